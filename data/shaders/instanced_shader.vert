@@ -0,0 +1,29 @@
+#version 450
+
+layout (binding = 0) uniform uniform_buffer_object
+{
+   mat4 model;
+   mat4 view;
+   mat4 proj;
+} ubo;
+
+/*
+ * The transforms written by gfx::instance_buffer, in the order of the 
+ * draw list. A batch draws from its first instance, which Vulkan adds 
+ * to gl_InstanceIndex.
+ */
+layout( std430, binding = 1 ) readonly buffer instance_data
+{
+   mat4 transforms[];
+};
+
+layout( location = 0 ) in vec2 in_position;
+layout( location = 1 ) in vec3 in_colour;
+
+layout( location = 0 ) out vec3 frag_colour;
+
+void main( )
+{
+    gl_Position = ubo.proj * ubo.view * transforms[gl_InstanceIndex] * vec4( in_position, 0.0, 1.0 );
+    frag_colour = in_colour;
+}
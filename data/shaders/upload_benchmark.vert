@@ -0,0 +1,8 @@
+#version 450
+
+layout( location = 0 ) in vec3 in_position;
+
+void main( )
+{
+    gl_Position = vec4( in_position, 1.0 );
+}
@@ -17,8 +17,15 @@
  */
 
 #include <luciole/luciole.hpp>
+#include <luciole/assets/loading_pipeline.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/vk/memory_stats_recorder.hpp>
 #include <luciole/vk/shaders/shader_compiler.hpp>
 
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+
 int main( )
 {
    ui::window::create_info const create_info 
@@ -32,18 +39,94 @@ int main( )
    auto ctx = context( wnd );
    auto rdr = renderer( p_context_t( &ctx ), wnd );
 
+   // Dumps to compare with tools/memory_stats_diff, one once the content
+   // is loaded and then every 10 seconds.
+   vk::memory_stats_recorder::create_info const recorder_create_info
+   {
+      .p_context = &ctx
+   };
+
+   auto memory_recorder = vk::memory_stats_recorder( vk::memory_stats_recorder::create_info_t( recorder_create_info ) );
+
+   auto pool = thread_pool( );
+
+   assets::loading_pipeline::create_info const loading_create_info
+   {
+      .p_thread_pool = &pool
+   };
+
+   auto loading = assets::loading_pipeline( assets::loading_pipeline::create_info_t( loading_create_info ) );
+
    vk::shader_compiler* p_shader_compiler = new vk::shader_compiler( );
 
-   auto vert_shader_id = rdr.load_shader( p_shader_compiler, vk::shader::filepath_t( "../data/shaders/default_shader.vert" ) );
-   auto frag_shader_id = rdr.load_shader( p_shader_compiler, vk::shader::filepath_t( "../data/shaders/default_shader.frag" ) ); 
+   rdr.load_content( loading );
+
+   // The shader manager is only used by this job until it is done.
+   assets::loading_pipeline::job shader_job;
+   shader_job.name = "default shaders";
+   shader_job.steps.push_back( { assets::load_stage::e_decode, [&rdr, p_shader_compiler] 
+   {
+      rdr.load_shader( p_shader_compiler, vk::shader::filepath_t( "../data/shaders/default_shader.vert" ) );
+      rdr.load_shader( p_shader_compiler, vk::shader::filepath_t( "../data/shaders/default_shader.frag" ) ); 
+   } } );
+
+   loading.enqueue( std::move( shader_job ) );
+
+   bool is_loading = true;
+   int reported_percent = -1;
 
    while( wnd.is_open() )
    {
+      loading.update( );
+
+      if ( is_loading )
+      {
+         auto const progress = loading.get_progress( );
+         
+         if ( int const percent = static_cast<int>( progress.get_fraction( ) * 100.0f ); percent / 10 != reported_percent / 10 )
+         {
+            reported_percent = percent;
+            spdlog::info( "Loading {0}%.", percent );
+         }
+
+         if ( progress.is_done( ) )
+         {
+            is_loading = false;
+
+            spdlog::info( 
+               "Loaded {0} jobs, {1} failed, in {2} ms.", 
+               progress.job_count, 
+               progress.failed_job_count,
+               std::chrono::duration_cast<std::chrono::milliseconds>( progress.elapsed_time ).count( ) 
+            );
+
+            for( std::size_t i = 0; i < assets::load_stage_count; ++i )
+            {
+               spdlog::info( 
+                  "   {0}: {1} steps, {2} ms.",
+                  assets::to_string( static_cast<assets::load_stage>( i ) ),
+                  progress.stages[i].completed_count,
+                  std::chrono::duration_cast<std::chrono::milliseconds>( progress.stages[i].busy_time ).count( )
+               );
+            }
+
+            for( auto const& error : loading.get_errors( ) )
+            {
+               spdlog::error( "Load failed: {0}.", error );
+            }
+
+            memory_recorder.record( );
+         }
+      }
+
       rdr.draw_frame();
+      memory_recorder.update( );
 
       wnd.poll_events();
    }
 
+   pool.wait_idle( );
+
    delete p_shader_compiler;
    p_shader_compiler = nullptr;
 
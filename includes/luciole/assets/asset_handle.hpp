@@ -0,0 +1,534 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_ASSET_HANDLE_HPP
+#define LUCIOLE_ASSETS_ASSET_HANDLE_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/delegate.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * @brief Where an asset requested through an asset_cache is.
+    */
+   enum class asset_state : std::uint32_t
+   {
+      e_queued,
+      e_loading,
+      e_ready,
+      e_failed
+   }; // enum class asset_state
+
+   template<typename T>
+   class asset_handle;
+
+   template<typename T, typename Decoded>
+   class asset_cache;
+
+   namespace detail
+   {
+      /**
+       * @brief The shared state of every handle to an asset. It is owned
+       * by its asset_cache, which frees it once no handle is left.
+       */
+      template<typename T>
+      struct asset_slot
+      {
+         std::atomic<std::uint32_t> ref_count = 0;
+         std::atomic<asset_state> state = asset_state::e_queued;
+
+         std::string filepath;
+         std::string error;
+
+         T value;
+         T const* p_placeholder = nullptr;
+
+         std::vector<delegate<void( asset_handle<T> const& )>> continuations;
+      }; // struct asset_slot
+   } // namespace detail
+
+   /**
+    * @brief A counted reference to an asset loaded by an asset_cache.
+    *
+    * Handles may be copied and released from any thread, but the asset
+    * itself and the continuations are only touched by the thread calling
+    * asset_cache::update. Handles must not outlive their cache.
+    */
+   template<typename T>
+   class asset_handle
+   {
+   public:
+      using continuation = delegate<void( asset_handle<T> const& )>;
+
+   public:
+      asset_handle( ) = default;
+      explicit asset_handle( detail::asset_slot<T>* p_slot ) noexcept
+         :
+         p_slot( p_slot )
+      {
+         acquire( );
+      }
+      asset_handle( asset_handle const& rhs ) noexcept
+         :
+         p_slot( rhs.p_slot )
+      {
+         acquire( );
+      }
+      asset_handle( asset_handle&& rhs ) noexcept
+         :
+         p_slot( rhs.p_slot )
+      {
+         rhs.p_slot = nullptr;
+      }
+      ~asset_handle( )
+      {
+         release( );
+      }
+
+      asset_handle& operator=( asset_handle const& rhs ) noexcept
+      {
+         if ( this != &rhs )
+         {
+            release( );
+            p_slot = rhs.p_slot;
+            acquire( );
+         }
+
+         return *this;
+      }
+      asset_handle& operator=( asset_handle&& rhs ) noexcept
+      {
+         if ( this != &rhs )
+         {
+            release( );
+            p_slot = rhs.p_slot;
+            rhs.p_slot = nullptr;
+         }
+
+         return *this;
+      }
+
+      bool operator==( asset_handle const& rhs ) const noexcept
+      {
+         return p_slot == rhs.p_slot;
+      }
+      bool operator!=( asset_handle const& rhs ) const noexcept
+      {
+         return p_slot != rhs.p_slot;
+      }
+
+      /**
+       * @brief Whether the handle refers to an asset at all.
+       */
+      [[nodiscard]]
+      bool is_valid( ) const noexcept
+      {
+         return p_slot != nullptr;
+      }
+
+      [[nodiscard]]
+      asset_state get_state( ) const noexcept
+      {
+         return p_slot != nullptr ? p_slot->state.load( std::memory_order_acquire ) : asset_state::e_failed;
+      }
+
+      [[nodiscard]]
+      bool is_ready( ) const noexcept
+      {
+         return get_state( ) == asset_state::e_ready;
+      }
+
+      /**
+       * @brief Get the asset once it is ready, or the placeholder of its
+       * cache until then and when it failed to load.
+       *
+       * @return The asset, the placeholder, or null when the cache has 
+       * no placeholder.
+       */
+      [[nodiscard]]
+      T const* get( ) const noexcept
+      {
+         if ( p_slot == nullptr )
+         {
+            return nullptr;
+         }
+
+         return is_ready( ) ? &p_slot->value : p_slot->p_placeholder;
+      }
+
+      [[nodiscard]]
+      std::string const& get_filepath( ) const noexcept
+      {
+         return p_slot->filepath;
+      }
+
+      /**
+       * @brief The message of the exception thrown while the asset was
+       * loaded, empty unless the asset failed.
+       */
+      [[nodiscard]]
+      std::string const& get_error( ) const noexcept
+      {
+         return p_slot->error;
+      }
+
+      [[nodiscard]]
+      std::uint32_t get_ref_count( ) const noexcept
+      {
+         return p_slot != nullptr ? p_slot->ref_count.load( std::memory_order_relaxed ) : 0;
+      }
+
+      /**
+       * @brief Run a function once the asset is ready or has failed, from 
+       * asset_cache::update. It runs right away if the asset is already 
+       * done. Must be called from the thread calling asset_cache::update.
+       */
+      void then( continuation const& f ) const
+      {
+         auto const state = get_state( );
+         if ( state == asset_state::e_ready || state == asset_state::e_failed )
+         {
+            f( *this );
+         }
+         else
+         {
+            p_slot->continuations.push_back( f );
+         }
+      }
+
+   private:
+      void acquire( ) noexcept
+      {
+         if ( p_slot != nullptr )
+         {
+            p_slot->ref_count.fetch_add( 1, std::memory_order_relaxed );
+         }
+      }
+
+      void release( ) noexcept
+      {
+         if ( p_slot != nullptr )
+         {
+            p_slot->ref_count.fetch_sub( 1, std::memory_order_acq_rel );
+            p_slot = nullptr;
+         }
+      }
+
+   private:
+      detail::asset_slot<T>* p_slot = nullptr;
+   }; // class asset_handle
+
+   /**
+    * @brief Loads assets of one type by path and hands out asset_handles
+    * to them. Requests for a path that is already loaded or loading share
+    * the same asset.
+    *
+    * Loading is split in two: decode runs on the thread pool and turns a 
+    * file into a Decoded value, then finalize turns it into the asset on 
+    * the thread calling update, which is where GPU resources are created.
+    * Assets no handle refers to anymore are freed by update.
+    *
+    * @tparam T The asset type, default constructible and move assignable.
+    * @tparam Decoded What decode produces, the asset itself by default.
+    */
+   template<typename T, typename Decoded = T>
+   class asset_cache
+   {
+   public:
+      using decode_function = delegate<Decoded( std::string const& )>;
+      using finalize_function = delegate<T( Decoded&& )>;
+
+      struct create_info
+      {
+         /**
+          * @brief May be null, in which case decoding is deferred to update.
+          */
+         thread_pool* p_thread_pool = nullptr;
+
+         decode_function decode;
+
+         /**
+          * @brief May be empty when Decoded is T.
+          */
+         finalize_function finalize;
+
+         /**
+          * @brief What handles return from get while their asset is not 
+          * ready. Must outlive the cache.
+          */
+         T const* p_placeholder = nullptr;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+      struct stats
+      {
+         std::uint64_t request_count = 0;
+         /**
+          * @brief Requests that were given an asset already loaded or
+          * loading instead of starting a new load.
+          */
+         std::uint64_t coalesced_count = 0;
+         std::uint64_t loaded_count = 0;
+         std::uint64_t failed_count = 0;
+
+         std::size_t asset_count = 0;
+         std::size_t pending_count = 0;
+      }; // struct stats
+
+   public:
+      asset_cache( ) = default;
+      explicit asset_cache( create_info_t const& create_info )
+         :
+         p_thread_pool( create_info.value( ).p_thread_pool ),
+         decode( create_info.value( ).decode ),
+         finalize( create_info.value( ).finalize ),
+         p_placeholder( create_info.value( ).p_placeholder )
+      { }
+      asset_cache( asset_cache const& rhs ) = delete;
+      asset_cache( asset_cache&& rhs ) noexcept
+      {
+         *this = std::move( rhs );
+      }
+      ~asset_cache( )
+      {
+         wait_pending( );
+      }
+
+      asset_cache& operator=( asset_cache const& rhs ) = delete;
+      asset_cache& operator=( asset_cache&& rhs ) noexcept
+      {
+         if ( this != &rhs )
+         {
+            wait_pending( );
+
+            p_thread_pool = rhs.p_thread_pool;
+            rhs.p_thread_pool = nullptr;
+
+            decode = std::move( rhs.decode );
+            finalize = std::move( rhs.finalize );
+
+            p_placeholder = rhs.p_placeholder;
+            rhs.p_placeholder = nullptr;
+
+            slots = std::move( rhs.slots );
+            pending = std::move( rhs.pending );
+            cache_stats = rhs.cache_stats;
+         }
+
+         return *this;
+      }
+
+      /**
+       * @brief Get a handle to the asset at a path, and start loading it
+       * if it is not loaded or loading already.
+       */
+      [[nodiscard]]
+      asset_handle<T> request( std::string const& filepath )
+      {
+         return request( filepath, decode );
+      }
+
+      /**
+       * @brief Get a handle to the asset at a path, decoding it with a
+       * specific function if it has to be loaded. 
+       */
+      [[nodiscard]]
+      asset_handle<T> request( std::string const& filepath, decode_function const& decode_override )
+      {
+         ++cache_stats.request_count;
+
+         if ( auto const it = slots.find( filepath ); it != slots.end( ) )
+         {
+            ++cache_stats.coalesced_count;
+
+            return asset_handle<T>( it->second.get( ) );
+         }
+
+         auto p_slot = std::make_unique<detail::asset_slot<T>>( );
+         p_slot->filepath = filepath;
+         p_slot->p_placeholder = p_placeholder;
+
+         auto const task = [decode_override, filepath, p_state = &p_slot->state] {
+            p_state->store( asset_state::e_loading, std::memory_order_release );
+
+            if ( decode_override == nullptr )
+            {
+               throw std::runtime_error( "No decode function for asset " + filepath );
+            }
+
+            return decode_override( filepath );
+         };
+
+         pending_load load{ .p_slot = p_slot.get( ) };
+         if ( p_thread_pool != nullptr )
+         {
+            load.future = p_thread_pool->submit( task );
+         }
+         else
+         {
+            load.future = std::async( std::launch::deferred, task );
+         }
+
+         auto handle = asset_handle<T>( p_slot.get( ) );
+
+         pending.push_back( std::move( load ) );
+         slots.emplace( filepath, std::move( p_slot ) );
+
+         return handle;
+      }
+
+      /**
+       * @brief Finalize the assets that are done decoding, run their
+       * continuations and free the assets no handle refers to anymore.
+       *
+       * @param [in] max_finalized The most assets finalized by this call,
+       * to spread the cost of creating GPU resources over frames.
+       */
+      void update( std::size_t max_finalized = std::numeric_limits<std::size_t>::max( ) )
+      {
+         std::size_t finalized_count = 0;
+         for( auto it = pending.begin( ); it != pending.end( ) && finalized_count < max_finalized; )
+         {
+            if ( it->future.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::timeout )
+            {
+               ++it;
+
+               continue;
+            }
+
+            auto* p_slot = it->p_slot;
+            try
+            {
+               if constexpr ( std::is_same_v<T, Decoded> )
+               {
+                  p_slot->value = finalize != nullptr ? finalize( it->future.get( ) ) : it->future.get( );
+               }
+               else
+               {
+                  if ( finalize == nullptr )
+                  {
+                     throw std::runtime_error( "No finalize function for asset " + p_slot->filepath );
+                  }
+
+                  p_slot->value = finalize( it->future.get( ) );
+               }
+
+               p_slot->state.store( asset_state::e_ready, std::memory_order_release );
+               ++cache_stats.loaded_count;
+            }
+            catch( std::exception const& e )
+            {
+               p_slot->error = e.what( );
+               p_slot->state.store( asset_state::e_failed, std::memory_order_release );
+               ++cache_stats.failed_count;
+            }
+
+            it = pending.erase( it );
+            ++finalized_count;
+
+            auto const continuations = std::move( p_slot->continuations );
+            auto const handle = asset_handle<T>( p_slot );
+            for( auto const& f : continuations )
+            {
+               f( handle );
+            }
+         }
+
+         for( auto it = slots.begin( ); it != slots.end( ); )
+         {
+            auto const state = it->second->state.load( std::memory_order_acquire );
+            bool const is_done = state == asset_state::e_ready || state == asset_state::e_failed;
+
+            if ( is_done && it->second->ref_count.load( std::memory_order_acquire ) == 0 )
+            {
+               it = slots.erase( it );
+            }
+            else
+            {
+               ++it;
+            }
+         }
+      }
+
+      [[nodiscard]]
+      stats get_stats( ) const noexcept
+      {
+         auto res = cache_stats;
+         res.asset_count = slots.size( );
+         res.pending_count = pending.size( );
+
+         return res;
+      }
+
+   private:
+      struct pending_load
+      {
+         detail::asset_slot<T>* p_slot = nullptr;
+         std::future<Decoded> future;
+      }; // struct pending_load
+
+      /**
+       * @brief Wait for the decodes running on the thread pool, which 
+       * refer to the slots.
+       */
+      void wait_pending( ) noexcept
+      {
+         for( auto& load : pending )
+         {
+            if ( load.future.valid( ) && load.future.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::deferred )
+            {
+               load.future.wait( );
+            }
+         }
+      }
+
+   private:
+      thread_pool* p_thread_pool = nullptr;
+
+      decode_function decode;
+      finalize_function finalize;
+
+      T const* p_placeholder = nullptr;
+
+      std::unordered_map<std::string, std::unique_ptr<detail::asset_slot<T>>> slots;
+      std::vector<pending_load> pending;
+
+      stats cache_stats;
+   }; // class asset_cache
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_ASSET_HANDLE_HPP
@@ -0,0 +1,266 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_COOKED_MESH_HPP
+#define LUCIOLE_ASSETS_COOKED_MESH_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/assets/derived_data_cache.hpp>
+#include <luciole/assets/gltf_loader.hpp>
+#include <luciole/assets/mesh.hpp>
+#include <luciole/utils/file_io.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * Layout of a cooked mesh file, all values little endian:
+    *
+    *    cooked_mesh_header
+    *    cooked_mesh_entry[mesh_count]
+    *    cooked_primitive[primitive_count]
+    *    cooked_lod[lod_count]
+    *    names
+    *    for every mesh, its vertex blob then its index blob, each aligned
+    *    on cooked_blob_alignment
+    *
+    * The blobs are in their final GPU layout: vertices encoded with the
+    * mesh_vertex_layout, and 16 bit indices when every primitive of the
+    * mesh has few enough vertices, 32 bit ones otherwise. The offsets of
+    * a primitive are relative to the blobs of its mesh, so a mesh can be
+    * loaded on its own.
+    */
+   static constexpr std::uint32_t cooked_mesh_magic = 0x48534d4c; // "LMSH"
+   static constexpr std::uint32_t cooked_mesh_version = 2;
+   static constexpr std::uint64_t cooked_blob_alignment = 256;
+
+   struct cooked_mesh_header
+   {
+      std::uint32_t magic = cooked_mesh_magic;
+      std::uint32_t version = cooked_mesh_version;
+      std::uint32_t vertex_stride = mesh_vertex_layout::stride;
+      std::uint32_t mesh_count = 0;
+      std::uint32_t primitive_count = 0;
+      std::uint32_t lod_count = 0;
+
+      std::uint64_t mesh_table_offset = 0;
+      std::uint64_t primitive_table_offset = 0;
+      std::uint64_t lod_table_offset = 0;
+      std::uint64_t name_table_offset = 0;
+      std::uint64_t file_size = 0;
+   }; // struct cooked_mesh_header
+
+   struct cooked_mesh_entry
+   {
+      std::uint32_t name_offset = 0;
+      std::uint32_t name_size = 0;
+
+      std::uint32_t first_primitive = 0;
+      std::uint32_t primitive_count = 0;
+      std::uint32_t first_lod = 0;
+      std::uint32_t lod_count = 0;
+
+      std::uint32_t vertex_count = 0;
+      std::uint32_t index_count = 0;
+      std::uint64_t vertex_offset = 0;
+      std::uint64_t index_offset = 0;
+
+      float min[3] = { 0.0f, 0.0f, 0.0f };
+      float max[3] = { 0.0f, 0.0f, 0.0f };
+
+      /**
+       * @brief The size of an index of the index blob, 2 or 4 bytes.
+       */
+      std::uint32_t index_size = sizeof( std::uint32_t );
+      std::uint32_t reserved = 0;
+   }; // struct cooked_mesh_entry
+
+   struct cooked_primitive
+   {
+      std::uint32_t first_index = 0;
+      std::uint32_t index_count = 0;
+      std::int32_t vertex_offset = 0;
+      std::uint32_t vertex_count = 0;
+      std::int32_t material = -1;
+      std::uint32_t first_lod = 0;
+      std::uint32_t lod_count = 0;
+      std::uint32_t reserved = 0;
+
+      float min[3] = { 0.0f, 0.0f, 0.0f };
+      float max[3] = { 0.0f, 0.0f, 0.0f };
+   }; // struct cooked_primitive
+
+   struct cooked_lod
+   {
+      std::uint32_t first_index = 0;
+      std::uint32_t index_count = 0;
+      float error = 0.0f;
+      std::uint32_t reserved = 0;
+   }; // struct cooked_lod
+
+   static_assert( std::is_trivially_copyable_v<cooked_mesh_header> && sizeof( cooked_mesh_header ) == 64 );
+   static_assert( std::is_trivially_copyable_v<cooked_mesh_entry> && sizeof( cooked_mesh_entry ) == 80 );
+   static_assert( std::is_trivially_copyable_v<cooked_primitive> && sizeof( cooked_primitive ) == 56 );
+   static_assert( std::is_trivially_copyable_v<cooked_lod> && sizeof( cooked_lod ) == 16 );
+
+   /**
+    * @brief How the levels of detail of the meshes are generated when
+    * they are cooked.
+    */
+   struct lod_settings
+   {
+      std::uint32_t max_lod_count = 4;
+
+      /**
+       * @brief The ratio of triangles kept from one level to the next.
+       */
+      float reduction = 0.5f;
+
+      /**
+       * @brief Primitives with fewer triangles get no level of detail.
+       */
+      std::uint32_t min_triangle_count = 256;
+   }; // struct lod_settings
+
+   /**
+    * @brief Generate the levels of detail of every primitive with the
+    * quadric error simplifier, replacing those the meshes had. The
+    * indices of the levels are appended to the indices of the data.
+    *
+    * @param [in, out] data The meshes to generate the levels of.
+    * @param [in] settings How the levels are built.
+    * @param [in] pool The pool the primitives are simplified on.
+    */
+   void generate_lods(
+      mesh_data& data,
+      lod_settings const& settings,
+      thread_pool& pool
+   );
+
+   /**
+    * @brief Turn decoded meshes into a cooked mesh file. The scene nodes
+    * are not part of the format.
+    *
+    * @param [in] data The meshes to cook.
+    *
+    * @return The content of the file.
+    */
+   [[nodiscard]]
+   std::vector<std::byte> cook_meshes(
+      mesh_data const& data
+   );
+
+   /**
+    * @brief Get the cooked mesh file of a glTF file from a derived data
+    * cache. The glTF file is only decoded and cooked when its content, or
+    * the content of its external buffers, changed since it was cached.
+    *
+    * @param [in] cache The cache to look into and store to.
+    * @param [in] loader The loader to decode the file with on a miss.
+    * @param [in] filepath The path of the .gltf or .glb file.
+    * @param [in] settings How the levels of detail are generated.
+    *
+    * @return The path of the cooked mesh file, to open with a
+    * cooked_mesh_file.
+    *
+    * @throw std::runtime_error if the file could not be loaded.
+    */
+   [[nodiscard]]
+   std::string get_cooked_meshes(
+      derived_data_cache& cache,
+      gltf_loader const& loader,
+      std::string const& filepath,
+      lod_settings const& settings = { }
+   );
+
+   /**
+    * @brief A memory mapped cooked mesh file. Staging meshes only
+    * copies their blobs, with no per vertex work.
+    */
+   class cooked_mesh_file
+   {
+   public:
+      cooked_mesh_file( ) = default;
+
+      /**
+       * @throw std::runtime_error if the file cannot be mapped or is
+       * not a valid cooked mesh file of the current version.
+       */
+      explicit cooked_mesh_file( std::string const& filepath );
+
+      [[nodiscard]]
+      std::uint32_t get_mesh_count(
+      ) const PURE;
+
+      [[nodiscard]]
+      std::string_view get_mesh_name(
+         std::uint32_t mesh_index
+      ) const PURE;
+
+      /**
+       * @brief Find a mesh by name.
+       */
+      [[nodiscard]]
+      std::optional<std::uint32_t> find_mesh(
+         std::string_view name
+      ) const PURE;
+
+      /**
+       * @brief Copy the blobs of some meshes into a new staging buffer.
+       * The indices are staged on 16 bits if every mesh has 16 bit
+       * indices, and widened to 32 bits otherwise.
+       *
+       * @param [in] p_context The context to create the staging buffer with.
+       * @param [in] mesh_indices The meshes to load, in the order they
+       * will appear in the import.
+       */
+      [[nodiscard]]
+      mesh_import stage(
+         context const* p_context,
+         std::vector<std::uint32_t> const& mesh_indices
+      ) const;
+
+      /**
+       * @brief Copy the blobs of every mesh into a new staging buffer.
+       */
+      [[nodiscard]]
+      mesh_import stage_all(
+         context const* p_context
+      ) const;
+
+   private:
+      std::string filepath;
+      mapped_file file;
+
+      cooked_mesh_header const* p_header = nullptr;
+      cooked_mesh_entry const* p_meshes = nullptr;
+      cooked_primitive const* p_primitives = nullptr;
+      cooked_lod const* p_lods = nullptr;
+      char const* p_names = nullptr;
+   }; // class cooked_mesh_file
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_COOKED_MESH_HPP
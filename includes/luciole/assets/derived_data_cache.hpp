@@ -0,0 +1,207 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_DERIVED_DATA_CACHE_HPP
+#define LUCIOLE_ASSETS_DERIVED_DATA_CACHE_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * @brief Hash a range of bytes, with a 64 bit non cryptographic hash.
+    */
+   [[nodiscard]]
+   std::uint64_t hash_bytes( 
+      void const* p_data, 
+      std::size_t size, 
+      std::uint64_t seed = 0 
+   ) noexcept PURE;
+
+   /**
+    * @brief Hash the content of a file.
+    *
+    * @throw std::runtime_error if the file cannot be read.
+    */
+   [[nodiscard]]
+   std::uint64_t hash_file( 
+      std::string const& filepath 
+   );
+
+   /**
+    * @brief Everything a cooked artifact depends on. Two keys that are 
+    * equal always map to the same artifact.
+    */
+   struct derived_data_key
+   {
+      /**
+       * @brief The name of the importer, e.g. "texture" or "spir_v".
+       */
+      std::string importer;
+
+      /**
+       * @brief Bumped whenever the importer changes its output, which
+       * invalidates all its previous artifacts.
+       */
+      std::uint32_t importer_version = 0;
+
+      /**
+       * @brief The hash of the source the artifact is made from.
+       */
+      std::uint64_t source_hash = 0;
+
+      /**
+       * @brief The import settings, in any stable textual form.
+       */
+      std::string settings;
+   }; // struct derived_data_key
+
+   /**
+    * @brief A content addressed cache of cooked artifacts on disk. Every
+    * artifact is a file named after the digest of its key, so importers 
+    * only run again when their source, settings or version change.
+    *
+    * Artifacts are written to a temporary file and renamed, so a crash 
+    * or a concurrent writer never leaves a partial artifact behind. When 
+    * the cache grows past its size limit, the least recently used 
+    * artifacts are deleted.
+    *
+    * All the functions are thread safe.
+    */
+   class derived_data_cache
+   {
+   public:
+      struct create_info
+      {
+         std::string directory;
+
+         std::uint64_t max_size = 4ull * 1024 * 1024 * 1024;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+      struct stats
+      {
+         std::uint64_t hit_count = 0;
+         std::uint64_t miss_count = 0;
+         std::uint64_t store_count = 0;
+         std::uint64_t pruned_count = 0;
+
+         /**
+          * @brief The bytes of all the artifacts in the cache.
+          */
+         std::uint64_t size = 0;
+      }; // struct stats
+
+   public:
+      /**
+       * @brief Open a cache directory, creating it if needed.
+       *
+       * @throw std::runtime_error if the directory cannot be created.
+       */
+      explicit derived_data_cache( create_info_t const& create_info );
+      derived_data_cache( derived_data_cache const& rhs ) = delete;
+      derived_data_cache( derived_data_cache&& rhs ) = delete;
+      ~derived_data_cache( ) = default;
+
+      derived_data_cache& operator=( derived_data_cache const& rhs ) = delete;
+      derived_data_cache& operator=( derived_data_cache&& rhs ) = delete;
+
+      /**
+       * @brief Look for the artifact of a key and mark it as used.
+       *
+       * @return The path of the artifact, if it is in the cache.
+       */
+      [[nodiscard]]
+      std::optional<std::string> find( 
+         derived_data_key const& key 
+      );
+
+      /**
+       * @brief Read the artifact of a key and mark it as used.
+       *
+       * @return The content of the artifact, if it is in the cache.
+       */
+      [[nodiscard]]
+      std::optional<std::vector<std::byte>> load( 
+         derived_data_key const& key 
+      );
+
+      /**
+       * @brief Write the artifact of a key, replacing any previous one.
+       * If the cache is now over its size limit, it is pruned down to 
+       * three quarters of it.
+       *
+       * @return The path of the artifact.
+       *
+       * @throw std::runtime_error if the artifact cannot be written.
+       */
+      std::string store( 
+         derived_data_key const& key, 
+         std::vector<std::byte> const& data 
+      );
+
+      /**
+       * @brief Delete the least recently used artifacts until the cache 
+       * fits in a size.
+       */
+      void prune( 
+         std::uint64_t target_size 
+      );
+
+      [[nodiscard]]
+      stats get_stats( 
+      ) const;
+
+      /**
+       * @brief Get the 128 bit digest of a key, as 32 hex characters.
+       */
+      [[nodiscard]]
+      static std::string get_digest( 
+         derived_data_key const& key 
+      );
+
+   private:
+      [[nodiscard]]
+      std::string get_artifact_path( 
+         derived_data_key const& key 
+      ) const;
+
+      void prune_locked( 
+         std::uint64_t target_size 
+      );
+
+   private:
+      std::string directory;
+      std::uint64_t max_size = 0;
+
+      mutable std::mutex mutex;
+      stats cache_stats;
+   }; // class derived_data_cache
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_DERIVED_DATA_CACHE_HPP
@@ -0,0 +1,121 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_GLTF_LOADER_HPP
+#define LUCIOLE_ASSETS_GLTF_LOADER_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/assets/mesh.hpp>
+#include <luciole/context.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <future>
+#include <string>
+
+namespace assets
+{
+   /**
+    * @brief Loads glTF files on a thread pool. Parsing and decoding
+    * the accessors happen on the workers, the primitives of a file
+    * being decoded in parallel straight into a mapped staging buffer.
+    * Only the upload, which submits to the device queues, has to run
+    * on the thread owning the context.
+    */
+   class gltf_loader
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+         thread_pool* p_thread_pool = nullptr;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      gltf_loader( ) = default;
+      gltf_loader( create_info_t const& create_info );
+
+      /**
+       * @brief Parse and decode a .gltf or .glb file on the thread pool.
+       *
+       * @param [in] filepath The path of the file.
+       *
+       * @return A future to the decoded file. Holds a std::runtime_error
+       * if the file could not be loaded.
+       */
+      [[nodiscard]]
+      std::future<mesh_import> load_async( 
+         std::string const& filepath 
+      ) const;
+
+      /**
+       * @brief Parse and decode a .gltf or .glb file on the calling
+       * thread, decoding the primitives on the thread pool.
+       *
+       * @param [in] filepath The path of the file.
+       *
+       * @throw std::runtime_error if the file could not be loaded.
+       */
+      [[nodiscard]]
+      mesh_import load( 
+         std::string const& filepath 
+      ) const;
+
+      /**
+       * @brief Parse and decode a .gltf or .glb file into host memory,
+       * decoding the primitives on the thread pool. Does not need a
+       * context.
+       *
+       * @param [in] filepath The path of the file.
+       *
+       * @throw std::runtime_error if the file could not be loaded.
+       */
+      [[nodiscard]]
+      mesh_data decode( 
+         std::string const& filepath 
+      ) const;
+
+      /**
+       * @brief Copy a decoded file into device local buffers. Must be
+       * called from the thread owning the context.
+       *
+       * @param [in] import The decoded file.
+       *
+       * @throw std::runtime_error if the upload failed.
+       */
+      [[nodiscard]]
+      mesh_scene upload( 
+         mesh_import&& import 
+      ) const;
+
+      /**
+       * @brief The pool the primitives are decoded on.
+       */
+      [[nodiscard]]
+      thread_pool* get_thread_pool(
+      ) const noexcept PURE;
+
+   private:
+      context const* p_context = nullptr;
+      thread_pool* p_thread_pool = nullptr;
+   }; // class gltf_loader
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_GLTF_LOADER_HPP
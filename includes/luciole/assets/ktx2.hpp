@@ -0,0 +1,169 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_KTX2_HPP
+#define LUCIOLE_ASSETS_KTX2_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/assets/texture_loader.hpp>
+#include <luciole/graphics/block_compression.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/file_io.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * Layout of a KTX2 file, as far as it is used here, all values little
+    * endian:
+    *
+    *    ktx2_header
+    *    ktx2_level[level_count]
+    *    data format descriptor
+    *    the mip levels, from the smallest to the largest
+    *
+    * Only 2D textures without supercompression are supported, so the
+    * mip levels can be copied to the GPU as they are.
+    */
+   static constexpr std::uint8_t ktx2_identifier[12] = { 
+      0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A 
+   };
+
+   struct ktx2_header
+   {
+      std::uint8_t identifier[12];
+      std::uint32_t vk_format = 0;
+      std::uint32_t type_size = 0;
+      std::uint32_t pixel_width = 0;
+      std::uint32_t pixel_height = 0;
+      std::uint32_t pixel_depth = 0;
+      std::uint32_t layer_count = 0;
+      std::uint32_t face_count = 0;
+      std::uint32_t level_count = 0;
+      std::uint32_t supercompression_scheme = 0;
+
+      std::uint32_t dfd_byte_offset = 0;
+      std::uint32_t dfd_byte_length = 0;
+      std::uint32_t kvd_byte_offset = 0;
+      std::uint32_t kvd_byte_length = 0;
+      std::uint64_t sgd_byte_offset = 0;
+      std::uint64_t sgd_byte_length = 0;
+   }; // struct ktx2_header
+
+   struct ktx2_level
+   {
+      std::uint64_t byte_offset = 0;
+      std::uint64_t byte_length = 0;
+      std::uint64_t uncompressed_byte_length = 0;
+   }; // struct ktx2_level
+
+   static_assert( std::is_trivially_copyable_v<ktx2_header> && sizeof( ktx2_header ) == 80 );
+   static_assert( std::is_trivially_copyable_v<ktx2_level> && sizeof( ktx2_level ) == 24 );
+
+   /**
+    * @brief Generate the mip chain of an image on the CPU, compress every
+    * level and write them in a KTX2 file.
+    *
+    * @param [in] image A single level image in VK_FORMAT_R8G8B8A8_SRGB or
+    * VK_FORMAT_R8G8B8A8_UNORM. sRGB images are filtered in linear space.
+    * @param [in] format The block format to compress to.
+    * @param [in] p_thread_pool If not null, the blocks are compressed in
+    * parallel on it.
+    *
+    * @return The content of the file.
+    *
+    * @throw std::runtime_error if the image is not in one of the
+    * supported formats.
+    */
+   [[nodiscard]]
+   std::vector<std::byte> cook_texture(
+      image_data const& image,
+      gfx::block_format format,
+      thread_pool* p_thread_pool = nullptr
+   );
+
+   /**
+    * @brief A memory mapped KTX2 file.
+    */
+   class ktx2_file
+   {
+   public:
+      ktx2_file( ) = default;
+
+      /**
+       * @throw std::runtime_error if the file cannot be mapped, is not a
+       * valid KTX2 file, has more levels than the mip chain or levels smaller
+       * than their texels, or uses features or formats that are not supported.
+       */
+      explicit ktx2_file( std::string const& filepath );
+
+      [[nodiscard]]
+      VkFormat get_format(
+      ) const PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_width(
+      ) const PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_height(
+      ) const PURE;
+
+      /**
+       * @brief Get the number of levels stored in the file, at least 1.
+       */
+      [[nodiscard]]
+      std::uint32_t get_level_count(
+      ) const PURE;
+
+      /**
+       * @brief Check if the file only stores the base level and asks the
+       * loader to generate the rest of the mip chain, level_count == 0.
+       */
+      [[nodiscard]]
+      bool is_mip_chain_generated(
+      ) const PURE;
+
+      [[nodiscard]]
+      std::byte const* get_level_data(
+         std::uint32_t level
+      ) const PURE;
+
+      [[nodiscard]]
+      std::size_t get_level_size(
+         std::uint32_t level
+      ) const PURE;
+
+   private:
+      std::string filepath;
+      mapped_file file;
+
+      ktx2_header const* p_header = nullptr;
+      ktx2_level const* p_levels = nullptr;
+   }; // class ktx2_file
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_KTX2_HPP
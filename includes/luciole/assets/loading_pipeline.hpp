@@ -0,0 +1,257 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_LOADING_PIPELINE_HPP
+#define LUCIOLE_ASSETS_LOADING_PIPELINE_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/delegate.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * @brief The kinds of work a load is made of. Every stage but
+    * e_upload runs on the background threads, e_upload runs on the
+    * thread owning the context, since it submits to the queues.
+    */
+   enum class load_stage : std::size_t
+   {
+      e_io,
+      e_decode,
+      e_pipeline,
+      e_upload,
+      e_count
+   }; // enum class load_stage
+
+   static constexpr std::size_t load_stage_count = static_cast<std::size_t>( load_stage::e_count );
+
+   /**
+    * @brief Get the name of a load stage.
+    */
+   [[nodiscard]]
+   std::string const& to_string( load_stage stage ) PURE;
+
+   /**
+    * @brief A snapshot of how far the loading_pipeline is.
+    */
+   struct load_progress
+   {
+      struct stage
+      {
+         std::uint32_t queued_count = 0;
+         std::uint32_t completed_count = 0;
+
+         /**
+          * @brief The steps that threw, and the ones skipped because an
+          * earlier step of their job threw.
+          */
+         std::uint32_t failed_count = 0;
+
+         /**
+          * @brief The time spent running the steps of the stage, summed
+          * over all the threads.
+          */
+         std::chrono::nanoseconds busy_time = std::chrono::nanoseconds( 0 );
+      }; // struct stage
+
+      std::array<stage, load_stage_count> stages = { };
+
+      std::uint32_t job_count = 0;
+      std::uint32_t completed_job_count = 0;
+      std::uint32_t failed_job_count = 0;
+
+      /**
+       * @brief The wall clock time from the first job queued until now,
+       * or until the last job finished.
+       */
+      std::chrono::nanoseconds elapsed_time = std::chrono::nanoseconds( 0 );
+
+      /**
+       * @return The fraction, from 0 to 1, of the queued steps that are
+       * done, successfully or not.
+       */
+      [[nodiscard]]
+      float get_fraction(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      bool is_done(
+      ) const noexcept PURE;
+   }; // struct load_progress
+
+   /**
+    * @brief Runs loads made of ordered steps without blocking the main
+    * loop. The file reads, decoding and pipeline creation run on the 
+    * thread pool, the uploads run in update under a per frame time
+    * budget, so the window can keep polling its events and presenting
+    * while a level loads.
+    *
+    * The steps of a job run one after the other, and share their data
+    * through what they capture. A step that throws fails its job, the
+    * remaining steps of the job are skipped and the error is kept for
+    * get_errors.
+    *
+    * The pipeline cannot be moved, since its steps in flight point to it.
+    */
+   class loading_pipeline
+   {
+   public:
+      using step_function = delegate<void( )>;
+
+      struct step
+      {
+         load_stage stage = load_stage::e_io;
+         step_function function;
+      }; // struct step
+
+      struct job
+      {
+         std::string name;
+         std::vector<step> steps;
+      }; // struct job
+
+      struct create_info
+      {
+         /**
+          * @brief The pool running the background steps. When null, the
+          * pipeline starts its own load thread.
+          */
+         thread_pool* p_thread_pool = nullptr;
+
+         /**
+          * @brief The time update may spend on upload steps. At least one
+          * step is run per call, however long.
+          */
+         std::chrono::microseconds upload_budget = std::chrono::microseconds( 4000 );
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      explicit loading_pipeline( create_info_t const& create_info );
+      loading_pipeline( loading_pipeline const& rhs ) = delete;
+      loading_pipeline( loading_pipeline&& rhs ) = delete;
+      ~loading_pipeline( );
+
+      loading_pipeline& operator=( loading_pipeline const& rhs ) = delete;
+      loading_pipeline& operator=( loading_pipeline&& rhs ) = delete;
+
+      /**
+       * @brief Queue a job. Its first step starts right away if it runs
+       * in the background, or on the next update otherwise.
+       *
+       * @throw std::runtime_error if the job has no step, or a step has
+       * no function.
+       */
+      void enqueue( job&& j );
+
+      /**
+       * @brief Run the upload steps that are ready, until the upload
+       * budget is spent. Call it once per frame from the thread owning
+       * the context.
+       */
+      void update( );
+
+      [[nodiscard]]
+      load_progress get_progress(
+      ) const;
+
+      /**
+       * @return For every failed job, its name and the error of the step
+       * that threw.
+       */
+      [[nodiscard]]
+      std::vector<std::string> get_errors(
+      ) const;
+
+      [[nodiscard]]
+      bool is_done(
+      ) const noexcept PURE;
+
+   private:
+      struct job_state
+      {
+         std::string name;
+         std::vector<step> steps;
+         std::size_t next_step = 0;
+      }; // struct job_state
+
+      struct stage_counter
+      {
+         std::atomic<std::uint32_t> queued_count = 0;
+         std::atomic<std::uint32_t> completed_count = 0;
+         std::atomic<std::uint32_t> failed_count = 0;
+         std::atomic<std::int64_t> busy_time = 0;
+      }; // struct stage_counter
+
+   private:
+      /**
+       * @brief Send the next step of a job to the thread pool or to the
+       * upload queue, or retire the job if it has no step left.
+       */
+      void dispatch( std::shared_ptr<job_state> p_job );
+
+      /**
+       * @brief Run the next step of a job and time it.
+       *
+       * @return Whether the step succeeded. 
+       */
+      bool run_step( job_state& job );
+
+      void fail_job( job_state& job, std::string const& error );
+      void finish_job( );
+
+   private:
+      std::unique_ptr<thread_pool> p_owned_thread_pool;
+      thread_pool* p_thread_pool = nullptr;
+
+      std::chrono::microseconds upload_budget;
+
+      std::array<stage_counter, load_stage_count> counters;
+
+      std::atomic<std::uint32_t> job_count = 0;
+      std::atomic<std::uint32_t> completed_job_count = 0;
+      std::atomic<std::uint32_t> failed_job_count = 0;
+
+      std::atomic<std::int64_t> start_time = 0;
+      std::atomic<std::int64_t> finish_time = 0;
+
+      mutable std::mutex mutex;
+      std::condition_variable idle_condition;
+      std::deque<std::shared_ptr<job_state>> upload_queue;
+      std::vector<std::string> errors;
+      std::size_t background_step_count = 0;
+      bool is_stopping = false;
+   }; // class loading_pipeline
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_LOADING_PIPELINE_HPP
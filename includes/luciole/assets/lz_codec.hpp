@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_LZ_CODEC_HPP
+#define LUCIOLE_ASSETS_LZ_CODEC_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace assets
+{
+   /**
+    * A byte oriented LZ77 codec in the spirit of LZ4, made for decoding
+    * speed. A compressed stream is a series of sequences:
+    *
+    *    token                     literal length << 4 | ( match length - 4 )
+    *    [literal length bytes]    when the literal length nibble is 15
+    *    literals
+    *    match offset              16 bit little endian, 1 to 65535
+    *    [match length bytes]      when the match length nibble is 15
+    *
+    * Lengths of 15 and more continue in bytes of 255 ended by a smaller
+    * byte. The last sequence only has literals, and the last 12 bytes of
+    * the input are always literals so the decoder can copy in 16 byte 
+    * steps away from the end of the output.
+    */
+
+   /**
+    * @brief The largest output compress_lz can produce for an input size.
+    */
+   [[nodiscard]]
+   constexpr std::size_t get_lz_bound( std::size_t size ) noexcept
+   {
+      return size + size / 255 + 16;
+   }
+
+   /**
+    * @brief Compress a range of bytes.
+    *
+    * @param [in] p_src The bytes to compress.
+    * @param [in] src_size The number of bytes to compress.
+    * @param [out] p_dst Where to write the compressed bytes.
+    * @param [in] dst_capacity The size of p_dst. Compression always
+    * succeeds when it is at least get_lz_bound( src_size ).
+    *
+    * @return The compressed size, or 0 if it does not fit in dst_capacity.
+    */
+   [[nodiscard]]
+   std::size_t compress_lz(
+      std::byte const* p_src, std::size_t src_size,
+      std::byte* p_dst, std::size_t dst_capacity
+   ) noexcept;
+
+   /**
+    * @brief Decompress bytes compressed by compress_lz. Corrupted input 
+    * is detected and never read or written out of bounds.
+    *
+    * @param [in] p_src The compressed bytes.
+    * @param [in] src_size The number of compressed bytes.
+    * @param [out] p_dst Where to write the decompressed bytes.
+    * @param [in] dst_size The exact decompressed size.
+    *
+    * @return Whether the input was valid and decompressed to exactly
+    * dst_size bytes.
+    */
+   [[nodiscard]]
+   bool decompress_lz(
+      std::byte const* p_src, std::size_t src_size,
+      std::byte* p_dst, std::size_t dst_size
+   ) noexcept;
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_LZ_CODEC_HPP
@@ -0,0 +1,257 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_MESH_HPP
+#define LUCIOLE_ASSETS_MESH_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/context.hpp>
+#include <luciole/graphics/mesh_optimizer.hpp>
+#include <luciole/graphics/vertex_layout.hpp>
+#include <luciole/vk/buffers/queue_ownership.hpp>
+#include <luciole/vk/buffers/staging_buffer.hpp>
+#include <luciole/vk/memory_stats.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * @brief The layout the vertices of loaded meshes are stored with:
+    * full precision positions, octahedral normals and half float
+    * texture coordinates, 20 bytes per vertex.
+    */
+   using mesh_vertex_layout = gfx::vertex_layout<
+      gfx::attrib::float3,
+      gfx::attrib::octahedral16,
+      gfx::attrib::half2
+   >;
+
+   /**
+    * @brief A reduced level of detail of a primitive, drawn with the
+    * vertices of the primitive.
+    */
+   struct mesh_lod
+   {
+      std::uint32_t first_index = 0;
+      std::uint32_t index_count = 0;
+
+      /**
+       * @brief The geometric error of the level, in object space units.
+       */
+      float error = 0.0f;
+   }; // struct mesh_lod
+
+   /**
+    * @brief A range of the shared vertex and index buffers drawn with
+    * a single material.
+    */
+   struct mesh_primitive
+   {
+      std::uint32_t first_index = 0;
+      std::uint32_t index_count = 0;
+      std::int32_t vertex_offset = 0;
+      std::uint32_t vertex_count = 0;
+
+      std::int32_t material = -1;
+
+      /**
+       * @brief The range of the levels of detail of the mesh used by
+       * the primitive, past the full detail one.
+       */
+      std::uint32_t first_lod = 0;
+      std::uint32_t lod_count = 0;
+
+      glm::vec3 min = glm::vec3( 0.0f );
+      glm::vec3 max = glm::vec3( 0.0f );
+   }; // struct mesh_primitive
+
+   struct mesh
+   {
+      std::string name;
+      std::vector<mesh_primitive> primitives;
+      std::vector<mesh_lod> lods;
+   }; // struct mesh
+
+   /**
+    * @brief A node of the scene with a mesh, flattened to its world
+    * transform.
+    */
+   struct scene_node
+   {
+      std::int32_t mesh = -1;
+      glm::mat4 transform = glm::mat4( 1.0f );
+   }; // struct scene_node
+
+   /**
+    * @brief Meshes with their vertices and 32 bit indices in host memory.
+    */
+   struct mesh_data
+   {
+      std::vector<mesh> meshes;
+      std::vector<scene_node> nodes;
+
+      std::vector<std::byte> vertices;
+      std::vector<std::uint32_t> indices;
+
+      /**
+       * @brief The vertex cache statistics of the primitives before
+       * and after they were optimized on import.
+       */
+      gfx::mesh_optimization_report optimization;
+   }; // struct mesh_data
+
+   /**
+    * @brief Meshes with their vertices and indices written into a
+    * staging buffer, ready to be uploaded to the GPU.
+    */
+   struct mesh_import
+   {
+      std::string filepath;
+
+      std::vector<mesh> meshes;
+      std::vector<scene_node> nodes;
+
+      vk::staging_buffer staging;
+
+      VkDeviceSize vertex_offset = 0;
+      VkDeviceSize vertex_size = 0;
+      VkDeviceSize index_offset = 0;
+      VkDeviceSize index_size = 0;
+
+      /**
+       * @brief VK_INDEX_TYPE_UINT16 when every primitive has few enough
+       * vertices for its indices to fit on 16 bits.
+       */
+      VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+   }; // struct mesh_import
+
+   /**
+    * @brief Meshes with all of their vertices and indices in a single
+    * pair of device local buffers.
+    */
+   class mesh_scene
+   {
+   public:
+      mesh_scene( ) = default;
+      mesh_scene( 
+         context const* p_context, 
+         vk::buffer_allocation vertex_buffer, vk::buffer_allocation index_buffer, VkIndexType index_type,
+         std::vector<mesh>&& meshes, std::vector<scene_node>&& nodes );
+      mesh_scene( mesh_scene const& rhs ) = delete;
+      mesh_scene( mesh_scene&& rhs );
+      ~mesh_scene( );
+
+      mesh_scene& operator=( mesh_scene const& rhs ) = delete;
+      mesh_scene& operator=( mesh_scene&& rhs );
+
+      /**
+       * @brief Get the buffer holding the vertices, encoded with the
+       * mesh_vertex_layout.
+       */
+      [[nodiscard]]
+      VkBuffer get_vertex_buffer(
+      ) const PURE;
+
+      /**
+       * @brief Get the buffer holding the indices, relative to the
+       * vertex offset of their primitive.
+       */
+      [[nodiscard]]
+      VkBuffer get_index_buffer(
+      ) const PURE;
+
+      /**
+       * @brief Get the type to bind the index buffer with.
+       */
+      [[nodiscard]]
+      VkIndexType get_index_type(
+      ) const PURE;
+
+      [[nodiscard]]
+      std::vector<mesh> const& get_meshes(
+      ) const PURE;
+
+      [[nodiscard]]
+      std::vector<scene_node> const& get_nodes(
+      ) const PURE;
+
+   private:
+      context const* p_context = nullptr;
+
+      vk::buffer_allocation vertex_buffer;
+      vk::buffer_allocation index_buffer;
+      VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+
+      std::vector<mesh> meshes;
+      std::vector<scene_node> nodes;
+   }; // class mesh_scene
+
+   /**
+    * @brief Meshes whose upload was submitted but may not be done yet.
+    * The staging buffer and the submission must be kept until
+    * vk::is_submission_done, then the submission released.
+    */
+   struct pending_mesh_upload
+   {
+      mesh_scene scene;
+
+      vk::staging_buffer staging;
+      vk::pending_submission submission;
+   }; // struct pending_mesh_upload
+
+   /**
+    * @brief Copy imported meshes into device local buffers with a single
+    * batched upload. Must be called from the thread owning the context.
+    *
+    * @param [in] p_context The context to create the buffers with.
+    * @param [in] import The imported meshes, their staging buffer is
+    * released once the upload is done.
+    *
+    * @throw std::runtime_error if the upload failed.
+    */
+   [[nodiscard]]
+   mesh_scene upload_meshes( 
+      context const* p_context, 
+      mesh_import&& import 
+   );
+
+   /**
+    * @brief Submit the upload of imported meshes without waiting for it.
+    * Must be called from the thread owning the context.
+    *
+    * @param [in] p_context The context to create the buffers with.
+    * @param [in] import The imported meshes, their staging buffer is
+    * moved into the pending upload.
+    *
+    * @throw std::runtime_error if the upload could not be submitted.
+    */
+   [[nodiscard]]
+   pending_mesh_upload upload_meshes_async( 
+      context const* p_context, 
+      mesh_import&& import 
+   );
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_MESH_HPP
@@ -0,0 +1,252 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_PACK_FILE_HPP
+#define LUCIOLE_ASSETS_PACK_FILE_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/file_io.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * Layout of a pack file, all values little endian:
+    *
+    *    pack_header
+    *    pack_entry[entry_count], sorted by path hash then path
+    *    pack_block[block_count]
+    *    paths
+    *    the blocks of every entry, in entry order
+    *
+    * The content of an entry is split in blocks of pack_block_size bytes, 
+    * each compressed on its own with compress_lz, or stored as it is when
+    * it does not shrink. Any range of an entry can be read by only
+    * decoding the blocks it covers.
+    */
+   static constexpr std::uint32_t pack_magic = 0x4b41504c; // "LPAK"
+   static constexpr std::uint32_t pack_version = 1;
+   static constexpr std::uint32_t pack_block_size = 64 * 1024;
+
+   struct pack_header
+   {
+      std::uint32_t magic = pack_magic;
+      std::uint32_t version = pack_version;
+      std::uint32_t entry_count = 0;
+      std::uint32_t block_count = 0;
+
+      std::uint64_t entry_table_offset = 0;
+      std::uint64_t block_table_offset = 0;
+      std::uint64_t path_table_offset = 0;
+      std::uint64_t file_size = 0;
+   }; // struct pack_header
+
+   struct pack_entry
+   {
+      std::uint64_t path_hash = 0;
+      std::uint32_t path_offset = 0;
+      std::uint32_t path_size = 0;
+
+      std::uint64_t size = 0;
+      std::uint32_t first_block = 0;
+      std::uint32_t block_count = 0;
+   }; // struct pack_entry
+
+   struct pack_block
+   {
+      std::uint64_t offset = 0;
+
+      /**
+       * @brief Equal to size when the block is stored uncompressed.
+       */
+      std::uint32_t compressed_size = 0;
+      std::uint32_t size = 0;
+   }; // struct pack_block
+
+   static_assert( std::is_trivially_copyable_v<pack_header> && sizeof( pack_header ) == 48 );
+   static_assert( std::is_trivially_copyable_v<pack_entry> && sizeof( pack_entry ) == 32 );
+   static_assert( std::is_trivially_copyable_v<pack_block> && sizeof( pack_block ) == 16 );
+
+   /**
+    * @brief Get the hash a path is looked up by in a pack file.
+    */
+   [[nodiscard]]
+   std::uint64_t hash_pack_path(
+      std::string_view path
+   ) noexcept PURE;
+
+   /**
+    * @brief Gathers files in memory and builds a pack file out of them.
+    */
+   class pack_writer
+   {
+   public:
+      /**
+       * @brief Add a file to the pack.
+       *
+       * @param [in] path The path the file is found by, with '/' as
+       * the separator.
+       * @param [in] data The content of the file.
+       * @param [in] compress Whether to compress the file. Already
+       * compressed files only waste time being compressed again.
+       */
+      void add(
+         std::string path,
+         std::vector<std::byte> data,
+         bool compress = true
+      );
+
+      /**
+       * @brief Compress the blocks of every file, on the thread pool if
+       * there is one, and lay out the pack.
+       *
+       * @return The content of the pack file.
+       *
+       * @throw std::runtime_error if two files have the same path.
+       */
+      [[nodiscard]]
+      std::vector<std::byte> build(
+         thread_pool* p_thread_pool = nullptr
+      ) const;
+
+   private:
+      struct file
+      {
+         std::string path;
+         std::vector<std::byte> data;
+         bool compress = true;
+      }; // struct file
+
+      std::vector<file> files;
+   }; // class pack_writer
+
+   /**
+    * @brief A memory mapped pack file. Only the pages of the blocks that
+    * are read are loaded from disk. All the functions are thread safe.
+    */
+   class pack_file
+   {
+   public:
+      pack_file( ) = default;
+
+      /**
+       * @throw std::runtime_error if the file cannot be mapped or is
+       * not a valid pack file of the current version.
+       */
+      explicit pack_file( std::string const& filepath );
+
+      [[nodiscard]]
+      std::uint32_t get_entry_count(
+      ) const PURE;
+
+      [[nodiscard]]
+      std::string_view get_path(
+         std::uint32_t entry
+      ) const PURE;
+
+      /**
+       * @brief Get the decompressed size of an entry.
+       */
+      [[nodiscard]]
+      std::uint64_t get_size(
+         std::uint32_t entry
+      ) const PURE;
+
+      /**
+       * @brief Find an entry by path.
+       */
+      [[nodiscard]]
+      std::optional<std::uint32_t> find(
+         std::string_view path
+      ) const PURE;
+
+      /**
+       * @brief Decompress a whole entry.
+       *
+       * @throw std::runtime_error if a block of the entry is corrupted.
+       */
+      [[nodiscard]]
+      std::vector<std::byte> read(
+         std::uint32_t entry
+      ) const;
+
+      /**
+       * @brief Decompress a range of an entry, only decoding the blocks 
+       * that overlap it.
+       *
+       * @param [in] entry The entry to read from.
+       * @param [in] offset Where the range starts in the entry.
+       * @param [in] size The size of the range.
+       * @param [out] p_dst Where to write the range.
+       *
+       * @throw std::runtime_error if the range is out of the entry or a
+       * block is corrupted.
+       */
+      void read(
+         std::uint32_t entry,
+         std::uint64_t offset, std::size_t size,
+         std::byte* p_dst
+      ) const;
+
+      /**
+       * @brief Decompress many entries, with every block decoded as its
+       * own task on the thread pool. The calling thread takes part.
+       *
+       * @return The content of the entries, in the same order.
+       *
+       * @throw std::runtime_error if a block of the entries is corrupted.
+       */
+      [[nodiscard]]
+      std::vector<std::vector<std::byte>> read(
+         std::vector<std::uint32_t> const& entries,
+         thread_pool& pool
+      ) const;
+
+   private:
+      /**
+       * @brief Decode a whole block into p_dst.
+       *
+       * @return Whether the block was valid.
+       */
+      [[nodiscard]]
+      bool decode_block(
+         std::uint32_t block,
+         std::byte* p_dst
+      ) const noexcept;
+
+   private:
+      std::string filepath;
+      mapped_file file;
+
+      pack_header const* p_header = nullptr;
+      pack_entry const* p_entries = nullptr;
+      pack_block const* p_blocks = nullptr;
+      char const* p_paths = nullptr;
+   }; // class pack_file
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_PACK_FILE_HPP
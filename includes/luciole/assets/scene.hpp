@@ -0,0 +1,209 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_SCENE_HPP
+#define LUCIOLE_ASSETS_SCENE_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/utils/file_io.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * @brief An entity of a scene, with its transform relative to its
+    * parent and the mesh it draws.
+    */
+   struct scene_entity
+   {
+      std::string name;
+
+      /**
+       * @brief The index of the parent entity, -1 for a root.
+       */
+      std::int32_t parent = -1;
+
+      glm::vec3 translation = glm::vec3( 0.0f );
+      glm::quat rotation = glm::quat( 1.0f, 0.0f, 0.0f, 0.0f );
+      glm::vec3 scale = glm::vec3( 1.0f );
+
+      /**
+       * @brief The path of the cooked mesh file of the entity, empty if
+       * it draws nothing.
+       */
+      std::string mesh;
+      std::uint32_t mesh_index = 0;
+   }; // struct scene_entity
+
+   /**
+    * @brief A scene as it is authored, in JSON.
+    */
+   struct scene_description
+   {
+      std::vector<scene_entity> entities;
+   }; // struct scene_description
+
+   void to_json( nlohmann::json& j, scene_entity const& entity );
+   void from_json( nlohmann::json const& j, scene_entity& entity );
+
+   void to_json( nlohmann::json& j, scene_description const& scene );
+   void from_json( nlohmann::json const& j, scene_description& scene );
+
+   /**
+    * @brief Read a scene from a JSON file.
+    *
+    * @throw std::runtime_error if the file cannot be read or is not a
+    * valid scene.
+    */
+   [[nodiscard]]
+   scene_description read_scene_json(
+      std::string const& filepath
+   );
+
+   /**
+    * @brief Write a scene to a JSON file, indented for editing.
+    *
+    * @throw std::runtime_error if the file cannot be written.
+    */
+   void write_scene_json(
+      scene_description const& scene,
+      std::string const& filepath
+   );
+
+   /**
+    * Layout of a scene snapshot, all values little endian:
+    *
+    *    scene_snapshot_header
+    *    scene_snapshot_entity[entity_count]
+    *    strings
+    *
+    * Strings are referenced by offsets relative to the reference itself,
+    * so the file is used in place from memory with no fix-up at all.
+    * Loading only checks every reference once.
+    */
+   static constexpr std::uint32_t scene_snapshot_magic = 0x4e43534c; // "LSCN"
+   static constexpr std::uint32_t scene_snapshot_version = 1;
+
+   struct scene_snapshot_header
+   {
+      std::uint32_t magic = scene_snapshot_magic;
+      std::uint32_t version = scene_snapshot_version;
+      std::uint32_t entity_count = 0;
+      std::uint32_t reserved = 0;
+
+      std::uint64_t entity_table_offset = 0;
+      std::uint64_t string_table_offset = 0;
+      std::uint64_t string_table_size = 0;
+      std::uint64_t file_size = 0;
+   }; // struct scene_snapshot_header
+
+   /**
+    * @brief A string stored at an offset from this reference.
+    */
+   struct relative_string
+   {
+      std::int64_t offset = 0;
+      std::uint32_t size = 0;
+      std::uint32_t reserved = 0;
+
+      [[nodiscard]]
+      std::string_view get( ) const noexcept
+      {
+         return std::string_view( reinterpret_cast<char const*>( this ) + offset, size );
+      }
+   }; // struct relative_string
+
+   struct scene_snapshot_entity
+   {
+      float translation[3] = { 0.0f, 0.0f, 0.0f };
+      float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+      float scale[3] = { 1.0f, 1.0f, 1.0f };
+
+      std::int32_t parent = -1;
+      std::uint32_t mesh_index = 0;
+
+      relative_string name;
+      relative_string mesh;
+   }; // struct scene_snapshot_entity
+
+   static_assert( std::is_trivially_copyable_v<scene_snapshot_header> && sizeof( scene_snapshot_header ) == 48 );
+   static_assert( std::is_trivially_copyable_v<relative_string> && sizeof( relative_string ) == 16 );
+   static_assert( std::is_trivially_copyable_v<scene_snapshot_entity> && sizeof( scene_snapshot_entity ) == 80 );
+
+   /**
+    * @brief Turn a scene into a snapshot. Identical strings are stored
+    * once.
+    *
+    * @return The content of the file.
+    */
+   [[nodiscard]]
+   std::vector<std::byte> cook_scene(
+      scene_description const& scene
+   );
+
+   /**
+    * @brief A memory mapped scene snapshot, read in place.
+    */
+   class scene_snapshot
+   {
+   public:
+      scene_snapshot( ) = default;
+
+      /**
+       * @throw std::runtime_error if the file cannot be mapped or is
+       * not a valid scene snapshot of the current version.
+       */
+      explicit scene_snapshot( std::string const& filepath );
+
+      [[nodiscard]]
+      std::uint32_t get_entity_count(
+      ) const PURE;
+
+      [[nodiscard]]
+      scene_snapshot_entity const& get_entity(
+         std::uint32_t index
+      ) const PURE;
+
+      /**
+       * @brief Copy the snapshot into a scene that can be edited.
+       */
+      [[nodiscard]]
+      scene_description to_description(
+      ) const;
+
+   private:
+      std::string filepath;
+      mapped_file file;
+
+      scene_snapshot_header const* p_header = nullptr;
+      scene_snapshot_entity const* p_entities = nullptr;
+   }; // class scene_snapshot
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_SCENE_HPP
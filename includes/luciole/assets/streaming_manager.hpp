@@ -0,0 +1,301 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_STREAMING_MANAGER_HPP
+#define LUCIOLE_ASSETS_STREAMING_MANAGER_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/context.hpp>
+#include <luciole/assets/mesh.hpp>
+#include <luciole/assets/texture_loader.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/vk/images/texture.hpp>
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace assets
+{
+   using asset_id = std::uint32_t;
+
+   /**
+    * @brief Where an asset is between its file and the GPU.
+    */
+   enum class residency
+   {
+      e_unloaded,
+      e_loading,
+      e_decoded,
+      e_uploading,
+      e_resident,
+      e_failed
+   }; // enum class residency
+
+   /**
+    * @brief Keeps the assets that are requested every frame resident on
+    * the GPU, within a device memory budget. 
+    *
+    * Files are read and decoded on the thread pool, in priority order.
+    * Decoded assets are uploaded by update under a per frame bandwidth
+    * limit, and the least recently requested assets are evicted when
+    * an upload would go over the memory budget. Uploads are submitted 
+    * with a fence that the next calls to update poll, the assets become
+    * resident once the GPU is done with them.
+    *
+    * All the functions must be called from the thread owning the context.
+    * The manager cannot be moved, since its loads in flight point to it.
+    */
+   class streaming_manager
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+         thread_pool* p_thread_pool = nullptr;
+
+         /**
+          * @brief The device memory that all resources together may use,
+          * as reported by context::get_device_memory_usage. 0 picks 3/4
+          * of the largest device local heap.
+          */
+         VkDeviceSize memory_budget = 0;
+
+         /**
+          * @brief The bytes uploaded by a call to update. At least one
+          * asset is uploaded per call, however large.
+          */
+         VkDeviceSize upload_budget = 16 * 1024 * 1024;
+
+         std::uint32_t max_pending_loads = 8;
+
+         /**
+          * @brief How many calls to update an evicted asset is kept alive
+          * for, so the frames still in flight can finish using it.
+          */
+         std::uint32_t frames_in_flight = 2;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+      struct stats
+      {
+         std::uint32_t resident_count = 0;
+         std::uint32_t pending_count = 0;
+
+         VkDeviceSize resident_bytes = 0;
+         VkDeviceSize memory_budget = 0;
+
+         /**
+          * @brief The bytes uploaded by the last call to update.
+          */
+         VkDeviceSize uploaded_bytes = 0;
+
+         std::uint64_t eviction_count = 0;
+      }; // struct stats
+
+   public:
+      explicit streaming_manager( create_info_t const& create_info );
+      streaming_manager( streaming_manager const& rhs ) = delete;
+      streaming_manager( streaming_manager&& rhs ) = delete;
+      ~streaming_manager( );
+
+      streaming_manager& operator=( streaming_manager const& rhs ) = delete;
+      streaming_manager& operator=( streaming_manager&& rhs ) = delete;
+
+      /**
+       * @brief Register a texture, from any file the texture_loader can
+       * decode. Nothing is loaded until it is requested.
+       */
+      [[nodiscard]]
+      asset_id add_texture( 
+         std::string const& filepath, 
+         color_space space = color_space::e_srgb 
+      );
+
+      /**
+       * @brief Register every mesh of a cooked mesh file. Nothing is
+       * loaded until it is requested.
+       */
+      [[nodiscard]]
+      asset_id add_mesh( 
+         std::string const& filepath 
+      );
+
+      /**
+       * @brief Ask for an asset to be resident. Must be called every 
+       * frame the asset is needed, the highest priority of the frame 
+       * is kept.
+       *
+       * @param [in] screen_coverage The fraction of the screen covered
+       * by what uses the asset.
+       * @param [in] distance The distance from the camera to what uses
+       * the asset.
+       */
+      void request( 
+         asset_id id, 
+         float screen_coverage, 
+         float distance 
+      );
+
+      /**
+       * @brief Pick up the finished loads, upload them, evict assets to
+       * stay within the memory budget and start new loads. Call it once
+       * per frame.
+       */
+      void update( );
+
+      [[nodiscard]]
+      residency get_residency(
+         asset_id id
+      ) const PURE;
+
+      /**
+       * @return The texture, or nullptr if it is not resident.
+       */
+      [[nodiscard]]
+      vk::texture const* get_texture(
+         asset_id id
+      ) const PURE;
+
+      /**
+       * @return The meshes, or nullptr if they are not resident.
+       */
+      [[nodiscard]]
+      mesh_scene const* get_mesh(
+         asset_id id
+      ) const PURE;
+
+      [[nodiscard]]
+      stats get_stats(
+      ) const PURE;
+
+      /**
+       * @brief Turn the feedback of a request into a priority. The screen
+       * coverage dominates, the distance keeps the assets close to the
+       * camera but off screen ahead of the rest.
+       */
+      [[nodiscard]]
+      static float compute_priority( 
+         float screen_coverage, 
+         float distance 
+      ) noexcept;
+
+   private:
+      enum class asset_kind
+      {
+         e_texture,
+         e_mesh
+      }; // enum class asset_kind
+
+      struct asset
+      {
+         asset_kind kind = asset_kind::e_texture;
+         std::string filepath;
+         color_space space = color_space::e_srgb;
+
+         residency state = residency::e_unloaded;
+         float priority = 0.0f;
+         std::uint64_t last_requested_frame = 0;
+
+         /**
+          * @brief The device memory of the asset, estimated once decoded.
+          */
+         VkDeviceSize size = 0;
+
+         std::future<image_data> pending_image;
+         std::future<mesh_import> pending_mesh;
+         image_data image;
+         mesh_import import;
+
+         vk::texture texture;
+         mesh_scene mesh;
+
+         /**
+          * @brief The staging memory and submission of an upload in
+          * flight.
+          */
+         vk::staging_buffer upload_staging;
+         vk::pending_submission upload;
+
+         std::list<asset_id>::iterator lru_it;
+      }; // struct asset
+
+      struct retired_asset
+      {
+         std::uint64_t frame = 0;
+         VkDeviceSize size = 0;
+
+         vk::texture texture;
+         mesh_scene mesh;
+      }; // struct retired_asset
+
+   private:
+      void poll_loads( );
+      void poll_uploads( );
+      void upload_decoded( );
+      void start_loads( );
+
+      /**
+       * @brief Evict least recently requested assets until size bytes 
+       * fit in the budget. Assets requested this frame are never evicted.
+       *
+       * @return Whether enough memory could be made available.
+       */
+      bool make_room( VkDeviceSize size );
+      void evict( asset_id id );
+      void release_retired( );
+
+   private:
+      context const* p_context = nullptr;
+      thread_pool* p_thread_pool = nullptr;
+
+      texture_loader textures;
+
+      VkDeviceSize memory_budget = 0;
+      VkDeviceSize upload_budget = 0;
+      std::uint32_t max_pending_loads = 0;
+      std::uint32_t frames_in_flight = 0;
+
+      std::vector<asset> assets;
+
+      std::vector<asset_id> requested;
+      std::vector<asset_id> loading;
+      std::vector<asset_id> decoded;
+      std::vector<asset_id> uploading;
+
+      /**
+       * @brief The resident assets, from the least to the most recently
+       * requested.
+       */
+      std::list<asset_id> lru;
+      std::vector<retired_asset> retired;
+
+      std::uint64_t frame = 1;
+
+      VkDeviceSize resident_bytes = 0;
+      VkDeviceSize retired_bytes = 0;
+      VkDeviceSize uploaded_bytes = 0;
+      std::uint64_t eviction_count = 0;
+   }; // class streaming_manager
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_STREAMING_MANAGER_HPP
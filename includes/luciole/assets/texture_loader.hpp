@@ -0,0 +1,245 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_ASSETS_TEXTURE_LOADER_HPP
+#define LUCIOLE_ASSETS_TEXTURE_LOADER_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/context.hpp>
+#include <luciole/assets/derived_data_cache.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/vk/buffers/queue_ownership.hpp>
+#include <luciole/vk/buffers/staging_buffer.hpp>
+#include <luciole/vk/images/texture.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace assets
+{
+   /**
+    * @brief How the 8 bit channels of an image are meant to be read.
+    * HDR images are always linear.
+    */
+   enum class color_space
+   {
+      e_srgb,
+      e_linear
+   }; // enum class color_space
+
+   /**
+    * @brief Where a mip level is in the pixels of an image.
+    */
+   struct image_level
+   {
+      std::size_t offset = 0;
+      std::size_t size = 0;
+   }; // struct image_level
+
+   /**
+    * @brief A decoded image, with four channels per pixel: 8 bit for
+    * LDR images and half floats for HDR images, or block compressed
+    * mip levels loaded from a KTX2 file.
+    */
+   struct image_data
+   {
+      std::string filepath;
+
+      std::uint32_t width = 0;
+      std::uint32_t height = 0;
+      VkFormat format = VK_FORMAT_UNDEFINED;
+
+      std::vector<std::byte> pixels;
+
+      /**
+       * @brief The mip levels stored in pixels, from the largest. When
+       * empty, pixels only holds the base level and the rest of the mip
+       * chain is generated on upload.
+       */
+      std::vector<image_level> levels;
+   }; // struct image_data
+
+   /**
+    * @brief A texture whose upload was submitted but may not be done
+    * yet. The staging buffer and the submission must be kept until
+    * vk::is_submission_done, then the submission released.
+    */
+   struct pending_texture_upload
+   {
+      vk::texture texture;
+
+      vk::staging_buffer staging;
+      vk::pending_submission submission;
+   }; // struct pending_texture_upload
+
+   /**
+    * @brief Decodes PNG, JPEG, HDR and the other formats supported by
+    * stb_image on a thread pool, and uploads them through a persistent
+    * staging buffer into textures with a full mip chain generated on
+    * the GPU. 
+    *
+    * KTX2 files are uploaded with their mip levels as they are. If the 
+    * GPU cannot sample their block compressed format, they are 
+    * decompressed to 8 bit RGBA while decoding.
+    *
+    * With a derived data cache, the other formats are only decoded once:
+    * later decodes read the pixels back from the cache.
+    */
+   class texture_loader
+   {
+   public:
+      struct create_info
+      {
+         /**
+          * @brief May be null to only decode images, in which case KTX2
+          * files are never decompressed.
+          */
+         context const* p_context = nullptr;
+         thread_pool* p_thread_pool = nullptr;
+
+         /**
+          * @brief May be null to always decode from the source file.
+          */
+         derived_data_cache* p_cache = nullptr;
+
+         /**
+          * @brief The size of the persistent staging buffer. Images larger
+          * than it go through a temporary one.
+          */
+         VkDeviceSize staging_size = 64 * 1024 * 1024;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      texture_loader( ) = default;
+      texture_loader( create_info_t const& create_info );
+
+      /**
+       * @brief Decode an image on the thread pool.
+       *
+       * @return A future to the decoded image. Holds a std::runtime_error
+       * if the image could not be decoded.
+       */
+      [[nodiscard]]
+      std::future<image_data> decode_async(
+         std::string const& filepath,
+         color_space space = color_space::e_srgb
+      ) const;
+
+      /**
+       * @brief Decode an image on the calling thread.
+       *
+       * @throw std::runtime_error if the image could not be decoded, or
+       * is in a format the GPU does not support and that cannot be 
+       * decompressed.
+       */
+      [[nodiscard]]
+      image_data decode(
+         std::string const& filepath,
+         color_space space = color_space::e_srgb
+      ) const;
+
+      /**
+       * @brief Upload images into textures and generate their mip chains.
+       * Images are batched into as few submissions as the staging buffer
+       * allows. Must be called from the thread owning the context.
+       *
+       * @throw std::runtime_error if the upload failed.
+       */
+      [[nodiscard]]
+      std::vector<vk::texture> upload(
+         std::vector<image_data> const& images
+      );
+
+      /**
+       * @brief Upload a single image into a texture.
+       *
+       * @throw std::runtime_error if the upload failed.
+       */
+      [[nodiscard]]
+      vk::texture upload(
+         image_data const& image
+      );
+
+      /**
+       * @brief Submit the upload of an image into a texture without 
+       * waiting for it. The image goes through its own staging buffer.
+       * Must be called from the thread owning the context.
+       *
+       * @throw std::runtime_error if the upload could not be submitted.
+       */
+      [[nodiscard]]
+      pending_texture_upload upload_async(
+         image_data const& image
+      ) const;
+
+   private:
+      /**
+       * @brief Create the texture an image is uploaded to, with room for
+       * a full mip chain if the image has a single level and the format
+       * can be blitted.
+       */
+      [[nodiscard]]
+      vk::texture create_texture(
+         image_data const& image
+      ) const;
+
+      /**
+       * @brief Record the copy of an image staged at an offset of a
+       * buffer into its texture and the generation of its mip chain.
+       */
+      void record_upload(
+         VkCommandBuffer cmd_buffer,
+         VkBuffer staging_buffer, VkDeviceSize offset,
+         image_data const& image,
+         vk::texture const& texture
+      ) const;
+
+      /**
+       * @brief Decode an image with stb_image.
+       */
+      [[nodiscard]]
+      image_data decode_image(
+         std::string const& filepath,
+         color_space space
+      ) const;
+
+      /**
+       * @brief Read the mip levels of a KTX2 file, decompressing them if
+       * the GPU does not support their format.
+       */
+      [[nodiscard]]
+      image_data decode_ktx2(
+         std::string const& filepath
+      ) const;
+
+   private:
+      context const* p_context = nullptr;
+      thread_pool* p_thread_pool = nullptr;
+      derived_data_cache* p_cache = nullptr;
+
+      vk::staging_buffer staging;
+   }; // class texture_loader
+} // namespace assets
+
+#endif // LUCIOLE_ASSETS_TEXTURE_LOADER_HPP
@@ -26,16 +26,21 @@
 #include <luciole/vk/core.hpp>
 #include <luciole/vk/errors.hpp>
 #include <luciole/vk/extension.hpp>
+#include <luciole/vk/host_allocator.hpp>
 #include <luciole/vk/layer.hpp>
+#include <luciole/vk/memory_stats.hpp>
 #include <luciole/vk/queue.hpp>
 
 #include <spdlog/logger.h>
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
+#include <nlohmann/json.hpp>
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <optional>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 
@@ -350,6 +355,87 @@ public:
       vk::fence_t fence 
    ) const noexcept;
 
+   /**
+    * @brief Create a buffer and allocate its memory through the
+    * memory allocator.
+    *
+    * @param [in] create_info The information required to create
+    * the buffer.
+    * @param [in] allocation_info The information required to allocate
+    * the memory of the buffer.
+    * @param [in] category What the buffer is used for. Only used
+    * for memory statistics.
+    *
+    * @return Either the buffer and its allocation or an error code.
+    */
+   [[nodiscard]]
+   std::variant<vk::buffer_allocation, vk::error> create_buffer(
+      vk::buffer_create_info_t const& create_info,
+      vk::allocation_create_info_t const& allocation_info,
+      vk::memory_category category
+   ) const PURE;
+
+   /**
+    * @brief Destroy a buffer and free its memory.
+    *
+    * @param [in] buffer The buffer to destroy.
+    */
+   void destroy_buffer(
+      vk::buffer_allocation const& buffer
+   ) const noexcept;
+
+   /**
+    * @brief Create an image and allocate its memory through the
+    * memory allocator.
+    *
+    * @param [in] create_info The information required to create
+    * the image.
+    * @param [in] allocation_info The information required to allocate
+    * the memory of the image.
+    * @param [in] category What the image is used for. Only used
+    * for memory statistics.
+    *
+    * @return Either the image and its allocation or an error code.
+    */
+   [[nodiscard]]
+   std::variant<vk::image_allocation, vk::error> create_image(
+      vk::image_create_info_t const& create_info,
+      vk::allocation_create_info_t const& allocation_info,
+      vk::memory_category category
+   ) const PURE;
+
+   /**
+    * @brief Destroy an image and free its memory.
+    *
+    * @param [in] image The image to destroy.
+    */
+   void destroy_image(
+      vk::image_allocation const& image
+   ) const noexcept;
+
+   /**
+    * @brief Create a sampler.
+    *
+    * @param [in] create_info The information required to create
+    * the sampler.
+    *
+    * @return Either a handle to the newly created sampler or an
+    * error code.
+    */
+   [[nodiscard]]
+   std::variant<VkSampler, vk::error> create_sampler(
+      vk::sampler_create_info_t const& create_info
+   ) const noexcept PURE;
+
+   /**
+    * @brief Destroy a sampler.
+    *
+    * @param [in] sampler The handle to the sampler.
+    */
+   void destroy_sampler(
+      vk::sampler_t sampler
+   ) const noexcept;
+
    /**
     * @brief Create an array of command buffers.
     *
@@ -366,6 +452,17 @@ public:
       count32_t buffer_count 
    ) const PURE;
 
+   /**
+    * @brief Free command buffers allocated with create_command_buffers.
+    *
+    * @param flag The queue the command buffers were created for.
+    * @param buffers The command buffers to free.
+    */
+   void destroy_command_buffers(
+      queue::flag_t flag,
+      std::vector<VkCommandBuffer> const& buffers
+   ) const noexcept;
+
    /**
     * @brief Get the swapchain images from the swapchain.
     *
@@ -396,6 +493,18 @@ public:
    std::vector<std::uint32_t> get_unique_family_indices( 
    ) const PURE;
 
+   /**
+    * @brief Get the family index of a queue.
+    *
+    * @param flag The type of queue.
+    * @return The family index of the queue or VK_QUEUE_FAMILY_IGNORED
+    * if the context has no such queue.
+    */
+   [[nodiscard]]
+   std::uint32_t get_queue_family_index(
+      queue::flag_t flag
+   ) const noexcept PURE;
+
    /**
     * @brief Get all the formats supported by the surface.
     *
@@ -469,6 +578,16 @@ public:
       vk::fence_t fence 
    ) const noexcept;
 
+   /**
+    * @brief Check whether a fence is signaled, without waiting.
+    *
+    * @param fence The handle to the fence.
+    */
+   [[nodiscard]]
+   bool is_fence_signaled( 
+      vk::fence_t fence 
+   ) const noexcept PURE;
+
    /**
     * @brief Reset a fence.
     *
@@ -490,6 +609,109 @@ public:
    VmaAllocator get_memory_allocator( 
    ) const PURE;
 
+   /**
+    * @brief Get what the GPU supports for a format.
+    *
+    * @param [in] format The format to query.
+    */
+   [[nodiscard]]
+   VkFormatProperties get_format_properties(
+      VkFormat format
+   ) const noexcept PURE;
+
+   /**
+    * @brief Check if the GPU supports a set of features for a format
+    * in images with optimal tiling.
+    *
+    * @param [in] format The format to query.
+    * @param [in] features The features that must all be supported.
+    */
+   [[nodiscard]]
+   bool is_format_supported(
+      VkFormat format,
+      VkFormatFeatureFlags features
+   ) const noexcept PURE;
+
+   /**
+    * @brief Get the features of the GPU, all of which are enabled on
+    * the device.
+    */
+   [[nodiscard]]
+   VkPhysicalDeviceFeatures get_device_features(
+   ) const noexcept PURE;
+
+   /**
+    * @brief Check if a device extension, required or optional, was
+    * enabled on the device.
+    *
+    * @param [in] name The name of the extension.
+    */
+   [[nodiscard]]
+   bool is_device_extension_enabled(
+      std::string_view name
+   ) const noexcept PURE;
+
+   /**
+    * @brief Get a snapshot of the host memory allocated by the
+    * driver through the context's allocation callbacks.
+    *
+    * @return The live bytes, peak bytes and allocation rates by
+    * allocation scope and by object type.
+    */
+   [[nodiscard]]
+   vk::host_allocator::report get_host_memory_report(
+   ) const;
+
+   /**
+    * @brief Get statistics on the device memory, by memory heap
+    * and by category of resource.
+    */
+   [[nodiscard]]
+   vk::memory_stats get_memory_stats(
+   ) const;
+
+   /**
+    * @brief Get the bytes of device memory used by every resource but
+    * the staging buffers. Only reads the counters of the memory
+    * tracker, so it is cheap enough to be called every frame.
+    */
+   [[nodiscard]]
+   VkDeviceSize get_device_memory_usage(
+   ) const noexcept PURE;
+
+   /**
+    * @brief Get the size of the largest device local memory heap.
+    */
+   [[nodiscard]]
+   VkDeviceSize get_device_local_heap_size(
+   ) const PURE;
+
+   /**
+    * @brief Get the device memory statistics as json, along with
+    * the statistics built by the memory allocator under "vma".
+    *
+    * @param [in] detailed Whether the map of every allocation should
+    * be part of the allocator's statistics.
+    *
+    * @return The json object holding the statistics.
+    */
+   [[nodiscard]]
+   nlohmann::json get_memory_stats_json(
+      bool detailed
+   ) const;
+
+   /**
+    * @brief Write the device memory statistics as json in a file.
+    *
+    * @param [in] filepath The path of the file to write to.
+    * @param [in] detailed Whether the map of every allocation should
+    * be dumped too.
+    */
+   void dump_memory_stats(
+      std::string_view filepath,
+      bool detailed
+   ) const;
+
 private:
    /**
     * @brief Load all the validation layers.
@@ -655,6 +877,9 @@ private:
 
    VmaAllocator memory_allocator = VK_NULL_HANDLE;
 
+   std::unique_ptr<vk::host_allocator> p_host_allocator;
+   std::unique_ptr<vk::memory_tracker> p_memory_tracker;
+
    std::unordered_map<queue::flag, queue> queues;
    std::unordered_map<std::uint32_t, command_pool> command_pools;
 
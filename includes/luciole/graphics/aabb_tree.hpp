@@ -0,0 +1,506 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_AABB_TREE_HPP
+#define LUCIOLE_GRAPHICS_AABB_TREE_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/graphics/frustum_culling.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief An axis aligned bounding box.
+    */
+   struct aabb
+   {
+      glm::vec3 min = glm::vec3( 0.0f );
+      glm::vec3 max = glm::vec3( 0.0f );
+
+      [[nodiscard]]
+      bool contains( aabb const& rhs ) const noexcept
+      {
+         return glm::all( glm::lessThanEqual( min, rhs.min ) ) && glm::all( glm::lessThanEqual( rhs.max, max ) );
+      }
+
+      [[nodiscard]]
+      bool overlaps( aabb const& rhs ) const noexcept
+      {
+         return glm::all( glm::lessThanEqual( min, rhs.max ) ) && glm::all( glm::lessThanEqual( rhs.min, max ) );
+      }
+
+      [[nodiscard]]
+      float get_surface_area( ) const noexcept
+      {
+         glm::vec3 const size = max - min;
+         return 2.0f * ( size.x * size.y + size.y * size.z + size.z * size.x );
+      }
+   }; // struct aabb
+
+   [[nodiscard]]
+   inline aabb merge( aabb const& lhs, aabb const& rhs ) noexcept
+   {
+      return aabb{ glm::min( lhs.min, rhs.min ), glm::max( lhs.max, rhs.max ) };
+   }
+
+   /**
+    * @brief A bounding volume hierarchy of boxes, updated as objects are
+    * added, moved and removed.
+    *
+    * Leaves store a fat box, the object's box grown by a margin, so that 
+    * objects moving a little do not change the tree. A new leaf goes down 
+    * the branch that least increases the surface area of the tree, and 
+    * the nodes on its way back up are rotated when swapping a child with
+    * a grandchild shrinks them.
+    *
+    * Queries only read the tree and can run on many threads at once, as
+    * long as no thread changes it at the same time.
+    */
+   class aabb_tree
+   {
+   public:
+      static constexpr std::uint32_t null_proxy = std::numeric_limits<std::uint32_t>::max( );
+
+      struct create_info
+      {
+         /**
+          * @brief How much the leaves are grown on each side.
+          */
+         float margin = 0.1f;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      aabb_tree( ) = default;
+      explicit aabb_tree( create_info_t const& create_info );
+
+      /**
+       * @brief Add an object to the tree.
+       *
+       * @param [in] box The bounds of the object.
+       * @param [in] user_data The value handed to the query callbacks 
+       * for the object.
+       *
+       * @return The proxy of the object in the tree.
+       */
+      std::uint32_t insert( aabb const& box, std::uint32_t user_data );
+
+      void remove( std::uint32_t proxy );
+
+      /**
+       * @brief Move an object. The tree only changes when the new box 
+       * leaves the fat box of the object.
+       *
+       * @return Whether the object was inserted again.
+       */
+      bool move( std::uint32_t proxy, aabb const& box );
+
+      /**
+       * @brief Move an object without changing the shape of the tree. The
+       * boxes above it are wrong until the next call to refit.
+       *
+       * Cheaper than move when most objects move a little each frame, but
+       * the tree gets worse as the objects drift from where they were 
+       * inserted.
+       */
+      void set_box( std::uint32_t proxy, aabb const& box );
+
+      /**
+       * @brief Recompute the boxes of every node from their children, 
+       * after calls to set_box.
+       */
+      void refit( );
+
+      void clear( ) noexcept;
+
+      /**
+       * @brief Call f with the user data of every object whose fat box 
+       * overlaps a box.
+       */
+      template<typename F>
+      void query_box( aabb const& box, F&& f ) const
+      {
+         node_stack stack;
+         stack.push( root );
+
+         while( !stack.is_empty( ) )
+         {
+            std::uint32_t const index = stack.pop( );
+            if ( index == null_proxy || !nodes[index].box.overlaps( box ) )
+            {
+               continue;
+            }
+
+            if ( nodes[index].is_leaf( ) )
+            {
+               f( nodes[index].user_data );
+            }
+            else
+            {
+               stack.push( nodes[index].child_1 );
+               stack.push( nodes[index].child_2 );
+            }
+         }
+      }
+
+      /**
+       * @brief Call f with the user data of every object whose fat box 
+       * overlaps a sphere.
+       */
+      template<typename F>
+      void query_sphere( glm::vec3 const& center, float radius, F&& f ) const
+      {
+         float const radius_squared = radius * radius;
+
+         node_stack stack;
+         stack.push( root );
+
+         while( !stack.is_empty( ) )
+         {
+            std::uint32_t const index = stack.pop( );
+            if ( index == null_proxy )
+            {
+               continue;
+            }
+
+            auto const& n = nodes[index];
+
+            glm::vec3 const closest = glm::clamp( center, n.box.min, n.box.max );
+            glm::vec3 const offset = closest - center;
+            if ( glm::dot( offset, offset ) > radius_squared )
+            {
+               continue;
+            }
+
+            if ( n.is_leaf( ) )
+            {
+               f( n.user_data );
+            }
+            else
+            {
+               stack.push( n.child_1 );
+               stack.push( n.child_2 );
+            }
+         }
+      }
+
+      /**
+       * @brief Call f with the user data of every object whose fat box is
+       * inside or across a frustum. The planes are not tested again below
+       * a node fully inside the frustum.
+       */
+      template<typename F>
+      void query_frustum( frustum const& fr, F&& f ) const
+      {
+         node_stack stack;
+         stack.push( root );
+
+         while( !stack.is_empty( ) )
+         {
+            std::uint32_t const index = stack.pop( );
+            if ( index == null_proxy )
+            {
+               continue;
+            }
+
+            auto const& n = nodes[index];
+
+            glm::vec3 const center = ( n.box.min + n.box.max ) * 0.5f;
+            glm::vec3 const extent = ( n.box.max - n.box.min ) * 0.5f;
+
+            bool is_outside = false;
+            bool is_inside = true;
+            for( auto const& plane : fr.planes )
+            {
+               float const distance = glm::dot( glm::vec3( plane ), center ) + plane.w;
+               float const reach = glm::dot( glm::abs( glm::vec3( plane ) ), extent );
+
+               if ( distance + reach < 0.0f )
+               {
+                  is_outside = true;
+                  break;
+               }
+
+               is_inside = is_inside && distance - reach >= 0.0f;
+            }
+
+            if ( is_outside )
+            {
+               continue;
+            }
+
+            if ( is_inside || n.is_leaf( ) )
+            {
+               for_each_leaf( index, f );
+            }
+            else
+            {
+               stack.push( n.child_1 );
+               stack.push( n.child_2 );
+            }
+         }
+      }
+
+      /**
+       * @brief Walk the objects whose fat box a ray crosses, nearest 
+       * nodes first.
+       *
+       * @param [in] origin Where the ray starts.
+       * @param [in] direction The direction of the ray, need not be 
+       * normalized. Distances are in multiples of it.
+       * @param [in] max_distance How far along the ray to look.
+       * @param [in] f A callable taking the user data of an object and the
+       * current max distance. It returns the new max distance: the 
+       * distance of its hit to only look for nearer ones, the current one
+       * to go on, or 0 to stop.
+       */
+      template<typename F>
+      void raycast( glm::vec3 const& origin, glm::vec3 const& direction, float max_distance, F&& f ) const
+      {
+         glm::vec3 const inverse_direction = 1.0f / direction;
+
+         node_stack stack;
+         stack.push( root );
+
+         while( !stack.is_empty( ) && max_distance > 0.0f )
+         {
+            std::uint32_t const index = stack.pop( );
+            if ( index == null_proxy )
+            {
+               continue;
+            }
+
+            auto const& n = nodes[index];
+            if ( get_ray_distance( n.box, origin, inverse_direction ) > max_distance )
+            {
+               continue;
+            }
+
+            if ( n.is_leaf( ) )
+            {
+               max_distance = f( n.user_data, max_distance );
+            }
+            else
+            {
+               /* The nearer child is popped first, to shrink max_distance early. */
+               float const distance_1 = get_ray_distance( nodes[n.child_1].box, origin, inverse_direction );
+               float const distance_2 = get_ray_distance( nodes[n.child_2].box, origin, inverse_direction );
+
+               if ( distance_1 < distance_2 )
+               {
+                  stack.push( n.child_2 );
+                  stack.push( n.child_1 );
+               }
+               else
+               {
+                  stack.push( n.child_1 );
+                  stack.push( n.child_2 );
+               }
+            }
+         }
+      }
+
+      [[nodiscard]]
+      aabb const& get_fat_box(
+         std::uint32_t proxy
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_user_data(
+         std::uint32_t proxy
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_proxy_count(
+      ) const noexcept PURE;
+
+      /**
+       * @return The number of nodes on the longest path from the root to
+       * a leaf, 0 for an empty tree.
+       */
+      [[nodiscard]]
+      std::uint32_t get_height(
+      ) const noexcept PURE;
+
+      /**
+       * @return The summed surface area of the internal nodes over the
+       * area of the root. Lower is better.
+       */
+      [[nodiscard]]
+      float get_area_ratio(
+      ) const noexcept PURE;
+
+   private:
+      struct node
+      {
+         aabb box;
+
+         /* The next free node, when the node is free. */
+         std::uint32_t parent = null_proxy;
+         std::uint32_t child_1 = null_proxy;
+         std::uint32_t child_2 = null_proxy;
+
+         std::uint32_t user_data = 0;
+
+         /* 0 for leaves, -1 for free nodes. */
+         std::int32_t height = 0;
+
+         [[nodiscard]]
+         bool is_leaf( ) const noexcept
+         {
+            return child_1 == null_proxy;
+         }
+      }; // struct node
+
+      /**
+       * @brief A stack of nodes to visit, on the stack of the thread unless
+       * the tree is very deep.
+       */
+      class node_stack
+      {
+      public:
+         void push( std::uint32_t index )
+         {
+            if ( size < fixed.size( ) )
+            {
+               fixed[size] = index;
+            }
+            else
+            {
+               overflow.push_back( index );
+            }
+
+            ++size;
+         }
+
+         std::uint32_t pop( ) noexcept
+         {
+            --size;
+            if ( size < fixed.size( ) )
+            {
+               return fixed[size];
+            }
+
+            std::uint32_t const index = overflow.back( );
+            overflow.pop_back( );
+
+            return index;
+         }
+
+         [[nodiscard]]
+         bool is_empty( ) const noexcept
+         {
+            return size == 0;
+         }
+
+      private:
+         std::array<std::uint32_t, 64> fixed;
+         std::vector<std::uint32_t> overflow;
+         std::size_t size = 0;
+      }; // class node_stack
+
+   private:
+      /**
+       * @return How far along the ray it enters a box, or infinity when it
+       * misses it.
+       */
+      [[nodiscard]]
+      static float get_ray_distance( 
+         aabb const& box, 
+         glm::vec3 const& origin, 
+         glm::vec3 const& inverse_direction 
+      ) noexcept
+      {
+         glm::vec3 const t_1 = ( box.min - origin ) * inverse_direction;
+         glm::vec3 const t_2 = ( box.max - origin ) * inverse_direction;
+
+         glm::vec3 const t_near = glm::min( t_1, t_2 );
+         glm::vec3 const t_far = glm::max( t_1, t_2 );
+
+         float const enter = std::max( std::max( t_near.x, t_near.y ), std::max( t_near.z, 0.0f ) );
+         float const exit = std::min( std::min( t_far.x, t_far.y ), t_far.z );
+
+         return enter <= exit ? enter : std::numeric_limits<float>::infinity( );
+      }
+
+      template<typename F>
+      void for_each_leaf( std::uint32_t index, F& f ) const
+      {
+         node_stack stack;
+         stack.push( index );
+
+         while( !stack.is_empty( ) )
+         {
+            auto const& n = nodes[stack.pop( )];
+            if ( n.is_leaf( ) )
+            {
+               f( n.user_data );
+            }
+            else
+            {
+               stack.push( n.child_1 );
+               stack.push( n.child_2 );
+            }
+         }
+      }
+
+      std::uint32_t allocate_node( );
+      void free_node( std::uint32_t index ) noexcept;
+
+      void insert_leaf( std::uint32_t leaf );
+      void remove_leaf( std::uint32_t leaf );
+
+      /**
+       * @brief Swap a child of a node with a grandchild when it lowers the
+       * surface area of the child left with the other grandchild.
+       */
+      void rotate( std::uint32_t index ) noexcept;
+
+      /**
+       * @brief Recompute the box and height of a node and the nodes above
+       * it, rotating them on the way if asked.
+       */
+      void refit_ancestors( std::uint32_t index, bool is_rotating ) noexcept;
+
+      [[nodiscard]]
+      aabb get_fat( 
+         aabb const& box 
+      ) const noexcept PURE;
+
+   private:
+      float margin = 0.1f;
+
+      std::vector<node> nodes;
+      std::uint32_t root = null_proxy;
+      std::uint32_t free_list = null_proxy;
+      std::uint32_t proxy_count = 0;
+   }; // class aabb_tree
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_AABB_TREE_HPP
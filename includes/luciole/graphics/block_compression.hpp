@@ -0,0 +1,137 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_BLOCK_COMPRESSION_HPP
+#define LUCIOLE_GRAPHICS_BLOCK_COMPRESSION_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief The block compressed formats that can be encoded and
+    * decoded on the CPU. Each of them stores 4x4 pixel blocks.
+    *
+    * BC1: RGB with 1 bit alpha, 8 bytes a block.
+    * BC3: RGBA, 16 bytes a block.
+    * BC4: R, 8 bytes a block.
+    * BC5: RG, 16 bytes a block.
+    * BC7: RGBA at a higher quality than BC3, 16 bytes a block.
+    */
+   enum class block_format
+   {
+      e_bc1,
+      e_bc3,
+      e_bc4,
+      e_bc5,
+      e_bc7
+   }; // enum class block_format
+
+   /**
+    * @brief Get the number of bytes of a 4x4 block.
+    */
+   [[nodiscard]]
+   constexpr std::size_t get_block_size( block_format format ) noexcept
+   {
+      return ( format == block_format::e_bc1 || format == block_format::e_bc4 ) ? 8 : 16;
+   }
+
+   /**
+    * @brief Get the number of bytes of an image once compressed.
+    */
+   [[nodiscard]]
+   constexpr std::size_t get_compressed_size( block_format format, std::uint32_t width, std::uint32_t height ) noexcept
+   {
+      return std::size_t( ( width + 3 ) / 4 ) * std::size_t( ( height + 3 ) / 4 ) * get_block_size( format );
+   }
+
+   /**
+    * @brief Get the vulkan format of a block format. BC4 and BC5 have
+    * no sRGB variant, srgb is ignored for them.
+    */
+   [[nodiscard]]
+   VkFormat to_vk_format( 
+      block_format format, 
+      bool srgb 
+   ) noexcept PURE;
+
+   /**
+    * @brief Get the block format of a vulkan format, if it is one that
+    * can be decoded on the CPU.
+    */
+   [[nodiscard]]
+   std::optional<block_format> to_block_format( 
+      VkFormat format 
+   ) noexcept PURE;
+
+   /**
+    * @brief Compress a 4x4 block.
+    *
+    * @param [in] p_rgba The 16 pixels of the block in rows, 4 bytes each.
+    * @param [out] p_dst Where to write the get_block_size( format ) bytes
+    * of the block.
+    */
+   void compress_block( block_format format, std::uint8_t const* p_rgba, std::byte* p_dst ) noexcept;
+
+   /**
+    * @brief Decompress a 4x4 block into 16 RGBA pixels. Missing channels
+    * are set the way the GPU would sample them.
+    *
+    * @throw std::runtime_error for BC7 blocks in the partitioned modes 
+    * 0 to 3 and 7, which are not decoded on the CPU.
+    */
+   void decompress_block( block_format format, std::byte const* p_src, std::uint8_t* p_rgba );
+
+   /**
+    * @brief Compress an RGBA image. Blocks on the right and bottom edges
+    * are padded by repeating the last pixels.
+    *
+    * @param [in] p_thread_pool If not null, the rows of blocks are
+    * compressed in parallel on it.
+    */
+   [[nodiscard]]
+   std::vector<std::byte> compress_image(
+      block_format format,
+      std::uint8_t const* p_rgba,
+      std::uint32_t width, std::uint32_t height,
+      thread_pool* p_thread_pool = nullptr
+   );
+
+   /**
+    * @brief Decompress an image into RGBA pixels.
+    *
+    * @throw std::runtime_error if a block cannot be decoded.
+    */
+   [[nodiscard]]
+   std::vector<std::byte> decompress_image(
+      block_format format,
+      std::byte const* p_blocks,
+      std::uint32_t width, std::uint32_t height
+   );
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_BLOCK_COMPRESSION_HPP
@@ -0,0 +1,141 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_DEPTH_PYRAMID_HPP
+#define LUCIOLE_GRAPHICS_DEPTH_PYRAMID_HPP
+
+/* INCLUDES */
+#include <luciole/context.hpp>
+#include <luciole/luciole_core.hpp>
+#include <luciole/utils/strong_types.hpp>
+#include <luciole/vk/images/texture.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief A hierarchical depth buffer, where each texel of a level
+    * keeps the farthest depth of the texels it covers in the level 
+    * above. The levels are reduced from a depth buffer by a compute 
+    * shader.
+    *
+    * The first level is the largest power of two that fits in the depth
+    * buffer, so that every level halves the one above it. A bound 
+    * covering at most 2x2 texels of a level can then be tested against 
+    * everything drawn behind it with 4 reads.
+    */
+   class depth_pyramid
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+
+         /**
+          * @brief The SPIR-V of data/shaders/depth_pyramid.comp.
+          */
+         std::vector<std::uint32_t> spir_v;
+
+         /**
+          * @brief A view of the depth aspect of the depth buffer, which
+          * must be sampled in the DEPTH_STENCIL_READ_ONLY_OPTIMAL 
+          * layout.
+          */
+         VkImageView depth_view = VK_NULL_HANDLE;
+         VkExtent2D depth_extent = { 0, 0 };
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      depth_pyramid( ) = default;
+      explicit depth_pyramid( create_info_t const& create_info );
+      depth_pyramid( depth_pyramid const& rhs ) = delete;
+      depth_pyramid( depth_pyramid&& rhs );
+      ~depth_pyramid( );
+
+      depth_pyramid& operator=( depth_pyramid const& rhs ) = delete;
+      depth_pyramid& operator=( depth_pyramid&& rhs );
+
+      /**
+       * @brief Record the reduction of the depth buffer, outside of a 
+       * render pass and after the depth writes. The pyramid is ready for
+       * compute shaders to read in the GENERAL layout after it.
+       */
+      void record_build( 
+         VkCommandBuffer cmd_buffer 
+      ) const noexcept;
+
+      /**
+       * @brief A view over every level of the pyramid.
+       */
+      [[nodiscard]]
+      VkImageView get_image_view(
+      ) const noexcept PURE;
+
+      /**
+       * @brief A nearest sampler clamped to the edges, to fetch texels 
+       * from the pyramid.
+       */
+      [[nodiscard]]
+      VkSampler get_sampler(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      VkExtent2D get_extent(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_level_count(
+      ) const noexcept PURE;
+
+   private:
+      void create_pipeline( 
+         std::vector<std::uint32_t> const& spir_v 
+      );
+
+      void create_descriptor_sets( 
+         VkImageView depth_view 
+      );
+
+      void destroy( ) noexcept;
+
+   private:
+      context const* p_context = nullptr;
+
+      vk::texture pyramid;
+      std::vector<VkImageView> level_views;
+      VkSampler sampler = VK_NULL_HANDLE;
+
+      VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+      VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+      std::vector<VkDescriptorSet> descriptor_sets;
+      VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+      VkPipeline pipeline = VK_NULL_HANDLE;
+
+      VkExtent2D depth_extent = { 0, 0 };
+      VkExtent2D extent = { 0, 0 };
+      std::uint32_t level_count = 0;
+   }; // class depth_pyramid
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_DEPTH_PYRAMID_HPP
@@ -0,0 +1,221 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_DRAW_LIST_HPP
+#define LUCIOLE_GRAPHICS_DRAW_LIST_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief The draws of a frame, sorted by a 64 bit key and merged into
+    * instanced draws.
+    *
+    * From the high bits down, a key holds the pass, the pipeline, the
+    * material, the mesh and the quantized depth, so sorting groups the 
+    * draws by state and every run of the same mesh and material becomes
+    * a single draw. In a back to front pass the depth moves right under
+    * the pass, blended draws are then only merged when they are at the 
+    * same depth.
+    *
+    * The keys are sorted with an LSD radix sort spread across the thread 
+    * pool. The transforms of the instances are laid out in draw order, 
+    * the first instance of a batch indexes them. gfx::instance_buffer 
+    * uploads them for data/shaders/instanced_shader.vert.
+    */
+   class draw_list
+   {
+   public:
+      static constexpr std::uint32_t max_pass_count = 1u << 4;
+      static constexpr std::uint32_t max_pipeline_count = 1u << 12;
+      static constexpr std::uint32_t max_material_count = 1u << 16;
+      static constexpr std::uint32_t max_mesh_count = 1u << 16;
+
+      enum class depth_order
+      {
+         e_front_to_back,
+         e_back_to_front
+      }; // enum class depth_order
+
+      struct create_info
+      {
+         /**
+          * @brief When null, the draws are sorted on the calling thread.
+          */
+         thread_pool* p_thread_pool = nullptr;
+
+         std::uint32_t items_per_job = 16384;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+      struct draw_item
+      {
+         std::uint32_t pass = 0;
+         std::uint32_t pipeline = 0;
+         std::uint32_t material = 0;
+         std::uint32_t mesh = 0;
+
+         /**
+          * @brief The view depth mapped to [0, 1].
+          */
+         float depth = 0.0f;
+
+         glm::mat4 transform = glm::mat4( 1.0f );
+      }; // struct draw_item
+
+      /**
+       * @brief An instanced draw, along with the state to bind before it.
+       * The state is flagged when it differs from the previous batch, 
+       * and always at the start of a pass.
+       */
+      struct draw_batch
+      {
+         std::uint32_t pass = 0;
+         std::uint32_t pipeline = 0;
+         std::uint32_t material = 0;
+         std::uint32_t mesh = 0;
+
+         std::uint32_t first_instance = 0;
+         std::uint32_t instance_count = 0;
+
+         bool is_pass_changed = false;
+         bool is_pipeline_changed = false;
+         bool is_material_changed = false;
+         bool is_mesh_changed = false;
+      }; // struct draw_batch
+
+      /**
+       * @brief The counters of the last build.
+       */
+      struct stats
+      {
+         std::uint32_t item_count = 0;
+         std::uint32_t draw_count = 0;
+         std::uint32_t pass_count = 0;
+         std::uint32_t pipeline_bind_count = 0;
+         std::uint32_t material_bind_count = 0;
+         std::uint32_t mesh_bind_count = 0;
+
+         /**
+          * @brief The radix passes skipped because every key had the 
+          * same digit.
+          */
+         std::uint32_t skipped_sort_pass_count = 0;
+      }; // struct stats
+
+   public:
+      draw_list( ) = default;
+      explicit draw_list( create_info_t const& create_info );
+
+      /**
+       * @brief Set how the draws of a pass are ordered by depth, before 
+       * any of them is added.
+       */
+      void set_depth_order( std::uint32_t pass, depth_order order );
+
+      /**
+       * @brief Queue a draw for the next build.
+       */
+      void add( draw_item const& item );
+
+      /**
+       * @brief Sort the queued draws and merge them into batches.
+       */
+      void build( );
+
+      /**
+       * @brief Remove the queued draws, keeping the memory for the next 
+       * frame. The batches of the last build stay until the next one.
+       */
+      void clear( ) noexcept;
+
+      [[nodiscard]]
+      std::vector<draw_batch> const& get_batches(
+      ) const noexcept PURE;
+
+      /**
+       * @return The transforms of the instances, in the order the 
+       * batches index them.
+       */
+      [[nodiscard]]
+      std::vector<glm::mat4> const& get_instance_data(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      stats const& get_stats(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_item_count(
+      ) const noexcept PURE;
+
+      /**
+       * @brief Build the sort key of a draw.
+       */
+      [[nodiscard]]
+      static std::uint64_t make_sort_key( 
+         draw_item const& item, 
+         depth_order order 
+      ) noexcept PURE;
+
+   private:
+      struct sort_entry
+      {
+         std::uint64_t key;
+         std::uint32_t index;
+      }; // struct sort_entry
+
+      void sort( );
+
+      /**
+       * @brief Run a job on each range of items_per_job entries, on the
+       * thread pool when there is more than one.
+       */
+      template<typename F>
+      void for_each_job( std::uint32_t job_count, F const& f );
+
+   private:
+      thread_pool* p_thread_pool = nullptr;
+      std::uint32_t items_per_job = 16384;
+
+      std::array<depth_order, max_pass_count> depth_orders = { };
+
+      std::vector<glm::mat4> transforms;
+      std::vector<sort_entry> entries;
+      std::vector<sort_entry> scratch;
+      std::vector<std::uint32_t> histograms;
+
+      std::vector<draw_batch> batches;
+      std::vector<glm::mat4> instance_data;
+
+      stats last_stats;
+   }; // class draw_list
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_DRAW_LIST_HPP
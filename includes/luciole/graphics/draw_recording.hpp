@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_DRAW_RECORDING_HPP
+#define LUCIOLE_GRAPHICS_DRAW_RECORDING_HPP
+
+/* INCLUDES */
+#include <luciole/graphics/draw_list.hpp>
+#include <luciole/graphics/gpu_culling.hpp>
+#include <luciole/luciole_core.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief The buffers and index range a draw_item::mesh stands for.
+    */
+   struct draw_mesh
+   {
+      VkBuffer vertex_buffer = VK_NULL_HANDLE;
+      VkBuffer index_buffer = VK_NULL_HANDLE;
+      VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+
+      gpu_culling::draw_range range;
+   }; // struct draw_mesh
+
+   /**
+    * @brief The Vulkan objects the indices of a draw list stand for. 
+    * Every pipeline shares the same layout, set 0 holds the instance 
+    * transforms and is bound by the caller, set 1 the material.
+    */
+   struct draw_bindings
+   {
+      VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+
+      /**
+       * @brief Indexed by draw_item::pipeline.
+       */
+      std::vector<VkPipeline> pipelines;
+
+      /**
+       * @brief Indexed by draw_item::material. Left empty when the
+       * pipelines take no material.
+       */
+      std::vector<VkDescriptorSet> materials;
+
+      /**
+       * @brief Indexed by draw_item::mesh.
+       */
+      std::vector<draw_mesh> meshes;
+   }; // struct draw_bindings
+
+   /**
+    * @brief Record the batches of a pass from the last build of a draw 
+    * list, binding only the state each batch flags as changed. A batch
+    * draws its instances from its first instance, which is where 
+    * gfx::instance_buffer wrote their transforms.
+    *
+    * @return The number of draws recorded.
+    */
+   std::uint32_t record_draw_list(
+      VkCommandBuffer cmd_buffer,
+      draw_list const& list,
+      std::uint32_t pass,
+      draw_bindings const& bindings
+   );
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_DRAW_RECORDING_HPP
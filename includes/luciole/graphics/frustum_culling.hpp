@@ -0,0 +1,136 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_FRUSTUM_CULLING_HPP
+#define LUCIOLE_GRAPHICS_FRUSTUM_CULLING_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief The planes bounding what a camera sees, normals pointing 
+    * inwards: left, right, bottom, top, near and far.
+    */
+   struct frustum
+   {
+      std::array<glm::vec4, 6> planes = { };
+   }; // struct frustum
+
+   /**
+    * @brief Extract the normalized planes of a view projection matrix. 
+    * The near plane is taken for a depth range of [-1, 1], which is a 
+    * little behind the real one for a [0, 1] projection.
+    */
+   [[nodiscard]]
+   frustum make_frustum( 
+      glm::mat4 const& view_projection 
+   ) noexcept PURE;
+
+   /**
+    * @brief The world bounds of the objects to test against the camera.
+    *
+    * Each object has an axis aligned box and a sphere around the center 
+    * of the box, kept in separate arrays. An object is culled when either
+    * of them is fully outside a plane of the frustum. The objects are 
+    * tested several at a time with AVX2 or SSE2 when the build enables 
+    * them, in jobs spread across the thread pool.
+    */
+   class culling_set
+   {
+   public:
+      struct create_info
+      {
+         /**
+          * @brief When null, the objects are tested on the calling thread.
+          */
+         thread_pool* p_thread_pool = nullptr;
+
+         std::uint32_t objects_per_job = 16384;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      culling_set( ) = default;
+      explicit culling_set( create_info_t const& create_info );
+
+      /**
+       * @brief Add an object bounded by a box. Its sphere goes through
+       * the corners of the box until set_radius gives a tighter one.
+       *
+       * @return The index of the object.
+       */
+      std::uint32_t add( glm::vec3 const& min, glm::vec3 const& max );
+
+      void set( std::uint32_t index, glm::vec3 const& min, glm::vec3 const& max );
+
+      /**
+       * @brief Set the bounds of an object to a local box moved by a 
+       * transform.
+       */
+      void set( std::uint32_t index, glm::mat4 const& transform, glm::vec3 const& min, glm::vec3 const& max );
+
+      /**
+       * @brief Set the radius of the sphere of an object, centered on its 
+       * box.
+       */
+      void set_radius( std::uint32_t index, float radius );
+
+      void clear( ) noexcept;
+
+      /**
+       * @brief Find the objects inside or across a frustum. Can be called
+       * from many threads at once.
+       *
+       * @param [in] f The frustum to test against.
+       * @param [out] visible The indices of the visible objects, in 
+       * increasing order.
+       */
+      void cull( frustum const& f, std::vector<std::uint32_t>& visible ) const;
+
+      [[nodiscard]]
+      std::uint32_t get_object_count(
+      ) const noexcept PURE;
+
+   private:
+      thread_pool* p_thread_pool = nullptr;
+      std::uint32_t objects_per_job = 16384;
+
+      std::vector<float> center_x;
+      std::vector<float> center_y;
+      std::vector<float> center_z;
+
+      std::vector<float> extent_x;
+      std::vector<float> extent_y;
+      std::vector<float> extent_z;
+
+      std::vector<float> radius;
+   }; // class culling_set
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_FRUSTUM_CULLING_HPP
@@ -0,0 +1,338 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_GPU_CULLING_HPP
+#define LUCIOLE_GRAPHICS_GPU_CULLING_HPP
+
+/* INCLUDES */
+#include <luciole/context.hpp>
+#include <luciole/graphics/depth_pyramid.hpp>
+#include <luciole/graphics/frustum_culling.hpp>
+#include <luciole/luciole_core.hpp>
+#include <luciole/utils/strong_types.hpp>
+#include <luciole/vk/memory_stats.hpp>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief Frustum culling of instances in a compute shader, which
+    * writes the indirect draw commands of the visible ones.
+    *
+    * The bounding spheres and the frustum sit in host visible buffers,
+    * so a frame only writes what changed and the command buffers are
+    * recorded once. With VK_KHR_draw_indirect_count, the visible 
+    * commands are packed and their count is read by the GPU. Without 
+    * it, every instance keeps its command and the culled ones draw 0 
+    * instances.
+    *
+    * The instance index is passed as the first instance of its draw, 
+    * for the vertex shader to read per instance data through 
+    * gl_InstanceIndex. A device without drawIndirectFirstInstance 
+    * cannot do that, and the constructor throws for the caller to cull
+    * on the CPU.
+    *
+    * With occlusion culling, a frame culls in two phases. The early 
+    * phase draws the instances that were visible at the end of the last 
+    * frame. A depth pyramid is built from what they wrote, and the late 
+    * phase tests every instance against it, drawing the visible ones the
+    * early phase missed and remembering which are visible for the next 
+    * frame. Testing against the depth of the current frame keeps a fast
+    * camera from culling what has just come into view.
+    */
+   class gpu_culling
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+
+         /**
+          * @brief The SPIR-V of data/shaders/cull_instances.comp, or of 
+          * data/shaders/cull_occlusion.comp with occlusion culling.
+          */
+         std::vector<std::uint32_t> spir_v;
+
+         std::uint32_t max_instance_count = 65536;
+
+         bool is_occlusion_culled = false;
+
+         /**
+          * @brief Whether the draw count is read from the device when 
+          * VK_KHR_draw_indirect_count is enabled. Turned off, the 
+          * commands are not compacted, as on a device without it.
+          */
+         bool is_draw_count_used = true;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+      /**
+       * @brief The indices an instance draws from the bound index buffer.
+       */
+      struct draw_range
+      {
+         std::uint32_t index_count = 0;
+         std::uint32_t first_index = 0;
+         std::int32_t vertex_offset = 0;
+      }; // struct draw_range
+
+      /**
+       * @brief The phases of occlusion culling. Without it, everything
+       * is culled and drawn in the early phase.
+       */
+      enum class cull_phase
+      {
+         e_early,
+         e_late
+      }; // enum class cull_phase
+
+   public:
+      gpu_culling( ) = default;
+      explicit gpu_culling( create_info_t const& create_info );
+      gpu_culling( gpu_culling const& rhs ) = delete;
+      gpu_culling( gpu_culling&& rhs );
+      ~gpu_culling( );
+
+      gpu_culling& operator=( gpu_culling const& rhs ) = delete;
+      gpu_culling& operator=( gpu_culling&& rhs );
+
+      /**
+       * @brief Add an instance. The command buffers must be recorded 
+       * again for it to be drawn.
+       *
+       * @return The index of the instance.
+       */
+      std::uint32_t add( 
+         glm::vec3 const& center, 
+         float radius, 
+         draw_range const& range 
+      );
+
+      /**
+       * @brief Move the bounding sphere of an instance. It must not be
+       * called while a frame using the culling is in flight.
+       */
+      void set_bounds( 
+         std::uint32_t index, 
+         glm::vec3 const& center, 
+         float radius 
+      ) noexcept;
+
+      /**
+       * @brief Change the indices an instance draws, such as to switch
+       * its level of detail. The commands are written by the culling 
+       * dispatch, so it takes effect without recording again. It must 
+       * not be called while a frame using the culling is in flight.
+       */
+      void set_range( 
+         std::uint32_t index, 
+         draw_range const& range 
+      ) noexcept;
+
+      void clear( ) noexcept;
+
+      /**
+       * @brief Write the frustum to cull against and make the bounds 
+       * set since the last update visible to the device.
+       */
+      void update( 
+         frustum const& view 
+      ) noexcept;
+
+      /**
+       * @brief Set the camera that projects the bounds on the depth 
+       * pyramid, written to the device by the next update.
+       */
+      void set_camera( 
+         glm::mat4 const& view, 
+         glm::mat4 const& projection 
+      ) noexcept;
+
+      /**
+       * @brief Set the depth pyramid the late phase tests against. It 
+       * must be set again whenever the pyramid is created again, and
+       * not while a frame using the culling is in flight.
+       */
+      void set_depth_pyramid( 
+         depth_pyramid const& pyramid 
+      ) noexcept;
+
+      /**
+       * @brief Record the culling dispatch of a phase, outside of a 
+       * render pass. The commands are ready for the draw indirect stage
+       * after it. The late phase must come after the depth pyramid is 
+       * built, and records nothing without occlusion culling.
+       */
+      void record_cull( 
+         VkCommandBuffer cmd_buffer,
+         cull_phase phase = cull_phase::e_early
+      ) const noexcept;
+
+      /**
+       * @brief Record the draws of the instances visible in a phase, 
+       * with the pipeline and the vertex and index buffers already 
+       * bound.
+       */
+      void record_draw( 
+         VkCommandBuffer cmd_buffer,
+         cull_phase phase = cull_phase::e_early
+      ) const noexcept;
+
+      [[nodiscard]]
+      std::uint32_t get_instance_count(
+      ) const noexcept PURE;
+
+      /**
+       * @brief The buffer the culling writes the indirect commands to,
+       * which can be copied from to read them back.
+       */
+      [[nodiscard]]
+      VkBuffer get_command_buffer(
+      ) const noexcept PURE;
+
+      /**
+       * @return Where the commands of a phase start in the command 
+       * buffer.
+       */
+      [[nodiscard]]
+      VkDeviceSize get_command_offset( 
+         cull_phase phase 
+      ) const noexcept PURE;
+
+      /**
+       * @brief The buffer holding the draw count of each phase, which
+       * can be copied from to read them back. Only written when the 
+       * commands are compacted.
+       */
+      [[nodiscard]]
+      VkBuffer get_count_buffer(
+      ) const noexcept PURE;
+
+      /**
+       * @return Where the draw count of a phase is in the count buffer.
+       */
+      [[nodiscard]]
+      VkDeviceSize get_count_offset( 
+         cull_phase phase 
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_max_instance_count(
+      ) const noexcept PURE;
+
+      /**
+       * @return Whether the draw count is read from the device, with 
+       * only the visible instances in the commands.
+       */
+      [[nodiscard]]
+      bool is_compacted(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      bool is_occlusion_culled(
+      ) const noexcept PURE;
+
+   private:
+      /**
+       * @brief An instance as laid out in the std430 instance buffer.
+       */
+      struct gpu_instance
+      {
+         glm::vec4 sphere;
+         std::uint32_t index_count;
+         std::uint32_t first_index;
+         std::int32_t vertex_offset;
+         std::uint32_t padding;
+      }; // struct gpu_instance
+
+      /**
+       * @brief The std140 uniform block of the culling shaders. The 
+       * frustum culling shader only reads up to the instance count.
+       */
+      struct cull_data
+      {
+         std::array<glm::vec4, 6> planes;
+         std::uint32_t instance_count;
+         std::uint32_t pyramid_level_count;
+         glm::vec2 pyramid_size;
+         glm::mat4 view;
+         glm::mat4 projection;
+      }; // struct cull_data
+
+      /**
+       * @brief The push constants of the occlusion culling shader.
+       */
+      struct phase_data
+      {
+         std::uint32_t phase;
+         std::uint32_t command_offset;
+      }; // struct phase_data
+
+      vk::buffer_allocation create_buffer( 
+         VkDeviceSize size, 
+         VkBufferUsageFlags usage, 
+         VmaMemoryUsage memory_usage,
+         vk::memory_category category 
+      ) const;
+
+      void create_pipeline( 
+         std::vector<std::uint32_t> const& spir_v 
+      );
+
+      void create_descriptor_set( );
+
+      void destroy( ) noexcept;
+
+   private:
+      context const* p_context = nullptr;
+
+      vk::buffer_allocation instance_buffer;
+      vk::buffer_allocation uniform_buffer;
+      vk::buffer_allocation command_buffer;
+      vk::buffer_allocation count_buffer;
+      vk::buffer_allocation visibility_buffer;
+
+      gpu_instance* p_instances = nullptr;
+      cull_data* p_cull_data = nullptr;
+
+      VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+      VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+      VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+      VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+      VkPipeline pipeline = VK_NULL_HANDLE;
+
+      PFN_vkCmdDrawIndexedIndirectCountKHR p_draw_indexed_indirect_count = nullptr;
+      bool is_multi_draw_supported = false;
+      bool is_occlusion_enabled = false;
+
+      std::uint32_t instance_count = 0;
+      std::uint32_t max_instance_count = 0;
+
+      std::uint32_t dirty_begin = 0;
+      std::uint32_t dirty_end = 0;
+   }; // class gpu_culling
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_GPU_CULLING_HPP
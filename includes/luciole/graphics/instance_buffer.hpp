@@ -0,0 +1,116 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_INSTANCE_BUFFER_HPP
+#define LUCIOLE_GRAPHICS_INSTANCE_BUFFER_HPP
+
+/* INCLUDES */
+#include <luciole/context.hpp>
+#include <luciole/graphics/draw_list.hpp>
+#include <luciole/luciole_core.hpp>
+#include <luciole/utils/strong_types.hpp>
+#include <luciole/vk/memory_stats.hpp>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace gfx
+{
+   /**
+    * @brief The per instance transforms of a draw list, in a host 
+    * visible storage buffer read by data/shaders/instanced_shader.vert
+    * through gl_InstanceIndex.
+    *
+    * The buffer holds a region per frame in flight, so that writing the
+    * transforms of a frame does not touch those the GPU may still read.
+    * The region of a frame is bound at get_offset( frame ), either as the 
+    * offset of the descriptor or as a dynamic offset.
+    */
+   class instance_buffer
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+
+         std::uint32_t frame_count = 2;
+         std::uint32_t max_instance_count = 65536;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      instance_buffer( ) = default;
+      explicit instance_buffer( create_info_t const& create_info );
+      instance_buffer( instance_buffer const& rhs ) = delete;
+      instance_buffer( instance_buffer&& rhs );
+      ~instance_buffer( );
+
+      instance_buffer& operator=( instance_buffer const& rhs ) = delete;
+      instance_buffer& operator=( instance_buffer&& rhs );
+
+      /**
+       * @brief Copy the transforms of the last build of a draw list into 
+       * the region of a frame. The frame must not be in flight.
+       */
+      void write( 
+         std::uint32_t frame, 
+         draw_list const& list 
+      );
+
+      [[nodiscard]]
+      VkBuffer get_buffer(
+      ) const noexcept PURE;
+
+      /**
+       * @return Where the region of a frame starts in the buffer.
+       */
+      [[nodiscard]]
+      VkDeviceSize get_offset( 
+         std::uint32_t frame 
+      ) const noexcept PURE;
+
+      /**
+       * @return The size of the region of a frame.
+       */
+      [[nodiscard]]
+      VkDeviceSize get_range(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_max_instance_count(
+      ) const noexcept PURE;
+
+   private:
+      void destroy( ) noexcept;
+
+   private:
+      context const* p_context = nullptr;
+
+      vk::buffer_allocation buffer;
+      glm::mat4* p_transforms = nullptr;
+
+      std::uint32_t frame_count = 0;
+      std::uint32_t max_instance_count = 0;
+      VkDeviceSize range = 0;
+   }; // class instance_buffer
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_INSTANCE_BUFFER_HPP
@@ -0,0 +1,159 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_LOD_SELECTION_HPP
+#define LUCIOLE_GRAPHICS_LOD_SELECTION_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief Where the levels of detail are seen from.
+    */
+   struct lod_view
+   {
+      glm::vec3 position = glm::vec3( 0.0f );
+
+      /**
+       * @brief The pixels covered by a length of one unit seen from a
+       * distance of one unit.
+       */
+      float scale = 1.0f;
+   }; // struct lod_view
+
+   /**
+    * @brief Get the view of a perspective camera.
+    *
+    * @param [in] view The view matrix.
+    * @param [in] projection The perspective projection matrix.
+    * @param [in] viewport_height The height of the viewport, in pixels.
+    */
+   [[nodiscard]]
+   lod_view make_lod_view( 
+      glm::mat4 const& view, 
+      glm::mat4 const& projection, 
+      float viewport_height 
+   ) noexcept PURE;
+
+   /**
+    * @brief Picks the level of detail of objects from the size their
+    * geometric errors project to on the screen: the coarsest level 
+    * whose error covers at most threshold pixels.
+    *
+    * To keep objects near a switch distance from popping every frame,
+    * an object only moves to a coarser level once its error projects 
+    * under threshold * ( 1 - hysteresis ), while it moves back to a 
+    * finer one as soon as the error of its level goes over threshold.
+    */
+   class lod_selector
+   {
+   public:
+      struct create_info
+      {
+         /**
+          * @brief The projected error allowed, in pixels.
+          */
+         float threshold = 1.0f;
+         float hysteresis = 0.25f;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      lod_selector( ) = default;
+      explicit lod_selector( create_info_t const& create_info );
+
+      /**
+       * @brief Add an object at full detail.
+       *
+       * @param [in] errors The errors of the levels past full detail,
+       * in object space units and increasing.
+       *
+       * @return The index of the object.
+       */
+      std::uint32_t add( 
+         glm::vec3 const& center, 
+         float radius, 
+         std::vector<float> const& errors 
+      );
+
+      /**
+       * @brief Move the bounding sphere of an object.
+       *
+       * @param [in] scale How much the transform of the object scales 
+       * its errors.
+       */
+      void set_bounds( 
+         std::uint32_t index, 
+         glm::vec3 const& center, 
+         float radius, 
+         float scale = 1.0f 
+      ) noexcept;
+
+      void clear( ) noexcept;
+
+      /**
+       * @brief Select the levels of some objects, usually the visible
+       * ones given by culling. The others keep their level.
+       *
+       * @param [in] view Where the objects are seen from.
+       * @param [in] objects The indices of the objects.
+       *
+       * @return Whether the level of any of the objects changed.
+       */
+      bool select( 
+         lod_view const& view, 
+         std::vector<std::uint32_t> const& objects 
+      ) noexcept;
+
+      /**
+       * @return The level of an object, 0 for full detail and i for the
+       * level of the i-th error it was added with.
+       */
+      [[nodiscard]]
+      std::uint32_t get_level( 
+         std::uint32_t index 
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_object_count(
+      ) const noexcept PURE;
+
+   private:
+      float threshold = 1.0f;
+      float hysteresis = 0.25f;
+
+      std::vector<glm::vec4> spheres;
+      std::vector<float> scales;
+      std::vector<std::uint32_t> first_errors;
+      std::vector<std::uint32_t> error_counts;
+      std::vector<std::uint32_t> levels;
+
+      std::vector<float> errors;
+   }; // class lod_selector
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_LOD_SELECTION_HPP
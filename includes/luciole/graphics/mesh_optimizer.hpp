@@ -0,0 +1,170 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_MESH_OPTIMIZER_HPP
+#define LUCIOLE_GRAPHICS_MESH_OPTIMIZER_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief How well a triangle list uses the post-transform
+    * vertex cache.
+    */
+   struct vertex_cache_stats
+   {
+      /**
+       * @brief Average cache miss ratio, transformed vertices per
+       * triangle. 0.5 is the best achievable on regular grids, 3 the worst.
+       */
+      float acmr = 0.0f;
+      /**
+       * @brief Average transformed to vertex ratio. 1 is the best
+       * achievable.
+       */
+      float atvr = 0.0f;
+   }; // struct vertex_cache_stats
+
+   struct mesh_optimization_report
+   {
+      vertex_cache_stats before;
+      vertex_cache_stats after;
+
+      bool uses_16_bit_indices = false;
+   }; // struct mesh_optimization_report
+
+   struct mesh_optimization_result
+   {
+      /**
+       * @brief For each original vertex, its index in the optimized
+       * vertex buffer. Unused vertices are mapped to unused_vertex.
+       */
+      std::vector<std::uint32_t> remap;
+      std::uint32_t vertex_count = 0;
+
+      mesh_optimization_report report;
+   }; // struct mesh_optimization_result
+
+   static constexpr std::uint32_t unused_vertex = std::numeric_limits<std::uint32_t>::max( );
+
+   /**
+    * @brief Simulate a FIFO post-transform cache over a triangle list.
+    *
+    * @param [in] indices The triangle list.
+    * @param [in] vertex_count The number of vertices referenced.
+    * @param [in] cache_size The number of entries of the simulated cache.
+    */
+   [[nodiscard]]
+   vertex_cache_stats analyze_vertex_cache(
+      std::vector<std::uint32_t> const& indices,
+      std::uint32_t vertex_count,
+      std::uint32_t cache_size = 16
+   ) PURE;
+
+   /**
+    * @brief Reorder triangles for the post-transform cache using Tom
+    * Forsyth's linear-speed vertex cache optimisation.
+    */
+   [[nodiscard]]
+   std::vector<std::uint32_t> optimize_vertex_cache(
+      std::vector<std::uint32_t> const& indices,
+      std::uint32_t vertex_count
+   ) PURE;
+
+   /**
+    * @brief Split a cache optimized triangle list in clusters and sort
+    * them so that outward facing clusters are drawn first, reducing
+    * overdraw while keeping most of the vertex cache efficiency.
+    *
+    * @param [in] threshold How much the ACMR may degrade, 1.05 allows
+    * for 5 percent.
+    */
+   [[nodiscard]]
+   std::vector<std::uint32_t> optimize_overdraw(
+      std::vector<std::uint32_t> const& indices,
+      std::vector<glm::vec3> const& positions,
+      float threshold = 1.05f
+   ) PURE;
+
+   /**
+    * @brief Order vertices by first use so vertex fetches are linear.
+    * The indices are rewritten in place.
+    *
+    * @return The remap table from old to new vertex indices.
+    */
+   [[nodiscard]]
+   std::vector<std::uint32_t> optimize_vertex_fetch(
+      std::vector<std::uint32_t>& indices,
+      std::uint32_t vertex_count
+   );
+
+   /**
+    * @brief Run vertex cache, overdraw and vertex fetch optimisation
+    * on a triangle list. The indices are rewritten in place, vertex
+    * streams must then be reordered with remap_vertices.
+    */
+   [[nodiscard]]
+   mesh_optimization_result optimize_mesh(
+      std::vector<std::uint32_t>& indices,
+      std::vector<glm::vec3> const& positions
+   );
+
+   /**
+    * @brief Whether a mesh with a given number of vertices can be
+    * drawn with 16 bit indices. 0xFFFF is kept out as it is the
+    * primitive restart value.
+    */
+   [[nodiscard]]
+   constexpr bool fits_16_bit_indices( std::uint32_t vertex_count ) noexcept
+   {
+      return vertex_count <= std::numeric_limits<std::uint16_t>::max( );
+   }
+
+   /**
+    * @brief Reorder a vertex stream with the remap table given by
+    * optimize_vertex_fetch or optimize_mesh.
+    */
+   template<typename T>
+   [[nodiscard]]
+   std::vector<T> remap_vertices( 
+      std::vector<T> const& vertices, 
+      std::vector<std::uint32_t> const& remap,
+      std::uint32_t vertex_count )
+   {
+      std::vector<T> res( vertex_count );
+      for( std::size_t i = 0; i < vertices.size( ) && i < remap.size( ); ++i )
+      {
+         if ( remap[i] != unused_vertex )
+         {
+            res[remap[i]] = vertices[i];
+         }
+      }
+
+      return res;
+   }
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_MESH_OPTIMIZER_HPP
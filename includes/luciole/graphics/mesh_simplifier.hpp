@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_MESH_SIMPLIFIER_HPP
+#define LUCIOLE_GRAPHICS_MESH_SIMPLIFIER_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief A reduced triangle list, drawn with the vertices of the
+    * mesh it was simplified from.
+    */
+   struct simplified_mesh
+   {
+      std::vector<std::uint32_t> indices;
+
+      /**
+       * @brief The geometric error of the triangles, in the units of
+       * the positions. It is the square root of the quadric error of
+       * the worst collapse, a distance to the original surface.
+       */
+      float error = 0.0f;
+   }; // struct simplified_mesh
+
+   /**
+    * @brief Reduce a triangle list with Garland and Heckbert's quadric
+    * error metric. Vertices are collapsed onto one of their neighbours,
+    * cheapest first, so no new vertex is made. Vertices on an open edge
+    * of the index topology, which covers the borders of the mesh as well
+    * as its attribute seams, are never moved.
+    *
+    * @param [in] indices The triangle list.
+    * @param [in] positions The positions of the vertices.
+    * @param [in] target_index_count The number of indices to stop at.
+    * @param [in] max_error The error no collapse may go over.
+    */
+   [[nodiscard]]
+   simplified_mesh simplify_mesh(
+      std::vector<std::uint32_t> const& indices,
+      std::vector<glm::vec3> const& positions,
+      std::uint32_t target_index_count,
+      float max_error = std::numeric_limits<float>::max( )
+   ) PURE;
+
+   /**
+    * @brief Build the levels of detail of a triangle list in a single
+    * simplification run, each with about reduction times the triangles
+    * of the previous one. The chain stops early when a level would not
+    * remove at least a tenth of the triangles of the previous one. The
+    * levels are optimized for the post-transform cache.
+    *
+    * @param [in] max_lod_count The number of levels past full detail.
+    * @param [in] reduction The ratio of triangles kept from one level
+    * to the next.
+    *
+    * @return The levels, coarsest last, with increasing errors.
+    */
+   [[nodiscard]]
+   std::vector<simplified_mesh> build_lod_chain(
+      std::vector<std::uint32_t> const& indices,
+      std::vector<glm::vec3> const& positions,
+      std::uint32_t max_lod_count = 4,
+      float reduction = 0.5f,
+      float max_error = std::numeric_limits<float>::max( )
+   ) PURE;
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_MESH_SIMPLIFIER_HPP
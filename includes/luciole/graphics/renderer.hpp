@@ -20,15 +20,26 @@
 #define LUCIOLE_GRAPHICS_RENDERER_HPP
 
 /* INCLUDES */
+#include <luciole/assets/loading_pipeline.hpp>
 #include <luciole/context.hpp>
+#include <luciole/graphics/depth_pyramid.hpp>
+#include <luciole/graphics/draw_list.hpp>
+#include <luciole/graphics/frustum_culling.hpp>
+#include <luciole/graphics/gpu_culling.hpp>
+#include <luciole/graphics/instance_buffer.hpp>
+#include <luciole/graphics/lod_selection.hpp>
+#include <luciole/graphics/transform_hierarchy.hpp>
 #include <luciole/utils/strong_types.hpp>
 #include <luciole/vk/buffers/index_buffer.hpp>
 #include <luciole/vk/buffers/uniform_buffer.hpp>
 #include <luciole/vk/buffers/vertex_buffer.hpp>
+#include <luciole/vk/images/texture.hpp>
 #include <luciole/vk/shaders/shader_manager.hpp>
 
 #include <vulkan/vulkan.h>
 
+#include <limits>
+#include <mutex>
 #include <vector>
 
 /**
@@ -38,22 +49,22 @@ class renderer
 {
 private:
    /**
-    * @brief Dummy struct for custom strong type to designate a shader filepath.
+    * @brief Dummy struct for custom strong type to designate SPIR-V code.
     */
-   struct shader_filepath_parameter{ };
-   using shader_filepath_t = strong_type<std::string const&, shader_filepath_parameter>;
+   struct shader_code_parameter{ };
+   using shader_code_t = strong_type<std::string const&, shader_code_parameter>;
 
    /**
-    * @brief Dummy struct for custom strong type to designate a vertex shader filepath.
+    * @brief Dummy struct for custom strong type to designate vertex shader SPIR-V code.
     */
-   struct vert_shader_filepath_param{ };
-   using vert_shader_filepath_t = strong_type<std::string const&, vert_shader_filepath_param>;
+   struct vert_shader_code_param{ };
+   using vert_shader_code_t = strong_type<std::string const&, vert_shader_code_param>;
    
    /**
-    * @brief Dummy struct for custom strong type to designate a fragment shader filepath.
+    * @brief Dummy struct for custom strong type to designate fragment shader SPIR-V code.
     */
-   struct frag_shader_filepath_param{ };
-   using frag_shader_filepath_t = strong_type<std::string const&, frag_shader_filepath_param>;
+   struct frag_shader_code_param{ };
+   using frag_shader_code_t = strong_type<std::string const&, frag_shader_code_param>;
 
 public:
    renderer( ) = default;
@@ -71,6 +82,21 @@ public:
 
    std::uint32_t load_shader( vk::shader_loader_interface const* p_loader, vk::shader::filepath_t const& filepath );
 
+   /**
+    * @brief Queue the loading of the geometry and the default pipeline.
+    * The SPIR-V is read, the vertices encoded and the pipeline created
+    * in the background, the buffers are uploaded by the loading 
+    * pipeline's update. Until then, draw_frame presents a cleared 
+    * loading frame.
+    *
+    * The renderer must not be moved until the load is done.
+    */
+   void load_content( assets::loading_pipeline& pipeline );
+
+   [[nodiscard]]
+   bool is_content_loaded(
+   ) const noexcept PURE;
+
 private:
    /**
     * @brief Create all objects related to the swapchain.
@@ -86,6 +112,41 @@ private:
     */
    void record_command_buffers( );
 
+   /**
+    * @brief Create the GPU culling of the model and add the model to it.
+    * With occlusion culling, the swapchain mutex must be held for the 
+    * depth pyramid to be created.
+    *
+    * @param [in] spir_v The SPIR-V of the culling shader.
+    * @param [in] is_occlusion_culled Whether the shader is the occlusion 
+    * culling one.
+    *
+    * @return Whether the culling could be created.
+    */
+   bool create_gpu_culling( 
+      std::vector<std::uint32_t> spir_v, 
+      bool is_occlusion_culled 
+   );
+
+   /**
+    * @brief Create the depth pyramid over the depth buffer of the 
+    * swapchain and hand it to the GPU culling.
+    */
+   void create_depth_pyramid( );
+
+   /**
+    * @brief Create the pipeline drawing the draw list from the instanced
+    * vertex shader, if it compiled. Without it the default pipeline 
+    * draws the model.
+    */
+   void create_instanced_pipeline( );
+
+   /**
+    * @brief Create a descriptor set per swapchain image, holding its 
+    * uniform buffer and its region of the instance buffer.
+    */
+   void create_descriptor_sets( );
+
    /**
     * @brief Create a swapchain object.
     * 
@@ -113,24 +174,29 @@ private:
    ) const PURE;
 
    /**
-    * @brief Create a render pass object.
+    * @brief Create a render pass object. A frame draws in two passes:
+    * the first clears the attachments and leaves the depth readable by 
+    * the depth pyramid, the second draws over it what the late phase of
+    * occlusion culling found and hands the image to the presentation.
     * 
+    * @param load_op CLEAR for the first pass, LOAD for the second.
     * @return std::variant<VkRenderPass, vk::error> Type safe union that either returns
     * a render pass or an error code.
     */
    [[nodiscard]] 
    std::variant<VkRenderPass, vk::error> create_render_pass( 
+      VkAttachmentLoadOp load_op
    ) const PURE;
 
    /**
     * @brief Create a shader module object.
     * 
-    * @param filepath The Path to the SPIR-V binary file
+    * @param code The SPIR-V binary code.
     * @return VkShaderModule The shader module generated from the SPIR-V code.
     */
    [[nodiscard]] 
    VkShaderModule create_shader_module( 
-       shader_filepath_t filepath 
+       shader_code_t code 
    ) const PURE;
 
    /**
@@ -155,17 +221,18 @@ private:
    ) const PURE;
 
    /**
-    * @brief Create a default pipeline object.
+    * @brief Create a default pipeline object. Safe to call from any thread
+    * holding the swapchain mutex.
     * 
-    * @param vert_filepath The path from the executable to the vertex shader SPIR-V file. 
-    * @param frag_filepath The path from the executable to the fragment shader SPIR-V file.
+    * @param vert_code The SPIR-V code of the vertex shader. 
+    * @param frag_code The SPIR-V code of the fragment shader.
     * @return std::variant<VkPipeline, vk::error> Type safe union that either returns a 
     * default graphics pipeline or an error code.
     */
    [[nodiscard]] 
    std::variant<VkPipeline, vk::error> create_default_pipeline( 
-       vert_shader_filepath_t vert_filepath, 
-       frag_shader_filepath_t frag_filepath 
+       vert_shader_code_t vert_code, 
+       frag_shader_code_t frag_code 
    ) const PURE;
 
    /**
@@ -209,6 +276,17 @@ private:
    VkSurfaceFormatKHR pick_swapchain_format(
    ) const PURE;
 
+   /**
+    * @brief Pick a depth format that can be both rendered to and 
+    * sampled.
+    * 
+    * @return VkFormat The chosen format, or VK_FORMAT_UNDEFINED if none
+    * is supported.
+    */
+   [[nodiscard]]
+   VkFormat pick_depth_format(
+   ) const PURE;
+
    /**
     * @brief Pick a surface present mode for the swapchain.
     * 
@@ -243,6 +321,11 @@ private:
    VkExtent2D swapchain_extent;
 
    VkRenderPass render_pass = VK_NULL_HANDLE;
+   VkRenderPass late_render_pass = VK_NULL_HANDLE;
+
+   VkFormat depth_format = VK_FORMAT_UNDEFINED;
+   vk::texture depth_image;
+
    VkPipeline default_graphics_pipeline = VK_NULL_HANDLE;
    VkPipelineLayout default_graphics_pipeline_layout = VK_NULL_HANDLE;
 
@@ -266,6 +349,65 @@ private:
    vk::vertex_buffer vertex_buffer;
    vk::index_buffer index_buffer;
 
+   gfx::transform_hierarchy transforms;
+   gfx::transform_node model_node;
+
+   gfx::culling_set culling;
+   std::uint32_t model_object = 0;
+   glm::vec3 model_min = glm::vec3( std::numeric_limits<float>::max( ) );
+   glm::vec3 model_max = glm::vec3( std::numeric_limits<float>::lowest( ) );
+   std::vector<std::uint32_t> visible_objects;
+   bool is_model_visible = true;
+
+   /**
+    * @brief Without GPU culling, the visible model is queued in a draw 
+    * list each frame, its transform written to the region of the 
+    * swapchain image in the instance buffer.
+    */
+   gfx::draw_list draws;
+   gfx::instance_buffer instances;
+   VkPipeline instanced_graphics_pipeline = VK_NULL_HANDLE;
+   std::string instanced_vert_shader_code;
+
+   VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+   std::vector<VkDescriptorSet> descriptor_sets;
+
+   /**
+    * @brief The level of detail of the model, an index into the index 
+    * ranges of model_levels, full detail first. The objects of the 
+    * selector are added in the same order as those of the culling set.
+    */
+   gfx::lod_selector lods;
+   std::uint32_t model_lod = 0;
+   std::vector<gfx::gpu_culling::draw_range> model_levels;
+
+   /**
+    * @brief Set once the culling shader is compiled. The model is then
+    * culled on the GPU and drawn indirectly instead.
+    */
+   gfx::gpu_culling gpu_culling;
+   std::uint32_t model_instance = 0;
+   bool is_gpu_culled = false;
+
+   /**
+    * @brief Built from the depth of the first pass when the GPU culling
+    * tests occlusion. It follows the size of the swapchain, so the 
+    * shader is kept to create it again.
+    */
+   gfx::depth_pyramid depth_pyramid;
+   std::vector<std::uint32_t> depth_pyramid_shader;
+
+   std::string vert_shader_code;
+   std::string frag_shader_code;
+   bool has_content = false;
+
+   /**
+    * @brief Held while the swapchain objects are rebuilt, and while a 
+    * pipeline is created against them by the loading threads.
+    */
+   std::mutex swapchain_mutex;
+   std::uint64_t swapchain_generation = 0;
+
    vk::shader_manager shader_manager;
 
    std::shared_ptr<spdlog::logger> vulkan_logger;
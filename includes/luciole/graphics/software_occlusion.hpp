@@ -0,0 +1,226 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_SOFTWARE_OCCLUSION_HPP
+#define LUCIOLE_GRAPHICS_SOFTWARE_OCCLUSION_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/graphics/aabb_tree.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief A small depth buffer drawn on the CPU with a few large 
+    * occluders, to drop the objects hidden behind them before their draws 
+    * are recorded.
+    *
+    * The buffer is split in tiles of tile_width by tile_height pixels, 
+    * each stored on its own. The occluder triangles are binned to the 
+    * tiles they touch, then every tile is rasterized by a single job, 
+    * a row of 8 pixels at a time with AVX2, 4 with SSE2. Since a pixel 
+    * keeps the nearest depth written to it, the buffer does not depend on 
+    * the order of the jobs and is the same with or without a thread pool.
+    *
+    * The depth kept is z / w after the projection, which grows with the
+    * distance and is linear across the screen. Triangles with a corner 
+    * in front of the near plane, where the GPU would clip them, are not 
+    * clipped but skipped, which only loses some occlusion.
+    */
+   class occlusion_buffer
+   {
+   public:
+      static constexpr std::uint32_t tile_width = 32;
+      static constexpr std::uint32_t tile_height = 8;
+
+      struct create_info
+      {
+         /**
+          * @brief When null, the tiles and the boxes are done on the 
+          * calling thread.
+          */
+         thread_pool* p_thread_pool = nullptr;
+
+         /**
+          * @brief The size of the buffer in pixels, rounded up to whole 
+          * tiles.
+          */
+         std::uint32_t width = 320;
+         std::uint32_t height = 192;
+
+         std::uint32_t tiles_per_job = 4;
+         std::uint32_t boxes_per_job = 4096;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+      struct stats
+      {
+         std::uint32_t occluder_count = 0;
+         std::uint32_t triangle_count = 0;
+
+         /**
+          * @brief Triangles skipped for crossing the near plane, off the 
+          * screen, facing edge on or covering no pixel.
+          */
+         std::uint32_t skipped_triangle_count = 0;
+
+         std::uint32_t tested_count = 0;
+         std::uint32_t culled_count = 0;
+
+         /**
+          * @brief In milliseconds, since begin_frame.
+          */
+         double rasterize_time = 0.0;
+         double test_time = 0.0;
+      }; // struct stats
+
+   public:
+      occlusion_buffer( ) = default;
+      explicit occlusion_buffer( create_info_t const& create_info );
+
+      /**
+       * @brief Drop the occluders and the depth of the previous frame.
+       *
+       * @param [in] view_projection The matrix used for the occluders and 
+       * the boxes of this frame.
+       */
+      void begin_frame( glm::mat4 const& view_projection );
+
+      /**
+       * @brief Project the triangles of a mesh, to be drawn by the next 
+       * rasterize. The mesh should be smaller than what it is drawn as,
+       * or it will hide objects that can be seen around it.
+       *
+       * @param [in] positions The local positions of the vertices.
+       * @param [in] indices Three per triangle.
+       * @param [in] transform Moves the mesh into the world.
+       */
+      void add_occluder( 
+         std::vector<glm::vec3> const& positions, 
+         std::vector<std::uint32_t> const& indices, 
+         glm::mat4 const& transform 
+      );
+
+      /**
+       * @brief Draw the occluders added since begin_frame.
+       */
+      void rasterize( );
+
+      /**
+       * @brief Check whether a box is behind the occluders everywhere it 
+       * covers the buffer. A box reaching in front of the near plane, or 
+       * entirely off the buffer, is never occluded.
+       */
+      [[nodiscard]]
+      bool is_occluded(
+         aabb const& box
+      ) const noexcept PURE;
+
+      /**
+       * @brief Find the boxes that are not hidden by the occluders.
+       *
+       * @param [in] boxes The world bounds of the objects to test.
+       * @param [out] visible The indices of the visible boxes, in 
+       * increasing order.
+       */
+      void cull( std::vector<aabb> const& boxes, std::vector<std::uint32_t>& visible );
+
+      /**
+       * @return The depth stored at a pixel, or the largest float where 
+       * no occluder was drawn.
+       */
+      [[nodiscard]]
+      float get_depth( 
+         std::uint32_t x, 
+         std::uint32_t y 
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_width(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_height(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      stats const& get_stats(
+      ) const noexcept PURE;
+
+   private:
+      /**
+       * @brief A triangle on the screen, as the three edge functions that
+       * are positive inside of it and the plane of its depth.
+       */
+      struct screen_triangle
+      {
+         float edge_a[3];
+         float edge_b[3];
+         float edge_c[3];
+
+         float depth_a;
+         float depth_b;
+         float depth_c;
+
+         std::uint32_t min_x;
+         std::uint32_t min_y;
+         std::uint32_t max_x;
+         std::uint32_t max_y;
+      }; // struct screen_triangle
+
+      void rasterize_tile( std::uint32_t tile ) noexcept;
+
+   private:
+      thread_pool* p_thread_pool = nullptr;
+      std::uint32_t tiles_per_job = 4;
+      std::uint32_t boxes_per_job = 4096;
+
+      std::uint32_t width = 0;
+      std::uint32_t height = 0;
+      std::uint32_t tile_count_x = 0;
+      std::uint32_t tile_count_y = 0;
+
+      glm::mat4 view_projection = glm::mat4( 1.0f );
+
+      std::vector<screen_triangle> triangles;
+      std::vector<std::vector<std::uint32_t>> bins;
+
+      /**
+       * @brief The pixels of each tile one after the other, a row at a 
+       * time.
+       */
+      std::vector<float> depth;
+
+      /**
+       * @brief The farthest depth of each tile.
+       */
+      std::vector<float> tile_max_depth;
+
+      stats frame_stats;
+   }; // class occlusion_buffer
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_SOFTWARE_OCCLUSION_HPP
@@ -0,0 +1,294 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_TRANSFORM_HIERARCHY_HPP
+#define LUCIOLE_GRAPHICS_TRANSFORM_HIERARCHY_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief A handle to a node of a transform_hierarchy.
+    */
+   struct transform_node
+   {
+      std::uint32_t index = std::numeric_limits<std::uint32_t>::max( );
+      std::uint32_t generation = 0;
+
+      bool operator==( transform_node const& rhs ) const noexcept 
+      {
+         return index == rhs.index && generation == rhs.generation;
+      }
+
+      bool operator!=( transform_node const& rhs ) const noexcept
+      {
+         return !( *this == rhs );
+      }
+   }; // struct transform_node
+
+   /**
+    * @brief The local and world transforms of a forest of nodes.
+    *
+    * The local position, rotation and scale of the nodes are kept in
+    * separate arrays. The arrays are sorted so that the nodes under the
+    * same group of roots are contiguous, one depth after the other, which
+    * puts every parent before its children. The world matrices are only
+    * recomputed for the nodes that changed and their descendants, several
+    * nodes at a time with AVX2 or SSE2 when the build enables them. The
+    * groups of roots are independent and are updated in parallel on the
+    * thread pool.
+    *
+    * Structural changes are cheap: the arrays are sorted again by the 
+    * next update.
+    */
+   class transform_hierarchy
+   {
+   public:
+      using node = transform_node;
+
+      static constexpr node null_node = node{ };
+
+      struct create_info
+      {
+         /**
+          * @brief When null, the update runs on the calling thread.
+          */
+         thread_pool* p_thread_pool = nullptr;
+
+         /**
+          * @brief Roots are grouped until a group holds at least this many
+          * nodes. A group is the unit of work given to a thread.
+          */
+         std::uint32_t min_nodes_per_group = 4096;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      transform_hierarchy( ) = default;
+      explicit transform_hierarchy( create_info_t const& create_info );
+
+      /**
+       * @brief Create a node with an identity local transform.
+       *
+       * @param [in] parent The parent of the node, or null_node for a root.
+       */
+      node create( node parent = null_node );
+
+      /**
+       * @brief Destroy a node and all its descendants.
+       */
+      void destroy( node n );
+
+      /**
+       * @brief Move a node, and its descendants, under another parent. The
+       * local transform is kept.
+       *
+       * @param [in] parent The new parent, or null_node to make the node a
+       * root. It may not be the node or one of its descendants.
+       */
+      void set_parent( node n, node parent );
+
+      void set_position( node n, glm::vec3 const& position );
+      /**
+       * @param [in] rotation A unit quaternion.
+       */
+      void set_rotation( node n, glm::quat const& rotation );
+      void set_scale( node n, glm::vec3 const& scale );
+      void set_local( node n, glm::vec3 const& position, glm::quat const& rotation, glm::vec3 const& scale );
+
+      /**
+       * @brief Sort the nodes again if the hierarchy changed, and compute 
+       * the world matrix of the nodes changed since the last update and of
+       * their descendants.
+       */
+      void update( );
+
+      [[nodiscard]]
+      bool is_alive( 
+         node n 
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      node get_parent(
+         node n
+      ) const PURE;
+
+      [[nodiscard]]
+      glm::vec3 get_position(
+         node n
+      ) const PURE;
+
+      [[nodiscard]]
+      glm::quat get_rotation(
+         node n
+      ) const PURE;
+
+      [[nodiscard]]
+      glm::vec3 get_scale(
+         node n
+      ) const PURE;
+
+      /**
+       * @return The world matrix of the node as of the last update.
+       */
+      [[nodiscard]]
+      glm::mat4 get_world_matrix(
+         node n
+      ) const PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_node_count(
+      ) const noexcept PURE;
+
+      /**
+       * @return The number of world matrices computed by the last update.
+       */
+      [[nodiscard]]
+      std::uint32_t get_updated_count(
+      ) const noexcept PURE;
+
+   private:
+      static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max( );
+
+      /**
+       * @brief Where a node lives in the arrays, and its links in the 
+       * hierarchy, by handle index.
+       */
+      struct slot
+      {
+         std::uint32_t generation = 0;
+         std::uint32_t dense = npos;
+
+         std::uint32_t parent = npos;
+         std::uint32_t first_child = npos;
+         std::uint32_t next_sibling = npos;
+         std::uint32_t prev_sibling = npos;
+      }; // struct slot
+
+      /**
+       * @brief A range of nodes at the same depth.
+       */
+      struct level
+      {
+         std::uint32_t first = 0;
+         std::uint32_t last = 0;
+      }; // struct level
+
+      /**
+       * @brief Roots whose nodes are updated together.
+       */
+      struct group
+      {
+         std::uint32_t first_level = 0;
+         std::uint32_t last_level = 0;
+      }; // struct group
+
+   private:
+      /**
+       * @throw std::runtime_error If the node was destroyed.
+       */
+      void check_alive( node n ) const;
+
+      /**
+       * @return The dense index of a living node.
+       *
+       * @throw std::runtime_error If the node was destroyed.
+       */
+      [[nodiscard]]
+      std::uint32_t get_dense(
+         node n
+      ) const;
+
+      void link( std::uint32_t index, std::uint32_t parent );
+      void unlink( std::uint32_t index );
+
+      /**
+       * @brief Swap remove a node from the arrays.
+       */
+      void erase_dense( std::uint32_t dense );
+
+      /**
+       * @brief Sort the arrays by group and depth, and split them into
+       * levels and groups.
+       */
+      void rebuild( );
+
+      /**
+       * @return The number of world matrices computed.
+       */
+      std::uint32_t update_group( group const& g ) noexcept;
+
+   private:
+      thread_pool* p_thread_pool = nullptr;
+      std::uint32_t min_nodes_per_group = 4096;
+
+      std::vector<slot> slots;
+      std::vector<std::uint32_t> free_slots;
+
+      /* By dense index. */
+      std::vector<std::uint32_t> handles;
+
+      std::vector<float> position_x;
+      std::vector<float> position_y;
+      std::vector<float> position_z;
+
+      std::vector<float> rotation_x;
+      std::vector<float> rotation_y;
+      std::vector<float> rotation_z;
+      std::vector<float> rotation_w;
+
+      std::vector<float> scale_x;
+      std::vector<float> scale_y;
+      std::vector<float> scale_z;
+
+      std::vector<std::uint8_t> dirty;
+
+      /**
+       * @brief The index in the world arrays of the parent of each node.
+       */
+      std::vector<std::uint32_t> parent_world;
+
+      /**
+       * @brief The first three rows of the world matrices, by row then 
+       * column. Element 0 holds the identity, the parent of the roots, 
+       * and node i lives at i + 1.
+       */
+      std::array<std::vector<float>, 12> world;
+
+      std::vector<level> levels;
+      std::vector<group> groups;
+
+      bool is_layout_dirty = false;
+      std::uint32_t updated_count = 0;
+   }; // class transform_hierarchy
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_TRANSFORM_HIERARCHY_HPP
@@ -19,10 +19,13 @@
 #ifndef LUCIOLE_GRAPHICS_VERTEX_HPP
 #define LUCIOLE_GRAPHICS_VERTEX_HPP
 
+#include <luciole/graphics/vertex_layout.hpp>
+
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 
 #include <array>
+#include <cstddef>
 #include <vector>
 
 struct vertex
@@ -30,39 +33,39 @@ struct vertex
     glm::vec2 position;
     glm::vec3 colour;
 
+    /**
+     * @brief The layout the vertices are uploaded with: half float
+     * positions and 8 bit colours, 8 bytes per vertex instead of 20.
+     */
+    using layout = gfx::vertex_layout<gfx::attrib::half2, gfx::attrib::unorm8x4>;
+
     static VkVertexInputBindingDescription get_binding_description()
     {
-        VkVertexInputBindingDescription const description 
-        {
-            .binding = 0,
-            .stride = sizeof(vertex),
-            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-        };
+        return layout::get_binding_description( );
+    }
 
-        return description;
+    static std::array<VkVertexInputAttributeDescription, layout::attribute_count> get_attribute_descriptions()
+    {
+        return layout::get_attribute_descriptions( );
     }
 
-    static std::array<VkVertexInputAttributeDescription, 2> get_attribute_descriptions()
+    /**
+     * @brief Encode vertices into the layout.
+     */
+    static std::vector<std::byte> encode( std::vector<vertex> const& vertices )
     {
-        std::array<VkVertexInputAttributeDescription, 2> descriptions 
+        std::vector<glm::vec2> positions;
+        std::vector<glm::vec4> colours;
+        positions.reserve( vertices.size( ) );
+        colours.reserve( vertices.size( ) );
+
+        for( auto const& v : vertices )
         {
-            VkVertexInputAttributeDescription
-            {
-                .location = 0,
-                .binding = 0,
-                .format = VK_FORMAT_R32G32_SFLOAT,
-                .offset = offsetof(vertex, position)
-            },
-            VkVertexInputAttributeDescription
-            {
-                .location = 1,
-                .binding = 0,
-                .format = VK_FORMAT_R32G32B32_SFLOAT,
-                .offset = offsetof(vertex, colour)
-            }
-        };
+            positions.push_back( v.position );
+            colours.emplace_back( v.colour, 1.0f );
+        }
 
-        return descriptions;
+        return layout::encode( positions, colours );
     }
 };
 
@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_VERTEX_ENCODING_HPP
+#define LUCIOLE_GRAPHICS_VERTEX_ENCODING_HPP
+
+/* INCLUDES */
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gfx
+{
+   /**
+    * @brief Convert floats to IEEE half floats.
+    */
+   void encode_half( float const* p_src, std::uint16_t* p_dst, std::size_t count ) noexcept;
+
+   /**
+    * @brief Convert floats in [-1, 1] to signed normalized 8 bit integers.
+    */
+   void encode_snorm8( float const* p_src, std::int8_t* p_dst, std::size_t count ) noexcept;
+
+   /**
+    * @brief Convert floats in [-1, 1] to signed normalized 16 bit integers.
+    */
+   void encode_snorm16( float const* p_src, std::int16_t* p_dst, std::size_t count ) noexcept;
+
+   /**
+    * @brief Convert floats in [0, 1] to unsigned normalized 8 bit integers.
+    */
+   void encode_unorm8( float const* p_src, std::uint8_t* p_dst, std::size_t count ) noexcept;
+
+   /**
+    * @brief Convert floats in [0, 1] to unsigned normalized 16 bit integers.
+    */
+   void encode_unorm16( float const* p_src, std::uint16_t* p_dst, std::size_t count ) noexcept;
+
+   /**
+    * @brief Map unit vectors on the octahedron unfolded in [-1, 1]^2.
+    */
+   void encode_octahedral( glm::vec3 const* p_src, glm::vec2* p_dst, std::size_t count ) noexcept;
+
+   /**
+    * @brief Pack tangents with their bitangent sign in w in the
+    * VK_FORMAT_A2B10G10R10_SNORM_PACK32 layout.
+    */
+   void encode_packed_tangent( glm::vec4 const* p_src, std::uint32_t* p_dst, std::size_t count ) noexcept;
+
+   /**
+    * @brief Retrieve a unit vector from its octahedral mapping.
+    */
+   [[nodiscard]]
+   glm::vec3 decode_octahedral( glm::vec2 const& encoded ) noexcept;
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_VERTEX_ENCODING_HPP
@@ -0,0 +1,332 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_GRAPHICS_VERTEX_LAYOUT_HPP
+#define LUCIOLE_GRAPHICS_VERTEX_LAYOUT_HPP
+
+/* INCLUDES */
+#include <luciole/graphics/vertex_encoding.hpp>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace gfx
+{
+   /**
+    * @brief The encodings a vertex attribute can be stored with. Every
+    * encoding exposes the type it is built from, the VkFormat and size
+    * of the encoded attribute and a function encoding a contiguous
+    * array of attributes.
+    */
+   namespace attrib
+   {
+      struct float2
+      {
+         using input_type = glm::vec2;
+
+         static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT;
+         static constexpr std::uint32_t size = 8;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            std::memcpy( p_dst, p_src, count * size );
+         }
+      }; // struct float2
+
+      struct float3
+      {
+         using input_type = glm::vec3;
+
+         static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+         static constexpr std::uint32_t size = 12;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            std::memcpy( p_dst, p_src, count * size );
+         }
+      }; // struct float3
+
+      /**
+       * @brief Half float 2D positions or texture coordinates.
+       */
+      struct half2
+      {
+         using input_type = glm::vec2;
+
+         static constexpr VkFormat format = VK_FORMAT_R16G16_SFLOAT;
+         static constexpr std::uint32_t size = 4;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            encode_half( &p_src->x, reinterpret_cast<std::uint16_t*>( p_dst ), count * 2 );
+         }
+      }; // struct half2
+
+      /**
+       * @brief Half float 3D positions, padded to four components since
+       * three component 16 bit formats are rarely supported for vertex
+       * input.
+       */
+      struct half4
+      {
+         using input_type = glm::vec3;
+
+         static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+         static constexpr std::uint32_t size = 8;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            std::vector<std::uint16_t> halfs( count * 3 );
+            encode_half( &p_src->x, halfs.data( ), halfs.size( ) );
+
+            auto* p_out = reinterpret_cast<std::uint16_t*>( p_dst );
+            for( std::size_t i = 0; i < count; ++i )
+            {
+               p_out[i * 4 + 0] = halfs[i * 3 + 0];
+               p_out[i * 4 + 1] = halfs[i * 3 + 1];
+               p_out[i * 4 + 2] = halfs[i * 3 + 2];
+               p_out[i * 4 + 3] = 0x3c00; // 1.0
+            }
+         }
+      }; // struct half4
+
+      /**
+       * @brief Normals stored as signed normalized bytes.
+       */
+      struct snorm8x4
+      {
+         using input_type = glm::vec3;
+
+         static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_SNORM;
+         static constexpr std::uint32_t size = 4;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            std::vector<std::int8_t> values( count * 3 );
+            encode_snorm8( &p_src->x, values.data( ), values.size( ) );
+
+            auto* p_out = reinterpret_cast<std::int8_t*>( p_dst );
+            for( std::size_t i = 0; i < count; ++i )
+            {
+               p_out[i * 4 + 0] = values[i * 3 + 0];
+               p_out[i * 4 + 1] = values[i * 3 + 1];
+               p_out[i * 4 + 2] = values[i * 3 + 2];
+               p_out[i * 4 + 3] = 0;
+            }
+         }
+      }; // struct snorm8x4
+
+      /**
+       * @brief Normals mapped on an octahedron and stored as two signed
+       * normalized shorts. Must be decoded in the vertex shader.
+       */
+      struct octahedral16
+      {
+         using input_type = glm::vec3;
+
+         static constexpr VkFormat format = VK_FORMAT_R16G16_SNORM;
+         static constexpr std::uint32_t size = 4;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            std::vector<glm::vec2> mapped( count );
+            encode_octahedral( p_src, mapped.data( ), count );
+            encode_snorm16( &mapped.data( )->x, reinterpret_cast<std::int16_t*>( p_dst ), count * 2 );
+         }
+      }; // struct octahedral16
+
+      /**
+       * @brief Texture coordinates in [0, 1] stored as unsigned
+       * normalized shorts.
+       */
+      struct unorm16x2
+      {
+         using input_type = glm::vec2;
+
+         static constexpr VkFormat format = VK_FORMAT_R16G16_UNORM;
+         static constexpr std::uint32_t size = 4;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            encode_unorm16( &p_src->x, reinterpret_cast<std::uint16_t*>( p_dst ), count * 2 );
+         }
+      }; // struct unorm16x2
+
+      /**
+       * @brief Colours stored as unsigned normalized bytes.
+       */
+      struct unorm8x4
+      {
+         using input_type = glm::vec4;
+
+         static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+         static constexpr std::uint32_t size = 4;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            encode_unorm8( &p_src->x, reinterpret_cast<std::uint8_t*>( p_dst ), count * 4 );
+         }
+      }; // struct unorm8x4
+
+      /**
+       * @brief Tangents stored in 10 bits per component, with the sign of
+       * the bitangent in the 2 bit w component.
+       */
+      struct packed_tangent
+      {
+         using input_type = glm::vec4;
+
+         static constexpr VkFormat format = VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+         static constexpr std::uint32_t size = 4;
+
+         static void encode( input_type const* p_src, std::size_t count, std::byte* p_dst ) noexcept
+         {
+            encode_packed_tangent( p_src, reinterpret_cast<std::uint32_t*>( p_dst ), count );
+         }
+      }; // struct packed_tangent
+   } // namespace attrib
+
+   /**
+    * @brief An interleaved vertex layout built from a list of attribute
+    * encodings. Attributes are given consecutive locations in the
+    * order they are declared in.
+    */
+   template<typename... attributes>
+   class vertex_layout
+   {
+   public:
+      static constexpr std::uint32_t attribute_count = sizeof...( attributes );
+      static constexpr std::uint32_t stride = ( attributes::size + ... );
+
+      static constexpr std::array<std::uint32_t, attribute_count> offsets = [] 
+      {
+         std::array<std::uint32_t, attribute_count> res = { };
+         std::array<std::uint32_t, attribute_count> const sizes = { attributes::size... };
+
+         std::uint32_t offset = 0;
+         for( std::size_t i = 0; i < attribute_count; ++i )
+         {
+            res[i] = offset;
+            offset += sizes[i];
+         }
+
+         return res;
+      }( );
+
+   public:
+      static constexpr VkVertexInputBindingDescription get_binding_description( 
+         std::uint32_t binding = 0 ) noexcept
+      {
+         return VkVertexInputBindingDescription
+         {
+            .binding = binding,
+            .stride = stride,
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+         };
+      }
+
+      static constexpr std::array<VkVertexInputAttributeDescription, attribute_count> get_attribute_descriptions(
+         std::uint32_t binding = 0, std::uint32_t first_location = 0 ) noexcept
+      {
+         std::array<VkFormat, attribute_count> const formats = { attributes::format... };
+         std::array<VkVertexInputAttributeDescription, attribute_count> descriptions = { };
+
+         for( std::uint32_t i = 0; i < attribute_count; ++i )
+         {
+            descriptions[i] = VkVertexInputAttributeDescription
+            {
+               .location = first_location + i,
+               .binding = binding,
+               .format = formats[i],
+               .offset = offsets[i]
+            };
+         }
+
+         return descriptions;
+      }
+
+      /**
+       * @brief Encode and interleave one stream of data per attribute.
+       * All the streams must have the same size.
+       *
+       * @return The vertex data, ready to be uploaded.
+       */
+      static std::vector<std::byte> encode( 
+         std::vector<typename attributes::input_type> const&... streams )
+      {
+         std::array<std::size_t, attribute_count> const counts = { streams.size( )... };
+         std::size_t const count = counts[0];
+
+         for( auto stream_count : counts )
+         {
+            assert( stream_count == count && "All vertex streams must be the same size." );
+            static_cast<void>( stream_count );
+         }
+
+         std::vector<std::byte> vertices( count * stride );
+         encode_to( vertices.data( ), count, streams.data( )... );
+
+         return vertices;
+      }
+
+      /**
+       * @brief Encode and interleave count vertices straight into
+       * memory of at least count * stride bytes, such as a mapped
+       * staging buffer.
+       */
+      static void encode_to(
+         std::byte* p_dst, std::size_t count,
+         typename attributes::input_type const*... p_streams )
+      {
+         encode_to_impl( std::index_sequence_for<attributes...>{ }, p_dst, count, p_streams... );
+      }
+
+   private:
+      template<std::size_t... indices>
+      static void encode_to_impl(
+         std::index_sequence<indices...>, std::byte* p_dst, std::size_t count,
+         typename attributes::input_type const*... p_streams )
+      {
+         ( interleave<attributes>( p_streams, count, offsets[indices], p_dst ), ... );
+      }
+
+      template<typename attribute>
+      static void interleave( 
+         typename attribute::input_type const* p_src, std::size_t count, 
+         std::uint32_t offset, std::byte* p_dst )
+      {
+         std::vector<std::byte> encoded( count * attribute::size );
+         attribute::encode( p_src, count, encoded.data( ) );
+
+         for( std::size_t i = 0; i < count; ++i )
+         {
+            std::memcpy( p_dst + i * stride + offset, encoded.data( ) + i * attribute::size, attribute::size );
+         }
+      }
+   }; // class vertex_layout
+} // namespace gfx
+
+#endif // LUCIOLE_GRAPHICS_VERTEX_LAYOUT_HPP
@@ -0,0 +1,156 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_SYS_COMMAND_BUFFER_HPP
+#define LUCIOLE_SYS_COMMAND_BUFFER_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/sys/component.hpp>
+#include <luciole/sys/world.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sys
+{
+   /**
+    * @brief Records structural changes to a world, to apply them once 
+    * the iteration that wants them is over. Components are moved into
+    * the buffer when recorded, and into the world when executed.
+    *
+    * Entities created by the buffer get a pending handle, that the
+    * later commands of the same buffer may use.
+    */
+   class command_buffer
+   {
+   public:
+      command_buffer( ) = default;
+      command_buffer( command_buffer const& rhs ) = delete;
+      command_buffer( command_buffer&& rhs ) noexcept = default;
+      ~command_buffer( );
+
+      command_buffer& operator=( command_buffer const& rhs ) = delete;
+      command_buffer& operator=( command_buffer&& rhs ) noexcept;
+
+      /**
+       * @return A pending handle to the entity, only valid within this
+       * buffer.
+       */
+      entity create( );
+
+      template<typename... Ts>
+      entity create( Ts&&... components )
+      {
+         auto const e = create( );
+         ( add( e, std::forward<Ts>( components ) ), ... );
+
+         return e;
+      }
+
+      void destroy( entity e );
+
+      template<typename T>
+      void add( entity e, T&& component )
+      {
+         using component_t = std::decay_t<T>;
+
+         auto const& info = get_component_info<component_t>( );
+
+         // Nothing may throw once the component is in the buffer.
+         commands.reserve( commands.size( ) + 1 );
+
+         void* p_storage = allocate( info.size, info.alignment );
+         new( p_storage ) component_t( std::forward<T>( component ) );
+
+         commands.push_back( command{ command_type::e_add, e, &info, p_storage } );
+      }
+
+      template<typename T>
+      void remove( entity e )
+      {
+         commands.push_back( command{ command_type::e_remove, e, &get_component_info<T>( ), nullptr } );
+      }
+
+      /**
+       * @brief Drop every command, destroying the components they hold.
+       */
+      void clear( ) noexcept;
+
+      [[nodiscard]]
+      bool is_empty(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      static constexpr bool is_pending( entity e ) noexcept
+      {
+         return e.generation == pending_generation;
+      }
+
+   private:
+      friend class world;
+
+      static constexpr std::uint32_t pending_generation = std::numeric_limits<std::uint32_t>::max( );
+
+      enum class command_type
+      {
+         e_create,
+         e_destroy,
+         e_add,
+         e_remove
+      }; // enum class command_type
+
+      struct command
+      {
+         command_type type = command_type::e_create;
+         entity target = null_entity;
+         component_info const* p_info = nullptr;
+
+         /**
+          * @brief The component to add, null once moved into the world.
+          */
+         void* p_component = nullptr;
+      }; // struct command
+
+      struct block
+      {
+         std::unique_ptr<std::byte[]> p_data;
+         std::size_t size = 0;
+      }; // struct block
+
+      /**
+       * @brief Get aligned storage that does not move until the buffer
+       * is cleared.
+       */
+      void* allocate( std::size_t size, std::size_t alignment );
+
+   private:
+      std::vector<command> commands;
+      std::uint32_t pending_count = 0;
+
+      std::vector<block> blocks;
+      std::size_t block_index = 0;
+      std::size_t block_offset = 0;
+   }; // class command_buffer
+} // namespace sys
+
+#endif // LUCIOLE_SYS_COMMAND_BUFFER_HPP
@@ -19,60 +19,112 @@
 #ifndef LUCIOLE_SYS_COMPONENT_HPP
 #define LUCIOLE_SYS_COMPONENT_HPP
 
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string_view>
 #include <type_traits>
-#include <tuple>
+#include <utility>
 
 namespace sys
 {
-   /*
-   template<template<typename...> typename type1, typename type2>
-   constexpr bool is_specialization_v = false;
-
-   template<template<typename...> typename type, typename... args>
-   constexpr bool is_specialization_v<type, type<args...>> = true;
-
-   namespace cpt
-   {  
-      template<typename type>
-      concept node = std::is_object_v<type>;
+   using component_id = std::uint64_t;
 
-      template<typename type>
-      concept graph = true;
-   } // namespace cpt
-
-   template<cpt::node node_t, cpt::graph... connections_t>
-   struct graph   
+   namespace detail
    {
-      node_t node;
-      std::tuple<connections_t...> connections; 
+      constexpr std::uint64_t hash_name( std::string_view name ) noexcept
+      {
+         std::uint64_t hash = 0xcbf29ce484222325ull;
+         for( char const c : name )
+         {
+            hash ^= static_cast<std::uint8_t>( c );
+            hash *= 0x100000001b3ull;
+         }
 
-      graph( ) = default;
+         return hash;
+      }
 
-      template<std::size_t index_t>
-         requires (index_t < sizeof...(connections_t) && index_t >= 0)
-      cpt::graph auto& get_connection( )
+      /**
+       * @brief The name of a type, as spelled by the compiler in the
+       * signature of this function. 
+       */
+      template<typename T>
+      constexpr std::string_view get_type_name( ) noexcept
       {
-         return std::get<index_t>(connections);
+#if defined( _MSC_VER )
+         return __FUNCSIG__;
+#else
+         return __PRETTY_FUNCTION__;
+#endif
       }
-   }; // struct graph
+   } // namespace detail
 
-   template<typename graph, typename graph_location>
-   struct graph_context
-   {
-      graph& instance;
-      graph_location location;
-   };
+   /**
+    * @brief Whether a type can be stored as a component. Components are
+    * moved around the chunks as entities change archetype, so they must
+    * move and destroy without throwing.
+    */
+   template<typename T>
+   inline constexpr bool is_component_v = 
+      std::is_object_v<T> && 
+      !std::is_const_v<T> && 
+      !std::is_array_v<T> &&
+      std::is_nothrow_move_constructible_v<T> && 
+      std::is_nothrow_destructible_v<T> &&
+      alignof( T ) <= cache_line;
+
+   /**
+    * @brief The id of a component type, computed at compile time from
+    * its name. The same type has the same id in every translation unit.
+    */
+   template<typename T>
+   inline constexpr component_id component_id_v = detail::hash_name( detail::get_type_name<std::remove_cv_t<T>>( ) );
 
-   template<typename type>
-   concept component_graph = is_specialization_v<graph_context, type>;
+   /**
+    * @brief What the archetype storage needs to know about a component
+    * type to move and destroy it without knowing the type.
+    */
+   struct component_info
+   {
+      component_id id = 0;
+      std::size_t size = 0;
+      std::size_t alignment = 0;
+      
+      /**
+       * @brief Move construct into p_dst the component at p_src, and
+       * destroy the one at p_src.
+       */
+      void ( *relocate )( void* p_dst, void* p_src ) noexcept = nullptr;
+      void ( *destroy )( void* p_component ) noexcept = nullptr;
+   }; // struct component_info
 
-   class component
+   template<typename T>
+   component_info const& get_component_info( ) noexcept
    {
-   public:
+      static_assert( is_component_v<T>, "Components must be non const objects that move and destroy without throwing." );
+
+      static constexpr component_info info
+      {
+         .id = component_id_v<T>,
+         .size = sizeof( T ),
+         .alignment = alignof( T ),
+         .relocate = [] ( void* p_dst, void* p_src ) noexcept
+         {
+            auto* p_value = std::launder( static_cast<T*>( p_src ) );
+            new( p_dst ) T( std::move( *p_value ) );
+            p_value->~T( );
+         },
+         .destroy = [] ( void* p_component ) noexcept
+         {
+            std::launder( static_cast<T*>( p_component ) )->~T( );
+         }
+      };
 
-   private:
-   }; // class component  
-   */
+      return info;
+   }
 } // namespace sys
 
 #endif // LUCIOLE_SYS_COMPONENT_HPP
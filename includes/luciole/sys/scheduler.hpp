@@ -0,0 +1,353 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_SYS_SCHEDULER_HPP
+#define LUCIOLE_SYS_SCHEDULER_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/sys/command_buffer.hpp>
+#include <luciole/sys/world.hpp>
+#include <luciole/threads/thread_pool.hpp>
+#include <luciole/utils/delegate.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sys
+{
+   /**
+    * @brief The components a system only reads.
+    */
+   template<typename... Ts>
+   struct reads { };
+
+   /**
+    * @brief The components a system reads and writes.
+    */
+   template<typename... Ts>
+   struct writes { };
+
+   /**
+    * @brief Runs the systems updating a world every frame, in parallel
+    * when they do not conflict.
+    *
+    * Each system declares the components it reads and writes. A system
+    * waits for the systems added before it that write what it reads, or
+    * touch what it writes, and the others run at the same time. The 
+    * entities of a system are split into jobs of whole chunks, spread
+    * across the thread pool.
+    *
+    * Systems record structural changes in the command buffer they are 
+    * given. The buffers are executed in the order the systems were added
+    * once the systems around them are done. Exclusive systems get the 
+    * whole world, and run alone on the calling thread after the command 
+    * buffers of the systems before them are executed.
+    *
+    * The scheduler cannot be moved, since its jobs in flight point to it.
+    */
+   class scheduler
+   {
+   public:
+      struct create_info
+      {
+         /**
+          * @brief When null, the systems run one after the other on the 
+          * calling thread.
+          */
+         thread_pool* p_thread_pool = nullptr;
+
+         /**
+          * @brief The most jobs the entities of a system are split into.
+          * 0 picks 4 per thread of the pool.
+          */
+         std::uint32_t max_jobs_per_system = 0;
+
+         bool is_tracing_enabled = false;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+      struct trace_event
+      {
+         std::uint32_t system = 0;
+
+         /**
+          * @brief 0 for the thread calling run, the index of the worker
+          * in the thread pool plus 1 otherwise.
+          */
+         std::uint32_t thread = 0;
+         std::uint32_t chunk_count = 0;
+
+         /**
+          * @brief Since the start of the frame.
+          */
+         std::chrono::nanoseconds begin = std::chrono::nanoseconds( 0 );
+         std::chrono::nanoseconds end = std::chrono::nanoseconds( 0 );
+      }; // struct trace_event
+
+   public:
+      explicit scheduler( create_info_t const& create_info );
+      scheduler( scheduler const& rhs ) = delete;
+      scheduler( scheduler&& rhs ) = delete;
+      ~scheduler( ) = default;
+
+      scheduler& operator=( scheduler const& rhs ) = delete;
+      scheduler& operator=( scheduler&& rhs ) = delete;
+
+      /**
+       * @brief Add a system called on every entity having all the read
+       * and written components. 
+       *
+       * @param [in] f A callable taking a reference to each written 
+       * component then a const reference to each read component. It may
+       * take the entity first, and a command buffer before the entity.
+       * It is called from many threads at once.
+       */
+      template<typename R, typename W, typename F>
+      void add_system( std::string name, F&& f )
+      {
+         add<false>( R( ), W( ), std::move( name ), std::forward<F>( f ) );
+      }
+
+      /**
+       * @brief Add a system called on every chunk of entities having all
+       * the read and written components.
+       *
+       * @param [in] f A callable taking the entity count of the chunk,
+       * its entities, a pointer to the array of each written component
+       * then a const pointer to the array of each read component. It may 
+       * take a command buffer first. It is called from many threads at
+       * once.
+       */
+      template<typename R, typename W, typename F>
+      void add_chunk_system( std::string name, F&& f )
+      {
+         add<true>( R( ), W( ), std::move( name ), std::forward<F>( f ) );
+      }
+
+      /**
+       * @brief Add a system with access to the whole world, running 
+       * alone.
+       */
+      void add_exclusive_system( std::string name, delegate<void( world& )> const& f );
+
+      /**
+       * @brief Run every system once, and wait for them.
+       *
+       * @throw The first exception thrown by a system, once the systems
+       * running alongside it are done. The command buffers are dropped.
+       */
+      void run( world& w );
+
+      [[nodiscard]]
+      std::size_t get_system_count(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::string const& get_system_name(
+         std::size_t system
+      ) const noexcept PURE;
+
+      /**
+       * @return The systems a system waits for.
+       */
+      [[nodiscard]]
+      std::vector<std::uint32_t> const& get_dependencies(
+         std::size_t system
+      ) const noexcept PURE;
+
+      /**
+       * @return The jobs of the last run, when tracing is enabled.
+       */
+      [[nodiscard]]
+      std::vector<trace_event> const& get_trace(
+      ) const noexcept PURE;
+
+      /**
+       * @return The trace of the last run in the Chrome trace event 
+       * format, for chrome://tracing or Perfetto.
+       */
+      [[nodiscard]]
+      nlohmann::json get_chrome_trace(
+      ) const;
+
+   private:
+      struct chunk_ref
+      {
+         archetype* p_archetype = nullptr;
+         std::size_t chunk = 0;
+      }; // struct chunk_ref
+
+      struct job
+      {
+         std::size_t first_chunk = 0;
+         std::size_t chunk_count = 0;
+      }; // struct job
+
+      struct system
+      {
+         std::string name;
+         std::vector<component_id> reads;
+         std::vector<component_id> writes;
+
+         bool is_exclusive = false;
+
+         delegate<std::vector<archetype*> const&( world& )> match;
+         delegate<void( archetype&, std::size_t, command_buffer& )> run_chunk;
+         delegate<void( world& )> run_exclusive;
+
+         std::vector<std::uint32_t> dependencies;
+         std::vector<std::uint32_t> dependents;
+      }; // struct system
+
+      /**
+       * @brief What a system needs during a run.
+       */
+      struct system_state
+      {
+         std::vector<chunk_ref> chunks;
+         std::vector<job> jobs;
+         std::vector<command_buffer> command_buffers;
+         std::vector<trace_event> trace;
+
+         std::atomic<std::size_t> remaining_jobs = 0;
+         std::atomic<std::size_t> remaining_dependencies = 0;
+      }; // struct system_state
+
+   private:
+      template<bool is_per_chunk, typename... Rs, typename... Ws, typename F>
+      void add( reads<Rs...>, writes<Ws...>, std::string name, F&& f )
+      {
+         static_assert( sizeof...( Rs ) + sizeof...( Ws ) > 0, "A system must access at least one component." );
+
+         system s;
+         s.name = std::move( name );
+         s.reads = { component_id_v<Rs>... };
+         s.writes = { component_id_v<Ws>... };
+         s.match = [] ( world& w ) -> std::vector<archetype*> const& 
+         { 
+            return w.get_archetypes<Ws..., Rs...>( ); 
+         };
+
+         if constexpr ( is_per_chunk )
+         {
+            s.run_chunk = [f = std::forward<F>( f )] ( archetype& arch, std::size_t chunk, command_buffer& commands ) 
+            {
+               auto const count = static_cast<std::size_t>( arch.get_chunk_entity_count( chunk ) );
+               auto const* p_entities = arch.get_entities( chunk );
+               
+               std::apply( [&] ( auto*... p_components ) 
+               {
+                  if constexpr ( std::is_invocable_v<std::decay_t<F> const&, command_buffer&, std::size_t, entity const*, Ws*..., Rs const*...> )
+                  {
+                     f( commands, count, p_entities, p_components... );
+                  }
+                  else
+                  {
+                     f( count, p_entities, p_components... );
+                  }
+               }, get_columns<Ws..., Rs const...>( arch, chunk ) );
+            };
+         }
+         else
+         {
+            s.run_chunk = [f = std::forward<F>( f )] ( archetype& arch, std::size_t chunk, command_buffer& commands ) 
+            {
+               auto const count = static_cast<std::size_t>( arch.get_chunk_entity_count( chunk ) );
+               auto const* p_entities = arch.get_entities( chunk );
+
+               std::apply( [&] ( auto*... p_components ) 
+               {
+                  for( std::size_t i = 0; i < count; ++i )
+                  {
+                     if constexpr ( std::is_invocable_v<std::decay_t<F> const&, command_buffer&, entity, Ws&..., Rs const&...> )
+                     {
+                        f( commands, p_entities[i], p_components[i]... );
+                     }
+                     else if constexpr ( std::is_invocable_v<std::decay_t<F> const&, entity, Ws&..., Rs const&...> )
+                     {
+                        f( p_entities[i], p_components[i]... );
+                     }
+                     else
+                     {
+                        f( p_components[i]... );
+                     }
+                  }
+               }, get_columns<Ws..., Rs const...>( arch, chunk ) );
+            };
+         }
+
+         link_system( std::move( s ) );
+      }
+
+      template<typename... Ts>
+      static std::tuple<Ts*...> get_columns( archetype const& arch, std::size_t chunk ) noexcept
+      {
+         return std::tuple<Ts*...>( 
+            std::launder( static_cast<Ts*>( arch.get_column( chunk, arch.find_column( component_id_v<Ts> ) ) ) )... 
+         );
+      }
+
+      /**
+       * @brief Link a new system to the systems it conflicts with, since
+       * the last exclusive system.
+       */
+      void link_system( system&& s );
+
+      void run_phase( world& w, std::size_t first, std::size_t last );
+      void run_exclusive( world& w, std::size_t index );
+
+      void start_system( std::size_t index );
+      void finish_system( std::size_t index );
+      void run_job( std::size_t index, std::size_t job_index );
+
+      [[nodiscard]]
+      std::uint32_t get_thread_index(
+      ) const noexcept PURE;
+
+   private:
+      thread_pool* p_thread_pool = nullptr;
+      std::uint32_t max_jobs_per_system = 0;
+      bool is_tracing_enabled = false;
+
+      std::vector<system> systems;
+      std::vector<std::unique_ptr<system_state>> states;
+
+      std::atomic<std::size_t> remaining_systems = 0;
+      std::chrono::steady_clock::time_point frame_start;
+      std::vector<trace_event> trace;
+
+      std::mutex exception_mutex;
+      std::exception_ptr p_exception;
+   }; // class scheduler
+} // namespace sys
+
+#endif // LUCIOLE_SYS_SCHEDULER_HPP
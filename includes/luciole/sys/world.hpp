@@ -0,0 +1,521 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_SYS_WORLD_HPP
+#define LUCIOLE_SYS_WORLD_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/sys/component.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sys
+{
+   /**
+    * @brief A handle to an entity. The generation tells apart the
+    * entities that reuse the index of a destroyed one.
+    */
+   struct entity
+   {
+      std::uint32_t index = std::numeric_limits<std::uint32_t>::max( );
+      std::uint32_t generation = 0;
+
+      friend constexpr bool operator==( entity lhs, entity rhs ) noexcept
+      {
+         return lhs.index == rhs.index && lhs.generation == rhs.generation;
+      }
+
+      friend constexpr bool operator!=( entity lhs, entity rhs ) noexcept
+      {
+         return !( lhs == rhs );
+      }
+   }; // struct entity
+
+   inline constexpr entity null_entity = entity{ };
+
+   inline constexpr std::size_t chunk_size = 16 * kilobyte;
+
+   class command_buffer;
+
+   /**
+    * @brief The storage of every entity with the same set of components.
+    * Entities are packed in fixed size chunks, each holding one array
+    * per component, so that iterating a component reads contiguous
+    * memory. Rows are kept dense: removing one moves the last entity
+    * into it.
+    */
+   class archetype
+   {
+   public:
+      static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max( );
+
+   public:
+      /**
+       * @param [in] components The components of the archetype, sorted
+       * by id, without duplicates.
+       *
+       * @throw std::runtime_error if a single entity does not fit in a 
+       * chunk.
+       */
+      explicit archetype( std::vector<component_info const*> components );
+      archetype( archetype const& rhs ) = delete;
+      archetype( archetype&& rhs ) = delete;
+      ~archetype( );
+
+      archetype& operator=( archetype const& rhs ) = delete;
+      archetype& operator=( archetype&& rhs ) = delete;
+
+      /**
+       * @return The index of the component's array in the chunks, or
+       * npos if the archetype does not have the component.
+       */
+      [[nodiscard]]
+      std::size_t find_column(
+         component_id id
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::vector<component_info const*> const& get_components(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_entity_count(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_chunk_capacity(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::size_t get_chunk_count(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_chunk_entity_count(
+         std::size_t chunk
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      entity const* get_entities(
+         std::size_t chunk
+      ) const noexcept PURE;
+
+      /**
+       * @return The array of a component in a chunk.
+       */
+      [[nodiscard]]
+      void* get_column(
+         std::size_t chunk,
+         std::size_t column
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      void* get_component(
+         std::uint32_t row,
+         std::size_t column
+      ) const noexcept PURE;
+
+   private:
+      friend class world;
+
+      struct alignas( cache_line ) chunk
+      {
+         std::byte data[chunk_size];
+      }; // struct chunk
+
+      /**
+       * @brief Add a row at the end, with uninitialized components.
+       */
+      std::uint32_t allocate_row( entity e );
+
+      /**
+       * @brief Remove a row, moving the last row into it.
+       *
+       * @param [in] destroy_components Whether the components of the row
+       * still need to be destroyed, or were already moved out.
+       *
+       * @return The entity moved into the row, or null_entity if the row
+       * was the last one.
+       */
+      entity remove_row( std::uint32_t row, bool destroy_components ) noexcept;
+
+   private:
+      std::vector<component_info const*> components;
+      std::vector<std::size_t> offsets;
+
+      std::uint32_t chunk_capacity = 0;
+      std::uint32_t entity_count = 0;
+      std::vector<std::unique_ptr<chunk>> chunks;
+
+      std::unordered_map<component_id, archetype*> add_edges;
+      std::unordered_map<component_id, archetype*> remove_edges;
+   }; // class archetype
+
+   /**
+    * @brief Holds the entities and their components, grouped by 
+    * archetype. 
+    *
+    * Structural changes, creating or destroying entities and adding or
+    * removing components, are not allowed while iterating with each or
+    * each_chunk. Record them in a command_buffer and execute it after.
+    */
+   class world
+   {
+   public:
+      world( );
+      world( world const& rhs ) = delete;
+      world( world&& rhs ) = default;
+      ~world( ) = default;
+
+      world& operator=( world const& rhs ) = delete;
+      world& operator=( world&& rhs ) = default;
+
+      template<typename... Ts>
+      entity create( Ts&&... components )
+      {
+         static_assert( are_unique<std::decay_t<Ts>...>( ), "An entity cannot have the same component twice." );
+
+         check_structural_change( );
+
+         // Copy first, so that nothing throws once the row is allocated.
+         std::tuple<std::decay_t<Ts>...> values( std::forward<Ts>( components )... );
+
+         auto* p_archetype = find_archetype<std::decay_t<Ts>...>( );
+         auto const e = create_entity( p_archetype );
+         auto const row = records[e.index].row;
+
+         std::apply( [&] ( auto&... value ) 
+         {
+            ( construct( p_archetype, row, std::move( value ) ), ... );
+         }, values );
+
+         return e;
+      }
+
+      /**
+       * @brief Destroy an entity and its components. Does nothing if the
+       * entity is not alive.
+       */
+      void destroy( entity e );
+
+      [[nodiscard]]
+      bool is_alive(
+         entity e
+      ) const noexcept PURE;
+
+      /**
+       * @brief Add a component to an entity, or replace it if the entity
+       * already has one.
+       *
+       * @throw std::runtime_error if the entity is not alive.
+       */
+      template<typename T>
+      std::decay_t<T>& add( entity e, T&& component )
+      {
+         using component_t = std::decay_t<T>;
+
+         check_structural_change( );
+
+         component_t value( std::forward<T>( component ) );
+
+         auto const [p_storage, is_new] = add_component( e, get_component_info<component_t>( ) );
+         if ( !is_new )
+         {
+            std::launder( static_cast<component_t*>( p_storage ) )->~component_t( );
+         }
+
+         return *new( p_storage ) component_t( std::move( value ) );
+      }
+
+      /**
+       * @brief Remove a component from an entity. Does nothing if the 
+       * entity is not alive or does not have the component.
+       */
+      template<typename T>
+      void remove( entity e )
+      {
+         check_structural_change( );
+         remove_component( e, component_id_v<T> );
+      }
+
+      template<typename T>
+      [[nodiscard]]
+      bool has( entity e ) const noexcept
+      {
+         return find_component( e, component_id_v<T> ) != nullptr;
+      }
+
+      /**
+       * @return The component of the entity, or nullptr if the entity is
+       * not alive or does not have it.
+       */
+      template<typename T>
+      [[nodiscard]]
+      T* get( entity e ) noexcept
+      {
+         return std::launder( static_cast<T*>( find_component( e, component_id_v<T> ) ) );
+      }
+
+      template<typename T>
+      [[nodiscard]]
+      T const* get( entity e ) const noexcept
+      {
+         return std::launder( static_cast<T const*>( find_component( e, component_id_v<T> ) ) );
+      }
+
+      /**
+       * @brief Call a function on every entity having all the components
+       * Ts. The function takes a reference to each component, optionally
+       * preceded by the entity. Const components are only read.
+       */
+      template<typename... Ts, typename F>
+      void each( F&& f )
+      {
+         each_chunk<Ts...>( [&f] ( std::size_t count, entity const* p_entities, Ts*... p_components ) 
+         {
+            for( std::size_t i = 0; i < count; ++i )
+            {
+               if constexpr ( std::is_invocable_v<F&, entity, Ts&...> )
+               {
+                  f( p_entities[i], p_components[i]... );
+               }
+               else
+               {
+                  f( p_components[i]... );
+               }
+            }
+         } );
+      }
+
+      /**
+       * @brief Call a function on every chunk of entities having all the
+       * components Ts, with the number of entities in the chunk, their 
+       * handles and a pointer to the array of each component.
+       */
+      template<typename... Ts, typename F>
+      void each_chunk( F&& f )
+      {
+         iteration_guard const guard( *this );
+
+         for( archetype* p_archetype : match_archetypes<Ts...>( ) )
+         {
+            std::size_t const columns[] = { p_archetype->find_column( component_id_v<Ts> )..., 0 };
+
+            for( std::size_t chunk = 0; chunk < p_archetype->get_chunk_count( ); ++chunk )
+            {
+               call_chunk<Ts...>( f, *p_archetype, chunk, columns, std::index_sequence_for<Ts...>( ) );
+            }
+         }
+      }
+
+      /**
+       * @brief Apply the commands of a buffer in the order they were
+       * recorded, and clear it. Commands on entities that are not alive
+       * anymore are skipped.
+       */
+      void execute( command_buffer& buffer );
+
+      [[nodiscard]]
+      std::uint32_t get_entity_count(
+      ) const noexcept PURE;
+
+      [[nodiscard]]
+      std::size_t get_archetype_count(
+      ) const noexcept PURE;
+
+      /**
+       * @return The archetypes having all the components Ts, to split the
+       * iteration across threads.
+       */
+      template<typename... Ts>
+      [[nodiscard]]
+      std::vector<archetype*> const& get_archetypes( )
+      {
+         return match_archetypes<Ts...>( );
+      }
+
+   private:
+      struct entity_record
+      {
+         archetype* p_archetype = nullptr;
+         std::uint32_t row = 0;
+         std::uint32_t generation = 0;
+      }; // struct entity_record
+
+      struct query_cache
+      {
+         std::vector<component_id> ids;
+         std::vector<archetype*> archetypes;
+
+         /**
+          * @brief How many archetypes of the world were already matched.
+          */
+         std::size_t checked_count = 0;
+      }; // struct query_cache
+
+      class iteration_guard
+      {
+      public:
+         explicit iteration_guard( world& w ) noexcept : w( w ) { ++w.iteration_depth; }
+         iteration_guard( iteration_guard const& rhs ) = delete;
+         ~iteration_guard( ) { --w.iteration_depth; }
+
+         iteration_guard& operator=( iteration_guard const& rhs ) = delete;
+
+      private:
+         world& w;
+      }; // class iteration_guard
+
+   private:
+      template<typename... Ts>
+      static constexpr bool are_unique( ) noexcept
+      {
+         component_id const ids[] = { component_id_v<Ts>..., 0 };
+         for( std::size_t i = 0; i < sizeof...( Ts ); ++i )
+         {
+            for( std::size_t j = i + 1; j < sizeof...( Ts ); ++j )
+            {
+               if ( ids[i] == ids[j] )
+               {
+                  return false;
+               }
+            }
+         }
+
+         return true;
+      }
+
+      template<typename T>
+      static void construct( archetype* p_archetype, std::uint32_t row, T&& value ) noexcept
+      {
+         using component_t = std::decay_t<T>;
+
+         auto const column = p_archetype->find_column( component_id_v<component_t> );
+         new( p_archetype->get_component( row, column ) ) component_t( std::move( value ) );
+      }
+
+      template<typename... Ts, typename F, std::size_t... Is>
+      static void call_chunk( 
+         F& f, 
+         archetype const& arch, 
+         std::size_t chunk, 
+         std::size_t const* p_columns, 
+         std::index_sequence<Is...> )
+      {
+         f( 
+            static_cast<std::size_t>( arch.get_chunk_entity_count( chunk ) ), 
+            arch.get_entities( chunk ), 
+            std::launder( static_cast<Ts*>( arch.get_column( chunk, p_columns[Is] ) ) )... 
+         );
+      }
+
+      /**
+       * @brief Find the archetype of a set of components through a hash
+       * of their ids, without sorting them.
+       */
+      template<typename... Ts>
+      archetype* find_archetype( )
+      {
+         static constexpr std::uint64_t key = ( std::uint64_t{ 0 } + ... + mix_id( component_id_v<Ts> ) );
+
+         if ( auto const it = signature_lookup.find( key ); it != signature_lookup.end( ) )
+         {
+            auto const* p_archetype = it->second;
+            if ( p_archetype->components.size( ) == sizeof...( Ts ) && ( ( p_archetype->find_column( component_id_v<Ts> ) != archetype::npos ) && ... ) )
+            {
+               return it->second;
+            }
+         }
+
+         auto* p_archetype = find_archetype( { &get_component_info<Ts>( )... } );
+         signature_lookup[key] = p_archetype;
+
+         return p_archetype;
+      }
+
+      static constexpr std::uint64_t mix_id( component_id id ) noexcept
+      {
+         id ^= id >> 31;
+         id *= 0x7fb5d329728ea185ull;
+         id ^= id >> 27;
+
+         return id;
+      }
+
+      template<typename... Ts>
+      std::vector<archetype*> const& match_archetypes( )
+      {
+         static_assert( are_unique<std::remove_cv_t<Ts>...>( ), "A query cannot ask for the same component twice." );
+
+         return match_archetypes( { component_id_v<Ts>... } );
+      }
+
+      std::vector<archetype*> const& match_archetypes( std::vector<component_id> ids );
+
+      /**
+       * @param [in] components Any order, without duplicates.
+       */
+      archetype* find_archetype( std::vector<component_info const*> components );
+      archetype* find_add_target( archetype* p_source, component_info const& info );
+      archetype* find_remove_target( archetype* p_source, component_id id );
+
+      entity create_entity( archetype* p_archetype );
+      void move_entity( entity e, archetype* p_target );
+
+      /**
+       * @return The storage of the component, and whether it is new and
+       * uninitialized, or holds the component the entity already had.
+       */
+      std::pair<void*, bool> add_component( entity e, component_info const& info );
+      void remove_component( entity e, component_id id );
+
+      [[nodiscard]]
+      void* find_component(
+         entity e,
+         component_id id
+      ) const noexcept PURE;
+
+      void check_structural_change( ) const;
+
+   private:
+      std::vector<std::unique_ptr<archetype>> archetypes;
+      std::map<std::vector<component_id>, archetype*> archetype_lookup;
+      std::unordered_map<std::uint64_t, archetype*> signature_lookup;
+      archetype* p_empty_archetype = nullptr;
+
+      std::vector<entity_record> records;
+      std::vector<std::uint32_t> free_indices;
+      std::uint32_t entity_count = 0;
+
+      std::unordered_map<std::uint64_t, query_cache> query_caches;
+
+      std::uint32_t iteration_depth = 0;
+   }; // class world
+} // namespace sys
+
+#endif // LUCIOLE_SYS_WORLD_HPP
@@ -20,24 +20,172 @@
 #define LUCIOLE_THREAD_POOL_HPP
 
 /* INCLUDES */
+#include <luciole/luciole_core.hpp>
 #include <luciole/utils/delegate.hpp>
 #include <luciole/utils/strong_types.hpp>
 
-#include <vector>
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
+#include <type_traits>
+#include <vector>
 
+/**
+ * @brief A pool of worker threads, each with its own task queue.
+ * Idle workers steal tasks from the other queues.
+ */
 class thread_pool
 {
 public:
    using task = delegate<void( )>;
 
 public:
-   thread_pool( ) = default;
+   explicit thread_pool( std::uint32_t thread_count = std::max( std::thread::hardware_concurrency( ), 1u ) );
+   thread_pool( thread_pool const& rhs ) = delete;
+   thread_pool( thread_pool&& rhs ) = delete;
+   ~thread_pool( );
+
+   thread_pool& operator=( thread_pool const& rhs ) = delete;
+   thread_pool& operator=( thread_pool&& rhs ) = delete;
+
+   /**
+    * @brief Queue a task. Tasks added from a worker thread go to
+    * that worker's queue, others are spread across the queues.
+    *
+    * @param [in] t The task to run.
+    */
+   void add_task( task const& t );
+
+   /**
+    * @brief Queue a callable and get a future to its result.
+    */
+   template<typename F>
+   [[nodiscard]]
+   std::future<std::invoke_result_t<std::decay_t<F>>> submit( F&& f )
+   {
+      using result_type = std::invoke_result_t<std::decay_t<F>>;
+
+      auto p_task = std::make_shared<std::packaged_task<result_type( )>>( std::forward<F>( f ) );
+      auto future = p_task->get_future( );
+
+      add_task( [p_task] { ( *p_task )( ); } );
+
+      return future;
+   }
+
+   /**
+    * @brief Run a function on every index of [begin, end) in chunks
+    * of grain_size indices and wait for all of them. The calling
+    * thread takes part in the work.
+    *
+    * @param [in] f A callable taking the index to process.
+    */
+   template<typename F>
+   void parallel_for( std::size_t begin, std::size_t end, std::size_t grain_size, F const& f )
+   {
+      if ( begin >= end )
+      {
+         return;
+      }
+
+      grain_size = std::max<std::size_t>( grain_size, 1 );
+      std::size_t const chunk_count = ( end - begin + grain_size - 1 ) / grain_size;
+
+      std::atomic<std::size_t> remaining = chunk_count;
+      for( std::size_t chunk = 0; chunk < chunk_count; ++chunk )
+      {
+         std::size_t const first = begin + chunk * grain_size;
+         std::size_t const last = std::min( first + grain_size, end );
+
+         add_task( [&f, &remaining, first, last] 
+         {
+            for( std::size_t i = first; i < last; ++i )
+            {
+               f( i );
+            }
+
+            remaining.fetch_sub( 1, std::memory_order_release );
+         } );
+      }
+
+      run_until( [&remaining] { return remaining.load( std::memory_order_acquire ) == 0; } );
+   }
+
+   /**
+    * @brief Run queued tasks on the calling thread until a condition 
+    * holds, yielding when there is nothing to run.
+    *
+    * @param [in] is_done A callable returning whether to stop. 
+    */
+   template<typename P>
+   void run_until( P const& is_done )
+   {
+      while( !is_done( ) )
+      {
+         if ( !run_pending_task( ) )
+         {
+            std::this_thread::yield( );
+         }
+      }
+   }
+
+   /**
+    * @brief Block until every queued task is done.
+    */
+   void wait_idle( );
+
+   [[nodiscard]]
+   std::uint32_t get_thread_count(
+   ) const noexcept PURE;
+
+   /**
+    * @return The index of the calling thread in the pool, or nothing if
+    * it is not one of the pool's workers.
+    */
+   [[nodiscard]]
+   std::optional<std::uint32_t> get_worker_index(
+   ) const noexcept PURE;
 
 private:
-   std::vector<std::queue<task>> task_queues_;
+   struct alignas( cache_line ) task_queue
+   {
+      std::mutex mutex;
+      std::deque<task> tasks;
+   }; // struct task_queue
+
+   /**
+    * @brief Pop a task from a worker's own queue, or steal one from
+    * the other queues.
+    */
+   bool try_pop( std::size_t index, task& t );
+
+   /**
+    * @brief Run one queued task on the calling thread.
+    *
+    * @return Whether a task was run.
+    */
+   bool run_pending_task( );
+
+   void work( std::size_t index );
+
+private:
+   std::vector<std::unique_ptr<task_queue>> task_queues_;
    std::vector<std::thread> threads_; 
+
+   std::mutex wake_mutex_;
+   std::condition_variable wake_condition_;
+   std::condition_variable idle_condition_;
+
+   std::atomic<std::size_t> pending_count_ = 0;
+   std::atomic<std::size_t> next_queue_ = 0;
+   std::atomic<bool> is_running_ = true;
 };
 
 #endif // LUCIOLE_THREAD_POOL_HPP
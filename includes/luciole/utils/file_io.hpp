@@ -19,6 +19,7 @@
 #ifndef LUCIOLE_UTILITIES_FILE_IO_H
 #define LUCIOLE_UTILITIES_FILE_IO_H
 
+#include <cstddef>
 #include <string_view>
 #include <fstream>
 #include <vector>
@@ -71,5 +72,39 @@ inline void write_to_file( const std::string& filepath, const std::string& data
    file << data;
 }
 
+/**
+ * @brief A read only view of a whole file mapped into memory. Pages
+ * are loaded by the OS on first access, so nothing is read until the
+ * data is used.
+ */
+class mapped_file
+{
+public:
+   mapped_file( ) = default;
+   explicit mapped_file( std::string const& filepath );
+   mapped_file( mapped_file const& rhs ) = delete;
+   mapped_file( mapped_file&& rhs ) noexcept;
+   ~mapped_file( );
+
+   mapped_file& operator=( mapped_file const& rhs ) = delete;
+   mapped_file& operator=( mapped_file&& rhs ) noexcept;
+
+   std::byte const* data( ) const noexcept { return p_data; }
+   std::size_t size( ) const noexcept { return data_size; }
+
+   bool is_open( ) const noexcept { return p_data != nullptr; }
+
+private:
+   void close( ) noexcept;
+
+private:
+   std::byte const* p_data = nullptr;
+   std::size_t data_size = 0;
+
+#if defined( _WIN32 )
+   void* file_handle = nullptr;
+   void* mapping_handle = nullptr;
+#endif
+};
 
 #endif //BAZAAR_UTILITIES_FILE_IO_HPP
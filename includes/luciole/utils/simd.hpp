@@ -0,0 +1,156 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_UTILS_SIMD_HPP
+#define LUCIOLE_UTILS_SIMD_HPP
+
+/* INCLUDES */
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#  include <emmintrin.h>
+#  define LUCIOLE_SIMD_SSE2
+#endif
+
+#if defined( __AVX2__ )
+#  include <immintrin.h>
+#  define LUCIOLE_SIMD_AVX2
+#endif
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Thin wrappers over the float vectors of each instruction set, so that
+ * a kernel can be written once as a template and instantiated for every
+ * width the build supports. Which ones exist is decided at compile time 
+ * by LUCIOLE_SIMD_SSE2 and LUCIOLE_SIMD_AVX2.
+ */
+namespace simd
+{
+   struct scalar_ops
+   {
+      using type = float;
+      using mask = bool;
+      static constexpr std::uint32_t width = 1;
+
+      static type load( float const* p ) noexcept { return *p; }
+      static void store( float* p, type v ) noexcept { *p = v; }
+      static type set1( float v ) noexcept { return v; }
+
+      static type add( type a, type b ) noexcept { return a + b; }
+      static type sub( type a, type b ) noexcept { return a - b; }
+      static type mul( type a, type b ) noexcept { return a * b; }
+      static type mul_add( type a, type b, type c ) noexcept { return a * b + c; }
+      static type min( type a, type b ) noexcept { return a < b ? a : b; }
+      static type max( type a, type b ) noexcept { return a < b ? b : a; }
+      static type abs( type a ) noexcept { return std::fabs( a ); }
+
+      static type gather( float const* p_base, std::uint32_t const* p_index ) noexcept
+      {
+         return p_base[*p_index];
+      }
+
+      static mask less( type a, type b ) noexcept { return a < b; }
+      static mask mask_or( mask a, mask b ) noexcept { return a || b; }
+      static mask mask_and( mask a, mask b ) noexcept { return a && b; }
+
+      /**
+       * @return The lanes of a where the mask is set, of b elsewhere.
+       */
+      static type select( mask m, type a, type b ) noexcept { return m ? a : b; }
+
+      /**
+       * @return One bit per lane, lane 0 in the lowest bit.
+       */
+      static std::uint32_t get_bits( mask m ) noexcept { return m ? 1u : 0u; }
+   }; // struct scalar_ops
+
+#if defined( LUCIOLE_SIMD_SSE2 )
+   struct sse2_ops
+   {
+      using type = __m128;
+      using mask = __m128;
+      static constexpr std::uint32_t width = 4;
+
+      static type load( float const* p ) noexcept { return _mm_loadu_ps( p ); }
+      static void store( float* p, type v ) noexcept { _mm_storeu_ps( p, v ); }
+      static type set1( float v ) noexcept { return _mm_set1_ps( v ); }
+
+      static type add( type a, type b ) noexcept { return _mm_add_ps( a, b ); }
+      static type sub( type a, type b ) noexcept { return _mm_sub_ps( a, b ); }
+      static type mul( type a, type b ) noexcept { return _mm_mul_ps( a, b ); }
+      static type mul_add( type a, type b, type c ) noexcept { return _mm_add_ps( _mm_mul_ps( a, b ), c ); }
+      static type min( type a, type b ) noexcept { return _mm_min_ps( a, b ); }
+      static type max( type a, type b ) noexcept { return _mm_max_ps( a, b ); }
+      static type abs( type a ) noexcept { return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+
+      static type gather( float const* p_base, std::uint32_t const* p_index ) noexcept
+      {
+         return _mm_set_ps( p_base[p_index[3]], p_base[p_index[2]], p_base[p_index[1]], p_base[p_index[0]] );
+      }
+
+      static mask less( type a, type b ) noexcept { return _mm_cmplt_ps( a, b ); }
+      static mask mask_or( mask a, mask b ) noexcept { return _mm_or_ps( a, b ); }
+      static mask mask_and( mask a, mask b ) noexcept { return _mm_and_ps( a, b ); }
+      static type select( mask m, type a, type b ) noexcept { return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) ); }
+      static std::uint32_t get_bits( mask m ) noexcept { return static_cast<std::uint32_t>( _mm_movemask_ps( m ) ); }
+   }; // struct sse2_ops
+#endif
+
+#if defined( LUCIOLE_SIMD_AVX2 )
+   struct avx2_ops
+   {
+      using type = __m256;
+      using mask = __m256;
+      static constexpr std::uint32_t width = 8;
+
+      static type load( float const* p ) noexcept { return _mm256_loadu_ps( p ); }
+      static void store( float* p, type v ) noexcept { _mm256_storeu_ps( p, v ); }
+      static type set1( float v ) noexcept { return _mm256_set1_ps( v ); }
+
+      static type add( type a, type b ) noexcept { return _mm256_add_ps( a, b ); }
+      static type sub( type a, type b ) noexcept { return _mm256_sub_ps( a, b ); }
+      static type mul( type a, type b ) noexcept { return _mm256_mul_ps( a, b ); }
+
+      static type mul_add( type a, type b, type c ) noexcept 
+      { 
+#if defined( __FMA__ )
+         return _mm256_fmadd_ps( a, b, c ); 
+#else
+         return _mm256_add_ps( _mm256_mul_ps( a, b ), c );
+#endif
+      }
+
+      static type min( type a, type b ) noexcept { return _mm256_min_ps( a, b ); }
+      static type max( type a, type b ) noexcept { return _mm256_max_ps( a, b ); }
+      static type abs( type a ) noexcept { return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), a ); }
+
+      static type gather( float const* p_base, std::uint32_t const* p_index ) noexcept
+      {
+         return _mm256_i32gather_ps( p_base, _mm256_loadu_si256( reinterpret_cast<__m256i const*>( p_index ) ), 4 );
+      }
+
+      static mask less( type a, type b ) noexcept { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+      static mask mask_or( mask a, mask b ) noexcept { return _mm256_or_ps( a, b ); }
+      static mask mask_and( mask a, mask b ) noexcept { return _mm256_and_ps( a, b ); }
+      static type select( mask m, type a, type b ) noexcept { return _mm256_blendv_ps( b, a, m ); }
+      static std::uint32_t get_bits( mask m ) noexcept { return static_cast<std::uint32_t>( _mm256_movemask_ps( m ) ); }
+   }; // struct avx2_ops
+#endif
+} // namespace simd
+
+#endif // LUCIOLE_UTILS_SIMD_HPP
@@ -17,8 +17,12 @@
  */
 
 #include <luciole/context.hpp>
+#include <luciole/vk/buffers/queue_ownership.hpp>
 #include <luciole/vk/core.hpp>
 
+#include <cstdint>
+#include <vector>
+
 namespace vk
 {
    class index_buffer
@@ -28,7 +32,10 @@ namespace vk
       {
          context const* p_context = nullptr;
 
-         std::vector<std::uint32_t> family_indices = {};
+         /**
+          * @brief The indices are stored on 16 bits when they all
+          * fit, on 32 bits otherwise.
+          */
          std::vector<std::uint32_t> indices = {};
       }; // struct create_info
 
@@ -53,9 +60,33 @@ namespace vk
       VkBuffer get_buffer(
       ) const PURE;
 
+      /**
+       * @brief Get the queue owning the buffer.
+       */
+      [[nodiscard]]
+      queue_ownership get_ownership(
+      ) const PURE;
+
+      /**
+       * @brief Get the type the indices are stored with.
+       */
+      [[nodiscard]]
+      VkIndexType get_index_type(
+      ) const PURE;
+
+      /**
+       * @brief Get the number of indices in the buffer.
+       */
+      [[nodiscard]]
+      std::uint32_t get_index_count(
+      ) const PURE;
+
    private:
-      VmaAllocator memory_allocator = VK_NULL_HANDLE;
-      VmaAllocation allocation = VK_NULL_HANDLE;
-      VkBuffer buffer = VK_NULL_HANDLE;
+      context const* p_context = nullptr;
+      buffer_allocation buffer;
+      queue_ownership ownership;
+
+      VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+      std::uint32_t index_count = 0;
    }; // class index_buffer
 } // namespace vk
@@ -0,0 +1,292 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_VK_BUFFERS_QUEUE_OWNERSHIP_HPP
+#define LUCIOLE_VK_BUFFERS_QUEUE_OWNERSHIP_HPP
+
+/* INCLUDES */
+#include <luciole/context.hpp>
+#include <luciole/vk/core.hpp>
+#include <luciole/vk/errors.hpp>
+#include <luciole/vk/memory_stats.hpp>
+#include <luciole/vk/queue.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+namespace vk
+{
+   /**
+    * @brief The queue family owning a resource created with
+    * VK_SHARING_MODE_EXCLUSIVE.
+    */
+   struct queue_ownership
+   {
+      queue::flag owner = queue::flag::e_none;
+      std::uint32_t family_index = VK_QUEUE_FAMILY_IGNORED;
+
+      /**
+       * @brief The number of release/acquire pairs the resource
+       * went through.
+       */
+      std::uint32_t transfer_count = 0;
+   }; // struct queue_ownership
+
+   /**
+    * @brief The information required to move a buffer from one
+    * queue to another.
+    */
+   struct ownership_transfer_info
+   {
+      context const* p_context = nullptr;
+
+      buffer_allocation const* p_buffer = nullptr;
+      queue_ownership ownership = { };
+
+      queue::flag dst_queue = queue::flag::e_graphics;
+
+      /**
+       * @brief The stage and access of the last use of the buffer on
+       * the source queue.
+       */
+      VkPipelineStageFlags src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+      VkAccessFlags src_access = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+      /**
+       * @brief The stage and access of the first use of the buffer on
+       * the destination queue.
+       */
+      VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+      VkAccessFlags dst_access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+   }; // struct ownership_transfer_info
+
+   using ownership_transfer_info_t = strong_type<ownership_transfer_info const&>;
+
+   /**
+    * @brief The information required to fill a device local buffer
+    * through a staging buffer.
+    */
+   struct staging_upload_info
+   {
+      context const* p_context = nullptr;
+
+      buffer_allocation const* p_buffer = nullptr;
+
+      void const* p_data = nullptr;
+      VkDeviceSize size = 0;
+
+      /**
+       * @brief The queue that will use the buffer once it is filled.
+       */
+      queue::flag dst_queue = queue::flag::e_graphics;
+      VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+      VkAccessFlags dst_access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+   }; // struct staging_upload_info
+
+   using staging_upload_info_t = strong_type<staging_upload_info const&>;
+
+   /**
+    * @brief A region of a staging buffer to copy into a buffer.
+    */
+   struct staging_copy
+   {
+      buffer_allocation const* p_dst = nullptr;
+
+      VkDeviceSize src_offset = 0;
+      VkDeviceSize dst_offset = 0;
+      VkDeviceSize size = 0;
+   }; // struct staging_copy
+
+   /**
+    * @brief The information required to copy many regions of a staging
+    * buffer into device local buffers with a single submission.
+    */
+   struct batch_upload_info
+   {
+      context const* p_context = nullptr;
+
+      VkBuffer staging_buffer = VK_NULL_HANDLE;
+      std::vector<staging_copy> copies;
+
+      queue::flag dst_queue = queue::flag::e_graphics;
+      VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+      VkAccessFlags dst_access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+   }; // struct batch_upload_info
+
+   using batch_upload_info_t = strong_type<batch_upload_info const&>;
+
+   /**
+    * @brief One time command buffers submitted with a fence, whose 
+    * completion is polled instead of waited on. When the submission
+    * moves resources to another queue family, the acquire command buffer
+    * waits on the release one through the semaphore.
+    */
+   struct pending_submission
+   {
+      VkFence fence = VK_NULL_HANDLE;
+      VkSemaphore semaphore = VK_NULL_HANDLE;
+
+      queue::flag src_queue = queue::flag::e_none;
+      VkCommandBuffer src_cmd_buffer = VK_NULL_HANDLE;
+
+      queue::flag dst_queue = queue::flag::e_none;
+      VkCommandBuffer dst_cmd_buffer = VK_NULL_HANDLE;
+   }; // struct pending_submission
+
+   /**
+    * @brief Allocate a command buffer on a queue and begin recording
+    * it for a single submission.
+    */
+   [[nodiscard]]
+   std::variant<VkCommandBuffer, error> begin_one_time_commands(
+      context const* p_context,
+      queue::flag flag
+   );
+
+   /**
+    * @brief End, submit and free a command buffer created with
+    * begin_one_time_commands. Blocks until it is done.
+    */
+   [[nodiscard]]
+   error submit_one_time_commands(
+      context const* p_context,
+      queue::flag flag,
+      VkCommandBuffer cmd_buffer
+   );
+
+   /**
+    * @brief End and submit a command buffer created with 
+    * begin_one_time_commands without waiting for it.
+    *
+    * @return Either the submission, to poll with is_submission_done and
+    * free with release_submission, or an error code. The command buffer
+    * is freed on error.
+    */
+   [[nodiscard]]
+   std::variant<pending_submission, error> submit_one_time_commands_async(
+      context const* p_context,
+      queue::flag flag,
+      VkCommandBuffer cmd_buffer
+   );
+
+   /**
+    * @brief Check whether the device is done with a submission. An empty
+    * submission is always done.
+    */
+   [[nodiscard]]
+   bool is_submission_done(
+      context const* p_context,
+      pending_submission const& submission
+   ) noexcept;
+
+   /**
+    * @brief Block until the device is done with a submission.
+    */
+   void wait_for_submission(
+      context const* p_context,
+      pending_submission const& submission
+   ) noexcept;
+
+   /**
+    * @brief Free the fence, semaphore and command buffers of a submission
+    * the device is done with, and leave it empty.
+    */
+   void release_submission(
+      context const* p_context,
+      pending_submission& submission
+   ) noexcept;
+
+   /**
+    * @brief Record the release half of a queue family ownership
+    * transfer. Must be submitted on the queue currently owning
+    * the buffer.
+    */
+   void record_ownership_release(
+      VkCommandBuffer cmd_buffer,
+      ownership_transfer_info const& info,
+      std::uint32_t dst_family_index
+   ) noexcept;
+
+   /**
+    * @brief Record the acquire half of a queue family ownership
+    * transfer. Must be submitted on the destination queue after the
+    * release.
+    */
+   void record_ownership_acquire(
+      VkCommandBuffer cmd_buffer,
+      ownership_transfer_info const& info,
+      std::uint32_t dst_family_index
+   ) noexcept;
+
+   /**
+    * @brief Move the ownership of a buffer to another queue. Nothing
+    * is submitted if both queues belong to the same family.
+    * Blocks until the destination queue acquired the buffer.
+    *
+    * @return Either the new ownership of the buffer or an error code.
+    */
+   [[nodiscard]]
+   std::variant<queue_ownership, error> transfer_ownership(
+      ownership_transfer_info_t const& info
+   );
+
+   /**
+    * @brief Record every copy of a batch in one command buffer on the
+    * transfer queue, then hand all the destination buffers over to
+    * the destination queue. Blocks until the upload is done.
+    *
+    * @return Either the ownership of the destination buffers after
+    * the upload or an error code.
+    */
+   [[nodiscard]]
+   std::variant<queue_ownership, error> upload_batch(
+      batch_upload_info_t const& info
+   );
+
+   /**
+    * @brief Record and submit a batch like upload_batch, without waiting
+    * for it. The staging buffer must be kept alive until the submission
+    * is done, after which the destination buffers are owned by the
+    * destination queue.
+    *
+    * @return Either the submission, to poll with is_submission_done and
+    * free with release_submission, or an error code.
+    */
+   [[nodiscard]]
+   std::variant<pending_submission, error> upload_batch_async(
+      batch_upload_info_t const& info
+   );
+
+   /**
+    * @brief Copy data into a buffer through a temporary staging buffer
+    * on the transfer queue, then hand the buffer over to the
+    * destination queue. Blocks until the upload is done.
+    *
+    * @return Either the ownership of the buffer after the upload
+    * or an error code.
+    */
+   [[nodiscard]]
+   std::variant<queue_ownership, error> upload_through_staging(
+      staging_upload_info_t const& info
+   );
+} // namespace vk
+
+#endif // LUCIOLE_VK_BUFFERS_QUEUE_OWNERSHIP_HPP
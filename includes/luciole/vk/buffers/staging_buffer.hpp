@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_VK_BUFFERS_STAGING_BUFFER_HPP
+#define LUCIOLE_VK_BUFFERS_STAGING_BUFFER_HPP
+
+#include <luciole/context.hpp>
+#include <luciole/vk/core.hpp>
+
+#include <atomic>
+#include <cstddef>
+
+namespace vk
+{
+   /**
+    * @brief A host visible buffer that stays mapped for its whole
+    * lifetime. Ranges are handed out with a lock free bump allocator,
+    * so any thread may write into it while the upload itself is
+    * recorded on the main thread.
+    */
+   class staging_buffer
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+
+         VkDeviceSize size = 0;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+      /**
+       * @brief Returned by allocate when the buffer is full.
+       */
+      static constexpr VkDeviceSize invalid_offset = ~VkDeviceSize( 0 );
+
+   public:
+      staging_buffer( ) = default;
+      staging_buffer( create_info_t const& create_info );
+      staging_buffer( staging_buffer const& rhs ) = delete;
+      staging_buffer( staging_buffer&& rhs );
+      ~staging_buffer( );
+
+      staging_buffer& operator=( staging_buffer const& rhs ) = delete;
+      staging_buffer& operator=( staging_buffer&& rhs );
+
+      /**
+       * @brief Reserve a range of the buffer. Thread safe.
+       *
+       * @param [in] size The size of the range in bytes.
+       * @param [in] alignment The alignment of the range, a power of two.
+       *
+       * @return The offset of the range, or invalid_offset if there
+       * is not enough space left.
+       */
+      [[nodiscard]]
+      VkDeviceSize allocate( VkDeviceSize size, VkDeviceSize alignment = 16 ) noexcept;
+
+      /**
+       * @brief Forget every range handed out so far.
+       */
+      void reset( ) noexcept;
+
+      /**
+       * @brief Get a pointer to the mapped memory at an offset.
+       */
+      [[nodiscard]]
+      std::byte* data(
+         VkDeviceSize offset = 0
+      ) const PURE;
+
+      [[nodiscard]]
+      VkBuffer get_buffer(
+      ) const PURE;
+
+      [[nodiscard]]
+      VkDeviceSize get_size(
+      ) const PURE;
+
+      /**
+       * @brief Get the number of bytes handed out so far.
+       */
+      [[nodiscard]]
+      VkDeviceSize get_used_size(
+      ) const noexcept;
+
+   private:
+      context const* p_context = nullptr;
+      buffer_allocation buffer;
+
+      std::byte* p_mapped_data = nullptr;
+      std::atomic<VkDeviceSize> used_size = 0;
+   }; // class staging_buffer
+} // namespace vk
+
+#endif // LUCIOLE_VK_BUFFERS_STAGING_BUFFER_HPP
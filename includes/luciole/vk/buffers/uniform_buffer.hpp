@@ -39,20 +39,27 @@ namespace vk
       uniform_buffer& operator=( uniform_buffer const& rhs ) = delete;
       uniform_buffer& operator=( uniform_buffer&& rhs );
 
+      [[nodiscard]]
+      inline VkBuffer get_buffer(
+      ) const PURE
+      {
+         return buffer.handle;
+      }
+
       template<typename T>
       void map_data( T const& data )
       {
          void* local_data;
 
-         vmaMapMemory( memory_allocator, allocation, &local_data );
+         vmaMapMemory( memory_allocator, buffer.allocation, &local_data );
          memcpy( local_data, &data, sizeof( data ) );
-         vmaUnmapMemory( memory_allocator, allocation );
+         vmaUnmapMemory( memory_allocator, buffer.allocation );
       }
 
    private:
+      context const* p_context = nullptr;
       VmaAllocator memory_allocator = VK_NULL_HANDLE;
-      VmaAllocation allocation = VK_NULL_HANDLE;
-      VkBuffer buffer = VK_NULL_HANDLE;
+      buffer_allocation buffer;
    }; // class uniform_buffer
 } // namespace vk
 
@@ -21,11 +21,15 @@
 
 #include <luciole/context.hpp>
 #include <luciole/graphics/vertex.hpp>
+#include <luciole/vk/buffers/queue_ownership.hpp>
 #include <luciole/utils/strong_types.hpp>
 #include <luciole/vk/queue.hpp>
 
 #include <vulkan/vulkan.h>
 
+#include <cstddef>
+#include <vector>
+
 namespace vk
 {
    /**
@@ -39,10 +43,10 @@ namespace vk
       {
          context const* p_context = nullptr;
 
-         VmaAllocator memory_allocator = VK_NULL_HANDLE;
-
-         std::vector<std::uint32_t> family_indices = {};
-         std::vector<vertex> vertices = {};
+         /**
+          * @brief The encoded vertex data, see gfx::vertex_layout.
+          */
+         std::vector<std::byte> vertices = {};
       }; // struct create_info
       
       using create_info_t = strong_type<create_info const&>;
@@ -61,13 +65,23 @@ namespace vk
       inline VkBuffer get_buffer(
       ) const PURE
       {
-         return buffer;
+         return buffer.handle;
+      }
+
+      /**
+       * @brief Get the queue owning the buffer.
+       */
+      [[nodiscard]]
+      inline queue_ownership get_ownership(
+      ) const PURE
+      {
+         return ownership;
       }
 
    private: 
-      VmaAllocator memory_allocator = VK_NULL_HANDLE;
-      VmaAllocation allocation = VK_NULL_HANDLE;
-      VkBuffer buffer = VK_NULL_HANDLE;
+      context const* p_context = nullptr;
+      buffer_allocation buffer;
+      queue_ownership ownership;
    }; // class vertex_buffer
 } // namespace vk
 
@@ -71,6 +71,11 @@ namespace vk
     using fence_t = strong_type<VkFence, default_param>;
     using fence_create_info_t = strong_type<VkFenceCreateInfo const&, default_param>;
     using result_t = strong_type<VkResult, default_param>;
+    using buffer_create_info_t = strong_type<VkBufferCreateInfo const&, default_param>;
+    using allocation_create_info_t = strong_type<VmaAllocationCreateInfo const&, default_param>;
+    using image_create_info_t = strong_type<VkImageCreateInfo const&, default_param>;
+    using sampler_t = strong_type<VkSampler, default_param>;
+    using sampler_create_info_t = strong_type<VkSamplerCreateInfo const&, default_param>;
 }
 
 #endif // LUCIOLE_VULKAN_CORE_HPP
@@ -0,0 +1,207 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_VK_HOST_ALLOCATOR_HPP
+#define LUCIOLE_VK_HOST_ALLOCATOR_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/vk/core.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace vk
+{
+   /**
+    * @brief Implementation of the VkAllocationCallbacks used by the
+    * context. Every host allocation made by the driver is routed through
+    * size-class pools cached per thread and accounted for by
+    * VkSystemAllocationScope and by the type of the object it was made for.
+    */
+   class host_allocator
+   {
+   public:
+      /**
+       * @brief The type of object a set of callbacks is given to.
+       */
+      enum class object_type : std::size_t
+      {
+         e_instance,
+         e_debug_messenger,
+         e_device,
+         e_swapchain,
+         e_image_view,
+         e_render_pass,
+         e_descriptor_pool,
+         e_pipeline_layout,
+         e_descriptor_set_layout,
+         e_pipeline,
+         e_shader_module,
+         e_framebuffer,
+         e_semaphore,
+         e_fence,
+         e_command_pool,
+         e_memory_allocator,
+         e_sampler,
+         e_count
+      }; // enum class object_type
+
+      static constexpr std::size_t scope_count = 5;
+      static constexpr std::size_t object_type_count = static_cast<std::size_t>( object_type::e_count );
+
+      /**
+       * @brief Memory usage of a single scope or object type.
+       */
+      struct usage
+      {
+         std::uint64_t live_bytes = 0;
+         std::uint64_t peak_bytes = 0;
+         std::uint64_t internal_bytes = 0;
+         std::uint64_t allocation_count = 0;
+         std::uint64_t free_count = 0;
+
+         /**
+          * @brief The number of allocations per second since the
+          * previous report.
+          */
+         double allocation_rate = 0.0;
+      }; // struct usage
+
+      /**
+       * @brief A snapshot of the host memory usage.
+       */
+      struct report
+      {
+         std::array<usage, scope_count> scopes = { };
+         std::array<usage, object_type_count> objects = { };
+         usage total = { };
+
+         std::uint64_t pooled_bytes = 0;
+      }; // struct report
+
+   public:
+      host_allocator( );
+      host_allocator( host_allocator const& rhs ) = delete;
+      host_allocator( host_allocator&& rhs ) = delete;
+      ~host_allocator( ) = default;
+
+      host_allocator& operator=( host_allocator const& rhs ) = delete;
+      host_allocator& operator=( host_allocator&& rhs ) = delete;
+
+      /**
+       * @brief Get the allocation callbacks to give to the creation
+       * and destruction of an object of a certain type. The same callbacks
+       * must be used for both.
+       *
+       * @param [in] type The type of the object.
+       *
+       * @return The allocation callbacks tagged with the object type.
+       */
+      [[nodiscard]]
+      VkAllocationCallbacks const* get_callbacks(
+         object_type type
+      ) const noexcept PURE;
+
+      /**
+       * @brief Take a snapshot of the memory usage. The allocation rates
+       * are computed from the previous call to this function.
+       *
+       * @return The current memory usage.
+       */
+      [[nodiscard]]
+      report get_report( ) const;
+
+      /**
+       * @brief Get the name of an object type.
+       */
+      [[nodiscard]]
+      static std::string const& to_string(
+         object_type type
+      ) PURE;
+
+      /**
+       * @brief Get the name of a VkSystemAllocationScope.
+       */
+      [[nodiscard]]
+      static std::string const& to_string(
+         VkSystemAllocationScope scope
+      ) PURE;
+
+   private:
+      struct counter
+      {
+         std::atomic<std::uint64_t> live_bytes = 0;
+         std::atomic<std::uint64_t> peak_bytes = 0;
+         std::atomic<std::uint64_t> internal_bytes = 0;
+         std::atomic<std::uint64_t> allocation_count = 0;
+         std::atomic<std::uint64_t> free_count = 0;
+
+         void on_allocate( std::uint64_t size ) noexcept;
+         void on_free( std::uint64_t size ) noexcept;
+      }; // struct counter
+
+      struct tag
+      {
+         host_allocator* p_allocator = nullptr;
+         object_type type = object_type::e_count;
+      }; // struct tag
+
+      static VKAPI_ATTR void* VKAPI_CALL allocation_callback(
+         void* p_user_data, std::size_t size, std::size_t alignment,
+         VkSystemAllocationScope scope );
+
+      static VKAPI_ATTR void* VKAPI_CALL reallocation_callback(
+         void* p_user_data, void* p_original, std::size_t size, std::size_t alignment,
+         VkSystemAllocationScope scope );
+
+      static VKAPI_ATTR void VKAPI_CALL free_callback(
+         void* p_user_data, void* p_memory );
+
+      static VKAPI_ATTR void VKAPI_CALL internal_allocation_callback(
+         void* p_user_data, std::size_t size, VkInternalAllocationType type,
+         VkSystemAllocationScope scope );
+
+      static VKAPI_ATTR void VKAPI_CALL internal_free_callback(
+         void* p_user_data, std::size_t size, VkInternalAllocationType type,
+         VkSystemAllocationScope scope );
+
+      void* allocate( std::size_t size, std::size_t alignment, VkSystemAllocationScope scope, object_type type );
+      void deallocate( void* p_memory );
+
+   private:
+      std::array<tag, object_type_count> tags;
+      std::array<VkAllocationCallbacks, object_type_count> callbacks;
+
+      std::array<counter, scope_count> scope_counters;
+      std::array<counter, object_type_count> object_counters;
+      counter total_counter;
+
+      mutable std::mutex report_mutex;
+      mutable std::chrono::steady_clock::time_point last_report_time;
+      mutable report last_report;
+   }; // class host_allocator
+} // namespace vk
+
+#endif // LUCIOLE_VK_HOST_ALLOCATOR_HPP
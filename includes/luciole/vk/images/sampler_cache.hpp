@@ -0,0 +1,120 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_VK_IMAGES_SAMPLER_CACHE_HPP
+#define LUCIOLE_VK_IMAGES_SAMPLER_CACHE_HPP
+
+#include <luciole/context.hpp>
+#include <luciole/vk/core.hpp>
+#include <luciole/vk/errors.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <variant>
+
+namespace vk
+{
+   /**
+    * @brief The state of a sampler, used as the key of the sampler
+    * cache. Anisotropic filtering is enabled when max_anisotropy is
+    * above 1.
+    */
+   struct sampler_desc
+   {
+      VkFilter mag_filter = VK_FILTER_LINEAR;
+      VkFilter min_filter = VK_FILTER_LINEAR;
+      VkSamplerMipmapMode mipmap_mode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+
+      VkSamplerAddressMode address_mode_u = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+      VkSamplerAddressMode address_mode_v = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+      VkSamplerAddressMode address_mode_w = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+      float mip_lod_bias = 0.0f;
+      float max_anisotropy = 1.0f;
+      float min_lod = 0.0f;
+      float max_lod = VK_LOD_CLAMP_NONE;
+
+      bool compare_enable = false;
+      VkCompareOp compare_op = VK_COMPARE_OP_NEVER;
+      VkBorderColor border_color = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+
+      bool operator==( sampler_desc const& rhs ) const noexcept;
+   }; // struct sampler_desc
+
+   struct sampler_desc_hash
+   {
+      std::size_t operator( )( sampler_desc const& desc ) const noexcept;
+   }; // struct sampler_desc_hash
+
+   /**
+    * @brief Creates samplers on demand and hands out the same
+    * sampler for every request with the same state. Thread safe.
+    */
+   class sampler_cache
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      sampler_cache( ) = default;
+      sampler_cache( create_info_t const& create_info );
+      sampler_cache( sampler_cache const& rhs ) = delete;
+      sampler_cache( sampler_cache&& rhs );
+      ~sampler_cache( );
+
+      sampler_cache& operator=( sampler_cache const& rhs ) = delete;
+      sampler_cache& operator=( sampler_cache&& rhs );
+
+      /**
+       * @brief Get the sampler matching a state, creating it if it
+       * does not exist yet.
+       *
+       * @param [in] desc The state of the sampler.
+       *
+       * @return Either the sampler, owned by the cache, or an error code.
+       */
+      [[nodiscard]]
+      std::variant<VkSampler, error> get_sampler(
+         sampler_desc const& desc
+      );
+
+      /**
+       * @brief Get the number of distinct samplers created.
+       */
+      [[nodiscard]]
+      std::size_t get_sampler_count(
+      ) const;
+
+   private:
+      void destroy_samplers( ) noexcept;
+
+   private:
+      context const* p_context = nullptr;
+
+      mutable std::mutex mutex;
+      std::unordered_map<sampler_desc, VkSampler, sampler_desc_hash> samplers;
+   }; // class sampler_cache
+} // namespace vk
+
+#endif // LUCIOLE_VK_IMAGES_SAMPLER_CACHE_HPP
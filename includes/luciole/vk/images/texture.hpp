@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_VK_IMAGES_TEXTURE_HPP
+#define LUCIOLE_VK_IMAGES_TEXTURE_HPP
+
+#include <luciole/context.hpp>
+#include <luciole/vk/core.hpp>
+#include <luciole/vk/memory_stats.hpp>
+
+#include <cstdint>
+
+namespace vk
+{
+   /**
+    * @brief Get the number of levels of a full mip chain, down to 1x1.
+    */
+   [[nodiscard]]
+   constexpr std::uint32_t get_mip_level_count( std::uint32_t width, std::uint32_t height ) noexcept
+   {
+      std::uint32_t levels = 1;
+      for( auto size = width > height ? width : height; size > 1; size /= 2 )
+      {
+         ++levels;
+      }
+
+      return levels;
+   }
+
+   /**
+    * @brief A device local 2D image with a view over all of its mip
+    * levels.
+    */
+   class texture
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+
+         VkExtent2D extent = { 0, 0 };
+         VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+         std::uint32_t mip_levels = 1;
+
+         VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+         /**
+          * @brief The aspect covered by the view, depth for depth buffers.
+          */
+         VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      texture( ) = default;
+      texture( create_info_t const& create_info );
+      texture( texture const& rhs ) = delete;
+      texture( texture&& rhs );
+      ~texture( );
+
+      texture& operator=( texture const& rhs ) = delete;
+      texture& operator=( texture&& rhs );
+
+      [[nodiscard]]
+      VkImage get_image(
+      ) const PURE;
+
+      [[nodiscard]]
+      VkImageView get_image_view(
+      ) const PURE;
+
+      [[nodiscard]]
+      VkFormat get_format(
+      ) const PURE;
+
+      [[nodiscard]]
+      VkExtent2D get_extent(
+      ) const PURE;
+
+      [[nodiscard]]
+      std::uint32_t get_mip_levels(
+      ) const PURE;
+
+   private:
+      context const* p_context = nullptr;
+
+      image_allocation image;
+      VkImageView image_view = VK_NULL_HANDLE;
+
+      VkFormat format = VK_FORMAT_UNDEFINED;
+      VkExtent2D extent = { 0, 0 };
+      std::uint32_t mip_levels = 0;
+   }; // class texture
+} // namespace vk
+
+#endif // LUCIOLE_VK_IMAGES_TEXTURE_HPP
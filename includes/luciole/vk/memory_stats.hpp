@@ -0,0 +1,188 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_VK_MEMORY_STATS_HPP
+#define LUCIOLE_VK_MEMORY_STATS_HPP
+
+/* INCLUDES */
+#include <luciole/luciole_core.hpp>
+#include <luciole/vk/core.hpp>
+
+#include <nlohmann/json.hpp>
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vk
+{
+   /**
+    * @brief The kind of resource a device allocation is made for.
+    */
+   enum class memory_category : std::size_t
+   {
+      e_vertex_buffer,
+      e_index_buffer,
+      e_uniform_buffer,
+      e_staging_buffer,
+      e_image,
+      e_other,
+      e_count
+   }; // enum class memory_category
+
+   static constexpr std::size_t memory_category_count = static_cast<std::size_t>( memory_category::e_count );
+
+   /**
+    * @brief A buffer and the memory bound to it.
+    */
+   struct buffer_allocation
+   {
+      VkBuffer handle = VK_NULL_HANDLE;
+      VmaAllocation allocation = VK_NULL_HANDLE;
+
+      memory_category category = memory_category::e_other;
+      VkDeviceSize size = 0;
+
+      /**
+       * @brief The size of the memory VMA gave the buffer, with the 
+       * padding of its alignment.
+       */
+      VkDeviceSize reserved_size = 0;
+   }; // struct buffer_allocation
+
+   /**
+    * @brief An image and the memory bound to it.
+    */
+   struct image_allocation
+   {
+      VkImage handle = VK_NULL_HANDLE;
+      VmaAllocation allocation = VK_NULL_HANDLE;
+
+      memory_category category = memory_category::e_image;
+      VkDeviceSize size = 0;
+   }; // struct image_allocation
+
+   /**
+    * @brief Statistics on the device memory managed by VMA.
+    */
+   struct memory_stats
+   {
+      struct heap
+      {
+         std::uint32_t index = 0;
+         bool is_device_local = false;
+
+         VkDeviceSize heap_size = 0;
+
+         std::uint32_t block_count = 0;
+         std::uint32_t allocation_count = 0;
+
+         /**
+          * @brief Bytes handed out to allocations.
+          */
+         VkDeviceSize used_bytes = 0;
+         /**
+          * @brief Bytes of VkDeviceMemory held by the allocator, used or not.
+          */
+         VkDeviceSize reserved_bytes = 0;
+
+         /**
+          * @brief 0 when all the free space of the heap is contiguous,
+          * close to 1 when it is split into many small ranges.
+          */
+         double fragmentation = 0.0;
+      }; // struct heap
+
+      struct category
+      {
+         std::uint64_t allocation_count = 0;
+
+         /**
+          * @brief Bytes asked for by the resources.
+          */
+         std::uint64_t used_bytes = 0;
+         /**
+          * @brief Bytes VMA gave the resources, which grows past the used
+          * bytes with the padding of their alignment.
+          */
+         std::uint64_t reserved_bytes = 0;
+         std::uint64_t peak_bytes = 0;
+      }; // struct category
+
+      std::vector<heap> heaps;
+      std::array<category, memory_category_count> categories = { };
+
+      heap total;
+   }; // struct memory_stats
+
+   /**
+    * @brief Thread safe counters of the device memory used by each
+    * memory_category.
+    */
+   class memory_tracker
+   {
+   public:
+      void on_allocate( memory_category category, VkDeviceSize size, VkDeviceSize reserved_size ) noexcept;
+      void on_free( memory_category category, VkDeviceSize size, VkDeviceSize reserved_size ) noexcept;
+
+      [[nodiscard]]
+      std::array<memory_stats::category, memory_category_count> get_categories(
+      ) const noexcept;
+
+   private:
+      struct counter
+      {
+         std::atomic<std::uint64_t> allocation_count = 0;
+         std::atomic<std::uint64_t> used_bytes = 0;
+         std::atomic<std::uint64_t> reserved_bytes = 0;
+         std::atomic<std::uint64_t> peak_bytes = 0;
+      }; // struct counter
+
+      std::array<counter, memory_category_count> counters;
+   }; // class memory_tracker
+
+   /**
+    * @brief Get the name of a memory category.
+    */
+   [[nodiscard]]
+   std::string const& to_string( memory_category category ) PURE;
+
+   void to_json( nlohmann::json& j, memory_stats::heap const& heap );
+   void to_json( nlohmann::json& j, memory_stats::category const& category );
+   void to_json( nlohmann::json& j, memory_stats const& stats );
+
+   /**
+    * @brief Compare two memory stats dumps.
+    *
+    * @param [in] before The older dump.
+    * @param [in] after The newer dump.
+    *
+    * @return For every heap, category and the total, the difference
+    * of every numerical value between the two dumps.
+    */
+   [[nodiscard]]
+   nlohmann::json diff_memory_stats(
+      nlohmann::json const& before,
+      nlohmann::json const& after
+   );
+} // namespace vk
+
+#endif // LUCIOLE_VK_MEMORY_STATS_HPP
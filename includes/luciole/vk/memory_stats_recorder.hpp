@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUCIOLE_VK_MEMORY_STATS_RECORDER_HPP
+#define LUCIOLE_VK_MEMORY_STATS_RECORDER_HPP
+
+/* INCLUDES */
+#include <luciole/context.hpp>
+#include <luciole/utils/strong_types.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace vk
+{
+   /**
+    * @brief Dump the device memory statistics of a context to
+    * a json file at a fixed interval.
+    */
+   class memory_stats_recorder
+   {
+   public:
+      struct create_info
+      {
+         context const* p_context = nullptr;
+
+         /**
+          * @brief The directory the dumps are written in. Each dump is
+          * named memory_stats_<index>.json.
+          */
+         std::string directory = ".";
+         std::chrono::milliseconds interval = std::chrono::seconds( 10 );
+
+         bool detailed = false;
+      }; // struct create_info
+
+      using create_info_t = strong_type<create_info const&>;
+
+   public:
+      memory_stats_recorder( ) = default;
+      explicit memory_stats_recorder( create_info_t const& create_info );
+
+      /**
+       * @brief Write a dump if the interval has elapsed since the
+       * previous one. Meant to be called once per frame.
+       *
+       * @return Whether a dump was written.
+       */
+      bool update( );
+
+      /**
+       * @brief Write a dump right away.
+       */
+      void record( );
+
+      [[nodiscard]]
+      std::uint32_t get_dump_count(
+      ) const noexcept PURE;
+
+   private:
+      context const* p_context = nullptr;
+
+      std::string directory;
+      std::chrono::milliseconds interval;
+      bool detailed = false;
+
+      std::chrono::steady_clock::time_point last_dump_time;
+      std::uint32_t dump_count = 0;
+   }; // class memory_stats_recorder
+} // namespace vk
+
+#endif // LUCIOLE_VK_MEMORY_STATS_RECORDER_HPP
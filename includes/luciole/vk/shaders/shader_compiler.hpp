@@ -16,6 +16,7 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <luciole/assets/derived_data_cache.hpp>
 #include <luciole/vk/shaders/shader_loader_interface.hpp>
 
 namespace vk
@@ -24,8 +25,18 @@ namespace vk
    {
    public:
       shader_compiler() = default;
+
+      /**
+       * @brief Compile through a derived data cache, so a shader is only
+       * compiled again when its preprocessed source changes.
+       */
+      explicit shader_compiler( assets::derived_data_cache* p_cache );
       virtual ~shader_compiler( ) = default;
 
+      /**
+       * @brief Compile a shader, throwing with the glslang log when it 
+       * fails to preprocess, parse or link.
+       */
       virtual shader_data load_shader( shader::filepath_view_t filepath ) const override;
 
    private:
@@ -34,5 +45,8 @@ namespace vk
 
       EShLanguage get_shader_stage( std::string_view stage ) const;
       shader::type get_shader_type( EShLanguage shader_stage ) const;
+
+   private:
+      assets::derived_data_cache* p_cache = nullptr;
    }; // class shader_compiler
 }
@@ -19,15 +19,18 @@
 #ifndef LUCIOLE_VK_SHADERS_SHADER_MANAGER_HPP
 #define LUCIOLE_VK_SHADERS_SHADER_MANAGER_HPP
 
+#include <luciole/assets/asset_handle.hpp>
 #include <luciole/vk/shaders/shader.hpp>
 #include <luciole/vk/shaders/shader_loader_interface.hpp>
 #include <luciole/context.hpp>
+#include <luciole/threads/thread_pool.hpp>
 
 #include <glslang/Public/ShaderLang.h>
 #include <SPIRV/GlslangToSpv.h>
 #include <StandAlone/DirStackFileIncluder.h>
 
 #include <unordered_map>
+#include <string>
 #include <string_view>
 #include <cstdint>
 
@@ -37,7 +40,7 @@ namespace vk
    {
    public:
       shader_manager( );
-      shader_manager( p_context_t const& p_context );
+      shader_manager( p_context_t const& p_context, thread_pool* p_thread_pool = nullptr );
       shader_manager( shader_manager const& rhs ) = delete;
       shader_manager( shader_manager&& rhs );
       ~shader_manager( );
@@ -46,11 +49,32 @@ namespace vk
       shader_manager& operator=( shader_manager&& rhs );
   
       std::uint32_t load_shader( shader_loader_interface const* loader, shader::filepath_t const& filepath );
+
+      /**
+       * @brief Load a shader without blocking. The SPIR-V is produced by 
+       * the loader on the thread pool, or by update when there is none,
+       * and the shader module is created by update. Requests for a path
+       * already loaded or loading share the same shader, whatever their
+       * loader.
+       */
+      [[nodiscard]]
+      assets::asset_handle<shader> request_shader( 
+         shader_loader_interface const* p_loader, 
+         shader::filepath_t const& filepath 
+      );
+
+      /**
+       * @brief Create the shader modules of the shaders requested through
+       * request_shader that are done loading, and free the ones no handle
+       * refers to anymore.
+       */
+      void update( );
    
    private:
       context const* p_context; 
 
       std::unordered_map<std::uint32_t, shader> shaders;
+      assets::asset_cache<shader, shader_loader_interface::shader_data> shader_cache;
 
       static inline bool GLSLANG_INITIALIZED = false;
       static inline std::uint32_t SHADER_ID_COUNT = 0;
@@ -0,0 +1,598 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/cooked_mesh.hpp>
+#include <luciole/graphics/mesh_optimizer.hpp>
+#include <luciole/graphics/mesh_simplifier.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+namespace assets
+{
+   namespace
+   {
+      template<typename T>
+      void append( std::vector<std::byte>& out, T const* p_data, std::size_t count )
+      {
+         auto const* p_bytes = reinterpret_cast<std::byte const*>( p_data );
+         out.insert( out.end( ), p_bytes, p_bytes + count * sizeof( T ) );
+      }
+
+      void align( std::vector<std::byte>& out, std::uint64_t alignment )
+      {
+         out.resize( ( out.size( ) + alignment - 1 ) & ~( alignment - 1 ) );
+      }
+
+      /**
+       * @brief Whether [offset, offset + size) lies inside a file of
+       * file_size bytes, without overflowing.
+       */
+      bool is_in_file( std::uint64_t offset, std::uint64_t size, std::uint64_t file_size )
+      {
+         return offset <= file_size && size <= file_size - offset;
+      }
+
+      /**
+       * @brief The blobs of a mesh before they are laid out in the file.
+       */
+      struct mesh_blobs
+      {
+         std::vector<std::byte> vertices;
+         std::vector<std::uint32_t> indices;
+
+         bool uses_16_bit_indices = true;
+      }; // struct mesh_blobs
+
+      /**
+       * @brief Write the index blob of a mesh with the index size of
+       * its entry.
+       */
+      void append_indices( std::vector<std::byte>& out, mesh_blobs const& blob )
+      {
+         if ( blob.uses_16_bit_indices )
+         {
+            std::vector<std::uint16_t> narrow( blob.indices.size( ) );
+            std::transform( blob.indices.cbegin( ), blob.indices.cend( ), narrow.begin( ), 
+               [] ( std::uint32_t index ) { return static_cast<std::uint16_t>( index ); } );
+
+            append( out, narrow.data( ), narrow.size( ) );
+         }
+         else
+         {
+            append( out, blob.indices.data( ), blob.indices.size( ) );
+         }
+      }
+
+      /**
+       * @brief Hash a glTF file along with the external buffers it refers
+       * to, which hold the actual geometry of .gltf files.
+       */
+      std::uint64_t hash_gltf( std::string const& filepath )
+      {
+         std::uint64_t hash = hash_file( filepath );
+
+         if ( filepath.size( ) >= 4 && filepath.compare( filepath.size( ) - 4, 4, ".glb" ) == 0 )
+         {
+            return hash;
+         }
+
+         auto const json = nlohmann::json::parse( read_from_file( filepath ), nullptr, false );
+         if ( json.is_discarded( ) )
+         {
+            throw std::runtime_error{ "Error parsing glTF file: " + filepath + "." };
+         }
+
+         auto const buffers = json.find( "buffers" );
+         if ( buffers == json.end( ) || !buffers->is_array( ) )
+         {
+            return hash;
+         }
+
+         auto const directory = std::filesystem::path( filepath ).parent_path( );
+         for( auto const& buffer : *buffers )
+         {
+            auto const uri = buffer.find( "uri" );
+            if ( uri == buffer.end( ) || !uri->is_string( ) )
+            {
+               continue;
+            }
+
+            auto const path = uri->get<std::string>( );
+            if ( path.compare( 0, 5, "data:" ) == 0 )
+            {
+               continue;
+            }
+
+            std::uint64_t const buffer_hash = hash_file( ( directory / path ).string( ) );
+            hash = hash_bytes( &buffer_hash, sizeof( buffer_hash ), hash );
+         }
+
+         return hash;
+      }
+
+      /**
+       * @brief Read the positions of a primitive, the first attribute of
+       * the mesh_vertex_layout.
+       */
+      std::vector<glm::vec3> read_positions( mesh_data const& data, mesh_primitive const& primitive )
+      {
+         std::vector<glm::vec3> positions( primitive.vertex_count );
+
+         auto const* p_vertex = data.vertices.data( ) + static_cast<std::size_t>( primitive.vertex_offset ) * mesh_vertex_layout::stride;
+         for( auto& position : positions )
+         {
+            std::memcpy( &position, p_vertex + mesh_vertex_layout::offsets[0], sizeof( glm::vec3 ) );
+            p_vertex += mesh_vertex_layout::stride;
+         }
+
+         return positions;
+      }
+
+      std::string to_string( lod_settings const& settings )
+      {
+         return 
+            "lods " + std::to_string( settings.max_lod_count ) + 
+            " reduction " + std::to_string( settings.reduction ) + 
+            " min " + std::to_string( settings.min_triangle_count );
+      }
+   } // namespace
+
+   void generate_lods( mesh_data& data, lod_settings const& settings, thread_pool& pool )
+   {
+      std::vector<mesh_primitive*> primitives;
+      for( auto& mesh : data.meshes )
+      {
+         mesh.lods.clear( );
+         for( auto& primitive : mesh.primitives )
+         {
+            primitive.first_lod = 0;
+            primitive.lod_count = 0;
+            primitives.push_back( &primitive );
+         }
+      }
+
+      std::vector<std::vector<gfx::simplified_mesh>> chains( primitives.size( ) );
+      pool.parallel_for( 0, primitives.size( ), 1, [&] ( std::size_t i )
+      {
+         auto const& primitive = *primitives[i];
+         if ( primitive.index_count / 3 < settings.min_triangle_count )
+         {
+            return;
+         }
+
+         std::vector<std::uint32_t> const indices( 
+            data.indices.cbegin( ) + primitive.first_index, 
+            data.indices.cbegin( ) + primitive.first_index + primitive.index_count 
+         );
+
+         chains[i] = gfx::build_lod_chain( indices, read_positions( data, primitive ), settings.max_lod_count, settings.reduction );
+      } );
+
+      std::size_t i = 0;
+      for( auto& mesh : data.meshes )
+      {
+         for( auto& primitive : mesh.primitives )
+         {
+            primitive.first_lod = static_cast<std::uint32_t>( mesh.lods.size( ) );
+            primitive.lod_count = static_cast<std::uint32_t>( chains[i].size( ) );
+
+            for( auto const& level : chains[i] )
+            {
+               mesh.lods.push_back( mesh_lod
+               {
+                  .first_index = static_cast<std::uint32_t>( data.indices.size( ) ),
+                  .index_count = static_cast<std::uint32_t>( level.indices.size( ) ),
+                  .error = level.error
+               } );
+
+               data.indices.insert( data.indices.end( ), level.indices.begin( ), level.indices.end( ) );
+            }
+
+            ++i;
+         }
+      }
+   }
+
+   std::vector<std::byte> cook_meshes( mesh_data const& data )
+   {
+      std::vector<cooked_mesh_entry> entries;
+      std::vector<cooked_primitive> primitives;
+      std::vector<cooked_lod> lods;
+      std::string names;
+      std::vector<mesh_blobs> blobs( data.meshes.size( ) );
+
+      entries.reserve( data.meshes.size( ) );
+      for( std::size_t i = 0; i < data.meshes.size( ); ++i )
+      {
+         auto const& src = data.meshes[i];
+         auto& blob = blobs[i];
+
+         cooked_mesh_entry entry
+         {
+            .name_offset = static_cast<std::uint32_t>( names.size( ) ),
+            .name_size = static_cast<std::uint32_t>( src.name.size( ) ),
+            .first_primitive = static_cast<std::uint32_t>( primitives.size( ) ),
+            .primitive_count = static_cast<std::uint32_t>( src.primitives.size( ) ),
+            .first_lod = static_cast<std::uint32_t>( lods.size( ) ),
+            .lod_count = static_cast<std::uint32_t>( src.lods.size( ) )
+         };
+
+         names += src.name;
+
+         glm::vec3 min( std::numeric_limits<float>::max( ) );
+         glm::vec3 max( std::numeric_limits<float>::lowest( ) );
+
+         for( auto const& primitive : src.primitives )
+         {
+            auto const vertex_begin = data.vertices.cbegin( ) + primitive.vertex_offset * mesh_vertex_layout::stride;
+            auto const index_begin = data.indices.cbegin( ) + primitive.first_index;
+
+            primitives.push_back( cooked_primitive
+            {
+               .first_index = static_cast<std::uint32_t>( blob.indices.size( ) ),
+               .index_count = primitive.index_count,
+               .vertex_offset = static_cast<std::int32_t>( blob.vertices.size( ) / mesh_vertex_layout::stride ),
+               .vertex_count = primitive.vertex_count,
+               .material = primitive.material,
+               .first_lod = primitive.first_lod,
+               .lod_count = primitive.lod_count,
+               .reserved = 0,
+               .min = { primitive.min.x, primitive.min.y, primitive.min.z },
+               .max = { primitive.max.x, primitive.max.y, primitive.max.z }
+            } );
+
+            blob.vertices.insert( blob.vertices.end( ), vertex_begin, vertex_begin + primitive.vertex_count * mesh_vertex_layout::stride );
+            blob.indices.insert( blob.indices.end( ), index_begin, index_begin + primitive.index_count );
+            blob.uses_16_bit_indices = blob.uses_16_bit_indices && gfx::fits_16_bit_indices( primitive.vertex_count );
+
+            min = glm::min( min, primitive.min );
+            max = glm::max( max, primitive.max );
+         }
+
+         for( auto const& lod : src.lods )
+         {
+            auto const index_begin = data.indices.cbegin( ) + lod.first_index;
+
+            lods.push_back( cooked_lod
+            {
+               .first_index = static_cast<std::uint32_t>( blob.indices.size( ) ),
+               .index_count = lod.index_count,
+               .error = lod.error,
+               .reserved = 0
+            } );
+
+            blob.indices.insert( blob.indices.end( ), index_begin, index_begin + lod.index_count );
+         }
+
+         if ( !src.primitives.empty( ) )
+         {
+            std::memcpy( entry.min, &min.x, sizeof( entry.min ) );
+            std::memcpy( entry.max, &max.x, sizeof( entry.max ) );
+         }
+
+         entry.vertex_count = static_cast<std::uint32_t>( blob.vertices.size( ) / mesh_vertex_layout::stride );
+         entry.index_count = static_cast<std::uint32_t>( blob.indices.size( ) );
+         entry.index_size = blob.uses_16_bit_indices ? sizeof( std::uint16_t ) : sizeof( std::uint32_t );
+
+         entries.push_back( entry );
+      }
+
+      /* TABLES */
+      cooked_mesh_header header
+      {
+         .mesh_count = static_cast<std::uint32_t>( entries.size( ) ),
+         .primitive_count = static_cast<std::uint32_t>( primitives.size( ) ),
+         .lod_count = static_cast<std::uint32_t>( lods.size( ) )
+      };
+
+      header.mesh_table_offset = sizeof( cooked_mesh_header );
+      header.primitive_table_offset = header.mesh_table_offset + entries.size( ) * sizeof( cooked_mesh_entry );
+      header.lod_table_offset = header.primitive_table_offset + primitives.size( ) * sizeof( cooked_primitive );
+      header.name_table_offset = header.lod_table_offset + lods.size( ) * sizeof( cooked_lod );
+
+      /* BLOBS */
+      std::uint64_t offset = header.name_table_offset + names.size( );
+      for( std::size_t i = 0; i < entries.size( ); ++i )
+      {
+         offset = ( offset + cooked_blob_alignment - 1 ) & ~( cooked_blob_alignment - 1 );
+         entries[i].vertex_offset = offset;
+         offset += blobs[i].vertices.size( );
+
+         offset = ( offset + cooked_blob_alignment - 1 ) & ~( cooked_blob_alignment - 1 );
+         entries[i].index_offset = offset;
+         offset += blobs[i].indices.size( ) * entries[i].index_size;
+      }
+
+      header.file_size = offset;
+
+      std::vector<std::byte> out;
+      out.reserve( offset );
+
+      append( out, &header, 1 );
+      append( out, entries.data( ), entries.size( ) );
+      append( out, primitives.data( ), primitives.size( ) );
+      append( out, lods.data( ), lods.size( ) );
+      append( out, names.data( ), names.size( ) );
+
+      for( auto const& blob : blobs )
+      {
+         align( out, cooked_blob_alignment );
+         append( out, blob.vertices.data( ), blob.vertices.size( ) );
+
+         align( out, cooked_blob_alignment );
+         append_indices( out, blob );
+      }
+
+      return out;
+   }
+
+   std::string get_cooked_meshes( 
+      derived_data_cache& cache, gltf_loader const& loader, std::string const& filepath, lod_settings const& settings )
+   {
+      derived_data_key const key
+      {
+         .importer = "mesh",
+         .importer_version = cooked_mesh_version,
+         .source_hash = hash_gltf( filepath ),
+         .settings = to_string( settings )
+      };
+
+      if ( auto path = cache.find( key ) )
+      {
+         return std::move( *path );
+      }
+
+      auto data = loader.decode( filepath );
+      generate_lods( data, settings, *loader.get_thread_pool( ) );
+
+      return cache.store( key, cook_meshes( data ) );
+   }
+
+   cooked_mesh_file::cooked_mesh_file( std::string const& filepath )
+      :
+      filepath( filepath ),
+      file( filepath )
+   {
+      auto const invalid = [&filepath] ( std::string const& reason )
+      {
+         return std::runtime_error{ "Invalid cooked mesh file: " + filepath + ". " + reason + "." };
+      };
+
+      std::uint64_t const file_size = file.size( );
+      if ( file_size < sizeof( cooked_mesh_header ) )
+      {
+         throw invalid( "File too small" );
+      }
+
+      p_header = reinterpret_cast<cooked_mesh_header const*>( file.data( ) );
+      if ( p_header->magic != cooked_mesh_magic )
+      {
+         throw invalid( "Wrong magic number" );
+      }
+
+      if ( p_header->version != cooked_mesh_version )
+      {
+         throw invalid( "Version " + std::to_string( p_header->version ) + " instead of " + std::to_string( cooked_mesh_version ) );
+      }
+
+      bool const is_aligned = 
+         p_header->mesh_table_offset % alignof( cooked_mesh_entry ) == 0 &&
+         p_header->primitive_table_offset % alignof( cooked_primitive ) == 0 &&
+         p_header->lod_table_offset % alignof( cooked_lod ) == 0;
+
+      if ( p_header->vertex_stride != mesh_vertex_layout::stride || p_header->file_size != file_size || !is_aligned )
+      {
+         throw invalid( "Header does not match the file" );
+      }
+
+      if ( !is_in_file( p_header->mesh_table_offset, std::uint64_t( p_header->mesh_count ) * sizeof( cooked_mesh_entry ), file_size ) ||
+         !is_in_file( p_header->primitive_table_offset, std::uint64_t( p_header->primitive_count ) * sizeof( cooked_primitive ), file_size ) ||
+         !is_in_file( p_header->lod_table_offset, std::uint64_t( p_header->lod_count ) * sizeof( cooked_lod ), file_size ) ||
+         !is_in_file( p_header->name_table_offset, 0, file_size ) )
+      {
+         throw invalid( "Table out of the file" );
+      }
+
+      p_meshes = reinterpret_cast<cooked_mesh_entry const*>( file.data( ) + p_header->mesh_table_offset );
+      p_primitives = reinterpret_cast<cooked_primitive const*>( file.data( ) + p_header->primitive_table_offset );
+      p_lods = reinterpret_cast<cooked_lod const*>( file.data( ) + p_header->lod_table_offset );
+      p_names = reinterpret_cast<char const*>( file.data( ) + p_header->name_table_offset );
+
+      for( std::uint32_t i = 0; i < p_header->mesh_count; ++i )
+      {
+         auto const& entry = p_meshes[i];
+
+         bool const is_valid =
+            ( entry.index_size == sizeof( std::uint16_t ) || entry.index_size == sizeof( std::uint32_t ) ) &&
+            is_in_file( p_header->name_table_offset + entry.name_offset, entry.name_size, file_size ) &&
+            is_in_file( entry.vertex_offset, std::uint64_t( entry.vertex_count ) * mesh_vertex_layout::stride, file_size ) &&
+            is_in_file( entry.index_offset, std::uint64_t( entry.index_count ) * entry.index_size, file_size ) &&
+            is_in_file( entry.first_primitive, entry.primitive_count, p_header->primitive_count ) &&
+            is_in_file( entry.first_lod, entry.lod_count, p_header->lod_count );
+
+         if ( !is_valid )
+         {
+            throw invalid( "Mesh " + std::to_string( i ) + " out of the file" );
+         }
+
+         /* the ranges of the primitives and levels are relative to the blobs of their mesh */
+         for( std::uint32_t j = entry.first_primitive; j < entry.first_primitive + entry.primitive_count; ++j )
+         {
+            auto const& primitive = p_primitives[j];
+
+            bool const is_valid_primitive =
+               primitive.vertex_offset >= 0 &&
+               is_in_file( std::uint64_t( primitive.vertex_offset ), primitive.vertex_count, entry.vertex_count ) &&
+               is_in_file( primitive.first_index, primitive.index_count, entry.index_count ) &&
+               is_in_file( primitive.first_lod, primitive.lod_count, entry.lod_count );
+
+            if ( !is_valid_primitive )
+            {
+               throw invalid( "Primitive " + std::to_string( j ) + " out of the blobs of mesh " + std::to_string( i ) );
+            }
+         }
+
+         for( std::uint32_t j = entry.first_lod; j < entry.first_lod + entry.lod_count; ++j )
+         {
+            if ( !is_in_file( p_lods[j].first_index, p_lods[j].index_count, entry.index_count ) )
+            {
+               throw invalid( "Level of detail " + std::to_string( j ) + " out of the blobs of mesh " + std::to_string( i ) );
+            }
+         }
+      }
+   }
+
+   std::uint32_t cooked_mesh_file::get_mesh_count( ) const
+   {
+      return p_header != nullptr ? p_header->mesh_count : 0;
+   }
+
+   std::string_view cooked_mesh_file::get_mesh_name( std::uint32_t mesh_index ) const
+   {
+      auto const& entry = p_meshes[mesh_index];
+
+      return std::string_view( p_names + entry.name_offset, entry.name_size );
+   }
+
+   std::optional<std::uint32_t> cooked_mesh_file::find_mesh( std::string_view name ) const
+   {
+      for( std::uint32_t i = 0; i < get_mesh_count( ); ++i )
+      {
+         if ( get_mesh_name( i ) == name )
+         {
+            return i;
+         }
+      }
+
+      return std::nullopt;
+   }
+
+   mesh_import cooked_mesh_file::stage( context const* p_context, std::vector<std::uint32_t> const& mesh_indices ) const
+   {
+      mesh_import import;
+      import.filepath = filepath;
+
+      bool uses_16_bit_indices = true;
+      VkDeviceSize index_count = 0;
+      for( auto mesh_index : mesh_indices )
+      {
+         if ( mesh_index >= get_mesh_count( ) )
+         {
+            throw std::runtime_error{ "No mesh " + std::to_string( mesh_index ) + " in: " + filepath + "." };
+         }
+
+         import.vertex_size += static_cast<VkDeviceSize>( p_meshes[mesh_index].vertex_count ) * mesh_vertex_layout::stride;
+         index_count += p_meshes[mesh_index].index_count;
+         uses_16_bit_indices = uses_16_bit_indices && p_meshes[mesh_index].index_size == sizeof( std::uint16_t );
+      }
+
+      std::size_t const index_size = uses_16_bit_indices ? sizeof( std::uint16_t ) : sizeof( std::uint32_t );
+      import.index_type = uses_16_bit_indices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+      import.index_size = index_count * index_size;
+
+      vk::staging_buffer::create_info const staging_create_info
+      {
+         .p_context = p_context,
+         .size = std::max<VkDeviceSize>( import.vertex_size + import.index_size + 16, 16 )
+      };
+
+      import.staging = vk::staging_buffer( vk::staging_buffer::create_info_t( staging_create_info ) );
+      import.vertex_offset = import.staging.allocate( import.vertex_size );
+      import.index_offset = import.staging.allocate( import.index_size );
+
+      std::uint32_t base_vertex = 0;
+      std::uint32_t base_index = 0;
+
+      import.meshes.reserve( mesh_indices.size( ) );
+      for( auto mesh_index : mesh_indices )
+      {
+         auto const& entry = p_meshes[mesh_index];
+
+         std::memcpy( 
+            import.staging.data( import.vertex_offset + VkDeviceSize( base_vertex ) * mesh_vertex_layout::stride ),
+            file.data( ) + entry.vertex_offset,
+            std::size_t( entry.vertex_count ) * mesh_vertex_layout::stride
+         );
+
+         auto* p_indices = import.staging.data( import.index_offset + VkDeviceSize( base_index ) * index_size );
+         if ( entry.index_size == index_size )
+         {
+            std::memcpy( p_indices, file.data( ) + entry.index_offset, std::size_t( entry.index_count ) * index_size );
+         }
+         else
+         {
+            /* a mesh with 16 bit indices staged along meshes with 32 bit ones */
+            auto const* p_src = reinterpret_cast<std::uint16_t const*>( file.data( ) + entry.index_offset );
+            std::copy( p_src, p_src + entry.index_count, reinterpret_cast<std::uint32_t*>( p_indices ) );
+         }
+
+         auto& dst = import.meshes.emplace_back( );
+         dst.name = get_mesh_name( mesh_index );
+
+         dst.primitives.reserve( entry.primitive_count );
+         for( auto const* p_src = p_primitives + entry.first_primitive; p_src != p_primitives + entry.first_primitive + entry.primitive_count; ++p_src )
+         {
+            dst.primitives.push_back( mesh_primitive
+            {
+               .first_index = p_src->first_index + base_index,
+               .index_count = p_src->index_count,
+               .vertex_offset = p_src->vertex_offset + static_cast<std::int32_t>( base_vertex ),
+               .vertex_count = p_src->vertex_count,
+               .material = p_src->material,
+               .first_lod = p_src->first_lod,
+               .lod_count = p_src->lod_count,
+               .min = glm::vec3( p_src->min[0], p_src->min[1], p_src->min[2] ),
+               .max = glm::vec3( p_src->max[0], p_src->max[1], p_src->max[2] )
+            } );
+         }
+
+         dst.lods.reserve( entry.lod_count );
+         for( auto const* p_src = p_lods + entry.first_lod; p_src != p_lods + entry.first_lod + entry.lod_count; ++p_src )
+         {
+            dst.lods.push_back( mesh_lod
+            {
+               .first_index = p_src->first_index + base_index,
+               .index_count = p_src->index_count,
+               .error = p_src->error
+            } );
+         }
+
+         base_vertex += entry.vertex_count;
+         base_index += entry.index_count;
+      }
+
+      return import;
+   }
+
+   mesh_import cooked_mesh_file::stage_all( context const* p_context ) const
+   {
+      std::vector<std::uint32_t> mesh_indices( get_mesh_count( ) );
+      for( std::uint32_t i = 0; i < mesh_indices.size( ); ++i )
+      {
+         mesh_indices[i] = i;
+      }
+
+      return stage( p_context, mesh_indices );
+   }
+} // namespace assets
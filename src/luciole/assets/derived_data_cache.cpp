@@ -0,0 +1,338 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/derived_data_cache.hpp>
+#include <luciole/utils/file_io.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+namespace assets
+{
+   namespace
+   {
+      static constexpr std::uint64_t prime_1 = 0x9e3779b185ebca87ull;
+      static constexpr std::uint64_t prime_2 = 0xc2b2ae3d27d4eb4full;
+      static constexpr std::uint64_t prime_3 = 0x165667b19e3779f9ull;
+
+      static constexpr char const* artifact_extension = ".bin";
+      static constexpr char const* temporary_extension = ".tmp";
+
+      /* Temporary files this old are left over from a crash */
+      static constexpr auto stale_temporary_age = std::chrono::hours( 1 );
+
+      constexpr std::uint64_t rotate_left( std::uint64_t value, int count ) noexcept
+      {
+         return ( value << count ) | ( value >> ( 64 - count ) );
+      }
+
+      constexpr std::uint64_t mix( std::uint64_t hash, std::uint64_t word ) noexcept
+      {
+         hash ^= rotate_left( word * prime_2, 31 ) * prime_1;
+
+         return rotate_left( hash, 27 ) * prime_1 + prime_3;
+      }
+
+      constexpr std::uint64_t avalanche( std::uint64_t hash ) noexcept
+      {
+         hash ^= hash >> 33;
+         hash *= prime_2;
+         hash ^= hash >> 29;
+         hash *= prime_3;
+         hash ^= hash >> 32;
+
+         return hash;
+      }
+
+      std::string to_hex( std::uint64_t value )
+      {
+         static constexpr char digits[] = "0123456789abcdef";
+
+         std::string res( 16, '0' );
+         for( int i = 15; i >= 0; --i, value >>= 4 )
+         {
+            res[static_cast<std::size_t>( i )] = digits[value & 0xf];
+         }
+
+         return res;
+      }
+   } // namespace
+
+   std::uint64_t hash_bytes( void const* p_data, std::size_t size, std::uint64_t seed ) noexcept
+   {
+      auto const* p_bytes = static_cast<unsigned char const*>( p_data );
+
+      std::uint64_t hash = seed + prime_3;
+
+      std::size_t offset = 0;
+      for( ; offset + 8 <= size; offset += 8 )
+      {
+         std::uint64_t word;
+         std::memcpy( &word, p_bytes + offset, sizeof( word ) );
+
+         hash = mix( hash, word );
+      }
+
+      if ( offset < size )
+      {
+         std::uint64_t tail = 0;
+         std::memcpy( &tail, p_bytes + offset, size - offset );
+
+         hash = mix( hash, tail );
+      }
+
+      hash = mix( hash, static_cast<std::uint64_t>( size ) );
+
+      return avalanche( hash );
+   }
+
+   std::uint64_t hash_file( std::string const& filepath )
+   {
+      std::error_code error;
+      auto const size = std::filesystem::file_size( filepath, error );
+      if ( error )
+      {
+         throw std::runtime_error{ "Error loading file at location: " + filepath + "." };
+      }
+
+      if ( size == 0 )
+      {
+         return hash_bytes( nullptr, 0 );
+      }
+
+      mapped_file const file( filepath );
+
+      return hash_bytes( file.data( ), file.size( ) );
+   }
+
+   derived_data_cache::derived_data_cache( create_info_t const& create_info )
+      :
+      directory( create_info.value( ).directory ),
+      max_size( create_info.value( ).max_size )
+   {
+      std::error_code error;
+      std::filesystem::create_directories( directory, error );
+      if ( error )
+      {
+         throw std::runtime_error{ "Error creating the derived data cache at: " + directory + "." };
+      }
+
+      for( auto const& entry : std::filesystem::recursive_directory_iterator( directory, error ) )
+      {
+         if ( entry.is_regular_file( error ) && entry.path( ).extension( ) == artifact_extension )
+         {
+            cache_stats.size += entry.file_size( error );
+         }
+      }
+   }
+
+   std::optional<std::string> derived_data_cache::find( derived_data_key const& key )
+   {
+      auto const path = get_artifact_path( key );
+
+      std::error_code error;
+      if ( !std::filesystem::is_regular_file( path, error ) )
+      {
+         std::scoped_lock lock( mutex );
+         ++cache_stats.miss_count;
+
+         return std::nullopt;
+      }
+
+      // The write time doubles as the last use time for pruning.
+      std::filesystem::last_write_time( path, std::filesystem::file_time_type::clock::now( ), error );
+
+      std::scoped_lock lock( mutex );
+      ++cache_stats.hit_count;
+
+      return path;
+   }
+
+   std::optional<std::vector<std::byte>> derived_data_cache::load( derived_data_key const& key )
+   {
+      auto const path = find( key );
+      if ( !path )
+      {
+         return std::nullopt;
+      }
+
+      std::ifstream file( *path, std::ios::binary | std::ios::ate );
+      if ( !file.good( ) )
+      {
+         /* pruned between find and the read */
+         return std::nullopt;
+      }
+
+      std::vector<std::byte> data( static_cast<std::size_t>( file.tellg( ) ) );
+      file.seekg( 0 );
+      file.read( reinterpret_cast<char*>( data.data( ) ), static_cast<std::streamsize>( data.size( ) ) );
+      if ( !file.good( ) )
+      {
+         return std::nullopt;
+      }
+
+      return data;
+   }
+
+   std::string derived_data_cache::store( derived_data_key const& key, std::vector<std::byte> const& data )
+   {
+      namespace fs = std::filesystem;
+
+      auto const path = get_artifact_path( key );
+      auto const temporary_path = path + "." + to_hex( std::random_device{ }( ) ) + temporary_extension;
+
+      std::error_code error;
+      fs::create_directories( fs::path( path ).parent_path( ), error );
+
+      {
+         std::ofstream file( temporary_path, std::ios::binary );
+         file.write( reinterpret_cast<char const*>( data.data( ) ), static_cast<std::streamsize>( data.size( ) ) );
+         file.close( );
+
+         if ( !file.good( ) )
+         {
+            fs::remove( temporary_path, error );
+
+            throw std::runtime_error{ "Error writing the derived data at: " + temporary_path + "." };
+         }
+      }
+
+      std::scoped_lock lock( mutex );
+
+      auto const previous_size = fs::is_regular_file( path, error ) ? fs::file_size( path, error ) : 0;
+
+      fs::rename( temporary_path, path, error );
+      if ( error )
+      {
+         fs::remove( temporary_path, error );
+
+         throw std::runtime_error{ "Error writing the derived data at: " + path + "." };
+      }
+
+      cache_stats.size = cache_stats.size + data.size( ) - std::min<std::uint64_t>( previous_size, cache_stats.size );
+      ++cache_stats.store_count;
+
+      if ( cache_stats.size > max_size )
+      {
+         prune_locked( max_size / 4 * 3 );
+      }
+
+      return path;
+   }
+
+   void derived_data_cache::prune( std::uint64_t target_size )
+   {
+      std::scoped_lock lock( mutex );
+
+      prune_locked( target_size );
+   }
+
+   derived_data_cache::stats derived_data_cache::get_stats( ) const
+   {
+      std::scoped_lock lock( mutex );
+
+      return cache_stats;
+   }
+
+   std::string derived_data_cache::get_digest( derived_data_key const& key )
+   {
+      std::string description = key.importer;
+      description.push_back( '\0' );
+      description += std::to_string( key.importer_version );
+      description.push_back( '\0' );
+      description += to_hex( key.source_hash );
+      description.push_back( '\0' );
+      description += key.settings;
+
+      return to_hex( hash_bytes( description.data( ), description.size( ), 0 ) ) + 
+         to_hex( hash_bytes( description.data( ), description.size( ), prime_1 ) );
+   }
+
+   std::string derived_data_cache::get_artifact_path( derived_data_key const& key ) const
+   {
+      auto const digest = get_digest( key );
+
+      // Spread the artifacts over 256 directories to keep them small.
+      return ( std::filesystem::path( directory ) / digest.substr( 0, 2 ) / ( digest + artifact_extension ) ).string( );
+   }
+
+   void derived_data_cache::prune_locked( std::uint64_t target_size )
+   {
+      namespace fs = std::filesystem;
+
+      struct artifact
+      {
+         fs::path path;
+         std::uint64_t size = 0;
+         fs::file_time_type last_use;
+      }; // struct artifact
+
+      auto const now = fs::file_time_type::clock::now( );
+
+      std::error_code error;
+      std::vector<artifact> artifacts;
+      std::uint64_t size = 0;
+      for( auto const& entry : fs::recursive_directory_iterator( directory, error ) )
+      {
+         if ( !entry.is_regular_file( error ) )
+         {
+            continue;
+         }
+
+         auto const last_use = entry.last_write_time( error );
+         if ( entry.path( ).extension( ) == temporary_extension )
+         {
+            if ( now - last_use > stale_temporary_age )
+            {
+               fs::remove( entry.path( ), error );
+            }
+         }
+         else if ( entry.path( ).extension( ) == artifact_extension )
+         {
+            auto const& added = artifacts.emplace_back( artifact{ entry.path( ), entry.file_size( error ), last_use } );
+            size += added.size;
+         }
+      }
+
+      std::sort( artifacts.begin( ), artifacts.end( ), [] ( artifact const& lhs, artifact const& rhs ) {
+         return lhs.last_use < rhs.last_use;
+      } );
+
+      for( auto const& oldest : artifacts )
+      {
+         if ( size <= target_size )
+         {
+            break;
+         }
+
+         if ( fs::remove( oldest.path, error ) )
+         {
+            size -= oldest.size;
+            ++cache_stats.pruned_count;
+         }
+      }
+
+      cache_stats.size = size;
+   }
+} // namespace assets
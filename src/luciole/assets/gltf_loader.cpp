@@ -0,0 +1,639 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/gltf_loader.hpp>
+
+#include <luciole/graphics/mesh_optimizer.hpp>
+
+#include <tiny_gltf/tiny_gltf.h>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+namespace assets
+{
+   namespace
+   {
+      /**
+       * @brief Textures are loaded by their own pipeline, the loader
+       * keeps the raw image data out of the way.
+       */
+      bool skip_image_data(
+         tinygltf::Image*, std::string*, std::string*,
+         int, int, unsigned char const*, int, void* )
+      {
+         return true;
+      }
+
+      /**
+       * @brief Read one component of an accessor as a float, following
+       * the glTF rules for normalized integers.
+       */
+      float read_component( unsigned char const* p_data, int component_type, bool normalized )
+      {
+         switch( component_type )
+         {
+            case TINYGLTF_COMPONENT_TYPE_FLOAT:
+            {
+               float value;
+               std::memcpy( &value, p_data, sizeof( value ) );
+
+               return value;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            {
+               float const value = static_cast<float>( *p_data );
+
+               return normalized ? value / 255.0f : value;
+            }
+            case TINYGLTF_COMPONENT_TYPE_BYTE:
+            {
+               float const value = static_cast<float>( static_cast<std::int8_t>( *p_data ) );
+
+               return normalized ? std::max( value / 127.0f, -1.0f ) : value;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            {
+               std::uint16_t value;
+               std::memcpy( &value, p_data, sizeof( value ) );
+
+               return normalized ? static_cast<float>( value ) / 65535.0f : static_cast<float>( value );
+            }
+            case TINYGLTF_COMPONENT_TYPE_SHORT:
+            {
+               std::int16_t value;
+               std::memcpy( &value, p_data, sizeof( value ) );
+
+               return normalized ? std::max( static_cast<float>( value ) / 32767.0f, -1.0f ) : static_cast<float>( value );
+            }
+            default:
+            {
+               return 0.0f;
+            }
+         }
+      }
+
+      tinygltf::Accessor const& get_accessor( tinygltf::Model const& model, int accessor_index )
+      {
+         if ( accessor_index < 0 || static_cast<std::size_t>( accessor_index ) >= model.accessors.size( ) )
+         {
+            throw std::runtime_error{ "Invalid accessor index." };
+         }
+
+         return model.accessors[accessor_index];
+      }
+
+      /**
+       * @brief Get the first byte and the stride of an accessor, after
+       * checking that all of its elements lie inside its buffer.
+       */
+      std::pair<unsigned char const*, std::size_t> get_accessor_data( 
+         tinygltf::Model const& model, tinygltf::Accessor const& accessor )
+      {
+         if ( accessor.bufferView < 0 )
+         {
+            throw std::runtime_error{ "Sparse accessors are not supported." };
+         }
+
+         if ( static_cast<std::size_t>( accessor.bufferView ) >= model.bufferViews.size( ) )
+         {
+            throw std::runtime_error{ "Invalid buffer view index." };
+         }
+
+         auto const& view = model.bufferViews[accessor.bufferView];
+         if ( view.buffer < 0 || static_cast<std::size_t>( view.buffer ) >= model.buffers.size( ) )
+         {
+            throw std::runtime_error{ "Invalid buffer index." };
+         }
+
+         auto const& buffer = model.buffers[view.buffer];
+
+         if ( accessor.count == 0 )
+         {
+            throw std::runtime_error{ "Empty accessor." };
+         }
+
+         int const stride = accessor.ByteStride( view );
+         int const component_size = tinygltf::GetComponentSizeInBytes( static_cast<std::uint32_t>( accessor.componentType ) );
+         int const component_count = tinygltf::GetTypeSizeInBytes( static_cast<std::uint32_t>( accessor.type ) );
+         if ( stride <= 0 || component_size <= 0 || component_count <= 0 )
+         {
+            throw std::runtime_error{ "Invalid accessor stride." };
+         }
+
+         /* The last element only spans its own size, not the whole 
+            stride. */
+         std::size_t const element_size = static_cast<std::size_t>( component_size * component_count );
+         std::size_t const offset = view.byteOffset + accessor.byteOffset;
+         std::size_t const size = buffer.data.size( );
+
+         if ( offset > size || 
+            ( accessor.count - 1 ) > ( size - offset ) / static_cast<std::size_t>( stride ) || 
+            offset + ( accessor.count - 1 ) * stride + element_size > size )
+         {
+            throw std::runtime_error{ "Accessor out of the bounds of its buffer." };
+         }
+
+         return { buffer.data.data( ) + offset, static_cast<std::size_t>( stride ) };
+      }
+
+      /**
+       * @brief Decode an accessor into vectors of length components.
+       */
+      template<glm::length_t length>
+      std::vector<glm::vec<length, float>> read_vectors( 
+         tinygltf::Model const& model, int accessor_index )
+      {
+         auto const& accessor = get_accessor( model, accessor_index );
+         auto const [p_data, stride] = get_accessor_data( model, accessor );
+
+         std::size_t const component_count = static_cast<std::size_t>( 
+            std::min<int>( tinygltf::GetTypeSizeInBytes( static_cast<std::uint32_t>( accessor.type ) ), length ) 
+         );
+         std::size_t const component_size = static_cast<std::size_t>( 
+            tinygltf::GetComponentSizeInBytes( static_cast<std::uint32_t>( accessor.componentType ) ) 
+         );
+
+         std::vector<glm::vec<length, float>> values( accessor.count, glm::vec<length, float>( 0.0f ) );
+         if ( accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && component_count == length && stride == sizeof( values[0] ) )
+         {
+            std::memcpy( values.data( ), p_data, accessor.count * stride );
+
+            return values;
+         }
+
+         for( std::size_t i = 0; i < accessor.count; ++i )
+         {
+            for( std::size_t j = 0; j < component_count; ++j )
+            {
+               values[i][j] = read_component( p_data + i * stride + j * component_size, accessor.componentType, accessor.normalized );
+            }
+         }
+
+         return values;
+      }
+
+      /**
+       * @brief Decode the indices of a primitive.
+       *
+       * @throw std::runtime_error if an index is past the vertices of the
+       * primitive, as the GPU would read out of its vertex buffer.
+       */
+      void read_indices( tinygltf::Model const& model, int accessor_index, std::uint32_t vertex_count, std::uint32_t* p_dst )
+      {
+         auto const& accessor = get_accessor( model, accessor_index );
+         auto const [p_data, stride] = get_accessor_data( model, accessor );
+
+         for( std::size_t i = 0; i < accessor.count; ++i )
+         {
+            auto const* p_index = p_data + i * stride;
+
+            switch( accessor.componentType )
+            {
+               case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+               {
+                  p_dst[i] = *p_index;
+                  break;
+               }
+               case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+               {
+                  std::uint16_t index;
+                  std::memcpy( &index, p_index, sizeof( index ) );
+                  p_dst[i] = index;
+                  break;
+               }
+               case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+               {
+                  std::memcpy( &p_dst[i], p_index, sizeof( std::uint32_t ) );
+                  break;
+               }
+               default:
+               {
+                  throw std::runtime_error{ "Invalid index component type." };
+               }
+            }
+
+            if ( p_dst[i] >= vertex_count )
+            {
+               throw std::runtime_error{ "Index " + std::to_string( p_dst[i] ) + " past the " + std::to_string( vertex_count ) + " vertices of its primitive." };
+            }
+         }
+      }
+
+      /**
+       * @brief Decode the vertices and indices of a primitive into
+       * their place in the staging buffer, reordering them for the
+       * vertex cache, overdraw and vertex fetches on the way. The
+       * indices are written on 16 or 32 bits depending on index_type.
+       */
+      gfx::mesh_optimization_report decode_primitive( 
+         tinygltf::Model const& model, tinygltf::Primitive const& primitive, mesh_primitive const& dst,
+         std::byte* p_vertices, std::byte* p_indices, VkIndexType index_type )
+      {
+         auto const positions = read_vectors<3>( model, primitive.attributes.at( "POSITION" ) );
+
+         auto const normal = primitive.attributes.find( "NORMAL" );
+         auto const normals = normal != primitive.attributes.cend( ) ? 
+            read_vectors<3>( model, normal->second ) : 
+            std::vector<glm::vec3>( positions.size( ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+
+         auto const tex_coord = primitive.attributes.find( "TEXCOORD_0" );
+         auto const tex_coords = tex_coord != primitive.attributes.cend( ) ?
+            read_vectors<2>( model, tex_coord->second ) :
+            std::vector<glm::vec2>( positions.size( ), glm::vec2( 0.0f ) );
+
+         if ( normals.size( ) != positions.size( ) || tex_coords.size( ) != positions.size( ) )
+         {
+            throw std::runtime_error{ "Vertex attributes of different sizes." };
+         }
+
+         std::vector<std::uint32_t> indices( dst.index_count );
+         read_indices( model, primitive.indices, dst.vertex_count, indices.data( ) );
+
+         auto const optimized = gfx::optimize_mesh( indices, positions );
+
+         /* unused vertices are dropped to the end of the range reserved for the primitive */
+         auto const vertex_count = static_cast<std::uint32_t>( positions.size( ) );
+         auto const optimized_positions = gfx::remap_vertices( positions, optimized.remap, vertex_count );
+         auto const optimized_normals = gfx::remap_vertices( normals, optimized.remap, vertex_count );
+         auto const optimized_tex_coords = gfx::remap_vertices( tex_coords, optimized.remap, vertex_count );
+
+         mesh_vertex_layout::encode_to(
+            p_vertices + static_cast<std::size_t>( dst.vertex_offset ) * mesh_vertex_layout::stride,
+            optimized_positions.size( ),
+            optimized_positions.data( ), optimized_normals.data( ), optimized_tex_coords.data( )
+         );
+
+         if ( index_type == VK_INDEX_TYPE_UINT16 )
+         {
+            std::transform( indices.cbegin( ), indices.cend( ), reinterpret_cast<std::uint16_t*>( p_indices ) + dst.first_index,
+               [] ( std::uint32_t index ) { return static_cast<std::uint16_t>( index ); } );
+         }
+         else
+         {
+            std::copy( indices.cbegin( ), indices.cend( ), reinterpret_cast<std::uint32_t*>( p_indices ) + dst.first_index );
+         }
+
+         return optimized.report;
+      }
+
+      glm::mat4 get_local_transform( tinygltf::Node const& node )
+      {
+         if ( node.matrix.size( ) == 16 )
+         {
+            return glm::mat4( glm::make_mat4( node.matrix.data( ) ) );
+         }
+
+         glm::mat4 transform( 1.0f );
+         if ( node.translation.size( ) == 3 )
+         {
+            transform[3] = glm::vec4( glm::vec3( glm::make_vec3( node.translation.data( ) ) ), 1.0f );
+         }
+
+         if ( node.rotation.size( ) == 4 )
+         {
+            glm::quat const rotation( 
+               static_cast<float>( node.rotation[3] ), static_cast<float>( node.rotation[0] ),
+               static_cast<float>( node.rotation[1] ), static_cast<float>( node.rotation[2] ) 
+            );
+
+            transform *= glm::mat4_cast( rotation );
+         }
+
+         if ( node.scale.size( ) == 3 )
+         {
+            transform[0] *= static_cast<float>( node.scale[0] );
+            transform[1] *= static_cast<float>( node.scale[1] );
+            transform[2] *= static_cast<float>( node.scale[2] );
+         }
+
+         return transform;
+      }
+
+      /**
+       * @brief Append the nodes with a mesh under the roots of a scene, 
+       * walked with a stack so that a deep hierarchy cannot overflow the
+       * call stack.
+       *
+       * @throw std::runtime_error if an index is out of range, or if a 
+       * node is reached twice, which a cycle would do forever.
+       */
+      void flatten_nodes( 
+         tinygltf::Model const& model, std::vector<int> const& roots, 
+         std::vector<scene_node>& nodes )
+      {
+         struct pending_node
+         {
+            int index;
+            glm::mat4 parent_transform;
+         }; // struct pending_node
+
+         std::vector<bool> is_visited( model.nodes.size( ), false );
+         std::vector<pending_node> stack;
+
+         // Pushed in reverse to come out in the order of the file.
+         for( auto it = roots.rbegin( ); it != roots.rend( ); ++it )
+         {
+            stack.push_back( pending_node{ .index = *it, .parent_transform = glm::mat4( 1.0f ) } );
+         }
+
+         while( !stack.empty( ) )
+         {
+            auto const pending = stack.back( );
+            stack.pop_back( );
+
+            if ( pending.index < 0 || static_cast<std::size_t>( pending.index ) >= model.nodes.size( ) )
+            {
+               throw std::runtime_error{ "Invalid node index." };
+            }
+
+            if ( is_visited[pending.index] )
+            {
+               throw std::runtime_error{ "Node " + std::to_string( pending.index ) + " is reached twice in its scene." };
+            }
+
+            is_visited[pending.index] = true;
+
+            auto const& node = model.nodes[pending.index];
+            auto const transform = pending.parent_transform * get_local_transform( node );
+
+            if ( node.mesh >= 0 )
+            {
+               if ( static_cast<std::size_t>( node.mesh ) >= model.meshes.size( ) )
+               {
+                  throw std::runtime_error{ "Invalid mesh index." };
+               }
+
+               nodes.push_back( scene_node{ .mesh = node.mesh, .transform = transform } );
+            }
+
+            for( auto it = node.children.rbegin( ); it != node.children.rend( ); ++it )
+            {
+               stack.push_back( pending_node{ .index = *it, .parent_transform = transform } );
+            }
+         }
+      }
+
+      /**
+       * @brief Where a primitive goes in the decoded vertices and indices.
+       */
+      struct primitive_range
+      {
+         tinygltf::Primitive const* p_primitive = nullptr;
+         mesh_primitive const* p_dst = nullptr;
+      }; // struct primitive_range
+
+      /**
+       * @brief A parsed glTF file and the layout of its decoded vertices
+       * and indices. The ranges point into the model and the meshes, so
+       * it is filled in place: tinygltf::Model is copied, not moved.
+       */
+      struct parsed_gltf
+      {
+         tinygltf::Model model;
+
+         std::vector<mesh> meshes;
+         std::vector<scene_node> nodes;
+         std::vector<primitive_range> ranges;
+
+         std::uint32_t vertex_count = 0;
+         std::uint32_t index_count = 0;
+      }; // struct parsed_gltf
+
+      void parse_gltf( std::string const& filepath, parsed_gltf& parsed )
+      {
+         tinygltf::TinyGLTF parser;
+         parser.SetImageLoader( &skip_image_data, nullptr );
+
+         std::string err;
+         std::string warn;
+
+         bool const is_binary = filepath.size( ) >= 4 && filepath.compare( filepath.size( ) - 4, 4, ".glb" ) == 0;
+         bool const is_loaded = is_binary ?
+            parser.LoadBinaryFromFile( &parsed.model, &err, &warn, filepath ) :
+            parser.LoadASCIIFromFile( &parsed.model, &err, &warn, filepath );
+
+         if ( !is_loaded )
+         {
+            throw std::runtime_error{ "Error loading glTF file: " + filepath + ". " + err };
+         }
+
+         auto const& model = parsed.model;
+
+         parsed.meshes.reserve( model.meshes.size( ) );
+         for( auto const& gltf_mesh : model.meshes )
+         {
+            /* the storage is reserved up front so the ranges can point into it */
+            auto& dst_mesh = parsed.meshes.emplace_back( );
+            dst_mesh.name = gltf_mesh.name;
+            dst_mesh.primitives.reserve( gltf_mesh.primitives.size( ) );
+
+            for( auto const& primitive : gltf_mesh.primitives )
+            {
+               auto const position = primitive.attributes.find( "POSITION" );
+               if ( position == primitive.attributes.cend( ) || primitive.indices < 0 || primitive.mode != TINYGLTF_MODE_TRIANGLES )
+               {
+                  continue;
+               }
+
+               auto const& position_accessor = get_accessor( model, position->second );
+               auto const& index_accessor = get_accessor( model, primitive.indices );
+               if ( index_accessor.count % 3 != 0 )
+               {
+                  throw std::runtime_error{ "Error loading glTF file: " + filepath + ". A triangle list has a partial triangle." };
+               }
+
+               auto& dst = dst_mesh.primitives.emplace_back( );
+               dst.first_index = parsed.index_count;
+               dst.index_count = static_cast<std::uint32_t>( index_accessor.count );
+               dst.vertex_offset = static_cast<std::int32_t>( parsed.vertex_count );
+               dst.vertex_count = static_cast<std::uint32_t>( position_accessor.count );
+               dst.material = primitive.material;
+
+               if ( position_accessor.minValues.size( ) == 3 && position_accessor.maxValues.size( ) == 3 )
+               {
+                  dst.min = glm::vec3( glm::make_vec3( position_accessor.minValues.data( ) ) );
+                  dst.max = glm::vec3( glm::make_vec3( position_accessor.maxValues.data( ) ) );
+               }
+
+               parsed.vertex_count += dst.vertex_count;
+               parsed.index_count += dst.index_count;
+
+               parsed.ranges.push_back( primitive_range{ .p_primitive = &primitive, .p_dst = &dst } );
+            }
+         }
+
+         if ( model.defaultScene >= 0 && static_cast<std::size_t>( model.defaultScene ) >= model.scenes.size( ) )
+         {
+            throw std::runtime_error{ "Invalid scene index." };
+         }
+
+         for( auto const& scene : model.scenes )
+         {
+            if ( model.defaultScene >= 0 && &scene != &model.scenes[model.defaultScene] )
+            {
+               continue;
+            }
+
+            flatten_nodes( model, scene.nodes, parsed.nodes );
+         }
+      }
+
+      /**
+       * @brief Decode every primitive of a parsed file in parallel.
+       *
+       * @return The optimization report of the whole file, the cache
+       * statistics of the primitives weighted by their size.
+       */
+      gfx::mesh_optimization_report decode_primitives( 
+         thread_pool& pool, parsed_gltf const& parsed, 
+         std::byte* p_vertices, std::byte* p_indices, VkIndexType index_type )
+      {
+         std::mutex error_mutex;
+         std::exception_ptr p_error;
+
+         std::vector<gfx::mesh_optimization_report> reports( parsed.ranges.size( ) );
+
+         pool.parallel_for( 0, parsed.ranges.size( ), 1, [&] ( std::size_t i ) 
+         {
+            try
+            {
+               reports[i] = decode_primitive( 
+                  parsed.model, *parsed.ranges[i].p_primitive, *parsed.ranges[i].p_dst, p_vertices, p_indices, index_type 
+               );
+            }
+            catch( ... )
+            {
+               std::scoped_lock lock( error_mutex );
+               if ( !p_error )
+               {
+                  p_error = std::current_exception( );
+               }
+            }
+         } );
+
+         if ( p_error )
+         {
+            std::rethrow_exception( p_error );
+         }
+
+         gfx::mesh_optimization_report total;
+         total.uses_16_bit_indices = true;
+
+         for( std::size_t i = 0; i < reports.size( ); ++i )
+         {
+            auto const triangle_weight = static_cast<float>( parsed.ranges[i].p_dst->index_count / 3 ) / static_cast<float>( parsed.index_count / 3 );
+            auto const vertex_weight = static_cast<float>( parsed.ranges[i].p_dst->vertex_count ) / static_cast<float>( parsed.vertex_count );
+
+            total.before.acmr += reports[i].before.acmr * triangle_weight;
+            total.before.atvr += reports[i].before.atvr * vertex_weight;
+            total.after.acmr += reports[i].after.acmr * triangle_weight;
+            total.after.atvr += reports[i].after.atvr * vertex_weight;
+            total.uses_16_bit_indices = total.uses_16_bit_indices && reports[i].uses_16_bit_indices;
+         }
+
+         return total;
+      }
+   } // namespace
+
+   gltf_loader::gltf_loader( create_info_t const& create_info )
+      :
+      p_context( create_info.value( ).p_context ),
+      p_thread_pool( create_info.value( ).p_thread_pool )
+   { }
+
+   std::future<mesh_import> gltf_loader::load_async( std::string const& filepath ) const
+   {
+      return p_thread_pool->submit( [this, filepath] { return load( filepath ); } );
+   }
+
+   mesh_import gltf_loader::load( std::string const& filepath ) const
+   {
+      parsed_gltf parsed;
+      parse_gltf( filepath, parsed );
+
+      /* indices are relative to the vertex offset of their primitive, so only the largest primitive matters */
+      bool const uses_16_bit_indices = std::all_of( parsed.ranges.cbegin( ), parsed.ranges.cend( ), 
+         [] ( primitive_range const& range ) { return gfx::fits_16_bit_indices( range.p_dst->vertex_count ); } );
+
+      mesh_import import;
+      import.filepath = filepath;
+      import.index_type = uses_16_bit_indices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+      import.vertex_size = static_cast<VkDeviceSize>( parsed.vertex_count ) * mesh_vertex_layout::stride;
+      import.index_size = static_cast<VkDeviceSize>( parsed.index_count ) * 
+         ( uses_16_bit_indices ? sizeof( std::uint16_t ) : sizeof( std::uint32_t ) );
+
+      vk::staging_buffer::create_info const staging_create_info
+      {
+         .p_context = p_context,
+         .size = std::max<VkDeviceSize>( import.vertex_size + import.index_size + 16, 16 )
+      };
+
+      import.staging = vk::staging_buffer( vk::staging_buffer::create_info_t( staging_create_info ) );
+      import.vertex_offset = import.staging.allocate( import.vertex_size );
+      import.index_offset = import.staging.allocate( import.index_size );
+
+      decode_primitives( 
+         *p_thread_pool, parsed,
+         import.staging.data( import.vertex_offset ),
+         import.staging.data( import.index_offset ),
+         import.index_type
+      );
+
+      import.meshes = std::move( parsed.meshes );
+      import.nodes = std::move( parsed.nodes );
+
+      return import;
+   }
+
+   mesh_data gltf_loader::decode( std::string const& filepath ) const
+   {
+      parsed_gltf parsed;
+      parse_gltf( filepath, parsed );
+
+      mesh_data data;
+      data.vertices.resize( static_cast<std::size_t>( parsed.vertex_count ) * mesh_vertex_layout::stride );
+      data.indices.resize( parsed.index_count );
+
+      data.optimization = decode_primitives( 
+         *p_thread_pool, parsed, 
+         data.vertices.data( ), reinterpret_cast<std::byte*>( data.indices.data( ) ), VK_INDEX_TYPE_UINT32 
+      );
+
+      data.meshes = std::move( parsed.meshes );
+      data.nodes = std::move( parsed.nodes );
+
+      return data;
+   }
+
+   mesh_scene gltf_loader::upload( mesh_import&& import ) const
+   {
+      return upload_meshes( p_context, std::move( import ) );
+   }
+
+   thread_pool* gltf_loader::get_thread_pool( ) const noexcept
+   {
+      return p_thread_pool;
+   }
+} // namespace assets
@@ -0,0 +1,402 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/ktx2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace assets
+{
+   namespace
+   {
+      static constexpr std::uint64_t level_alignment = 16;
+
+      template<typename T>
+      void append( std::vector<std::byte>& out, T const* p_data, std::size_t count )
+      {
+         auto const* p_bytes = reinterpret_cast<std::byte const*>( p_data );
+         out.insert( out.end( ), p_bytes, p_bytes + count * sizeof( T ) );
+      }
+
+      void align( std::vector<std::byte>& out, std::uint64_t alignment )
+      {
+         out.resize( ( out.size( ) + alignment - 1 ) & ~( alignment - 1 ) );
+      }
+
+      bool is_in_file( std::uint64_t offset, std::uint64_t size, std::uint64_t file_size )
+      {
+         return offset <= file_size && size <= file_size - offset;
+      }
+
+      /**
+       * @brief Get the number of bytes a level of the given size needs, or
+       * nothing if the format is not one the loader knows.
+       */
+      std::optional<std::uint64_t> get_level_footprint( VkFormat format, std::uint32_t width, std::uint32_t height )
+      {
+         if ( auto const block_format = gfx::to_block_format( format ) )
+         {
+            return gfx::get_compressed_size( *block_format, width, height );
+         }
+
+         std::uint64_t texel_size = 0;
+         switch( format )
+         {
+            case VK_FORMAT_R8_UNORM:
+            case VK_FORMAT_R8_SRGB:
+               texel_size = 1;
+               break;
+            case VK_FORMAT_R8G8_UNORM:
+            case VK_FORMAT_R8G8_SRGB:
+            case VK_FORMAT_R16_SFLOAT:
+               texel_size = 2;
+               break;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+            case VK_FORMAT_R16G16_SFLOAT:
+            case VK_FORMAT_R32_SFLOAT:
+               texel_size = 4;
+               break;
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+            case VK_FORMAT_R32G32_SFLOAT:
+               texel_size = 8;
+               break;
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+               texel_size = 16;
+               break;
+            default:
+               return std::nullopt;
+         }
+
+         return texel_size * width * height;
+      }
+
+      float srgb_to_linear( std::uint8_t value ) noexcept
+      {
+         static auto const table = [] 
+         {
+            std::array<float, 256> res;
+            for( std::size_t i = 0; i < res.size( ); ++i )
+            {
+               float const c = static_cast<float>( i ) / 255.0f;
+               res[i] = c <= 0.04045f ? c / 12.92f : std::pow( ( c + 0.055f ) / 1.055f, 2.4f );
+            }
+
+            return res;
+         }( );
+
+         return table[value];
+      }
+
+      std::uint8_t linear_to_srgb( float value ) noexcept
+      {
+         float const c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow( value, 1.0f / 2.4f ) - 0.055f;
+
+         return static_cast<std::uint8_t>( std::lround( std::clamp( c, 0.0f, 1.0f ) * 255.0f ) );
+      }
+
+      /**
+       * @brief Halve an RGBA image with a box filter. The colors of sRGB
+       * images are averaged in linear space, alpha always is.
+       */
+      std::vector<std::byte> downsample( std::vector<std::byte> const& src, std::uint32_t width, std::uint32_t height, bool srgb )
+      {
+         std::uint32_t const next_width = std::max( width / 2, 1u );
+         std::uint32_t const next_height = std::max( height / 2, 1u );
+
+         std::vector<std::byte> dst( std::size_t( next_width ) * next_height * 4 );
+
+         for( std::uint32_t y = 0; y < next_height; ++y )
+         {
+            std::uint32_t const y0 = std::min( y * 2, height - 1 );
+            std::uint32_t const y1 = std::min( y * 2 + 1, height - 1 );
+
+            for( std::uint32_t x = 0; x < next_width; ++x )
+            {
+               std::uint32_t const x0 = std::min( x * 2, width - 1 );
+               std::uint32_t const x1 = std::min( x * 2 + 1, width - 1 );
+
+               std::size_t const samples[4] = 
+               { 
+                  ( std::size_t( y0 ) * width + x0 ) * 4, ( std::size_t( y0 ) * width + x1 ) * 4,
+                  ( std::size_t( y1 ) * width + x0 ) * 4, ( std::size_t( y1 ) * width + x1 ) * 4
+               };
+
+               for( std::uint32_t c = 0; c < 4; ++c )
+               {
+                  bool const is_linear = !srgb || c == 3;
+
+                  float sum = 0.0f;
+                  for( auto const sample : samples )
+                  {
+                     auto const value = static_cast<std::uint8_t>( src[sample + c] );
+                     sum += is_linear ? static_cast<float>( value ) / 255.0f : srgb_to_linear( value );
+                  }
+
+                  float const average = sum / 4.0f;
+                  dst[( std::size_t( y ) * next_width + x ) * 4 + c] = static_cast<std::byte>( 
+                     is_linear ? static_cast<std::uint8_t>( std::lround( average * 255.0f ) ) : linear_to_srgb( average ) 
+                  );
+               }
+            }
+         }
+
+         return dst;
+      }
+
+      /**
+       * @brief Build the basic data format descriptor of a block format.
+       */
+      std::vector<std::uint32_t> make_data_format_descriptor( gfx::block_format format, bool srgb )
+      {
+         struct sample
+         {
+            std::uint32_t bit_offset;
+            std::uint32_t bit_length;
+            std::uint32_t channel;
+         }; // struct sample
+
+         std::uint32_t color_model = 0;
+         std::vector<sample> samples;
+         switch( format )
+         {
+            case gfx::block_format::e_bc1:
+               color_model = 128;
+               samples = { { 0, 64, 1 } };
+               break;
+            case gfx::block_format::e_bc3:
+               color_model = 130;
+               samples = { { 0, 64, 15 }, { 64, 64, 0 } };
+               break;
+            case gfx::block_format::e_bc4:
+               color_model = 131;
+               samples = { { 0, 64, 0 } };
+               break;
+            case gfx::block_format::e_bc5:
+               color_model = 132;
+               samples = { { 0, 64, 0 }, { 64, 64, 1 } };
+               break;
+            case gfx::block_format::e_bc7:
+               color_model = 134;
+               samples = { { 0, 128, 0 } };
+               break;
+         }
+
+         std::uint32_t const block_size = 24 + 16 * static_cast<std::uint32_t>( samples.size( ) );
+         std::uint32_t const transfer_function = srgb ? 2 : 1;
+         std::uint32_t const color_primaries = 1;
+
+         std::vector<std::uint32_t> words = 
+         {
+            4 + block_size,
+            0,
+            2 | ( block_size << 16 ),
+            color_model | ( color_primaries << 8 ) | ( transfer_function << 16 ),
+            3 | ( 3 << 8 ),
+            static_cast<std::uint32_t>( gfx::get_block_size( format ) ),
+            0
+         };
+
+         for( auto const& s : samples )
+         {
+            words.push_back( s.bit_offset | ( ( s.bit_length - 1 ) << 16 ) | ( s.channel << 24 ) );
+            words.push_back( 0 );
+            words.push_back( 0 );
+            words.push_back( 0xFFFFFFFF );
+         }
+
+         return words;
+      }
+   } // namespace
+
+   std::vector<std::byte> cook_texture( image_data const& image, gfx::block_format format, thread_pool* p_thread_pool )
+   {
+      if ( ( image.format != VK_FORMAT_R8G8B8A8_SRGB && image.format != VK_FORMAT_R8G8B8A8_UNORM ) || !image.levels.empty( ) )
+      {
+         throw std::runtime_error{ "Cannot cook texture: " + image.filepath + ". Only single level 8 bit RGBA images can be compressed." };
+      }
+
+      bool const srgb = image.format == VK_FORMAT_R8G8B8A8_SRGB && format != gfx::block_format::e_bc4 && format != gfx::block_format::e_bc5;
+      std::uint32_t const level_count = vk::get_mip_level_count( image.width, image.height );
+
+      std::vector<std::vector<std::byte>> levels;
+      levels.reserve( level_count );
+
+      std::vector<std::byte> pixels = image.pixels;
+      std::uint32_t width = image.width;
+      std::uint32_t height = image.height;
+      for( std::uint32_t level = 0; level < level_count; ++level )
+      {
+         levels.push_back( gfx::compress_image( format, reinterpret_cast<std::uint8_t const*>( pixels.data( ) ), width, height, p_thread_pool ) );
+
+         if ( level + 1 < level_count )
+         {
+            pixels = downsample( pixels, width, height, image.format == VK_FORMAT_R8G8B8A8_SRGB );
+            width = std::max( width / 2, 1u );
+            height = std::max( height / 2, 1u );
+         }
+      }
+
+      auto const dfd = make_data_format_descriptor( format, srgb );
+
+      ktx2_header header;
+      std::copy( std::begin( ktx2_identifier ), std::end( ktx2_identifier ), header.identifier );
+      header.vk_format = static_cast<std::uint32_t>( gfx::to_vk_format( format, srgb ) );
+      header.type_size = 1;
+      header.pixel_width = image.width;
+      header.pixel_height = image.height;
+      header.pixel_depth = 0;
+      header.layer_count = 0;
+      header.face_count = 1;
+      header.level_count = level_count;
+      header.supercompression_scheme = 0;
+      header.dfd_byte_offset = static_cast<std::uint32_t>( sizeof( ktx2_header ) + level_count * sizeof( ktx2_level ) );
+      header.dfd_byte_length = static_cast<std::uint32_t>( dfd.size( ) * sizeof( std::uint32_t ) );
+
+      std::vector<ktx2_level> level_index( level_count );
+
+      std::vector<std::byte> out;
+      out.resize( header.dfd_byte_offset );
+      append( out, dfd.data( ), dfd.size( ) );
+
+      for( std::uint32_t level = level_count; level-- > 0; )
+      {
+         align( out, level_alignment );
+
+         level_index[level].byte_offset = out.size( );
+         level_index[level].byte_length = levels[level].size( );
+         level_index[level].uncompressed_byte_length = levels[level].size( );
+
+         append( out, levels[level].data( ), levels[level].size( ) );
+      }
+
+      std::memcpy( out.data( ), &header, sizeof( header ) );
+      std::memcpy( out.data( ) + sizeof( header ), level_index.data( ), level_index.size( ) * sizeof( ktx2_level ) );
+
+      return out;
+   }
+
+   ktx2_file::ktx2_file( std::string const& filepath )
+      :
+      filepath( filepath ),
+      file( filepath )
+   {
+      auto const invalid = [&filepath] ( std::string const& reason )
+      {
+         return std::runtime_error{ "Invalid KTX2 file: " + filepath + ". " + reason + "." };
+      };
+
+      std::uint64_t const file_size = file.size( );
+      if ( file_size < sizeof( ktx2_header ) )
+      {
+         throw invalid( "File too small" );
+      }
+
+      p_header = reinterpret_cast<ktx2_header const*>( file.data( ) );
+      if ( !std::equal( std::begin( ktx2_identifier ), std::end( ktx2_identifier ), p_header->identifier ) )
+      {
+         throw invalid( "Wrong identifier" );
+      }
+
+      if ( p_header->vk_format == 0 || p_header->supercompression_scheme != 0 )
+      {
+         throw invalid( "Basis Universal and supercompressed files are not supported" );
+      }
+
+      if ( p_header->pixel_width == 0 || p_header->pixel_height == 0 || p_header->pixel_depth > 1 || 
+         p_header->layer_count > 1 || p_header->face_count != 1 )
+      {
+         throw invalid( "Only 2D textures are supported" );
+      }
+
+      if ( get_level_count( ) > vk::get_mip_level_count( p_header->pixel_width, p_header->pixel_height ) )
+      {
+         throw invalid( "More levels than the mip chain has" );
+      }
+
+      if ( !get_level_footprint( get_format( ), p_header->pixel_width, p_header->pixel_height ) )
+      {
+         throw invalid( "Unsupported format" );
+      }
+
+      if ( !is_in_file( sizeof( ktx2_header ), std::uint64_t( get_level_count( ) ) * sizeof( ktx2_level ), file_size ) )
+      {
+         throw invalid( "Level index out of the file" );
+      }
+
+      p_levels = reinterpret_cast<ktx2_level const*>( file.data( ) + sizeof( ktx2_header ) );
+
+      for( std::uint32_t level = 0; level < get_level_count( ); ++level )
+      {
+         if ( !is_in_file( p_levels[level].byte_offset, p_levels[level].byte_length, file_size ) )
+         {
+            throw invalid( "Level " + std::to_string( level ) + " out of the file" );
+         }
+
+         std::uint32_t const width = std::max( p_header->pixel_width >> level, 1u );
+         std::uint32_t const height = std::max( p_header->pixel_height >> level, 1u );
+         if ( p_levels[level].byte_length < *get_level_footprint( get_format( ), width, height ) )
+         {
+            throw invalid( "Level " + std::to_string( level ) + " is truncated" );
+         }
+      }
+   }
+
+   VkFormat ktx2_file::get_format( ) const
+   {
+      return static_cast<VkFormat>( p_header->vk_format );
+   }
+
+   std::uint32_t ktx2_file::get_width( ) const
+   {
+      return p_header->pixel_width;
+   }
+
+   std::uint32_t ktx2_file::get_height( ) const
+   {
+      return p_header->pixel_height;
+   }
+
+   std::uint32_t ktx2_file::get_level_count( ) const
+   {
+      // A level count of 0 still stores the base level.
+      return std::max( p_header->level_count, 1u );
+   }
+
+   bool ktx2_file::is_mip_chain_generated( ) const
+   {
+      return p_header->level_count == 0;
+   }
+
+   std::byte const* ktx2_file::get_level_data( std::uint32_t level ) const
+   {
+      return file.data( ) + p_levels[level].byte_offset;
+   }
+
+   std::size_t ktx2_file::get_level_size( std::uint32_t level ) const
+   {
+      return static_cast<std::size_t>( p_levels[level].byte_length );
+   }
+} // namespace assets
@@ -0,0 +1,310 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/loading_pipeline.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace assets
+{
+   namespace
+   {
+      std::string const stage_names[] =
+      {
+         "io",
+         "decode",
+         "pipeline",
+         "upload",
+         "unknown"
+      };
+
+      std::int64_t get_time( ) noexcept
+      {
+         return std::chrono::duration_cast<std::chrono::nanoseconds>( 
+            std::chrono::steady_clock::now( ).time_since_epoch( ) 
+         ).count( );
+      }
+   } // namespace
+
+   std::string const& to_string( load_stage stage )
+   {
+      return stage_names[std::min( static_cast<std::size_t>( stage ), load_stage_count )];
+   }
+
+   float load_progress::get_fraction( ) const noexcept
+   {
+      std::uint64_t queued = 0;
+      std::uint64_t done = 0;
+      for( auto const& stage : stages )
+      {
+         queued += stage.queued_count;
+         done += stage.completed_count + stage.failed_count;
+      }
+
+      if ( queued == 0 )
+      {
+         return 1.0f;
+      }
+
+      return static_cast<float>( done ) / static_cast<float>( queued );
+   }
+
+   bool load_progress::is_done( ) const noexcept
+   {
+      return completed_job_count + failed_job_count == job_count;
+   }
+
+   loading_pipeline::loading_pipeline( create_info_t const& create_info )
+      :
+      p_thread_pool( create_info.value( ).p_thread_pool ),
+      upload_budget( create_info.value( ).upload_budget )
+   {
+      if ( p_thread_pool == nullptr )
+      {
+         p_owned_thread_pool = std::make_unique<thread_pool>( 1u );
+         p_thread_pool = p_owned_thread_pool.get( );
+      }
+   }
+
+   loading_pipeline::~loading_pipeline( )
+   {
+      std::unique_lock lock( mutex );
+
+      is_stopping = true;
+      upload_queue.clear( );
+
+      idle_condition.wait( lock, [this] { return background_step_count == 0; } );
+   }
+
+   void loading_pipeline::enqueue( job&& j )
+   {
+      if ( j.steps.empty( ) )
+      {
+         throw std::runtime_error{ "Load job \"" + j.name + "\" has no step." };
+      }
+
+      for( auto const& step : j.steps )
+      {
+         if ( step.function == nullptr || step.stage >= load_stage::e_count )
+         {
+            throw std::runtime_error{ "Load job \"" + j.name + "\" has an invalid step." };
+         }
+      }
+
+      std::int64_t no_start = 0;
+      start_time.compare_exchange_strong( no_start, get_time( ), std::memory_order_relaxed );
+      finish_time.store( 0, std::memory_order_relaxed );
+
+      for( auto const& step : j.steps )
+      {
+         counters[static_cast<std::size_t>( step.stage )].queued_count.fetch_add( 1, std::memory_order_relaxed );
+      }
+
+      job_count.fetch_add( 1, std::memory_order_release );
+
+      auto p_job = std::make_shared<job_state>( );
+      p_job->name = std::move( j.name );
+      p_job->steps = std::move( j.steps );
+
+      dispatch( std::move( p_job ) );
+   }
+
+   void loading_pipeline::update( )
+   {
+      auto const deadline = std::chrono::steady_clock::now( ) + upload_budget;
+
+      while( true )
+      {
+         std::shared_ptr<job_state> p_job;
+         {
+            std::scoped_lock lock( mutex );
+            if ( upload_queue.empty( ) )
+            {
+               break;
+            }
+
+            p_job = std::move( upload_queue.front( ) );
+            upload_queue.pop_front( );
+         }
+
+         if ( run_step( *p_job ) )
+         {
+            dispatch( std::move( p_job ) );
+         }
+
+         if ( std::chrono::steady_clock::now( ) >= deadline )
+         {
+            break;
+         }
+      }
+   }
+
+   load_progress loading_pipeline::get_progress( ) const
+   {
+      load_progress progress;
+      
+      progress.job_count = job_count.load( std::memory_order_acquire );
+      progress.completed_job_count = completed_job_count.load( std::memory_order_acquire );
+      progress.failed_job_count = failed_job_count.load( std::memory_order_acquire );
+
+      for( std::size_t i = 0; i < load_stage_count; ++i )
+      {
+         progress.stages[i] = load_progress::stage
+         {
+            .queued_count = counters[i].queued_count.load( std::memory_order_relaxed ),
+            .completed_count = counters[i].completed_count.load( std::memory_order_relaxed ),
+            .failed_count = counters[i].failed_count.load( std::memory_order_relaxed ),
+            .busy_time = std::chrono::nanoseconds( counters[i].busy_time.load( std::memory_order_relaxed ) )
+         };
+      }
+
+      auto const start = start_time.load( std::memory_order_relaxed );
+      auto const finish = finish_time.load( std::memory_order_relaxed );
+      if ( start != 0 )
+      {
+         progress.elapsed_time = std::chrono::nanoseconds( ( finish != 0 ? finish : get_time( ) ) - start );
+      }
+
+      return progress;
+   }
+
+   std::vector<std::string> loading_pipeline::get_errors( ) const
+   {
+      std::scoped_lock lock( mutex );
+
+      return errors;
+   }
+
+   bool loading_pipeline::is_done( ) const noexcept
+   {
+      auto const total = job_count.load( std::memory_order_acquire );
+
+      return completed_job_count.load( std::memory_order_acquire ) + failed_job_count.load( std::memory_order_acquire ) == total;
+   }
+
+   void loading_pipeline::dispatch( std::shared_ptr<job_state> p_job )
+   {
+      if ( p_job->next_step == p_job->steps.size( ) )
+      {
+         finish_job( );
+         return;
+      }
+
+      std::scoped_lock lock( mutex );
+      if ( is_stopping )
+      {
+         return;
+      }
+
+      if ( p_job->steps[p_job->next_step].stage == load_stage::e_upload )
+      {
+         upload_queue.push_back( std::move( p_job ) );
+         return;
+      }
+
+      ++background_step_count;
+      p_thread_pool->add_task( [this, p_job] 
+      {
+         bool should_run = false;
+         {
+            std::scoped_lock lock( mutex );
+            should_run = !is_stopping;
+         }
+
+         if ( should_run && run_step( *p_job ) )
+         {
+            dispatch( p_job );
+         }
+
+         // Notify under the lock, the destructor may return as soon as
+         // it is released.
+         std::scoped_lock lock( mutex );
+         --background_step_count;
+         idle_condition.notify_all( );
+      } );
+   }
+
+   bool loading_pipeline::run_step( job_state& job )
+   {
+      auto const& step = job.steps[job.next_step++];
+      auto& counter = counters[static_cast<std::size_t>( step.stage )];
+
+      auto const begin = get_time( );
+
+      std::string error;
+      try
+      {
+         step.function( );
+      }
+      catch( std::exception const& e )
+      {
+         error = e.what( );
+      }
+      catch( ... )
+      {
+         error = "unknown error";
+      }
+
+      counter.busy_time.fetch_add( get_time( ) - begin, std::memory_order_relaxed );
+
+      if ( !error.empty( ) )
+      {
+         counter.failed_count.fetch_add( 1, std::memory_order_relaxed );
+         fail_job( job, error );
+
+         return false;
+      }
+      
+      counter.completed_count.fetch_add( 1, std::memory_order_relaxed );
+
+      return true;
+   }
+
+   void loading_pipeline::fail_job( job_state& job, std::string const& error )
+   {
+      for( ; job.next_step < job.steps.size( ); ++job.next_step )
+      {
+         auto const stage = static_cast<std::size_t>( job.steps[job.next_step].stage );
+         counters[stage].failed_count.fetch_add( 1, std::memory_order_relaxed );
+      }
+
+      {
+         std::scoped_lock lock( mutex );
+         errors.push_back( job.name + ": " + error );
+      }
+
+      failed_job_count.fetch_add( 1, std::memory_order_release );
+
+      if ( is_done( ) )
+      {
+         finish_time.store( get_time( ), std::memory_order_relaxed );
+      }
+   }
+
+   void loading_pipeline::finish_job( )
+   {
+      completed_job_count.fetch_add( 1, std::memory_order_release );
+      
+      if ( is_done( ) )
+      {
+         finish_time.store( get_time( ), std::memory_order_relaxed );
+      }
+   }
+} // namespace assets
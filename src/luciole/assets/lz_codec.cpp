@@ -0,0 +1,326 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/lz_codec.hpp>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#  include <emmintrin.h>
+#  define LUCIOLE_LZ_CODEC_SSE2
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace assets
+{
+   namespace
+   {
+      static constexpr std::size_t min_match = 4;
+      static constexpr std::size_t max_offset = 65535;
+
+      /* The last bytes of the input that are always literals */
+      static constexpr std::size_t last_literals = 12;
+      /* How far from the end a match may reach */
+      static constexpr std::size_t match_end_margin = 5;
+
+      static constexpr std::uint32_t hash_bits = 12;
+
+      inline std::uint32_t read_32( std::byte const* p_src ) noexcept
+      {
+         std::uint32_t value;
+         std::memcpy( &value, p_src, sizeof( value ) );
+
+         return value;
+      }
+
+      inline std::uint32_t hash_sequence( std::uint32_t sequence ) noexcept
+      {
+         return ( sequence * 2654435761u ) >> ( 32 - hash_bits );
+      }
+
+      /**
+       * @brief Copy 16 bytes, which may overwrite bytes past the end of
+       * what is needed.
+       */
+      inline void copy_16( std::byte* p_dst, std::byte const* p_src ) noexcept
+      {
+#if defined( LUCIOLE_LZ_CODEC_SSE2 )
+         _mm_storeu_si128( reinterpret_cast<__m128i*>( p_dst ), _mm_loadu_si128( reinterpret_cast<__m128i const*>( p_src ) ) );
+#else
+         std::memcpy( p_dst, p_src, 16 );
+#endif
+      }
+
+      /**
+       * @brief Write the continuation bytes of a length of 15 or more.
+       */
+      inline std::byte* write_length( std::byte* p_dst, std::size_t length ) noexcept
+      {
+         for( ; length >= 255; length -= 255 )
+         {
+            *p_dst++ = std::byte{ 255 };
+         }
+
+         *p_dst++ = static_cast<std::byte>( length );
+
+         return p_dst;
+      }
+
+      /**
+       * @brief Read the continuation bytes of a length.
+       *
+       * @return Whether the input did not end in the middle of the length.
+       */
+      inline bool read_length( std::byte const*& p_src, std::byte const* p_src_end, std::size_t& length ) noexcept
+      {
+         std::uint8_t value = 255;
+         while( value == 255 )
+         {
+            if ( p_src == p_src_end )
+            {
+               return false;
+            }
+
+            value = static_cast<std::uint8_t>( *p_src++ );
+            length += value;
+         }
+
+         return true;
+      }
+
+      /**
+       * @brief Write a sequence, or only its literals when match_length
+       * is 0.
+       *
+       * @return The end of the written sequence, or null if it does not
+       * fit before p_dst_end.
+       */
+      std::byte* write_sequence( 
+         std::byte* p_dst, std::byte* p_dst_end, 
+         std::byte const* p_literals, std::size_t literal_length, 
+         std::size_t offset, std::size_t match_length ) noexcept
+      {
+         std::size_t const worst_size = 1 + ( literal_length / 255 + 1 ) + literal_length + 2 + ( match_length / 255 + 1 );
+         if ( static_cast<std::size_t>( p_dst_end - p_dst ) < worst_size )
+         {
+            return nullptr;
+         }
+
+         auto* p_token = p_dst++;
+
+         std::uint8_t token = 0;
+         if ( literal_length >= 15 )
+         {
+            token = 15 << 4;
+            p_dst = write_length( p_dst, literal_length - 15 );
+         }
+         else
+         {
+            token = static_cast<std::uint8_t>( literal_length << 4 );
+         }
+
+         if ( literal_length != 0 )
+         {
+            std::memcpy( p_dst, p_literals, literal_length );
+            p_dst += literal_length;
+         }
+
+         if ( match_length != 0 )
+         {
+            *p_dst++ = static_cast<std::byte>( offset & 0xff );
+            *p_dst++ = static_cast<std::byte>( offset >> 8 );
+
+            std::size_t const length_code = match_length - min_match;
+            if ( length_code >= 15 )
+            {
+               token |= 15;
+               p_dst = write_length( p_dst, length_code - 15 );
+            }
+            else
+            {
+               token |= static_cast<std::uint8_t>( length_code );
+            }
+         }
+
+         *p_token = static_cast<std::byte>( token );
+
+         return p_dst;
+      }
+   } // namespace
+
+   std::size_t compress_lz( std::byte const* p_src, std::size_t src_size, std::byte* p_dst, std::size_t dst_capacity ) noexcept
+   {
+      auto* const p_dst_begin = p_dst;
+      auto* const p_dst_end = p_dst + dst_capacity;
+
+      std::size_t anchor = 0;
+
+      if ( src_size > last_literals + min_match )
+      {
+         std::uint32_t table[1u << hash_bits] = { };
+
+         std::size_t const match_limit = src_size - last_literals;
+         std::size_t const match_end_limit = src_size - match_end_margin;
+
+         std::size_t position = 0;
+         while( position < match_limit )
+         {
+            std::uint32_t const sequence = read_32( p_src + position );
+            std::uint32_t const hash = hash_sequence( sequence );
+
+            /* positions are stored plus one so 0 means empty */
+            std::size_t const candidate = table[hash];
+            table[hash] = static_cast<std::uint32_t>( position + 1 );
+
+            if ( candidate == 0 || position - ( candidate - 1 ) > max_offset || read_32( p_src + candidate - 1 ) != sequence )
+            {
+               // Skip faster through data that does not compress.
+               position += 1 + ( ( position - anchor ) >> 6 );
+
+               continue;
+            }
+
+            std::size_t const match = candidate - 1;
+
+            std::size_t length = min_match;
+            while( position + length < match_end_limit && p_src[match + length] == p_src[position + length] )
+            {
+               ++length;
+            }
+
+            p_dst = write_sequence( p_dst, p_dst_end, p_src + anchor, position - anchor, position - match, length );
+            if ( p_dst == nullptr )
+            {
+               return 0;
+            }
+
+            position += length;
+            anchor = position;
+
+            if ( position - 2 < match_limit )
+            {
+               table[hash_sequence( read_32( p_src + position - 2 ) )] = static_cast<std::uint32_t>( position - 1 );
+            }
+         }
+      }
+
+      p_dst = write_sequence( p_dst, p_dst_end, p_src + anchor, src_size - anchor, 0, 0 );
+      if ( p_dst == nullptr )
+      {
+         return 0;
+      }
+
+      return static_cast<std::size_t>( p_dst - p_dst_begin );
+   }
+
+   bool decompress_lz( std::byte const* p_src, std::size_t src_size, std::byte* p_dst, std::size_t dst_size ) noexcept
+   {
+      auto const* const p_src_end = p_src + src_size;
+      auto* const p_dst_begin = p_dst;
+      auto* const p_dst_end = p_dst + dst_size;
+
+      while( p_src < p_src_end )
+      {
+         auto const token = static_cast<std::uint8_t>( *p_src++ );
+
+         std::size_t literal_length = token >> 4;
+         if ( literal_length == 15 && !read_length( p_src, p_src_end, literal_length ) )
+         {
+            return false;
+         }
+
+         if ( literal_length > static_cast<std::size_t>( p_src_end - p_src ) || 
+            literal_length > static_cast<std::size_t>( p_dst_end - p_dst ) )
+         {
+            return false;
+         }
+
+         if ( p_src_end - p_src >= static_cast<std::ptrdiff_t>( literal_length + 16 ) && 
+            p_dst_end - p_dst >= static_cast<std::ptrdiff_t>( literal_length + 16 ) )
+         {
+            for( std::size_t i = 0; i < literal_length; i += 16 )
+            {
+               copy_16( p_dst + i, p_src + i );
+            }
+         }
+         else if ( literal_length != 0 )
+         {
+            std::memcpy( p_dst, p_src, literal_length );
+         }
+
+         p_src += literal_length;
+         p_dst += literal_length;
+
+         if ( p_src == p_src_end )
+         {
+            break;
+         }
+
+         if ( p_src_end - p_src < 2 )
+         {
+            return false;
+         }
+
+         std::size_t const offset = static_cast<std::size_t>( p_src[0] ) | ( static_cast<std::size_t>( p_src[1] ) << 8 );
+         p_src += 2;
+
+         if ( offset == 0 || offset > static_cast<std::size_t>( p_dst - p_dst_begin ) )
+         {
+            return false;
+         }
+
+         std::size_t match_length = token & 15;
+         if ( match_length == 15 && !read_length( p_src, p_src_end, match_length ) )
+         {
+            return false;
+         }
+         match_length += min_match;
+
+         if ( match_length > static_cast<std::size_t>( p_dst_end - p_dst ) )
+         {
+            return false;
+         }
+
+         std::byte const* p_match = p_dst - offset;
+         if ( offset >= 16 && p_dst_end - p_dst >= static_cast<std::ptrdiff_t>( match_length + 16 ) )
+         {
+            for( std::size_t i = 0; i < match_length; i += 16 )
+            {
+               copy_16( p_dst + i, p_match + i );
+            }
+         }
+         else
+         {
+            // An overlapping match repeats a pattern of offset bytes. Each
+            // copy doubles the length of the pattern written so far, so
+            // the copies never overlap.
+            std::size_t distance = offset;
+            for( std::size_t copied = 0; copied < match_length; distance *= 2 )
+            {
+               std::size_t const count = std::min( distance, match_length - copied );
+               std::memcpy( p_dst + copied, p_dst + copied - distance, count );
+               copied += count;
+            }
+         }
+
+         p_dst += match_length;
+      }
+
+      return p_dst == p_dst_end;
+   }
+} // namespace assets
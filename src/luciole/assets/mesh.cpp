@@ -0,0 +1,212 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/mesh.hpp>
+#include <luciole/vk/buffers/queue_ownership.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace assets
+{
+   mesh_scene::mesh_scene( 
+      context const* p_context, 
+      vk::buffer_allocation vertex_buffer, vk::buffer_allocation index_buffer, VkIndexType index_type,
+      std::vector<mesh>&& meshes, std::vector<scene_node>&& nodes )
+      :
+      p_context( p_context ),
+      vertex_buffer( vertex_buffer ),
+      index_buffer( index_buffer ),
+      index_type( index_type ),
+      meshes( std::move( meshes ) ),
+      nodes( std::move( nodes ) )
+   { }
+
+   mesh_scene::mesh_scene( mesh_scene&& rhs )
+   {
+      *this = std::move( rhs );
+   }
+
+   mesh_scene::~mesh_scene( )
+   {
+      if ( p_context != nullptr )
+      {
+         p_context->destroy_buffer( index_buffer );
+         p_context->destroy_buffer( vertex_buffer );
+      }
+   }
+
+   mesh_scene& mesh_scene::operator=( mesh_scene&& rhs )
+   {
+      if ( this != &rhs )
+      {
+         if ( p_context != nullptr )
+         {
+            p_context->destroy_buffer( index_buffer );
+            p_context->destroy_buffer( vertex_buffer );
+         }
+
+         p_context = rhs.p_context;
+         rhs.p_context = nullptr;
+
+         vertex_buffer = rhs.vertex_buffer;
+         rhs.vertex_buffer = { };
+
+         index_buffer = rhs.index_buffer;
+         rhs.index_buffer = { };
+
+         index_type = rhs.index_type;
+
+         meshes = std::move( rhs.meshes );
+         nodes = std::move( rhs.nodes );
+      }
+
+      return *this;
+   }
+
+   VkBuffer mesh_scene::get_vertex_buffer( ) const
+   {
+      return vertex_buffer.handle;
+   }
+
+   VkBuffer mesh_scene::get_index_buffer( ) const
+   {
+      return index_buffer.handle;
+   }
+
+   VkIndexType mesh_scene::get_index_type( ) const
+   {
+      return index_type;
+   }
+
+   std::vector<mesh> const& mesh_scene::get_meshes( ) const
+   {
+      return meshes;
+   }
+
+   std::vector<scene_node> const& mesh_scene::get_nodes( ) const
+   {
+      return nodes;
+   }
+
+   mesh_scene upload_meshes( context const* p_context, mesh_import&& import )
+   {
+      auto upload = upload_meshes_async( p_context, std::move( import ) );
+
+      vk::wait_for_submission( p_context, upload.submission );
+      vk::release_submission( p_context, upload.submission );
+
+      return std::move( upload.scene );
+   }
+
+   pending_mesh_upload upload_meshes_async( context const* p_context, mesh_import&& import )
+   {
+      auto const create_device_buffer = [p_context, &import] ( VkDeviceSize size, VkBufferUsageFlags usage, vk::memory_category category )
+      {
+         VkBufferCreateInfo const buffer_create_info
+         {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .size = std::max<VkDeviceSize>( size, 4 ),
+            .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr
+         };
+
+         VmaAllocationCreateInfo allocation_info = { };
+         allocation_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+         auto temp_buffer = p_context->create_buffer(
+            vk::buffer_create_info_t( buffer_create_info ),
+            vk::allocation_create_info_t( allocation_info ),
+            category
+         );
+
+         if ( auto const* p_val = std::get_if<vk::buffer_allocation>( &temp_buffer ) )
+         {
+            return *p_val;
+         }
+         else
+         {
+            throw std::runtime_error{ "Error creating the buffers of: " + import.filepath + "." };
+         }
+      };
+
+      /* the scene only owns the buffers once both exist */
+      auto const vertex_buffer = create_device_buffer( import.vertex_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vk::memory_category::e_vertex_buffer );
+
+      vk::buffer_allocation index_buffer;
+      try
+      {
+         index_buffer = create_device_buffer( import.index_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, vk::memory_category::e_index_buffer );
+      }
+      catch( ... )
+      {
+         p_context->destroy_buffer( vertex_buffer );
+         throw;
+      }
+
+      mesh_scene scene(
+         p_context,
+         vertex_buffer,
+         index_buffer,
+         import.index_type,
+         std::move( import.meshes ),
+         std::move( import.nodes )
+      );
+
+      vk::batch_upload_info batch
+      {
+         .p_context = p_context,
+         .staging_buffer = import.staging.get_buffer( ),
+         .copies = { },
+         .dst_queue = queue::flag::e_graphics,
+         .dst_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+         .dst_access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+      };
+
+      if ( import.vertex_size != 0 )
+      {
+         batch.copies.push_back( vk::staging_copy{ 
+            .p_dst = &vertex_buffer, .src_offset = import.vertex_offset, .dst_offset = 0, .size = import.vertex_size 
+         } );
+      }
+
+      if ( import.index_size != 0 )
+      {
+         batch.copies.push_back( vk::staging_copy{ 
+            .p_dst = &index_buffer, .src_offset = import.index_offset, .dst_offset = 0, .size = import.index_size 
+         } );
+      }
+
+      auto temp_submission = vk::upload_batch_async( vk::batch_upload_info_t( batch ) );
+      if ( std::get_if<vk::error>( &temp_submission ) != nullptr )
+      {
+         throw std::runtime_error{ "Error uploading: " + import.filepath + "." };
+      }
+
+      return pending_mesh_upload
+      {
+         .scene = std::move( scene ),
+         .staging = std::move( import.staging ),
+         .submission = std::get<vk::pending_submission>( temp_submission )
+      };
+   }
+} // namespace assets
@@ -0,0 +1,429 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/derived_data_cache.hpp>
+#include <luciole/assets/lz_codec.hpp>
+#include <luciole/assets/pack_file.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+namespace assets
+{
+   namespace
+   {
+      template<typename T>
+      void append( std::vector<std::byte>& out, T const* p_data, std::size_t count )
+      {
+         auto const* p_bytes = reinterpret_cast<std::byte const*>( p_data );
+         out.insert( out.end( ), p_bytes, p_bytes + count * sizeof( T ) );
+      }
+
+      /**
+       * @brief Whether [offset, offset + size) lies inside a range of
+       * range_size, without overflowing.
+       */
+      bool is_in_range( std::uint64_t offset, std::uint64_t size, std::uint64_t range_size )
+      {
+         return offset <= range_size && size <= range_size - offset;
+      }
+
+      std::uint32_t get_block_count( std::uint64_t size ) noexcept
+      {
+         return static_cast<std::uint32_t>( ( size + pack_block_size - 1 ) / pack_block_size );
+      }
+   } // namespace
+
+   std::uint64_t hash_pack_path( std::string_view path ) noexcept
+   {
+      return hash_bytes( path.data( ), path.size( ) );
+   }
+
+   void pack_writer::add( std::string path, std::vector<std::byte> data, bool compress )
+   {
+      files.push_back( file{ std::move( path ), std::move( data ), compress } );
+   }
+
+   std::vector<std::byte> pack_writer::build( thread_pool* p_thread_pool ) const
+   {
+      /* ENTRIES */
+      std::vector<std::uint32_t> order( files.size( ) );
+      std::vector<std::uint64_t> hashes( files.size( ) );
+      for( std::uint32_t i = 0; i < files.size( ); ++i )
+      {
+         order[i] = i;
+         hashes[i] = hash_pack_path( files[i].path );
+      }
+
+      std::sort( order.begin( ), order.end( ), [&] ( std::uint32_t lhs, std::uint32_t rhs ) {
+         return std::tie( hashes[lhs], files[lhs].path ) < std::tie( hashes[rhs], files[rhs].path );
+      } );
+
+      std::vector<pack_entry> entries;
+      entries.reserve( files.size( ) );
+
+      std::string paths;
+      std::uint32_t block_count = 0;
+      for( std::size_t i = 0; i < order.size( ); ++i )
+      {
+         auto const& src = files[order[i]];
+         if ( i > 0 && src.path == files[order[i - 1]].path )
+         {
+            throw std::runtime_error{ "Duplicate path in pack: " + src.path + "." };
+         }
+
+         entries.push_back( pack_entry
+         {
+            .path_hash = hashes[order[i]],
+            .path_offset = static_cast<std::uint32_t>( paths.size( ) ),
+            .path_size = static_cast<std::uint32_t>( src.path.size( ) ),
+            .size = src.data.size( ),
+            .first_block = block_count,
+            .block_count = get_block_count( src.data.size( ) )
+         } );
+
+         paths += src.path;
+         block_count += entries.back( ).block_count;
+      }
+
+      /* BLOCKS */
+      struct block_source
+      {
+         file const* p_file = nullptr;
+         std::size_t offset = 0;
+         std::size_t size = 0;
+      }; // struct block_source
+
+      std::vector<block_source> sources;
+      sources.reserve( block_count );
+      for( std::size_t i = 0; i < entries.size( ); ++i )
+      {
+         auto const& src = files[order[i]];
+         for( std::size_t offset = 0; offset < src.data.size( ); offset += pack_block_size )
+         {
+            sources.push_back( block_source{ &src, offset, std::min<std::size_t>( pack_block_size, src.data.size( ) - offset ) } );
+         }
+      }
+
+      std::vector<std::vector<std::byte>> compressed( sources.size( ) );
+      auto const compress_block = [&sources, &compressed] ( std::size_t i ) 
+      {
+         auto const& source = sources[i];
+         if ( !source.p_file->compress )
+         {
+            return;
+         }
+
+         auto& out = compressed[i];
+         out.resize( get_lz_bound( source.size ) );
+
+         std::size_t const size = compress_lz( source.p_file->data.data( ) + source.offset, source.size, out.data( ), out.size( ) );
+         if ( size == 0 || size >= source.size )
+         {
+            out.clear( );
+         }
+         else
+         {
+            out.resize( size );
+            out.shrink_to_fit( );
+         }
+      };
+
+      if ( p_thread_pool != nullptr )
+      {
+         p_thread_pool->parallel_for( 0, sources.size( ), 4, compress_block );
+      }
+      else
+      {
+         for( std::size_t i = 0; i < sources.size( ); ++i )
+         {
+            compress_block( i );
+         }
+      }
+
+      /* TABLES */
+      pack_header header
+      {
+         .entry_count = static_cast<std::uint32_t>( entries.size( ) ),
+         .block_count = block_count
+      };
+
+      header.entry_table_offset = sizeof( pack_header );
+      header.block_table_offset = header.entry_table_offset + entries.size( ) * sizeof( pack_entry );
+      header.path_table_offset = header.block_table_offset + std::uint64_t( block_count ) * sizeof( pack_block );
+
+      std::vector<pack_block> blocks( block_count );
+
+      std::uint64_t offset = header.path_table_offset + paths.size( );
+      for( std::size_t i = 0; i < blocks.size( ); ++i )
+      {
+         bool const is_compressed = !compressed[i].empty( );
+
+         blocks[i].offset = offset;
+         blocks[i].size = static_cast<std::uint32_t>( sources[i].size );
+         blocks[i].compressed_size = is_compressed ? static_cast<std::uint32_t>( compressed[i].size( ) ) : blocks[i].size;
+
+         offset += blocks[i].compressed_size;
+      }
+
+      header.file_size = offset;
+
+      std::vector<std::byte> out;
+      out.reserve( offset );
+
+      append( out, &header, 1 );
+      append( out, entries.data( ), entries.size( ) );
+      append( out, blocks.data( ), blocks.size( ) );
+      append( out, paths.data( ), paths.size( ) );
+
+      for( std::size_t i = 0; i < blocks.size( ); ++i )
+      {
+         if ( !compressed[i].empty( ) )
+         {
+            append( out, compressed[i].data( ), compressed[i].size( ) );
+         }
+         else
+         {
+            append( out, sources[i].p_file->data.data( ) + sources[i].offset, sources[i].size );
+         }
+      }
+
+      return out;
+   }
+
+   pack_file::pack_file( std::string const& filepath )
+      :
+      filepath( filepath ),
+      file( filepath )
+   {
+      auto const invalid = [&filepath] ( std::string const& reason )
+      {
+         return std::runtime_error{ "Invalid pack file: " + filepath + ". " + reason + "." };
+      };
+
+      std::uint64_t const file_size = file.size( );
+      if ( file_size < sizeof( pack_header ) )
+      {
+         throw invalid( "File too small" );
+      }
+
+      p_header = reinterpret_cast<pack_header const*>( file.data( ) );
+      if ( p_header->magic != pack_magic )
+      {
+         throw invalid( "Wrong magic number" );
+      }
+
+      if ( p_header->version != pack_version )
+      {
+         throw invalid( "Version " + std::to_string( p_header->version ) + " instead of " + std::to_string( pack_version ) );
+      }
+
+      if ( p_header->file_size != file_size || p_header->entry_table_offset % alignof( pack_entry ) != 0 ||
+         p_header->block_table_offset % alignof( pack_block ) != 0 )
+      {
+         throw invalid( "Header does not match the file" );
+      }
+
+      if ( !is_in_range( p_header->entry_table_offset, std::uint64_t( p_header->entry_count ) * sizeof( pack_entry ), file_size ) ||
+         !is_in_range( p_header->block_table_offset, std::uint64_t( p_header->block_count ) * sizeof( pack_block ), file_size ) ||
+         !is_in_range( p_header->path_table_offset, 0, file_size ) )
+      {
+         throw invalid( "Table out of the file" );
+      }
+
+      p_entries = reinterpret_cast<pack_entry const*>( file.data( ) + p_header->entry_table_offset );
+      p_blocks = reinterpret_cast<pack_block const*>( file.data( ) + p_header->block_table_offset );
+      p_paths = reinterpret_cast<char const*>( file.data( ) + p_header->path_table_offset );
+
+      for( std::uint32_t i = 0; i < p_header->block_count; ++i )
+      {
+         auto const& block = p_blocks[i];
+
+         bool const is_valid = 
+            block.size <= pack_block_size && block.compressed_size <= block.size &&
+            is_in_range( block.offset, block.compressed_size, file_size );
+
+         if ( !is_valid )
+         {
+            throw invalid( "Block " + std::to_string( i ) + " out of the file" );
+         }
+      }
+
+      for( std::uint32_t i = 0; i < p_header->entry_count; ++i )
+      {
+         auto const& entry = p_entries[i];
+
+         bool is_valid =
+            is_in_range( p_header->path_table_offset + entry.path_offset, entry.path_size, file_size ) &&
+            is_in_range( entry.first_block, entry.block_count, p_header->block_count ) &&
+            entry.block_count == get_block_count( entry.size );
+
+         /* every block but the last is full, so the blocks can be seeked */
+         for( std::uint32_t j = 0; is_valid && j < entry.block_count; ++j )
+         {
+            std::uint64_t const expected_size = std::min<std::uint64_t>( pack_block_size, entry.size - std::uint64_t( j ) * pack_block_size );
+            is_valid = p_blocks[entry.first_block + j].size == expected_size;
+         }
+
+         if ( !is_valid )
+         {
+            throw invalid( "Entry " + std::to_string( i ) + " out of the file" );
+         }
+      }
+   }
+
+   std::uint32_t pack_file::get_entry_count( ) const
+   {
+      return p_header != nullptr ? p_header->entry_count : 0;
+   }
+
+   std::string_view pack_file::get_path( std::uint32_t entry ) const
+   {
+      return std::string_view( p_paths + p_entries[entry].path_offset, p_entries[entry].path_size );
+   }
+
+   std::uint64_t pack_file::get_size( std::uint32_t entry ) const
+   {
+      return p_entries[entry].size;
+   }
+
+   std::optional<std::uint32_t> pack_file::find( std::string_view path ) const
+   {
+      std::uint64_t const hash = hash_pack_path( path );
+
+      auto const* p_end = p_entries + get_entry_count( );
+      auto const* p_entry = std::lower_bound( p_entries, p_end, hash, [] ( pack_entry const& entry, std::uint64_t value ) {
+         return entry.path_hash < value;
+      } );
+
+      for( ; p_entry != p_end && p_entry->path_hash == hash; ++p_entry )
+      {
+         auto const index = static_cast<std::uint32_t>( p_entry - p_entries );
+         if ( get_path( index ) == path )
+         {
+            return index;
+         }
+      }
+
+      return std::nullopt;
+   }
+
+   std::vector<std::byte> pack_file::read( std::uint32_t entry ) const
+   {
+      std::vector<std::byte> data( get_size( entry ) );
+      read( entry, 0, data.size( ), data.data( ) );
+
+      return data;
+   }
+
+   void pack_file::read( std::uint32_t entry, std::uint64_t offset, std::size_t size, std::byte* p_dst ) const
+   {
+      auto const& src = p_entries[entry];
+      if ( !is_in_range( offset, size, src.size ) )
+      {
+         throw std::runtime_error{ "Read out of entry " + std::string( get_path( entry ) ) + " in pack file: " + filepath + "." };
+      }
+
+      std::vector<std::byte> scratch;
+
+      std::uint64_t const end = offset + size;
+      for( std::uint64_t block_offset = offset / pack_block_size * pack_block_size; block_offset < end; block_offset += pack_block_size )
+      {
+         std::uint32_t const block = src.first_block + static_cast<std::uint32_t>( block_offset / pack_block_size );
+
+         std::uint64_t const first = std::max( offset, block_offset );
+         std::uint64_t const last = std::min<std::uint64_t>( end, block_offset + p_blocks[block].size );
+         auto* p_out = p_dst + ( first - offset );
+
+         bool is_valid = false;
+         if ( first == block_offset && last == block_offset + p_blocks[block].size )
+         {
+            /* whole blocks are decoded in place */
+            is_valid = decode_block( block, p_out );
+         }
+         else
+         {
+            scratch.resize( p_blocks[block].size );
+            is_valid = decode_block( block, scratch.data( ) );
+
+            std::memcpy( p_out, scratch.data( ) + ( first - block_offset ), last - first );
+         }
+
+         if ( !is_valid )
+         {
+            throw std::runtime_error{ "Corrupted block in entry " + std::string( get_path( entry ) ) + " of pack file: " + filepath + "." };
+         }
+      }
+   }
+
+   std::vector<std::vector<std::byte>> pack_file::read( std::vector<std::uint32_t> const& entries, thread_pool& pool ) const
+   {
+      std::vector<std::vector<std::byte>> data( entries.size( ) );
+
+      struct block_target
+      {
+         std::uint32_t block = 0;
+         std::byte* p_dst = nullptr;
+      }; // struct block_target
+
+      std::vector<block_target> targets;
+      for( std::size_t i = 0; i < entries.size( ); ++i )
+      {
+         auto const& src = p_entries[entries[i]];
+         data[i].resize( src.size );
+
+         for( std::uint32_t j = 0; j < src.block_count; ++j )
+         {
+            targets.push_back( block_target{ src.first_block + j, data[i].data( ) + std::uint64_t( j ) * pack_block_size } );
+         }
+      }
+
+      std::atomic<bool> is_valid = true;
+      pool.parallel_for( 0, targets.size( ), 1, [this, &targets, &is_valid] ( std::size_t i ) {
+         if ( !decode_block( targets[i].block, targets[i].p_dst ) )
+         {
+            is_valid.store( false, std::memory_order_relaxed );
+         }
+      } );
+
+      if ( !is_valid.load( std::memory_order_relaxed ) )
+      {
+         throw std::runtime_error{ "Corrupted block in pack file: " + filepath + "." };
+      }
+
+      return data;
+   }
+
+   bool pack_file::decode_block( std::uint32_t block, std::byte* p_dst ) const noexcept
+   {
+      auto const& src = p_blocks[block];
+      auto const* p_src = file.data( ) + src.offset;
+
+      if ( src.compressed_size == src.size )
+      {
+         std::memcpy( p_dst, p_src, src.size );
+
+         return true;
+      }
+
+      return decompress_lz( p_src, src.compressed_size, p_dst, src.size );
+   }
+} // namespace assets
@@ -0,0 +1,319 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/scene.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace assets
+{
+   namespace
+   {
+      static constexpr std::uint32_t scene_json_version = 1;
+
+      template<typename T>
+      void append( std::vector<std::byte>& out, T const* p_data, std::size_t count )
+      {
+         auto const* p_bytes = reinterpret_cast<std::byte const*>( p_data );
+         out.insert( out.end( ), p_bytes, p_bytes + count * sizeof( T ) );
+      }
+
+      /**
+       * @brief Whether [offset, offset + size) lies inside a range of
+       * range_size, without overflowing.
+       */
+      bool is_in_range( std::uint64_t offset, std::uint64_t size, std::uint64_t range_size )
+      {
+         return offset <= range_size && size <= range_size - offset;
+      }
+
+      /**
+       * @brief Whether a string referenced from a position of the file
+       * lies inside the string table.
+       */
+      bool is_valid_string( relative_string const& string, std::uint64_t position, scene_snapshot_header const& header )
+      {
+         auto const target = static_cast<std::int64_t>( position ) + string.offset;
+
+         return target >= static_cast<std::int64_t>( header.string_table_offset ) &&
+            is_in_range( static_cast<std::uint64_t>( target ) - header.string_table_offset, string.size, header.string_table_size );
+      }
+   } // namespace
+
+   void to_json( nlohmann::json& j, scene_entity const& entity )
+   {
+      j = nlohmann::json
+      {
+         { "name", entity.name },
+         { "parent", entity.parent },
+         { "translation", { entity.translation.x, entity.translation.y, entity.translation.z } },
+         { "rotation", { entity.rotation.x, entity.rotation.y, entity.rotation.z, entity.rotation.w } },
+         { "scale", { entity.scale.x, entity.scale.y, entity.scale.z } }
+      };
+
+      if ( !entity.mesh.empty( ) )
+      {
+         j["mesh"] = entity.mesh;
+         j["mesh_index"] = entity.mesh_index;
+      }
+   }
+
+   void from_json( nlohmann::json const& j, scene_entity& entity )
+   {
+      entity = scene_entity( );
+      entity.name = j.value( "name", std::string( ) );
+      entity.parent = j.value( "parent", -1 );
+      entity.mesh = j.value( "mesh", std::string( ) );
+      entity.mesh_index = j.value( "mesh_index", 0u );
+
+      if ( auto const it = j.find( "translation" ); it != j.end( ) )
+      {
+         auto const values = it->get<std::array<float, 3>>( );
+         entity.translation = glm::vec3( values[0], values[1], values[2] );
+      }
+
+      if ( auto const it = j.find( "rotation" ); it != j.end( ) )
+      {
+         auto const values = it->get<std::array<float, 4>>( );
+         entity.rotation = glm::quat( values[3], values[0], values[1], values[2] );
+      }
+
+      if ( auto const it = j.find( "scale" ); it != j.end( ) )
+      {
+         auto const values = it->get<std::array<float, 3>>( );
+         entity.scale = glm::vec3( values[0], values[1], values[2] );
+      }
+   }
+
+   void to_json( nlohmann::json& j, scene_description const& scene )
+   {
+      j = nlohmann::json
+      {
+         { "version", scene_json_version },
+         { "entities", scene.entities }
+      };
+   }
+
+   void from_json( nlohmann::json const& j, scene_description& scene )
+   {
+      scene.entities = j.at( "entities" ).get<std::vector<scene_entity>>( );
+   }
+
+   scene_description read_scene_json( std::string const& filepath )
+   {
+      std::ifstream file( filepath );
+      if ( !file.good( ) )
+      {
+         throw std::runtime_error{ "Error loading file at location: " + filepath + "." };
+      }
+
+      try
+      {
+         auto const json = nlohmann::json::parse( file );
+         if ( json.value( "version", 0u ) != scene_json_version )
+         {
+            throw std::runtime_error{ "Unsupported scene version in file: " + filepath + "." };
+         }
+
+         return json.get<scene_description>( );
+      }
+      catch( nlohmann::json::exception const& e )
+      {
+         throw std::runtime_error{ "Invalid scene file: " + filepath + ". " + e.what( ) };
+      }
+   }
+
+   void write_scene_json( scene_description const& scene, std::string const& filepath )
+   {
+      std::ofstream file( filepath );
+      if ( !file.good( ) )
+      {
+         throw std::runtime_error{ "Error opening file: " + filepath + "." };
+      }
+
+      file << nlohmann::json( scene ).dump( 3 );
+   }
+
+   std::vector<std::byte> cook_scene( scene_description const& scene )
+   {
+      /* STRINGS */
+      std::string strings;
+      std::unordered_map<std::string_view, std::uint64_t> string_offsets;
+
+      auto const add_string = [&strings, &string_offsets] ( std::string const& value ) 
+      {
+         auto const [it, is_new] = string_offsets.try_emplace( value, strings.size( ) );
+         if ( is_new )
+         {
+            strings += value;
+         }
+
+         return it->second;
+      };
+
+      /* TABLES */
+      scene_snapshot_header header
+      {
+         .entity_count = static_cast<std::uint32_t>( scene.entities.size( ) )
+      };
+
+      header.entity_table_offset = sizeof( scene_snapshot_header );
+      header.string_table_offset = header.entity_table_offset + scene.entities.size( ) * sizeof( scene_snapshot_entity );
+
+      auto const make_string = [&header, &add_string] ( std::string const& value, std::uint64_t position )
+      {
+         std::uint64_t const target = header.string_table_offset + add_string( value );
+
+         return relative_string
+         {
+            .offset = static_cast<std::int64_t>( target ) - static_cast<std::int64_t>( position ),
+            .size = static_cast<std::uint32_t>( value.size( ) )
+         };
+      };
+
+      std::vector<scene_snapshot_entity> entities;
+      entities.reserve( scene.entities.size( ) );
+      for( std::size_t i = 0; i < scene.entities.size( ); ++i )
+      {
+         auto const& src = scene.entities[i];
+         std::uint64_t const position = header.entity_table_offset + i * sizeof( scene_snapshot_entity );
+
+         auto& entity = entities.emplace_back( );
+         std::memcpy( entity.translation, &src.translation.x, sizeof( entity.translation ) );
+         std::memcpy( entity.scale, &src.scale.x, sizeof( entity.scale ) );
+
+         entity.rotation[0] = src.rotation.x;
+         entity.rotation[1] = src.rotation.y;
+         entity.rotation[2] = src.rotation.z;
+         entity.rotation[3] = src.rotation.w;
+
+         entity.parent = src.parent;
+         entity.mesh_index = src.mesh_index;
+
+         entity.name = make_string( src.name, position + offsetof( scene_snapshot_entity, name ) );
+         entity.mesh = make_string( src.mesh, position + offsetof( scene_snapshot_entity, mesh ) );
+      }
+
+      header.string_table_size = strings.size( );
+      header.file_size = header.string_table_offset + strings.size( );
+
+      std::vector<std::byte> out;
+      out.reserve( header.file_size );
+
+      append( out, &header, 1 );
+      append( out, entities.data( ), entities.size( ) );
+      append( out, strings.data( ), strings.size( ) );
+
+      return out;
+   }
+
+   scene_snapshot::scene_snapshot( std::string const& filepath )
+      :
+      filepath( filepath ),
+      file( filepath )
+   {
+      auto const invalid = [&filepath] ( std::string const& reason )
+      {
+         return std::runtime_error{ "Invalid scene snapshot: " + filepath + ". " + reason + "." };
+      };
+
+      std::uint64_t const file_size = file.size( );
+      if ( file_size < sizeof( scene_snapshot_header ) )
+      {
+         throw invalid( "File too small" );
+      }
+
+      p_header = reinterpret_cast<scene_snapshot_header const*>( file.data( ) );
+      if ( p_header->magic != scene_snapshot_magic )
+      {
+         throw invalid( "Wrong magic number" );
+      }
+
+      if ( p_header->version != scene_snapshot_version )
+      {
+         throw invalid( "Version " + std::to_string( p_header->version ) + " instead of " + std::to_string( scene_snapshot_version ) );
+      }
+
+      if ( p_header->file_size != file_size || p_header->entity_table_offset % alignof( scene_snapshot_entity ) != 0 )
+      {
+         throw invalid( "Header does not match the file" );
+      }
+
+      if ( !is_in_range( p_header->entity_table_offset, std::uint64_t( p_header->entity_count ) * sizeof( scene_snapshot_entity ), file_size ) ||
+         !is_in_range( p_header->string_table_offset, p_header->string_table_size, file_size ) )
+      {
+         throw invalid( "Table out of the file" );
+      }
+
+      p_entities = reinterpret_cast<scene_snapshot_entity const*>( file.data( ) + p_header->entity_table_offset );
+
+      auto const entity_count = static_cast<std::int64_t>( p_header->entity_count );
+      for( std::uint32_t i = 0; i < p_header->entity_count; ++i )
+      {
+         auto const& entity = p_entities[i];
+         std::uint64_t const position = p_header->entity_table_offset + std::uint64_t( i ) * sizeof( scene_snapshot_entity );
+
+         bool const is_valid =
+            entity.parent >= -1 && entity.parent < entity_count &&
+            is_valid_string( entity.name, position + offsetof( scene_snapshot_entity, name ), *p_header ) &&
+            is_valid_string( entity.mesh, position + offsetof( scene_snapshot_entity, mesh ), *p_header );
+
+         if ( !is_valid )
+         {
+            throw invalid( "Entity " + std::to_string( i ) + " out of the file" );
+         }
+      }
+   }
+
+   std::uint32_t scene_snapshot::get_entity_count( ) const
+   {
+      return p_header != nullptr ? p_header->entity_count : 0;
+   }
+
+   scene_snapshot_entity const& scene_snapshot::get_entity( std::uint32_t index ) const
+   {
+      return p_entities[index];
+   }
+
+   scene_description scene_snapshot::to_description( ) const
+   {
+      scene_description scene;
+      scene.entities.reserve( get_entity_count( ) );
+
+      for( std::uint32_t i = 0; i < get_entity_count( ); ++i )
+      {
+         auto const& src = p_entities[i];
+
+         auto& entity = scene.entities.emplace_back( );
+         entity.name = src.name.get( );
+         entity.parent = src.parent;
+         entity.translation = glm::vec3( src.translation[0], src.translation[1], src.translation[2] );
+         entity.rotation = glm::quat( src.rotation[3], src.rotation[0], src.rotation[1], src.rotation[2] );
+         entity.scale = glm::vec3( src.scale[0], src.scale[1], src.scale[2] );
+         entity.mesh = src.mesh.get( );
+         entity.mesh_index = src.mesh_index;
+      }
+
+      return scene;
+   }
+} // namespace assets
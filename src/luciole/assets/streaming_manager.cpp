@@ -0,0 +1,395 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/streaming_manager.hpp>
+#include <luciole/assets/cooked_mesh.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace assets
+{
+   namespace
+   {
+      template<typename T>
+      bool is_ready( std::future<T> const& future )
+      {
+         return future.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready;
+      }
+   } // namespace
+
+   streaming_manager::streaming_manager( create_info_t const& create_info ) 
+      :
+      p_context( create_info.value( ).p_context ),
+      p_thread_pool( create_info.value( ).p_thread_pool ),
+      memory_budget( create_info.value( ).memory_budget ),
+      upload_budget( create_info.value( ).upload_budget ),
+      max_pending_loads( create_info.value( ).max_pending_loads ),
+      frames_in_flight( create_info.value( ).frames_in_flight )
+   {
+      if ( memory_budget == 0 )
+      {
+         memory_budget = p_context->get_device_local_heap_size( ) / 4 * 3;
+      }
+
+      texture_loader::create_info const loader_create_info
+      {
+         .p_context = p_context,
+         .p_thread_pool = p_thread_pool
+      };
+
+      textures = texture_loader( texture_loader::create_info_t( loader_create_info ) );
+   }
+
+   streaming_manager::~streaming_manager( )
+   {
+      for( auto const id : uploading )
+      {
+         vk::wait_for_submission( p_context, assets[id].upload );
+         vk::release_submission( p_context, assets[id].upload );
+      }
+
+      for( auto const id : loading )
+      {
+         if ( assets[id].kind == asset_kind::e_texture )
+         {
+            assets[id].pending_image.wait( );
+         }
+         else
+         {
+            assets[id].pending_mesh.wait( );
+         }
+      }
+   }
+
+   asset_id streaming_manager::add_texture( std::string const& filepath, color_space space )
+   {
+      auto& texture = assets.emplace_back( );
+      texture.kind = asset_kind::e_texture;
+      texture.filepath = filepath;
+      texture.space = space;
+
+      return static_cast<asset_id>( assets.size( ) - 1 );
+   }
+
+   asset_id streaming_manager::add_mesh( std::string const& filepath )
+   {
+      auto& mesh = assets.emplace_back( );
+      mesh.kind = asset_kind::e_mesh;
+      mesh.filepath = filepath;
+
+      return static_cast<asset_id>( assets.size( ) - 1 );
+   }
+
+   void streaming_manager::request( asset_id id, float screen_coverage, float distance )
+   {
+      auto& requested_asset = assets[id];
+
+      float const priority = compute_priority( screen_coverage, distance );
+      if ( requested_asset.last_requested_frame == frame )
+      {
+         requested_asset.priority = std::max( requested_asset.priority, priority );
+
+         return;
+      }
+
+      requested_asset.last_requested_frame = frame;
+      requested_asset.priority = priority;
+      requested.push_back( id );
+
+      if ( requested_asset.state == residency::e_resident )
+      {
+         lru.splice( lru.end( ), lru, requested_asset.lru_it );
+      }
+   }
+
+   void streaming_manager::update( )
+   {
+      release_retired( );
+      poll_uploads( );
+      poll_loads( );
+      upload_decoded( );
+      start_loads( );
+
+      requested.clear( );
+      ++frame;
+   }
+
+   residency streaming_manager::get_residency( asset_id id ) const
+   {
+      return assets[id].state;
+   }
+
+   vk::texture const* streaming_manager::get_texture( asset_id id ) const
+   {
+      auto const& texture = assets[id];
+
+      return texture.kind == asset_kind::e_texture && texture.state == residency::e_resident ? &texture.texture : nullptr;
+   }
+
+   mesh_scene const* streaming_manager::get_mesh( asset_id id ) const
+   {
+      auto const& mesh = assets[id];
+
+      return mesh.kind == asset_kind::e_mesh && mesh.state == residency::e_resident ? &mesh.mesh : nullptr;
+   }
+
+   streaming_manager::stats streaming_manager::get_stats( ) const
+   {
+      return stats
+      {
+         .resident_count = static_cast<std::uint32_t>( lru.size( ) ),
+         .pending_count = static_cast<std::uint32_t>( loading.size( ) + decoded.size( ) + uploading.size( ) ),
+         .resident_bytes = resident_bytes,
+         .memory_budget = memory_budget,
+         .uploaded_bytes = uploaded_bytes,
+         .eviction_count = eviction_count
+      };
+   }
+
+   float streaming_manager::compute_priority( float screen_coverage, float distance ) noexcept
+   {
+      return std::clamp( screen_coverage, 0.0f, 1.0f ) + 1.0f / ( 1.0f + std::max( distance, 0.0f ) );
+   }
+
+   void streaming_manager::poll_loads( )
+   {
+      auto const done = std::remove_if( loading.begin( ), loading.end( ), [this] ( asset_id id ) 
+      {
+         auto& loaded = assets[id];
+
+         try
+         {
+            if ( loaded.kind == asset_kind::e_texture )
+            {
+               if ( !is_ready( loaded.pending_image ) )
+               {
+                  return false;
+               }
+
+               loaded.image = loaded.pending_image.get( );
+
+               // A generated mip chain adds a third of the base level.
+               auto const pixel_size = static_cast<VkDeviceSize>( loaded.image.pixels.size( ) );
+               loaded.size = loaded.image.levels.empty( ) ? pixel_size + pixel_size / 3 : pixel_size;
+            }
+            else
+            {
+               if ( !is_ready( loaded.pending_mesh ) )
+               {
+                  return false;
+               }
+
+               loaded.import = loaded.pending_mesh.get( );
+               loaded.size = loaded.import.vertex_size + loaded.import.index_size;
+            }
+
+            loaded.state = residency::e_decoded;
+            decoded.push_back( id );
+         }
+         catch( std::exception const& )
+         {
+            loaded.state = residency::e_failed;
+         }
+
+         return true;
+      } );
+
+      loading.erase( done, loading.end( ) );
+   }
+
+   void streaming_manager::poll_uploads( )
+   {
+      auto const done = std::remove_if( uploading.begin( ), uploading.end( ), [this] ( asset_id id ) 
+      {
+         auto& uploaded = assets[id];
+         if ( !vk::is_submission_done( p_context, uploaded.upload ) )
+         {
+            return false;
+         }
+
+         vk::release_submission( p_context, uploaded.upload );
+         uploaded.upload_staging = vk::staging_buffer( );
+
+         uploaded.state = residency::e_resident;
+         uploaded.lru_it = lru.insert( lru.end( ), id );
+
+         return true;
+      } );
+
+      uploading.erase( done, uploading.end( ) );
+   }
+
+   void streaming_manager::upload_decoded( )
+   {
+      uploaded_bytes = 0;
+
+      std::stable_sort( decoded.begin( ), decoded.end( ), [this] ( asset_id lhs, asset_id rhs ) {
+         return assets[lhs].priority > assets[rhs].priority;
+      } );
+
+      std::size_t handled_count = 0;
+      for( ; handled_count < decoded.size( ); ++handled_count )
+      {
+         asset_id const id = decoded[handled_count];
+         auto& uploaded = assets[id];
+
+         if ( handled_count > 0 && uploaded_bytes + uploaded.size > upload_budget )
+         {
+            break;
+         }
+
+         // Assets that are no longer requested only get the memory that
+         // is free, and are dropped otherwise.
+         bool const is_requested = uploaded.last_requested_frame == frame;
+         if ( !is_requested && p_context->get_device_memory_usage( ) + uploaded.size > memory_budget + retired_bytes )
+         {
+            uploaded.state = residency::e_unloaded;
+            uploaded.image = image_data( );
+            uploaded.import = mesh_import( );
+
+            continue;
+         }
+
+         if ( !make_room( uploaded.size ) )
+         {
+            break;
+         }
+
+         try
+         {
+            // Nothing waits on the GPU here, poll_uploads makes the
+            // asset resident once its fence is signaled.
+            if ( uploaded.kind == asset_kind::e_texture )
+            {
+               auto upload = textures.upload_async( uploaded.image );
+               uploaded.texture = std::move( upload.texture );
+               uploaded.upload_staging = std::move( upload.staging );
+               uploaded.upload = upload.submission;
+               uploaded.image = image_data( );
+            }
+            else
+            {
+               auto upload = upload_meshes_async( p_context, std::move( uploaded.import ) );
+               uploaded.mesh = std::move( upload.scene );
+               uploaded.upload_staging = std::move( upload.staging );
+               uploaded.upload = upload.submission;
+               uploaded.import = mesh_import( );
+            }
+
+            uploaded.state = residency::e_uploading;
+            uploading.push_back( id );
+            resident_bytes += uploaded.size;
+         }
+         catch( std::exception const& )
+         {
+            uploaded.state = residency::e_failed;
+            uploaded.image = image_data( );
+            uploaded.import = mesh_import( );
+         }
+
+         uploaded_bytes += uploaded.size;
+      }
+
+      decoded.erase( decoded.begin( ), decoded.begin( ) + static_cast<std::ptrdiff_t>( handled_count ) );
+   }
+
+   void streaming_manager::start_loads( )
+   {
+      std::stable_sort( requested.begin( ), requested.end( ), [this] ( asset_id lhs, asset_id rhs ) {
+         return assets[lhs].priority > assets[rhs].priority;
+      } );
+
+      for( auto const id : requested )
+      {
+         if ( loading.size( ) >= max_pending_loads )
+         {
+            break;
+         }
+
+         auto& loaded = assets[id];
+         if ( loaded.state != residency::e_unloaded )
+         {
+            continue;
+         }
+
+         if ( loaded.kind == asset_kind::e_texture )
+         {
+            loaded.pending_image = textures.decode_async( loaded.filepath, loaded.space );
+         }
+         else
+         {
+            loaded.pending_mesh = p_thread_pool->submit( [p_context = p_context, filepath = loaded.filepath] {
+               return cooked_mesh_file( filepath ).stage_all( p_context );
+            } );
+         }
+
+         loaded.state = residency::e_loading;
+         loading.push_back( id );
+      }
+   }
+
+   bool streaming_manager::make_room( VkDeviceSize size )
+   {
+      // Retired assets count as freed, they are destroyed a few frames later.
+      while( p_context->get_device_memory_usage( ) + size > memory_budget + retired_bytes )
+      {
+         if ( lru.empty( ) || assets[lru.front( )].last_requested_frame == frame )
+         {
+            return false;
+         }
+
+         evict( lru.front( ) );
+      }
+
+      return true;
+   }
+
+   void streaming_manager::evict( asset_id id )
+   {
+      auto& evicted = assets[id];
+
+      retired.push_back( retired_asset
+      {
+         .frame = frame,
+         .size = evicted.size,
+         .texture = std::move( evicted.texture ),
+         .mesh = std::move( evicted.mesh )
+      } );
+
+      lru.erase( evicted.lru_it );
+      evicted.state = residency::e_unloaded;
+
+      resident_bytes -= evicted.size;
+      retired_bytes += evicted.size;
+      ++eviction_count;
+   }
+
+   void streaming_manager::release_retired( )
+   {
+      std::size_t released_count = 0;
+      while( released_count < retired.size( ) && retired[released_count].frame + frames_in_flight <= frame )
+      {
+         retired_bytes -= retired[released_count].size;
+         ++released_count;
+      }
+
+      retired.erase( retired.begin( ), retired.begin( ) + static_cast<std::ptrdiff_t>( released_count ) );
+   }
+} // namespace assets
@@ -0,0 +1,585 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/ktx2.hpp>
+#include <luciole/assets/texture_loader.hpp>
+#include <luciole/graphics/block_compression.hpp>
+#include <luciole/graphics/vertex_encoding.hpp>
+#include <luciole/vk/buffers/queue_ownership.hpp>
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace assets
+{
+   namespace
+   {
+      /**
+       * @brief Bumped whenever decode_image changes its output.
+       */
+      static constexpr std::uint32_t texture_importer_version = 1;
+
+      static constexpr std::uint32_t cooked_image_magic = 0x474d494c; // "LIMG"
+
+      /**
+       * @brief The layout of a decoded image in the derived data cache,
+       * followed by its pixels.
+       */
+      struct cooked_image_header
+      {
+         std::uint32_t magic = cooked_image_magic;
+         std::uint32_t width = 0;
+         std::uint32_t height = 0;
+         std::uint32_t format = 0;
+         std::uint64_t pixel_size = 0;
+      }; // struct cooked_image_header
+
+      std::vector<std::byte> write_cooked_image( image_data const& image )
+      {
+         cooked_image_header const header
+         {
+            .width = image.width,
+            .height = image.height,
+            .format = static_cast<std::uint32_t>( image.format ),
+            .pixel_size = image.pixels.size( )
+         };
+
+         std::vector<std::byte> data( sizeof( header ) + image.pixels.size( ) );
+         std::memcpy( data.data( ), &header, sizeof( header ) );
+         std::memcpy( data.data( ) + sizeof( header ), image.pixels.data( ), image.pixels.size( ) );
+
+         return data;
+      }
+
+      std::optional<image_data> read_cooked_image( std::vector<std::byte> const& data, std::string const& filepath )
+      {
+         cooked_image_header header;
+         if ( data.size( ) < sizeof( header ) )
+         {
+            return std::nullopt;
+         }
+
+         std::memcpy( &header, data.data( ), sizeof( header ) );
+         if ( header.magic != cooked_image_magic || data.size( ) - sizeof( header ) != header.pixel_size )
+         {
+            return std::nullopt;
+         }
+
+         image_data image;
+         image.filepath = filepath;
+         image.width = header.width;
+         image.height = header.height;
+         image.format = static_cast<VkFormat>( header.format );
+         image.pixels.assign( data.begin( ) + sizeof( header ), data.end( ) );
+
+         return image;
+      }
+
+      struct stbi_deleter
+      {
+         void operator( )( void* p_data ) const noexcept
+         {
+            stbi_image_free( p_data );
+         }
+      }; // struct stbi_deleter
+
+      /**
+       * @brief Whether a block compressed format that can be decompressed
+       * on the CPU stores sRGB colors.
+       */
+      bool is_srgb( VkFormat format ) noexcept
+      {
+         return format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+      }
+
+      /**
+       * @brief Record a layout transition of a range of mip levels.
+       */
+      void record_transition(
+         VkCommandBuffer cmd_buffer, VkImage image,
+         std::uint32_t first_level, std::uint32_t level_count,
+         VkImageLayout old_layout, VkImageLayout new_layout,
+         VkAccessFlags src_access, VkAccessFlags dst_access,
+         VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage )
+      {
+         VkImageMemoryBarrier const barrier
+         {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = src_access,
+            .dstAccessMask = dst_access,
+            .oldLayout = old_layout,
+            .newLayout = new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = VkImageSubresourceRange
+            {
+               .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+               .baseMipLevel = first_level,
+               .levelCount = level_count,
+               .baseArrayLayer = 0,
+               .layerCount = 1
+            }
+         };
+
+         vkCmdPipelineBarrier( cmd_buffer, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier );
+      }
+   } // namespace
+
+   texture_loader::texture_loader( create_info_t const& create_info ) :
+      p_context( create_info.value( ).p_context ),
+      p_thread_pool( create_info.value( ).p_thread_pool ),
+      p_cache( create_info.value( ).p_cache )
+   {
+      if ( p_context )
+      {
+         vk::staging_buffer::create_info const staging_create_info
+         {
+            .p_context = p_context,
+            .size = create_info.value( ).staging_size
+         };
+
+         staging = vk::staging_buffer( vk::staging_buffer::create_info_t( staging_create_info ) );
+      }
+   }
+
+   std::future<image_data> texture_loader::decode_async( std::string const& filepath, color_space space ) const
+   {
+      return p_thread_pool->submit( [this, filepath, space] { 
+         return decode( filepath, space ); 
+      } );
+   }
+
+   image_data texture_loader::decode( std::string const& filepath, color_space space ) const
+   {
+      if ( filepath.size( ) >= 5 && filepath.compare( filepath.size( ) - 5, 5, ".ktx2" ) == 0 )
+      {
+         return decode_ktx2( filepath );
+      }
+
+      if ( p_cache == nullptr )
+      {
+         return decode_image( filepath, space );
+      }
+
+      derived_data_key const key
+      {
+         .importer = "texture",
+         .importer_version = texture_importer_version,
+         .source_hash = hash_file( filepath ),
+         .settings = space == color_space::e_srgb ? "srgb" : "linear"
+      };
+
+      if ( auto const cooked = p_cache->load( key ) )
+      {
+         if ( auto image = read_cooked_image( *cooked, filepath ) )
+         {
+            return std::move( *image );
+         }
+      }
+
+      auto image = decode_image( filepath, space );
+
+      try
+      {
+         p_cache->store( key, write_cooked_image( image ) );
+      }
+      catch( std::runtime_error const& )
+      {
+         /* the image is still good if the cache cannot be written to */
+      }
+
+      return image;
+   }
+
+   image_data texture_loader::decode_image( std::string const& filepath, color_space space ) const
+   {
+      image_data image;
+      image.filepath = filepath;
+
+      int width = 0;
+      int height = 0;
+      int channels = 0;
+
+      if ( stbi_is_hdr( filepath.c_str( ) ) )
+      {
+         std::unique_ptr<float, stbi_deleter> p_pixels( stbi_loadf( filepath.c_str( ), &width, &height, &channels, STBI_rgb_alpha ) );
+         if ( !p_pixels )
+         {
+            throw std::runtime_error{ "Error decoding image: " + filepath + ". " + stbi_failure_reason( ) };
+         }
+
+         std::size_t const component_count = static_cast<std::size_t>( width ) * height * 4;
+
+         image.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+         image.pixels.resize( component_count * sizeof( std::uint16_t ) );
+
+         gfx::encode_half( p_pixels.get( ), reinterpret_cast<std::uint16_t*>( image.pixels.data( ) ), component_count );
+      }
+      else
+      {
+         std::unique_ptr<stbi_uc, stbi_deleter> p_pixels( stbi_load( filepath.c_str( ), &width, &height, &channels, STBI_rgb_alpha ) );
+         if ( !p_pixels )
+         {
+            throw std::runtime_error{ "Error decoding image: " + filepath + ". " + stbi_failure_reason( ) };
+         }
+
+         std::size_t const byte_count = static_cast<std::size_t>( width ) * height * 4;
+
+         image.format = space == color_space::e_srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+         image.pixels.resize( byte_count );
+
+         std::memcpy( image.pixels.data( ), p_pixels.get( ), byte_count );
+      }
+
+      image.width = static_cast<std::uint32_t>( width );
+      image.height = static_cast<std::uint32_t>( height );
+
+      return image;
+   }
+
+   std::vector<vk::texture> texture_loader::upload( std::vector<image_data> const& images )
+   {
+      std::vector<vk::texture> textures;
+      textures.reserve( images.size( ) );
+
+      VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
+
+      auto const begin = [this, &cmd_buffer] 
+      {
+         auto temp_cmd = vk::begin_one_time_commands( p_context, queue::flag::e_graphics );
+         if ( auto const* p_val = std::get_if<VkCommandBuffer>( &temp_cmd ) )
+         {
+            cmd_buffer = *p_val;
+         }
+         else
+         {
+            throw std::runtime_error{ "Error recording the texture uploads." };
+         }
+      };
+
+      auto const flush = [this, &cmd_buffer] 
+      {
+         if ( cmd_buffer == VK_NULL_HANDLE )
+         {
+            return;
+         }
+
+         auto const err = vk::submit_one_time_commands( p_context, queue::flag::e_graphics, cmd_buffer );
+         cmd_buffer = VK_NULL_HANDLE;
+         staging.reset( );
+
+         if ( err.is_error( ) )
+         {
+            throw std::runtime_error{ "Error submitting the texture uploads." };
+         }
+      };
+
+      for( auto const& image : images )
+      {
+         auto texture = create_texture( image );
+
+         auto const size = static_cast<VkDeviceSize>( image.pixels.size( ) );
+         if ( size > staging.get_size( ) )
+         {
+            flush( );
+
+            vk::staging_buffer::create_info const temp_create_info
+            {
+               .p_context = p_context,
+               .size = size
+            };
+
+            auto temp_staging = vk::staging_buffer( vk::staging_buffer::create_info_t( temp_create_info ) );
+            std::memcpy( temp_staging.data( temp_staging.allocate( size ) ), image.pixels.data( ), size );
+
+            begin( );
+            record_upload( cmd_buffer, temp_staging.get_buffer( ), 0, image, texture );
+            flush( );
+         }
+         else
+         {
+            auto offset = staging.allocate( size );
+            if ( offset == vk::staging_buffer::invalid_offset )
+            {
+               flush( );
+               offset = staging.allocate( size );
+            }
+
+            std::memcpy( staging.data( offset ), image.pixels.data( ), size );
+
+            if ( cmd_buffer == VK_NULL_HANDLE )
+            {
+               begin( );
+            }
+
+            record_upload( cmd_buffer, staging.get_buffer( ), offset, image, texture );
+         }
+
+         textures.push_back( std::move( texture ) );
+      }
+
+      flush( );
+
+      return textures;
+   }
+
+   vk::texture texture_loader::upload( image_data const& image )
+   {
+      auto textures = upload( std::vector<image_data>{ image } );
+
+      return std::move( textures.front( ) );
+   }
+
+   pending_texture_upload texture_loader::upload_async( image_data const& image ) const
+   {
+      auto const size = static_cast<VkDeviceSize>( image.pixels.size( ) );
+
+      vk::staging_buffer::create_info const staging_create_info
+      {
+         .p_context = p_context,
+         .size = size
+      };
+
+      pending_texture_upload upload
+      {
+         .texture = create_texture( image ),
+         .staging = vk::staging_buffer( vk::staging_buffer::create_info_t( staging_create_info ) ),
+         .submission = { }
+      };
+
+      std::memcpy( upload.staging.data( upload.staging.allocate( size ) ), image.pixels.data( ), size );
+
+      auto temp_cmd = vk::begin_one_time_commands( p_context, queue::flag::e_graphics );
+      if ( std::get_if<vk::error>( &temp_cmd ) != nullptr )
+      {
+         throw std::runtime_error{ "Error recording the texture upload." };
+      }
+
+      auto const cmd_buffer = std::get<VkCommandBuffer>( temp_cmd );
+      record_upload( cmd_buffer, upload.staging.get_buffer( ), 0, image, upload.texture );
+
+      auto temp_submission = vk::submit_one_time_commands_async( p_context, queue::flag::e_graphics, cmd_buffer );
+      if ( auto const* p_val = std::get_if<vk::pending_submission>( &temp_submission ) )
+      {
+         upload.submission = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "Error submitting the texture upload." };
+      }
+
+      return upload;
+   }
+
+   vk::texture texture_loader::create_texture( image_data const& image ) const
+   {
+      std::uint32_t mip_levels = static_cast<std::uint32_t>( image.levels.size( ) );
+      if ( image.levels.empty( ) )
+      {
+         bool const can_blit = p_context->is_format_supported( image.format, VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT );
+         mip_levels = can_blit ? vk::get_mip_level_count( image.width, image.height ) : 1;
+      }
+
+      vk::texture::create_info const texture_create_info
+      {
+         .p_context = p_context,
+         .extent = VkExtent2D{ image.width, image.height },
+         .format = image.format,
+         .mip_levels = mip_levels,
+         .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+      };
+
+      return vk::texture( vk::texture::create_info_t( texture_create_info ) );
+   }
+
+   void texture_loader::record_upload(
+      VkCommandBuffer cmd_buffer,
+      VkBuffer staging_buffer, VkDeviceSize offset,
+      image_data const& image,
+      vk::texture const& texture ) const
+   {
+      VkImage const handle = texture.get_image( );
+      std::uint32_t const mip_levels = texture.get_mip_levels( );
+      std::uint32_t const loaded_levels = std::max<std::uint32_t>( static_cast<std::uint32_t>( image.levels.size( ) ), 1 );
+
+      VkFilter const filter = p_context->is_format_supported( texture.get_format( ), VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT ) ? 
+         VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+      record_transition( 
+         cmd_buffer, handle, 0, mip_levels, 
+         VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+         0, VK_ACCESS_TRANSFER_WRITE_BIT,
+         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT 
+      );
+
+      std::vector<VkBufferImageCopy> regions;
+      regions.reserve( loaded_levels );
+      for( std::uint32_t level = 0; level < loaded_levels; ++level )
+      {
+         regions.push_back( VkBufferImageCopy
+         {
+            .bufferOffset = offset + ( image.levels.empty( ) ? 0 : image.levels[level].offset ),
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = VkImageSubresourceLayers
+            {
+               .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+               .mipLevel = level,
+               .baseArrayLayer = 0,
+               .layerCount = 1
+            },
+            .imageOffset = VkOffset3D{ 0, 0, 0 },
+            .imageExtent = VkExtent3D
+            { 
+               std::max( texture.get_extent( ).width >> level, 1u ), 
+               std::max( texture.get_extent( ).height >> level, 1u ), 
+               1 
+            }
+         } );
+      }
+
+      vkCmdCopyBufferToImage( 
+         cmd_buffer, staging_buffer, handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+         static_cast<std::uint32_t>( regions.size( ) ), regions.data( ) 
+      );
+
+      auto width = static_cast<std::int32_t>( texture.get_extent( ).width );
+      auto height = static_cast<std::int32_t>( texture.get_extent( ).height );
+
+      // Only runs when the image has a single level and the rest of the
+      // chain has to be generated.
+      for( std::uint32_t level = loaded_levels; level < mip_levels; ++level )
+      {
+         record_transition(
+            cmd_buffer, handle, level - 1, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+         );
+
+         std::int32_t const next_width = width > 1 ? width / 2 : 1;
+         std::int32_t const next_height = height > 1 ? height / 2 : 1;
+
+         VkImageBlit const blit
+         {
+            .srcSubresource = VkImageSubresourceLayers
+            {
+               .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+               .mipLevel = level - 1,
+               .baseArrayLayer = 0,
+               .layerCount = 1
+            },
+            .srcOffsets = { VkOffset3D{ 0, 0, 0 }, VkOffset3D{ width, height, 1 } },
+            .dstSubresource = VkImageSubresourceLayers
+            {
+               .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+               .mipLevel = level,
+               .baseArrayLayer = 0,
+               .layerCount = 1
+            },
+            .dstOffsets = { VkOffset3D{ 0, 0, 0 }, VkOffset3D{ next_width, next_height, 1 } }
+         };
+
+         vkCmdBlitImage( 
+            cmd_buffer, 
+            handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
+            handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+            1, &blit, filter 
+         );
+
+         record_transition(
+            cmd_buffer, handle, level - 1, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+         );
+
+         width = next_width;
+         height = next_height;
+      }
+
+      std::uint32_t const first_written_level = mip_levels > loaded_levels ? mip_levels - 1 : 0;
+
+      record_transition(
+         cmd_buffer, handle, first_written_level, mip_levels - first_written_level,
+         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+         VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+      );
+   }
+
+   image_data texture_loader::decode_ktx2( std::string const& filepath ) const
+   {
+      ktx2_file const file( filepath );
+
+      image_data image;
+      image.filepath = filepath;
+      image.width = file.get_width( );
+      image.height = file.get_height( );
+      image.format = file.get_format( );
+
+      auto const block_format = gfx::to_block_format( image.format );
+      bool const is_supported = p_context == nullptr || p_context->is_format_supported( image.format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT );
+      if ( !is_supported && !block_format )
+      {
+         throw std::runtime_error{ "Error decoding image: " + filepath + ". Its format is not supported by the GPU." };
+      }
+
+      for( std::uint32_t level = 0; level < file.get_level_count( ); ++level )
+      {
+         std::uint32_t const width = std::max( image.width >> level, 1u );
+         std::uint32_t const height = std::max( image.height >> level, 1u );
+
+         std::byte const* p_data = file.get_level_data( level );
+         std::size_t size = file.get_level_size( level );
+
+         std::vector<std::byte> decompressed;
+         if ( !is_supported )
+         {
+            decompressed = gfx::decompress_image( *block_format, p_data, width, height );
+            p_data = decompressed.data( );
+            size = decompressed.size( );
+         }
+
+         // Keep every level aligned for the copies into compressed images.
+         std::size_t const level_offset = ( image.pixels.size( ) + 15 ) & ~std::size_t( 15 );
+         image.pixels.resize( level_offset + size );
+         std::memcpy( image.pixels.data( ) + level_offset, p_data, size );
+
+         // Without levels the upload generates the mip chain from the base level.
+         if ( !file.is_mip_chain_generated( ) )
+         {
+            image.levels.push_back( image_level{ .offset = level_offset, .size = size } );
+         }
+      }
+
+      if ( !is_supported )
+      {
+         image.format = is_srgb( image.format ) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+      }
+
+      return image;
+   }
+} // namespace assets
@@ -18,15 +18,19 @@
 
 #include <luciole/context.hpp>
 #include <luciole/luciole_core.hpp>
+#include <luciole/utils/file_io.hpp>
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <variant>
 
+using object_type = vk::host_allocator::object_type;
+
 static VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(
     VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
     VkDebugUtilsMessageTypeFlagsEXT message_type,
@@ -100,7 +104,9 @@ context::context( const ui::window& wnd )
    surface( VK_NULL_HANDLE ),
    gpu( VK_NULL_HANDLE ),
    device( VK_NULL_HANDLE ),
-   memory_allocator( VK_NULL_HANDLE )
+   memory_allocator( VK_NULL_HANDLE ),
+   p_host_allocator( std::make_unique<vk::host_allocator>( ) ),
+   p_memory_tracker( std::make_unique<vk::memory_tracker>( ) )
 {
    /* Vulkan Logger */
    auto vk_console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
@@ -315,7 +321,7 @@ context::~context( )
    {
       if ( command_pool.second.handle != VK_NULL_HANDLE )
       {
-         vkDestroyCommandPool( device, command_pool.second.handle, nullptr );
+         vkDestroyCommandPool( device, command_pool.second.handle, p_host_allocator->get_callbacks( object_type::e_command_pool ) );
          command_pool.second.handle = VK_NULL_HANDLE;
          command_pool.second.flags = queue::flag::e_none;
       }
@@ -329,12 +335,13 @@ context::~context( )
 
    if ( device != VK_NULL_HANDLE )
    {
-      vkDestroyDevice( device, nullptr );
+      vkDestroyDevice( device, p_host_allocator->get_callbacks( object_type::e_device ) );
       device = VK_NULL_HANDLE;
    }
 
    if ( surface != VK_NULL_HANDLE )
    {
+      // The surface is created by the window without allocation callbacks.
       vkDestroySurfaceKHR( instance, surface, nullptr );
       surface = VK_NULL_HANDLE;
    }
@@ -343,13 +350,14 @@ context::~context( )
    {
       if ( debug_messenger != VK_NULL_HANDLE )
       {
-         destroy_debug_utils_messenger( instance, debug_messenger, nullptr );
+         destroy_debug_utils_messenger( instance, debug_messenger, p_host_allocator->get_callbacks( object_type::e_debug_messenger ) );
          debug_messenger = VK_NULL_HANDLE;
       }
    }
 
    if ( instance != VK_NULL_HANDLE )
    {
+      vkDestroyInstance( instance, p_host_allocator->get_callbacks( object_type::e_instance ) );
       instance = VK_NULL_HANDLE;
    }
 }
@@ -379,6 +387,9 @@ context& context::operator=( context&& rhs )
       memory_allocator = rhs.memory_allocator;
       rhs.memory_allocator = VK_NULL_HANDLE;
 
+      std::swap( p_host_allocator, rhs.p_host_allocator );
+      std::swap( p_memory_tracker, rhs.p_memory_tracker );
+
       std::swap( queues, rhs.queues );
       std::swap( command_pools, rhs.command_pools );
       std::swap( wnd_size, rhs.wnd_size );
@@ -418,7 +429,7 @@ std::variant<VkSwapchainKHR, vk::error> context::create_swapchain(
    vk::error err( vk::result_t( 
       vkCreateSwapchainKHR( 
          device, &create_info.value( ), 
-         nullptr, &handle 
+         p_host_allocator->get_callbacks( object_type::e_swapchain ), &handle 
    ) ) );
 
    if ( err.is_error() )
@@ -438,7 +449,7 @@ std::variant<VkSwapchainKHR, vk::error> context::create_swapchain(
  */
 void context::destroy_swapchain( vk::swapchain_t swapchain ) const noexcept
 {
-   vkDestroySwapchainKHR( device, swapchain.value( ), nullptr );
+   vkDestroySwapchainKHR( device, swapchain.value( ), p_host_allocator->get_callbacks( object_type::e_swapchain ) );
 }
 
 
@@ -458,7 +469,7 @@ std::variant<VkImageView, vk::error> context::create_image_view(
    vk::error err( vk::result_t(
       vkCreateImageView( 
          device, &create_info.value( ), 
-         nullptr, &handle 
+         p_host_allocator->get_callbacks( object_type::e_image_view ), &handle 
    ) ) );
 
    if ( err.is_error( ) )
@@ -472,7 +483,7 @@ std::variant<VkImageView, vk::error> context::create_image_view(
 }
 void context::destroy_image_view( vk::image_view_t image_view ) const noexcept
 {
-   vkDestroyImageView( device, image_view.value( ), nullptr );
+   vkDestroyImageView( device, image_view.value( ), p_host_allocator->get_callbacks( object_type::e_image_view ) );
 }
 
 
@@ -484,7 +495,7 @@ std::variant<VkRenderPass, vk::error> context::create_render_pass(
    vk::error const err ( vk::result_t( 
       vkCreateRenderPass( 
          device, &create_info.value( ), 
-         nullptr, &handle 
+         p_host_allocator->get_callbacks( object_type::e_render_pass ), &handle 
    ) ) );
 
    if ( err.is_error( ) )
@@ -498,7 +509,7 @@ std::variant<VkRenderPass, vk::error> context::create_render_pass(
 }
 void context::destroy_render_pass( vk::render_pass_t render_pass ) const noexcept
 {
-   vkDestroyRenderPass( device, render_pass.value( ), nullptr );
+   vkDestroyRenderPass( device, render_pass.value( ), p_host_allocator->get_callbacks( object_type::e_render_pass ) );
 }
 
 std::variant<VkDescriptorPool, vk::error> context::create_descriptor_pool(
@@ -509,7 +520,7 @@ std::variant<VkDescriptorPool, vk::error> context::create_descriptor_pool(
    vk::error const err ( vk::result_t(
       vkCreateDescriptorPool(
          device, &create_info.value( ),
-         nullptr, &handle
+         p_host_allocator->get_callbacks( object_type::e_descriptor_pool ), &handle
       )
    ) );
 
@@ -525,7 +536,7 @@ std::variant<VkDescriptorPool, vk::error> context::create_descriptor_pool(
 
 VkDescriptorPool context::destroy_descriptor_pool( vk::descriptor_pool_t handle ) const
 {
-   vkDestroyDescriptorPool( device, handle.value( ), nullptr );
+   vkDestroyDescriptorPool( device, handle.value( ), p_host_allocator->get_callbacks( object_type::e_descriptor_pool ) );
 
    return VK_NULL_HANDLE;
 }
@@ -536,7 +547,7 @@ std::variant<VkPipelineLayout, vk::error> context::create_pipeline_layout(
    VkPipelineLayout handle = VK_NULL_HANDLE;
 
    vk::error const err( vk::result_t(
-      vkCreatePipelineLayout( device, &create_info.value( ), nullptr, &handle ) 
+      vkCreatePipelineLayout( device, &create_info.value( ), p_host_allocator->get_callbacks( object_type::e_pipeline_layout ), &handle ) 
    ) );
    
    if ( err.is_error() )
@@ -550,7 +561,7 @@ std::variant<VkPipelineLayout, vk::error> context::create_pipeline_layout(
 }
 void context::destroy_pipeline_layout( vk::pipeline_layout_t pipeline_layout ) const noexcept
 {
-   vkDestroyPipelineLayout( device, pipeline_layout.value( ), nullptr );
+   vkDestroyPipelineLayout( device, pipeline_layout.value( ), p_host_allocator->get_callbacks( object_type::e_pipeline_layout ) );
 }
 
 std::variant<VkDescriptorSetLayout, vk::error> context::create_descriptor_set_layout(
@@ -559,7 +570,7 @@ std::variant<VkDescriptorSetLayout, vk::error> context::create_descriptor_set_la
    VkDescriptorSetLayout handle = VK_NULL_HANDLE;
 
    vk::error const err( vk::result_t(
-      vkCreateDescriptorSetLayout( device, &create_info.value( ), nullptr, &handle )
+      vkCreateDescriptorSetLayout( device, &create_info.value( ), p_host_allocator->get_callbacks( object_type::e_descriptor_set_layout ), &handle )
    ) );
 
    if ( err.is_error( ) )
@@ -575,7 +586,7 @@ std::variant<VkDescriptorSetLayout, vk::error> context::create_descriptor_set_la
 VkDescriptorSetLayout context::destroy_descriptor_set_layout(
    vk::descriptor_set_layout_t layout ) const
 {
-   vkDestroyDescriptorSetLayout( device, layout.value( ), nullptr );
+   vkDestroyDescriptorSetLayout( device, layout.value( ), p_host_allocator->get_callbacks( object_type::e_descriptor_set_layout ) );
 
    return VK_NULL_HANDLE;
 }
@@ -586,7 +597,7 @@ std::variant<VkPipeline, vk::error> context::create_pipeline(
    VkPipeline handle = VK_NULL_HANDLE;
 
    vk::error const err( vk::result_t(
-      vkCreateGraphicsPipelines( device, nullptr, 1, &create_info.value( ), nullptr, &handle )  
+      vkCreateGraphicsPipelines( device, nullptr, 1, &create_info.value( ), p_host_allocator->get_callbacks( object_type::e_pipeline ), &handle )  
    ) );
 
    if ( err.is_error( ) )
@@ -607,7 +618,7 @@ std::variant<VkPipeline, vk::error> context::create_pipeline(
       vkCreateComputePipelines( 
          device, nullptr, 1, 
          &create_info.value( ), 
-         nullptr, &handle 
+         p_host_allocator->get_callbacks( object_type::e_pipeline ), &handle 
       ) 
    ) );
 
@@ -622,7 +633,7 @@ std::variant<VkPipeline, vk::error> context::create_pipeline(
 }
 void context::destroy_pipeline( vk::pipeline_t pipeline ) const noexcept
 {
-    vkDestroyPipeline( device, pipeline.value( ), nullptr );
+    vkDestroyPipeline( device, pipeline.value( ), p_host_allocator->get_callbacks( object_type::e_pipeline ) );
 }
 
 
@@ -630,11 +641,11 @@ VkShaderModule context::create_shader_module( vk::shader_module_create_info_t co
 {
    VkShaderModule handle;
 
-   return ( vkCreateShaderModule( device, &create_info.value( ), nullptr, &handle ) == VK_SUCCESS ) ? handle : VK_NULL_HANDLE;
+   return ( vkCreateShaderModule( device, &create_info.value( ), p_host_allocator->get_callbacks( object_type::e_shader_module ), &handle ) == VK_SUCCESS ) ? handle : VK_NULL_HANDLE;
 }
 void context::destroy_shader_module( vk::shader_module_t shader_module ) const noexcept
 {
-   vkDestroyShaderModule( device, shader_module.value( ), nullptr );
+   vkDestroyShaderModule( device, shader_module.value( ), p_host_allocator->get_callbacks( object_type::e_shader_module ) );
 }
 
 
@@ -643,7 +654,7 @@ std::variant<VkFramebuffer, vk::error> context::create_framebuffer( vk::framebuf
    VkFramebuffer handle = VK_NULL_HANDLE;
  
    vk::error const err( vk::result_t( 
-      vkCreateFramebuffer( device, &create_info.value( ), nullptr, &handle ) 
+      vkCreateFramebuffer( device, &create_info.value( ), p_host_allocator->get_callbacks( object_type::e_framebuffer ), &handle ) 
    ) );
 
    if ( err.is_error( ) )
@@ -657,7 +668,7 @@ std::variant<VkFramebuffer, vk::error> context::create_framebuffer( vk::framebuf
 }
 void context::destroy_framebuffer( vk::framebuffer_t framebuffer ) const noexcept
 {
-   vkDestroyFramebuffer( device, framebuffer.value( ), nullptr ); 
+   vkDestroyFramebuffer( device, framebuffer.value( ), p_host_allocator->get_callbacks( object_type::e_framebuffer ) ); 
 }
 
 std::variant<VkSemaphore, vk::error> context::create_semaphore( 
@@ -666,7 +677,7 @@ std::variant<VkSemaphore, vk::error> context::create_semaphore(
    VkSemaphore handle = VK_NULL_HANDLE;
 
    vk::error const err( vk::result_t(
-      vkCreateSemaphore( device, &create_info.value( ), nullptr, &handle )  
+      vkCreateSemaphore( device, &create_info.value( ), p_host_allocator->get_callbacks( object_type::e_semaphore ), &handle )  
    ) );
 
    if ( err.is_error( ) )
@@ -680,7 +691,7 @@ std::variant<VkSemaphore, vk::error> context::create_semaphore(
 }
 void context::destroy_semaphore( vk::semaphore_t semaphore ) const noexcept
 {
-   vkDestroySemaphore( device, semaphore.value( ), nullptr );
+   vkDestroySemaphore( device, semaphore.value( ), p_host_allocator->get_callbacks( object_type::e_semaphore ) );
 }
 
 std::variant<VkFence, vk::error> context::create_fence( 
@@ -689,7 +700,7 @@ std::variant<VkFence, vk::error> context::create_fence(
    VkFence handle = VK_NULL_HANDLE;
 
    vk::error const err( vk::result_t(
-      vkCreateFence( device, &create_info.value( ), nullptr, &handle )
+      vkCreateFence( device, &create_info.value( ), p_host_allocator->get_callbacks( object_type::e_fence ), &handle )
    ) );
 
    if ( err.is_error( ) )
@@ -703,7 +714,127 @@ std::variant<VkFence, vk::error> context::create_fence(
 }
 void context::destroy_fence( vk::fence_t fence ) const noexcept
 {
-   vkDestroyFence( device, fence.value( ), nullptr );
+   vkDestroyFence( device, fence.value( ), p_host_allocator->get_callbacks( object_type::e_fence ) );
+}
+
+std::variant<vk::buffer_allocation, vk::error> context::create_buffer(
+   vk::buffer_create_info_t const& create_info,
+   vk::allocation_create_info_t const& allocation_info,
+   vk::memory_category category ) const
+{
+   auto info = allocation_info.value( );
+   if ( info.pUserData == nullptr )
+   {
+      info.flags |= VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT;
+      info.pUserData = const_cast<char*>( vk::to_string( category ).c_str( ) );
+   }
+
+   vk::buffer_allocation buffer
+   {
+      .handle = VK_NULL_HANDLE,
+      .allocation = VK_NULL_HANDLE,
+      .category = category,
+      .size = create_info.value( ).size
+   };
+
+   VmaAllocationInfo allocation_result = { };
+
+   vk::error const err( vk::result_t(
+      vmaCreateBuffer( memory_allocator, &create_info.value( ), &info, &buffer.handle, &buffer.allocation, &allocation_result )
+   ) );
+
+   if ( err.is_error( ) )
+   {
+      return err;
+   }
+   else
+   {
+      buffer.reserved_size = allocation_result.size;
+      p_memory_tracker->on_allocate( category, buffer.size, buffer.reserved_size );
+
+      return buffer;
+   }
+}
+void context::destroy_buffer( vk::buffer_allocation const& buffer ) const noexcept
+{
+   if ( buffer.handle != VK_NULL_HANDLE && buffer.allocation != VK_NULL_HANDLE )
+   {
+      vmaDestroyBuffer( memory_allocator, buffer.handle, buffer.allocation );
+
+      p_memory_tracker->on_free( buffer.category, buffer.size, buffer.reserved_size );
+   }
+}
+
+std::variant<vk::image_allocation, vk::error> context::create_image(
+   vk::image_create_info_t const& create_info,
+   vk::allocation_create_info_t const& allocation_info,
+   vk::memory_category category ) const
+{
+   auto info = allocation_info.value( );
+   if ( info.pUserData == nullptr )
+   {
+      info.flags |= VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT;
+      info.pUserData = const_cast<char*>( vk::to_string( category ).c_str( ) );
+   }
+
+   vk::image_allocation image
+   {
+      .handle = VK_NULL_HANDLE,
+      .allocation = VK_NULL_HANDLE,
+      .category = category,
+      .size = 0
+   };
+
+   VmaAllocationInfo allocation_result = { };
+
+   vk::error const err( vk::result_t(
+      vmaCreateImage( memory_allocator, &create_info.value( ), &info, &image.handle, &image.allocation, &allocation_result )
+   ) );
+
+   if ( err.is_error( ) )
+   {
+      return err;
+   }
+   else
+   {
+      // An image is only known by the memory it was given.
+      image.size = allocation_result.size;
+      p_memory_tracker->on_allocate( category, image.size, image.size );
+
+      return image;
+   }
+}
+void context::destroy_image( vk::image_allocation const& image ) const noexcept
+{
+   if ( image.handle != VK_NULL_HANDLE && image.allocation != VK_NULL_HANDLE )
+   {
+      vmaDestroyImage( memory_allocator, image.handle, image.allocation );
+
+      p_memory_tracker->on_free( image.category, image.size, image.size );
+   }
+}
+
+std::variant<VkSampler, vk::error> context::create_sampler(
+   vk::sampler_create_info_t const& create_info ) const noexcept
+{
+   VkSampler handle = VK_NULL_HANDLE;
+
+   vk::error const err( vk::result_t(
+      vkCreateSampler( device, &create_info.value( ), p_host_allocator->get_callbacks( object_type::e_sampler ), &handle )
+   ) );
+
+   if ( err.is_error( ) )
+   {
+      return err;
+   }
+   else
+   {
+      return handle;
+   }
+}
+void context::destroy_sampler( vk::sampler_t sampler ) const noexcept
+{
+   vkDestroySampler( device, sampler.value( ), p_host_allocator->get_callbacks( object_type::e_sampler ) );
 }
 
 std::variant<std::vector<VkCommandBuffer>, vk::error> context::create_command_buffers( 
@@ -737,6 +868,18 @@ std::variant<std::vector<VkCommandBuffer>, vk::error> context::create_command_bu
    }
 }
 
+void context::destroy_command_buffers(
+   queue::flag_t flag,
+   std::vector<VkCommandBuffer> const& buffers ) const noexcept
+{
+   if ( auto queue = queues.find( flag.value( ) ); queue != queues.cend( ) && !buffers.empty( ) )
+   {
+      auto pool = command_pools.find( queue->second.get_family_index( ) );
+
+      vkFreeCommandBuffers( device, pool->second.handle, static_cast<std::uint32_t>( buffers.size( ) ), buffers.data( ) );
+   }
+}
+
 std::variant<std::vector<VkImage>, vk::error> context::get_swapchain_images( 
    vk::swapchain_t swapchain, 
    count32_t image_count ) const
@@ -805,6 +948,18 @@ std::vector<std::uint32_t> context::get_unique_family_indices( ) const
    return indices;
 }
 
+std::uint32_t context::get_queue_family_index( queue::flag_t flag ) const noexcept
+{
+   if ( auto queue = queues.find( flag.value( ) ); queue != queues.cend( ) )
+   {
+      return queue->second.get_family_index( );
+   }
+   else
+   {
+      return VK_QUEUE_FAMILY_IGNORED;
+   }
+}
+
 std::vector<VkSurfaceFormatKHR> context::get_surface_format( ) const
 {
    std::uint32_t format_count = 0;
@@ -875,6 +1030,10 @@ void context::wait_for_fence( vk::fence_t fence ) const noexcept
 
    bool res = vkWaitForFences( device, 1, &fence_handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max() );
 }
+bool context::is_fence_signaled( vk::fence_t fence ) const noexcept
+{
+   return vkGetFenceStatus( device, fence.value( ) ) == VK_SUCCESS;
+}
 void context::reset_fence( vk::fence_t fence ) const noexcept
 {
    auto fence_handle = fence.value( );
@@ -892,6 +1051,142 @@ VmaAllocator context::get_memory_allocator( ) const
    return memory_allocator;
 }
 
+VkFormatProperties context::get_format_properties( VkFormat format ) const noexcept
+{
+   VkFormatProperties properties = { };
+   vkGetPhysicalDeviceFormatProperties( gpu, format, &properties );
+
+   return properties;
+}
+
+bool context::is_format_supported( VkFormat format, VkFormatFeatureFlags features ) const noexcept
+{
+   return ( get_format_properties( format ).optimalTilingFeatures & features ) == features;
+}
+
+VkPhysicalDeviceFeatures context::get_device_features( ) const noexcept
+{
+   VkPhysicalDeviceFeatures features = { };
+   vkGetPhysicalDeviceFeatures( gpu, &features );
+
+   return features;
+}
+
+bool context::is_device_extension_enabled( std::string_view name ) const noexcept
+{
+   return std::any_of( device_extensions.cbegin( ), device_extensions.cend( ), [name]( vk::extension const& extension )
+   {
+      return extension.found && extension.name == name;
+   } );
+}
+
+vk::host_allocator::report context::get_host_memory_report( ) const
+{
+   return p_host_allocator->get_report( );
+}
+
+vk::memory_stats context::get_memory_stats( ) const
+{
+   auto const to_heap = [] ( VmaStatInfo const& info )
+   {
+      vk::memory_stats::heap heap
+      {
+         .block_count = info.blockCount,
+         .allocation_count = info.allocationCount,
+         .used_bytes = info.usedBytes,
+         .reserved_bytes = info.usedBytes + info.unusedBytes
+      };
+
+      if ( info.unusedBytes > 0 )
+      {
+         heap.fragmentation = 1.0 - static_cast<double>( info.unusedRangeSizeMax ) / static_cast<double>( info.unusedBytes );
+      }
+
+      return heap;
+   };
+
+   VmaStats vma_stats = { };
+   vmaCalculateStats( memory_allocator, &vma_stats );
+
+   VkPhysicalDeviceMemoryProperties const* p_memory_properties = nullptr;
+   vmaGetMemoryProperties( memory_allocator, &p_memory_properties );
+
+   vk::memory_stats stats;
+   stats.heaps.reserve( p_memory_properties->memoryHeapCount );
+
+   for( std::uint32_t i = 0; i < p_memory_properties->memoryHeapCount; ++i )
+   {
+      auto heap = to_heap( vma_stats.memoryHeap[i] );
+      heap.index = i;
+      heap.heap_size = p_memory_properties->memoryHeaps[i].size;
+      heap.is_device_local = p_memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+      stats.heaps.push_back( heap );
+   }
+
+   stats.total = to_heap( vma_stats.total );
+   for( auto const& heap : stats.heaps )
+   {
+      stats.total.heap_size += heap.heap_size;
+   }
+
+   stats.categories = p_memory_tracker->get_categories( );
+
+   return stats;
+}
+
+VkDeviceSize context::get_device_memory_usage( ) const noexcept
+{
+   VkDeviceSize usage = 0;
+
+   auto const categories = p_memory_tracker->get_categories( );
+   for( std::size_t i = 0; i < vk::memory_category_count; ++i )
+   {
+      if ( static_cast<vk::memory_category>( i ) != vk::memory_category::e_staging_buffer )
+      {
+         usage += categories[i].used_bytes;
+      }
+   }
+
+   return usage;
+}
+
+VkDeviceSize context::get_device_local_heap_size( ) const
+{
+   VkPhysicalDeviceMemoryProperties const* p_memory_properties = nullptr;
+   vmaGetMemoryProperties( memory_allocator, &p_memory_properties );
+
+   VkDeviceSize size = 0;
+   for( std::uint32_t i = 0; i < p_memory_properties->memoryHeapCount; ++i )
+   {
+      if ( p_memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT )
+      {
+         size = std::max( size, p_memory_properties->memoryHeaps[i].size );
+      }
+   }
+
+   return size;
+}
+
+nlohmann::json context::get_memory_stats_json( bool detailed ) const
+{
+   nlohmann::json res = get_memory_stats( );
+
+   char* p_vma_stats = nullptr;
+   vmaBuildStatsString( memory_allocator, &p_vma_stats, detailed );
+
+   res["vma"] = nlohmann::json::parse( p_vma_stats, nullptr, false );
+
+   vmaFreeStatsString( memory_allocator, p_vma_stats );
+
+   return res;
+}
+
+void context::dump_memory_stats( std::string_view filepath, bool detailed ) const
+{
+   write_to_file( std::string{ filepath }, get_memory_stats_json( detailed ).dump( 3 ) );
+}
+
 std::vector<vk::layer> context::load_validation_layers( ) const
 {
    if constexpr( vk::enable_debug_layers )
@@ -962,7 +1257,8 @@ std::vector<vk::extension> context::load_device_extensions( ) const
 {
    std::vector<vk::extension> exts =
    {
-      vk::extension{ .priority = vk::extension::priority::e_required, .found = false, .name = "VK_KHR_swapchain" }
+      vk::extension{ .priority = vk::extension::priority::e_required, .found = false, .name = "VK_KHR_swapchain" },
+      vk::extension{ .priority = vk::extension::priority::e_optional, .found = false, .name = "VK_KHR_draw_indirect_count" }
    };
 
    std::uint32_t extension_count = 0;
@@ -974,7 +1270,7 @@ std::vector<vk::extension> context::load_device_extensions( ) const
    {
       for( auto& extension : exts )
       {
-         if ( strcmp( extensions[i].extensionName, extension.name.c_str( ) ) ) 
+         if ( strcmp( extensions[i].extensionName, extension.name.c_str( ) ) == 0 )
          {
             extension.found = true;
          }
@@ -1064,7 +1360,7 @@ std::variant<VkInstance, vk::error> context::create_instance(
       };
 
       vk::error const err ( vk::result_t(
-         vkCreateInstance( &create_info, nullptr, &handle )
+         vkCreateInstance( &create_info, p_host_allocator->get_callbacks( object_type::e_instance ), &handle )
       ) );
 
       if ( err.is_error( ) )
@@ -1091,7 +1387,7 @@ std::variant<VkInstance, vk::error> context::create_instance(
       };
 
       vk::error const err ( vk::result_t(
-         vkCreateInstance( &create_info, nullptr, &handle )
+         vkCreateInstance( &create_info, p_host_allocator->get_callbacks( object_type::e_instance ), &handle )
       ) );
 
       if ( err.is_error( ) )
@@ -1127,7 +1423,7 @@ std::variant<VkDebugUtilsMessengerEXT, vk::error> context::create_debug_messenge
    vk::error const err( vk::result_t(
       create_debug_utils_messenger(
          instance, &create_info,
-         nullptr, &handle
+         p_host_allocator->get_callbacks( object_type::e_debug_messenger ), &handle
       )
    ) );
 
@@ -1231,7 +1527,7 @@ std::variant<VkDevice, vk::error> context::create_device(
 
    VkDevice handle = VK_NULL_HANDLE; 
    vk::error const err( vk::result_t(
-      vkCreateDevice( gpu, &create_info, nullptr, &handle )
+      vkCreateDevice( gpu, &create_info, p_host_allocator->get_callbacks( object_type::e_device ), &handle )
    ) );
 
    if( err.is_error( ) )
@@ -1249,6 +1545,7 @@ std::variant<VmaAllocator, vk::error> context::create_memory_allocator() const
    VmaAllocatorCreateInfo allocator_info = {};
    allocator_info.physicalDevice = gpu;
    allocator_info.device = device; 
+   allocator_info.pAllocationCallbacks = p_host_allocator->get_callbacks( object_type::e_memory_allocator );
 
    VmaAllocator mem_allocator = VK_NULL_HANDLE;
    vmaCreateAllocator( &allocator_info, &mem_allocator );
@@ -1371,14 +1668,15 @@ std::variant<context::command_pools_container_t, vk::error> context::create_comm
          {
             .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
             .pNext = nullptr,
-            .flags = 0,
+            // The renderer records its command buffers again once its content is loaded.
+            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
             .queueFamilyIndex = queue.second.get_family_index( )
          };
 
          vk::error const err( vk::result_t(
             vkCreateCommandPool( 
                device, &create_info, 
-               nullptr, &handle 
+               p_host_allocator->get_callbacks( object_type::e_command_pool ), &handle 
             )
          ) );
 
@@ -0,0 +1,411 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/aabb_tree.hpp>
+
+namespace gfx
+{
+   aabb_tree::aabb_tree( create_info_t const& create_info )
+      :
+      margin( create_info.value( ).margin )
+   { }
+
+   std::uint32_t aabb_tree::insert( aabb const& box, std::uint32_t user_data )
+   {
+      std::uint32_t const leaf = allocate_node( );
+      nodes[leaf].box = get_fat( box );
+      nodes[leaf].user_data = user_data;
+      nodes[leaf].height = 0;
+
+      insert_leaf( leaf );
+      ++proxy_count;
+
+      return leaf;
+   }
+
+   void aabb_tree::remove( std::uint32_t proxy )
+   {
+      remove_leaf( proxy );
+      free_node( proxy );
+
+      --proxy_count;
+   }
+
+   bool aabb_tree::move( std::uint32_t proxy, aabb const& box )
+   {
+      if ( nodes[proxy].box.contains( box ) )
+      {
+         return false;
+      }
+
+      remove_leaf( proxy );
+      nodes[proxy].box = get_fat( box );
+      insert_leaf( proxy );
+
+      return true;
+   }
+
+   void aabb_tree::set_box( std::uint32_t proxy, aabb const& box )
+   {
+      nodes[proxy].box = get_fat( box );
+   }
+
+   void aabb_tree::refit( )
+   {
+      if ( root == null_proxy )
+      {
+         return;
+      }
+
+      /* Children come after their parent in a depth first order, so the 
+         reverse order refits them first. */
+      std::vector<std::uint32_t> order;
+      order.reserve( nodes.size( ) );
+      order.push_back( root );
+
+      for( std::size_t i = 0; i < order.size( ); ++i )
+      {
+         auto const& n = nodes[order[i]];
+         if ( !n.is_leaf( ) )
+         {
+            order.push_back( n.child_1 );
+            order.push_back( n.child_2 );
+         }
+      }
+
+      for( auto it = order.rbegin( ); it != order.rend( ); ++it )
+      {
+         auto& n = nodes[*it];
+         if ( !n.is_leaf( ) )
+         {
+            n.box = merge( nodes[n.child_1].box, nodes[n.child_2].box );
+         }
+      }
+   }
+
+   void aabb_tree::clear( ) noexcept
+   {
+      nodes.clear( );
+      root = null_proxy;
+      free_list = null_proxy;
+      proxy_count = 0;
+   }
+
+   aabb const& aabb_tree::get_fat_box( std::uint32_t proxy ) const noexcept
+   {
+      return nodes[proxy].box;
+   }
+
+   std::uint32_t aabb_tree::get_user_data( std::uint32_t proxy ) const noexcept
+   {
+      return nodes[proxy].user_data;
+   }
+
+   std::uint32_t aabb_tree::get_proxy_count( ) const noexcept
+   {
+      return proxy_count;
+   }
+
+   std::uint32_t aabb_tree::get_height( ) const noexcept
+   {
+      return root == null_proxy ? 0 : static_cast<std::uint32_t>( nodes[root].height ) + 1;
+   }
+
+   float aabb_tree::get_area_ratio( ) const noexcept
+   {
+      if ( root == null_proxy )
+      {
+         return 0.0f;
+      }
+
+      float const root_area = nodes[root].box.get_surface_area( );
+      if ( root_area <= 0.0f )
+      {
+         return 0.0f;
+      }
+
+      float total_area = 0.0f;
+      for( auto const& n : nodes )
+      {
+         if ( n.height > 0 )
+         {
+            total_area += n.box.get_surface_area( );
+         }
+      }
+
+      return total_area / root_area;
+   }
+
+   std::uint32_t aabb_tree::allocate_node( )
+   {
+      if ( free_list == null_proxy )
+      {
+         nodes.emplace_back( );
+         return static_cast<std::uint32_t>( nodes.size( ) - 1 );
+      }
+
+      std::uint32_t const index = free_list;
+      free_list = nodes[index].parent;
+      nodes[index] = node{ };
+
+      return index;
+   }
+
+   void aabb_tree::free_node( std::uint32_t index ) noexcept
+   {
+      nodes[index].parent = free_list;
+      nodes[index].child_1 = null_proxy;
+      nodes[index].child_2 = null_proxy;
+      nodes[index].height = -1;
+
+      free_list = index;
+   }
+
+   void aabb_tree::insert_leaf( std::uint32_t leaf )
+   {
+      if ( root == null_proxy )
+      {
+         root = leaf;
+         nodes[root].parent = null_proxy;
+
+         return;
+      }
+
+      aabb const leaf_box = nodes[leaf].box;
+
+      /* Go down the cheapest branch: every node on the way grows to hold
+         the leaf, which is the inherited cost. */
+      std::uint32_t sibling = root;
+      while( !nodes[sibling].is_leaf( ) )
+      {
+         auto const& n = nodes[sibling];
+
+         float const area = n.box.get_surface_area( );
+         float const combined_area = merge( n.box, leaf_box ).get_surface_area( );
+
+         float const cost = 2.0f * combined_area;
+         float const inherited_cost = 2.0f * ( combined_area - area );
+
+         auto const get_descent_cost = [&] ( std::uint32_t child ) 
+         {
+            float const merged_area = merge( nodes[child].box, leaf_box ).get_surface_area( );
+            float const own_cost = nodes[child].is_leaf( ) ? merged_area : merged_area - nodes[child].box.get_surface_area( );
+
+            return own_cost + inherited_cost;
+         };
+
+         float const cost_1 = get_descent_cost( n.child_1 );
+         float const cost_2 = get_descent_cost( n.child_2 );
+
+         if ( cost < cost_1 && cost < cost_2 )
+         {
+            break;
+         }
+
+         sibling = cost_1 < cost_2 ? n.child_1 : n.child_2;
+      }
+
+      std::uint32_t const old_parent = nodes[sibling].parent;
+      std::uint32_t const new_parent = allocate_node( );
+
+      nodes[new_parent].parent = old_parent;
+      nodes[new_parent].box = merge( leaf_box, nodes[sibling].box );
+      nodes[new_parent].height = nodes[sibling].height + 1;
+      nodes[new_parent].child_1 = sibling;
+      nodes[new_parent].child_2 = leaf;
+
+      nodes[sibling].parent = new_parent;
+      nodes[leaf].parent = new_parent;
+
+      if ( old_parent == null_proxy )
+      {
+         root = new_parent;
+      }
+      else if ( nodes[old_parent].child_1 == sibling )
+      {
+         nodes[old_parent].child_1 = new_parent;
+      }
+      else
+      {
+         nodes[old_parent].child_2 = new_parent;
+      }
+
+      refit_ancestors( old_parent, true );
+   }
+
+   void aabb_tree::remove_leaf( std::uint32_t leaf )
+   {
+      if ( leaf == root )
+      {
+         root = null_proxy;
+         return;
+      }
+
+      std::uint32_t const parent = nodes[leaf].parent;
+      std::uint32_t const grand_parent = nodes[parent].parent;
+      std::uint32_t const sibling = nodes[parent].child_1 == leaf ? nodes[parent].child_2 : nodes[parent].child_1;
+
+      nodes[sibling].parent = grand_parent;
+      free_node( parent );
+
+      if ( grand_parent == null_proxy )
+      {
+         root = sibling;
+         return;
+      }
+
+      if ( nodes[grand_parent].child_1 == parent )
+      {
+         nodes[grand_parent].child_1 = sibling;
+      }
+      else
+      {
+         nodes[grand_parent].child_2 = sibling;
+      }
+
+      refit_ancestors( grand_parent, false );
+   }
+
+   void aabb_tree::refit_ancestors( std::uint32_t index, bool is_rotating ) noexcept
+   {
+      while( index != null_proxy )
+      {
+         auto& n = nodes[index];
+
+         n.box = merge( nodes[n.child_1].box, nodes[n.child_2].box );
+         n.height = 1 + std::max( nodes[n.child_1].height, nodes[n.child_2].height );
+
+         if ( is_rotating )
+         {
+            rotate( index );
+         }
+
+         index = n.parent;
+      }
+   }
+
+   void aabb_tree::rotate( std::uint32_t index ) noexcept
+   {
+      auto& a = nodes[index];
+      if ( a.height < 2 )
+      {
+         return;
+      }
+
+      enum class rotation
+      {
+         e_none,
+         e_child_2_with_grandchild_1,
+         e_child_2_with_grandchild_2,
+         e_child_1_with_grandchild_1,
+         e_child_1_with_grandchild_2
+      };
+
+      std::uint32_t const b = a.child_1;
+      std::uint32_t const c = a.child_2;
+
+      rotation best = rotation::e_none;
+      float best_gain = 0.0f;
+
+      auto const consider = [&] ( rotation r, float old_area, aabb const& new_box ) 
+      {
+         float const gain = old_area - new_box.get_surface_area( );
+         if ( gain > best_gain )
+         {
+            best_gain = gain;
+            best = r;
+         }
+      };
+
+      if ( !nodes[b].is_leaf( ) )
+      {
+         float const area = nodes[b].box.get_surface_area( );
+
+         /* c goes under b in place of one of its children, which takes the
+            place of c. */
+         consider( rotation::e_child_2_with_grandchild_1, area, merge( nodes[c].box, nodes[nodes[b].child_2].box ) );
+         consider( rotation::e_child_2_with_grandchild_2, area, merge( nodes[nodes[b].child_1].box, nodes[c].box ) );
+      }
+
+      if ( !nodes[c].is_leaf( ) )
+      {
+         float const area = nodes[c].box.get_surface_area( );
+
+         consider( rotation::e_child_1_with_grandchild_1, area, merge( nodes[b].box, nodes[nodes[c].child_2].box ) );
+         consider( rotation::e_child_1_with_grandchild_2, area, merge( nodes[nodes[c].child_1].box, nodes[b].box ) );
+      }
+
+      /* Swap the child of index with the grandchild under the other child,
+         and refit that other child. */
+      auto const swap = [this, index] ( std::uint32_t child, std::uint32_t parent_of_grandchild, bool is_first_grandchild )
+      {
+         auto& n = nodes[index];
+         auto& p = nodes[parent_of_grandchild];
+
+         std::uint32_t const grandchild = is_first_grandchild ? p.child_1 : p.child_2;
+
+         if ( n.child_1 == child )
+         {
+            n.child_1 = grandchild;
+         }
+         else
+         {
+            n.child_2 = grandchild;
+         }
+
+         if ( is_first_grandchild )
+         {
+            p.child_1 = child;
+         }
+         else
+         {
+            p.child_2 = child;
+         }
+
+         nodes[grandchild].parent = index;
+         nodes[child].parent = parent_of_grandchild;
+
+         p.box = merge( nodes[p.child_1].box, nodes[p.child_2].box );
+         p.height = 1 + std::max( nodes[p.child_1].height, nodes[p.child_2].height );
+         n.height = 1 + std::max( nodes[n.child_1].height, nodes[n.child_2].height );
+      };
+
+      switch( best )
+      {
+         case rotation::e_none: 
+            break;
+         case rotation::e_child_2_with_grandchild_1:
+            swap( c, b, true );
+            break;
+         case rotation::e_child_2_with_grandchild_2:
+            swap( c, b, false );
+            break;
+         case rotation::e_child_1_with_grandchild_1:
+            swap( b, c, true );
+            break;
+         case rotation::e_child_1_with_grandchild_2:
+            swap( b, c, false );
+            break;
+      }
+   }
+
+   aabb aabb_tree::get_fat( aabb const& box ) const noexcept
+   {
+      return aabb{ box.min - glm::vec3( margin ), box.max + glm::vec3( margin ) };
+   }
+} // namespace gfx
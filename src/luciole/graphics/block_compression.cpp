@@ -0,0 +1,1093 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/block_compression.hpp>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#  include <emmintrin.h>
+#  define LUCIOLE_BLOCK_COMPRESSION_SSE2
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace gfx
+{
+   namespace
+   {
+      /**
+       * @brief The 16 pixels of a block, one array per channel, with
+       * values in [0, 255].
+       */
+      struct pixel_block
+      {
+         alignas( 16 ) float channels[4][16];
+      }; // struct pixel_block
+
+      /**
+       * @brief Reads and writes the fields of a 128 bit block, starting
+       * from the least significant bit.
+       */
+      class block_bits
+      {
+      public:
+         block_bits( ) = default;
+         explicit block_bits( std::byte const* p_src ) noexcept
+         {
+            std::memcpy( words, p_src, sizeof( words ) );
+         }
+
+         void write( std::uint32_t value, std::uint32_t count ) noexcept
+         {
+            for( std::uint32_t i = 0; i < count; ++i, ++position )
+            {
+               words[position / 64] |= std::uint64_t( ( value >> i ) & 1 ) << ( position % 64 );
+            }
+         }
+
+         std::uint32_t read( std::uint32_t count ) noexcept
+         {
+            std::uint32_t value = 0;
+            for( std::uint32_t i = 0; i < count; ++i, ++position )
+            {
+               value |= std::uint32_t( ( words[position / 64] >> ( position % 64 ) ) & 1 ) << i;
+            }
+
+            return value;
+         }
+
+         void store( std::byte* p_dst ) const noexcept
+         {
+            std::memcpy( p_dst, words, sizeof( words ) );
+         }
+
+      private:
+         std::uint64_t words[2] = { 0, 0 };
+         std::uint32_t position = 0;
+      }; // class block_bits
+
+      static constexpr std::uint32_t bc7_weights_2[4] = { 0, 21, 43, 64 };
+      static constexpr std::uint32_t bc7_weights_3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+      static constexpr std::uint32_t bc7_weights_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+      pixel_block load_block( std::uint8_t const* p_rgba ) noexcept
+      {
+         pixel_block block;
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            for( std::uint32_t c = 0; c < 4; ++c )
+            {
+               block.channels[c][i] = static_cast<float>( p_rgba[i * 4 + c] );
+            }
+         }
+
+         return block;
+      }
+
+      float clamp_unorm8( float value ) noexcept
+      {
+         return std::clamp( value, 0.0f, 255.0f );
+      }
+
+      /**
+       * @brief Find for every pixel the closest entry of a palette.
+       *
+       * @param [in] p_palette The palette entries, with a value for each
+       * channel.
+       * @param [in] p_weights How much each channel counts in the distance,
+       * 0 to ignore a channel.
+       * @param [out] p_indices The index of the closest entry of every pixel.
+       *
+       * @return The sum of the weighted squared distances.
+       */
+      float select_indices( 
+         pixel_block const& block, 
+         float const ( *p_palette )[4], std::uint32_t entry_count, 
+         float const* p_weights, 
+         std::uint8_t* p_indices ) noexcept
+      {
+         float total_error = 0.0f;
+
+#if defined( LUCIOLE_BLOCK_COMPRESSION_SSE2 )
+         for( std::uint32_t i = 0; i < 16; i += 4 )
+         {
+            __m128 best_error = _mm_set1_ps( FLT_MAX );
+            __m128i best_index = _mm_setzero_si128( );
+
+            for( std::uint32_t entry = 0; entry < entry_count; ++entry )
+            {
+               __m128 error = _mm_setzero_ps( );
+               for( std::uint32_t c = 0; c < 4; ++c )
+               {
+                  if ( p_weights[c] != 0.0f )
+                  {
+                     __m128 const diff = _mm_sub_ps( _mm_load_ps( block.channels[c] + i ), _mm_set1_ps( p_palette[entry][c] ) );
+                     error = _mm_add_ps( error, _mm_mul_ps( _mm_mul_ps( diff, diff ), _mm_set1_ps( p_weights[c] ) ) );
+                  }
+               }
+
+               __m128i const is_better = _mm_castps_si128( _mm_cmplt_ps( error, best_error ) );
+               best_error = _mm_min_ps( error, best_error );
+               best_index = _mm_or_si128( 
+                  _mm_andnot_si128( is_better, best_index ), 
+                  _mm_and_si128( is_better, _mm_set1_epi32( static_cast<int>( entry ) ) ) 
+               );
+            }
+
+            alignas( 16 ) std::int32_t indices[4];
+            alignas( 16 ) float errors[4];
+            _mm_store_si128( reinterpret_cast<__m128i*>( indices ), best_index );
+            _mm_store_ps( errors, best_error );
+
+            for( std::uint32_t j = 0; j < 4; ++j )
+            {
+               p_indices[i + j] = static_cast<std::uint8_t>( indices[j] );
+               total_error += errors[j];
+            }
+         }
+#else
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            float best_error = FLT_MAX;
+            for( std::uint32_t entry = 0; entry < entry_count; ++entry )
+            {
+               float error = 0.0f;
+               for( std::uint32_t c = 0; c < 4; ++c )
+               {
+                  float const diff = block.channels[c][i] - p_palette[entry][c];
+                  error += diff * diff * p_weights[c];
+               }
+
+               if ( error < best_error )
+               {
+                  best_error = error;
+                  p_indices[i] = static_cast<std::uint8_t>( entry );
+               }
+            }
+
+            total_error += best_error;
+         }
+#endif
+
+         return total_error;
+      }
+
+      /**
+       * @brief Find two endpoints on the principal axis of the pixels that
+       * enclose all of them.
+       */
+      void find_endpoints( pixel_block const& block, std::uint32_t channel_count, float* p_e0, float* p_e1 ) noexcept
+      {
+         float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+         float lo[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+         float hi[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+         for( std::uint32_t c = 0; c < channel_count; ++c )
+         {
+            for( std::uint32_t i = 0; i < 16; ++i )
+            {
+               mean[c] += block.channels[c][i];
+               lo[c] = std::min( lo[c], block.channels[c][i] );
+               hi[c] = std::max( hi[c], block.channels[c][i] );
+            }
+
+            mean[c] /= 16.0f;
+         }
+
+         float covariance[4][4] = { };
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            for( std::uint32_t a = 0; a < channel_count; ++a )
+            {
+               for( std::uint32_t b = 0; b < channel_count; ++b )
+               {
+                  covariance[a][b] += ( block.channels[a][i] - mean[a] ) * ( block.channels[b][i] - mean[b] );
+               }
+            }
+         }
+
+         // Power iteration, starting from the diagonal of the bounding box.
+         float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+         for( std::uint32_t c = 0; c < channel_count; ++c )
+         {
+            axis[c] = hi[c] - lo[c];
+         }
+
+         for( std::uint32_t iteration = 0; iteration < 8; ++iteration )
+         {
+            float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            float largest = 0.0f;
+            for( std::uint32_t a = 0; a < channel_count; ++a )
+            {
+               for( std::uint32_t b = 0; b < channel_count; ++b )
+               {
+                  next[a] += covariance[a][b] * axis[b];
+               }
+
+               largest = std::max( largest, std::abs( next[a] ) );
+            }
+
+            if ( largest < FLT_EPSILON )
+            {
+               break;
+            }
+
+            for( std::uint32_t c = 0; c < channel_count; ++c )
+            {
+               axis[c] = next[c] / largest;
+            }
+         }
+
+         float length = 0.0f;
+         for( std::uint32_t c = 0; c < channel_count; ++c )
+         {
+            length += axis[c] * axis[c];
+         }
+
+         if ( length < FLT_EPSILON )
+         {
+            std::copy( mean, mean + 4, p_e0 );
+            std::copy( mean, mean + 4, p_e1 );
+
+            return;
+         }
+
+         float t_min = FLT_MAX;
+         float t_max = -FLT_MAX;
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            float t = 0.0f;
+            for( std::uint32_t c = 0; c < channel_count; ++c )
+            {
+               t += ( block.channels[c][i] - mean[c] ) * axis[c];
+            }
+
+            t_min = std::min( t_min, t / length );
+            t_max = std::max( t_max, t / length );
+         }
+
+         for( std::uint32_t c = 0; c < 4; ++c )
+         {
+            p_e0[c] = clamp_unorm8( mean[c] + axis[c] * t_min );
+            p_e1[c] = clamp_unorm8( mean[c] + axis[c] * t_max );
+         }
+      }
+
+      /**
+       * @brief Find the endpoints that minimize the squared error of the
+       * pixels for a fixed set of indices.
+       *
+       * @param [in] p_weights The position of each index between the
+       * endpoints, from 0 at the first to 1 at the second.
+       *
+       * @return false if the indices do not constrain both endpoints.
+       */
+      bool fit_endpoints( 
+         pixel_block const& block, std::uint32_t channel_count, 
+         std::uint8_t const* p_indices, float const* p_weights, 
+         float* p_e0, float* p_e1 ) noexcept
+      {
+         float aa = 0.0f;
+         float ab = 0.0f;
+         float bb = 0.0f;
+         float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+         float bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            float const b = p_weights[p_indices[i]];
+            float const a = 1.0f - b;
+
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+
+            for( std::uint32_t c = 0; c < channel_count; ++c )
+            {
+               ax[c] += a * block.channels[c][i];
+               bx[c] += b * block.channels[c][i];
+            }
+         }
+
+         float const determinant = aa * bb - ab * ab;
+         if ( std::abs( determinant ) < 1e-6f )
+         {
+            return false;
+         }
+
+         for( std::uint32_t c = 0; c < channel_count; ++c )
+         {
+            p_e0[c] = clamp_unorm8( ( bb * ax[c] - ab * bx[c] ) / determinant );
+            p_e1[c] = clamp_unorm8( ( aa * bx[c] - ab * ax[c] ) / determinant );
+         }
+
+         return true;
+      }
+
+      std::uint16_t pack_565( float const* p_color ) noexcept
+      {
+         auto const r = static_cast<std::uint16_t>( std::lround( p_color[0] * 31.0f / 255.0f ) );
+         auto const g = static_cast<std::uint16_t>( std::lround( p_color[1] * 63.0f / 255.0f ) );
+         auto const b = static_cast<std::uint16_t>( std::lround( p_color[2] * 31.0f / 255.0f ) );
+
+         return static_cast<std::uint16_t>( ( r << 11 ) | ( g << 5 ) | b );
+      }
+
+      void unpack_565( std::uint16_t color, float* p_color ) noexcept
+      {
+         std::uint32_t const r = ( color >> 11 ) & 31;
+         std::uint32_t const g = ( color >> 5 ) & 63;
+         std::uint32_t const b = color & 31;
+
+         p_color[0] = static_cast<float>( ( r << 3 ) | ( r >> 2 ) );
+         p_color[1] = static_cast<float>( ( g << 2 ) | ( g >> 4 ) );
+         p_color[2] = static_cast<float>( ( b << 3 ) | ( b >> 2 ) );
+         p_color[3] = 255.0f;
+      }
+
+      /**
+       * @brief Build the palette of a BC1 color block. In the three color 
+       * mode, the last entry is transparent black.
+       */
+      void build_color_palette( std::uint16_t c0, std::uint16_t c1, bool four_colors, float ( *p_palette )[4] ) noexcept
+      {
+         unpack_565( c0, p_palette[0] );
+         unpack_565( c1, p_palette[1] );
+
+         for( std::uint32_t c = 0; c < 3; ++c )
+         {
+            float const a = p_palette[0][c];
+            float const b = p_palette[1][c];
+
+            if ( four_colors )
+            {
+               p_palette[2][c] = std::floor( ( 2.0f * a + b ) / 3.0f );
+               p_palette[3][c] = std::floor( ( a + 2.0f * b ) / 3.0f );
+            }
+            else
+            {
+               p_palette[2][c] = std::floor( ( a + b ) / 2.0f );
+               p_palette[3][c] = 0.0f;
+            }
+         }
+
+         p_palette[2][3] = 255.0f;
+         p_palette[3][3] = four_colors ? 255.0f : 0.0f;
+      }
+
+      /**
+       * @brief Build the palette of a BC4 block.
+       */
+      void build_alpha_palette( std::uint8_t a0, std::uint8_t a1, float* p_palette ) noexcept
+      {
+         p_palette[0] = a0;
+         p_palette[1] = a1;
+
+         if ( a0 > a1 )
+         {
+            for( std::uint32_t i = 1; i < 7; ++i )
+            {
+               p_palette[i + 1] = static_cast<float>( ( ( 7 - i ) * a0 + i * a1 + 3 ) / 7 );
+            }
+         }
+         else
+         {
+            for( std::uint32_t i = 1; i < 5; ++i )
+            {
+               p_palette[i + 1] = static_cast<float>( ( ( 5 - i ) * a0 + i * a1 + 2 ) / 5 );
+            }
+
+            p_palette[6] = 0.0f;
+            p_palette[7] = 255.0f;
+         }
+      }
+
+      float encode_color_indices( 
+         pixel_block const& block, 
+         std::uint16_t c0, std::uint16_t c1, bool always_four_colors, 
+         std::uint8_t* p_indices ) noexcept
+      {
+         bool const four_colors = always_four_colors || c0 > c1;
+
+         float palette[4][4];
+         build_color_palette( c0, c1, four_colors, palette );
+
+         float const weights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+
+         return select_indices( block, palette, four_colors ? 4 : 3, weights, p_indices );
+      }
+
+      /**
+       * @brief Compress the color of a block in the BC1 layout. BC3 color
+       * blocks are always decoded with four colors and cannot have
+       * transparent pixels.
+       */
+      void compress_color( pixel_block const& block, bool is_bc3, std::byte* p_dst ) noexcept
+      {
+         pixel_block colors = block;
+
+         std::uint32_t first_opaque = 16;
+         bool has_transparent = false;
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            if ( is_bc3 || block.channels[3][i] >= 128.0f )
+            {
+               first_opaque = std::min( first_opaque, i );
+            }
+            else
+            {
+               has_transparent = true;
+            }
+         }
+
+         std::uint16_t c0 = 0;
+         std::uint16_t c1 = 0;
+         std::uint8_t indices[16];
+
+         if ( first_opaque == 16 )
+         {
+            std::fill( indices, indices + 16, std::uint8_t( 3 ) );
+         }
+         else
+         {
+            // Transparent pixels take the color of an opaque one to keep them
+            // out of the endpoint search.
+            if ( has_transparent )
+            {
+               for( std::uint32_t i = 0; i < 16; ++i )
+               {
+                  if ( block.channels[3][i] < 128.0f )
+                  {
+                     for( std::uint32_t c = 0; c < 3; ++c )
+                     {
+                        colors.channels[c][i] = block.channels[c][first_opaque];
+                     }
+                  }
+               }
+            }
+
+            float e0[4];
+            float e1[4];
+            find_endpoints( colors, 3, e0, e1 );
+
+            c0 = pack_565( e1 );
+            c1 = pack_565( e0 );
+            if ( has_transparent ? c0 > c1 : c0 < c1 )
+            {
+               std::swap( c0, c1 );
+            }
+
+            float error = encode_color_indices( colors, c0, c1, is_bc3, indices );
+
+            if ( !has_transparent )
+            {
+               static constexpr float four_color_weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+               static constexpr float three_color_weights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+               bool const four_colors = is_bc3 || c0 > c1;
+               if ( fit_endpoints( colors, 3, indices, four_colors ? four_color_weights : three_color_weights, e0, e1 ) )
+               {
+                  std::uint16_t refined_c0 = pack_565( e0 );
+                  std::uint16_t refined_c1 = pack_565( e1 );
+                  if ( !is_bc3 && refined_c0 < refined_c1 )
+                  {
+                     std::swap( refined_c0, refined_c1 );
+                  }
+
+                  std::uint8_t refined_indices[16];
+                  if ( encode_color_indices( colors, refined_c0, refined_c1, is_bc3, refined_indices ) < error )
+                  {
+                     c0 = refined_c0;
+                     c1 = refined_c1;
+                     std::copy( refined_indices, refined_indices + 16, indices );
+                  }
+               }
+            }
+            else
+            {
+               for( std::uint32_t i = 0; i < 16; ++i )
+               {
+                  if ( block.channels[3][i] < 128.0f )
+                  {
+                     indices[i] = 3;
+                  }
+               }
+            }
+         }
+
+         std::uint32_t bits = 0;
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            bits |= std::uint32_t( indices[i] ) << ( i * 2 );
+         }
+
+         std::memcpy( p_dst, &c0, sizeof( c0 ) );
+         std::memcpy( p_dst + 2, &c1, sizeof( c1 ) );
+         std::memcpy( p_dst + 4, &bits, sizeof( bits ) );
+      }
+
+      /**
+       * @brief Compress one channel of a block in the BC4 layout, trying
+       * both the 8 value mode and the 6 value mode with explicit 0 and 255.
+       */
+      void compress_channel( pixel_block const& block, std::uint32_t channel, std::byte* p_dst ) noexcept
+      {
+         float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+         weights[channel] = 1.0f;
+
+         float const* p_values = block.channels[channel];
+
+         float lo = 255.0f;
+         float hi = 0.0f;
+         float inner_lo = 255.0f;
+         float inner_hi = 0.0f;
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            lo = std::min( lo, p_values[i] );
+            hi = std::max( hi, p_values[i] );
+
+            if ( p_values[i] > 0.0f && p_values[i] < 255.0f )
+            {
+               inner_lo = std::min( inner_lo, p_values[i] );
+               inner_hi = std::max( inner_hi, p_values[i] );
+            }
+         }
+
+         auto const encode = [&] ( std::uint8_t a0, std::uint8_t a1, std::uint8_t* p_indices )
+         {
+            float values[8];
+            build_alpha_palette( a0, a1, values );
+
+            float palette[8][4] = { };
+            for( std::uint32_t i = 0; i < 8; ++i )
+            {
+               palette[i][channel] = values[i];
+            }
+
+            return select_indices( block, palette, 8, weights, p_indices );
+         };
+
+         auto a0 = static_cast<std::uint8_t>( std::lround( hi ) );
+         auto a1 = static_cast<std::uint8_t>( std::lround( lo ) );
+
+         std::uint8_t indices[16] = { };
+         if ( a0 != a1 )
+         {
+            float const error = encode( a0, a1, indices );
+
+            if ( inner_lo < inner_hi )
+            {
+               auto const b0 = static_cast<std::uint8_t>( std::lround( inner_lo ) );
+               auto const b1 = static_cast<std::uint8_t>( std::lround( inner_hi ) );
+
+               std::uint8_t inner_indices[16];
+               if ( encode( b0, b1, inner_indices ) < error )
+               {
+                  a0 = b0;
+                  a1 = b1;
+                  std::copy( inner_indices, inner_indices + 16, indices );
+               }
+            }
+         }
+
+         std::uint64_t bits = 0;
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            bits |= std::uint64_t( indices[i] ) << ( i * 3 );
+         }
+
+         p_dst[0] = static_cast<std::byte>( a0 );
+         p_dst[1] = static_cast<std::byte>( a1 );
+         for( std::uint32_t i = 0; i < 6; ++i )
+         {
+            p_dst[2 + i] = static_cast<std::byte>( ( bits >> ( i * 8 ) ) & 0xff );
+         }
+      }
+
+      /**
+       * @brief Quantize a BC7 mode 6 endpoint to 7 bits a channel and the
+       * shared p-bit closest to it.
+       */
+      void quantize_bc7_endpoint( float const* p_endpoint, std::uint32_t* p_quantized, std::uint32_t& pbit ) noexcept
+      {
+         float best_error = FLT_MAX;
+         for( std::uint32_t p = 0; p < 2; ++p )
+         {
+            float error = 0.0f;
+            std::uint32_t quantized[4];
+            for( std::uint32_t c = 0; c < 4; ++c )
+            {
+               quantized[c] = static_cast<std::uint32_t>( std::clamp( std::lround( ( p_endpoint[c] - p ) / 2.0f ), 0l, 127l ) );
+
+               float const diff = static_cast<float>( quantized[c] * 2 + p ) - p_endpoint[c];
+               error += diff * diff;
+            }
+
+            if ( error < best_error )
+            {
+               best_error = error;
+               pbit = p;
+               std::copy( quantized, quantized + 4, p_quantized );
+            }
+         }
+      }
+
+      float encode_bc7_indices(
+         pixel_block const& block,
+         std::uint32_t const* p_q0, std::uint32_t p0,
+         std::uint32_t const* p_q1, std::uint32_t p1,
+         std::uint8_t* p_indices ) noexcept
+      {
+         float palette[16][4];
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            for( std::uint32_t c = 0; c < 4; ++c )
+            {
+               std::uint32_t const e0 = p_q0[c] * 2 + p0;
+               std::uint32_t const e1 = p_q1[c] * 2 + p1;
+
+               palette[i][c] = static_cast<float>( ( ( 64 - bc7_weights_4[i] ) * e0 + bc7_weights_4[i] * e1 + 32 ) >> 6 );
+            }
+         }
+
+         float const weights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+         return select_indices( block, palette, 16, weights, p_indices );
+      }
+
+      /**
+       * @brief Compress a block in BC7 mode 6: a single subset with RGBA
+       * endpoints and 16 interpolation steps.
+       */
+      void compress_bc7( pixel_block const& block, std::byte* p_dst ) noexcept
+      {
+         float e0[4];
+         float e1[4];
+         find_endpoints( block, 4, e0, e1 );
+
+         std::uint32_t q0[4];
+         std::uint32_t q1[4];
+         std::uint32_t p0 = 0;
+         std::uint32_t p1 = 0;
+         quantize_bc7_endpoint( e0, q0, p0 );
+         quantize_bc7_endpoint( e1, q1, p1 );
+
+         std::uint8_t indices[16];
+         float const error = encode_bc7_indices( block, q0, p0, q1, p1, indices );
+
+         float index_weights[16];
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            index_weights[i] = static_cast<float>( bc7_weights_4[i] ) / 64.0f;
+         }
+
+         if ( fit_endpoints( block, 4, indices, index_weights, e0, e1 ) )
+         {
+            std::uint32_t refined_q0[4];
+            std::uint32_t refined_q1[4];
+            std::uint32_t refined_p0 = 0;
+            std::uint32_t refined_p1 = 0;
+            quantize_bc7_endpoint( e0, refined_q0, refined_p0 );
+            quantize_bc7_endpoint( e1, refined_q1, refined_p1 );
+
+            std::uint8_t refined_indices[16];
+            if ( encode_bc7_indices( block, refined_q0, refined_p0, refined_q1, refined_p1, refined_indices ) < error )
+            {
+               std::copy( refined_q0, refined_q0 + 4, q0 );
+               std::copy( refined_q1, refined_q1 + 4, q1 );
+               p0 = refined_p0;
+               p1 = refined_p1;
+               std::copy( refined_indices, refined_indices + 16, indices );
+            }
+         }
+
+         // The most significant bit of the first index is implicit and 0.
+         if ( indices[0] >= 8 )
+         {
+            std::swap( q0, q1 );
+            std::swap( p0, p1 );
+            for( auto& index : indices )
+            {
+               index = static_cast<std::uint8_t>( 15 - index );
+            }
+         }
+
+         block_bits bits;
+         bits.write( 1 << 6, 7 );
+         for( std::uint32_t c = 0; c < 4; ++c )
+         {
+            bits.write( q0[c], 7 );
+            bits.write( q1[c], 7 );
+         }
+
+         bits.write( p0, 1 );
+         bits.write( p1, 1 );
+
+         bits.write( indices[0], 3 );
+         for( std::uint32_t i = 1; i < 16; ++i )
+         {
+            bits.write( indices[i], 4 );
+         }
+
+         bits.store( p_dst );
+      }
+
+      void decompress_color( std::byte const* p_src, bool is_bc3, std::uint8_t* p_rgba ) noexcept
+      {
+         std::uint16_t c0;
+         std::uint16_t c1;
+         std::uint32_t bits;
+         std::memcpy( &c0, p_src, sizeof( c0 ) );
+         std::memcpy( &c1, p_src + 2, sizeof( c1 ) );
+         std::memcpy( &bits, p_src + 4, sizeof( bits ) );
+
+         float palette[4][4];
+         build_color_palette( c0, c1, is_bc3 || c0 > c1, palette );
+
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            std::uint32_t const index = ( bits >> ( i * 2 ) ) & 3;
+            for( std::uint32_t c = 0; c < 4; ++c )
+            {
+               p_rgba[i * 4 + c] = static_cast<std::uint8_t>( palette[index][c] );
+            }
+         }
+      }
+
+      void decompress_channel( std::byte const* p_src, std::uint32_t channel, std::uint8_t* p_rgba ) noexcept
+      {
+         float palette[8];
+         build_alpha_palette( static_cast<std::uint8_t>( p_src[0] ), static_cast<std::uint8_t>( p_src[1] ), palette );
+
+         std::uint64_t bits = 0;
+         for( std::uint32_t i = 0; i < 6; ++i )
+         {
+            bits |= std::uint64_t( p_src[2 + i] ) << ( i * 8 );
+         }
+
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            p_rgba[i * 4 + channel] = static_cast<std::uint8_t>( palette[( bits >> ( i * 3 ) ) & 7] );
+         }
+      }
+
+      std::uint32_t expand_bits( std::uint32_t value, std::uint32_t bit_count ) noexcept
+      {
+         value <<= 8 - bit_count;
+
+         return value | ( value >> bit_count );
+      }
+
+      std::uint8_t interpolate_bc7( std::uint32_t e0, std::uint32_t e1, std::uint32_t weight ) noexcept
+      {
+         return static_cast<std::uint8_t>( ( ( 64 - weight ) * e0 + weight * e1 + 32 ) >> 6 );
+      }
+
+      /**
+       * @brief Decompress the single subset BC7 modes 4, 5 and 6.
+       */
+      void decompress_bc7( std::byte const* p_src, std::uint8_t* p_rgba )
+      {
+         block_bits bits( p_src );
+
+         std::uint32_t mode = 0;
+         while( mode < 8 && bits.read( 1 ) == 0 )
+         {
+            ++mode;
+         }
+
+         if ( mode == 8 )
+         {
+            // Reserved mode, decoded as transparent black.
+            std::fill( p_rgba, p_rgba + 64, std::uint8_t( 0 ) );
+
+            return;
+         }
+
+         if ( mode < 4 || mode == 7 )
+         {
+            throw std::runtime_error{ "BC7 mode " + std::to_string( mode ) + " cannot be decoded on the CPU." };
+         }
+
+         std::uint32_t e0[4];
+         std::uint32_t e1[4];
+
+         if ( mode == 6 )
+         {
+            for( std::uint32_t c = 0; c < 4; ++c )
+            {
+               e0[c] = bits.read( 7 ) << 1;
+               e1[c] = bits.read( 7 ) << 1;
+            }
+
+            std::uint32_t const p0 = bits.read( 1 );
+            std::uint32_t const p1 = bits.read( 1 );
+            for( std::uint32_t c = 0; c < 4; ++c )
+            {
+               e0[c] |= p0;
+               e1[c] |= p1;
+            }
+
+            for( std::uint32_t i = 0; i < 16; ++i )
+            {
+               std::uint32_t const weight = bc7_weights_4[bits.read( i == 0 ? 3 : 4 )];
+               for( std::uint32_t c = 0; c < 4; ++c )
+               {
+                  p_rgba[i * 4 + c] = interpolate_bc7( e0[c], e1[c], weight );
+               }
+            }
+
+            return;
+         }
+
+         std::uint32_t const rotation = bits.read( 2 );
+         std::uint32_t const index_mode = mode == 4 ? bits.read( 1 ) : 0;
+
+         std::uint32_t const color_bits = mode == 4 ? 5 : 7;
+         std::uint32_t const alpha_bits = mode == 4 ? 6 : 8;
+         for( std::uint32_t c = 0; c < 3; ++c )
+         {
+            e0[c] = expand_bits( bits.read( color_bits ), color_bits );
+            e1[c] = expand_bits( bits.read( color_bits ), color_bits );
+         }
+
+         e0[3] = expand_bits( bits.read( alpha_bits ), alpha_bits );
+         e1[3] = expand_bits( bits.read( alpha_bits ), alpha_bits );
+
+         // The first index set has 2 bit indices, the second has 3 bit
+         // indices in mode 4 and 2 bit indices in mode 5.
+         std::uint32_t const second_bits = mode == 4 ? 3 : 2;
+
+         std::uint32_t first_indices[16];
+         std::uint32_t second_indices[16];
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            first_indices[i] = bits.read( i == 0 ? 1 : 2 );
+         }
+
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            second_indices[i] = bits.read( i == 0 ? second_bits - 1 : second_bits );
+         }
+
+         for( std::uint32_t i = 0; i < 16; ++i )
+         {
+            std::uint32_t color_weight = bc7_weights_2[first_indices[i]];
+            std::uint32_t alpha_weight = second_bits == 3 ? bc7_weights_3[second_indices[i]] : bc7_weights_2[second_indices[i]];
+            if ( index_mode == 1 )
+            {
+               std::swap( color_weight, alpha_weight );
+            }
+
+            std::uint8_t pixel[4];
+            for( std::uint32_t c = 0; c < 3; ++c )
+            {
+               pixel[c] = interpolate_bc7( e0[c], e1[c], color_weight );
+            }
+
+            pixel[3] = interpolate_bc7( e0[3], e1[3], alpha_weight );
+
+            if ( rotation != 0 )
+            {
+               std::swap( pixel[3], pixel[rotation - 1] );
+            }
+
+            std::copy( pixel, pixel + 4, p_rgba + i * 4 );
+         }
+      }
+   } // namespace
+
+   VkFormat to_vk_format( block_format format, bool srgb ) noexcept
+   {
+      switch( format )
+      {
+         case block_format::e_bc1: return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+         case block_format::e_bc3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+         case block_format::e_bc4: return VK_FORMAT_BC4_UNORM_BLOCK;
+         case block_format::e_bc5: return VK_FORMAT_BC5_UNORM_BLOCK;
+         case block_format::e_bc7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+         default: return VK_FORMAT_UNDEFINED;
+      }
+   }
+
+   std::optional<block_format> to_block_format( VkFormat format ) noexcept
+   {
+      switch( format )
+      {
+         case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: 
+         case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: 
+            return block_format::e_bc1;
+         case VK_FORMAT_BC3_UNORM_BLOCK: 
+         case VK_FORMAT_BC3_SRGB_BLOCK: 
+            return block_format::e_bc3;
+         case VK_FORMAT_BC4_UNORM_BLOCK: 
+            return block_format::e_bc4;
+         case VK_FORMAT_BC5_UNORM_BLOCK: 
+            return block_format::e_bc5;
+         case VK_FORMAT_BC7_UNORM_BLOCK: 
+         case VK_FORMAT_BC7_SRGB_BLOCK: 
+            return block_format::e_bc7;
+         default: 
+            return std::nullopt;
+      }
+   }
+
+   void compress_block( block_format format, std::uint8_t const* p_rgba, std::byte* p_dst ) noexcept
+   {
+      auto const block = load_block( p_rgba );
+
+      switch( format )
+      {
+         case block_format::e_bc1:
+            compress_color( block, false, p_dst );
+            break;
+         case block_format::e_bc3:
+            compress_channel( block, 3, p_dst );
+            compress_color( block, true, p_dst + 8 );
+            break;
+         case block_format::e_bc4:
+            compress_channel( block, 0, p_dst );
+            break;
+         case block_format::e_bc5:
+            compress_channel( block, 0, p_dst );
+            compress_channel( block, 1, p_dst + 8 );
+            break;
+         case block_format::e_bc7:
+            compress_bc7( block, p_dst );
+            break;
+      }
+   }
+
+   void decompress_block( block_format format, std::byte const* p_src, std::uint8_t* p_rgba )
+   {
+      switch( format )
+      {
+         case block_format::e_bc1:
+            decompress_color( p_src, false, p_rgba );
+            break;
+         case block_format::e_bc3:
+            decompress_color( p_src + 8, true, p_rgba );
+            decompress_channel( p_src, 3, p_rgba );
+            break;
+         case block_format::e_bc4:
+            for( std::uint32_t i = 0; i < 16; ++i )
+            {
+               p_rgba[i * 4 + 1] = 0;
+               p_rgba[i * 4 + 2] = 0;
+               p_rgba[i * 4 + 3] = 255;
+            }
+
+            decompress_channel( p_src, 0, p_rgba );
+            break;
+         case block_format::e_bc5:
+            for( std::uint32_t i = 0; i < 16; ++i )
+            {
+               p_rgba[i * 4 + 2] = 0;
+               p_rgba[i * 4 + 3] = 255;
+            }
+
+            decompress_channel( p_src, 0, p_rgba );
+            decompress_channel( p_src + 8, 1, p_rgba );
+            break;
+         case block_format::e_bc7:
+            decompress_bc7( p_src, p_rgba );
+            break;
+      }
+   }
+
+   std::vector<std::byte> compress_image( 
+      block_format format, 
+      std::uint8_t const* p_rgba, 
+      std::uint32_t width, std::uint32_t height, 
+      thread_pool* p_thread_pool )
+   {
+      std::uint32_t const blocks_x = ( width + 3 ) / 4;
+      std::uint32_t const blocks_y = ( height + 3 ) / 4;
+      std::size_t const block_size = get_block_size( format );
+
+      std::vector<std::byte> blocks( get_compressed_size( format, width, height ) );
+
+      auto const compress_row = [&] ( std::size_t block_y )
+      {
+         std::uint8_t pixels[64];
+         for( std::uint32_t block_x = 0; block_x < blocks_x; ++block_x )
+         {
+            for( std::uint32_t i = 0; i < 16; ++i )
+            {
+               std::size_t const x = std::min<std::size_t>( block_x * 4 + i % 4, width - 1 );
+               std::size_t const y = std::min<std::size_t>( block_y * 4 + i / 4, height - 1 );
+
+               std::memcpy( pixels + i * 4, p_rgba + ( y * width + x ) * 4, 4 );
+            }
+
+            compress_block( format, pixels, blocks.data( ) + ( block_y * blocks_x + block_x ) * block_size );
+         }
+      };
+
+      if ( p_thread_pool )
+      {
+         p_thread_pool->parallel_for( 0, blocks_y, 1, compress_row );
+      }
+      else
+      {
+         for( std::size_t block_y = 0; block_y < blocks_y; ++block_y )
+         {
+            compress_row( block_y );
+         }
+      }
+
+      return blocks;
+   }
+
+   std::vector<std::byte> decompress_image( 
+      block_format format, 
+      std::byte const* p_blocks, 
+      std::uint32_t width, std::uint32_t height )
+   {
+      std::uint32_t const blocks_x = ( width + 3 ) / 4;
+      std::uint32_t const blocks_y = ( height + 3 ) / 4;
+      std::size_t const block_size = get_block_size( format );
+
+      std::vector<std::byte> pixels( std::size_t( width ) * height * 4 );
+
+      std::uint8_t block[64];
+      for( std::uint32_t block_y = 0; block_y < blocks_y; ++block_y )
+      {
+         for( std::uint32_t block_x = 0; block_x < blocks_x; ++block_x )
+         {
+            decompress_block( format, p_blocks + ( std::size_t( block_y ) * blocks_x + block_x ) * block_size, block );
+
+            for( std::uint32_t i = 0; i < 16; ++i )
+            {
+               std::uint32_t const x = block_x * 4 + i % 4;
+               std::uint32_t const y = block_y * 4 + i / 4;
+               if ( x < width && y < height )
+               {
+                  std::memcpy( pixels.data( ) + ( std::size_t( y ) * width + x ) * 4, block + i * 4, 4 );
+               }
+            }
+         }
+      }
+
+      return pixels;
+   }
+} // namespace gfx
@@ -0,0 +1,562 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/depth_pyramid.hpp>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+namespace gfx
+{
+   namespace
+   {
+      static constexpr std::uint32_t group_size = 8;
+
+      /**
+       * @brief The sizes of the levels read and written by a dispatch, as
+       * laid out in the push constants of the shader.
+       */
+      struct level_data
+      {
+         std::uint32_t source_width;
+         std::uint32_t source_height;
+         std::uint32_t destination_width;
+         std::uint32_t destination_height;
+      }; // struct level_data
+
+      [[nodiscard]]
+      constexpr std::uint32_t previous_power_of_two( std::uint32_t value ) noexcept
+      {
+         std::uint32_t power = 1;
+         while( power * 2 <= value && power * 2 != 0 )
+         {
+            power *= 2;
+         }
+
+         return power;
+      }
+
+      [[nodiscard]]
+      constexpr VkExtent2D get_level_extent( VkExtent2D extent, std::uint32_t level ) noexcept
+      {
+         return { std::max( extent.width >> level, 1u ), std::max( extent.height >> level, 1u ) };
+      }
+   } // namespace
+
+   depth_pyramid::depth_pyramid( create_info_t const& create_info )
+      :
+      p_context( create_info.value( ).p_context ),
+      depth_extent( create_info.value( ).depth_extent ),
+      extent( { 
+         previous_power_of_two( create_info.value( ).depth_extent.width ), 
+         previous_power_of_two( create_info.value( ).depth_extent.height ) 
+      } ),
+      level_count( vk::get_mip_level_count( extent.width, extent.height ) )
+   {
+      try
+      {
+         vk::texture::create_info const pyramid_create_info
+         {
+            .p_context = p_context,
+            .extent = extent,
+            .format = VK_FORMAT_R32_SFLOAT,
+            .mip_levels = level_count,
+            .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+         };
+
+         pyramid = vk::texture( vk::texture::create_info_t( pyramid_create_info ) );
+
+         level_views.reserve( level_count );
+         for( std::uint32_t i = 0; i < level_count; ++i )
+         {
+            VkImageViewCreateInfo const view_create_info
+            {
+               .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+               .pNext = nullptr,
+               .flags = 0,
+               .image = pyramid.get_image( ),
+               .viewType = VK_IMAGE_VIEW_TYPE_2D,
+               .format = VK_FORMAT_R32_SFLOAT,
+               .components = 
+               {
+                  .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                  .a = VK_COMPONENT_SWIZZLE_IDENTITY
+               },
+               .subresourceRange = 
+               {
+                  .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                  .baseMipLevel = i,
+                  .levelCount = 1,
+                  .baseArrayLayer = 0,
+                  .layerCount = 1
+               }
+            };
+
+            auto const res_view = p_context->create_image_view( vk::image_view_create_info_t( view_create_info ) );
+            if ( auto const* p_val = std::get_if<VkImageView>( &res_view ) )
+            {
+               level_views.push_back( *p_val );
+            }
+            else
+            {
+               throw std::runtime_error{ "Depth Pyramid Image View Creation Error: " + std::get<vk::error>( res_view ).to_string( ) + "." };
+            }
+         }
+
+         VkSamplerCreateInfo const sampler_create_info
+         {
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .magFilter = VK_FILTER_NEAREST,
+            .minFilter = VK_FILTER_NEAREST,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .mipLodBias = 0.0f,
+            .anisotropyEnable = VK_FALSE,
+            .maxAnisotropy = 1.0f,
+            .compareEnable = VK_FALSE,
+            .compareOp = VK_COMPARE_OP_ALWAYS,
+            .minLod = 0.0f,
+            .maxLod = static_cast<float>( level_count ),
+            .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+            .unnormalizedCoordinates = VK_FALSE
+         };
+
+         auto const res_sampler = p_context->create_sampler( vk::sampler_create_info_t( sampler_create_info ) );
+         if ( auto const* p_val = std::get_if<VkSampler>( &res_sampler ) )
+         {
+            sampler = *p_val;
+         }
+         else
+         {
+            throw std::runtime_error{ "Depth Pyramid Sampler Creation Error: " + std::get<vk::error>( res_sampler ).to_string( ) + "." };
+         }
+
+         create_descriptor_sets( create_info.value( ).depth_view );
+         create_pipeline( create_info.value( ).spir_v );
+      }
+      catch( ... )
+      {
+         destroy( );
+         throw;
+      }
+   }
+
+   depth_pyramid::depth_pyramid( depth_pyramid&& rhs )
+   {
+      *this = std::move( rhs );
+   }
+
+   depth_pyramid::~depth_pyramid( )
+   {
+      destroy( );
+   }
+
+   depth_pyramid& depth_pyramid::operator=( depth_pyramid&& rhs )
+   {
+      if ( this != &rhs )
+      {
+         destroy( );
+
+         p_context = std::exchange( rhs.p_context, nullptr );
+
+         pyramid = std::move( rhs.pyramid );
+         level_views = std::move( rhs.level_views );
+         sampler = std::exchange( rhs.sampler, VK_NULL_HANDLE );
+
+         descriptor_set_layout = std::exchange( rhs.descriptor_set_layout, VK_NULL_HANDLE );
+         descriptor_pool = std::exchange( rhs.descriptor_pool, VK_NULL_HANDLE );
+         descriptor_sets = std::move( rhs.descriptor_sets );
+         pipeline_layout = std::exchange( rhs.pipeline_layout, VK_NULL_HANDLE );
+         pipeline = std::exchange( rhs.pipeline, VK_NULL_HANDLE );
+
+         depth_extent = std::exchange( rhs.depth_extent, { 0, 0 } );
+         extent = std::exchange( rhs.extent, { 0, 0 } );
+         level_count = std::exchange( rhs.level_count, 0 );
+      }
+
+      return *this;
+   }
+
+   void depth_pyramid::record_build( VkCommandBuffer cmd_buffer ) const noexcept
+   {
+      VkMemoryBarrier const depth_barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+         .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+      };
+
+      // The reads of the last frame are done before the levels are 
+      // discarded.
+      VkImageMemoryBarrier const pyramid_barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = 0,
+         .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+         .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+         .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+         .image = pyramid.get_image( ),
+         .subresourceRange = 
+         {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = level_count,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+         }
+      };
+
+      vkCmdPipelineBarrier( 
+         cmd_buffer, 
+         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+         0, 1, &depth_barrier, 0, nullptr, 1, &pyramid_barrier 
+      );
+
+      vkCmdBindPipeline( cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline );
+
+      VkMemoryBarrier const level_barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+         .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+      };
+
+      for( std::uint32_t i = 0; i < level_count; ++i )
+      {
+         VkExtent2D const source = i == 0 ? depth_extent : get_level_extent( extent, i - 1 );
+         VkExtent2D const destination = get_level_extent( extent, i );
+
+         level_data const data
+         {
+            .source_width = source.width,
+            .source_height = source.height,
+            .destination_width = destination.width,
+            .destination_height = destination.height
+         };
+
+         vkCmdBindDescriptorSets( cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_sets[i], 0, nullptr );
+         vkCmdPushConstants( cmd_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( level_data ), &data );
+         vkCmdDispatch( 
+            cmd_buffer, 
+            ( destination.width + group_size - 1 ) / group_size, 
+            ( destination.height + group_size - 1 ) / group_size, 
+            1 
+         );
+
+         // Each level is read by the next one, and the last by whoever
+         // tests against the pyramid.
+         vkCmdPipelineBarrier( 
+            cmd_buffer, 
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+            0, 1, &level_barrier, 0, nullptr, 0, nullptr 
+         );
+      }
+   }
+
+   VkImageView depth_pyramid::get_image_view( ) const noexcept
+   {
+      return pyramid.get_image_view( );
+   }
+
+   VkSampler depth_pyramid::get_sampler( ) const noexcept
+   {
+      return sampler;
+   }
+
+   VkExtent2D depth_pyramid::get_extent( ) const noexcept
+   {
+      return extent;
+   }
+
+   std::uint32_t depth_pyramid::get_level_count( ) const noexcept
+   {
+      return level_count;
+   }
+
+   void depth_pyramid::create_pipeline( std::vector<std::uint32_t> const& spir_v )
+   {
+      VkPushConstantRange const push_constant_range
+      {
+         .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+         .offset = 0,
+         .size = sizeof( level_data )
+      };
+
+      VkPipelineLayoutCreateInfo const layout_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .setLayoutCount = 1,
+         .pSetLayouts = &descriptor_set_layout,
+         .pushConstantRangeCount = 1,
+         .pPushConstantRanges = &push_constant_range
+      };
+
+      auto const res_layout = p_context->create_pipeline_layout( vk::pipeline_layout_create_info_t( layout_create_info ) );
+      if ( auto const* p_val = std::get_if<VkPipelineLayout>( &res_layout ) )
+      {
+         pipeline_layout = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "Depth Pyramid Pipeline Layout Creation Error: " + std::get<vk::error>( res_layout ).to_string( ) + "." };
+      }
+
+      VkShaderModuleCreateInfo const module_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .codeSize = spir_v.size( ) * sizeof( std::uint32_t ),
+         .pCode = spir_v.data( )
+      };
+
+      auto const shader_module = p_context->create_shader_module( vk::shader_module_create_info_t( module_create_info ) );
+      if ( shader_module == VK_NULL_HANDLE )
+      {
+         throw std::runtime_error{ "Depth Pyramid Error: failed to create the shader module." };
+      }
+
+      VkComputePipelineCreateInfo const pipeline_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .stage = VkPipelineShaderStageCreateInfo
+         {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shader_module,
+            .pName = "main",
+            .pSpecializationInfo = nullptr
+         },
+         .layout = pipeline_layout,
+         .basePipelineHandle = VK_NULL_HANDLE,
+         .basePipelineIndex = -1
+      };
+
+      auto const res_pipeline = p_context->create_pipeline( vk::compute_pipeline_create_info_t( pipeline_create_info ) );
+
+      p_context->destroy_shader_module( vk::shader_module_t( shader_module ) );
+
+      if ( auto const* p_val = std::get_if<VkPipeline>( &res_pipeline ) )
+      {
+         pipeline = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "Depth Pyramid Pipeline Creation Error: " + std::get<vk::error>( res_pipeline ).to_string( ) + "." };
+      }
+   }
+
+   void depth_pyramid::create_descriptor_sets( VkImageView depth_view )
+   {
+      std::array<VkDescriptorSetLayoutBinding, 2> const bindings = 
+      {
+         VkDescriptorSetLayoutBinding
+         {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr
+         },
+         VkDescriptorSetLayoutBinding
+         {
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr
+         }
+      };
+
+      VkDescriptorSetLayoutCreateInfo const layout_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .bindingCount = static_cast<std::uint32_t>( bindings.size( ) ),
+         .pBindings = bindings.data( )
+      };
+
+      auto const res_layout = p_context->create_descriptor_set_layout( vk::descriptor_set_layout_create_info_t( layout_create_info ) );
+      if ( auto const* p_val = std::get_if<VkDescriptorSetLayout>( &res_layout ) )
+      {
+         descriptor_set_layout = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "Depth Pyramid Descriptor Set Layout Creation Error: " + std::get<vk::error>( res_layout ).to_string( ) + "." };
+      }
+
+      std::array<VkDescriptorPoolSize, 2> const pool_sizes = 
+      {
+         VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = level_count },
+         VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = level_count }
+      };
+
+      VkDescriptorPoolCreateInfo const pool_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .maxSets = level_count,
+         .poolSizeCount = static_cast<std::uint32_t>( pool_sizes.size( ) ),
+         .pPoolSizes = pool_sizes.data( )
+      };
+
+      auto const res_pool = p_context->create_descriptor_pool( vk::descriptor_pool_create_info_t( pool_create_info ) );
+      if ( auto const* p_val = std::get_if<VkDescriptorPool>( &res_pool ) )
+      {
+         descriptor_pool = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "Depth Pyramid Descriptor Pool Creation Error: " + std::get<vk::error>( res_pool ).to_string( ) + "." };
+      }
+
+      std::vector<VkDescriptorSetLayout> const set_layouts( level_count, descriptor_set_layout );
+
+      VkDescriptorSetAllocateInfo const set_allocate_info
+      {
+         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+         .pNext = nullptr,
+         .descriptorPool = descriptor_pool,
+         .descriptorSetCount = level_count,
+         .pSetLayouts = set_layouts.data( )
+      };
+
+      descriptor_sets.resize( level_count, VK_NULL_HANDLE );
+
+      vk::error const err( vk::result_t( 
+         vkAllocateDescriptorSets( p_context->get( ), &set_allocate_info, descriptor_sets.data( ) ) 
+      ) );
+
+      if ( err.is_error( ) )
+      {
+         throw std::runtime_error{ "Depth Pyramid Descriptor Set Allocation Error: " + err.to_string( ) + "." };
+      }
+
+      // Level i reads level i - 1, and the first one the depth buffer.
+      for( std::uint32_t i = 0; i < level_count; ++i )
+      {
+         std::array<VkDescriptorImageInfo, 2> const image_infos = 
+         {
+            VkDescriptorImageInfo
+            {
+               .sampler = sampler,
+               .imageView = i == 0 ? depth_view : level_views[i - 1],
+               .imageLayout = i == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+            },
+            VkDescriptorImageInfo
+            {
+               .sampler = VK_NULL_HANDLE,
+               .imageView = level_views[i],
+               .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+            }
+         };
+
+         std::array<VkWriteDescriptorSet, 2> writes = { };
+         for( std::uint32_t j = 0; j < writes.size( ); ++j )
+         {
+            writes[j] = VkWriteDescriptorSet
+            {
+               .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+               .pNext = nullptr,
+               .dstSet = descriptor_sets[i],
+               .dstBinding = j,
+               .dstArrayElement = 0,
+               .descriptorCount = 1,
+               .descriptorType = bindings[j].descriptorType,
+               .pImageInfo = &image_infos[j],
+               .pBufferInfo = nullptr,
+               .pTexelBufferView = nullptr
+            };
+         }
+
+         vkUpdateDescriptorSets( p_context->get( ), static_cast<std::uint32_t>( writes.size( ) ), writes.data( ), 0, nullptr );
+      }
+   }
+
+   void depth_pyramid::destroy( ) noexcept
+   {
+      if ( p_context == nullptr )
+      {
+         return;
+      }
+
+      if ( pipeline != VK_NULL_HANDLE )
+      {
+         p_context->destroy_pipeline( vk::pipeline_t( pipeline ) );
+         pipeline = VK_NULL_HANDLE;
+      }
+
+      if ( pipeline_layout != VK_NULL_HANDLE )
+      {
+         p_context->destroy_pipeline_layout( vk::pipeline_layout_t( pipeline_layout ) );
+         pipeline_layout = VK_NULL_HANDLE;
+      }
+
+      // The sets go away with their pool.
+      if ( descriptor_pool != VK_NULL_HANDLE )
+      {
+         descriptor_pool = p_context->destroy_descriptor_pool( vk::descriptor_pool_t( descriptor_pool ) );
+      }
+
+      descriptor_sets.clear( );
+
+      if ( descriptor_set_layout != VK_NULL_HANDLE )
+      {
+         descriptor_set_layout = p_context->destroy_descriptor_set_layout( vk::descriptor_set_layout_t( descriptor_set_layout ) );
+      }
+
+      if ( sampler != VK_NULL_HANDLE )
+      {
+         p_context->destroy_sampler( vk::sampler_t( sampler ) );
+         sampler = VK_NULL_HANDLE;
+      }
+
+      for( auto const view : level_views )
+      {
+         p_context->destroy_image_view( vk::image_view_t( view ) );
+      }
+
+      level_views.clear( );
+      pyramid = vk::texture( );
+
+      p_context = nullptr;
+   }
+} // namespace gfx
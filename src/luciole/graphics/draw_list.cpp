@@ -0,0 +1,317 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/draw_list.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace gfx
+{
+   namespace
+   {
+      static constexpr std::uint32_t radix_bits = 8;
+      static constexpr std::uint32_t radix_size = 1u << radix_bits;
+      static constexpr std::uint32_t radix_pass_count = 64 / radix_bits;
+
+      std::uint64_t quantize_depth( float depth ) noexcept
+      {
+         return static_cast<std::uint64_t>( std::clamp( depth, 0.0f, 1.0f ) * 65535.0f + 0.5f );
+      }
+   } // namespace
+
+   draw_list::draw_list( create_info_t const& create_info )
+      :
+      p_thread_pool( create_info.value( ).p_thread_pool ),
+      items_per_job( std::max( create_info.value( ).items_per_job, 1u ) )
+   {  }
+
+   void draw_list::set_depth_order( std::uint32_t pass, depth_order order )
+   {
+      if ( pass >= max_pass_count )
+      {
+         throw std::runtime_error{ "Draw List Error: pass " + std::to_string( pass ) + " is out of range." };
+      }
+
+      depth_orders[pass] = order;
+   }
+
+   void draw_list::add( draw_item const& item )
+   {
+      if ( item.pass >= max_pass_count || item.pipeline >= max_pipeline_count || 
+           item.material >= max_material_count || item.mesh >= max_mesh_count )
+      {
+         throw std::runtime_error{ "Draw List Error: an id of the draw does not fit in the sort key." };
+      }
+
+      entries.push_back( sort_entry
+      {
+         .key = make_sort_key( item, depth_orders[item.pass] ),
+         .index = static_cast<std::uint32_t>( transforms.size( ) )
+      } );
+
+      transforms.push_back( item.transform );
+   }
+
+   void draw_list::build( )
+   {
+      last_stats = stats{ };
+      last_stats.item_count = static_cast<std::uint32_t>( transforms.size( ) );
+
+      batches.clear( );
+
+      // Only grows, so a frame of the same size does not clear it again.
+      if ( instance_data.size( ) < transforms.size( ) )
+      {
+         instance_data.resize( transforms.size( ) );
+      }
+
+      if ( transforms.empty( ) )
+      {
+         return;
+      }
+
+      sort( );
+
+      std::uint32_t const item_count = last_stats.item_count;
+      std::uint32_t const job_count = ( item_count + items_per_job - 1 ) / items_per_job;
+
+      for_each_job( job_count, [&] ( std::uint32_t first, std::uint32_t last )
+      {
+         for( std::uint32_t i = first; i < last; ++i )
+         {
+            instance_data[i] = transforms[entries[i].index];
+         }
+      } );
+
+      // The state is read back from the sorted keys rather than from the
+      // draws, which would be read out of order.
+      std::uint64_t batch_state = 0;
+      for( std::uint32_t i = 0; i < item_count; ++i )
+      {
+         std::uint64_t const key = entries[i].key;
+         auto const pass = static_cast<std::uint32_t>( key >> 60 );
+         bool const is_back_to_front = depth_orders[pass] == depth_order::e_back_to_front;
+
+         // Back to front, the depth sits above the state and a batch only
+         // merges draws at the same depth.
+         std::uint64_t const state = is_back_to_front ? key : key >> 16;
+         if ( !batches.empty( ) && state == batch_state && batches.back( ).pass == pass )
+         {
+            ++batches.back( ).instance_count;
+            continue;
+         }
+
+         batch_state = state;
+
+         draw_batch batch
+         {
+            .pass = pass,
+            .pipeline = static_cast<std::uint32_t>( key >> ( is_back_to_front ? 32 : 48 ) ) & ( max_pipeline_count - 1 ),
+            .material = static_cast<std::uint32_t>( key >> ( is_back_to_front ? 16 : 32 ) ) & ( max_material_count - 1 ),
+            .mesh = static_cast<std::uint32_t>( key >> ( is_back_to_front ? 0 : 16 ) ) & ( max_mesh_count - 1 ),
+            .first_instance = i,
+            .instance_count = 1
+         };
+
+         // Starting a pass begins a new render pass, nothing stays bound.
+         if ( batches.empty( ) || batches.back( ).pass != batch.pass )
+         {
+            batch.is_pass_changed = true;
+            batch.is_pipeline_changed = true;
+            batch.is_material_changed = true;
+            batch.is_mesh_changed = true;
+         }
+         else
+         {
+            auto const& previous = batches.back( );
+
+            batch.is_pipeline_changed = previous.pipeline != batch.pipeline;
+            batch.is_material_changed = previous.material != batch.material;
+            batch.is_mesh_changed = previous.mesh != batch.mesh;
+         }
+
+         last_stats.pass_count += batch.is_pass_changed;
+         last_stats.pipeline_bind_count += batch.is_pipeline_changed;
+         last_stats.material_bind_count += batch.is_material_changed;
+         last_stats.mesh_bind_count += batch.is_mesh_changed;
+
+         batches.push_back( batch );
+      }
+
+      last_stats.draw_count = static_cast<std::uint32_t>( batches.size( ) );
+   }
+
+   void draw_list::clear( ) noexcept
+   {
+      transforms.clear( );
+      entries.clear( );
+   }
+
+   std::vector<draw_list::draw_batch> const& draw_list::get_batches( ) const noexcept
+   {
+      return batches;
+   }
+
+   std::vector<glm::mat4> const& draw_list::get_instance_data( ) const noexcept
+   {
+      return instance_data;
+   }
+
+   draw_list::stats const& draw_list::get_stats( ) const noexcept
+   {
+      return last_stats;
+   }
+
+   std::uint32_t draw_list::get_item_count( ) const noexcept
+   {
+      return static_cast<std::uint32_t>( transforms.size( ) );
+   }
+
+   std::uint64_t draw_list::make_sort_key( draw_item const& item, depth_order order ) noexcept
+   {
+      std::uint64_t const pass = item.pass & ( max_pass_count - 1 );
+      std::uint64_t const pipeline = item.pipeline & ( max_pipeline_count - 1 );
+      std::uint64_t const material = item.material & ( max_material_count - 1 );
+      std::uint64_t const mesh = item.mesh & ( max_mesh_count - 1 );
+
+      if ( order == depth_order::e_back_to_front )
+      {
+         std::uint64_t const depth = 0xffff - quantize_depth( item.depth );
+
+         return pass << 60 | depth << 44 | pipeline << 32 | material << 16 | mesh;
+      }
+      else
+      {
+         return pass << 60 | pipeline << 48 | material << 32 | mesh << 16 | quantize_depth( item.depth );
+      }
+   }
+
+   void draw_list::sort( )
+   {
+      std::uint32_t const item_count = static_cast<std::uint32_t>( entries.size( ) );
+      std::uint32_t const job_count = ( item_count + items_per_job - 1 ) / items_per_job;
+
+      /*
+         Count the digits of every pass at once to skip the passes where 
+         all the keys agree, which is most of them when few pipelines and 
+         materials are in use. 
+      */
+      histograms.assign( static_cast<std::size_t>( job_count ) * radix_pass_count * radix_size, 0 );
+
+      for_each_job( job_count, [&] ( std::uint32_t first, std::uint32_t last )
+      {
+         auto* p_counts = histograms.data( ) + static_cast<std::size_t>( first / items_per_job ) * radix_pass_count * radix_size;
+         for( std::uint32_t i = first; i < last; ++i )
+         {
+            for( std::uint32_t pass = 0; pass < radix_pass_count; ++pass )
+            {
+               ++p_counts[pass * radix_size + ( ( entries[i].key >> ( pass * radix_bits ) ) & ( radix_size - 1 ) )];
+            }
+         }
+      } );
+
+      std::array<bool, radix_pass_count> is_pass_needed = { };
+      for( std::uint32_t pass = 0; pass < radix_pass_count; ++pass )
+      {
+         for( std::uint32_t digit = 0; digit < radix_size && !is_pass_needed[pass]; ++digit )
+         {
+            std::uint32_t total = 0;
+            for( std::uint32_t job = 0; job < job_count; ++job )
+            {
+               total += histograms[( static_cast<std::size_t>( job ) * radix_pass_count + pass ) * radix_size + digit];
+            }
+
+            is_pass_needed[pass] = total != 0 && total != item_count;
+         }
+
+         last_stats.skipped_sort_pass_count += !is_pass_needed[pass];
+      }
+
+      scratch.resize( item_count );
+
+      for( std::uint32_t pass = 0; pass < radix_pass_count; ++pass )
+      {
+         if ( !is_pass_needed[pass] )
+         {
+            continue;
+         }
+
+         std::uint32_t const shift = pass * radix_bits;
+
+         histograms.assign( static_cast<std::size_t>( job_count ) * radix_size, 0 );
+
+         for_each_job( job_count, [&] ( std::uint32_t first, std::uint32_t last )
+         {
+            auto* p_counts = histograms.data( ) + static_cast<std::size_t>( first / items_per_job ) * radix_size;
+            for( std::uint32_t i = first; i < last; ++i )
+            {
+               ++p_counts[( entries[i].key >> shift ) & ( radix_size - 1 )];
+            }
+         } );
+
+         // The jobs scatter in order for each digit, which keeps the sort stable.
+         std::uint32_t offset = 0;
+         for( std::uint32_t digit = 0; digit < radix_size; ++digit )
+         {
+            for( std::uint32_t job = 0; job < job_count; ++job )
+            {
+               auto& count = histograms[static_cast<std::size_t>( job ) * radix_size + digit];
+               offset += std::exchange( count, offset );
+            }
+         }
+
+         for_each_job( job_count, [&] ( std::uint32_t first, std::uint32_t last )
+         {
+            auto* p_offsets = histograms.data( ) + static_cast<std::size_t>( first / items_per_job ) * radix_size;
+            for( std::uint32_t i = first; i < last; ++i )
+            {
+               scratch[p_offsets[( entries[i].key >> shift ) & ( radix_size - 1 )]++] = entries[i];
+            }
+         } );
+
+         entries.swap( scratch );
+      }
+   }
+
+   template<typename F>
+   void draw_list::for_each_job( std::uint32_t job_count, F const& f )
+   {
+      std::uint32_t const item_count = static_cast<std::uint32_t>( entries.size( ) );
+
+      auto const job = [&] ( std::size_t index )
+      {
+         std::uint32_t const first = static_cast<std::uint32_t>( index ) * items_per_job;
+         f( first, std::min( first + items_per_job, item_count ) );
+      };
+
+      if ( p_thread_pool != nullptr && job_count > 1 )
+      {
+         p_thread_pool->parallel_for( 0, job_count, 1, job );
+      }
+      else
+      {
+         for( std::uint32_t i = 0; i < job_count; ++i )
+         {
+            job( i );
+         }
+      }
+   }
+} // namespace gfx
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/draw_recording.hpp>
+
+namespace gfx
+{
+   std::uint32_t record_draw_list( VkCommandBuffer cmd_buffer, draw_list const& list, std::uint32_t pass, draw_bindings const& bindings )
+   {
+      std::uint32_t draw_count = 0;
+
+      // The batches are sorted by pass, and the first batch of a pass
+      // flags every state, so the state of another pass never leaks in.
+      for( auto const& batch : list.get_batches( ) )
+      {
+         if ( batch.pass != pass )
+         {
+            continue;
+         }
+
+         if ( batch.is_pipeline_changed )
+         {
+            vkCmdBindPipeline( cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindings.pipelines[batch.pipeline] );
+         }
+
+         if ( batch.is_material_changed && !bindings.materials.empty( ) )
+         {
+            vkCmdBindDescriptorSets( 
+               cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindings.pipeline_layout, 
+               1, 1, &bindings.materials[batch.material], 
+               0, nullptr 
+            );
+         }
+
+         auto const& mesh = bindings.meshes[batch.mesh];
+         if ( batch.is_mesh_changed )
+         {
+            VkDeviceSize const offset = 0;
+            vkCmdBindVertexBuffers( cmd_buffer, 0, 1, &mesh.vertex_buffer, &offset );
+            vkCmdBindIndexBuffer( cmd_buffer, mesh.index_buffer, 0, mesh.index_type );
+         }
+
+         vkCmdDrawIndexed( 
+            cmd_buffer, 
+            mesh.range.index_count, batch.instance_count, 
+            mesh.range.first_index, mesh.range.vertex_offset, 
+            batch.first_instance 
+         );
+
+         ++draw_count;
+      }
+
+      return draw_count;
+   }
+} // namespace gfx
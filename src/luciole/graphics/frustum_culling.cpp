@@ -0,0 +1,301 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/frustum_culling.hpp>
+#include <luciole/utils/simd.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace gfx
+{
+   namespace
+   {
+      /**
+       * @brief The planes of a frustum, each component on its own, and 
+       * the absolute value of the normals to project the boxes on them.
+       */
+      struct frustum_planes
+      {
+         float normal_x[6];
+         float normal_y[6];
+         float normal_z[6];
+         float distance[6];
+
+         float abs_x[6];
+         float abs_y[6];
+         float abs_z[6];
+      }; // struct frustum_planes
+
+      struct bounds_arrays
+      {
+         float const* p_center_x;
+         float const* p_center_y;
+         float const* p_center_z;
+
+         float const* p_extent_x;
+         float const* p_extent_y;
+         float const* p_extent_z;
+
+         float const* p_radius;
+      }; // struct bounds_arrays
+
+      /**
+       * @brief Test the objects of [first, last) ops::width at a time, 
+       * and write the indices of the visible ones.
+       *
+       * @param [in, out] first The first object to test, left on the 
+       * first one not tested, less than ops::width before last.
+       *
+       * @return The number of indices written.
+       */
+      template<typename ops>
+      std::uint32_t cull_range( 
+         bounds_arrays const& bounds, 
+         frustum_planes const& planes, 
+         std::uint32_t& first, 
+         std::uint32_t last, 
+         std::uint32_t* p_visible 
+      ) noexcept
+      {
+         using type = typename ops::type;
+         using mask = typename ops::mask;
+
+         std::uint32_t count = 0;
+         type const zero = ops::set1( 0.0f );
+
+         for( ; first + ops::width <= last; first += ops::width )
+         {
+            type const cx = ops::load( bounds.p_center_x + first );
+            type const cy = ops::load( bounds.p_center_y + first );
+            type const cz = ops::load( bounds.p_center_z + first );
+
+            type const ex = ops::load( bounds.p_extent_x + first );
+            type const ey = ops::load( bounds.p_extent_y + first );
+            type const ez = ops::load( bounds.p_extent_z + first );
+
+            type const r = ops::load( bounds.p_radius + first );
+
+            mask outside = ops::less( zero, zero );
+            for( std::uint32_t p = 0; p < 6; ++p )
+            {
+               type distance = ops::mul_add( ops::set1( planes.normal_x[p] ), cx, ops::set1( planes.distance[p] ) );
+               distance = ops::mul_add( ops::set1( planes.normal_y[p] ), cy, distance );
+               distance = ops::mul_add( ops::set1( planes.normal_z[p] ), cz, distance );
+
+               type reach = ops::mul( ops::set1( planes.abs_x[p] ), ex );
+               reach = ops::mul_add( ops::set1( planes.abs_y[p] ), ey, reach );
+               reach = ops::mul_add( ops::set1( planes.abs_z[p] ), ez, reach );
+
+               outside = ops::mask_or( outside, ops::less( ops::add( distance, ops::min( reach, r ) ), zero ) );
+            }
+
+            std::uint32_t const visible_bits = ~ops::get_bits( outside );
+            for( std::uint32_t lane = 0; lane < ops::width; ++lane )
+            {
+               p_visible[count] = first + lane;
+               count += ( visible_bits >> lane ) & 1u;
+            }
+         }
+
+         return count;
+      }
+   } // namespace
+
+   frustum make_frustum( glm::mat4 const& view_projection ) noexcept
+   {
+      auto const row = [&view_projection] ( int i ) 
+      {
+         return glm::vec4( view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i] );
+      };
+
+      frustum res;
+      res.planes[0] = row( 3 ) + row( 0 );
+      res.planes[1] = row( 3 ) - row( 0 );
+      res.planes[2] = row( 3 ) + row( 1 );
+      res.planes[3] = row( 3 ) - row( 1 );
+      res.planes[4] = row( 3 ) + row( 2 );
+      res.planes[5] = row( 3 ) - row( 2 );
+
+      for( auto& plane : res.planes )
+      {
+         float const length = glm::length( glm::vec3( plane ) );
+         if ( length > 0.0f )
+         {
+            plane /= length;
+         }
+      }
+
+      return res;
+   }
+
+   culling_set::culling_set( create_info_t const& create_info )
+      :
+      p_thread_pool( create_info.value( ).p_thread_pool ),
+      objects_per_job( std::max( create_info.value( ).objects_per_job, 1u ) )
+   { }
+
+   std::uint32_t culling_set::add( glm::vec3 const& min, glm::vec3 const& max )
+   {
+      auto const index = static_cast<std::uint32_t>( center_x.size( ) );
+
+      center_x.emplace_back( );
+      center_y.emplace_back( );
+      center_z.emplace_back( );
+      extent_x.emplace_back( );
+      extent_y.emplace_back( );
+      extent_z.emplace_back( );
+      radius.emplace_back( );
+
+      set( index, min, max );
+
+      return index;
+   }
+
+   void culling_set::set( std::uint32_t index, glm::vec3 const& min, glm::vec3 const& max )
+   {
+      glm::vec3 const center = ( min + max ) * 0.5f;
+      glm::vec3 const extent = ( max - min ) * 0.5f;
+
+      center_x[index] = center.x;
+      center_y[index] = center.y;
+      center_z[index] = center.z;
+
+      extent_x[index] = extent.x;
+      extent_y[index] = extent.y;
+      extent_z[index] = extent.z;
+
+      radius[index] = glm::length( extent );
+   }
+
+   void culling_set::set( std::uint32_t index, glm::mat4 const& transform, glm::vec3 const& min, glm::vec3 const& max )
+   {
+      glm::vec3 const center = glm::vec3( transform * glm::vec4( ( min + max ) * 0.5f, 1.0f ) );
+      glm::vec3 const extent = ( max - min ) * 0.5f;
+
+      /* The extent of the moved box along each axis is the sum of the 
+         extents projected on it. */
+      glm::mat3 const abs_transform = glm::mat3( 
+         glm::abs( glm::vec3( transform[0] ) ), 
+         glm::abs( glm::vec3( transform[1] ) ), 
+         glm::abs( glm::vec3( transform[2] ) ) 
+      );
+
+      set( index, center - abs_transform * extent, center + abs_transform * extent );
+   }
+
+   void culling_set::set_radius( std::uint32_t index, float r )
+   {
+      radius[index] = r;
+   }
+
+   void culling_set::clear( ) noexcept
+   {
+      center_x.clear( );
+      center_y.clear( );
+      center_z.clear( );
+      extent_x.clear( );
+      extent_y.clear( );
+      extent_z.clear( );
+      radius.clear( );
+   }
+
+   void culling_set::cull( frustum const& f, std::vector<std::uint32_t>& visible ) const
+   {
+      frustum_planes planes;
+      for( std::uint32_t p = 0; p < 6; ++p )
+      {
+         planes.normal_x[p] = f.planes[p].x;
+         planes.normal_y[p] = f.planes[p].y;
+         planes.normal_z[p] = f.planes[p].z;
+         planes.distance[p] = f.planes[p].w;
+
+         planes.abs_x[p] = std::fabs( f.planes[p].x );
+         planes.abs_y[p] = std::fabs( f.planes[p].y );
+         planes.abs_z[p] = std::fabs( f.planes[p].z );
+      }
+
+      bounds_arrays const bounds
+      {
+         .p_center_x = center_x.data( ),
+         .p_center_y = center_y.data( ),
+         .p_center_z = center_z.data( ),
+         .p_extent_x = extent_x.data( ),
+         .p_extent_y = extent_y.data( ),
+         .p_extent_z = extent_z.data( ),
+         .p_radius = radius.data( )
+      };
+
+      auto const object_count = get_object_count( );
+
+      /* Jobs end on a multiple of the widest vector, so that only the 
+         last one has a scalar tail. Each job writes its visible objects 
+         at the start of its own range, which are then packed. */
+      std::uint32_t const job_size = ( objects_per_job + 7 ) & ~7u;
+      std::uint32_t const job_count = ( object_count + job_size - 1 ) / job_size;
+
+      visible.resize( object_count );
+      std::vector<std::uint32_t> counts( job_count );
+
+      auto const cull_job = [&] ( std::size_t job ) 
+      {
+         std::uint32_t first = static_cast<std::uint32_t>( job ) * job_size;
+         std::uint32_t const last = std::min( first + job_size, object_count );
+         std::uint32_t* p_visible = visible.data( ) + first;
+
+         std::uint32_t count = 0;
+#if defined( LUCIOLE_SIMD_AVX2 )
+         count += cull_range<simd::avx2_ops>( bounds, planes, first, last, p_visible + count );
+#endif
+#if defined( LUCIOLE_SIMD_SSE2 )
+         count += cull_range<simd::sse2_ops>( bounds, planes, first, last, p_visible + count );
+#endif
+         count += cull_range<simd::scalar_ops>( bounds, planes, first, last, p_visible + count );
+
+         counts[job] = count;
+      };
+
+      if ( p_thread_pool != nullptr && job_count > 1 )
+      {
+         p_thread_pool->parallel_for( 0, job_count, 1, cull_job );
+      }
+      else
+      {
+         for( std::uint32_t job = 0; job < job_count; ++job )
+         {
+            cull_job( job );
+         }
+      }
+
+      std::uint32_t visible_count = 0;
+      for( std::uint32_t job = 0; job < job_count; ++job )
+      {
+         auto const src = visible.begin( ) + job * job_size;
+         std::copy( src, src + counts[job], visible.begin( ) + visible_count );
+
+         visible_count += counts[job];
+      }
+
+      visible.resize( visible_count );
+   }
+
+   std::uint32_t culling_set::get_object_count( ) const noexcept
+   {
+      return static_cast<std::uint32_t>( center_x.size( ) );
+   }
+} // namespace gfx
@@ -0,0 +1,742 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/gpu_culling.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace gfx
+{
+   namespace
+   {
+      static constexpr std::uint32_t group_size = 64;
+
+      static constexpr VkDeviceSize command_stride = sizeof( VkDrawIndexedIndirectCommand );
+   } // namespace
+
+   gpu_culling::gpu_culling( create_info_t const& create_info )
+      :
+      p_context( create_info.value( ).p_context ),
+      is_occlusion_enabled( create_info.value( ).is_occlusion_culled ),
+      max_instance_count( std::max( create_info.value( ).max_instance_count, 1u ) )
+   {
+      try
+      {
+         // The vertex shader finds the data of an instance from the first
+         // instance of its draw, which an indirect draw may not set.
+         if ( p_context->get_device_features( ).drawIndirectFirstInstance != VK_TRUE )
+         {
+            throw std::runtime_error{ "GPU Culling Error: drawIndirectFirstInstance is not supported." };
+         }
+
+         instance_buffer = create_buffer( 
+            sizeof( gpu_instance ) * max_instance_count, 
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            vk::memory_category::e_other
+         );
+
+         uniform_buffer = create_buffer( 
+            sizeof( cull_data ), 
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VMA_MEMORY_USAGE_CPU_TO_GPU,
+            vk::memory_category::e_uniform_buffer
+         );
+
+         // Each phase writes its own commands and count.
+         command_buffer = create_buffer( 
+            command_stride * max_instance_count * ( is_occlusion_enabled ? 2 : 1 ), 
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            vk::memory_category::e_other
+         );
+
+         count_buffer = create_buffer( 
+            sizeof( std::uint32_t ) * 2, 
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            vk::memory_category::e_other
+         );
+
+         if ( is_occlusion_enabled )
+         {
+            visibility_buffer = create_buffer( 
+               sizeof( std::uint32_t ) * max_instance_count, 
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+               VMA_MEMORY_USAGE_CPU_TO_GPU,
+               vk::memory_category::e_other
+            );
+         }
+
+         auto const allocator = p_context->get_memory_allocator( );
+
+         void* p_data = nullptr;
+         if ( vmaMapMemory( allocator, instance_buffer.allocation, &p_data ) != VK_SUCCESS )
+         {
+            throw std::runtime_error{ "GPU Culling Error: failed to map the instance buffer." };
+         }
+
+         p_instances = static_cast<gpu_instance*>( p_data );
+
+         if ( vmaMapMemory( allocator, uniform_buffer.allocation, &p_data ) != VK_SUCCESS )
+         {
+            throw std::runtime_error{ "GPU Culling Error: failed to map the uniform buffer." };
+         }
+
+         p_cull_data = static_cast<cull_data*>( p_data );
+         *p_cull_data = cull_data{ };
+
+         // Nothing is visible before the first frame, which draws 
+         // everything in its late phase.
+         if ( is_occlusion_enabled )
+         {
+            if ( vmaMapMemory( allocator, visibility_buffer.allocation, &p_data ) != VK_SUCCESS )
+            {
+               throw std::runtime_error{ "GPU Culling Error: failed to map the visibility buffer." };
+            }
+
+            std::memset( p_data, 0, sizeof( std::uint32_t ) * max_instance_count );
+
+            vmaFlushAllocation( allocator, visibility_buffer.allocation, 0, VK_WHOLE_SIZE );
+            vmaUnmapMemory( allocator, visibility_buffer.allocation );
+         }
+
+         if ( create_info.value( ).is_draw_count_used && p_context->is_device_extension_enabled( "VK_KHR_draw_indirect_count" ) )
+         {
+            p_draw_indexed_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>( 
+               vkGetDeviceProcAddr( p_context->get( ), "vkCmdDrawIndexedIndirectCountKHR" )
+            );
+         }
+
+         is_multi_draw_supported = p_context->get_device_features( ).multiDrawIndirect == VK_TRUE;
+
+         create_descriptor_set( );
+         create_pipeline( create_info.value( ).spir_v );
+      }
+      catch( ... )
+      {
+         destroy( );
+         throw;
+      }
+   }
+
+   gpu_culling::gpu_culling( gpu_culling&& rhs )
+   {
+      *this = std::move( rhs );
+   }
+
+   gpu_culling::~gpu_culling( )
+   {
+      destroy( );
+   }
+
+   gpu_culling& gpu_culling::operator=( gpu_culling&& rhs )
+   {
+      if ( this != &rhs )
+      {
+         destroy( );
+
+         p_context = std::exchange( rhs.p_context, nullptr );
+
+         instance_buffer = std::exchange( rhs.instance_buffer, { } );
+         uniform_buffer = std::exchange( rhs.uniform_buffer, { } );
+         command_buffer = std::exchange( rhs.command_buffer, { } );
+         count_buffer = std::exchange( rhs.count_buffer, { } );
+         visibility_buffer = std::exchange( rhs.visibility_buffer, { } );
+
+         p_instances = std::exchange( rhs.p_instances, nullptr );
+         p_cull_data = std::exchange( rhs.p_cull_data, nullptr );
+
+         descriptor_set_layout = std::exchange( rhs.descriptor_set_layout, VK_NULL_HANDLE );
+         descriptor_pool = std::exchange( rhs.descriptor_pool, VK_NULL_HANDLE );
+         descriptor_set = std::exchange( rhs.descriptor_set, VK_NULL_HANDLE );
+         pipeline_layout = std::exchange( rhs.pipeline_layout, VK_NULL_HANDLE );
+         pipeline = std::exchange( rhs.pipeline, VK_NULL_HANDLE );
+
+         p_draw_indexed_indirect_count = std::exchange( rhs.p_draw_indexed_indirect_count, nullptr );
+         is_multi_draw_supported = rhs.is_multi_draw_supported;
+         is_occlusion_enabled = rhs.is_occlusion_enabled;
+
+         instance_count = std::exchange( rhs.instance_count, 0 );
+         max_instance_count = std::exchange( rhs.max_instance_count, 0 );
+
+         dirty_begin = std::exchange( rhs.dirty_begin, 0 );
+         dirty_end = std::exchange( rhs.dirty_end, 0 );
+      }
+
+      return *this;
+   }
+
+   std::uint32_t gpu_culling::add( glm::vec3 const& center, float radius, draw_range const& range )
+   {
+      if ( instance_count == max_instance_count )
+      {
+         throw std::runtime_error{ "GPU Culling Error: the instance buffer is full." };
+      }
+
+      std::uint32_t const index = instance_count++;
+
+      p_instances[index] = gpu_instance
+      {
+         .sphere = glm::vec4( center, radius ),
+         .index_count = range.index_count,
+         .first_index = range.first_index,
+         .vertex_offset = range.vertex_offset,
+         .padding = 0
+      };
+
+      dirty_begin = dirty_begin == dirty_end ? index : std::min( dirty_begin, index );
+      dirty_end = std::max( dirty_end, index + 1 );
+
+      return index;
+   }
+
+   void gpu_culling::set_bounds( std::uint32_t index, glm::vec3 const& center, float radius ) noexcept
+   {
+      p_instances[index].sphere = glm::vec4( center, radius );
+
+      dirty_begin = dirty_begin == dirty_end ? index : std::min( dirty_begin, index );
+      dirty_end = std::max( dirty_end, index + 1 );
+   }
+
+   void gpu_culling::set_range( std::uint32_t index, draw_range const& range ) noexcept
+   {
+      p_instances[index].index_count = range.index_count;
+      p_instances[index].first_index = range.first_index;
+      p_instances[index].vertex_offset = range.vertex_offset;
+
+      dirty_begin = dirty_begin == dirty_end ? index : std::min( dirty_begin, index );
+      dirty_end = std::max( dirty_end, index + 1 );
+   }
+
+   void gpu_culling::clear( ) noexcept
+   {
+      instance_count = 0;
+      dirty_begin = 0;
+      dirty_end = 0;
+   }
+
+   void gpu_culling::update( frustum const& view ) noexcept
+   {
+      auto const allocator = p_context->get_memory_allocator( );
+
+      p_cull_data->planes = view.planes;
+      p_cull_data->instance_count = instance_count;
+
+      // The memory may not be host coherent.
+      vmaFlushAllocation( allocator, uniform_buffer.allocation, 0, sizeof( cull_data ) );
+
+      if ( dirty_begin != dirty_end )
+      {
+         vmaFlushAllocation( 
+            allocator, instance_buffer.allocation, 
+            sizeof( gpu_instance ) * dirty_begin, 
+            sizeof( gpu_instance ) * ( dirty_end - dirty_begin ) 
+         );
+
+         dirty_begin = 0;
+         dirty_end = 0;
+      }
+   }
+
+   void gpu_culling::set_camera( glm::mat4 const& view, glm::mat4 const& projection ) noexcept
+   {
+      p_cull_data->view = view;
+      p_cull_data->projection = projection;
+   }
+
+   void gpu_culling::set_depth_pyramid( depth_pyramid const& pyramid ) noexcept
+   {
+      if ( !is_occlusion_enabled )
+      {
+         return;
+      }
+
+      p_cull_data->pyramid_level_count = pyramid.get_level_count( );
+      p_cull_data->pyramid_size = glm::vec2( pyramid.get_extent( ).width, pyramid.get_extent( ).height );
+
+      VkDescriptorImageInfo const image_info
+      {
+         .sampler = pyramid.get_sampler( ),
+         .imageView = pyramid.get_image_view( ),
+         .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+      };
+
+      VkWriteDescriptorSet const write
+      {
+         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+         .pNext = nullptr,
+         .dstSet = descriptor_set,
+         .dstBinding = 5,
+         .dstArrayElement = 0,
+         .descriptorCount = 1,
+         .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+         .pImageInfo = &image_info,
+         .pBufferInfo = nullptr,
+         .pTexelBufferView = nullptr
+      };
+
+      vkUpdateDescriptorSets( p_context->get( ), 1, &write, 0, nullptr );
+   }
+
+   void gpu_culling::record_cull( VkCommandBuffer cmd_buffer, cull_phase phase ) const noexcept
+   {
+      if ( instance_count == 0 || ( phase == cull_phase::e_late && !is_occlusion_enabled ) )
+      {
+         return;
+      }
+
+      auto const phase_index = static_cast<std::uint32_t>( phase );
+
+      vkCmdFillBuffer( cmd_buffer, count_buffer.handle, sizeof( std::uint32_t ) * phase_index, sizeof( std::uint32_t ), 0 );
+
+      // Also orders the late phase after the visibility reads of the 
+      // early one.
+      VkMemoryBarrier const clear_barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+         .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+      };
+
+      vkCmdPipelineBarrier( 
+         cmd_buffer, 
+         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+         0, 1, &clear_barrier, 0, nullptr, 0, nullptr 
+      );
+
+      vkCmdBindPipeline( cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline );
+      vkCmdBindDescriptorSets( cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr );
+
+      if ( is_occlusion_enabled )
+      {
+         phase_data const data
+         {
+            .phase = phase_index,
+            .command_offset = max_instance_count * phase_index
+         };
+
+         vkCmdPushConstants( cmd_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( phase_data ), &data );
+      }
+
+      vkCmdDispatch( cmd_buffer, ( instance_count + group_size - 1 ) / group_size, 1, 1 );
+
+      VkMemoryBarrier const command_barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+         .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+      };
+
+      vkCmdPipelineBarrier( 
+         cmd_buffer, 
+         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 
+         0, 1, &command_barrier, 0, nullptr, 0, nullptr 
+      );
+   }
+
+   void gpu_culling::record_draw( VkCommandBuffer cmd_buffer, cull_phase phase ) const noexcept
+   {
+      if ( instance_count == 0 || ( phase == cull_phase::e_late && !is_occlusion_enabled ) )
+      {
+         return;
+      }
+
+      VkDeviceSize const command_offset = get_command_offset( phase );
+
+      if ( p_draw_indexed_indirect_count != nullptr )
+      {
+         p_draw_indexed_indirect_count( 
+            cmd_buffer, 
+            command_buffer.handle, command_offset, 
+            count_buffer.handle, get_count_offset( phase ), 
+            instance_count, command_stride 
+         );
+      }
+      else if ( is_multi_draw_supported )
+      {
+         vkCmdDrawIndexedIndirect( cmd_buffer, command_buffer.handle, command_offset, instance_count, command_stride );
+      }
+      else
+      {
+         for( std::uint32_t i = 0; i < instance_count; ++i )
+         {
+            vkCmdDrawIndexedIndirect( cmd_buffer, command_buffer.handle, command_offset + command_stride * i, 1, command_stride );
+         }
+      }
+   }
+
+   std::uint32_t gpu_culling::get_instance_count( ) const noexcept
+   {
+      return instance_count;
+   }
+
+   VkBuffer gpu_culling::get_command_buffer( ) const noexcept
+   {
+      return command_buffer.handle;
+   }
+
+   VkDeviceSize gpu_culling::get_command_offset( cull_phase phase ) const noexcept
+   {
+      return command_stride * max_instance_count * static_cast<std::uint32_t>( phase );
+   }
+
+   VkBuffer gpu_culling::get_count_buffer( ) const noexcept
+   {
+      return count_buffer.handle;
+   }
+
+   VkDeviceSize gpu_culling::get_count_offset( cull_phase phase ) const noexcept
+   {
+      return sizeof( std::uint32_t ) * static_cast<std::uint32_t>( phase );
+   }
+
+   std::uint32_t gpu_culling::get_max_instance_count( ) const noexcept
+   {
+      return max_instance_count;
+   }
+
+   bool gpu_culling::is_compacted( ) const noexcept
+   {
+      return p_draw_indexed_indirect_count != nullptr;
+   }
+
+   bool gpu_culling::is_occlusion_culled( ) const noexcept
+   {
+      return is_occlusion_enabled;
+   }
+
+   vk::buffer_allocation gpu_culling::create_buffer( 
+      VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memory_usage, vk::memory_category category ) const
+   {
+      VkBufferCreateInfo const buffer_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .size = size,
+         .usage = usage,
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr
+      };
+
+      VmaAllocationCreateInfo allocation_info = { };
+      allocation_info.usage = memory_usage;
+
+      auto const res = p_context->create_buffer(
+         vk::buffer_create_info_t( buffer_create_info ),
+         vk::allocation_create_info_t( allocation_info ),
+         category
+      );
+
+      if ( auto const* p_val = std::get_if<vk::buffer_allocation>( &res ) )
+      {
+         return *p_val;
+      }
+
+      throw std::runtime_error{ "GPU Culling Buffer Creation Error: " + std::get<vk::error>( res ).to_string( ) + "." };
+   }
+
+   void gpu_culling::create_pipeline( std::vector<std::uint32_t> const& spir_v )
+   {
+      VkPushConstantRange const push_constant_range
+      {
+         .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+         .offset = 0,
+         .size = sizeof( phase_data )
+      };
+
+      VkPipelineLayoutCreateInfo const layout_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .setLayoutCount = 1,
+         .pSetLayouts = &descriptor_set_layout,
+         .pushConstantRangeCount = is_occlusion_enabled ? 1u : 0u,
+         .pPushConstantRanges = is_occlusion_enabled ? &push_constant_range : nullptr
+      };
+
+      auto const res_layout = p_context->create_pipeline_layout( vk::pipeline_layout_create_info_t( layout_create_info ) );
+      if ( auto const* p_val = std::get_if<VkPipelineLayout>( &res_layout ) )
+      {
+         pipeline_layout = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "GPU Culling Pipeline Layout Creation Error: " + std::get<vk::error>( res_layout ).to_string( ) + "." };
+      }
+
+      VkShaderModuleCreateInfo const module_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .codeSize = spir_v.size( ) * sizeof( std::uint32_t ),
+         .pCode = spir_v.data( )
+      };
+
+      auto const shader_module = p_context->create_shader_module( vk::shader_module_create_info_t( module_create_info ) );
+      if ( shader_module == VK_NULL_HANDLE )
+      {
+         throw std::runtime_error{ "GPU Culling Error: failed to create the shader module." };
+      }
+
+      VkBool32 const compacted = is_compacted( ) ? VK_TRUE : VK_FALSE;
+
+      VkSpecializationMapEntry const specialization_entry
+      {
+         .constantID = 0,
+         .offset = 0,
+         .size = sizeof( VkBool32 )
+      };
+
+      VkSpecializationInfo const specialization_info
+      {
+         .mapEntryCount = 1,
+         .pMapEntries = &specialization_entry,
+         .dataSize = sizeof( VkBool32 ),
+         .pData = &compacted
+      };
+
+      VkComputePipelineCreateInfo const pipeline_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .stage = VkPipelineShaderStageCreateInfo
+         {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shader_module,
+            .pName = "main",
+            .pSpecializationInfo = &specialization_info
+         },
+         .layout = pipeline_layout,
+         .basePipelineHandle = VK_NULL_HANDLE,
+         .basePipelineIndex = -1
+      };
+
+      auto const res_pipeline = p_context->create_pipeline( vk::compute_pipeline_create_info_t( pipeline_create_info ) );
+
+      p_context->destroy_shader_module( vk::shader_module_t( shader_module ) );
+
+      if ( auto const* p_val = std::get_if<VkPipeline>( &res_pipeline ) )
+      {
+         pipeline = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "GPU Culling Pipeline Creation Error: " + std::get<vk::error>( res_pipeline ).to_string( ) + "." };
+      }
+   }
+
+   void gpu_culling::create_descriptor_set( )
+   {
+      // Occlusion culling adds the visibility buffer and the depth 
+      // pyramid.
+      std::uint32_t const binding_count = is_occlusion_enabled ? 6 : 4;
+
+      std::array<VkDescriptorSetLayoutBinding, 6> bindings = { };
+      for( std::uint32_t i = 0; i < bindings.size( ); ++i )
+      {
+         VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+         if ( i == 0 )
+         {
+            type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+         }
+         else if ( i == 5 )
+         {
+            type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+         }
+
+         bindings[i] = VkDescriptorSetLayoutBinding
+         {
+            .binding = i,
+            .descriptorType = type,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr
+         };
+      }
+
+      VkDescriptorSetLayoutCreateInfo const layout_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .bindingCount = binding_count,
+         .pBindings = bindings.data( )
+      };
+
+      auto const res_layout = p_context->create_descriptor_set_layout( vk::descriptor_set_layout_create_info_t( layout_create_info ) );
+      if ( auto const* p_val = std::get_if<VkDescriptorSetLayout>( &res_layout ) )
+      {
+         descriptor_set_layout = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "GPU Culling Descriptor Set Layout Creation Error: " + std::get<vk::error>( res_layout ).to_string( ) + "." };
+      }
+
+      std::array<VkDescriptorPoolSize, 3> const pool_sizes = 
+      {
+         VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1 },
+         VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = is_occlusion_enabled ? 4u : 3u },
+         VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1 }
+      };
+
+      VkDescriptorPoolCreateInfo const pool_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .maxSets = 1,
+         .poolSizeCount = is_occlusion_enabled ? 3u : 2u,
+         .pPoolSizes = pool_sizes.data( )
+      };
+
+      auto const res_pool = p_context->create_descriptor_pool( vk::descriptor_pool_create_info_t( pool_create_info ) );
+      if ( auto const* p_val = std::get_if<VkDescriptorPool>( &res_pool ) )
+      {
+         descriptor_pool = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "GPU Culling Descriptor Pool Creation Error: " + std::get<vk::error>( res_pool ).to_string( ) + "." };
+      }
+
+      VkDescriptorSetAllocateInfo const set_allocate_info
+      {
+         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+         .pNext = nullptr,
+         .descriptorPool = descriptor_pool,
+         .descriptorSetCount = 1,
+         .pSetLayouts = &descriptor_set_layout
+      };
+
+      vk::error const err( vk::result_t( 
+         vkAllocateDescriptorSets( p_context->get( ), &set_allocate_info, &descriptor_set ) 
+      ) );
+
+      if ( err.is_error( ) )
+      {
+         throw std::runtime_error{ "GPU Culling Descriptor Set Allocation Error: " + err.to_string( ) + "." };
+      }
+
+      std::array<VkDescriptorBufferInfo, 5> const buffer_infos = 
+      {
+         VkDescriptorBufferInfo{ .buffer = uniform_buffer.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+         VkDescriptorBufferInfo{ .buffer = instance_buffer.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+         VkDescriptorBufferInfo{ .buffer = command_buffer.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+         VkDescriptorBufferInfo{ .buffer = count_buffer.handle, .offset = 0, .range = VK_WHOLE_SIZE },
+         VkDescriptorBufferInfo{ .buffer = visibility_buffer.handle, .offset = 0, .range = VK_WHOLE_SIZE }
+      };
+
+      // The depth pyramid is written once it exists.
+      std::uint32_t const write_count = is_occlusion_enabled ? 5 : 4;
+
+      std::array<VkWriteDescriptorSet, 5> writes = { };
+      for( std::uint32_t i = 0; i < write_count; ++i )
+      {
+         writes[i] = VkWriteDescriptorSet
+         {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = descriptor_set,
+            .dstBinding = i,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = bindings[i].descriptorType,
+            .pImageInfo = nullptr,
+            .pBufferInfo = &buffer_infos[i],
+            .pTexelBufferView = nullptr
+         };
+      }
+
+      vkUpdateDescriptorSets( p_context->get( ), write_count, writes.data( ), 0, nullptr );
+   }
+
+   void gpu_culling::destroy( ) noexcept
+   {
+      if ( p_context == nullptr )
+      {
+         return;
+      }
+
+      if ( pipeline != VK_NULL_HANDLE )
+      {
+         p_context->destroy_pipeline( vk::pipeline_t( pipeline ) );
+         pipeline = VK_NULL_HANDLE;
+      }
+
+      if ( pipeline_layout != VK_NULL_HANDLE )
+      {
+         p_context->destroy_pipeline_layout( vk::pipeline_layout_t( pipeline_layout ) );
+         pipeline_layout = VK_NULL_HANDLE;
+      }
+
+      // The set goes away with its pool.
+      if ( descriptor_pool != VK_NULL_HANDLE )
+      {
+         descriptor_pool = p_context->destroy_descriptor_pool( vk::descriptor_pool_t( descriptor_pool ) );
+         descriptor_set = VK_NULL_HANDLE;
+      }
+
+      if ( descriptor_set_layout != VK_NULL_HANDLE )
+      {
+         descriptor_set_layout = p_context->destroy_descriptor_set_layout( vk::descriptor_set_layout_t( descriptor_set_layout ) );
+      }
+
+      auto const allocator = p_context->get_memory_allocator( );
+      
+      if ( p_instances != nullptr )
+      {
+         vmaUnmapMemory( allocator, instance_buffer.allocation );
+         p_instances = nullptr;
+      }
+
+      if ( p_cull_data != nullptr )
+      {
+         vmaUnmapMemory( allocator, uniform_buffer.allocation );
+         p_cull_data = nullptr;
+      }
+
+      p_context->destroy_buffer( visibility_buffer );
+      p_context->destroy_buffer( count_buffer );
+      p_context->destroy_buffer( command_buffer );
+      p_context->destroy_buffer( uniform_buffer );
+      p_context->destroy_buffer( instance_buffer );
+
+      visibility_buffer = { };
+      count_buffer = { };
+      command_buffer = { };
+      uniform_buffer = { };
+      instance_buffer = { };
+
+      p_context = nullptr;
+   }
+} // namespace gfx
@@ -0,0 +1,186 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/instance_buffer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace gfx
+{
+   namespace
+   {
+      /**
+       * @brief The largest minStorageBufferOffsetAlignment allowed by the 
+       * specification, so that every region can be bound on any device.
+       */
+      static constexpr VkDeviceSize region_alignment = 256;
+   } // namespace
+
+   instance_buffer::instance_buffer( create_info_t const& create_info )
+      :
+      p_context( create_info.value( ).p_context ),
+      frame_count( std::max( create_info.value( ).frame_count, 1u ) ),
+      max_instance_count( std::max( create_info.value( ).max_instance_count, 1u ) )
+   {
+      range = sizeof( glm::mat4 ) * VkDeviceSize( max_instance_count );
+      range = ( range + region_alignment - 1 ) / region_alignment * region_alignment;
+
+      VkBufferCreateInfo const buffer_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .size = range * frame_count,
+         .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr
+      };
+
+      VmaAllocationCreateInfo allocation_info = { };
+      allocation_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+
+      auto const res = p_context->create_buffer(
+         vk::buffer_create_info_t( buffer_create_info ),
+         vk::allocation_create_info_t( allocation_info ),
+         vk::memory_category::e_other
+      );
+
+      if ( auto const* p_val = std::get_if<vk::buffer_allocation>( &res ) )
+      {
+         buffer = *p_val;
+      }
+      else
+      {
+         throw std::runtime_error{ "Instance Buffer Creation Error: " + std::get<vk::error>( res ).to_string( ) + "." };
+      }
+
+      void* p_data = nullptr;
+      if ( vmaMapMemory( p_context->get_memory_allocator( ), buffer.allocation, &p_data ) != VK_SUCCESS )
+      {
+         destroy( );
+         throw std::runtime_error{ "Instance Buffer Error: failed to map the buffer." };
+      }
+
+      p_transforms = static_cast<glm::mat4*>( p_data );
+   }
+
+   instance_buffer::instance_buffer( instance_buffer&& rhs )
+   {
+      *this = std::move( rhs );
+   }
+
+   instance_buffer::~instance_buffer( )
+   {
+      destroy( );
+   }
+
+   instance_buffer& instance_buffer::operator=( instance_buffer&& rhs )
+   {
+      if ( this != &rhs )
+      {
+         destroy( );
+
+         p_context = std::exchange( rhs.p_context, nullptr );
+
+         buffer = std::exchange( rhs.buffer, { } );
+         p_transforms = std::exchange( rhs.p_transforms, nullptr );
+
+         frame_count = std::exchange( rhs.frame_count, 0 );
+         max_instance_count = std::exchange( rhs.max_instance_count, 0 );
+         range = std::exchange( rhs.range, 0 );
+      }
+
+      return *this;
+   }
+
+   void instance_buffer::write( std::uint32_t frame, draw_list const& list )
+   {
+      if ( frame >= frame_count )
+      {
+         throw std::runtime_error{ "Instance Buffer Error: frame " + std::to_string( frame ) + " is out of range." };
+      }
+
+      // The instance data of the list only grows, its size is not the 
+      // instance count of the last build.
+      std::uint32_t const instance_count = list.get_stats( ).item_count;
+      if ( instance_count > max_instance_count )
+      {
+         throw std::runtime_error{ "Instance Buffer Error: " + std::to_string( instance_count ) + " instances do not fit in the buffer." };
+      }
+
+      if ( instance_count == 0 )
+      {
+         return;
+      }
+
+      VkDeviceSize const offset = get_offset( frame );
+
+      std::memcpy( 
+         reinterpret_cast<std::byte*>( p_transforms ) + offset, 
+         list.get_instance_data( ).data( ), 
+         sizeof( glm::mat4 ) * instance_count 
+      );
+
+      vmaFlushAllocation( p_context->get_memory_allocator( ), buffer.allocation, offset, sizeof( glm::mat4 ) * instance_count );
+   }
+
+   VkBuffer instance_buffer::get_buffer( ) const noexcept
+   {
+      return buffer.handle;
+   }
+
+   VkDeviceSize instance_buffer::get_offset( std::uint32_t frame ) const noexcept
+   {
+      return range * frame;
+   }
+
+   VkDeviceSize instance_buffer::get_range( ) const noexcept
+   {
+      return range;
+   }
+
+   std::uint32_t instance_buffer::get_max_instance_count( ) const noexcept
+   {
+      return max_instance_count;
+   }
+
+   void instance_buffer::destroy( ) noexcept
+   {
+      if ( p_context == nullptr )
+      {
+         return;
+      }
+
+      if ( p_transforms != nullptr )
+      {
+         vmaUnmapMemory( p_context->get_memory_allocator( ), buffer.allocation );
+         p_transforms = nullptr;
+      }
+
+      p_context->destroy_buffer( buffer );
+      buffer = { };
+
+      p_context = nullptr;
+   }
+} // namespace gfx
@@ -0,0 +1,133 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/lod_selection.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace gfx
+{
+   namespace
+   {
+      /**
+       * @brief The distance under which objects are considered as close
+       * as the camera gets, so that their error does not blow up.
+       */
+      constexpr float min_distance = 1e-3f;
+   } // namespace
+
+   lod_view make_lod_view( glm::mat4 const& view, glm::mat4 const& projection, float viewport_height ) noexcept
+   {
+      // proj[1][1] is the cotangent of half the vertical field of view,
+      // which may be negated to flip the y axis.
+      return lod_view
+      {
+         .position = glm::vec3( glm::inverse( view )[3] ),
+         .scale = std::abs( projection[1][1] ) * viewport_height * 0.5f
+      };
+   }
+
+   lod_selector::lod_selector( create_info_t const& create_info )
+      :
+      threshold( create_info.value( ).threshold ),
+      hysteresis( create_info.value( ).hysteresis )
+   { }
+
+   std::uint32_t lod_selector::add( glm::vec3 const& center, float radius, std::vector<float> const& object_errors )
+   {
+      auto const index = static_cast<std::uint32_t>( spheres.size( ) );
+
+      spheres.emplace_back( center, radius );
+      scales.push_back( 1.0f );
+      first_errors.push_back( static_cast<std::uint32_t>( errors.size( ) ) );
+      error_counts.push_back( static_cast<std::uint32_t>( object_errors.size( ) ) );
+      levels.push_back( 0 );
+
+      errors.insert( errors.end( ), object_errors.begin( ), object_errors.end( ) );
+
+      return index;
+   }
+
+   void lod_selector::set_bounds( std::uint32_t index, glm::vec3 const& center, float radius, float scale ) noexcept
+   {
+      spheres[index] = glm::vec4( center, radius );
+      scales[index] = scale;
+   }
+
+   void lod_selector::clear( ) noexcept
+   {
+      spheres.clear( );
+      scales.clear( );
+      first_errors.clear( );
+      error_counts.clear( );
+      levels.clear( );
+      errors.clear( );
+   }
+
+   bool lod_selector::select( lod_view const& view, std::vector<std::uint32_t> const& objects ) noexcept
+   {
+      float const coarsen_threshold = threshold * ( 1.0f - hysteresis );
+
+      bool is_changed = false;
+      for( std::uint32_t index : objects )
+      {
+         std::uint32_t const count = error_counts[index];
+         if ( count == 0 )
+         {
+            continue;
+         }
+
+         auto const& sphere = spheres[index];
+         float const distance = std::max( glm::length( glm::vec3( sphere ) - view.position ) - sphere.w, min_distance );
+
+         // Pixels per object space unit of error at the distance of the object.
+         float const pixels = scales[index] * view.scale / distance;
+         float const* p_errors = errors.data( ) + first_errors[index];
+
+         std::uint32_t level = levels[index];
+         while( level > 0 && p_errors[level - 1] * pixels > threshold )
+         {
+            --level;
+         }
+
+         if ( level == levels[index] )
+         {
+            while( level < count && p_errors[level] * pixels <= coarsen_threshold )
+            {
+               ++level;
+            }
+         }
+
+         is_changed |= level != levels[index];
+         levels[index] = level;
+      }
+
+      return is_changed;
+   }
+
+   std::uint32_t lod_selector::get_level( std::uint32_t index ) const noexcept
+   {
+      return levels[index];
+   }
+
+   std::uint32_t lod_selector::get_object_count( ) const noexcept
+   {
+      return static_cast<std::uint32_t>( spheres.size( ) );
+   }
+} // namespace gfx
@@ -0,0 +1,474 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/mesh_optimizer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace gfx
+{
+   namespace
+   {
+      constexpr std::size_t forsyth_cache_size = 32;
+      constexpr std::size_t forsyth_max_valence = 32;
+
+      /**
+       * @brief Precomputed vertex scores of the Forsyth algorithm, by
+       * position in the simulated LRU cache and by number of remaining
+       * triangles.
+       */
+      struct forsyth_tables
+      {
+         std::array<float, forsyth_cache_size + 1> cache = { };
+         std::array<float, forsyth_max_valence + 1> valence = { };
+
+         forsyth_tables( )
+         {
+            for( std::size_t i = 0; i < forsyth_cache_size; ++i )
+            {
+               if ( i < 3 )
+               {
+                  cache[i] = 0.75f;
+               }
+               else
+               {
+                  float const scale = 1.0f - static_cast<float>( i - 3 ) / static_cast<float>( forsyth_cache_size - 3 );
+                  cache[i] = std::pow( scale, 1.5f );
+               }
+            }
+            cache[forsyth_cache_size] = 0.0f;
+
+            valence[0] = 0.0f;
+            for( std::size_t i = 1; i <= forsyth_max_valence; ++i )
+            {
+               valence[i] = 2.0f / std::sqrt( static_cast<float>( i ) );
+            }
+         }
+      }; // struct forsyth_tables
+
+      forsyth_tables const tables;
+
+      float vertex_score( std::uint32_t cache_position, std::uint32_t remaining ) noexcept
+      {
+         if ( remaining == 0 )
+         {
+            return -1.0f;
+         }
+
+         return tables.cache[std::min<std::size_t>( cache_position, forsyth_cache_size )] + 
+            tables.valence[std::min<std::size_t>( remaining, forsyth_max_valence )];
+      }
+
+      struct triangle_adjacency
+      {
+         std::vector<std::uint32_t> counts;
+         std::vector<std::uint32_t> offsets;
+         std::vector<std::uint32_t> triangles;
+      }; // struct triangle_adjacency
+
+      triangle_adjacency build_adjacency( std::vector<std::uint32_t> const& indices, std::uint32_t vertex_count )
+      {
+         triangle_adjacency adjacency;
+         adjacency.counts.assign( vertex_count, 0 );
+         adjacency.offsets.assign( vertex_count, 0 );
+         adjacency.triangles.resize( indices.size( ) );
+
+         for( auto index : indices )
+         {
+            ++adjacency.counts[index];
+         }
+
+         std::uint32_t offset = 0;
+         for( std::uint32_t i = 0; i < vertex_count; ++i )
+         {
+            adjacency.offsets[i] = offset;
+            offset += adjacency.counts[i];
+         }
+
+         std::vector<std::uint32_t> fill = adjacency.offsets;
+         for( std::size_t i = 0; i < indices.size( ); ++i )
+         {
+            adjacency.triangles[fill[indices[i]]++] = static_cast<std::uint32_t>( i / 3 );
+         }
+
+         return adjacency;
+      }
+
+      std::uint32_t count_vertices( std::vector<std::uint32_t> const& indices ) noexcept
+      {
+         std::uint32_t count = 0;
+         for( auto index : indices )
+         {
+            count = std::max( count, index + 1 );
+         }
+
+         return count;
+      }
+   } // namespace
+
+   vertex_cache_stats analyze_vertex_cache(
+      std::vector<std::uint32_t> const& indices,
+      std::uint32_t vertex_count,
+      std::uint32_t cache_size )
+   {
+      if ( indices.size( ) < 3 )
+      {
+         return { };
+      }
+
+      /* A FIFO cache, a vertex is in the cache if it was transformed less than cache_size misses ago. */
+      std::vector<std::uint32_t> timestamps( vertex_count, 0 );
+      std::vector<bool> used( vertex_count, false );
+
+      std::uint32_t time = cache_size + 1;
+      std::uint32_t misses = 0;
+      std::uint32_t unique = 0;
+
+      for( auto index : indices )
+      {
+         if ( !used[index] )
+         {
+            used[index] = true;
+            ++unique;
+         }
+
+         if ( time - timestamps[index] > cache_size )
+         {
+            timestamps[index] = time++;
+            ++misses;
+         }
+      }
+
+      return vertex_cache_stats
+      {
+         .acmr = static_cast<float>( misses ) / static_cast<float>( indices.size( ) / 3 ),
+         .atvr = unique == 0 ? 0.0f : static_cast<float>( misses ) / static_cast<float>( unique )
+      };
+   }
+
+   std::vector<std::uint32_t> optimize_vertex_cache(
+      std::vector<std::uint32_t> const& indices,
+      std::uint32_t vertex_count )
+   {
+      std::size_t const triangle_count = indices.size( ) / 3;
+      if ( triangle_count == 0 )
+      {
+         return indices;
+      }
+
+      auto adjacency = build_adjacency( indices, vertex_count );
+
+      /* LIVE TRIANGLE COUNTS AND SCORES */
+      std::vector<std::uint32_t> remaining = adjacency.counts;
+      std::vector<std::uint32_t> cache_positions( vertex_count, forsyth_cache_size );
+      std::vector<float> vertex_scores( vertex_count );
+      for( std::uint32_t i = 0; i < vertex_count; ++i )
+      {
+         vertex_scores[i] = vertex_score( forsyth_cache_size, remaining[i] );
+      }
+
+      std::vector<float> triangle_scores( triangle_count );
+      std::vector<bool> emitted( triangle_count, false );
+      for( std::size_t i = 0; i < triangle_count; ++i )
+      {
+         triangle_scores[i] = 
+            vertex_scores[indices[i * 3 + 0]] + 
+            vertex_scores[indices[i * 3 + 1]] + 
+            vertex_scores[indices[i * 3 + 2]];
+      }
+
+      std::vector<std::uint32_t> res;
+      res.reserve( indices.size( ) );
+
+      /* The cache holds 3 extra entries for the vertices pushed by the emitted triangle. */
+      std::array<std::uint32_t, forsyth_cache_size + 3> cache;
+      std::size_t cache_count = 0;
+
+      std::size_t input_cursor = 0;
+      std::uint32_t best_triangle = 0;
+      float best_score = triangle_scores[0];
+      for( std::size_t i = 1; i < triangle_count; ++i )
+      {
+         if ( triangle_scores[i] > best_score )
+         {
+            best_score = triangle_scores[i];
+            best_triangle = static_cast<std::uint32_t>( i );
+         }
+      }
+
+      for( std::size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count )
+      {
+         /* EMIT */
+         emitted[best_triangle] = true;
+
+         std::array<std::uint32_t, 3> const triangle = 
+         {
+            indices[best_triangle * 3 + 0],
+            indices[best_triangle * 3 + 1],
+            indices[best_triangle * 3 + 2]
+         };
+
+         for( auto vertex : triangle )
+         {
+            res.push_back( vertex );
+
+            /* Remove the triangle from the adjacency of its vertices. */
+            auto* p_begin = adjacency.triangles.data( ) + adjacency.offsets[vertex];
+            auto* p_end = p_begin + remaining[vertex];
+            auto* p_found = std::find( p_begin, p_end, best_triangle );
+            std::swap( *p_found, *( p_end - 1 ) );
+            --remaining[vertex];
+         }
+
+         /* UPDATE THE CACHE */
+         std::array<std::uint32_t, forsyth_cache_size + 3> new_cache;
+         std::size_t new_count = 0;
+
+         for( auto vertex : triangle )
+         {
+            new_cache[new_count++] = vertex;
+         }
+
+         for( std::size_t i = 0; i < cache_count; ++i )
+         {
+            auto const vertex = cache[i];
+            if ( vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2] )
+            {
+               new_cache[new_count++] = vertex;
+            }
+         }
+
+         for( std::size_t i = forsyth_cache_size; i < new_count; ++i )
+         {
+            cache_positions[new_cache[i]] = forsyth_cache_size;
+         }
+
+         cache_count = std::min( new_count, forsyth_cache_size );
+         cache = new_cache;
+
+         /* RESCORE THE VERTICES IN THE CACHE AND THEIR TRIANGLES */
+         best_score = -1.0f;
+         for( std::size_t i = 0; i < new_count; ++i )
+         {
+            auto const vertex = new_cache[i];
+            if ( i < forsyth_cache_size )
+            {
+               cache_positions[vertex] = static_cast<std::uint32_t>( i );
+            }
+
+            float const score = vertex_score( cache_positions[vertex], remaining[vertex] );
+            float const delta = score - vertex_scores[vertex];
+            vertex_scores[vertex] = score;
+
+            auto const* p_begin = adjacency.triangles.data( ) + adjacency.offsets[vertex];
+            for( auto const* p_it = p_begin; p_it != p_begin + remaining[vertex]; ++p_it )
+            {
+               triangle_scores[*p_it] += delta;
+            }
+         }
+
+         for( std::size_t i = 0; i < cache_count; ++i )
+         {
+            auto const vertex = cache[i];
+
+            auto const* p_begin = adjacency.triangles.data( ) + adjacency.offsets[vertex];
+            for( auto const* p_it = p_begin; p_it != p_begin + remaining[vertex]; ++p_it )
+            {
+               if ( triangle_scores[*p_it] > best_score )
+               {
+                  best_score = triangle_scores[*p_it];
+                  best_triangle = *p_it;
+               }
+            }
+         }
+
+         /* Dead end, continue with the next triangle in input order. */
+         if ( best_score < 0.0f )
+         {
+            while( input_cursor < triangle_count && emitted[input_cursor] )
+            {
+               ++input_cursor;
+            }
+
+            if ( input_cursor < triangle_count )
+            {
+               best_triangle = static_cast<std::uint32_t>( input_cursor );
+            }
+         }
+      }
+
+      return res;
+   }
+
+   std::vector<std::uint32_t> optimize_overdraw(
+      std::vector<std::uint32_t> const& indices,
+      std::vector<glm::vec3> const& positions,
+      float threshold )
+   {
+      std::size_t const triangle_count = indices.size( ) / 3;
+      if ( triangle_count == 0 )
+      {
+         return indices;
+      }
+
+      auto const vertex_count = static_cast<std::uint32_t>( positions.size( ) );
+      float const mesh_acmr = analyze_vertex_cache( indices, vertex_count ).acmr;
+
+      /* CLUSTERS: split where a triangle misses the cache on all three vertices, as long as the cluster is efficient enough. */
+      constexpr std::uint32_t cache_size = 16;
+      std::vector<std::uint32_t> timestamps( vertex_count, 0 );
+      std::uint32_t time = cache_size + 1;
+
+      std::vector<std::size_t> cluster_starts = { 0 };
+      std::uint32_t cluster_misses = 0;
+
+      for( std::size_t i = 0; i < triangle_count; ++i )
+      {
+         std::uint32_t misses = 0;
+         for( std::size_t j = 0; j < 3; ++j )
+         {
+            auto const index = indices[i * 3 + j];
+            if ( time - timestamps[index] > cache_size )
+            {
+               timestamps[index] = time++;
+               ++misses;
+            }
+         }
+
+         std::size_t const cluster_size = i - cluster_starts.back( );
+         if ( misses == 3 && cluster_size > 0 && 
+              static_cast<float>( cluster_misses ) / static_cast<float>( cluster_size ) <= mesh_acmr * threshold )
+         {
+            cluster_starts.push_back( i );
+            cluster_misses = 0;
+         }
+
+         cluster_misses += misses;
+      }
+
+      cluster_starts.push_back( triangle_count );
+
+      /* SORT KEYS */
+      glm::vec3 mesh_centroid( 0.0f );
+      for( auto const& position : positions )
+      {
+         mesh_centroid += position;
+      }
+      mesh_centroid /= static_cast<float>( std::max<std::size_t>( positions.size( ), 1 ) );
+
+      std::size_t const cluster_count = cluster_starts.size( ) - 1;
+      std::vector<float> sort_keys( cluster_count );
+
+      for( std::size_t c = 0; c < cluster_count; ++c )
+      {
+         glm::vec3 centroid( 0.0f );
+         glm::vec3 normal( 0.0f );
+         float area = 0.0f;
+
+         for( std::size_t i = cluster_starts[c]; i < cluster_starts[c + 1]; ++i )
+         {
+            auto const& p0 = positions[indices[i * 3 + 0]];
+            auto const& p1 = positions[indices[i * 3 + 1]];
+            auto const& p2 = positions[indices[i * 3 + 2]];
+
+            glm::vec3 const n = glm::cross( p1 - p0, p2 - p0 );
+            float const a = glm::length( n );
+
+            centroid += ( p0 + p1 + p2 ) * ( a / 3.0f );
+            normal += n;
+            area += a;
+         }
+
+         if ( area > 0.0f )
+         {
+            centroid /= area;
+         }
+
+         float const length = glm::length( normal );
+         sort_keys[c] = length > 0.0f ? glm::dot( centroid - mesh_centroid, normal / length ) : 0.0f;
+      }
+
+      std::vector<std::size_t> order( cluster_count );
+      std::iota( order.begin( ), order.end( ), 0 );
+      std::stable_sort( order.begin( ), order.end( ), [&] ( std::size_t lhs, std::size_t rhs ) 
+      {
+         return sort_keys[lhs] > sort_keys[rhs];
+      } );
+
+      std::vector<std::uint32_t> res;
+      res.reserve( indices.size( ) );
+
+      for( auto c : order )
+      {
+         res.insert( 
+            res.end( ), 
+            indices.begin( ) + cluster_starts[c] * 3, 
+            indices.begin( ) + cluster_starts[c + 1] * 3 
+         );
+      }
+
+      return res;
+   }
+
+   std::vector<std::uint32_t> optimize_vertex_fetch(
+      std::vector<std::uint32_t>& indices,
+      std::uint32_t vertex_count )
+   {
+      std::vector<std::uint32_t> remap( vertex_count, unused_vertex );
+      std::uint32_t next = 0;
+
+      for( auto& index : indices )
+      {
+         if ( remap[index] == unused_vertex )
+         {
+            remap[index] = next++;
+         }
+
+         index = remap[index];
+      }
+
+      return remap;
+   }
+
+   mesh_optimization_result optimize_mesh(
+      std::vector<std::uint32_t>& indices,
+      std::vector<glm::vec3> const& positions )
+   {
+      auto const vertex_count = std::max( static_cast<std::uint32_t>( positions.size( ) ), count_vertices( indices ) );
+
+      mesh_optimization_result res;
+      res.report.before = analyze_vertex_cache( indices, vertex_count );
+
+      indices = optimize_vertex_cache( indices, vertex_count );
+      if ( positions.size( ) >= vertex_count )
+      {
+         indices = optimize_overdraw( indices, positions );
+      }
+
+      res.remap = optimize_vertex_fetch( indices, vertex_count );
+      res.vertex_count = count_vertices( indices );
+
+      res.report.after = analyze_vertex_cache( indices, res.vertex_count );
+      res.report.uses_16_bit_indices = fits_16_bit_indices( res.vertex_count );
+
+      return res;
+   }
+} // namespace gfx
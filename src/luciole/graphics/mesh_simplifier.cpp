@@ -0,0 +1,513 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/mesh_simplifier.hpp>
+#include <luciole/graphics/mesh_optimizer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace gfx
+{
+   namespace
+   {
+      /**
+       * @brief The sum of the squared distances to a set of planes, as
+       * the symmetric matrix A, the vector b and the scalar c of
+       * v'Av + 2b'v + c.
+       */
+      struct quadric
+      {
+         double a00 = 0.0, a01 = 0.0, a02 = 0.0;
+         double a11 = 0.0, a12 = 0.0;
+         double a22 = 0.0;
+         double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+         double c = 0.0;
+
+         quadric& operator+=( quadric const& rhs ) noexcept
+         {
+            a00 += rhs.a00; a01 += rhs.a01; a02 += rhs.a02;
+            a11 += rhs.a11; a12 += rhs.a12;
+            a22 += rhs.a22;
+            b0 += rhs.b0; b1 += rhs.b1; b2 += rhs.b2;
+            c += rhs.c;
+
+            return *this;
+         }
+      }; // struct quadric
+
+      quadric make_plane_quadric( glm::dvec3 const& n, double d ) noexcept
+      {
+         quadric q;
+         q.a00 = n.x * n.x; q.a01 = n.x * n.y; q.a02 = n.x * n.z;
+         q.a11 = n.y * n.y; q.a12 = n.y * n.z;
+         q.a22 = n.z * n.z;
+         q.b0 = n.x * d; q.b1 = n.y * d; q.b2 = n.z * d;
+         q.c = d * d;
+
+         return q;
+      }
+
+      double evaluate( quadric const& q, glm::vec3 const& p ) noexcept
+      {
+         double const x = p.x;
+         double const y = p.y;
+         double const z = p.z;
+
+         double const error =
+            q.a00 * x * x + 2.0 * q.a01 * x * y + 2.0 * q.a02 * x * z +
+            q.a11 * y * y + 2.0 * q.a12 * y * z +
+            q.a22 * z * z +
+            2.0 * ( q.b0 * x + q.b1 * y + q.b2 * z ) + q.c;
+
+         return std::max( error, 0.0 );
+      }
+
+      quadric sum( quadric lhs, quadric const& rhs ) noexcept
+      {
+         return lhs += rhs;
+      }
+
+      /**
+       * @brief A collapse of a vertex onto a neighbour, waiting in the
+       * queue. It is stale once the version of its vertex moved on.
+       */
+      struct collapse
+      {
+         double cost = 0.0;
+         std::uint32_t from = 0;
+         std::uint32_t to = 0;
+         std::uint32_t version = 0;
+
+         bool operator>( collapse const& rhs ) const noexcept
+         {
+            return cost > rhs.cost;
+         }
+      }; // struct collapse
+
+      /**
+       * @brief The state of an edge collapse simplification. Triangles
+       * keep their slot and are flagged when removed, each vertex keeps
+       * the list of its live triangles.
+       */
+      class simplifier
+      {
+      public:
+         simplifier( std::vector<std::uint32_t> const& indices, std::vector<glm::vec3> const& positions )
+            :
+            positions( positions ),
+            triangles( indices.begin( ), indices.begin( ) + indices.size( ) / 3 * 3 ),
+            is_removed( triangles.size( ) / 3, false ),
+            vertex_triangles( positions.size( ) ),
+            quadrics( positions.size( ) ),
+            is_locked( positions.size( ), false ),
+            versions( positions.size( ), 0 )
+         {
+            std::size_t const triangle_count = triangles.size( ) / 3;
+
+            for( std::size_t t = 0; t < triangle_count; ++t )
+            {
+               std::uint32_t const a = triangles[t * 3 + 0];
+               std::uint32_t const b = triangles[t * 3 + 1];
+               std::uint32_t const c = triangles[t * 3 + 2];
+
+               if ( a >= positions.size( ) || b >= positions.size( ) || c >= positions.size( ) || a == b || b == c || a == c )
+               {
+                  is_removed[t] = true;
+                  continue;
+               }
+
+               ++live_triangle_count;
+
+               glm::dvec3 const pa = positions[a];
+               glm::dvec3 const normal = glm::cross( glm::dvec3( positions[b] ) - pa, glm::dvec3( positions[c] ) - pa );
+               double const length = glm::length( normal );
+               if ( length > 0.0 )
+               {
+                  auto const n = normal / length;
+                  auto const q = make_plane_quadric( n, -glm::dot( n, pa ) );
+
+                  quadrics[a] += q;
+                  quadrics[b] += q;
+                  quadrics[c] += q;
+               }
+
+               vertex_triangles[a].push_back( static_cast<std::uint32_t>( t ) );
+               vertex_triangles[b].push_back( static_cast<std::uint32_t>( t ) );
+               vertex_triangles[c].push_back( static_cast<std::uint32_t>( t ) );
+            }
+
+            lock_open_edges( );
+
+            for( std::uint32_t v = 0; v < positions.size( ); ++v )
+            {
+               push_best_collapse( v );
+            }
+         }
+
+         /**
+          * @brief Collapse vertices until the triangle list is down to
+          * a number of indices, or nothing can be collapsed under the
+          * maximum error.
+          */
+         void run( std::size_t target_index_count, double max_error_squared )
+         {
+            while( live_triangle_count * 3 > target_index_count && !queue.empty( ) )
+            {
+               auto const top = queue.top( );
+               if ( top.version != versions[top.from] || is_locked[top.from] || vertex_triangles[top.from].empty( ) )
+               {
+                  queue.pop( );
+                  continue;
+               }
+
+               if ( top.cost > max_error_squared )
+               {
+                  break;
+               }
+
+               queue.pop( );
+
+               get_neighbours( top.from, candidates );
+               if ( !is_valid( top.from, top.to, candidates ) )
+               {
+                  ++versions[top.from];
+                  push_best_collapse( top.from );
+                  continue;
+               }
+
+               apply( top.from, top.to, top.cost );
+            }
+         }
+
+         [[nodiscard]]
+         std::vector<std::uint32_t> get_indices( ) const
+         {
+            std::vector<std::uint32_t> res;
+            res.reserve( live_triangle_count * 3 );
+
+            for( std::size_t t = 0; t < is_removed.size( ); ++t )
+            {
+               if ( !is_removed[t] )
+               {
+                  res.insert( res.end( ), triangles.begin( ) + t * 3, triangles.begin( ) + t * 3 + 3 );
+               }
+            }
+
+            return res;
+         }
+
+         [[nodiscard]]
+         std::size_t get_index_count( ) const noexcept
+         {
+            return live_triangle_count * 3;
+         }
+
+         [[nodiscard]]
+         float get_error( ) const noexcept
+         {
+            return static_cast<float>( std::sqrt( max_error ) );
+         }
+
+      private:
+         /**
+          * @brief Lock the vertices of every edge not shared by exactly
+          * two triangles.
+          */
+         void lock_open_edges( )
+         {
+            std::vector<std::uint64_t> edges;
+            edges.reserve( live_triangle_count * 3 );
+
+            for( std::size_t t = 0; t < is_removed.size( ); ++t )
+            {
+               if ( is_removed[t] )
+               {
+                  continue;
+               }
+
+               for( std::size_t i = 0; i < 3; ++i )
+               {
+                  std::uint64_t const a = triangles[t * 3 + i];
+                  std::uint64_t const b = triangles[t * 3 + ( i + 1 ) % 3];
+
+                  edges.push_back( std::min( a, b ) << 32 | std::max( a, b ) );
+               }
+            }
+
+            std::sort( edges.begin( ), edges.end( ) );
+
+            for( std::size_t i = 0; i < edges.size( ); )
+            {
+               std::size_t j = i + 1;
+               while( j < edges.size( ) && edges[j] == edges[i] )
+               {
+                  ++j;
+               }
+
+               if ( j - i != 2 )
+               {
+                  is_locked[edges[i] >> 32] = true;
+                  is_locked[edges[i] & 0xffffffff] = true;
+               }
+
+               i = j;
+            }
+         }
+
+         void get_neighbours( std::uint32_t v, std::vector<std::uint32_t>& out ) const
+         {
+            out.clear( );
+            for( std::uint32_t t : vertex_triangles[v] )
+            {
+               for( std::size_t i = 0; i < 3; ++i )
+               {
+                  if ( triangles[t * 3 + i] != v )
+                  {
+                     out.push_back( triangles[t * 3 + i] );
+                  }
+               }
+            }
+
+            std::sort( out.begin( ), out.end( ) );
+            out.erase( std::unique( out.begin( ), out.end( ) ), out.end( ) );
+         }
+
+         /**
+          * @brief Whether moving a vertex onto a neighbour keeps the
+          * surface manifold and flips no triangle.
+          *
+          * @param [in] from_neighbours The neighbours of from, sorted.
+          */
+         bool is_valid( std::uint32_t from, std::uint32_t to, std::vector<std::uint32_t> const& from_neighbours )
+         {
+            get_neighbours( to, to_neighbours );
+
+            if ( !std::binary_search( from_neighbours.begin( ), from_neighbours.end( ), to ) )
+            {
+               return false;
+            }
+
+            // Two vertices of valence 3 are the last edge of a tetrahedron.
+            if ( from_neighbours.size( ) == 3 && to_neighbours.size( ) == 3 )
+            {
+               return false;
+            }
+
+            // Only the two vertices opposite the edge may be shared, more would
+            // pinch the surface into a non manifold edge.
+            std::size_t shared_count = 0;
+            for( std::size_t i = 0, j = 0; i < from_neighbours.size( ) && j < to_neighbours.size( ); )
+            {
+               if ( from_neighbours[i] < to_neighbours[j] )
+               {
+                  ++i;
+               }
+               else if ( to_neighbours[j] < from_neighbours[i] )
+               {
+                  ++j;
+               }
+               else
+               {
+                  ++shared_count;
+                  ++i;
+                  ++j;
+               }
+            }
+
+            if ( shared_count != 2 )
+            {
+               return false;
+            }
+
+            for( std::uint32_t t : vertex_triangles[from] )
+            {
+               std::uint32_t const* p_tri = triangles.data( ) + t * 3;
+               if ( p_tri[0] == to || p_tri[1] == to || p_tri[2] == to )
+               {
+                  continue;
+               }
+
+               glm::vec3 moved[3];
+               glm::vec3 original[3];
+               for( std::size_t i = 0; i < 3; ++i )
+               {
+                  original[i] = positions[p_tri[i]];
+                  moved[i] = p_tri[i] == from ? positions[to] : original[i];
+               }
+
+               auto const before = glm::cross( original[1] - original[0], original[2] - original[0] );
+               auto const after = glm::cross( moved[1] - moved[0], moved[2] - moved[0] );
+               if ( glm::dot( before, after ) <= 0.0f )
+               {
+                  return false;
+               }
+            }
+
+            return true;
+         }
+
+         /**
+          * @brief Queue the cheapest valid collapse of a vertex.
+          */
+         void push_best_collapse( std::uint32_t v )
+         {
+            if ( is_locked[v] || vertex_triangles[v].empty( ) )
+            {
+               return;
+            }
+
+            get_neighbours( v, candidates );
+
+            collapse best{ .cost = std::numeric_limits<double>::max( ), .from = v, .to = v, .version = versions[v] };
+            for( std::uint32_t to : candidates )
+            {
+               double const cost = evaluate( sum( quadrics[v], quadrics[to] ), positions[to] );
+               if ( cost < best.cost && is_valid( v, to, candidates ) )
+               {
+                  best.cost = cost;
+                  best.to = to;
+               }
+            }
+
+            if ( best.to != v )
+            {
+               queue.push( best );
+            }
+         }
+
+         void apply( std::uint32_t from, std::uint32_t to, double cost )
+         {
+            for( std::uint32_t t : vertex_triangles[from] )
+            {
+               std::uint32_t* p_tri = triangles.data( ) + t * 3;
+               if ( p_tri[0] == to || p_tri[1] == to || p_tri[2] == to )
+               {
+                  is_removed[t] = true;
+                  --live_triangle_count;
+
+                  for( std::size_t i = 0; i < 3; ++i )
+                  {
+                     if ( p_tri[i] != from )
+                     {
+                        auto& list = vertex_triangles[p_tri[i]];
+                        list.erase( std::find( list.begin( ), list.end( ), t ) );
+                     }
+                  }
+               }
+               else
+               {
+                  std::replace( p_tri, p_tri + 3, from, to );
+                  vertex_triangles[to].push_back( t );
+               }
+            }
+
+            vertex_triangles[from].clear( );
+            vertex_triangles[from].shrink_to_fit( );
+
+            quadrics[to] += quadrics[from];
+            max_error = std::max( max_error, cost );
+
+            // The collapse changed the quadric of the target and the
+            // neighbourhood of every vertex around it.
+            get_neighbours( to, updated );
+            updated.push_back( to );
+            for( std::uint32_t v : updated )
+            {
+               ++versions[v];
+               push_best_collapse( v );
+            }
+         }
+
+      private:
+         std::vector<glm::vec3> const& positions;
+
+         std::vector<std::uint32_t> triangles;
+         std::vector<bool> is_removed;
+         std::size_t live_triangle_count = 0;
+
+         std::vector<std::vector<std::uint32_t>> vertex_triangles;
+         std::vector<quadric> quadrics;
+         std::vector<bool> is_locked;
+         std::vector<std::uint32_t> versions;
+
+         std::priority_queue<collapse, std::vector<collapse>, std::greater<collapse>> queue;
+         double max_error = 0.0;
+
+         std::vector<std::uint32_t> to_neighbours;
+         std::vector<std::uint32_t> candidates;
+         std::vector<std::uint32_t> updated;
+      }; // class simplifier
+
+      double square( float error ) noexcept
+      {
+         return error == std::numeric_limits<float>::max( ) ? 
+            std::numeric_limits<double>::max( ) : 
+            static_cast<double>( error ) * static_cast<double>( error );
+      }
+   } // namespace
+
+   simplified_mesh simplify_mesh(
+      std::vector<std::uint32_t> const& indices,
+      std::vector<glm::vec3> const& positions,
+      std::uint32_t target_index_count,
+      float max_error )
+   {
+      simplifier s( indices, positions );
+      s.run( target_index_count, square( max_error ) );
+
+      return simplified_mesh{ .indices = s.get_indices( ), .error = s.get_error( ) };
+   }
+
+   std::vector<simplified_mesh> build_lod_chain(
+      std::vector<std::uint32_t> const& indices,
+      std::vector<glm::vec3> const& positions,
+      std::uint32_t max_lod_count,
+      float reduction,
+      float max_error )
+   {
+      std::vector<simplified_mesh> res;
+
+      simplifier s( indices, positions );
+
+      std::size_t previous_count = s.get_index_count( );
+      double target = static_cast<double>( previous_count );
+      for( std::uint32_t i = 0; i < max_lod_count; ++i )
+      {
+         target *= static_cast<double>( reduction );
+         s.run( static_cast<std::size_t>( target ), square( max_error ) );
+
+         std::size_t const count = s.get_index_count( );
+         if ( count == 0 || count * 10 > previous_count * 9 )
+         {
+            break;
+         }
+
+         res.push_back( simplified_mesh
+         {
+            .indices = optimize_vertex_cache( s.get_indices( ), static_cast<std::uint32_t>( positions.size( ) ) ),
+            .error = s.get_error( )
+         } );
+
+         previous_count = count;
+      }
+
+      return res;
+   }
+} // namespace gfx
@@ -16,10 +16,12 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <luciole/graphics/draw_recording.hpp>
 #include <luciole/graphics/renderer.hpp>
 #include <luciole/graphics/vertex.hpp>
 #include <luciole/ui/event.hpp>
 #include <luciole/utils/file_io.hpp>
+#include <luciole/vk/shaders/shader_compiler.hpp>
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
@@ -27,6 +29,12 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
 const std::vector<vertex> vertices = {
     {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
     {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}},
@@ -38,6 +46,46 @@ const std::vector<std::uint32_t> indices = {
     0, 1, 2, 2, 3, 0
 };
 
+namespace
+{
+   /**
+    * @brief The data the steps of renderer::load_content hand to each other.
+    */
+   struct content_load
+   {
+      content_load( ) = default;
+      content_load( content_load const& rhs ) = delete;
+      content_load& operator=( content_load const& rhs ) = delete;
+
+      ~content_load( )
+      {
+         if ( pipeline != VK_NULL_HANDLE )
+         {
+            p_context->destroy_pipeline( vk::pipeline_t( pipeline ) );
+         }
+
+         if ( instanced_pipeline != VK_NULL_HANDLE )
+         {
+            p_context->destroy_pipeline( vk::pipeline_t( instanced_pipeline ) );
+         }
+      }
+
+      context const* p_context = nullptr;
+
+      std::string vert_shader_code;
+      std::string frag_shader_code;
+      std::string instanced_vert_shader_code;
+      std::vector<std::byte> vertices;
+      std::vector<std::uint32_t> cull_shader;
+      std::vector<std::uint32_t> occlusion_cull_shader;
+      std::vector<std::uint32_t> depth_pyramid_shader;
+
+      VkPipeline pipeline = VK_NULL_HANDLE;
+      VkPipeline instanced_pipeline = VK_NULL_HANDLE;
+      std::uint64_t swapchain_generation = 0;
+   }; // struct content_load
+} // namespace
+
 /**
  * @brief Construct a new renderer object.
  * 
@@ -63,28 +111,16 @@ renderer::renderer( p_context_t p_context, ui::window& wnd )
 
    wnd.add_callback( framebuffer_resize_event_delg( *this, &renderer::on_framebuffer_resize ) );
 
-   auto vertex_buffer_create_info = vk::vertex_buffer::create_info( );
-   vertex_buffer_create_info.p_context = p_context.value( );
-   vertex_buffer_create_info.memory_allocator = p_context.value( )->get_memory_allocator( );
-   vertex_buffer_create_info.family_indices = p_context.value( )->get_unique_family_indices( );
-   vertex_buffer_create_info.vertices = vertices;
+   model_node = transforms.create( );
 
-   vertex_buffer = vk::vertex_buffer( 
-      vk::vertex_buffer::create_info_t(
-         vertex_buffer_create_info 
-      ) 
-   );
+   for( auto const& v : vertices )
+   {
+      model_min = glm::min( model_min, glm::vec3( v.position, 0.0f ) );
+      model_max = glm::max( model_max, glm::vec3( v.position, 0.0f ) );
+   }
 
-   auto index_buffer_create_info = vk::index_buffer::create_info( );
-   index_buffer_create_info.p_context = p_context.value( );
-   index_buffer_create_info.family_indices = p_context.value( )->get_unique_family_indices( );
-   index_buffer_create_info.indices = indices;
-   
-   index_buffer = vk::index_buffer(
-      vk::index_buffer::create_info_t(
-         index_buffer_create_info
-      )
-   );
+   model_object = culling.add( model_min, model_max );
+   model_lod = lods.add( ( model_min + model_max ) * 0.5f, glm::length( model_max - model_min ) * 0.5f, { } );
 
    if ( auto res = create_descriptor_set_layout( ); auto* p_val = std::get_if<VkDescriptorSetLayout>( &res ) )
    {
@@ -201,12 +237,26 @@ renderer& renderer::operator=( renderer&& rhs )
       render_pass = rhs.render_pass;
       rhs.render_pass = VK_NULL_HANDLE;
 
+      late_render_pass = rhs.late_render_pass;
+      rhs.late_render_pass = VK_NULL_HANDLE;
+
+      depth_format = rhs.depth_format;
+      depth_image = std::move( rhs.depth_image );
+
       default_graphics_pipeline_layout = rhs.default_graphics_pipeline_layout;
       rhs.default_graphics_pipeline_layout = VK_NULL_HANDLE;
      
       default_graphics_pipeline = rhs.default_graphics_pipeline;
       rhs.default_graphics_pipeline_layout = VK_NULL_HANDLE;
 
+      instanced_graphics_pipeline = rhs.instanced_graphics_pipeline;
+      rhs.instanced_graphics_pipeline = VK_NULL_HANDLE;
+
+      descriptor_pool = rhs.descriptor_pool;
+      rhs.descriptor_pool = VK_NULL_HANDLE;
+
+      descriptor_sets = std::move( rhs.descriptor_sets );
+
       swapchain_framebuffers = std::move( rhs.swapchain_framebuffers );
 
       std::swap( render_command_buffers, rhs.render_command_buffers );
@@ -223,6 +273,41 @@ renderer& renderer::operator=( renderer&& rhs )
          rhs.in_flight_fences[i] = VK_NULL_HANDLE;
       }
 
+      vertex_buffer = std::move( rhs.vertex_buffer );
+      index_buffer = std::move( rhs.index_buffer );
+
+      vert_shader_code = std::move( rhs.vert_shader_code );
+      frag_shader_code = std::move( rhs.frag_shader_code );
+      instanced_vert_shader_code = std::move( rhs.instanced_vert_shader_code );
+      has_content = rhs.has_content;
+      rhs.has_content = false;
+
+      swapchain_generation = rhs.swapchain_generation;
+
+      transforms = std::move( rhs.transforms );
+      model_node = rhs.model_node;
+
+      culling = std::move( rhs.culling );
+      model_object = rhs.model_object;
+      model_min = rhs.model_min;
+      model_max = rhs.model_max;
+      is_model_visible = rhs.is_model_visible;
+
+      draws = std::move( rhs.draws );
+      instances = std::move( rhs.instances );
+
+      lods = std::move( rhs.lods );
+      model_lod = rhs.model_lod;
+      model_levels = std::move( rhs.model_levels );
+
+      gpu_culling = std::move( rhs.gpu_culling );
+      model_instance = rhs.model_instance;
+      is_gpu_culled = rhs.is_gpu_culled;
+      rhs.is_gpu_culled = false;
+
+      depth_pyramid = std::move( rhs.depth_pyramid );
+      depth_pyramid_shader = std::move( rhs.depth_pyramid_shader );
+
       p_context = rhs.p_context;
       rhs.p_context = nullptr;
    }
@@ -260,13 +345,68 @@ void renderer::draw_frame( )
       current_time - start_time 
    ).count( ); 
 
+   transforms.set_rotation( model_node, glm::angleAxis( time * glm::radians( 90.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) ) );
+   transforms.update( );
+
    uniform_buffer_object ubo = { };
-   ubo.model = glm::rotate( glm::mat4( 1.0f ), time * glm::radians( 90.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+   ubo.model = transforms.get_world_matrix( model_node );
    ubo.view = glm::lookAt( glm::vec3( 2.0f, 2.0f, 2.0f ), glm::vec3( 0.0f, 0.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
    ubo.proj = glm::perspective( glm::radians( 45.0f ), swapchain_extent.width / (float) swapchain_extent.height, 0.1f, 10.0f );
    ubo.proj[1][1] *= -1;
 
    uniform_buffers[image_index].map_data( ubo );
+
+   float const scale = std::max( { 
+      glm::length( glm::vec3( ubo.model[0] ) ), 
+      glm::length( glm::vec3( ubo.model[1] ) ), 
+      glm::length( glm::vec3( ubo.model[2] ) ) 
+   } );
+
+   glm::vec3 const model_center = glm::vec3( ubo.model * glm::vec4( ( model_min + model_max ) * 0.5f, 1.0f ) );
+   float const model_radius = glm::length( model_max - model_min ) * 0.5f * scale;
+
+   auto const lod_view = gfx::make_lod_view( ubo.view, ubo.proj, static_cast<float>( swapchain_extent.height ) );
+
+   // Every submit is waited on, so the command buffers are free to record again
+   // and the culling buffers to be written.
+   if ( is_gpu_culled )
+   {
+      gpu_culling.set_bounds( model_instance, model_center, model_radius );
+
+      // The GPU does not report what it culled, every instance gets a level.
+      lods.set_bounds( model_lod, model_center, model_radius, scale );
+      visible_objects.assign( 1, model_lod );
+      if ( lods.select( lod_view, visible_objects ) )
+      {
+         gpu_culling.set_range( model_instance, model_levels[lods.get_level( model_lod )] );
+      }
+
+      gpu_culling.set_camera( ubo.view, ubo.proj );
+      gpu_culling.update( gfx::make_frustum( ubo.proj * ubo.view ) );
+   }
+   else
+   {
+      culling.set( model_object, ubo.model, model_min, model_max );
+      culling.cull( gfx::make_frustum( ubo.proj * ubo.view ), visible_objects );
+
+      lods.set_bounds( model_lod, model_center, model_radius, scale );
+      bool const is_level_changed = lods.select( lod_view, visible_objects );
+
+      draws.clear( );
+      if ( !visible_objects.empty( ) )
+      {
+         draws.add( gfx::draw_list::draw_item{ .mesh = lods.get_level( model_lod ), .transform = ubo.model } );
+      }
+
+      draws.build( );
+      instances.write( image_index, draws );
+
+      if ( bool const is_visible = !visible_objects.empty( ); is_visible != is_model_visible || is_level_changed )
+      {
+         is_model_visible = is_visible;
+         record_command_buffers( );
+      }
+   }
          
    VkSubmitInfo const submit_info 
    {
@@ -332,6 +472,186 @@ std::uint32_t renderer::load_shader( vk::shader_loader_interface const* p_loader
    return shader_manager.load_shader( p_loader, filepath );
 }
 
+void renderer::load_content( assets::loading_pipeline& pipeline )
+{
+   auto p_load = std::make_shared<content_load>( );
+   p_load->p_context = p_context;
+
+   assets::loading_pipeline::job job;
+   job.name = "default content";
+   
+   job.steps.push_back( { assets::load_stage::e_io, [p_load] 
+   {
+      p_load->vert_shader_code = read_from_binary_file( "../data/shaders/default_vert.spv" );
+      p_load->frag_shader_code = read_from_binary_file( "../data/shaders/default_frag.spv" );
+   } } );
+
+   job.steps.push_back( { assets::load_stage::e_decode, [this, p_load] 
+   {
+      // A shader that fails to compile leaves its feature off, the model
+      // is still drawn.
+      auto const compile = [this]( char const* p_filepath )
+      {
+         try
+         {
+            return vk::shader_compiler( ).load_shader( vk::shader::filepath_view_t( p_filepath ) ).first;
+         }
+         catch( std::runtime_error const& e )
+         {
+            vulkan_logger->warn( "{0}", e.what( ) );
+
+            return std::vector<std::uint32_t>( );
+         }
+      };
+
+      p_load->vertices = vertex::encode( vertices );
+      p_load->cull_shader = compile( "../data/shaders/cull_instances.comp" );
+      p_load->occlusion_cull_shader = compile( "../data/shaders/cull_occlusion.comp" );
+      p_load->depth_pyramid_shader = compile( "../data/shaders/depth_pyramid.comp" );
+
+      auto const instanced_vert_shader = compile( "../data/shaders/instanced_shader.vert" );
+      p_load->instanced_vert_shader_code.assign( 
+         reinterpret_cast<char const*>( instanced_vert_shader.data( ) ), 
+         instanced_vert_shader.size( ) * sizeof( std::uint32_t ) 
+      );
+   } } );
+
+   job.steps.push_back( { assets::load_stage::e_pipeline, [this, p_load] 
+   {
+      std::scoped_lock lock( swapchain_mutex );
+
+      auto const res = create_default_pipeline( 
+         vert_shader_code_t( p_load->vert_shader_code ), 
+         frag_shader_code_t( p_load->frag_shader_code )
+      );
+
+      if ( auto const* p_val = std::get_if<VkPipeline>( &res ) )
+      {
+         p_load->pipeline = *p_val;
+         p_load->swapchain_generation = swapchain_generation;
+      }
+      else
+      {
+         throw std::runtime_error{ "Default Graphics Pipeline Creation Error: " + std::get<vk::error>( res ).to_string( ) + "." };
+      }
+
+      if ( !p_load->instanced_vert_shader_code.empty( ) )
+      {
+         auto const res_instanced = create_default_pipeline( 
+            vert_shader_code_t( p_load->instanced_vert_shader_code ), 
+            frag_shader_code_t( p_load->frag_shader_code )
+         );
+
+         if ( auto const* p_val = std::get_if<VkPipeline>( &res_instanced ) )
+         {
+            p_load->instanced_pipeline = *p_val;
+         }
+         else
+         {
+            vulkan_logger->warn( 
+               "Instanced Graphics Pipeline Creation Error, drawing with the default pipeline: {0}.", 
+               std::get<vk::error>( res_instanced ).to_string( ) 
+            );
+         }
+      }
+   } } );
+
+   job.steps.push_back( { assets::load_stage::e_upload, [this, p_load] 
+   {
+      auto vertex_buffer_create_info = vk::vertex_buffer::create_info( );
+      vertex_buffer_create_info.p_context = p_context;
+      vertex_buffer_create_info.vertices = std::move( p_load->vertices );
+
+      auto index_buffer_create_info = vk::index_buffer::create_info( );
+      index_buffer_create_info.p_context = p_context;
+      index_buffer_create_info.indices = indices;
+
+      // The buffers and pipeline are replaced and the command buffers recorded again.
+      if ( auto const err = p_context->device_wait_idle( ); err.is_error( ) )
+      {
+         throw std::runtime_error{ "Device Wait Idle Error: " + err.to_string( ) + "." };
+      }
+
+      vertex_buffer = vk::vertex_buffer( vk::vertex_buffer::create_info_t( vertex_buffer_create_info ) );
+      index_buffer = vk::index_buffer( vk::index_buffer::create_info_t( index_buffer_create_info ) );
+
+      // The model has no reduced level of detail, cooked meshes bring theirs.
+      model_levels.assign( 1, gfx::gpu_culling::draw_range{ .index_count = index_buffer.get_index_count( ) } );
+
+      std::scoped_lock lock( swapchain_mutex );
+
+      // Occlusion culling first, then frustum culling alone, then the CPU.
+      depth_pyramid = gfx::depth_pyramid( );
+      depth_pyramid_shader = std::move( p_load->depth_pyramid_shader );
+
+      is_gpu_culled = 
+         create_gpu_culling( std::move( p_load->occlusion_cull_shader ), true ) || 
+         create_gpu_culling( std::move( p_load->cull_shader ), false );
+
+      if ( !is_gpu_culled )
+      {
+         vulkan_logger->warn( "GPU culling is unavailable, culling on the CPU." );
+      }
+
+      vert_shader_code = std::move( p_load->vert_shader_code );
+      frag_shader_code = std::move( p_load->frag_shader_code );
+      instanced_vert_shader_code = std::move( p_load->instanced_vert_shader_code );
+
+      if ( default_graphics_pipeline != VK_NULL_HANDLE )
+      {
+         p_context->destroy_pipeline( vk::pipeline_t( default_graphics_pipeline ) );
+         default_graphics_pipeline = VK_NULL_HANDLE;
+      }
+
+      if ( instanced_graphics_pipeline != VK_NULL_HANDLE )
+      {
+         p_context->destroy_pipeline( vk::pipeline_t( instanced_graphics_pipeline ) );
+         instanced_graphics_pipeline = VK_NULL_HANDLE;
+      }
+
+      // The swapchain was rebuilt while the pipeline was created, its
+      // viewport no longer matches.
+      if ( p_load->swapchain_generation == swapchain_generation )
+      {
+         default_graphics_pipeline = std::exchange( p_load->pipeline, VK_NULL_HANDLE );
+         instanced_graphics_pipeline = std::exchange( p_load->instanced_pipeline, VK_NULL_HANDLE );
+      }
+      else
+      {
+         create_instanced_pipeline( );
+
+         auto const res = create_default_pipeline( 
+            vert_shader_code_t( vert_shader_code ), 
+            frag_shader_code_t( frag_shader_code )
+         );
+
+         if ( auto const* p_val = std::get_if<VkPipeline>( &res ) )
+         {
+            default_graphics_pipeline = *p_val;
+         }
+         else
+         {
+            throw std::runtime_error{ "Default Graphics Pipeline Recreation Error: " + std::get<vk::error>( res ).to_string( ) + "." };
+         }
+      }
+
+      has_content = true;
+
+      // The draw list is only built for the content from the next frame,
+      // which records the command buffers again.
+      is_model_visible = false;
+
+      record_command_buffers( );
+   } } );
+
+   pipeline.enqueue( std::move( job ) );
+}
+
+bool renderer::is_content_loaded( ) const noexcept
+{
+   return has_content;
+}
+
 void renderer::on_framebuffer_resize( framebuffer_resize_event const& event )
 {
    window_width = event.size.x;
@@ -341,10 +661,14 @@ void renderer::on_framebuffer_resize( framebuffer_resize_event const& event )
 
 void renderer::create_swapchain( )
 {
+   std::scoped_lock lock( swapchain_mutex );
+
    p_context->device_wait_idle();
 
    cleanup_swapchain( );
 
+   ++swapchain_generation;
+
    auto const capabilities = p_context->get_surface_capabilities();
    auto const format = pick_swapchain_format();
    
@@ -421,7 +745,27 @@ void renderer::create_swapchain( )
       }
    }
 
-   if ( auto res = create_render_pass( ); auto p_val = std::get_if<VkRenderPass>( &res ) )
+   depth_format = pick_depth_format( );
+   if ( depth_format == VK_FORMAT_UNDEFINED )
+   {
+      vulkan_logger->error( "Depth Buffer Recreation Error: no supported format." );
+
+      abort( );
+   }
+
+   vk::texture::create_info const depth_create_info
+   {
+      .p_context = p_context,
+      .extent = swapchain_extent,
+      .format = depth_format,
+      .mip_levels = 1,
+      .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      .aspect = VK_IMAGE_ASPECT_DEPTH_BIT
+   };
+
+   depth_image = vk::texture( vk::texture::create_info_t( depth_create_info ) );
+
+   if ( auto res = create_render_pass( VK_ATTACHMENT_LOAD_OP_CLEAR ); auto p_val = std::get_if<VkRenderPass>( &res ) )
    {
       render_pass = *p_val;
    }
@@ -435,6 +779,20 @@ void renderer::create_swapchain( )
       abort( );
    }
 
+   if ( auto res = create_render_pass( VK_ATTACHMENT_LOAD_OP_LOAD ); auto p_val = std::get_if<VkRenderPass>( &res ) )
+   {
+      late_render_pass = *p_val;
+   }
+   else
+   {
+      vulkan_logger->error(
+         "Late Render Pass Recreation Error: {0}.",
+         std::get<vk::error>( res ).to_string( )
+      );
+       
+      abort( );
+   }
+
    if ( auto res = create_default_pipeline_layout( ); auto p_val = std::get_if<VkPipelineLayout>( &res ) )
    {
       default_graphics_pipeline_layout = *p_val;
@@ -449,23 +807,28 @@ void renderer::create_swapchain( )
       abort( );
    }
 
-   auto const res_default_pipeline = create_default_pipeline( 
-      vert_shader_filepath_t( "../data/shaders/default_vert.spv" ), 
-      frag_shader_filepath_t( "../data/shaders/default_frag.spv" )
-   );
-      
-   if ( auto const* p_val = std::get_if<VkPipeline>( &res_default_pipeline ) )
+   if ( has_content )
    {
-      default_graphics_pipeline = *p_val;
-   }
-   else
-   {
-      vulkan_logger->error(
-         "Default Graphics Pipeline Recreation Error: {0}.",
-         std::get<vk::error>( res_default_pipeline ).to_string( )
+      auto const res_default_pipeline = create_default_pipeline( 
+         vert_shader_code_t( vert_shader_code ), 
+         frag_shader_code_t( frag_shader_code )
       );
+      
+      if ( auto const* p_val = std::get_if<VkPipeline>( &res_default_pipeline ) )
+      {
+         default_graphics_pipeline = *p_val;
+      }
+      else
+      {
+         vulkan_logger->error(
+            "Default Graphics Pipeline Recreation Error: {0}.",
+            std::get<vk::error>( res_default_pipeline ).to_string( )
+         );
 
-      abort( );
+         abort( );
+      }
+
+      create_instanced_pipeline( );
    }
 
    auto const res_command_buffers = p_context->create_command_buffers(
@@ -515,10 +878,42 @@ void renderer::create_swapchain( )
       uniform_buffers.emplace_back( *p_context, sizeof( uniform_buffer_object ) );
    }
 
+   gfx::instance_buffer::create_info const instances_create_info
+   {
+      .p_context = p_context,
+      .frame_count = image_count,
+      .max_instance_count = 1024
+   };
+
+   instances = gfx::instance_buffer( gfx::instance_buffer::create_info_t( instances_create_info ) );
+
+   create_descriptor_sets( );
+
+   if ( is_gpu_culled && gpu_culling.is_occlusion_culled( ) )
+   {
+      try
+      {
+         create_depth_pyramid( );
+      }
+      catch( std::runtime_error const& e )
+      {
+         vulkan_logger->warn( "Depth Pyramid Recreation Error, culling on the CPU: {0}", e.what( ) );
+
+         is_gpu_culled = false;
+      }
+   }
+
    record_command_buffers( );
 }
 void renderer::cleanup_swapchain( )
 {
+   if ( descriptor_pool != VK_NULL_HANDLE )
+   {
+      descriptor_pool = p_context->destroy_descriptor_pool( vk::descriptor_pool_t( descriptor_pool ) );
+   }
+
+   descriptor_sets.clear( );
+   instances = gfx::instance_buffer( );
    uniform_buffers.clear( );
       
    for( auto& framebuffer : swapchain_framebuffers )
@@ -536,6 +931,12 @@ void renderer::cleanup_swapchain( )
       default_graphics_pipeline = VK_NULL_HANDLE;
    }
 
+   if ( instanced_graphics_pipeline != VK_NULL_HANDLE )
+   {
+      p_context->destroy_pipeline( vk::pipeline_t( instanced_graphics_pipeline ) );
+      instanced_graphics_pipeline = VK_NULL_HANDLE;
+   }
+
    if ( default_graphics_pipeline_layout != VK_NULL_HANDLE )
    {
       p_context->destroy_pipeline_layout( vk::pipeline_layout_t( default_graphics_pipeline_layout ) );
@@ -547,6 +948,15 @@ void renderer::cleanup_swapchain( )
       p_context->destroy_render_pass( vk::render_pass_t( render_pass ) );
       render_pass = VK_NULL_HANDLE;
    }
+
+   if ( late_render_pass != VK_NULL_HANDLE )
+   {
+      p_context->destroy_render_pass( vk::render_pass_t( late_render_pass ) );
+      late_render_pass = VK_NULL_HANDLE;
+   }
+
+   depth_pyramid = gfx::depth_pyramid( );
+   depth_image = vk::texture( );
    
    for( auto& image_view : swapchain_image_views )
    {
@@ -570,6 +980,22 @@ void renderer::cleanup_swapchain( )
 
 void renderer::record_command_buffers( )
 {
+   // The levels of the model are the meshes of the draw list.
+   gfx::draw_bindings bindings;
+   bindings.pipeline_layout = default_graphics_pipeline_layout;
+   bindings.pipelines.assign( 1, instanced_graphics_pipeline );
+   
+   for( auto const& level : model_levels )
+   {
+      bindings.meshes.push_back( gfx::draw_mesh
+      {
+         .vertex_buffer = vertex_buffer.get_buffer( ),
+         .index_buffer = index_buffer.get_buffer( ),
+         .index_type = index_buffer.get_index_type( ),
+         .range = level
+      } );
+   }
+
    for( size_t i = 0; i < render_command_buffers.size( ); ++i )
    {
       VkCommandBufferBeginInfo const buffer_begin_info 
@@ -592,7 +1018,11 @@ void renderer::record_command_buffers( )
          );
       }
 
-      VkClearValue const clear_colour = { 0.0f, 0.0f, 0.0f, 1.0f };
+      std::array<VkClearValue, 2> const clear_values = 
+      {
+         VkClearValue{ .color = { { 0.0f, 0.0f, 0.0f, 1.0f } } },
+         VkClearValue{ .depthStencil = { 1.0f, 0 } }
+      };
 
       VkRenderPassBeginInfo const pass_begin_info 
       {
@@ -605,21 +1035,77 @@ void renderer::record_command_buffers( )
             .offset = {0, 0},
             .extent = swapchain_extent
          },
-         .clearValueCount = 1,
-         .pClearValues = &clear_colour
+         .clearValueCount = static_cast<std::uint32_t>( clear_values.size( ) ),
+         .pClearValues = clear_values.data( )
       };
 
-      vkCmdBeginRenderPass( render_command_buffers[i], &pass_begin_info, VK_SUBPASS_CONTENTS_INLINE );
+      auto late_pass_begin_info = pass_begin_info;
+      late_pass_begin_info.renderPass = late_render_pass;
 
-      vkCmdBindPipeline( render_command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, default_graphics_pipeline );
+      auto const bind_model = [&]( VkCommandBuffer cmd_buffer ) 
+      {
+         vkCmdBindPipeline( cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, default_graphics_pipeline );
+         vkCmdBindDescriptorSets( 
+            cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, default_graphics_pipeline_layout, 0, 1, &descriptor_sets[i], 0, nullptr 
+         );
    
-      VkBuffer buffers[] = { vertex_buffer.get_buffer() };
-      VkDeviceSize offsets[] = { 0 };
-      vkCmdBindVertexBuffers( render_command_buffers[i], 0, 1, buffers, offsets );
+         VkBuffer buffers[] = { vertex_buffer.get_buffer() };
+         VkDeviceSize offsets[] = { 0 };
+         vkCmdBindVertexBuffers( cmd_buffer, 0, 1, buffers, offsets );
+
+         vkCmdBindIndexBuffer( cmd_buffer, index_buffer.get_buffer( ), 0, index_buffer.get_index_type( ) );
+      };
+
+      bool const is_occlusion_culled = has_content && is_gpu_culled && gpu_culling.is_occlusion_culled( );
+
+      if ( has_content && is_gpu_culled )
+      {
+         gpu_culling.record_cull( render_command_buffers[i], gfx::gpu_culling::cull_phase::e_early );
+      }
+
+      vkCmdBeginRenderPass( render_command_buffers[i], &pass_begin_info, VK_SUBPASS_CONTENTS_INLINE );
+
+      // While the content loads, the pass only clears: the loading frame.
+      if ( has_content && is_gpu_culled )
+      {
+         bind_model( render_command_buffers[i] );
+         gpu_culling.record_draw( render_command_buffers[i], gfx::gpu_culling::cull_phase::e_early );
+      }
+      else if ( has_content && instanced_graphics_pipeline != VK_NULL_HANDLE )
+      {
+         vkCmdBindDescriptorSets( 
+            render_command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, default_graphics_pipeline_layout, 0, 1, &descriptor_sets[i], 0, nullptr 
+         );
+
+         gfx::record_draw_list( render_command_buffers[i], draws, 0, bindings );
+      }
+      else if ( has_content && is_model_visible )
+      {
+         bind_model( render_command_buffers[i] );
 
-      vkCmdBindIndexBuffer( render_command_buffers[i], index_buffer.get_buffer( ), 0, VK_INDEX_TYPE_UINT32 );
+         auto const& level = model_levels[lods.get_level( model_lod )];
+         vkCmdDrawIndexed( render_command_buffers[i], level.index_count, 1, level.first_index, level.vertex_offset, 0 );
+      }
+
+      vkCmdEndRenderPass( render_command_buffers[i] );
+
+      // What was visible last frame is drawn, the rest is tested against
+      // its depth.
+      if ( is_occlusion_culled )
+      {
+         depth_pyramid.record_build( render_command_buffers[i] );
+         gpu_culling.record_cull( render_command_buffers[i], gfx::gpu_culling::cull_phase::e_late );
+      }
 
-      vkCmdDrawIndexed( render_command_buffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+      // Without occlusion culling, the late pass only hands the image to
+      // the presentation.
+      vkCmdBeginRenderPass( render_command_buffers[i], &late_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE );
+
+      if ( is_occlusion_culled )
+      {
+         bind_model( render_command_buffers[i] );
+         gpu_culling.record_draw( render_command_buffers[i], gfx::gpu_culling::cull_phase::e_late );
+      }
 
       vkCmdEndRenderPass( render_command_buffers[i] );
 
@@ -637,6 +1123,178 @@ void renderer::record_command_buffers( )
    }
 }
 
+bool renderer::create_gpu_culling( std::vector<std::uint32_t> spir_v, bool is_occlusion_culled )
+{
+   if ( spir_v.empty( ) || ( is_occlusion_culled && depth_pyramid_shader.empty( ) ) )
+   {
+      return false;
+   }
+
+   auto gpu_culling_create_info = gfx::gpu_culling::create_info( );
+   gpu_culling_create_info.p_context = p_context;
+   gpu_culling_create_info.spir_v = std::move( spir_v );
+   gpu_culling_create_info.is_occlusion_culled = is_occlusion_culled;
+
+   try
+   {
+      gpu_culling = gfx::gpu_culling( gfx::gpu_culling::create_info_t( gpu_culling_create_info ) );
+      model_instance = gpu_culling.add( 
+         ( model_min + model_max ) * 0.5f, 
+         glm::length( model_max - model_min ) * 0.5f,
+         model_levels.front( )
+      );
+
+      if ( is_occlusion_culled )
+      {
+         create_depth_pyramid( );
+      }
+
+      return true;
+   }
+   catch( std::runtime_error const& e )
+   {
+      vulkan_logger->warn( "GPU Culling Creation Error: {0}", e.what( ) );
+
+      return false;
+   }
+}
+
+void renderer::create_depth_pyramid( )
+{
+   auto depth_pyramid_create_info = gfx::depth_pyramid::create_info( );
+   depth_pyramid_create_info.p_context = p_context;
+   depth_pyramid_create_info.spir_v = depth_pyramid_shader;
+   depth_pyramid_create_info.depth_view = depth_image.get_image_view( );
+   depth_pyramid_create_info.depth_extent = swapchain_extent;
+
+   depth_pyramid = gfx::depth_pyramid( gfx::depth_pyramid::create_info_t( depth_pyramid_create_info ) );
+   gpu_culling.set_depth_pyramid( depth_pyramid );
+}
+
+void renderer::create_instanced_pipeline( )
+{
+   if ( instanced_vert_shader_code.empty( ) )
+   {
+      return;
+   }
+
+   auto const res = create_default_pipeline(
+      vert_shader_code_t( instanced_vert_shader_code ),
+      frag_shader_code_t( frag_shader_code )
+   );
+
+   if ( auto const* p_val = std::get_if<VkPipeline>( &res ) )
+   {
+      instanced_graphics_pipeline = *p_val;
+   }
+   else
+   {
+      vulkan_logger->warn(
+         "Instanced Graphics Pipeline Recreation Error, drawing with the default pipeline: {0}.",
+         std::get<vk::error>( res ).to_string( )
+      );
+   }
+}
+
+void renderer::create_descriptor_sets( )
+{
+   auto const set_count = static_cast<std::uint32_t>( uniform_buffers.size( ) );
+
+   std::array<VkDescriptorPoolSize, 2> const pool_sizes =
+   {
+      VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = set_count },
+      VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = set_count }
+   };
+
+   VkDescriptorPoolCreateInfo const pool_create_info
+   {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .maxSets = set_count,
+      .poolSizeCount = static_cast<std::uint32_t>( pool_sizes.size( ) ),
+      .pPoolSizes = pool_sizes.data( )
+   };
+
+   auto const res_pool = p_context->create_descriptor_pool( vk::descriptor_pool_create_info_t( pool_create_info ) );
+   if ( auto const* p_val = std::get_if<VkDescriptorPool>( &res_pool ) )
+   {
+      descriptor_pool = *p_val;
+   }
+   else
+   {
+      vulkan_logger->error(
+         "Descriptor Pool Recreation Error: {0}.",
+         std::get<vk::error>( res_pool ).to_string( )
+      );
+
+      abort( );
+   }
+
+   std::vector<VkDescriptorSetLayout> const set_layouts( set_count, descriptor_set_layout );
+
+   VkDescriptorSetAllocateInfo const set_allocate_info
+   {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .pNext = nullptr,
+      .descriptorPool = descriptor_pool,
+      .descriptorSetCount = set_count,
+      .pSetLayouts = set_layouts.data( )
+   };
+
+   descriptor_sets.resize( set_count, VK_NULL_HANDLE );
+
+   vk::error const err( vk::result_t(
+      vkAllocateDescriptorSets( p_context->get( ), &set_allocate_info, descriptor_sets.data( ) )
+   ) );
+
+   if ( err.is_error( ) )
+   {
+      vulkan_logger->error( "Descriptor Set Allocation Error: {0}.", err.to_string( ) );
+
+      abort( );
+   }
+
+   for( std::uint32_t i = 0; i < set_count; ++i )
+   {
+      std::array<VkDescriptorBufferInfo, 2> const buffer_infos =
+      {
+         VkDescriptorBufferInfo
+         {
+            .buffer = uniform_buffers[i].get_buffer( ),
+            .offset = 0,
+            .range = sizeof( uniform_buffer_object )
+         },
+         VkDescriptorBufferInfo
+         {
+            .buffer = instances.get_buffer( ),
+            .offset = instances.get_offset( i ),
+            .range = instances.get_range( )
+         }
+      };
+
+      std::array<VkWriteDescriptorSet, 2> writes = { };
+      for( std::uint32_t j = 0; j < writes.size( ); ++j )
+      {
+         writes[j] = VkWriteDescriptorSet
+         {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = descriptor_sets[i],
+            .dstBinding = j,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = pool_sizes[j].type,
+            .pImageInfo = nullptr,
+            .pBufferInfo = &buffer_infos[j],
+            .pTexelBufferView = nullptr
+         };
+      }
+
+      vkUpdateDescriptorSets( p_context->get( ), static_cast<std::uint32_t>( writes.size( ) ), writes.data( ), 0, nullptr );
+   }
+}
+
 std::variant<VkSwapchainKHR, vk::error> renderer::create_swapchain( 
     VkSurfaceCapabilitiesKHR const& capabilities, 
     VkSurfaceFormatKHR const& format ) const 
@@ -692,19 +1350,36 @@ std::variant<VkImageView, vk::error> renderer::create_image_view( vk::image_t im
    return p_context->create_image_view( vk::image_view_create_info_t( create_info ) );
 }
 
-std::variant<VkRenderPass, vk::error> renderer::create_render_pass( ) const
+std::variant<VkRenderPass, vk::error> renderer::create_render_pass( VkAttachmentLoadOp load_op ) const
 {
-   VkAttachmentDescription const colour_attachment
+   bool const is_first_pass = load_op == VK_ATTACHMENT_LOAD_OP_CLEAR;
+
+   std::array<VkAttachmentDescription, 2> const attachments = 
    {
-      .flags = 0,
-      .format = swapchain_image_format,
-      .samples = VK_SAMPLE_COUNT_1_BIT,
-      .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-      .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-      .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-      .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-      .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+      VkAttachmentDescription
+      {
+         .flags = 0,
+         .format = swapchain_image_format,
+         .samples = VK_SAMPLE_COUNT_1_BIT,
+         .loadOp = load_op,
+         .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+         .initialLayout = is_first_pass ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+         .finalLayout = is_first_pass ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+      },
+      VkAttachmentDescription
+      {
+         .flags = 0,
+         .format = depth_format,
+         .samples = VK_SAMPLE_COUNT_1_BIT,
+         .loadOp = load_op,
+         .storeOp = is_first_pass ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+         .initialLayout = is_first_pass ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+         .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+      }
    };
    
    VkAttachmentReference const colour_attachment_reference
@@ -712,6 +1387,12 @@ std::variant<VkRenderPass, vk::error> renderer::create_render_pass( ) const
       .attachment = 0,
       .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
    };
+
+   VkAttachmentReference const depth_attachment_reference
+   {
+      .attachment = 1,
+      .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+   };
    
    VkSubpassDescription const subpass_description
    {
@@ -722,20 +1403,40 @@ std::variant<VkRenderPass, vk::error> renderer::create_render_pass( ) const
       .colorAttachmentCount = 1,
       .pColorAttachments = &colour_attachment_reference,
       .pResolveAttachments = nullptr,
-      .pDepthStencilAttachment = nullptr,
+      .pDepthStencilAttachment = &depth_attachment_reference,
       .preserveAttachmentCount = 0,
       .pPreserveAttachments = nullptr
    };
 
-   VkSubpassDependency const dependency 
+   // The depth is read by the depth pyramid between the passes, and by 
+   // the previous frame.
+   std::array<VkSubpassDependency, 2> const dependencies = 
    {
-      .srcSubpass = VK_SUBPASS_EXTERNAL,
-      .dstSubpass = 0,
-      .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      .srcAccessMask = 0,
-      .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-      .dependencyFlags = 0
+      VkSubpassDependency 
+      {
+         .srcSubpass = VK_SUBPASS_EXTERNAL,
+         .dstSubpass = 0,
+         .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+         .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+         .srcAccessMask = 0,
+         .dstAccessMask = 
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | 
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+         .dependencyFlags = 0
+      },
+      VkSubpassDependency 
+      {
+         .srcSubpass = 0,
+         .dstSubpass = VK_SUBPASS_EXTERNAL,
+         .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+         .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+         .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+         .dstAccessMask = 
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | 
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | 
+            VK_ACCESS_SHADER_READ_BIT,
+         .dependencyFlags = 0
+      }
    };
    
    VkRenderPassCreateInfo const create_info
@@ -743,20 +1444,20 @@ std::variant<VkRenderPass, vk::error> renderer::create_render_pass( ) const
       .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .attachmentCount = 1,
-      .pAttachments = &colour_attachment,
+      .attachmentCount = static_cast<std::uint32_t>( attachments.size( ) ),
+      .pAttachments = attachments.data( ),
       .subpassCount = 1,
       .pSubpasses = &subpass_description,
-      .dependencyCount = 1,
-      .pDependencies = &dependency
+      .dependencyCount = static_cast<std::uint32_t>( dependencies.size( ) ),
+      .pDependencies = dependencies.data( )
    };
    
    return p_context->create_render_pass( vk::render_pass_create_info_t( create_info ) );
 }
 
-VkShaderModule renderer::create_shader_module( shader_filepath_t filepath ) const
+VkShaderModule renderer::create_shader_module( shader_code_t code ) const
 {
-   auto const spirv_code = read_from_binary_file( filepath.value( ) );
+   auto const& spirv_code = code.value( );
 
    VkShaderModuleCreateInfo const create_info 
    {
@@ -777,8 +1478,8 @@ std::variant<VkPipelineLayout, vk::error> renderer::create_default_pipeline_layo
       .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .setLayoutCount = 0,
-      .pSetLayouts = nullptr,
+      .setLayoutCount = 1,
+      .pSetLayouts = &descriptor_set_layout,
       .pushConstantRangeCount = 0,
       .pPushConstantRanges = nullptr
    };
@@ -788,13 +1489,25 @@ std::variant<VkPipelineLayout, vk::error> renderer::create_default_pipeline_layo
 
 std::variant<VkDescriptorSetLayout, vk::error> renderer::create_descriptor_set_layout( ) const
 {
-   VkDescriptorSetLayoutBinding const layout_binding =
-   { 
-      .binding = 0,
-      .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-      .descriptorCount = 1,
-      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-      .pImmutableSamplers = nullptr
+   // The uniform buffer, then the transforms of the instanced shader.
+   std::array<VkDescriptorSetLayoutBinding, 2> const layout_bindings =
+   {
+      VkDescriptorSetLayoutBinding
+      { 
+         .binding = 0,
+         .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+         .descriptorCount = 1,
+         .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+         .pImmutableSamplers = nullptr
+      },
+      VkDescriptorSetLayoutBinding
+      { 
+         .binding = 1,
+         .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+         .descriptorCount = 1,
+         .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+         .pImmutableSamplers = nullptr
+      }
    };
 
    VkDescriptorSetLayoutCreateInfo const create_info =
@@ -802,19 +1515,19 @@ std::variant<VkDescriptorSetLayout, vk::error> renderer::create_descriptor_set_l
       .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .bindingCount = 1,
-      .pBindings = &layout_binding
+      .bindingCount = static_cast<std::uint32_t>( layout_bindings.size( ) ),
+      .pBindings = layout_bindings.data( )
    };
 
    return p_context->create_descriptor_set_layout( vk::descriptor_set_layout_create_info_t( create_info ) );
 }
 
 std::variant<VkPipeline, vk::error> renderer::create_default_pipeline( 
-   vert_shader_filepath_t vert_filepath, 
-   frag_shader_filepath_t frag_filepath ) const 
+   vert_shader_code_t vert_code, 
+   frag_shader_code_t frag_code ) const 
 {
-   auto const vert_shader = create_shader_module( shader_filepath_t( vert_filepath.value( ) ) );
-   auto const frag_shader = create_shader_module( shader_filepath_t( frag_filepath.value( ) ) );
+   auto const vert_shader = create_shader_module( shader_code_t( vert_code.value( ) ) );
+   auto const frag_shader = create_shader_module( shader_code_t( frag_code.value( ) ) );
 
    VkPipelineShaderStageCreateInfo vert_shader_stage_create_info 
    {
@@ -924,6 +1637,22 @@ std::variant<VkPipeline, vk::error> renderer::create_default_pipeline(
       .alphaToOneEnable = VK_FALSE
    };
 
+   VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info
+   {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .depthTestEnable = VK_TRUE,
+      .depthWriteEnable = VK_TRUE,
+      .depthCompareOp = VK_COMPARE_OP_LESS,
+      .depthBoundsTestEnable = VK_FALSE,
+      .stencilTestEnable = VK_FALSE,
+      .front = { },
+      .back = { },
+      .minDepthBounds = 0.0f,
+      .maxDepthBounds = 1.0f
+   };
+
    VkPipelineColorBlendAttachmentState colour_blend_attachment_state
    {
       .blendEnable = VK_FALSE,
@@ -975,7 +1704,7 @@ std::variant<VkPipeline, vk::error> renderer::create_default_pipeline(
       .pViewportState = &viewport_state_create_info,
       .pRasterizationState = &rasterization_state_create_info,
       .pMultisampleState = &multisample_state_create_info,
-      .pDepthStencilState = nullptr,
+      .pDepthStencilState = &depth_stencil_state_create_info,
       .pColorBlendState = &colour_blend_state_create_info,
       .pDynamicState = &dynamic_state_create_info,
       .layout = default_graphics_pipeline_layout,
@@ -1020,7 +1749,8 @@ std::variant<VkFence, vk::error> renderer::create_fence( ) const
 std::variant<VkFramebuffer, vk::error> renderer::create_framebuffer( vk::image_view_t image_view ) const
 {
    VkImageView attachments[] = {
-      image_view.value( )
+      image_view.value( ),
+      depth_image.get_image_view( )
    };
 
    VkFramebufferCreateInfo const create_info
@@ -1054,6 +1784,21 @@ VkSurfaceFormatKHR renderer::pick_swapchain_format( ) const
    return formats[0];
 }
 
+VkFormat renderer::pick_depth_format( ) const
+{
+   // D16 is always supported as a depth attachment, both are sampled by 
+   // the depth pyramid.
+   for( auto const format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM } )
+   {
+      if ( p_context->is_format_supported( format, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) )
+      {
+         return format;
+      }
+   }
+
+   return VK_FORMAT_UNDEFINED;
+}
+
 VkPresentModeKHR renderer::pick_swapchain_present_mode( ) const
 {
    auto const present_modes = p_context->get_present_modes( );
@@ -0,0 +1,535 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/software_occlusion.hpp>
+#include <luciole/utils/simd.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace gfx
+{
+   namespace
+   {
+#if defined( LUCIOLE_SIMD_AVX2 )
+      using raster_ops = simd::avx2_ops;
+#elif defined( LUCIOLE_SIMD_SSE2 )
+      using raster_ops = simd::sse2_ops;
+#else
+      using raster_ops = simd::scalar_ops;
+#endif
+
+      float constexpr empty_depth = std::numeric_limits<float>::max( );
+
+      /**
+       * @brief Below this, a corner is taken as behind the camera.
+       */
+      float constexpr min_w = 1e-5f;
+
+      /**
+       * @brief Whether a corner is closer than the near plane, where the 
+       * GPU clips it. Vulkan clips at z = 0 whichever depth range the
+       * projection was made for, so z in [-w, 0) of a GLM projection 
+       * without GLM_FORCE_DEPTH_ZERO_TO_ONE is clipped as well.
+       */
+      bool is_before_near_plane( glm::vec4 const& clip ) noexcept
+      {
+         return clip.w <= min_w || clip.z < 0.0f;
+      }
+
+      /**
+       * @brief The offset of the center of each pixel of a row from the 
+       * first one.
+       */
+      alignas( 32 ) float constexpr lane_centers[8] = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f };
+
+      /**
+       * @brief A triangle reduced to the values of its edge functions and
+       * depth at the start of a row, and how much they change per pixel.
+       */
+      struct row_setup
+      {
+         float edge_step[3];
+         float edge_start[3];
+
+         float depth_step;
+         float depth_start;
+      }; // struct row_setup
+
+      /**
+       * @brief Keep the nearest of the depth of a triangle and of the 
+       * pixels of [first, last) inside of it, ops::width at a time.
+       *
+       * @param [in] p_row The row of the tile, starting at the pixel 0 of
+       * the tile.
+       * @param [in] first The first pixel, a multiple of ops::width.
+       */
+      template<typename ops>
+      void rasterize_row( 
+         float* p_row, 
+         std::uint32_t first, 
+         std::uint32_t last, 
+         row_setup const& setup 
+      ) noexcept
+      {
+         using type = typename ops::type;
+         using mask = typename ops::mask;
+
+         type const zero = ops::set1( 0.0f );
+         type const offsets = ops::load( lane_centers );
+
+         type const edge_step_0 = ops::set1( setup.edge_step[0] );
+         type const edge_step_1 = ops::set1( setup.edge_step[1] );
+         type const edge_step_2 = ops::set1( setup.edge_step[2] );
+         type const edge_start_0 = ops::set1( setup.edge_start[0] );
+         type const edge_start_1 = ops::set1( setup.edge_start[1] );
+         type const edge_start_2 = ops::set1( setup.edge_start[2] );
+
+         type const depth_step = ops::set1( setup.depth_step );
+         type const depth_start = ops::set1( setup.depth_start );
+
+         for( std::uint32_t x = first; x < last; x += ops::width )
+         {
+            type const center = ops::add( ops::set1( static_cast<float>( x ) ), offsets );
+
+            mask outside = ops::less( ops::mul_add( edge_step_0, center, edge_start_0 ), zero );
+            outside = ops::mask_or( outside, ops::less( ops::mul_add( edge_step_1, center, edge_start_1 ), zero ) );
+            outside = ops::mask_or( outside, ops::less( ops::mul_add( edge_step_2, center, edge_start_2 ), zero ) );
+
+            type const depth = ops::mul_add( depth_step, center, depth_start );
+            type const stored = ops::load( p_row + x );
+
+            ops::store( p_row + x, ops::select( outside, stored, ops::min( stored, depth ) ) );
+         }
+      }
+
+      /**
+       * @brief Check whether every pixel of [first, last) of a row is 
+       * nearer than a depth, ops::width at a time.
+       *
+       * @param [in] p_row The row of the tile, starting at the pixel 0 of
+       * the tile.
+       * @param [in] first The first pixel to check, which does not have
+       * to be a multiple of ops::width.
+       */
+      template<typename ops>
+      bool is_row_hidden( 
+         float const* p_row, 
+         std::uint32_t first, 
+         std::uint32_t last, 
+         float depth 
+      ) noexcept
+      {
+         using type = typename ops::type;
+         using mask = typename ops::mask;
+
+         type const offsets = ops::load( lane_centers );
+         type const begin = ops::set1( static_cast<float>( first ) );
+         type const end = ops::set1( static_cast<float>( last ) );
+         type const nearest = ops::set1( depth );
+
+         for( std::uint32_t x = first & ~( ops::width - 1 ); x < last; x += ops::width )
+         {
+            type const center = ops::add( ops::set1( static_cast<float>( x ) ), offsets );
+
+            mask const is_inside = ops::mask_and( ops::less( begin, center ), ops::less( center, end ) );
+            mask const is_hidden = ops::less( ops::load( p_row + x ), nearest );
+
+            if ( ( ops::get_bits( is_inside ) & ~ops::get_bits( is_hidden ) ) != 0 )
+            {
+               return false;
+            }
+         }
+
+         return true;
+      }
+
+      double get_milliseconds( std::chrono::steady_clock::time_point start ) noexcept
+      {
+         return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+      }
+   } // namespace
+
+   occlusion_buffer::occlusion_buffer( create_info_t const& create_info )
+      :
+      p_thread_pool( create_info.value( ).p_thread_pool ),
+      tiles_per_job( std::max( create_info.value( ).tiles_per_job, 1u ) ),
+      boxes_per_job( std::max( create_info.value( ).boxes_per_job, 1u ) ),
+      tile_count_x( ( std::max( create_info.value( ).width, 1u ) + tile_width - 1 ) / tile_width ),
+      tile_count_y( ( std::max( create_info.value( ).height, 1u ) + tile_height - 1 ) / tile_height )
+   {
+      width = tile_count_x * tile_width;
+      height = tile_count_y * tile_height;
+
+      bins.resize( tile_count_x * tile_count_y );
+      depth.resize( width * height, empty_depth );
+      tile_max_depth.resize( tile_count_x * tile_count_y, empty_depth );
+   }
+
+   void occlusion_buffer::begin_frame( glm::mat4 const& vp )
+   {
+      view_projection = vp;
+
+      triangles.clear( );
+      for( auto& bin : bins )
+      {
+         bin.clear( );
+      }
+
+      std::fill( depth.begin( ), depth.end( ), empty_depth );
+      std::fill( tile_max_depth.begin( ), tile_max_depth.end( ), empty_depth );
+
+      frame_stats = stats{ };
+   }
+
+   void occlusion_buffer::add_occluder( 
+      std::vector<glm::vec3> const& positions, 
+      std::vector<std::uint32_t> const& indices, 
+      glm::mat4 const& transform )
+   {
+      glm::mat4 const model_view_projection = view_projection * transform;
+
+      std::vector<glm::vec4> clip_positions;
+      clip_positions.reserve( positions.size( ) );
+      for( auto const& position : positions )
+      {
+         clip_positions.push_back( model_view_projection * glm::vec4( position, 1.0f ) );
+      }
+
+      float const screen_width = static_cast<float>( width );
+      float const screen_height = static_cast<float>( height );
+
+      ++frame_stats.occluder_count;
+
+      for( std::size_t i = 0; i + 2 < indices.size( ); i += 3 )
+      {
+         ++frame_stats.triangle_count;
+
+         glm::vec4 const& c_0 = clip_positions[indices[i]];
+         glm::vec4 const& c_1 = clip_positions[indices[i + 1]];
+         glm::vec4 const& c_2 = clip_positions[indices[i + 2]];
+
+         // What the GPU clips away hides nothing, and the corners that
+         // near the camera project far off the screen.
+         if ( is_before_near_plane( c_0 ) || is_before_near_plane( c_1 ) || is_before_near_plane( c_2 ) )
+         {
+            ++frame_stats.skipped_triangle_count;
+            continue;
+         }
+
+         glm::vec4 const* clip[3] = { &c_0, &c_1, &c_2 };
+
+         glm::vec3 v[3];
+         for( int c = 0; c < 3; ++c )
+         {
+            v[c] = glm::vec3( 
+               ( clip[c]->x / clip[c]->w * 0.5f + 0.5f ) * screen_width, 
+               ( clip[c]->y / clip[c]->w * 0.5f + 0.5f ) * screen_height, 
+               clip[c]->z / clip[c]->w 
+            );
+         }
+
+         float area = ( v[1].x - v[0].x ) * ( v[2].y - v[0].y ) - ( v[2].x - v[0].x ) * ( v[1].y - v[0].y );
+         if ( !( std::fabs( area ) > 0.0f ) )
+         {
+            ++frame_stats.skipped_triangle_count;
+            continue;
+         }
+
+         /* Occluders are drawn from both sides, so the corners are put 
+            in the order that makes the edge functions positive inside. */
+         if ( area < 0.0f )
+         {
+            std::swap( v[1], v[2] );
+            area = -area;
+         }
+
+         /* The pixels whose center is inside the bounds of the triangle. */
+         float const min_x = std::max( std::ceil( std::min( { v[0].x, v[1].x, v[2].x } ) - 0.5f ), 0.0f );
+         float const min_y = std::max( std::ceil( std::min( { v[0].y, v[1].y, v[2].y } ) - 0.5f ), 0.0f );
+         float const max_x = std::min( std::floor( std::max( { v[0].x, v[1].x, v[2].x } ) - 0.5f ), screen_width - 1.0f );
+         float const max_y = std::min( std::floor( std::max( { v[0].y, v[1].y, v[2].y } ) - 0.5f ), screen_height - 1.0f );
+
+         if ( !( min_x <= max_x && min_y <= max_y ) )
+         {
+            ++frame_stats.skipped_triangle_count;
+            continue;
+         }
+
+         screen_triangle triangle;
+         for( int e = 0; e < 3; ++e )
+         {
+            glm::vec3 const& from = v[( e + 1 ) % 3];
+            glm::vec3 const& to = v[( e + 2 ) % 3];
+
+            triangle.edge_a[e] = from.y - to.y;
+            triangle.edge_b[e] = to.x - from.x;
+            triangle.edge_c[e] = from.x * to.y - from.y * to.x;
+         }
+
+         triangle.depth_a = ( ( v[1].z - v[0].z ) * ( v[2].y - v[0].y ) - ( v[2].z - v[0].z ) * ( v[1].y - v[0].y ) ) / area;
+         triangle.depth_b = ( ( v[2].z - v[0].z ) * ( v[1].x - v[0].x ) - ( v[1].z - v[0].z ) * ( v[2].x - v[0].x ) ) / area;
+         triangle.depth_c = v[0].z - triangle.depth_a * v[0].x - triangle.depth_b * v[0].y;
+
+         triangle.min_x = static_cast<std::uint32_t>( min_x );
+         triangle.min_y = static_cast<std::uint32_t>( min_y );
+         triangle.max_x = static_cast<std::uint32_t>( max_x );
+         triangle.max_y = static_cast<std::uint32_t>( max_y );
+
+         auto const index = static_cast<std::uint32_t>( triangles.size( ) );
+         triangles.push_back( triangle );
+
+         for( std::uint32_t y = triangle.min_y / tile_height; y <= triangle.max_y / tile_height; ++y )
+         {
+            for( std::uint32_t x = triangle.min_x / tile_width; x <= triangle.max_x / tile_width; ++x )
+            {
+               bins[y * tile_count_x + x].push_back( index );
+            }
+         }
+      }
+   }
+
+   void occlusion_buffer::rasterize( )
+   {
+      auto const start = std::chrono::steady_clock::now( );
+
+      std::uint32_t const tile_count = tile_count_x * tile_count_y;
+      if ( p_thread_pool != nullptr && tile_count > tiles_per_job )
+      {
+         p_thread_pool->parallel_for( 0, tile_count, tiles_per_job, [this] ( std::size_t tile ) 
+         { 
+            rasterize_tile( static_cast<std::uint32_t>( tile ) ); 
+         } );
+      }
+      else
+      {
+         for( std::uint32_t tile = 0; tile < tile_count; ++tile )
+         {
+            rasterize_tile( tile );
+         }
+      }
+
+      frame_stats.rasterize_time += get_milliseconds( start );
+   }
+
+   void occlusion_buffer::rasterize_tile( std::uint32_t tile ) noexcept
+   {
+      std::uint32_t const tile_x = ( tile % tile_count_x ) * tile_width;
+      std::uint32_t const tile_y = ( tile / tile_count_x ) * tile_height;
+
+      float* p_tile = depth.data( ) + tile * tile_width * tile_height;
+
+      for( auto const index : bins[tile] )
+      {
+         auto const& triangle = triangles[index];
+
+         /* Rows start on a whole vector; the pixels before the triangle 
+            fail its edge functions. */
+         std::uint32_t const first_x = ( std::max( triangle.min_x, tile_x ) - tile_x ) & ~( raster_ops::width - 1 );
+         std::uint32_t const last_x = std::min( triangle.max_x + 1, tile_x + tile_width ) - tile_x;
+
+         std::uint32_t const first_y = std::max( triangle.min_y, tile_y ) - tile_y;
+         std::uint32_t const last_y = std::min( triangle.max_y + 1, tile_y + tile_height ) - tile_y;
+
+         /* The edge functions and the depth are moved to the origin of 
+            the tile, so that the rows are walked in tile pixels. */
+         row_setup setup;
+         setup.depth_step = triangle.depth_a;
+         for( int e = 0; e < 3; ++e )
+         {
+            setup.edge_step[e] = triangle.edge_a[e];
+         }
+
+         for( std::uint32_t y = first_y; y < last_y; ++y )
+         {
+            float const center_y = static_cast<float>( tile_y + y ) + 0.5f;
+            for( int e = 0; e < 3; ++e )
+            {
+               setup.edge_start[e] = triangle.edge_a[e] * static_cast<float>( tile_x ) + triangle.edge_b[e] * center_y + triangle.edge_c[e];
+            }
+
+            setup.depth_start = triangle.depth_a * static_cast<float>( tile_x ) + triangle.depth_b * center_y + triangle.depth_c;
+
+            rasterize_row<raster_ops>( p_tile + y * tile_width, first_x, last_x, setup );
+         }
+      }
+
+      tile_max_depth[tile] = *std::max_element( p_tile, p_tile + tile_width * tile_height );
+   }
+
+   bool occlusion_buffer::is_occluded( aabb const& box ) const noexcept
+   {
+      float const screen_width = static_cast<float>( width );
+      float const screen_height = static_cast<float>( height );
+
+      glm::vec2 screen_min = glm::vec2( std::numeric_limits<float>::max( ) );
+      glm::vec2 screen_max = glm::vec2( std::numeric_limits<float>::lowest( ) );
+      float nearest = std::numeric_limits<float>::max( );
+
+      for( std::uint32_t corner = 0; corner < 8; ++corner )
+      {
+         glm::vec4 const position = glm::vec4( 
+            ( corner & 1u ) ? box.max.x : box.min.x, 
+            ( corner & 2u ) ? box.max.y : box.min.y, 
+            ( corner & 4u ) ? box.max.z : box.min.z, 
+            1.0f 
+         );
+
+         glm::vec4 const clip = view_projection * position;
+         if ( is_before_near_plane( clip ) )
+         {
+            return false;
+         }
+
+         glm::vec2 const screen = glm::vec2( 
+            ( clip.x / clip.w * 0.5f + 0.5f ) * screen_width, 
+            ( clip.y / clip.w * 0.5f + 0.5f ) * screen_height 
+         );
+
+         screen_min = glm::min( screen_min, screen );
+         screen_max = glm::max( screen_max, screen );
+         nearest = std::min( nearest, clip.z / clip.w );
+      }
+
+      /* Every pixel the box touches, not only those whose center it 
+         covers. */
+      float const min_x = std::max( std::floor( screen_min.x ), 0.0f );
+      float const min_y = std::max( std::floor( screen_min.y ), 0.0f );
+      float const max_x = std::min( std::floor( screen_max.x ), screen_width - 1.0f );
+      float const max_y = std::min( std::floor( screen_max.y ), screen_height - 1.0f );
+
+      if ( !( min_x <= max_x && min_y <= max_y ) )
+      {
+         return false;
+      }
+
+      auto const first_x = static_cast<std::uint32_t>( min_x );
+      auto const first_y = static_cast<std::uint32_t>( min_y );
+      auto const last_x = static_cast<std::uint32_t>( max_x ) + 1;
+      auto const last_y = static_cast<std::uint32_t>( max_y ) + 1;
+
+      for( std::uint32_t tile_y = first_y / tile_height; tile_y <= ( last_y - 1 ) / tile_height; ++tile_y )
+      {
+         for( std::uint32_t tile_x = first_x / tile_width; tile_x <= ( last_x - 1 ) / tile_width; ++tile_x )
+         {
+            std::uint32_t const tile = tile_y * tile_count_x + tile_x;
+            if ( tile_max_depth[tile] < nearest )
+            {
+               continue;
+            }
+
+            std::uint32_t const origin_x = tile_x * tile_width;
+            std::uint32_t const origin_y = tile_y * tile_height;
+
+            std::uint32_t const row_first = std::max( first_x, origin_x ) - origin_x;
+            std::uint32_t const row_last = std::min( last_x, origin_x + tile_width ) - origin_x;
+
+            float const* p_tile = depth.data( ) + tile * tile_width * tile_height;
+            for( std::uint32_t y = std::max( first_y, origin_y ); y < std::min( last_y, origin_y + tile_height ); ++y )
+            {
+               if ( !is_row_hidden<raster_ops>( p_tile + ( y - origin_y ) * tile_width, row_first, row_last, nearest ) )
+               {
+                  return false;
+               }
+            }
+         }
+      }
+
+      return true;
+   }
+
+   void occlusion_buffer::cull( std::vector<aabb> const& boxes, std::vector<std::uint32_t>& visible )
+   {
+      auto const start = std::chrono::steady_clock::now( );
+
+      auto const box_count = static_cast<std::uint32_t>( boxes.size( ) );
+      std::uint32_t const job_count = ( box_count + boxes_per_job - 1 ) / boxes_per_job;
+
+      /* Each job writes its visible boxes at the start of its own range,
+         which are then packed. */
+      visible.resize( box_count );
+      std::vector<std::uint32_t> counts( job_count );
+
+      auto const cull_job = [&] ( std::size_t job ) 
+      {
+         std::uint32_t const first = static_cast<std::uint32_t>( job ) * boxes_per_job;
+         std::uint32_t const last = std::min( first + boxes_per_job, box_count );
+
+         std::uint32_t count = 0;
+         for( std::uint32_t i = first; i < last; ++i )
+         {
+            visible[first + count] = i;
+            count += is_occluded( boxes[i] ) ? 0u : 1u;
+         }
+
+         counts[job] = count;
+      };
+
+      if ( p_thread_pool != nullptr && job_count > 1 )
+      {
+         p_thread_pool->parallel_for( 0, job_count, 1, cull_job );
+      }
+      else
+      {
+         for( std::uint32_t job = 0; job < job_count; ++job )
+         {
+            cull_job( job );
+         }
+      }
+
+      std::uint32_t visible_count = 0;
+      for( std::uint32_t job = 0; job < job_count; ++job )
+      {
+         auto const src = visible.begin( ) + job * boxes_per_job;
+         std::copy( src, src + counts[job], visible.begin( ) + visible_count );
+
+         visible_count += counts[job];
+      }
+
+      visible.resize( visible_count );
+
+      frame_stats.tested_count += box_count;
+      frame_stats.culled_count += box_count - visible_count;
+      frame_stats.test_time += get_milliseconds( start );
+   }
+
+   float occlusion_buffer::get_depth( std::uint32_t x, std::uint32_t y ) const noexcept
+   {
+      std::uint32_t const tile = ( y / tile_height ) * tile_count_x + x / tile_width;
+
+      return depth[tile * tile_width * tile_height + ( y % tile_height ) * tile_width + x % tile_width];
+   }
+
+   std::uint32_t occlusion_buffer::get_width( ) const noexcept
+   {
+      return width;
+   }
+
+   std::uint32_t occlusion_buffer::get_height( ) const noexcept
+   {
+      return height;
+   }
+
+   occlusion_buffer::stats const& occlusion_buffer::get_stats( ) const noexcept
+   {
+      return frame_stats;
+   }
+} // namespace gfx
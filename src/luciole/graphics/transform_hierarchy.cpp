@@ -0,0 +1,673 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/transform_hierarchy.hpp>
+#include <luciole/utils/simd.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace gfx
+{
+   namespace
+   {
+      /**
+       * @brief The arrays of the hierarchy, as seen by the kernels.
+       */
+      struct transform_arrays
+      {
+         float const* p_position_x;
+         float const* p_position_y;
+         float const* p_position_z;
+
+         float const* p_rotation_x;
+         float const* p_rotation_y;
+         float const* p_rotation_z;
+         float const* p_rotation_w;
+
+         float const* p_scale_x;
+         float const* p_scale_y;
+         float const* p_scale_z;
+
+         std::uint32_t const* p_parent_world;
+         std::uint8_t* p_dirty;
+
+         std::array<float*, 12> world;
+      }; // struct transform_arrays
+
+      /**
+       * @brief Compute the world matrices of ops::width nodes from their 
+       * local transform and the world matrix of their parent.
+       */
+      template<typename ops>
+      void compose( transform_arrays const& arrays, std::uint32_t i ) noexcept
+      {
+         using type = typename ops::type;
+
+         type const x = ops::load( arrays.p_rotation_x + i );
+         type const y = ops::load( arrays.p_rotation_y + i );
+         type const z = ops::load( arrays.p_rotation_z + i );
+         type const w = ops::load( arrays.p_rotation_w + i );
+
+         type const x2 = ops::add( x, x );
+         type const y2 = ops::add( y, y );
+         type const z2 = ops::add( z, z );
+
+         type const xx = ops::mul( x, x2 );
+         type const yy = ops::mul( y, y2 );
+         type const zz = ops::mul( z, z2 );
+         type const xy = ops::mul( x, y2 );
+         type const xz = ops::mul( x, z2 );
+         type const yz = ops::mul( y, z2 );
+         type const wx = ops::mul( w, x2 );
+         type const wy = ops::mul( w, y2 );
+         type const wz = ops::mul( w, z2 );
+
+         type const one = ops::set1( 1.0f );
+         type const sx = ops::load( arrays.p_scale_x + i );
+         type const sy = ops::load( arrays.p_scale_y + i );
+         type const sz = ops::load( arrays.p_scale_z + i );
+
+         /* The local matrix, the rotation scaled along its columns. */
+         type const local[3][4] = 
+         {
+            { 
+               ops::mul( ops::sub( one, ops::add( yy, zz ) ), sx ), 
+               ops::mul( ops::sub( xy, wz ), sy ), 
+               ops::mul( ops::add( xz, wy ), sz ), 
+               ops::load( arrays.p_position_x + i ) 
+            },
+            { 
+               ops::mul( ops::add( xy, wz ), sx ), 
+               ops::mul( ops::sub( one, ops::add( xx, zz ) ), sy ), 
+               ops::mul( ops::sub( yz, wx ), sz ), 
+               ops::load( arrays.p_position_y + i ) 
+            },
+            { 
+               ops::mul( ops::sub( xz, wy ), sx ), 
+               ops::mul( ops::add( yz, wx ), sy ), 
+               ops::mul( ops::sub( one, ops::add( xx, yy ) ), sz ), 
+               ops::load( arrays.p_position_z + i ) 
+            }
+         };
+
+         std::uint32_t const* p_parent = arrays.p_parent_world + i;
+
+         for( std::uint32_t row = 0; row < 3; ++row )
+         {
+            type const p0 = ops::gather( arrays.world[row * 4 + 0], p_parent );
+            type const p1 = ops::gather( arrays.world[row * 4 + 1], p_parent );
+            type const p2 = ops::gather( arrays.world[row * 4 + 2], p_parent );
+            type const p3 = ops::gather( arrays.world[row * 4 + 3], p_parent );
+
+            for( std::uint32_t column = 0; column < 4; ++column )
+            {
+               type value = ops::mul_add( p2, local[2][column], column == 3 ? p3 : ops::set1( 0.0f ) );
+               value = ops::mul_add( p1, local[1][column], value );
+               value = ops::mul_add( p0, local[0][column], value );
+
+               ops::store( arrays.world[row * 4 + column] + i + 1, value );
+            }
+         }
+      }
+
+      /**
+       * @brief Compose the dirty nodes of [first, last) ops::width at a
+       * time, skipping the batches where no node is dirty.
+       *
+       * @return The first node left, less than ops::width before last.
+       */
+      template<typename ops>
+      std::uint32_t compose_range( transform_arrays const& arrays, std::uint32_t first, std::uint32_t last ) noexcept
+      {
+         for( ; first + ops::width <= last; first += ops::width )
+         {
+            std::uint8_t const* p_dirty = arrays.p_dirty + first;
+
+            if ( std::any_of( p_dirty, p_dirty + ops::width, [] ( std::uint8_t d ) { return d != 0; } ) )
+            {
+               compose<ops>( arrays, first );
+            }
+         }
+
+         return first;
+      }
+
+      template<typename T>
+      void permute( std::vector<T>& values, std::vector<std::uint32_t> const& sources, std::uint32_t offset )
+      {
+         std::vector<T> sorted( values.size( ) );
+         std::copy_n( values.begin( ), offset, sorted.begin( ) );
+
+         for( std::size_t i = 0; i < sources.size( ); ++i )
+         {
+            sorted[i + offset] = values[sources[i] + offset];
+         }
+
+         values.swap( sorted );
+      }
+
+      template<typename T>
+      void move_back( std::vector<T>& values, std::size_t to )
+      {
+         values[to] = values.back( );
+         values.pop_back( );
+      }
+   } // namespace
+
+   transform_hierarchy::transform_hierarchy( create_info_t const& create_info ) 
+      :
+      p_thread_pool( create_info.value( ).p_thread_pool ),
+      min_nodes_per_group( std::max( create_info.value( ).min_nodes_per_group, 1u ) )
+   { }
+
+   transform_hierarchy::node transform_hierarchy::create( node parent )
+   {
+      if ( parent != null_node )
+      {
+         check_alive( parent );
+      }
+
+      std::uint32_t const parent_index = parent == null_node ? npos : parent.index;
+
+      if ( world[0].empty( ) )
+      {
+         for( std::size_t i = 0; i < world.size( ); ++i )
+         {
+            world[i].push_back( i % 5 == 0 ? 1.0f : 0.0f );
+         }
+      }
+
+      std::uint32_t index = 0;
+      if ( free_slots.empty( ) )
+      {
+         index = static_cast<std::uint32_t>( slots.size( ) );
+         slots.emplace_back( );
+      }
+      else
+      {
+         index = free_slots.back( );
+         free_slots.pop_back( );
+      }
+
+      slots[index].dense = static_cast<std::uint32_t>( handles.size( ) );
+      handles.push_back( index );
+
+      position_x.push_back( 0.0f );
+      position_y.push_back( 0.0f );
+      position_z.push_back( 0.0f );
+
+      rotation_x.push_back( 0.0f );
+      rotation_y.push_back( 0.0f );
+      rotation_z.push_back( 0.0f );
+      rotation_w.push_back( 1.0f );
+
+      scale_x.push_back( 1.0f );
+      scale_y.push_back( 1.0f );
+      scale_z.push_back( 1.0f );
+
+      dirty.push_back( 1 );
+      parent_world.push_back( 0 );
+
+      for( std::size_t i = 0; i < world.size( ); ++i )
+      {
+         world[i].push_back( i % 5 == 0 ? 1.0f : 0.0f );
+      }
+
+      link( index, parent_index );
+      is_layout_dirty = true;
+
+      return node{ index, slots[index].generation };
+   }
+
+   void transform_hierarchy::destroy( node n )
+   {
+      check_alive( n );
+
+      unlink( n.index );
+
+      std::vector<std::uint32_t> stack = { n.index };
+      while( !stack.empty( ) )
+      {
+         std::uint32_t const index = stack.back( );
+         stack.pop_back( );
+
+         auto& s = slots[index];
+         for( std::uint32_t child = s.first_child; child != npos; child = slots[child].next_sibling )
+         {
+            stack.push_back( child );
+         }
+
+         erase_dense( s.dense );
+
+         s = slot{ .generation = s.generation + 1 };
+         free_slots.push_back( index );
+      }
+
+      is_layout_dirty = true;
+   }
+
+   void transform_hierarchy::set_parent( node n, node parent )
+   {
+      std::uint32_t const dense = get_dense( n );
+      std::uint32_t parent_index = npos;
+
+      if ( parent != null_node )
+      {
+         check_alive( parent );
+
+         for( std::uint32_t i = parent.index; i != npos; i = slots[i].parent )
+         {
+            if ( i == n.index )
+            {
+               throw std::runtime_error{ "A transform cannot be moved under itself or one of its descendants." };
+            }
+         }
+
+         parent_index = parent.index;
+      }
+
+      unlink( n.index );
+      link( n.index, parent_index );
+
+      dirty[dense] = 1;
+      is_layout_dirty = true;
+   }
+
+   void transform_hierarchy::set_position( node n, glm::vec3 const& position )
+   {
+      std::uint32_t const dense = get_dense( n );
+
+      position_x[dense] = position.x;
+      position_y[dense] = position.y;
+      position_z[dense] = position.z;
+      dirty[dense] = 1;
+   }
+
+   void transform_hierarchy::set_rotation( node n, glm::quat const& rotation )
+   {
+      std::uint32_t const dense = get_dense( n );
+
+      rotation_x[dense] = rotation.x;
+      rotation_y[dense] = rotation.y;
+      rotation_z[dense] = rotation.z;
+      rotation_w[dense] = rotation.w;
+      dirty[dense] = 1;
+   }
+
+   void transform_hierarchy::set_scale( node n, glm::vec3 const& scale )
+   {
+      std::uint32_t const dense = get_dense( n );
+
+      scale_x[dense] = scale.x;
+      scale_y[dense] = scale.y;
+      scale_z[dense] = scale.z;
+      dirty[dense] = 1;
+   }
+
+   void transform_hierarchy::set_local( node n, glm::vec3 const& position, glm::quat const& rotation, glm::vec3 const& scale )
+   {
+      set_position( n, position );
+      set_rotation( n, rotation );
+      set_scale( n, scale );
+   }
+
+   void transform_hierarchy::update( )
+   {
+      if ( is_layout_dirty )
+      {
+         rebuild( );
+         is_layout_dirty = false;
+      }
+
+      if ( p_thread_pool != nullptr && groups.size( ) > 1 )
+      {
+         std::atomic<std::uint32_t> count = 0;
+         p_thread_pool->parallel_for( 0, groups.size( ), 1, [this, &count] ( std::size_t i ) 
+         {
+            count.fetch_add( update_group( groups[i] ), std::memory_order_relaxed );
+         } );
+
+         updated_count = count.load( std::memory_order_relaxed );
+      }
+      else
+      {
+         updated_count = 0;
+         for( auto const& g : groups )
+         {
+            updated_count += update_group( g );
+         }
+      }
+   }
+
+   bool transform_hierarchy::is_alive( node n ) const noexcept
+   {
+      return n.index < slots.size( ) && slots[n.index].generation == n.generation && slots[n.index].dense != npos;
+   }
+
+   transform_hierarchy::node transform_hierarchy::get_parent( node n ) const
+   {
+      check_alive( n );
+
+      std::uint32_t const parent = slots[n.index].parent;
+      return parent == npos ? null_node : node{ parent, slots[parent].generation };
+   }
+
+   glm::vec3 transform_hierarchy::get_position( node n ) const
+   {
+      std::uint32_t const dense = get_dense( n );
+      return glm::vec3( position_x[dense], position_y[dense], position_z[dense] );
+   }
+
+   glm::quat transform_hierarchy::get_rotation( node n ) const
+   {
+      std::uint32_t const dense = get_dense( n );
+      return glm::quat( rotation_w[dense], rotation_x[dense], rotation_y[dense], rotation_z[dense] );
+   }
+
+   glm::vec3 transform_hierarchy::get_scale( node n ) const
+   {
+      std::uint32_t const dense = get_dense( n );
+      return glm::vec3( scale_x[dense], scale_y[dense], scale_z[dense] );
+   }
+
+   glm::mat4 transform_hierarchy::get_world_matrix( node n ) const
+   {
+      std::uint32_t const i = get_dense( n ) + 1;
+
+      glm::mat4 res( 1.0f );
+      for( std::uint32_t row = 0; row < 3; ++row )
+      {
+         for( std::uint32_t column = 0; column < 4; ++column )
+         {
+            res[column][row] = world[row * 4 + column][i];
+         }
+      }
+
+      return res;
+   }
+
+   std::uint32_t transform_hierarchy::get_node_count( ) const noexcept
+   {
+      return static_cast<std::uint32_t>( handles.size( ) );
+   }
+
+   std::uint32_t transform_hierarchy::get_updated_count( ) const noexcept
+   {
+      return updated_count;
+   }
+
+   void transform_hierarchy::check_alive( node n ) const
+   {
+      if ( !is_alive( n ) )
+      {
+         throw std::runtime_error{ "Use of a destroyed transform." };
+      }
+   }
+
+   std::uint32_t transform_hierarchy::get_dense( node n ) const
+   {
+      check_alive( n );
+
+      return slots[n.index].dense;
+   }
+
+   void transform_hierarchy::link( std::uint32_t index, std::uint32_t parent )
+   {
+      auto& s = slots[index];
+      s.parent = parent;
+
+      if ( parent != npos )
+      {
+         s.next_sibling = slots[parent].first_child;
+         if ( s.next_sibling != npos )
+         {
+            slots[s.next_sibling].prev_sibling = index;
+         }
+
+         slots[parent].first_child = index;
+      }
+   }
+
+   void transform_hierarchy::unlink( std::uint32_t index )
+   {
+      auto& s = slots[index];
+
+      if ( s.prev_sibling != npos )
+      {
+         slots[s.prev_sibling].next_sibling = s.next_sibling;
+      }
+      else if ( s.parent != npos )
+      {
+         slots[s.parent].first_child = s.next_sibling;
+      }
+
+      if ( s.next_sibling != npos )
+      {
+         slots[s.next_sibling].prev_sibling = s.prev_sibling;
+      }
+
+      s.parent = npos;
+      s.next_sibling = npos;
+      s.prev_sibling = npos;
+   }
+
+   void transform_hierarchy::erase_dense( std::uint32_t dense )
+   {
+      slots[handles.back( )].dense = dense;
+
+      move_back( handles, dense );
+
+      move_back( position_x, dense );
+      move_back( position_y, dense );
+      move_back( position_z, dense );
+
+      move_back( rotation_x, dense );
+      move_back( rotation_y, dense );
+      move_back( rotation_z, dense );
+      move_back( rotation_w, dense );
+
+      move_back( scale_x, dense );
+      move_back( scale_y, dense );
+      move_back( scale_z, dense );
+
+      move_back( dirty, dense );
+      move_back( parent_world, dense );
+
+      for( auto& values : world )
+      {
+         move_back( values, dense + 1 );
+      }
+   }
+
+   void transform_hierarchy::rebuild( )
+   {
+      std::vector<std::uint32_t> order;
+      order.reserve( handles.size( ) );
+
+      levels.clear( );
+      groups.clear( );
+
+      std::vector<std::uint32_t> stack;
+      auto const get_subtree_size = [this, &stack] ( std::uint32_t root )
+      {
+         std::uint32_t size = 0;
+
+         stack.push_back( root );
+         while( !stack.empty( ) )
+         {
+            std::uint32_t const index = stack.back( );
+            stack.pop_back( );
+
+            ++size;
+            for( std::uint32_t child = slots[index].first_child; child != npos; child = slots[child].next_sibling )
+            {
+               stack.push_back( child );
+            }
+         }
+
+         return size;
+      };
+
+      std::vector<std::uint32_t> frontier;
+      std::vector<std::uint32_t> next;
+
+      std::uint32_t root = 0;
+      while( root < slots.size( ) )
+      {
+         std::uint32_t group_size = 0;
+         for( ; root < slots.size( ) && group_size < min_nodes_per_group; ++root )
+         {
+            if ( slots[root].dense != npos && slots[root].parent == npos )
+            {
+               frontier.push_back( root );
+               group_size += get_subtree_size( root );
+            }
+         }
+
+         if ( frontier.empty( ) )
+         {
+            break;
+         }
+
+         group g;
+         g.first_level = static_cast<std::uint32_t>( levels.size( ) );
+
+         while( !frontier.empty( ) )
+         {
+            levels.push_back( level{ 
+               static_cast<std::uint32_t>( order.size( ) ), 
+               static_cast<std::uint32_t>( order.size( ) + frontier.size( ) ) 
+            } );
+
+            next.clear( );
+            for( std::uint32_t const index : frontier )
+            {
+               order.push_back( index );
+
+               for( std::uint32_t child = slots[index].first_child; child != npos; child = slots[child].next_sibling )
+               {
+                  next.push_back( child );
+               }
+            }
+
+            frontier.swap( next );
+         }
+
+         g.last_level = static_cast<std::uint32_t>( levels.size( ) );
+         groups.push_back( g );
+      }
+
+      std::vector<std::uint32_t> sources( order.size( ) );
+      for( std::size_t i = 0; i < order.size( ); ++i )
+      {
+         sources[i] = slots[order[i]].dense;
+      }
+
+      permute( position_x, sources, 0 );
+      permute( position_y, sources, 0 );
+      permute( position_z, sources, 0 );
+
+      permute( rotation_x, sources, 0 );
+      permute( rotation_y, sources, 0 );
+      permute( rotation_z, sources, 0 );
+      permute( rotation_w, sources, 0 );
+
+      permute( scale_x, sources, 0 );
+      permute( scale_y, sources, 0 );
+      permute( scale_z, sources, 0 );
+
+      permute( dirty, sources, 0 );
+
+      for( auto& values : world )
+      {
+         permute( values, sources, 1 );
+      }
+
+      handles = order;
+      for( std::size_t i = 0; i < order.size( ); ++i )
+      {
+         slots[order[i]].dense = static_cast<std::uint32_t>( i );
+      }
+
+      for( std::size_t i = 0; i < order.size( ); ++i )
+      {
+         std::uint32_t const parent = slots[order[i]].parent;
+         parent_world[i] = parent == npos ? 0 : slots[parent].dense + 1;
+      }
+   }
+
+   std::uint32_t transform_hierarchy::update_group( group const& g ) noexcept
+   {
+      transform_arrays arrays
+      {
+         .p_position_x = position_x.data( ),
+         .p_position_y = position_y.data( ),
+         .p_position_z = position_z.data( ),
+         .p_rotation_x = rotation_x.data( ),
+         .p_rotation_y = rotation_y.data( ),
+         .p_rotation_z = rotation_z.data( ),
+         .p_rotation_w = rotation_w.data( ),
+         .p_scale_x = scale_x.data( ),
+         .p_scale_y = scale_y.data( ),
+         .p_scale_z = scale_z.data( ),
+         .p_parent_world = parent_world.data( ),
+         .p_dirty = dirty.data( ),
+         .world = { }
+      };
+
+      for( std::size_t i = 0; i < world.size( ); ++i )
+      {
+         arrays.world[i] = world[i].data( );
+      }
+
+      std::uint32_t count = 0;
+      for( std::uint32_t l = g.first_level; l < g.last_level; ++l )
+      {
+         auto const [first, last] = levels[l];
+
+         /* The parents are one level up, their flags are final. */
+         for( std::uint32_t i = first; i < last; ++i )
+         {
+            if ( parent_world[i] != 0 )
+            {
+               dirty[i] |= dirty[parent_world[i] - 1];
+            }
+
+            count += dirty[i];
+         }
+
+         std::uint32_t i = first;
+#if defined( LUCIOLE_SIMD_AVX2 )
+         i = compose_range<simd::avx2_ops>( arrays, i, last );
+#endif
+#if defined( LUCIOLE_SIMD_SSE2 )
+         i = compose_range<simd::sse2_ops>( arrays, i, last );
+#endif
+         compose_range<simd::scalar_ops>( arrays, i, last );
+      }
+
+      if ( g.first_level != g.last_level )
+      {
+         std::fill( dirty.begin( ) + levels[g.first_level].first, dirty.begin( ) + levels[g.last_level - 1].last, 0 );
+      }
+
+      return count;
+   }
+} // namespace gfx
@@ -0,0 +1,205 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/vertex_encoding.hpp>
+
+#include <glm/gtc/packing.hpp>
+
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#  include <emmintrin.h>
+#  define LUCIOLE_VERTEX_ENCODING_SSE2
+#endif
+
+#if defined( __F16C__ )
+#  include <immintrin.h>
+#  define LUCIOLE_VERTEX_ENCODING_F16C
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+namespace gfx
+{
+   namespace
+   {
+#if defined( LUCIOLE_VERTEX_ENCODING_SSE2 )
+      /**
+       * @brief Clamp four floats and scale them to the integer range,
+       * rounding to nearest.
+       */
+      inline __m128i scale_and_round( float const* p_src, float lo, float hi, float scale ) noexcept
+      {
+         __m128 value = _mm_loadu_ps( p_src );
+         value = _mm_min_ps( _mm_max_ps( value, _mm_set1_ps( lo ) ), _mm_set1_ps( hi ) );
+
+         return _mm_cvtps_epi32( _mm_mul_ps( value, _mm_set1_ps( scale ) ) );
+      }
+#endif
+   } // namespace
+
+   void encode_half( float const* p_src, std::uint16_t* p_dst, std::size_t count ) noexcept
+   {
+      std::size_t i = 0;
+
+#if defined( LUCIOLE_VERTEX_ENCODING_F16C )
+      for( ; i + 8 <= count; i += 8 )
+      {
+         __m128i const half = _mm256_cvtps_ph( _mm256_loadu_ps( p_src + i ), _MM_FROUND_TO_NEAREST_INT );
+         _mm_storeu_si128( reinterpret_cast<__m128i*>( p_dst + i ), half );
+      }
+#endif
+
+      for( ; i < count; ++i )
+      {
+         p_dst[i] = glm::packHalf1x16( p_src[i] );
+      }
+   }
+
+   void encode_snorm8( float const* p_src, std::int8_t* p_dst, std::size_t count ) noexcept
+   {
+      std::size_t i = 0;
+
+#if defined( LUCIOLE_VERTEX_ENCODING_SSE2 )
+      for( ; i + 16 <= count; i += 16 )
+      {
+         __m128i const a = scale_and_round( p_src + i, -1.0f, 1.0f, 127.0f );
+         __m128i const b = scale_and_round( p_src + i + 4, -1.0f, 1.0f, 127.0f );
+         __m128i const c = scale_and_round( p_src + i + 8, -1.0f, 1.0f, 127.0f );
+         __m128i const d = scale_and_round( p_src + i + 12, -1.0f, 1.0f, 127.0f );
+
+         __m128i const packed = _mm_packs_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) );
+         _mm_storeu_si128( reinterpret_cast<__m128i*>( p_dst + i ), packed );
+      }
+#endif
+
+      for( ; i < count; ++i )
+      {
+         p_dst[i] = static_cast<std::int8_t>( glm::packSnorm1x8( p_src[i] ) );
+      }
+   }
+
+   void encode_snorm16( float const* p_src, std::int16_t* p_dst, std::size_t count ) noexcept
+   {
+      std::size_t i = 0;
+
+#if defined( LUCIOLE_VERTEX_ENCODING_SSE2 )
+      for( ; i + 8 <= count; i += 8 )
+      {
+         __m128i const a = scale_and_round( p_src + i, -1.0f, 1.0f, 32767.0f );
+         __m128i const b = scale_and_round( p_src + i + 4, -1.0f, 1.0f, 32767.0f );
+
+         _mm_storeu_si128( reinterpret_cast<__m128i*>( p_dst + i ), _mm_packs_epi32( a, b ) );
+      }
+#endif
+
+      for( ; i < count; ++i )
+      {
+         p_dst[i] = static_cast<std::int16_t>( glm::packSnorm1x16( p_src[i] ) );
+      }
+   }
+
+   void encode_unorm8( float const* p_src, std::uint8_t* p_dst, std::size_t count ) noexcept
+   {
+      std::size_t i = 0;
+
+#if defined( LUCIOLE_VERTEX_ENCODING_SSE2 )
+      for( ; i + 16 <= count; i += 16 )
+      {
+         __m128i const a = scale_and_round( p_src + i, 0.0f, 1.0f, 255.0f );
+         __m128i const b = scale_and_round( p_src + i + 4, 0.0f, 1.0f, 255.0f );
+         __m128i const c = scale_and_round( p_src + i + 8, 0.0f, 1.0f, 255.0f );
+         __m128i const d = scale_and_round( p_src + i + 12, 0.0f, 1.0f, 255.0f );
+
+         __m128i const packed = _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) );
+         _mm_storeu_si128( reinterpret_cast<__m128i*>( p_dst + i ), packed );
+      }
+#endif
+
+      for( ; i < count; ++i )
+      {
+         p_dst[i] = glm::packUnorm1x8( p_src[i] );
+      }
+   }
+
+   void encode_unorm16( float const* p_src, std::uint16_t* p_dst, std::size_t count ) noexcept
+   {
+      std::size_t i = 0;
+
+#if defined( LUCIOLE_VERTEX_ENCODING_SSE2 )
+      for( ; i + 8 <= count; i += 8 )
+      {
+         /* SSE2 has no unsigned 32 to 16 bit pack, bias into the signed range and back. */
+         __m128i const bias32 = _mm_set1_epi32( 32768 );
+         __m128i const bias16 = _mm_set1_epi16( static_cast<short>( 0x8000 ) );
+
+         __m128i const a = _mm_sub_epi32( scale_and_round( p_src + i, 0.0f, 1.0f, 65535.0f ), bias32 );
+         __m128i const b = _mm_sub_epi32( scale_and_round( p_src + i + 4, 0.0f, 1.0f, 65535.0f ), bias32 );
+
+         __m128i const packed = _mm_xor_si128( _mm_packs_epi32( a, b ), bias16 );
+         _mm_storeu_si128( reinterpret_cast<__m128i*>( p_dst + i ), packed );
+      }
+#endif
+
+      for( ; i < count; ++i )
+      {
+         p_dst[i] = glm::packUnorm1x16( p_src[i] );
+      }
+   }
+
+   void encode_octahedral( glm::vec3 const* p_src, glm::vec2* p_dst, std::size_t count ) noexcept
+   {
+      for( std::size_t i = 0; i < count; ++i )
+      {
+         glm::vec3 const n = p_src[i] / ( std::abs( p_src[i].x ) + std::abs( p_src[i].y ) + std::abs( p_src[i].z ) );
+
+         if ( n.z >= 0.0f )
+         {
+            p_dst[i] = glm::vec2( n.x, n.y );
+         }
+         else
+         {
+            p_dst[i] = glm::vec2(
+               ( 1.0f - std::abs( n.y ) ) * ( n.x >= 0.0f ? 1.0f : -1.0f ),
+               ( 1.0f - std::abs( n.x ) ) * ( n.y >= 0.0f ? 1.0f : -1.0f )
+            );
+         }
+      }
+   }
+
+   void encode_packed_tangent( glm::vec4 const* p_src, std::uint32_t* p_dst, std::size_t count ) noexcept
+   {
+      for( std::size_t i = 0; i < count; ++i )
+      {
+         p_dst[i] = glm::packSnorm3x10_1x2( glm::vec4(
+            glm::vec3( p_src[i] ),
+            p_src[i].w < 0.0f ? -1.0f : 1.0f
+         ) );
+      }
+   }
+
+   glm::vec3 decode_octahedral( glm::vec2 const& encoded ) noexcept
+   {
+      glm::vec3 n( encoded.x, encoded.y, 1.0f - std::abs( encoded.x ) - std::abs( encoded.y ) );
+
+      float const t = std::max( -n.z, 0.0f );
+      n.x += n.x >= 0.0f ? -t : t;
+      n.y += n.y >= 0.0f ? -t : t;
+
+      return glm::normalize( n );
+   }
+} // namespace gfx
@@ -0,0 +1,114 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/sys/command_buffer.hpp>
+
+#include <algorithm>
+
+namespace sys
+{
+   command_buffer::~command_buffer( )
+   {
+      clear( );
+   }
+
+   command_buffer& command_buffer::operator=( command_buffer&& rhs ) noexcept
+   {
+      if ( this != &rhs )
+      {
+         clear( );
+
+         commands = std::move( rhs.commands );
+         rhs.commands.clear( );
+         pending_count = std::exchange( rhs.pending_count, 0 );
+
+         blocks = std::move( rhs.blocks );
+         block_index = std::exchange( rhs.block_index, 0 );
+         block_offset = std::exchange( rhs.block_offset, 0 );
+      }
+
+      return *this;
+   }
+
+   entity command_buffer::create( )
+   {
+      entity const e{ pending_count, pending_generation };
+      commands.push_back( command{ command_type::e_create, e, nullptr, nullptr } );
+      
+      ++pending_count;
+
+      return e;
+   }
+
+   void command_buffer::destroy( entity e )
+   {
+      commands.push_back( command{ command_type::e_destroy, e, nullptr, nullptr } );
+   }
+
+   void command_buffer::clear( ) noexcept
+   {
+      for( auto& command : commands )
+      {
+         if ( command.p_component != nullptr )
+         {
+            command.p_info->destroy( command.p_component );
+            command.p_component = nullptr;
+         }
+      }
+
+      commands.clear( );
+      pending_count = 0;
+
+      // The blocks are kept for the next frame's commands.
+      block_index = 0;
+      block_offset = 0;
+   }
+
+   bool command_buffer::is_empty( ) const noexcept
+   {
+      return commands.empty( );
+   }
+
+   void* command_buffer::allocate( std::size_t size, std::size_t alignment )
+   {
+      while( true )
+      {
+         if ( block_index < blocks.size( ) )
+         {
+            auto const& current = blocks[block_index];
+
+            auto const base = reinterpret_cast<std::uintptr_t>( current.p_data.get( ) );
+            auto const aligned = ( base + block_offset + alignment - 1 ) / alignment * alignment;
+
+            if ( aligned + size <= base + current.size )
+            {
+               block_offset = aligned + size - base;
+               return reinterpret_cast<void*>( aligned );
+            }
+
+            ++block_index;
+            block_offset = 0;
+
+            continue;
+         }
+
+         std::size_t const block_size = std::max( chunk_size, size + alignment );
+         blocks.push_back( block{ std::unique_ptr<std::byte[]>( new std::byte[block_size] ), block_size } );
+      }
+   }
+} // namespace sys
@@ -0,0 +1,359 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/sys/scheduler.hpp>
+
+#include <algorithm>
+
+namespace sys
+{
+   namespace
+   {
+      bool intersects( std::vector<component_id> const& lhs, std::vector<component_id> const& rhs ) noexcept
+      {
+         return std::any_of( lhs.cbegin( ), lhs.cend( ), [&rhs] ( component_id id ) 
+         { 
+            return std::find( rhs.cbegin( ), rhs.cend( ), id ) != rhs.cend( ); 
+         } );
+      }
+   } // namespace
+
+   scheduler::scheduler( create_info_t const& create_info )
+      :
+      p_thread_pool( create_info.value( ).p_thread_pool ),
+      max_jobs_per_system( create_info.value( ).max_jobs_per_system ),
+      is_tracing_enabled( create_info.value( ).is_tracing_enabled )
+   {
+      if ( max_jobs_per_system == 0 )
+      {
+         max_jobs_per_system = p_thread_pool != nullptr ? p_thread_pool->get_thread_count( ) * 4 : 1;
+      }
+   }
+
+   void scheduler::add_exclusive_system( std::string name, delegate<void( world& )> const& f )
+   {
+      system s;
+      s.name = std::move( name );
+      s.is_exclusive = true;
+      s.run_exclusive = f;
+
+      link_system( std::move( s ) );
+   }
+
+   void scheduler::run( world& w )
+   {
+      frame_start = std::chrono::steady_clock::now( );
+      trace.clear( );
+
+      std::size_t first = 0;
+      while( first < systems.size( ) )
+      {
+         if ( systems[first].is_exclusive )
+         {
+            run_exclusive( w, first );
+            ++first;
+
+            continue;
+         }
+
+         std::size_t last = first;
+         while( last < systems.size( ) && !systems[last].is_exclusive )
+         {
+            ++last;
+         }
+
+         run_phase( w, first, last );
+         first = last;
+      }
+
+      if ( is_tracing_enabled )
+      {
+         std::sort( trace.begin( ), trace.end( ), [] ( trace_event const& lhs, trace_event const& rhs ) 
+         { 
+            return lhs.begin < rhs.begin; 
+         } );
+      }
+   }
+
+   std::size_t scheduler::get_system_count( ) const noexcept
+   {
+      return systems.size( );
+   }
+
+   std::string const& scheduler::get_system_name( std::size_t system ) const noexcept
+   {
+      return systems[system].name;
+   }
+
+   std::vector<std::uint32_t> const& scheduler::get_dependencies( std::size_t system ) const noexcept
+   {
+      return systems[system].dependencies;
+   }
+
+   std::vector<scheduler::trace_event> const& scheduler::get_trace( ) const noexcept
+   {
+      return trace;
+   }
+
+   nlohmann::json scheduler::get_chrome_trace( ) const
+   {
+      auto events = nlohmann::json::array( );
+      for( auto const& event : trace )
+      {
+         events.push_back( nlohmann::json
+         {
+            { "name", systems[event.system].name },
+            { "cat", systems[event.system].is_exclusive ? "exclusive" : "system" },
+            { "ph", "X" },
+            { "ts", std::chrono::duration<double, std::micro>( event.begin ).count( ) },
+            { "dur", std::chrono::duration<double, std::micro>( event.end - event.begin ).count( ) },
+            { "pid", 0 },
+            { "tid", event.thread },
+            { "args", { { "chunks", event.chunk_count } } }
+         } );
+      }
+
+      return nlohmann::json{ { "traceEvents", events }, { "displayTimeUnit", "ms" } };
+   }
+
+   void scheduler::link_system( system&& s )
+   {
+      auto const index = static_cast<std::uint32_t>( systems.size( ) );
+
+      if ( !s.is_exclusive )
+      {
+         // Systems before the last exclusive one are done by the time it
+         // runs, so there is no need to wait on them.
+         for( auto i = index; i > 0 && !systems[i - 1].is_exclusive; --i )
+         {
+            auto& other = systems[i - 1];
+
+            if ( intersects( s.writes, other.writes ) || intersects( s.writes, other.reads ) || intersects( s.reads, other.writes ) )
+            {
+               s.dependencies.push_back( i - 1 );
+               other.dependents.push_back( index );
+            }
+         }
+
+         std::reverse( s.dependencies.begin( ), s.dependencies.end( ) );
+      }
+
+      systems.push_back( std::move( s ) );
+      states.push_back( std::make_unique<system_state>( ) );
+   }
+
+   void scheduler::run_phase( world& w, std::size_t first, std::size_t last )
+   {
+      /* Gather the chunks of every system before any of them starts, the
+         world's query cache is not thread safe. */
+      for( std::size_t i = first; i < last; ++i )
+      {
+         auto& state = *states[i];
+
+         state.chunks.clear( );
+         for( archetype* p_archetype : systems[i].match( w ) )
+         {
+            for( std::size_t chunk = 0; chunk < p_archetype->get_chunk_count( ); ++chunk )
+            {
+               state.chunks.push_back( chunk_ref{ p_archetype, chunk } );
+            }
+         }
+
+         std::size_t const job_count = std::min<std::size_t>( state.chunks.size( ), max_jobs_per_system );
+
+         state.jobs.clear( );
+         for( std::size_t j = 0; j < job_count; ++j )
+         {
+            std::size_t const begin = state.chunks.size( ) * j / job_count;
+            std::size_t const end = state.chunks.size( ) * ( j + 1 ) / job_count;
+
+            state.jobs.push_back( job{ begin, end - begin } );
+         }
+
+         if ( state.command_buffers.size( ) < job_count )
+         {
+            state.command_buffers.resize( job_count );
+         }
+
+         state.trace.resize( job_count );
+         state.remaining_jobs.store( job_count, std::memory_order_relaxed );
+         state.remaining_dependencies.store( systems[i].dependencies.size( ), std::memory_order_relaxed );
+      }
+
+      if ( p_thread_pool == nullptr )
+      {
+         for( std::size_t i = first; i < last; ++i )
+         {
+            for( std::size_t j = 0; j < states[i]->jobs.size( ); ++j )
+            {
+               run_job( i, j );
+            }
+         }
+      }
+      else
+      {
+         remaining_systems.store( last - first, std::memory_order_release );
+
+         for( std::size_t i = first; i < last; ++i )
+         {
+            if ( systems[i].dependencies.empty( ) )
+            {
+               start_system( i );
+            }
+         }
+
+         p_thread_pool->run_until( [this] { return remaining_systems.load( std::memory_order_acquire ) == 0; } );
+      }
+
+      if ( is_tracing_enabled )
+      {
+         for( std::size_t i = first; i < last; ++i )
+         {
+            trace.insert( trace.end( ), states[i]->trace.cbegin( ), states[i]->trace.cend( ) );
+         }
+      }
+
+      if ( p_exception )
+      {
+         for( std::size_t i = first; i < last; ++i )
+         {
+            for( auto& commands : states[i]->command_buffers )
+            {
+               commands.clear( );
+            }
+         }
+
+         std::rethrow_exception( std::exchange( p_exception, nullptr ) );
+      }
+
+      for( std::size_t i = first; i < last; ++i )
+      {
+         for( auto& commands : states[i]->command_buffers )
+         {
+            if ( !commands.is_empty( ) )
+            {
+               w.execute( commands );
+            }
+         }
+      }
+   }
+
+   void scheduler::run_exclusive( world& w, std::size_t index )
+   {
+      auto const begin = std::chrono::steady_clock::now( );
+      
+      systems[index].run_exclusive( w );
+
+      if ( is_tracing_enabled )
+      {
+         trace.push_back( trace_event
+         {
+            .system = static_cast<std::uint32_t>( index ),
+            .thread = 0,
+            .chunk_count = 0,
+            .begin = begin - frame_start,
+            .end = std::chrono::steady_clock::now( ) - frame_start
+         } );
+      }
+   }
+
+   void scheduler::start_system( std::size_t index )
+   {
+      auto& state = *states[index];
+      if ( state.jobs.empty( ) )
+      {
+         finish_system( index );
+         return;
+      }
+
+      for( std::size_t j = 0; j < state.jobs.size( ); ++j )
+      {
+         p_thread_pool->add_task( [this, index, j] 
+         {
+            run_job( index, j );
+
+            if ( states[index]->remaining_jobs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+            {
+               finish_system( index );
+            }
+         } );
+      }
+   }
+
+   void scheduler::finish_system( std::size_t index )
+   {
+      for( auto const dependent : systems[index].dependents )
+      {
+         if ( states[dependent]->remaining_dependencies.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+         {
+            start_system( dependent );
+         }
+      }
+
+      remaining_systems.fetch_sub( 1, std::memory_order_acq_rel );
+   }
+
+   void scheduler::run_job( std::size_t index, std::size_t job_index )
+   {
+      auto& state = *states[index];
+      auto const& current = state.jobs[job_index];
+      auto& commands = state.command_buffers[job_index];
+
+      auto const begin = std::chrono::steady_clock::now( );
+
+      try
+      {
+         for( std::size_t i = current.first_chunk; i < current.first_chunk + current.chunk_count; ++i )
+         {
+            systems[index].run_chunk( *state.chunks[i].p_archetype, state.chunks[i].chunk, commands );
+         }
+      }
+      catch( ... )
+      {
+         std::scoped_lock lock( exception_mutex );
+         if ( !p_exception )
+         {
+            p_exception = std::current_exception( );
+         }
+      }
+
+      if ( is_tracing_enabled )
+      {
+         state.trace[job_index] = trace_event
+         {
+            .system = static_cast<std::uint32_t>( index ),
+            .thread = get_thread_index( ),
+            .chunk_count = static_cast<std::uint32_t>( current.chunk_count ),
+            .begin = begin - frame_start,
+            .end = std::chrono::steady_clock::now( ) - frame_start
+         };
+      }
+   }
+
+   std::uint32_t scheduler::get_thread_index( ) const noexcept
+   {
+      if ( p_thread_pool == nullptr )
+      {
+         return 0;
+      }
+
+      auto const index = p_thread_pool->get_worker_index( );
+
+      return index ? *index + 1 : 0;
+   }
+} // namespace sys
@@ -0,0 +1,579 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/sys/world.hpp>
+#include <luciole/sys/command_buffer.hpp>
+
+#include <algorithm>
+
+namespace sys
+{
+   namespace
+   {
+      constexpr std::size_t align_up( std::size_t value, std::size_t alignment ) noexcept
+      {
+         return ( value + alignment - 1 ) / alignment * alignment;
+      }
+
+      std::vector<component_id> get_ids( std::vector<component_info const*> const& components )
+      {
+         std::vector<component_id> ids;
+         ids.reserve( components.size( ) );
+         for( auto const* p_info : components )
+         {
+            ids.push_back( p_info->id );
+         }
+
+         return ids;
+      }
+   } // namespace
+
+   archetype::archetype( std::vector<component_info const*> components_in )
+      :
+      components( std::move( components_in ) ),
+      offsets( components.size( ), 0 )
+   {
+      std::size_t row_size = sizeof( entity );
+      for( auto const* p_info : components )
+      {
+         row_size += p_info->size;
+      }
+
+      // Every array starts on a cache line, so they can be read with
+      // aligned vector loads.
+      std::size_t capacity = chunk_size / row_size;
+      for( ; capacity > 0; --capacity )
+      {
+         std::size_t offset = sizeof( entity ) * capacity;
+         for( std::size_t i = 0; i < components.size( ); ++i )
+         {
+            offset = align_up( offset, std::max( components[i]->alignment, cache_line ) );
+            offsets[i] = offset;
+            offset += components[i]->size * capacity;
+         }
+
+         if ( offset <= chunk_size )
+         {
+            break;
+         }
+      }
+
+      if ( capacity == 0 )
+      {
+         throw std::runtime_error{ "Archetype components do not fit in a chunk." };
+      }
+
+      chunk_capacity = static_cast<std::uint32_t>( capacity );
+   }
+
+   archetype::~archetype( )
+   {
+      for( std::uint32_t row = 0; row < entity_count; ++row )
+      {
+         for( std::size_t column = 0; column < components.size( ); ++column )
+         {
+            components[column]->destroy( get_component( row, column ) );
+         }
+      }
+   }
+
+   std::size_t archetype::find_column( component_id id ) const noexcept
+   {
+      auto const it = std::lower_bound( 
+         components.cbegin( ), components.cend( ), id, 
+         [] ( component_info const* p_info, component_id value ) { return p_info->id < value; } 
+      );
+
+      if ( it == components.cend( ) || ( *it )->id != id )
+      {
+         return npos;
+      }
+
+      return static_cast<std::size_t>( it - components.cbegin( ) );
+   }
+
+   std::vector<component_info const*> const& archetype::get_components( ) const noexcept
+   {
+      return components;
+   }
+
+   std::uint32_t archetype::get_entity_count( ) const noexcept
+   {
+      return entity_count;
+   }
+
+   std::uint32_t archetype::get_chunk_capacity( ) const noexcept
+   {
+      return chunk_capacity;
+   }
+
+   std::size_t archetype::get_chunk_count( ) const noexcept
+   {
+      return ( entity_count + chunk_capacity - 1 ) / chunk_capacity;
+   }
+
+   std::uint32_t archetype::get_chunk_entity_count( std::size_t chunk ) const noexcept
+   {
+      return std::min( chunk_capacity, entity_count - static_cast<std::uint32_t>( chunk ) * chunk_capacity );
+   }
+
+   entity const* archetype::get_entities( std::size_t chunk ) const noexcept
+   {
+      return std::launder( reinterpret_cast<entity const*>( chunks[chunk]->data ) );
+   }
+
+   void* archetype::get_column( std::size_t chunk, std::size_t column ) const noexcept
+   {
+      return chunks[chunk]->data + offsets[column];
+   }
+
+   void* archetype::get_component( std::uint32_t row, std::size_t column ) const noexcept
+   {
+      auto const chunk = row / chunk_capacity;
+      auto const index = row % chunk_capacity;
+
+      return chunks[chunk]->data + offsets[column] + index * components[column]->size;
+   }
+
+   std::uint32_t archetype::allocate_row( entity e )
+   {
+      if ( entity_count == chunks.size( ) * chunk_capacity )
+      {
+         // Not value initialized, the rows are written before being read.
+         chunks.push_back( std::unique_ptr<chunk>( new chunk ) );
+      }
+
+      auto const row = entity_count;
+      new( chunks[row / chunk_capacity]->data + ( row % chunk_capacity ) * sizeof( entity ) ) entity( e );
+      
+      ++entity_count;
+
+      return row;
+   }
+
+   entity archetype::remove_row( std::uint32_t row, bool destroy_components ) noexcept
+   {
+      if ( destroy_components )
+      {
+         for( std::size_t column = 0; column < components.size( ); ++column )
+         {
+            components[column]->destroy( get_component( row, column ) );
+         }
+      }
+
+      auto const last = entity_count - 1;
+      auto moved = null_entity;
+
+      if ( row != last )
+      {
+         for( std::size_t column = 0; column < components.size( ); ++column )
+         {
+            components[column]->relocate( get_component( row, column ), get_component( last, column ) );
+         }
+
+         auto* p_entities = chunks[row / chunk_capacity]->data;
+         auto const* p_last_entities = chunks[last / chunk_capacity]->data;
+
+         moved = *std::launder( reinterpret_cast<entity const*>( p_last_entities + ( last % chunk_capacity ) * sizeof( entity ) ) );
+         new( p_entities + ( row % chunk_capacity ) * sizeof( entity ) ) entity( moved );
+      }
+
+      --entity_count;
+
+      // Keep one empty chunk around, so an entity moving back and forth
+      // across a chunk boundary does not allocate every time.
+      if ( chunks.size( ) > get_chunk_count( ) + 1 )
+      {
+         chunks.pop_back( );
+      }
+
+      return moved;
+   }
+
+   world::world( )
+   {
+      p_empty_archetype = find_archetype( { } );
+   }
+
+   void world::destroy( entity e )
+   {
+      check_structural_change( );
+
+      if ( !is_alive( e ) )
+      {
+         return;
+      }
+
+      free_indices.reserve( free_indices.size( ) + 1 );
+
+      auto& record = records[e.index];
+      auto const moved = record.p_archetype->remove_row( record.row, true );
+      if ( moved != null_entity )
+      {
+         records[moved.index].row = record.row;
+      }
+
+      record.p_archetype = nullptr;
+      record.row = 0;
+
+      // The generation of pending entities is never handed out.
+      if ( ++record.generation == command_buffer::pending_generation )
+      {
+         record.generation = 0;
+      }
+
+      free_indices.push_back( e.index );
+      --entity_count;
+   }
+
+   bool world::is_alive( entity e ) const noexcept
+   {
+      return 
+         e.index < records.size( ) && 
+         records[e.index].generation == e.generation && 
+         records[e.index].p_archetype != nullptr;
+   }
+
+   void world::execute( command_buffer& buffer )
+   {
+      check_structural_change( );
+
+      using command_type = command_buffer::command_type;
+
+      std::vector<entity> created( buffer.pending_count, null_entity );
+      auto const resolve = [&created] ( entity e ) 
+      { 
+         return command_buffer::is_pending( e ) ? created[e.index] : e; 
+      };
+
+      std::vector<component_info const*> components;
+      auto& commands = buffer.commands;
+
+      try
+      {
+         for( std::size_t i = 0; i < commands.size( ); ++i )
+         {
+            auto& command = commands[i];
+
+            switch( command.type )
+            {
+               case command_type::e_create:
+               {
+                  // Gather the components added right after the creation,
+                  // to place the entity in its final archetype at once.
+                  components.clear( );
+
+                  std::size_t last = i + 1;
+                  while( 
+                     last < commands.size( ) && 
+                     commands[last].type == command_type::e_add && 
+                     commands[last].target == command.target )
+                  {
+                     auto const* p_info = commands[last].p_info;
+                     
+                     bool const is_duplicate = std::any_of( components.cbegin( ), components.cend( ), 
+                        [p_info] ( component_info const* p_other ) { return p_other->id == p_info->id; } 
+                     );
+
+                     if ( is_duplicate )
+                     {
+                        break;
+                     }
+
+                     components.push_back( p_info );
+                     ++last;
+                  }
+
+                  auto* p_archetype = components.empty( ) ? p_empty_archetype : find_archetype( components );
+                  auto const e = create_entity( p_archetype );
+                  auto const row = records[e.index].row;
+
+                  created[command.target.index] = e;
+
+                  for( std::size_t j = i + 1; j < last; ++j )
+                  {
+                     auto& add = commands[j];
+                     auto const column = p_archetype->find_column( add.p_info->id );
+
+                     add.p_info->relocate( p_archetype->get_component( row, column ), add.p_component );
+                     add.p_component = nullptr;
+                  }
+
+                  i = last - 1;
+
+                  break;
+               }
+               case command_type::e_destroy:
+               {
+                  destroy( resolve( command.target ) );
+                  break;
+               }
+               case command_type::e_add:
+               {
+                  auto const target = resolve( command.target );
+                  if ( command.p_component != nullptr && is_alive( target ) )
+                  {
+                     auto const [p_storage, is_new] = add_component( target, *command.p_info );
+                     if ( !is_new )
+                     {
+                        command.p_info->destroy( p_storage );
+                     }
+
+                     command.p_info->relocate( p_storage, command.p_component );
+                     command.p_component = nullptr;
+                  }
+
+                  break;
+               }
+               case command_type::e_remove:
+               {
+                  remove_component( resolve( command.target ), command.p_info->id );
+                  break;
+               }
+            }
+         }
+      }
+      catch( ... )
+      {
+         buffer.clear( );
+         throw;
+      }
+
+      buffer.clear( );
+   }
+
+   std::uint32_t world::get_entity_count( ) const noexcept
+   {
+      return entity_count;
+   }
+
+   std::size_t world::get_archetype_count( ) const noexcept
+   {
+      return archetypes.size( );
+   }
+
+   std::vector<archetype*> const& world::match_archetypes( std::vector<component_id> ids )
+   {
+      std::sort( ids.begin( ), ids.end( ) );
+
+      std::uint64_t key = ids.size( );
+      for( auto const id : ids )
+      {
+         key = ( key ^ id ) * 0x9e3779b97f4a7c15ull;
+      }
+
+      // Probe past the unlikely queries with the same key.
+      auto it = query_caches.find( key );
+      while( it != query_caches.end( ) && it->second.ids != ids )
+      {
+         it = query_caches.find( ++key );
+      }
+
+      if ( it == query_caches.end( ) )
+      {
+         query_cache cache;
+         cache.ids = std::move( ids );
+
+         it = query_caches.emplace( key, std::move( cache ) ).first;
+      }
+
+      auto& cache = it->second;
+      for( ; cache.checked_count < archetypes.size( ); ++cache.checked_count )
+      {
+         auto* p_archetype = archetypes[cache.checked_count].get( );
+
+         bool const has_all = std::all_of( cache.ids.cbegin( ), cache.ids.cend( ), 
+            [p_archetype] ( component_id id ) { return p_archetype->find_column( id ) != archetype::npos; } 
+         );
+
+         if ( has_all )
+         {
+            cache.archetypes.push_back( p_archetype );
+         }
+      }
+
+      return cache.archetypes;
+   }
+
+   archetype* world::find_archetype( std::vector<component_info const*> components )
+   {
+      std::sort( components.begin( ), components.end( ), 
+         [] ( component_info const* p_lhs, component_info const* p_rhs ) { return p_lhs->id < p_rhs->id; } 
+      );
+
+      auto ids = get_ids( components );
+      if ( auto const it = archetype_lookup.find( ids ); it != archetype_lookup.end( ) )
+      {
+         return it->second;
+      }
+
+      archetypes.push_back( std::make_unique<archetype>( std::move( components ) ) );
+      auto* p_archetype = archetypes.back( ).get( );
+
+      archetype_lookup.emplace( std::move( ids ), p_archetype );
+
+      return p_archetype;
+   }
+
+   archetype* world::find_add_target( archetype* p_source, component_info const& info )
+   {
+      if ( auto const it = p_source->add_edges.find( info.id ); it != p_source->add_edges.end( ) )
+      {
+         return it->second;
+      }
+
+      auto components = p_source->components;
+      components.push_back( &info );
+
+      auto* p_target = find_archetype( std::move( components ) );
+      p_source->add_edges.emplace( info.id, p_target );
+      p_target->remove_edges.emplace( info.id, p_source );
+
+      return p_target;
+   }
+
+   archetype* world::find_remove_target( archetype* p_source, component_id id )
+   {
+      if ( auto const it = p_source->remove_edges.find( id ); it != p_source->remove_edges.end( ) )
+      {
+         return it->second;
+      }
+
+      auto components = p_source->components;
+      components.erase( components.begin( ) + static_cast<std::ptrdiff_t>( p_source->find_column( id ) ) );
+
+      auto* p_target = find_archetype( std::move( components ) );
+      p_source->remove_edges.emplace( id, p_target );
+      p_target->add_edges.emplace( id, p_source );
+
+      return p_target;
+   }
+
+   entity world::create_entity( archetype* p_archetype )
+   {
+      if ( free_indices.empty( ) )
+      {
+         records.emplace_back( );
+         free_indices.push_back( static_cast<std::uint32_t>( records.size( ) - 1 ) );
+      }
+
+      auto const index = free_indices.back( );
+      auto& record = records[index];
+      
+      entity const e{ index, record.generation };
+      record.row = p_archetype->allocate_row( e );
+      record.p_archetype = p_archetype;
+      
+      free_indices.pop_back( );
+      ++entity_count;
+
+      return e;
+   }
+
+   void world::move_entity( entity e, archetype* p_target )
+   {
+      auto& record = records[e.index];
+      auto* p_source = record.p_archetype;
+
+      auto const row = p_target->allocate_row( e );
+
+      for( std::size_t column = 0; column < p_source->components.size( ); ++column )
+      {
+         auto const* p_info = p_source->components[column];
+         auto const target_column = p_target->find_column( p_info->id );
+
+         if ( target_column != archetype::npos )
+         {
+            p_info->relocate( p_target->get_component( row, target_column ), p_source->get_component( record.row, column ) );
+         }
+         else
+         {
+            p_info->destroy( p_source->get_component( record.row, column ) );
+         }
+      }
+
+      auto const moved = p_source->remove_row( record.row, false );
+      if ( moved != null_entity )
+      {
+         records[moved.index].row = record.row;
+      }
+
+      record.p_archetype = p_target;
+      record.row = row;
+   }
+
+   std::pair<void*, bool> world::add_component( entity e, component_info const& info )
+   {
+      if ( !is_alive( e ) )
+      {
+         throw std::runtime_error{ "Cannot add a component to an entity that is not alive." };
+      }
+
+      auto& record = records[e.index];
+      if ( auto const column = record.p_archetype->find_column( info.id ); column != archetype::npos )
+      {
+         return { record.p_archetype->get_component( record.row, column ), false };
+      }
+
+      auto* p_target = find_add_target( record.p_archetype, info );
+      move_entity( e, p_target );
+
+      return { p_target->get_component( record.row, p_target->find_column( info.id ) ), true };
+   }
+
+   void world::remove_component( entity e, component_id id )
+   {
+      if ( !is_alive( e ) )
+      {
+         return;
+      }
+
+      auto& record = records[e.index];
+      if ( record.p_archetype->find_column( id ) == archetype::npos )
+      {
+         return;
+      }
+
+      move_entity( e, find_remove_target( record.p_archetype, id ) );
+   }
+
+   void* world::find_component( entity e, component_id id ) const noexcept
+   {
+      if ( !is_alive( e ) )
+      {
+         return nullptr;
+      }
+
+      auto const& record = records[e.index];
+      auto const column = record.p_archetype->find_column( id );
+      if ( column == archetype::npos )
+      {
+         return nullptr;
+      }
+
+      return record.p_archetype->get_component( record.row, column );
+   }
+
+   void world::check_structural_change( ) const
+   {
+      if ( iteration_depth != 0 )
+      {
+         throw std::runtime_error{ "Structural changes are not allowed while iterating, use a command_buffer." };
+      }
+   }
+} // namespace sys
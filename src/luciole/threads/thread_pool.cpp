@@ -17,3 +17,169 @@
  */
 
 #include <luciole/threads/thread_pool.hpp>
+
+namespace
+{
+   thread_local thread_pool const* p_current_pool = nullptr;
+   thread_local std::size_t current_queue = 0;
+} // namespace
+
+thread_pool::thread_pool( std::uint32_t thread_count )
+{
+   thread_count = std::max( thread_count, 1u );
+
+   task_queues_.reserve( thread_count );
+   for( std::uint32_t i = 0; i < thread_count; ++i )
+   {
+      task_queues_.push_back( std::make_unique<task_queue>( ) );
+   }
+
+   threads_.reserve( thread_count );
+   for( std::uint32_t i = 0; i < thread_count; ++i )
+   {
+      threads_.emplace_back( &thread_pool::work, this, i );
+   }
+}
+
+thread_pool::~thread_pool( )
+{
+   {
+      std::scoped_lock lock( wake_mutex_ );
+      is_running_ = false;
+   }
+
+   wake_condition_.notify_all( );
+
+   for( auto& thread : threads_ )
+   {
+      if ( thread.joinable( ) )
+      {
+         thread.join( );
+      }
+   }
+}
+
+void thread_pool::add_task( task const& t )
+{
+   std::size_t const index = ( p_current_pool == this ) ? 
+      current_queue : 
+      next_queue_.fetch_add( 1, std::memory_order_relaxed ) % task_queues_.size( );
+
+   pending_count_.fetch_add( 1, std::memory_order_relaxed );
+
+   {
+      std::scoped_lock lock( task_queues_[index]->mutex );
+      task_queues_[index]->tasks.push_back( t );
+   }
+
+   {
+      std::scoped_lock lock( wake_mutex_ );
+   }
+
+   wake_condition_.notify_one( );
+}
+
+void thread_pool::wait_idle( )
+{
+   while( pending_count_.load( std::memory_order_acquire ) != 0 )
+   {
+      if ( !run_pending_task( ) )
+      {
+         std::unique_lock lock( wake_mutex_ );
+         idle_condition_.wait_for( lock, std::chrono::milliseconds( 1 ), [this] 
+         {
+            return pending_count_.load( std::memory_order_acquire ) == 0;
+         } );
+      }
+   }
+}
+
+std::uint32_t thread_pool::get_thread_count( ) const noexcept
+{
+   return static_cast<std::uint32_t>( threads_.size( ) );
+}
+
+std::optional<std::uint32_t> thread_pool::get_worker_index( ) const noexcept
+{
+   if ( p_current_pool != this )
+   {
+      return std::nullopt;
+   }
+
+   return static_cast<std::uint32_t>( current_queue );
+}
+
+bool thread_pool::try_pop( std::size_t index, task& t )
+{
+   /* Own queue first, newest task for locality. */
+   {
+      auto& queue = *task_queues_[index];
+
+      std::scoped_lock lock( queue.mutex );
+      if ( !queue.tasks.empty( ) )
+      {
+         t = std::move( queue.tasks.back( ) );
+         queue.tasks.pop_back( );
+
+         return true;
+      }
+   }
+
+   /* Steal the oldest task of another queue. */
+   for( std::size_t i = 1; i < task_queues_.size( ); ++i )
+   {
+      auto& queue = *task_queues_[( index + i ) % task_queues_.size( )];
+
+      std::unique_lock lock( queue.mutex, std::try_to_lock );
+      if ( lock.owns_lock( ) && !queue.tasks.empty( ) )
+      {
+         t = std::move( queue.tasks.front( ) );
+         queue.tasks.pop_front( );
+
+         return true;
+      }
+   }
+
+   return false;
+}
+
+bool thread_pool::run_pending_task( )
+{
+   std::size_t const index = ( p_current_pool == this ) ? current_queue : 0;
+
+   task t;
+   if ( !try_pop( index, t ) )
+   {
+      return false;
+   }
+
+   t( );
+
+   if ( pending_count_.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+   {
+      std::scoped_lock lock( wake_mutex_ );
+      idle_condition_.notify_all( );
+   }
+
+   return true;
+}
+
+void thread_pool::work( std::size_t index )
+{
+   p_current_pool = this;
+   current_queue = index;
+
+   while( is_running_ )
+   {
+      if ( run_pending_task( ) )
+      {
+         continue;
+      }
+
+      std::unique_lock lock( wake_mutex_ );
+      wake_condition_.wait_for( lock, std::chrono::milliseconds( 1 ), [this] 
+      {
+         return !is_running_ || pending_count_.load( std::memory_order_acquire ) != 0;
+      } );
+   }
+}
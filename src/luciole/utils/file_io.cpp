@@ -0,0 +1,163 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/utils/file_io.hpp>
+
+#include <stdexcept>
+#include <string>
+
+#if defined( _WIN32 )
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+mapped_file::mapped_file( std::string const& filepath )
+{
+#if defined( _WIN32 )
+   file_handle = CreateFileA( 
+      filepath.c_str( ), GENERIC_READ, FILE_SHARE_READ, nullptr, 
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr 
+   );
+
+   if ( file_handle == INVALID_HANDLE_VALUE )
+   {
+      file_handle = nullptr;
+
+      throw std::runtime_error{ "Error loading file at location: " + filepath + "." };
+   }
+
+   LARGE_INTEGER file_size;
+   GetFileSizeEx( file_handle, &file_size );
+   data_size = static_cast<std::size_t>( file_size.QuadPart );
+
+   if ( data_size == 0 )
+   {
+      close( );
+
+      throw std::runtime_error{ "Error mapping empty file: " + filepath + "." };
+   }
+
+   mapping_handle = CreateFileMappingA( file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+   if ( mapping_handle != nullptr )
+   {
+      p_data = static_cast<std::byte const*>( MapViewOfFile( mapping_handle, FILE_MAP_READ, 0, 0, 0 ) );
+   }
+#else
+   int const fd = open( filepath.c_str( ), O_RDONLY );
+   if ( fd == -1 )
+   {
+      throw std::runtime_error{ "Error loading file at location: " + filepath + "." };
+   }
+
+   struct stat file_stat;
+   if ( fstat( fd, &file_stat ) == -1 || file_stat.st_size == 0 )
+   {
+      ::close( fd );
+
+      throw std::runtime_error{ "Error mapping empty file: " + filepath + "." };
+   }
+
+   data_size = static_cast<std::size_t>( file_stat.st_size );
+
+   void* p_mapping = mmap( nullptr, data_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   ::close( fd );
+
+   if ( p_mapping != MAP_FAILED )
+   {
+      madvise( p_mapping, data_size, MADV_WILLNEED );
+
+      p_data = static_cast<std::byte const*>( p_mapping );
+   }
+#endif
+
+   if ( p_data == nullptr )
+   {
+      close( );
+
+      throw std::runtime_error{ "Error mapping file: " + filepath + "." };
+   }
+}
+
+mapped_file::mapped_file( mapped_file&& rhs ) noexcept
+{
+   *this = std::move( rhs );
+}
+
+mapped_file::~mapped_file( )
+{
+   close( );
+}
+
+mapped_file& mapped_file::operator=( mapped_file&& rhs ) noexcept
+{
+   if ( this != &rhs )
+   {
+      close( );
+
+      p_data = rhs.p_data;
+      rhs.p_data = nullptr;
+
+      data_size = rhs.data_size;
+      rhs.data_size = 0;
+
+#if defined( _WIN32 )
+      file_handle = rhs.file_handle;
+      rhs.file_handle = nullptr;
+
+      mapping_handle = rhs.mapping_handle;
+      rhs.mapping_handle = nullptr;
+#endif
+   }
+
+   return *this;
+}
+
+void mapped_file::close( ) noexcept
+{
+#if defined( _WIN32 )
+   if ( p_data != nullptr )
+   {
+      UnmapViewOfFile( p_data );
+   }
+
+   if ( mapping_handle != nullptr )
+   {
+      CloseHandle( mapping_handle );
+      mapping_handle = nullptr;
+   }
+
+   if ( file_handle != nullptr )
+   {
+      CloseHandle( file_handle );
+      file_handle = nullptr;
+   }
+#else
+   if ( p_data != nullptr )
+   {
+      munmap( const_cast<std::byte*>( p_data ), data_size );
+   }
+#endif
+
+   p_data = nullptr;
+   data_size = 0;
+}
@@ -16,155 +16,89 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <luciole/graphics/mesh_optimizer.hpp>
 #include <luciole/vk/buffers/index_buffer.hpp>
 
+#include <algorithm>
+
 namespace vk
 {
    index_buffer::index_buffer( index_buffer::create_info_t const& create_info )
       :
-      memory_allocator( create_info.value( ).p_context->get_memory_allocator( ) ),
-      allocation( VK_NULL_HANDLE ),
-      buffer( VK_NULL_HANDLE )
+      p_context( create_info.value( ).p_context ),
+      buffer( ),
+      index_type( VK_INDEX_TYPE_UINT32 ),
+      index_count( static_cast<std::uint32_t>( create_info.value( ).indices.size( ) ) )
    {
-      auto const buffer_size =
-         create_info.value( ).indices.size( ) *
-         sizeof( create_info.value( ).indices[0] );
+      auto const& indices = create_info.value( ).indices;
 
-      /* STAGING BUFFER */
-      VkBuffer staging_buffer = VK_NULL_HANDLE;
-      VmaAllocation staging_memory = VK_NULL_HANDLE; 
+      std::uint32_t const vertex_count = indices.empty( ) ? 0 : *std::max_element( indices.cbegin( ), indices.cend( ) ) + 1;
 
-      VkBufferCreateInfo const staging_create_info
+      std::vector<std::uint16_t> short_indices;
+      if ( gfx::fits_16_bit_indices( vertex_count ) )
       {
-         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-         .pNext = nullptr,
-         .flags = 0,
-         .size = buffer_size,
-         .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-         .sharingMode = VK_SHARING_MODE_CONCURRENT,
-         .queueFamilyIndexCount = static_cast<std::uint32_t>(
-            create_info.value( ).family_indices.size( )
-         ),
-         .pQueueFamilyIndices = create_info.value( ).family_indices.data( )
-      };
+         index_type = VK_INDEX_TYPE_UINT16;
+         short_indices.assign( indices.cbegin( ), indices.cend( ) );
+      }
 
-      VmaAllocationCreateInfo staging_alloc_info = { };
-      staging_alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+      void const* p_data = index_type == VK_INDEX_TYPE_UINT16 ? 
+         static_cast<void const*>( short_indices.data( ) ) : 
+         static_cast<void const*>( indices.data( ) );
 
-      vmaCreateBuffer(
-         memory_allocator,
-         &staging_create_info,
-         &staging_alloc_info,
-         &staging_buffer,
-         &staging_memory,
-         nullptr
-      );
+      VkDeviceSize const buffer_size = index_type == VK_INDEX_TYPE_UINT16 ? 
+         short_indices.size( ) * sizeof( std::uint16_t ) : 
+         indices.size( ) * sizeof( std::uint32_t );
 
-      /* MAP THE MEMORY INTO THE STAGING BUFFER */
-      void* data;
-      vmaMapMemory( memory_allocator, staging_memory, &data );
-      memcpy(
-         data,
-         create_info.value( ).indices.data( ),
-         buffer_size
-      );
-      vmaUnmapMemory( memory_allocator, staging_memory );
-
-      /* INDEX BUFFER */
-      VkBufferCreateInfo const index_create_info
+      VkBufferCreateInfo const buffer_create_info
       {
          .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
          .pNext = nullptr,
          .flags = 0,
          .size = buffer_size,
          .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-         .sharingMode = VK_SHARING_MODE_CONCURRENT, 
-         .queueFamilyIndexCount = static_cast<std::uint32_t>(
-            create_info.value( ).family_indices.size( )
-         ),
-         .pQueueFamilyIndices = create_info.value( ).family_indices.data( )
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr
       };
 
-      VmaAllocationCreateInfo index_alloc_info = { };
-      index_alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+      VmaAllocationCreateInfo allocation_info = { };
+      allocation_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
-      vmaCreateBuffer(
-         memory_allocator,
-         &index_create_info,
-         &index_alloc_info,
-         &buffer,
-         &allocation,
-         nullptr
+      auto temp_buffer = p_context->create_buffer(
+         buffer_create_info_t( buffer_create_info ),
+         allocation_create_info_t( allocation_info ),
+         memory_category::e_index_buffer
       );
 
-      /* CREATE COMMAND BUFFER */
-      VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
-
-      auto temp_cmd_buffer = create_info.value( ).p_context->create_command_buffers(
-         queue::flag_t( queue::flag::e_transfer ),
-         count32_t( 1 )
-      );
-
-      if ( auto const* p_val = 
-            std::get_if<std::vector<VkCommandBuffer>>( &temp_cmd_buffer ) )
+      if ( auto const* p_val = std::get_if<buffer_allocation>( &temp_buffer ) )
       {
-         cmd_buffer = (*p_val)[0];
+         buffer = *p_val;
       }
       else
       {
-         
-         abort();
+         abort( );
       }
 
-      VkCommandBufferBeginInfo const begin_info
+      staging_upload_info const upload_info
       {
-         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-         .pNext = nullptr,
-         .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-         .pInheritanceInfo = nullptr
+         .p_context = p_context,
+         .p_buffer = &buffer,
+         .p_data = p_data,
+         .size = buffer_size,
+         .dst_queue = queue::flag::e_graphics,
+         .dst_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+         .dst_access = VK_ACCESS_INDEX_READ_BIT
       };
 
-      vkBeginCommandBuffer( cmd_buffer, &begin_info );
-
-      VkBufferCopy const copy_region
+      auto temp_ownership = upload_through_staging( staging_upload_info_t( upload_info ) );
+      if ( auto const* p_val = std::get_if<queue_ownership>( &temp_ownership ) )
       {
-         .srcOffset = VkDeviceSize( 0 ),
-         .dstOffset = VkDeviceSize( 0 ),
-         .size = VkDeviceSize( buffer_size )
-      };
-
-      vkCmdCopyBuffer(
-         cmd_buffer,
-         staging_buffer, buffer,
-         1,&copy_region
-      );
-
-      vkEndCommandBuffer( cmd_buffer );
-
-      VkSubmitInfo const submit_info
+         ownership = *p_val;
+      }
+      else
       {
-         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-         .pNext = nullptr,
-         .waitSemaphoreCount = 0,
-         .pWaitSemaphores = nullptr,
-         .pWaitDstStageMask = nullptr,
-         .commandBufferCount = 1,
-         .pCommandBuffers = &cmd_buffer,
-         .signalSemaphoreCount = 0,
-         .pSignalSemaphores = nullptr
-      };
-
-      create_info.value( ).p_context->submit_queue(
-         queue::flag_t( queue::flag::e_transfer ),
-         submit_info_t( submit_info ),
-         fence_t( nullptr )
-      );
-
-      create_info.value( ).p_context->queue_wait_idle(
-         queue::flag_t( queue::flag::e_transfer )
-      );
-
-      vmaDestroyBuffer( memory_allocator, staging_buffer, staging_memory );
+         abort( );
+      }
    }
 
    index_buffer::index_buffer( index_buffer&& rhs )
@@ -174,14 +108,11 @@ namespace vk
 
    index_buffer::~index_buffer( )
    {
-      if ( memory_allocator != VK_NULL_HANDLE &&
-           allocation != VK_NULL_HANDLE &&
-           buffer != VK_NULL_HANDLE )
+      if ( p_context != nullptr )
       {
-         vmaDestroyBuffer( memory_allocator, buffer, allocation ); 
+         p_context->destroy_buffer( buffer );
 
-         buffer = VK_NULL_HANDLE;
-         allocation = VK_NULL_HANDLE;
+         buffer = { };
       }
    }
 
@@ -190,18 +121,39 @@ namespace vk
       if ( this != &rhs )
       {
          buffer = rhs.buffer;
-         rhs.buffer = VK_NULL_HANDLE;
+         rhs.buffer = { };
+
+         ownership = rhs.ownership;
+         rhs.ownership = { };
 
-         allocation = rhs.allocation;
-         rhs.allocation = VK_NULL_HANDLE;
+         index_type = rhs.index_type;
+         index_count = rhs.index_count;
+         rhs.index_count = 0;
 
-         memory_allocator = rhs.memory_allocator;
-         rhs.memory_allocator = VK_NULL_HANDLE;
+         p_context = rhs.p_context;
+         rhs.p_context = nullptr;
       }
+
+      return *this;
    }
 
    VkBuffer index_buffer::get_buffer( ) const
    {
-      return buffer;
+      return buffer.handle;
+   }
+
+   queue_ownership index_buffer::get_ownership( ) const
+   {
+      return ownership;
+   }
+
+   VkIndexType index_buffer::get_index_type( ) const
+   {
+      return index_type;
+   }
+
+   std::uint32_t index_buffer::get_index_count( ) const
+   {
+      return index_count;
    }
 } // namespace vk
@@ -0,0 +1,568 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/vk/buffers/queue_ownership.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace vk
+{
+   namespace
+   {
+      /**
+       * @brief Submit the release command buffer on the source queue and,
+       * if there is one, the acquire command buffer on the destination
+       * queue, waiting on the release with a semaphore. The fence of the
+       * submission is signaled once the last command buffer is done. The
+       * command buffers belong to the submission, they are freed if it
+       * fails.
+       */
+      std::variant<pending_submission, error> submit(
+         context const* p_context,
+         queue::flag src_queue, VkCommandBuffer src_cmd_buffer,
+         queue::flag dst_queue, VkCommandBuffer dst_cmd_buffer,
+         VkPipelineStageFlags wait_stage )
+      {
+         pending_submission submission
+         {
+            .fence = VK_NULL_HANDLE,
+            .semaphore = VK_NULL_HANDLE,
+            .src_queue = src_queue,
+            .src_cmd_buffer = src_cmd_buffer,
+            .dst_queue = dst_queue,
+            .dst_cmd_buffer = dst_cmd_buffer
+         };
+
+         VkSemaphoreCreateInfo const semaphore_create_info
+         {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0
+         };
+
+         VkFenceCreateInfo const fence_create_info
+         {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0
+         };
+
+         if ( dst_cmd_buffer != VK_NULL_HANDLE )
+         {
+            auto temp_semaphore = p_context->create_semaphore( semaphore_create_info_t( semaphore_create_info ) );
+            if ( auto const* p_val = std::get_if<VkSemaphore>( &temp_semaphore ) )
+            {
+               submission.semaphore = *p_val;
+            }
+            else
+            {
+               release_submission( p_context, submission );
+
+               return std::get<error>( temp_semaphore );
+            }
+         }
+
+         auto temp_fence = p_context->create_fence( fence_create_info_t( fence_create_info ) );
+         if ( auto const* p_val = std::get_if<VkFence>( &temp_fence ) )
+         {
+            submission.fence = *p_val;
+         }
+         else
+         {
+            release_submission( p_context, submission );
+
+            return std::get<error>( temp_fence );
+         }
+
+         VkSubmitInfo const src_submit_info
+         {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreCount = 0,
+            .pWaitSemaphores = nullptr,
+            .pWaitDstStageMask = nullptr,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &submission.src_cmd_buffer,
+            .signalSemaphoreCount = submission.semaphore != VK_NULL_HANDLE ? 1u : 0u,
+            .pSignalSemaphores = &submission.semaphore
+         };
+
+         VkSubmitInfo const dst_submit_info
+         {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = nullptr,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &submission.semaphore,
+            .pWaitDstStageMask = &wait_stage,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &submission.dst_cmd_buffer,
+            .signalSemaphoreCount = 0,
+            .pSignalSemaphores = nullptr
+         };
+
+         error err = p_context->submit_queue(
+            queue::flag_t( src_queue ),
+            submit_info_t( src_submit_info ),
+            fence_t( submission.semaphore != VK_NULL_HANDLE ? VK_NULL_HANDLE : submission.fence )
+         );
+
+         if ( !err.is_error( ) && submission.semaphore != VK_NULL_HANDLE )
+         {
+            err = p_context->submit_queue(
+               queue::flag_t( dst_queue ),
+               submit_info_t( dst_submit_info ),
+               fence_t( submission.fence )
+            );
+         }
+
+         if ( err.is_error( ) )
+         {
+            static_cast<void>( p_context->device_wait_idle( ) );
+            release_submission( p_context, submission );
+
+            return err;
+         }
+
+         return submission;
+      }
+
+      /**
+       * @brief Submit like submit, then block until the submission is
+       * done and free it.
+       */
+      error submit_and_wait(
+         context const* p_context,
+         queue::flag src_queue, VkCommandBuffer src_cmd_buffer,
+         queue::flag dst_queue, VkCommandBuffer dst_cmd_buffer,
+         VkPipelineStageFlags wait_stage )
+      {
+         auto temp_submission = submit( p_context, src_queue, src_cmd_buffer, dst_queue, dst_cmd_buffer, wait_stage );
+         if ( auto const* p_err = std::get_if<error>( &temp_submission ) )
+         {
+            return *p_err;
+         }
+
+         auto& submission = std::get<pending_submission>( temp_submission );
+         wait_for_submission( p_context, submission );
+         release_submission( p_context, submission );
+
+         return error( result_t( VK_SUCCESS ) );
+      }
+   } // namespace
+
+   std::variant<VkCommandBuffer, error> begin_one_time_commands( context const* p_context, queue::flag flag )
+   {
+      auto temp_cmd_buffer = p_context->create_command_buffers(
+         queue::flag_t( flag ),
+         count32_t( 1 )
+      );
+
+      if ( auto const* p_val = std::get_if<std::vector<VkCommandBuffer>>( &temp_cmd_buffer ) )
+      {
+         VkCommandBufferBeginInfo const begin_info
+         {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .pNext = nullptr,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = nullptr
+         };
+
+         vkBeginCommandBuffer( ( *p_val )[0], &begin_info );
+
+         return ( *p_val )[0];
+      }
+      else
+      {
+         return std::get<error>( temp_cmd_buffer );
+      }
+   }
+
+   error submit_one_time_commands( context const* p_context, queue::flag flag, VkCommandBuffer cmd_buffer )
+   {
+      vkEndCommandBuffer( cmd_buffer );
+
+      return submit_and_wait( p_context, flag, cmd_buffer, flag, VK_NULL_HANDLE, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT );
+   }
+
+   std::variant<pending_submission, error> submit_one_time_commands_async( context const* p_context, queue::flag flag, VkCommandBuffer cmd_buffer )
+   {
+      vkEndCommandBuffer( cmd_buffer );
+
+      return submit( p_context, flag, cmd_buffer, flag, VK_NULL_HANDLE, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT );
+   }
+
+   bool is_submission_done( context const* p_context, pending_submission const& submission ) noexcept
+   {
+      return submission.fence == VK_NULL_HANDLE || p_context->is_fence_signaled( fence_t( submission.fence ) );
+   }
+
+   void wait_for_submission( context const* p_context, pending_submission const& submission ) noexcept
+   {
+      if ( submission.fence != VK_NULL_HANDLE )
+      {
+         p_context->wait_for_fence( fence_t( submission.fence ) );
+      }
+   }
+
+   void release_submission( context const* p_context, pending_submission& submission ) noexcept
+   {
+      if ( submission.fence != VK_NULL_HANDLE )
+      {
+         p_context->destroy_fence( fence_t( submission.fence ) );
+      }
+
+      if ( submission.semaphore != VK_NULL_HANDLE )
+      {
+         p_context->destroy_semaphore( semaphore_t( submission.semaphore ) );
+      }
+
+      if ( submission.dst_cmd_buffer != VK_NULL_HANDLE )
+      {
+         p_context->destroy_command_buffers( queue::flag_t( submission.dst_queue ), { submission.dst_cmd_buffer } );
+      }
+
+      if ( submission.src_cmd_buffer != VK_NULL_HANDLE )
+      {
+         p_context->destroy_command_buffers( queue::flag_t( submission.src_queue ), { submission.src_cmd_buffer } );
+      }
+
+      submission = pending_submission( );
+   }
+
+   void record_ownership_release(
+      VkCommandBuffer cmd_buffer,
+      ownership_transfer_info const& info,
+      std::uint32_t dst_family_index ) noexcept
+   {
+      VkBufferMemoryBarrier const barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = info.src_access,
+         .dstAccessMask = 0,
+         .srcQueueFamilyIndex = info.ownership.family_index,
+         .dstQueueFamilyIndex = dst_family_index,
+         .buffer = info.p_buffer->handle,
+         .offset = 0,
+         .size = VK_WHOLE_SIZE
+      };
+
+      vkCmdPipelineBarrier(
+         cmd_buffer,
+         info.src_stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+         0,
+         0, nullptr,
+         1, &barrier,
+         0, nullptr
+      );
+   }
+
+   void record_ownership_acquire(
+      VkCommandBuffer cmd_buffer,
+      ownership_transfer_info const& info,
+      std::uint32_t dst_family_index ) noexcept
+   {
+      VkBufferMemoryBarrier const barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = 0,
+         .dstAccessMask = info.dst_access,
+         .srcQueueFamilyIndex = info.ownership.family_index,
+         .dstQueueFamilyIndex = dst_family_index,
+         .buffer = info.p_buffer->handle,
+         .offset = 0,
+         .size = VK_WHOLE_SIZE
+      };
+
+      vkCmdPipelineBarrier(
+         cmd_buffer,
+         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, info.dst_stage,
+         0,
+         0, nullptr,
+         1, &barrier,
+         0, nullptr
+      );
+   }
+
+   std::variant<queue_ownership, error> transfer_ownership( ownership_transfer_info_t const& info )
+   {
+      auto const& transfer = info.value( );
+      auto const dst_family_index = transfer.p_context->get_queue_family_index( queue::flag_t( transfer.dst_queue ) );
+
+      if ( transfer.ownership.family_index == dst_family_index || 
+           transfer.ownership.family_index == VK_QUEUE_FAMILY_IGNORED )
+      {
+         return queue_ownership
+         {
+            .owner = transfer.dst_queue,
+            .family_index = dst_family_index,
+            .transfer_count = transfer.ownership.transfer_count
+         };
+      }
+
+      auto temp_release = begin_one_time_commands( transfer.p_context, transfer.ownership.owner );
+      if ( auto const* p_err = std::get_if<error>( &temp_release ) )
+      {
+         return *p_err;
+      }
+
+      auto temp_acquire = begin_one_time_commands( transfer.p_context, transfer.dst_queue );
+      if ( auto const* p_err = std::get_if<error>( &temp_acquire ) )
+      {
+         transfer.p_context->destroy_command_buffers( queue::flag_t( transfer.ownership.owner ), { std::get<VkCommandBuffer>( temp_release ) } );
+
+         return *p_err;
+      }
+
+      auto release_cmd_buffer = std::get<VkCommandBuffer>( temp_release );
+      auto acquire_cmd_buffer = std::get<VkCommandBuffer>( temp_acquire );
+
+      record_ownership_release( release_cmd_buffer, transfer, dst_family_index );
+      vkEndCommandBuffer( release_cmd_buffer );
+
+      record_ownership_acquire( acquire_cmd_buffer, transfer, dst_family_index );
+      vkEndCommandBuffer( acquire_cmd_buffer );
+
+      auto const err = submit_and_wait(
+         transfer.p_context,
+         transfer.ownership.owner, release_cmd_buffer,
+         transfer.dst_queue, acquire_cmd_buffer,
+         transfer.dst_stage
+      );
+
+      if ( err.is_error( ) )
+      {
+         return err;
+      }
+
+      return queue_ownership
+      {
+         .owner = transfer.dst_queue,
+         .family_index = dst_family_index,
+         .transfer_count = transfer.ownership.transfer_count + 1
+      };
+   }
+
+   std::variant<queue_ownership, error> upload_batch( batch_upload_info_t const& info )
+   {
+      auto const& batch = info.value( );
+      auto const* p_context = batch.p_context;
+
+      auto temp_submission = upload_batch_async( info );
+      if ( auto const* p_err = std::get_if<error>( &temp_submission ) )
+      {
+         return *p_err;
+      }
+
+      auto& submission = std::get<pending_submission>( temp_submission );
+      bool const is_transferred = submission.dst_cmd_buffer != VK_NULL_HANDLE;
+
+      wait_for_submission( p_context, submission );
+      release_submission( p_context, submission );
+
+      return queue_ownership
+      {
+         .owner = batch.dst_queue,
+         .family_index = p_context->get_queue_family_index( queue::flag_t( batch.dst_queue ) ),
+         .transfer_count = is_transferred ? 1u : 0u
+      };
+   }
+
+   std::variant<pending_submission, error> upload_batch_async( batch_upload_info_t const& info )
+   {
+      auto const& batch = info.value( );
+      auto const* p_context = batch.p_context;
+
+      auto const transfer_family_index = p_context->get_queue_family_index( queue::flag_t( queue::flag::e_transfer ) );
+      auto const dst_family_index = p_context->get_queue_family_index( queue::flag_t( batch.dst_queue ) );
+
+      if ( batch.copies.empty( ) )
+      {
+         return pending_submission( );
+      }
+
+      /* COPY */
+      auto temp_copy = begin_one_time_commands( p_context, queue::flag::e_transfer );
+      if ( auto const* p_err = std::get_if<error>( &temp_copy ) )
+      {
+         return *p_err;
+      }
+
+      auto copy_cmd_buffer = std::get<VkCommandBuffer>( temp_copy );
+
+      for( auto const& copy : batch.copies )
+      {
+         VkBufferCopy const copy_region
+         {
+            .srcOffset = copy.src_offset,
+            .dstOffset = copy.dst_offset,
+            .size = copy.size
+         };
+
+         vkCmdCopyBuffer(
+            copy_cmd_buffer,
+            batch.staging_buffer, copy.p_dst->handle,
+            1, &copy_region
+         );
+      }
+
+      /* OWNERSHIP */
+      std::vector<buffer_allocation const*> destinations;
+      destinations.reserve( batch.copies.size( ) );
+      for( auto const& copy : batch.copies )
+      {
+         if ( std::find( destinations.cbegin( ), destinations.cend( ), copy.p_dst ) == destinations.cend( ) )
+         {
+            destinations.push_back( copy.p_dst );
+         }
+      }
+
+      auto const make_transfer = [&] ( buffer_allocation const* p_dst )
+      {
+         return ownership_transfer_info
+         {
+            .p_context = p_context,
+            .p_buffer = p_dst,
+            .ownership = queue_ownership{ .owner = queue::flag::e_transfer, .family_index = transfer_family_index, .transfer_count = 0 },
+            .dst_queue = batch.dst_queue,
+            .src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .src_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dst_stage = batch.dst_stage,
+            .dst_access = batch.dst_access
+         };
+      };
+
+      VkCommandBuffer acquire_cmd_buffer = VK_NULL_HANDLE;
+      if ( transfer_family_index != dst_family_index )
+      {
+         for( auto const* p_dst : destinations )
+         {
+            record_ownership_release( copy_cmd_buffer, make_transfer( p_dst ), dst_family_index );
+         }
+
+         auto temp_acquire = begin_one_time_commands( p_context, batch.dst_queue );
+         if ( auto const* p_err = std::get_if<error>( &temp_acquire ) )
+         {
+            p_context->destroy_command_buffers( queue::flag_t( queue::flag::e_transfer ), { copy_cmd_buffer } );
+
+            return *p_err;
+         }
+
+         acquire_cmd_buffer = std::get<VkCommandBuffer>( temp_acquire );
+
+         for( auto const* p_dst : destinations )
+         {
+            record_ownership_acquire( acquire_cmd_buffer, make_transfer( p_dst ), dst_family_index );
+         }
+
+         vkEndCommandBuffer( acquire_cmd_buffer );
+      }
+      else
+      {
+         VkMemoryBarrier const barrier
+         {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = batch.dst_access
+         };
+
+         vkCmdPipelineBarrier(
+            copy_cmd_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, batch.dst_stage,
+            0,
+            1, &barrier,
+            0, nullptr,
+            0, nullptr
+         );
+      }
+
+      vkEndCommandBuffer( copy_cmd_buffer );
+
+      return submit(
+         p_context,
+         queue::flag::e_transfer, copy_cmd_buffer,
+         batch.dst_queue, acquire_cmd_buffer,
+         batch.dst_stage
+      );
+   }
+
+   std::variant<queue_ownership, error> upload_through_staging( staging_upload_info_t const& info )
+   {
+      auto const& upload = info.value( );
+      auto const* p_context = upload.p_context;
+      auto const memory_allocator = p_context->get_memory_allocator( );
+
+      /* STAGING BUFFER */
+      VkBufferCreateInfo const staging_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .size = upload.size,
+         .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr
+      };
+
+      VmaAllocationCreateInfo staging_alloc_info = { };
+      staging_alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+
+      buffer_allocation staging_buffer;
+
+      auto temp_staging_buffer = p_context->create_buffer(
+         buffer_create_info_t( staging_create_info ),
+         allocation_create_info_t( staging_alloc_info ),
+         memory_category::e_staging_buffer
+      );
+
+      if ( auto const* p_val = std::get_if<buffer_allocation>( &temp_staging_buffer ) )
+      {
+         staging_buffer = *p_val;
+      }
+      else
+      {
+         return std::get<error>( temp_staging_buffer );
+      }
+
+      /* MAP THE MEMORY INTO THE STAGING BUFFER */
+      void* data;
+      vmaMapMemory( memory_allocator, staging_buffer.allocation, &data );
+      memcpy( data, upload.p_data, upload.size );
+      vmaUnmapMemory( memory_allocator, staging_buffer.allocation );
+
+      batch_upload_info const batch
+      {
+         .p_context = p_context,
+         .staging_buffer = staging_buffer.handle,
+         .copies = { staging_copy{ .p_dst = upload.p_buffer, .src_offset = 0, .dst_offset = 0, .size = upload.size } },
+         .dst_queue = upload.dst_queue,
+         .dst_stage = upload.dst_stage,
+         .dst_access = upload.dst_access
+      };
+
+      auto res = upload_batch( batch_upload_info_t( batch ) );
+
+      p_context->destroy_buffer( staging_buffer );
+
+      return res;
+   }
+} // namespace vk
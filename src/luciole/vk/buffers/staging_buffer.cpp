@@ -0,0 +1,143 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/vk/buffers/staging_buffer.hpp>
+
+namespace vk
+{
+   staging_buffer::staging_buffer( create_info_t const& create_info )
+      :
+      p_context( create_info.value( ).p_context ),
+      buffer( )
+   {
+      VkBufferCreateInfo const buffer_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .size = create_info.value( ).size,
+         .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr
+      };
+
+      VmaAllocationCreateInfo alloc_info = { };
+      alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+      alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+
+      auto temp_buffer = p_context->create_buffer(
+         buffer_create_info_t( buffer_create_info ),
+         allocation_create_info_t( alloc_info ),
+         memory_category::e_staging_buffer
+      );
+
+      if ( auto const* p_val = std::get_if<buffer_allocation>( &temp_buffer ) )
+      {
+         buffer = *p_val;
+      }
+      else
+      {
+         abort( );
+      }
+
+      VmaAllocationInfo allocation_info = { };
+      vmaGetAllocationInfo( p_context->get_memory_allocator( ), buffer.allocation, &allocation_info );
+
+      p_mapped_data = static_cast<std::byte*>( allocation_info.pMappedData );
+   }
+
+   staging_buffer::staging_buffer( staging_buffer&& rhs )
+   {
+      *this = std::move( rhs );
+   }
+
+   staging_buffer::~staging_buffer( )
+   {
+      if ( p_context != nullptr )
+      {
+         p_context->destroy_buffer( buffer );
+      }
+   }
+
+   staging_buffer& staging_buffer::operator=( staging_buffer&& rhs )
+   {
+      if ( this != &rhs )
+      {
+         if ( p_context != nullptr )
+         {
+            p_context->destroy_buffer( buffer );
+         }
+
+         p_context = rhs.p_context;
+         rhs.p_context = nullptr;
+
+         buffer = rhs.buffer;
+         rhs.buffer = { };
+
+         p_mapped_data = rhs.p_mapped_data;
+         rhs.p_mapped_data = nullptr;
+
+         used_size.store( rhs.used_size.exchange( 0, std::memory_order_relaxed ), std::memory_order_relaxed );
+      }
+
+      return *this;
+   }
+
+   VkDeviceSize staging_buffer::allocate( VkDeviceSize size, VkDeviceSize alignment ) noexcept
+   {
+      auto used = used_size.load( std::memory_order_relaxed );
+      VkDeviceSize offset;
+
+      do
+      {
+         offset = ( used + alignment - 1 ) & ~( alignment - 1 );
+         if ( offset + size > buffer.size )
+         {
+            return invalid_offset;
+         }
+      } while( !used_size.compare_exchange_weak( used, offset + size, std::memory_order_relaxed ) );
+
+      return offset;
+   }
+
+   void staging_buffer::reset( ) noexcept
+   {
+      used_size.store( 0, std::memory_order_relaxed );
+   }
+
+   std::byte* staging_buffer::data( VkDeviceSize offset ) const
+   {
+      return p_mapped_data + offset;
+   }
+
+   VkBuffer staging_buffer::get_buffer( ) const
+   {
+      return buffer.handle;
+   }
+
+   VkDeviceSize staging_buffer::get_size( ) const
+   {
+      return buffer.size;
+   }
+
+   VkDeviceSize staging_buffer::get_used_size( ) const noexcept
+   {
+      return used_size.load( std::memory_order_relaxed );
+   }
+} // namespace vk
@@ -22,12 +22,10 @@ namespace vk
 {
    uniform_buffer::uniform_buffer( context const& ctx, std::size_t buffer_size )
       :
+      p_context( &ctx ),
       memory_allocator( ctx.get_memory_allocator( ) ),
-      allocation( VK_NULL_HANDLE ),
-      buffer( VK_NULL_HANDLE )
+      buffer( )
    {
-      auto const indices = ctx.get_unique_family_indices( );
-
       VkBufferCreateInfo const create_info
       {
          .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -35,24 +33,28 @@ namespace vk
          .flags = 0,
          .size = buffer_size,
          .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-         .sharingMode = VK_SHARING_MODE_CONCURRENT,
-         .queueFamilyIndexCount = static_cast<std::uint32_t>(
-            indices.size()
-         ),
-         .pQueueFamilyIndices = indices.data()
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr
       };
 
       VmaAllocationCreateInfo alloc_info = { };
       alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
 
-      vmaCreateBuffer(
-         memory_allocator,
-         &create_info,
-         &alloc_info,
-         &buffer,
-         &allocation,
-         nullptr
+      auto temp_buffer = ctx.create_buffer(
+         buffer_create_info_t( create_info ),
+         allocation_create_info_t( alloc_info ),
+         memory_category::e_uniform_buffer
       );
+
+      if ( auto const* p_val = std::get_if<buffer_allocation>( &temp_buffer ) )
+      {
+         buffer = *p_val;
+      }
+      else
+      {
+         abort( );
+      }
    }   
 
    uniform_buffer::uniform_buffer( uniform_buffer&& rhs )
@@ -62,11 +64,9 @@ namespace vk
    
    uniform_buffer::~uniform_buffer( )
    {
-      if ( buffer != VK_NULL_HANDLE || 
-           memory_allocator != VK_NULL_HANDLE || 
-           allocation != VK_NULL_HANDLE )
+      if ( p_context != nullptr )
       {
-         vmaDestroyBuffer( memory_allocator, buffer, allocation );  
+         p_context->destroy_buffer( buffer );
       }
    }
    
@@ -74,15 +74,17 @@ namespace vk
    {
       if ( this != &rhs )
       {
+         p_context = rhs.p_context;
+         rhs.p_context = nullptr;
+
          memory_allocator = rhs.memory_allocator;
          rhs.memory_allocator = VK_NULL_HANDLE;
 
-         allocation = rhs.allocation;
-         rhs.allocation = VK_NULL_HANDLE;
-
          buffer = rhs.buffer;
-         rhs.buffer = VK_NULL_HANDLE;
+         rhs.buffer = { };
       }
+
+      return *this;
    }
 
 } // namespace vk
@@ -22,148 +22,63 @@ namespace vk
 {
    vertex_buffer::vertex_buffer( vertex_buffer::create_info_t const& create_info )
       :
-      memory_allocator( create_info.value( ).memory_allocator ),
-      allocation( VK_NULL_HANDLE ),
-      buffer( VK_NULL_HANDLE )
+      p_context( create_info.value( ).p_context ),
+      buffer( )
    {
       auto const buffer_size = 
-         create_info.value( ).vertices.size() * 
+         create_info.value( ).vertices.size( ) * 
          sizeof( create_info.value( ).vertices[0] );
 
-      VkBuffer staging_buffer = VK_NULL_HANDLE;
-      VmaAllocation staging_memory = VK_NULL_HANDLE; 
-
-      /* STAGING BUFFER */
-      VkBufferCreateInfo const staging_create_info 
-      {
-         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-         .pNext = nullptr,
-         .flags = 0,
-         .size = buffer_size,
-         .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-         .sharingMode = VK_SHARING_MODE_CONCURRENT,
-         .queueFamilyIndexCount = static_cast<std::uint32_t>( 
-            create_info.value( ).family_indices.size() 
-         ),
-         .pQueueFamilyIndices = create_info.value( ).family_indices.data()
-      };
-
-      VmaAllocationCreateInfo staging_allocation_info = { };
-      staging_allocation_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-
-      vmaCreateBuffer( 
-         memory_allocator,
-         &staging_create_info,
-         &staging_allocation_info,
-         &staging_buffer, 
-         &staging_memory, 
-         nullptr 
-      );
-
-      /* MAP THE MEMORY INTO THE STAGING BUFFER */
-      void* data;
-      vmaMapMemory( memory_allocator, staging_memory, &data );
-      memcpy( 
-         data, 
-         create_info.value( ).vertices.data(), 
-         buffer_size
-      );
-      vmaUnmapMemory( memory_allocator, staging_memory );
-
-      VkBufferCreateInfo const vertex_buffer_create_info
+      VkBufferCreateInfo const buffer_create_info
       {
          .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
          .pNext = nullptr,
          .flags = 0,
          .size = buffer_size,
          .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-         .sharingMode = VK_SHARING_MODE_CONCURRENT,
-         .queueFamilyIndexCount = static_cast<std::uint32_t>(
-               create_info.value( ).family_indices.size()
-         ),
-         .pQueueFamilyIndices = create_info.value( ).family_indices.data()
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr
       };
 
-      VmaAllocationCreateInfo allocation_info = {};
+      VmaAllocationCreateInfo allocation_info = { };
       allocation_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
-      vmaCreateBuffer(
-         memory_allocator,
-         &vertex_buffer_create_info,
-         &allocation_info,
-         &buffer,
-         &allocation,
-         nullptr
+      auto temp_buffer = p_context->create_buffer(
+         buffer_create_info_t( buffer_create_info ),
+         allocation_create_info_t( allocation_info ),
+         memory_category::e_vertex_buffer
       );
 
-      /* CREATE COMMAND BUFFER */
-      VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
-
-      auto temp_cmd_buffer = create_info.value( ).p_context->create_command_buffers(
-         queue::flag_t( queue::flag::e_transfer ),
-         count32_t( 1 )
-      );
-
-      if ( auto const* p_val = 
-            std::get_if<std::vector<VkCommandBuffer>>( &temp_cmd_buffer ) )
+      if ( auto const* p_val = std::get_if<buffer_allocation>( &temp_buffer ) )
       {
-         cmd_buffer = (*p_val)[0];
+         buffer = *p_val;
       }
       else
       {
-         
-         abort();
+         abort( );
       }
 
-      VkCommandBufferBeginInfo const begin_info
+      staging_upload_info const upload_info
       {
-         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-         .pNext = nullptr,
-         .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-         .pInheritanceInfo = nullptr
+         .p_context = p_context,
+         .p_buffer = &buffer,
+         .p_data = create_info.value( ).vertices.data( ),
+         .size = buffer_size,
+         .dst_queue = queue::flag::e_graphics,
+         .dst_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+         .dst_access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
       };
 
-      vkBeginCommandBuffer( cmd_buffer, &begin_info );
-
-      VkBufferCopy const copy_region
+      auto temp_ownership = upload_through_staging( staging_upload_info_t( upload_info ) );
+      if ( auto const* p_val = std::get_if<queue_ownership>( &temp_ownership ) )
       {
-         .srcOffset = VkDeviceSize( 0 ),
-         .dstOffset = VkDeviceSize( 0 ),
-         .size = VkDeviceSize( buffer_size )
-      };
-
-      vkCmdCopyBuffer(
-         cmd_buffer,
-         staging_buffer, buffer,
-         1,&copy_region
-      );
-
-      vkEndCommandBuffer( cmd_buffer );
-
-      VkSubmitInfo const submit_info
+         ownership = *p_val;
+      }
+      else
       {
-         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-         .pNext = nullptr,
-         .waitSemaphoreCount = 0,
-         .pWaitSemaphores = nullptr,
-         .pWaitDstStageMask = nullptr,
-         .commandBufferCount = 1,
-         .pCommandBuffers = &cmd_buffer,
-         .signalSemaphoreCount = 0,
-         .pSignalSemaphores = nullptr
-      };
-
-      create_info.value( ).p_context->submit_queue(
-         queue::flag_t( queue::flag::e_transfer ),
-         submit_info_t( submit_info ),
-         fence_t( nullptr )
-      );
-
-      create_info.value( ).p_context->queue_wait_idle(
-         queue::flag_t( queue::flag::e_transfer )
-      );
-
-      vmaDestroyBuffer( memory_allocator, staging_buffer, staging_memory );
+         abort( );
+      }
    }
 
    vertex_buffer::vertex_buffer( vertex_buffer&& rhs )
@@ -173,22 +88,24 @@ namespace vk
 
    vertex_buffer::~vertex_buffer( )
    {
-      if ( buffer != VK_NULL_HANDLE )
-         vmaDestroyBuffer( memory_allocator, buffer, allocation );
+      if ( p_context != nullptr )
+         p_context->destroy_buffer( buffer );
    }
 
    vertex_buffer& vertex_buffer::operator=( vertex_buffer&& rhs )
    {
       if ( this != &rhs )
       {
-         memory_allocator = rhs.memory_allocator;
-         rhs.memory_allocator = VK_NULL_HANDLE;
+         p_context = rhs.p_context;
+         rhs.p_context = nullptr;
 
          buffer = rhs.buffer;
-         rhs.buffer = VK_NULL_HANDLE;
+         rhs.buffer = { };
 
-         allocation = rhs.allocation;
-         rhs.allocation = VK_NULL_HANDLE;
+         ownership = rhs.ownership;
+         rhs.ownership = { };
       }
+
+      return *this;
    }
 } // namespace vk
@@ -0,0 +1,411 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/vk/host_allocator.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+
+namespace vk
+{
+   namespace
+   {
+      /**
+       * @brief Header stored right before every pointer given to the driver.
+       */
+      struct alignas( 32 ) allocation_header
+      {
+         void* p_raw;
+         std::uint64_t size;
+         std::uint32_t size_class;
+         std::uint16_t scope;
+         std::uint16_t type;
+      }; // struct allocation_header
+
+      static_assert( sizeof( allocation_header ) == 32, "allocation_header must be 32 bytes." );
+
+      constexpr std::size_t header_size = sizeof( allocation_header );
+      constexpr std::uint32_t no_size_class = std::numeric_limits<std::uint32_t>::max( );
+      constexpr std::array<std::size_t, 5> size_classes = { 64, 128, 256, 512, 1024 };
+      constexpr std::size_t max_cached_blocks = 256;
+
+      std::atomic<std::uint64_t> pooled_bytes = 0;
+
+      /**
+       * @brief Free lists of small blocks owned by a single thread. Blocks
+       * freed on a thread are reused by that thread without any locking.
+       */
+      struct thread_cache
+      {
+         struct free_block
+         {
+            free_block* p_next;
+         }; // struct free_block
+
+         std::array<free_block*, size_classes.size( )> free_lists = { };
+         std::array<std::size_t, size_classes.size( )> counts = { };
+
+         ~thread_cache( )
+         {
+            for( std::size_t i = 0; i < free_lists.size( ); ++i )
+            {
+               while( free_lists[i] != nullptr )
+               {
+                  auto* p_block = free_lists[i];
+                  free_lists[i] = p_block->p_next;
+
+                  std::free( p_block );
+               }
+
+               pooled_bytes -= counts[i] * size_classes[i];
+               counts[i] = 0;
+            }
+         }
+
+         void* pop( std::uint32_t size_class ) noexcept
+         {
+            if ( auto* p_block = free_lists[size_class] )
+            {
+               free_lists[size_class] = p_block->p_next;
+               --counts[size_class];
+               pooled_bytes -= size_classes[size_class];
+
+               return p_block;
+            }
+
+            return std::aligned_alloc( header_size, size_classes[size_class] );
+         }
+
+         void push( std::uint32_t size_class, void* p_memory ) noexcept
+         {
+            if ( counts[size_class] < max_cached_blocks )
+            {
+               auto* p_block = static_cast<free_block*>( p_memory );
+               p_block->p_next = free_lists[size_class];
+               free_lists[size_class] = p_block;
+
+               ++counts[size_class];
+               pooled_bytes += size_classes[size_class];
+            }
+            else
+            {
+               std::free( p_memory );
+            }
+         }
+      }; // struct thread_cache
+
+      thread_local thread_cache cache;
+
+      std::uint32_t find_size_class( std::size_t size, std::size_t alignment ) noexcept
+      {
+         if ( alignment > header_size )
+         {
+            return no_size_class;
+         }
+
+         for( std::uint32_t i = 0; i < size_classes.size( ); ++i )
+         {
+            if ( size + header_size <= size_classes[i] )
+            {
+               return i;
+            }
+         }
+
+         return no_size_class;
+      }
+
+      std::string const object_type_names[] =
+      {
+         "instance",
+         "debug messenger",
+         "device",
+         "swapchain",
+         "image view",
+         "render pass",
+         "descriptor pool",
+         "pipeline layout",
+         "descriptor set layout",
+         "pipeline",
+         "shader module",
+         "framebuffer",
+         "semaphore",
+         "fence",
+         "command pool",
+         "memory allocator",
+         "sampler",
+         "unknown"
+      };
+
+      std::string const scope_names[] =
+      {
+         "command",
+         "object",
+         "cache",
+         "device",
+         "instance",
+         "unknown"
+      };
+   } // namespace
+
+   void host_allocator::counter::on_allocate( std::uint64_t size ) noexcept
+   {
+      allocation_count.fetch_add( 1, std::memory_order_relaxed );
+
+      auto const live = live_bytes.fetch_add( size, std::memory_order_relaxed ) + size;
+      auto peak = peak_bytes.load( std::memory_order_relaxed );
+      while( live > peak && !peak_bytes.compare_exchange_weak( peak, live, std::memory_order_relaxed ) ) { }
+   }
+
+   void host_allocator::counter::on_free( std::uint64_t size ) noexcept
+   {
+      free_count.fetch_add( 1, std::memory_order_relaxed );
+      live_bytes.fetch_sub( size, std::memory_order_relaxed );
+   }
+
+   host_allocator::host_allocator( )
+      :
+      last_report_time( std::chrono::steady_clock::now( ) )
+   {
+      for( std::size_t i = 0; i < object_type_count; ++i )
+      {
+         tags[i] = tag{ .p_allocator = this, .type = static_cast<object_type>( i ) };
+
+         callbacks[i] = VkAllocationCallbacks
+         {
+            .pUserData = &tags[i],
+            .pfnAllocation = &host_allocator::allocation_callback,
+            .pfnReallocation = &host_allocator::reallocation_callback,
+            .pfnFree = &host_allocator::free_callback,
+            .pfnInternalAllocation = &host_allocator::internal_allocation_callback,
+            .pfnInternalFree = &host_allocator::internal_free_callback
+         };
+      }
+   }
+
+   VkAllocationCallbacks const* host_allocator::get_callbacks( object_type type ) const noexcept
+   {
+      return &callbacks[static_cast<std::size_t>( type )];
+   }
+
+   host_allocator::report host_allocator::get_report( ) const
+   {
+      auto const load = [] ( counter const& c, usage const& previous, double elapsed )
+      {
+         usage res
+         {
+            .live_bytes = c.live_bytes.load( std::memory_order_relaxed ),
+            .peak_bytes = c.peak_bytes.load( std::memory_order_relaxed ),
+            .internal_bytes = c.internal_bytes.load( std::memory_order_relaxed ),
+            .allocation_count = c.allocation_count.load( std::memory_order_relaxed ),
+            .free_count = c.free_count.load( std::memory_order_relaxed ),
+            .allocation_rate = 0.0
+         };
+
+         if ( elapsed > 0.0 )
+         {
+            res.allocation_rate = static_cast<double>( res.allocation_count - previous.allocation_count ) / elapsed;
+         }
+
+         return res;
+      };
+
+      std::scoped_lock lock( report_mutex );
+
+      auto const now = std::chrono::steady_clock::now( );
+      double const elapsed = std::chrono::duration<double>( now - last_report_time ).count( );
+
+      report res = { };
+      for( std::size_t i = 0; i < scope_count; ++i )
+      {
+         res.scopes[i] = load( scope_counters[i], last_report.scopes[i], elapsed );
+      }
+
+      for( std::size_t i = 0; i < object_type_count; ++i )
+      {
+         res.objects[i] = load( object_counters[i], last_report.objects[i], elapsed );
+      }
+
+      res.total = load( total_counter, last_report.total, elapsed );
+      res.pooled_bytes = pooled_bytes.load( std::memory_order_relaxed );
+
+      last_report = res;
+      last_report_time = now;
+
+      return res;
+   }
+
+   std::string const& host_allocator::to_string( object_type type )
+   {
+      return object_type_names[std::min( static_cast<std::size_t>( type ), object_type_count )];
+   }
+
+   std::string const& host_allocator::to_string( VkSystemAllocationScope scope )
+   {
+      return scope_names[std::min( static_cast<std::size_t>( scope ), scope_count )];
+   }
+
+   void* host_allocator::allocate(
+      std::size_t size, std::size_t alignment,
+      VkSystemAllocationScope scope, object_type type )
+   {
+      if ( size == 0 )
+      {
+         return nullptr;
+      }
+
+      std::byte* p_memory = nullptr;
+      void* p_raw = nullptr;
+
+      auto const size_class = find_size_class( size, alignment );
+      if ( size_class != no_size_class )
+      {
+         auto* p_block = static_cast<std::byte*>( cache.pop( size_class ) );
+         if ( p_block == nullptr )
+         {
+            return nullptr;
+         }
+
+         p_memory = p_block + header_size;
+      }
+      else
+      {
+         alignment = std::max( alignment, header_size );
+
+         p_raw = std::malloc( size + header_size + alignment - 1 );
+         if ( p_raw == nullptr )
+         {
+            return nullptr;
+         }
+
+         auto const address = reinterpret_cast<std::uintptr_t>( p_raw ) + header_size;
+         p_memory = reinterpret_cast<std::byte*>( ( address + alignment - 1 ) & ~( alignment - 1 ) );
+      }
+
+      new( p_memory - header_size ) allocation_header
+      {
+         .p_raw = p_raw,
+         .size = size,
+         .size_class = size_class,
+         .scope = static_cast<std::uint16_t>( scope ),
+         .type = static_cast<std::uint16_t>( type )
+      };
+
+      scope_counters[static_cast<std::size_t>( scope )].on_allocate( size );
+      object_counters[static_cast<std::size_t>( type )].on_allocate( size );
+      total_counter.on_allocate( size );
+
+      return p_memory;
+   }
+
+   void host_allocator::deallocate( void* p_memory )
+   {
+      if ( p_memory == nullptr )
+      {
+         return;
+      }
+
+      auto* p_header = reinterpret_cast<allocation_header*>( static_cast<std::byte*>( p_memory ) - header_size );
+
+      scope_counters[p_header->scope].on_free( p_header->size );
+      object_counters[p_header->type].on_free( p_header->size );
+      total_counter.on_free( p_header->size );
+
+      if ( p_header->size_class != no_size_class )
+      {
+         cache.push( p_header->size_class, p_header );
+      }
+      else
+      {
+         std::free( p_header->p_raw );
+      }
+   }
+
+   void* host_allocator::allocation_callback(
+      void* p_user_data, std::size_t size, std::size_t alignment,
+      VkSystemAllocationScope scope )
+   {
+      auto const* p_tag = static_cast<tag const*>( p_user_data );
+
+      return p_tag->p_allocator->allocate( size, alignment, scope, p_tag->type );
+   }
+
+   void* host_allocator::reallocation_callback(
+      void* p_user_data, void* p_original, std::size_t size, std::size_t alignment,
+      VkSystemAllocationScope scope )
+   {
+      auto const* p_tag = static_cast<tag const*>( p_user_data );
+
+      if ( p_original == nullptr )
+      {
+         return p_tag->p_allocator->allocate( size, alignment, scope, p_tag->type );
+      }
+
+      if ( size == 0 )
+      {
+         p_tag->p_allocator->deallocate( p_original );
+
+         return nullptr;
+      }
+
+      auto const* p_header = reinterpret_cast<allocation_header const*>(
+         static_cast<std::byte*>( p_original ) - header_size
+      );
+
+      void* p_memory = p_tag->p_allocator->allocate( size, alignment, scope, p_tag->type );
+      if ( p_memory != nullptr )
+      {
+         std::memcpy( p_memory, p_original, std::min<std::size_t>( size, p_header->size ) );
+
+         p_tag->p_allocator->deallocate( p_original );
+      }
+
+      return p_memory;
+   }
+
+   void host_allocator::free_callback( void* p_user_data, void* p_memory )
+   {
+      static_cast<tag const*>( p_user_data )->p_allocator->deallocate( p_memory );
+   }
+
+   void host_allocator::internal_allocation_callback(
+      void* p_user_data, std::size_t size, VkInternalAllocationType,
+      VkSystemAllocationScope scope )
+   {
+      auto const* p_tag = static_cast<tag const*>( p_user_data );
+      auto* p_allocator = p_tag->p_allocator;
+
+      p_allocator->scope_counters[static_cast<std::size_t>( scope )].internal_bytes += size;
+      p_allocator->object_counters[static_cast<std::size_t>( p_tag->type )].internal_bytes += size;
+      p_allocator->total_counter.internal_bytes += size;
+   }
+
+   void host_allocator::internal_free_callback(
+      void* p_user_data, std::size_t size, VkInternalAllocationType,
+      VkSystemAllocationScope scope )
+   {
+      auto const* p_tag = static_cast<tag const*>( p_user_data );
+      auto* p_allocator = p_tag->p_allocator;
+
+      p_allocator->scope_counters[static_cast<std::size_t>( scope )].internal_bytes -= size;
+      p_allocator->object_counters[static_cast<std::size_t>( p_tag->type )].internal_bytes -= size;
+      p_allocator->total_counter.internal_bytes -= size;
+   }
+} // namespace vk
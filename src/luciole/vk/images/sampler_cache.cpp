@@ -0,0 +1,173 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/vk/images/sampler_cache.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+namespace vk
+{
+   namespace
+   {
+      void hash_combine( std::size_t& seed, std::size_t value ) noexcept
+      {
+         seed ^= value + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
+      }
+
+      std::size_t hash_float( float value ) noexcept
+      {
+         /* -0.0f and 0.0f compare equal, so they must hash the same */
+         if ( value == 0.0f )
+         {
+            value = 0.0f;
+         }
+
+         std::uint32_t bits;
+         std::memcpy( &bits, &value, sizeof( bits ) );
+
+         return std::hash<std::uint32_t>{ }( bits );
+      }
+   } // namespace
+
+   bool sampler_desc::operator==( sampler_desc const& rhs ) const noexcept
+   {
+      return 
+         mag_filter == rhs.mag_filter && min_filter == rhs.min_filter && mipmap_mode == rhs.mipmap_mode &&
+         address_mode_u == rhs.address_mode_u && address_mode_v == rhs.address_mode_v && address_mode_w == rhs.address_mode_w &&
+         mip_lod_bias == rhs.mip_lod_bias && max_anisotropy == rhs.max_anisotropy &&
+         min_lod == rhs.min_lod && max_lod == rhs.max_lod &&
+         compare_enable == rhs.compare_enable && compare_op == rhs.compare_op && 
+         border_color == rhs.border_color;
+   }
+
+   std::size_t sampler_desc_hash::operator( )( sampler_desc const& desc ) const noexcept
+   {
+      std::size_t seed = 0;
+
+      hash_combine( seed, static_cast<std::size_t>( desc.mag_filter ) );
+      hash_combine( seed, static_cast<std::size_t>( desc.min_filter ) );
+      hash_combine( seed, static_cast<std::size_t>( desc.mipmap_mode ) );
+      hash_combine( seed, static_cast<std::size_t>( desc.address_mode_u ) );
+      hash_combine( seed, static_cast<std::size_t>( desc.address_mode_v ) );
+      hash_combine( seed, static_cast<std::size_t>( desc.address_mode_w ) );
+      hash_combine( seed, hash_float( desc.mip_lod_bias ) );
+      hash_combine( seed, hash_float( desc.max_anisotropy ) );
+      hash_combine( seed, hash_float( desc.min_lod ) );
+      hash_combine( seed, hash_float( desc.max_lod ) );
+      hash_combine( seed, static_cast<std::size_t>( desc.compare_enable ) );
+      hash_combine( seed, static_cast<std::size_t>( desc.compare_op ) );
+      hash_combine( seed, static_cast<std::size_t>( desc.border_color ) );
+
+      return seed;
+   }
+
+   sampler_cache::sampler_cache( sampler_cache::create_info_t const& create_info )
+      :
+      p_context( create_info.value( ).p_context )
+   { }
+
+   sampler_cache::sampler_cache( sampler_cache&& rhs )
+   {
+      *this = std::move( rhs );
+   }
+
+   sampler_cache::~sampler_cache( )
+   {
+      destroy_samplers( );
+   }
+
+   sampler_cache& sampler_cache::operator=( sampler_cache&& rhs )
+   {
+      if ( this != &rhs )
+      {
+         std::scoped_lock lock( mutex, rhs.mutex );
+
+         destroy_samplers( );
+
+         p_context = rhs.p_context;
+         rhs.p_context = nullptr;
+
+         samplers = std::move( rhs.samplers );
+         rhs.samplers.clear( );
+      }
+
+      return *this;
+   }
+
+   std::variant<VkSampler, error> sampler_cache::get_sampler( sampler_desc const& desc )
+   {
+      std::scoped_lock lock( mutex );
+
+      if ( auto it = samplers.find( desc ); it != samplers.cend( ) )
+      {
+         return it->second;
+      }
+
+      VkSamplerCreateInfo const create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .magFilter = desc.mag_filter,
+         .minFilter = desc.min_filter,
+         .mipmapMode = desc.mipmap_mode,
+         .addressModeU = desc.address_mode_u,
+         .addressModeV = desc.address_mode_v,
+         .addressModeW = desc.address_mode_w,
+         .mipLodBias = desc.mip_lod_bias,
+         .anisotropyEnable = desc.max_anisotropy > 1.0f ? VK_TRUE : VK_FALSE,
+         .maxAnisotropy = desc.max_anisotropy,
+         .compareEnable = desc.compare_enable ? VK_TRUE : VK_FALSE,
+         .compareOp = desc.compare_op,
+         .minLod = desc.min_lod,
+         .maxLod = desc.max_lod,
+         .borderColor = desc.border_color,
+         .unnormalizedCoordinates = VK_FALSE
+      };
+
+      auto temp_sampler = p_context->create_sampler( sampler_create_info_t( create_info ) );
+      if ( auto const* p_val = std::get_if<VkSampler>( &temp_sampler ) )
+      {
+         samplers.emplace( desc, *p_val );
+      }
+
+      return temp_sampler;
+   }
+
+   std::size_t sampler_cache::get_sampler_count( ) const
+   {
+      std::scoped_lock lock( mutex );
+
+      return samplers.size( );
+   }
+
+   void sampler_cache::destroy_samplers( ) noexcept
+   {
+      if ( p_context != nullptr )
+      {
+         for( auto const& [desc, sampler] : samplers )
+         {
+            p_context->destroy_sampler( sampler_t( sampler ) );
+         }
+      }
+
+      samplers.clear( );
+   }
+} // namespace vk
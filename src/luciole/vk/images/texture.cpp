@@ -0,0 +1,175 @@
+/**
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/vk/images/texture.hpp>
+
+namespace vk
+{
+   texture::texture( texture::create_info_t const& create_info )
+      :
+      p_context( create_info.value( ).p_context ),
+      image( ),
+      format( create_info.value( ).format ),
+      extent( create_info.value( ).extent ),
+      mip_levels( create_info.value( ).mip_levels )
+   {
+      VkImageCreateInfo const image_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .imageType = VK_IMAGE_TYPE_2D,
+         .format = format,
+         .extent = { extent.width, extent.height, 1 },
+         .mipLevels = mip_levels,
+         .arrayLayers = 1,
+         .samples = VK_SAMPLE_COUNT_1_BIT,
+         .tiling = VK_IMAGE_TILING_OPTIMAL,
+         .usage = create_info.value( ).usage,
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr,
+         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+      };
+
+      VmaAllocationCreateInfo allocation_info = { };
+      allocation_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+      auto temp_image = p_context->create_image(
+         image_create_info_t( image_create_info ),
+         allocation_create_info_t( allocation_info ),
+         memory_category::e_image
+      );
+
+      if ( auto const* p_val = std::get_if<image_allocation>( &temp_image ) )
+      {
+         image = *p_val;
+      }
+      else
+      {
+         abort( );
+      }
+
+      VkImageViewCreateInfo const view_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .image = image.handle,
+         .viewType = VK_IMAGE_VIEW_TYPE_2D,
+         .format = format,
+         .components = 
+         { 
+            VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, 
+            VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY 
+         },
+         .subresourceRange = 
+         {
+            .aspectMask = create_info.value( ).aspect,
+            .baseMipLevel = 0,
+            .levelCount = mip_levels,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+         }
+      };
+
+      auto temp_view = p_context->create_image_view( image_view_create_info_t( view_create_info ) );
+      if ( auto const* p_val = std::get_if<VkImageView>( &temp_view ) )
+      {
+         image_view = *p_val;
+      }
+      else
+      {
+         abort( );
+      }
+   }
+
+   texture::texture( texture&& rhs )
+   {
+      *this = std::move( rhs );
+   }
+
+   texture::~texture( )
+   {
+      if ( p_context != nullptr )
+      {
+         if ( image_view != VK_NULL_HANDLE )
+         {
+            p_context->destroy_image_view( image_view_t( image_view ) );
+         }
+
+         p_context->destroy_image( image );
+      }
+   }
+
+   texture& texture::operator=( texture&& rhs )
+   {
+      if ( this != &rhs )
+      {
+         if ( p_context != nullptr )
+         {
+            if ( image_view != VK_NULL_HANDLE )
+            {
+               p_context->destroy_image_view( image_view_t( image_view ) );
+            }
+
+            p_context->destroy_image( image );
+         }
+
+         p_context = rhs.p_context;
+         rhs.p_context = nullptr;
+
+         image = rhs.image;
+         rhs.image = { };
+
+         image_view = rhs.image_view;
+         rhs.image_view = VK_NULL_HANDLE;
+
+         format = rhs.format;
+         extent = rhs.extent;
+         mip_levels = rhs.mip_levels;
+      }
+
+      return *this;
+   }
+
+   VkImage texture::get_image( ) const
+   {
+      return image.handle;
+   }
+
+   VkImageView texture::get_image_view( ) const
+   {
+      return image_view;
+   }
+
+   VkFormat texture::get_format( ) const
+   {
+      return format;
+   }
+
+   VkExtent2D texture::get_extent( ) const
+   {
+      return extent;
+   }
+
+   std::uint32_t texture::get_mip_levels( ) const
+   {
+      return mip_levels;
+   }
+} // namespace vk
@@ -0,0 +1,194 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/vk/memory_stats.hpp>
+
+#include <algorithm>
+
+namespace vk
+{
+   namespace
+   {
+      std::string const category_names[] =
+      {
+         "vertex buffer",
+         "index buffer",
+         "uniform buffer",
+         "staging buffer",
+         "image",
+         "other",
+         "unknown"
+      };
+
+      /**
+       * @brief Subtract every numerical value of two json objects of the
+       * same shape. Values only present in one of the objects are
+       * compared against 0.
+       */
+      nlohmann::json diff_numbers( nlohmann::json const& before, nlohmann::json const& after )
+      {
+         nlohmann::json res = nlohmann::json::object( );
+
+         auto const diff_value = [] ( nlohmann::json const* p_before, nlohmann::json const* p_after )
+         {
+            double const lhs = ( p_before != nullptr && p_before->is_number( ) ) ? p_before->get<double>( ) : 0.0;
+            double const rhs = ( p_after != nullptr && p_after->is_number( ) ) ? p_after->get<double>( ) : 0.0;
+
+            return rhs - lhs;
+         };
+
+         for( auto it = after.begin( ); it != after.end( ); ++it )
+         {
+            if ( it.value( ).is_number( ) )
+            {
+               auto const found = before.find( it.key( ) );
+               res[it.key( )] = diff_value( found != before.end( ) ? &found.value( ) : nullptr, &it.value( ) );
+            }
+         }
+
+         for( auto it = before.begin( ); it != before.end( ); ++it )
+         {
+            if ( it.value( ).is_number( ) && after.find( it.key( ) ) == after.end( ) )
+            {
+               res[it.key( )] = diff_value( &it.value( ), nullptr );
+            }
+         }
+
+         return res;
+      }
+   } // namespace
+
+   void memory_tracker::on_allocate( memory_category category, VkDeviceSize size, VkDeviceSize reserved_size ) noexcept
+   {
+      auto& counter = counters[static_cast<std::size_t>( category )];
+
+      counter.allocation_count.fetch_add( 1, std::memory_order_relaxed );
+      counter.reserved_bytes.fetch_add( reserved_size, std::memory_order_relaxed );
+
+      auto const used = counter.used_bytes.fetch_add( size, std::memory_order_relaxed ) + size;
+      auto peak = counter.peak_bytes.load( std::memory_order_relaxed );
+      while( used > peak && !counter.peak_bytes.compare_exchange_weak( peak, used, std::memory_order_relaxed ) ) { }
+   }
+
+   void memory_tracker::on_free( memory_category category, VkDeviceSize size, VkDeviceSize reserved_size ) noexcept
+   {
+      auto& counter = counters[static_cast<std::size_t>( category )];
+
+      counter.allocation_count.fetch_sub( 1, std::memory_order_relaxed );
+      counter.used_bytes.fetch_sub( size, std::memory_order_relaxed );
+      counter.reserved_bytes.fetch_sub( reserved_size, std::memory_order_relaxed );
+   }
+
+   std::array<memory_stats::category, memory_category_count> memory_tracker::get_categories( ) const noexcept
+   {
+      std::array<memory_stats::category, memory_category_count> categories;
+
+      for( std::size_t i = 0; i < memory_category_count; ++i )
+      {
+         categories[i] = memory_stats::category
+         {
+            .allocation_count = counters[i].allocation_count.load( std::memory_order_relaxed ),
+            .used_bytes = counters[i].used_bytes.load( std::memory_order_relaxed ),
+            .reserved_bytes = counters[i].reserved_bytes.load( std::memory_order_relaxed ),
+            .peak_bytes = counters[i].peak_bytes.load( std::memory_order_relaxed )
+         };
+      }
+
+      return categories;
+   }
+
+   std::string const& to_string( memory_category category )
+   {
+      return category_names[std::min( static_cast<std::size_t>( category ), memory_category_count )];
+   }
+
+   void to_json( nlohmann::json& j, memory_stats::heap const& heap )
+   {
+      j = nlohmann::json
+      {
+         { "index", heap.index },
+         { "device_local", heap.is_device_local },
+         { "heap_size", heap.heap_size },
+         { "block_count", heap.block_count },
+         { "allocation_count", heap.allocation_count },
+         { "used_bytes", heap.used_bytes },
+         { "reserved_bytes", heap.reserved_bytes },
+         { "fragmentation", heap.fragmentation }
+      };
+   }
+
+   void to_json( nlohmann::json& j, memory_stats::category const& category )
+   {
+      j = nlohmann::json
+      {
+         { "allocation_count", category.allocation_count },
+         { "used_bytes", category.used_bytes },
+         { "reserved_bytes", category.reserved_bytes },
+         { "peak_bytes", category.peak_bytes }
+      };
+   }
+
+   void to_json( nlohmann::json& j, memory_stats const& stats )
+   {
+      j = nlohmann::json::object( );
+      j["total"] = stats.total;
+      j["heaps"] = stats.heaps;
+
+      auto& categories = j["categories"] = nlohmann::json::object( );
+      for( std::size_t i = 0; i < memory_category_count; ++i )
+      {
+         categories[to_string( static_cast<memory_category>( i ) )] = stats.categories[i];
+      }
+   }
+
+   nlohmann::json diff_memory_stats( nlohmann::json const& before, nlohmann::json const& after )
+   {
+      nlohmann::json res = nlohmann::json::object( );
+
+      res["total"] = diff_numbers( before.value( "total", nlohmann::json::object( ) ), after.value( "total", nlohmann::json::object( ) ) );
+
+      auto const& before_heaps = before.value( "heaps", nlohmann::json::array( ) );
+      auto const& after_heaps = after.value( "heaps", nlohmann::json::array( ) );
+      auto& heaps = res["heaps"] = nlohmann::json::array( );
+      for( std::size_t i = 0; i < std::max( before_heaps.size( ), after_heaps.size( ) ); ++i )
+      {
+         auto const lhs = i < before_heaps.size( ) ? before_heaps[i] : nlohmann::json::object( );
+         auto const rhs = i < after_heaps.size( ) ? after_heaps[i] : nlohmann::json::object( );
+
+         auto heap = diff_numbers( lhs, rhs );
+         heap["index"] = i;
+
+         heaps.push_back( heap );
+      }
+
+      auto const& before_categories = before.value( "categories", nlohmann::json::object( ) );
+      auto const& after_categories = after.value( "categories", nlohmann::json::object( ) );
+      auto& categories = res["categories"] = nlohmann::json::object( );
+      for( std::size_t i = 0; i < memory_category_count; ++i )
+      {
+         auto const& name = to_string( static_cast<memory_category>( i ) );
+
+         categories[name] = diff_numbers(
+            before_categories.value( name, nlohmann::json::object( ) ),
+            after_categories.value( name, nlohmann::json::object( ) )
+         );
+      }
+
+      return res;
+   }
+} // namespace vk
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/vk/memory_stats_recorder.hpp>
+
+namespace vk
+{
+   memory_stats_recorder::memory_stats_recorder( create_info_t const& create_info )
+      :
+      p_context( create_info.value( ).p_context ),
+      directory( create_info.value( ).directory ),
+      interval( create_info.value( ).interval ),
+      detailed( create_info.value( ).detailed ),
+      last_dump_time( std::chrono::steady_clock::now( ) ),
+      dump_count( 0 )
+   { }
+
+   bool memory_stats_recorder::update( )
+   {
+      if ( p_context == nullptr || std::chrono::steady_clock::now( ) - last_dump_time < interval )
+      {
+         return false;
+      }
+
+      record( );
+
+      return true;
+   }
+
+   void memory_stats_recorder::record( )
+   {
+      p_context->dump_memory_stats( directory + "/memory_stats_" + std::to_string( dump_count ) + ".json", detailed );
+
+      last_dump_time = std::chrono::steady_clock::now( );
+      ++dump_count;
+   }
+
+   std::uint32_t memory_stats_recorder::get_dump_count( ) const noexcept
+   {
+      return dump_count;
+   }
+} // namespace vk
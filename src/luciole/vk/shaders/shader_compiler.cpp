@@ -19,6 +19,9 @@
 #include <luciole/utils/file_io.hpp>
 #include <luciole/vk/shaders/shader_compiler.hpp>
 
+#include <cstring>
+#include <stdexcept>
+
 namespace vk
 {
    const TBuiltInResource default_built_in_resource = {
@@ -128,6 +131,17 @@ namespace vk
       }
    };
 
+   /**
+    * @brief Bumped whenever the compile options or glslang change the
+    * SPIR-V output.
+    */
+   static constexpr std::uint32_t spir_v_importer_version = 1;
+
+   shader_compiler::shader_compiler( assets::derived_data_cache* p_cache )
+      :
+      p_cache( p_cache )
+   {  }
+
    shader_compiler::shader_data shader_compiler::load_shader( shader::filepath_view_t filepath ) const
    {   
       std::string data = read_from_file( filepath.value( ) );
@@ -163,7 +177,28 @@ namespace vk
       if ( !glsl_shader.preprocess( &resources, default_version, ENoProfile, false,
          false, messages, &preprocessed_glsl, includer ) )
       {
-         // handle error.
+         throw std::runtime_error{ "Shader Preprocessing Error: " + std::string( filepath.value( ) ) + ": " + glsl_shader.getInfoLog( ) };
+      }
+
+      // The preprocessed source has the includes expanded, so it is all 
+      // the SPIR-V depends on along with the compile options.
+      auto const key = assets::derived_data_key
+      {
+         .importer = "spir_v",
+         .importer_version = spir_v_importer_version,
+         .source_hash = assets::hash_bytes( preprocessed_glsl.data( ), preprocessed_glsl.size( ) ),
+         .settings = std::string( get_suffix( filepath.value( ) ) ) + " vulkan1.1 spv1.4"
+      };
+
+      if ( p_cache != nullptr )
+      {
+         if ( auto const cooked = p_cache->load( key ); cooked && cooked->size( ) % sizeof( std::uint32_t ) == 0 )
+         {
+            std::vector<std::uint32_t> spir_v( cooked->size( ) / sizeof( std::uint32_t ) );
+            std::memcpy( spir_v.data( ), cooked->data( ), cooked->size( ) );
+
+            return std::pair{ spir_v, get_shader_type( shader_stage ) };
+         }
       }
 
       char const* raw_preprocessed_glsl = preprocessed_glsl.c_str( );
@@ -172,7 +207,7 @@ namespace vk
 
       if (!glsl_shader.parse( &resources, default_version, false, messages ) )
       {
-         // handle error
+         throw std::runtime_error{ "Shader Parsing Error: " + std::string( filepath.value( ) ) + ": " + glsl_shader.getInfoLog( ) };
       }
 
       glslang::TProgram program;
@@ -180,7 +215,7 @@ namespace vk
 
       if ( !program.link(messages ) )
       {
-         // handle error
+         throw std::runtime_error{ "Shader Linking Error: " + std::string( filepath.value( ) ) + ": " + program.getInfoLog( ) };
       }
 
       std::vector<std::uint32_t> spir_v;
@@ -190,6 +225,21 @@ namespace vk
 
       glslang::GlslangToSpv( *program.getIntermediate( shader_stage ), spir_v, &logger, &spv_options );
 
+      if ( p_cache != nullptr && !spir_v.empty( ) )
+      {
+         std::vector<std::byte> cooked( spir_v.size( ) * sizeof( std::uint32_t ) );
+         std::memcpy( cooked.data( ), spir_v.data( ), cooked.size( ) );
+
+         try
+         {
+            p_cache->store( key, cooked );
+         }
+         catch( std::runtime_error const& )
+         {
+            /* the shader is still good if the cache cannot be written to */
+         }
+      }
+
       return std::pair{ spir_v, get_shader_type( shader_stage ) };
    }
 
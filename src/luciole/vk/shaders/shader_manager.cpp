@@ -31,7 +31,7 @@ namespace vk
       }
    }
 
-   shader_manager::shader_manager( p_context_t const& p_context )
+   shader_manager::shader_manager( p_context_t const& p_context, thread_pool* p_thread_pool )
       :
       p_context( p_context.value( ) )
    {
@@ -40,6 +40,21 @@ namespace vk
          glslang::InitializeProcess( );
          GLSLANG_INITIALIZED = true;
       }
+
+      using cache_t = assets::asset_cache<shader, shader_loader_interface::shader_data>;
+
+      auto cache_create_info = cache_t::create_info( );
+      cache_create_info.p_thread_pool = p_thread_pool;
+      cache_create_info.finalize = [p_context = this->p_context] ( shader_loader_interface::shader_data&& shader_data ) {
+         auto create_info = shader::create_info( );
+         create_info.p_context = p_context;
+         create_info.spir_v = std::move( shader_data.first );
+         create_info.shader_type = shader_data.second;
+
+         return shader( shader::create_info_t( create_info ) );
+      };
+
+      shader_cache = cache_t( cache_t::create_info_t( cache_create_info ) );
    }
 
    shader_manager::shader_manager( shader_manager&& rhs )
@@ -56,7 +71,11 @@ namespace vk
    {
       if ( this != &rhs )
       {
-         
+         p_context = rhs.p_context;
+         rhs.p_context = nullptr;
+
+         shaders = std::move( rhs.shaders );
+         shader_cache = std::move( rhs.shader_cache );
       }
 
       return *this;
@@ -77,4 +96,16 @@ namespace vk
 
       return id;
    }
+
+   assets::asset_handle<shader> shader_manager::request_shader( shader_loader_interface const* p_loader, shader::filepath_t const& filepath )
+   {
+      return shader_cache.request( filepath.value( ), [p_loader] ( std::string const& path ) {
+         return p_loader->load_shader( vk::shader::filepath_view_t( path ) );
+      } );
+   }
+
+   void shader_manager::update( )
+   {
+      shader_cache.update( );
+   }
 } // namespace vk
@@ -0,0 +1,327 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/aabb_tree.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+   struct object
+   {
+      std::uint32_t proxy = gfx::aabb_tree::null_proxy;
+      gfx::aabb box;
+   }; // struct object
+
+   /**
+    * @brief A tree next to the list of its objects, to check the queries
+    * against testing every object. The queries report fat boxes, so the 
+    * brute force tests read the fat boxes from the tree.
+    */
+   class aabb_tree_test : public ::testing::Test
+   {
+   protected:
+      gfx::aabb make_box( )
+      {
+         glm::vec3 const min( position( rng ), position( rng ), position( rng ) );
+         return gfx::aabb{ min, min + glm::vec3( size( rng ), size( rng ), size( rng ) ) };
+      }
+
+      void insert( std::uint32_t count )
+      {
+         for( std::uint32_t i = 0; i < count; ++i )
+         {
+            auto const id = static_cast<std::uint32_t>( objects.size( ) );
+            auto const box = make_box( );
+
+            objects.push_back( object{ tree.insert( box, id ), box } );
+         }
+      }
+
+      /**
+       * @brief Move, remove and add objects at random, some by a little
+       * so they stay in their fat box and some across the world.
+       */
+      void shuffle( std::uint32_t step_count )
+      {
+         std::uniform_int_distribution<std::uint32_t> action( 0, 9 );
+         std::uniform_real_distribution<float> nudge( -0.05f, 0.05f );
+
+         for( std::uint32_t step = 0; step < step_count; ++step )
+         {
+            std::uniform_int_distribution<std::size_t> pick( 0, objects.size( ) - 1 );
+            auto& o = objects[pick( rng )];
+            auto const a = action( rng );
+
+            if ( o.proxy == gfx::aabb_tree::null_proxy )
+            {
+               o.box = make_box( );
+               o.proxy = tree.insert( o.box, static_cast<std::uint32_t>( &o - objects.data( ) ) );
+            }
+            else if ( a < 2 )
+            {
+               tree.remove( o.proxy );
+               o.proxy = gfx::aabb_tree::null_proxy;
+            }
+            else if ( a < 6 )
+            {
+               glm::vec3 const offset( nudge( rng ), nudge( rng ), nudge( rng ) );
+               o.box = gfx::aabb{ o.box.min + offset, o.box.max + offset };
+               tree.move( o.proxy, o.box );
+            }
+            else
+            {
+               o.box = make_box( );
+               tree.move( o.proxy, o.box );
+            }
+         }
+      }
+
+      template<typename F>
+      std::vector<std::uint32_t> brute_force( F&& is_hit ) const
+      {
+         std::vector<std::uint32_t> hits;
+         for( std::uint32_t i = 0; i < objects.size( ); ++i )
+         {
+            if ( objects[i].proxy != gfx::aabb_tree::null_proxy && is_hit( tree.get_fat_box( objects[i].proxy ) ) )
+            {
+               hits.push_back( i );
+            }
+         }
+
+         return hits;
+      }
+
+      template<typename Q>
+      static std::vector<std::uint32_t> collect( Q&& query )
+      {
+         std::vector<std::uint32_t> hits;
+         query( [&hits] ( std::uint32_t id ) { hits.push_back( id ); } );
+         std::sort( hits.begin( ), hits.end( ) );
+
+         return hits;
+      }
+
+      void check_boxes( ) const
+      {
+         std::uint32_t proxy_count = 0;
+         for( std::uint32_t i = 0; i < objects.size( ); ++i )
+         {
+            if ( objects[i].proxy != gfx::aabb_tree::null_proxy )
+            {
+               ++proxy_count;
+               EXPECT_TRUE( tree.get_fat_box( objects[i].proxy ).contains( objects[i].box ) ) << "object " << i;
+               EXPECT_EQ( tree.get_user_data( objects[i].proxy ), i );
+            }
+         }
+
+         EXPECT_EQ( tree.get_proxy_count( ), proxy_count );
+      }
+
+      void check_box_queries( )
+      {
+         for( std::uint32_t i = 0; i < 50; ++i )
+         {
+            gfx::aabb query = make_box( );
+            query.max += glm::vec3( 40.0f );
+
+            EXPECT_EQ( collect( [&] ( auto&& f ) { tree.query_box( query, f ); } ), 
+               brute_force( [&] ( gfx::aabb const& box ) { return box.overlaps( query ); } ) );
+         }
+      }
+
+      void check_sphere_queries( )
+      {
+         std::uniform_real_distribution<float> radius( 0.0f, 60.0f );
+
+         for( std::uint32_t i = 0; i < 50; ++i )
+         {
+            glm::vec3 const center( position( rng ), position( rng ), position( rng ) );
+            float const r = radius( rng );
+
+            auto const is_hit = [&] ( gfx::aabb const& box )
+            {
+               glm::vec3 const offset = glm::clamp( center, box.min, box.max ) - center;
+               return glm::dot( offset, offset ) <= r * r;
+            };
+
+            EXPECT_EQ( collect( [&] ( auto&& f ) { tree.query_sphere( center, r, f ); } ), brute_force( is_hit ) );
+         }
+      }
+
+      void check_frustum_queries( )
+      {
+         std::uniform_real_distribution<float> direction( -1.0f, 1.0f );
+
+         for( std::uint32_t i = 0; i < 20; ++i )
+         {
+            glm::vec3 const eye( position( rng ), position( rng ), position( rng ) );
+            glm::vec3 const target = eye + glm::vec3( direction( rng ), direction( rng ), direction( rng ) );
+
+            glm::mat4 const view = glm::lookAt( eye, target, glm::vec3( 0.0f, 0.0f, 1.0f ) );
+            glm::mat4 const projection = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 300.0f );
+            auto const f = gfx::make_frustum( projection * view );
+
+            auto const is_hit = [&] ( gfx::aabb const& box )
+            {
+               glm::vec3 const center = ( box.min + box.max ) * 0.5f;
+               glm::vec3 const extent = ( box.max - box.min ) * 0.5f;
+
+               return std::all_of( f.planes.begin( ), f.planes.end( ), [&] ( glm::vec4 const& plane )
+               {
+                  float const distance = glm::dot( glm::vec3( plane ), center ) + plane.w;
+                  float const reach = glm::dot( glm::abs( glm::vec3( plane ) ), extent );
+
+                  return distance + reach >= 0.0f;
+               } );
+            };
+
+            EXPECT_EQ( collect( [&] ( auto&& fn ) { tree.query_frustum( f, fn ); } ), brute_force( is_hit ) );
+         }
+      }
+
+      /**
+       * @brief The closest hit of rays against the real boxes, through
+       * the tree and through every object.
+       */
+      void check_raycasts( )
+      {
+         std::uniform_real_distribution<float> direction( -1.0f, 1.0f );
+         float constexpr ray_length = 1000.0f;
+
+         for( std::uint32_t i = 0; i < 50; ++i )
+         {
+            glm::vec3 const origin( position( rng ), position( rng ), position( rng ) );
+            glm::vec3 const dir = glm::normalize( glm::vec3( direction( rng ), direction( rng ), direction( rng ) ) );
+            glm::vec3 const inverse_direction = 1.0f / dir;
+
+            float expected = ray_length;
+            for( auto const& o : objects )
+            {
+               if ( o.proxy != gfx::aabb_tree::null_proxy )
+               {
+                  expected = std::min( expected, get_ray_distance( o.box, origin, inverse_direction ) );
+               }
+            }
+
+            float hit = ray_length;
+            tree.raycast( origin, dir, ray_length, [&] ( std::uint32_t id, float max_distance ) 
+            {
+               hit = std::min( max_distance, get_ray_distance( objects[id].box, origin, inverse_direction ) );
+               return hit;
+            } );
+
+            EXPECT_EQ( hit, expected ) << "ray " << i;
+         }
+      }
+
+      void check_queries( )
+      {
+         check_boxes( );
+         check_box_queries( );
+         check_sphere_queries( );
+         check_frustum_queries( );
+         check_raycasts( );
+      }
+
+   private:
+      static float get_ray_distance( gfx::aabb const& b, glm::vec3 const& origin, glm::vec3 const& inverse_direction )
+      {
+         glm::vec3 const t_1 = ( b.min - origin ) * inverse_direction;
+         glm::vec3 const t_2 = ( b.max - origin ) * inverse_direction;
+
+         glm::vec3 const t_near = glm::min( t_1, t_2 );
+         glm::vec3 const t_far = glm::max( t_1, t_2 );
+
+         float const enter = std::max( std::max( t_near.x, t_near.y ), std::max( t_near.z, 0.0f ) );
+         float const exit = std::min( std::min( t_far.x, t_far.y ), t_far.z );
+
+         return enter <= exit ? enter : std::numeric_limits<float>::infinity( );
+      }
+
+   protected:
+      gfx::aabb_tree tree;
+      std::vector<object> objects;
+
+      std::mt19937 rng{ 42 };
+      std::uniform_real_distribution<float> position{ -200.0f, 200.0f };
+      std::uniform_real_distribution<float> size{ 0.5f, 8.0f };
+   }; // class aabb_tree_test
+} // namespace
+
+TEST_F( aabb_tree_test, empty )
+{
+   EXPECT_EQ( tree.get_height( ), 0u );
+   check_queries( );
+}
+
+TEST_F( aabb_tree_test, queries_after_inserts )
+{
+   insert( 3000 );
+
+   EXPECT_LT( tree.get_height( ), 40u );
+   check_queries( );
+}
+
+TEST_F( aabb_tree_test, queries_after_moves_and_removals )
+{
+   insert( 3000 );
+
+   for( std::uint32_t round = 0; round < 5; ++round )
+   {
+      shuffle( 2000 );
+      check_queries( );
+   }
+}
+
+TEST_F( aabb_tree_test, queries_after_set_box_and_refit )
+{
+   insert( 2000 );
+   shuffle( 1000 );
+
+   std::uniform_real_distribution<float> drift( -3.0f, 3.0f );
+   for( auto& o : objects )
+   {
+      if ( o.proxy != gfx::aabb_tree::null_proxy )
+      {
+         glm::vec3 const offset( drift( rng ), drift( rng ), drift( rng ) );
+         o.box = gfx::aabb{ o.box.min + offset, o.box.max + offset };
+         tree.set_box( o.proxy, o.box );
+      }
+   }
+
+   tree.refit( );
+   check_queries( );
+}
+
+TEST_F( aabb_tree_test, queries_after_clear )
+{
+   insert( 100 );
+   tree.clear( );
+   objects.clear( );
+
+   insert( 500 );
+   check_queries( );
+}
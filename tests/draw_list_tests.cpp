@@ -0,0 +1,264 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/draw_list.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+   /**
+    * @brief Draws sharing a few pipelines, materials and meshes, one in 
+    * ten in a blended pass. The translation of each transform holds the 
+    * index of the draw, to read the order back from the instance data.
+    */
+   std::vector<gfx::draw_list::draw_item> make_items( std::uint32_t count, std::uint32_t seed )
+   {
+      std::mt19937 rng( seed );
+      std::uniform_int_distribution<std::uint32_t> pipeline( 0, 7 );
+      std::uniform_int_distribution<std::uint32_t> material( 0, 31 );
+      std::uniform_int_distribution<std::uint32_t> mesh( 0, 63 );
+      std::uniform_real_distribution<float> depth( 0.0f, 1.0f );
+
+      std::vector<gfx::draw_list::draw_item> items( count );
+      for( std::uint32_t i = 0; i < count; ++i )
+      {
+         auto& item = items[i];
+         item.pass = i % 10 == 0 ? 1 : 0;
+         item.pipeline = pipeline( rng );
+         item.material = material( rng ) % ( item.pass == 1 ? 4 : 32 );
+         item.mesh = mesh( rng );
+         item.depth = depth( rng );
+         item.transform[3] = glm::vec4( static_cast<float>( i ), 0.0f, 0.0f, 1.0f );
+      }
+
+      return items;
+   }
+
+   void build( gfx::draw_list& list, std::vector<gfx::draw_list::draw_item> const& items )
+   {
+      list.set_depth_order( 1, gfx::draw_list::depth_order::e_back_to_front );
+
+      list.clear( );
+      for( auto const& item : items )
+      {
+         list.add( item );
+      }
+
+      list.build( );
+   }
+
+   std::vector<std::uint32_t> get_order( gfx::draw_list const& list )
+   {
+      std::vector<std::uint32_t> order( list.get_stats( ).item_count );
+      for( std::uint32_t i = 0; i < order.size( ); ++i )
+      {
+         order[i] = static_cast<std::uint32_t>( list.get_instance_data( )[i][3].x );
+      }
+
+      return order;
+   }
+
+   /**
+    * @brief The reference order: a stable sort of the keys.
+    */
+   std::vector<std::uint32_t> get_stable_sort_order( std::vector<gfx::draw_list::draw_item> const& items )
+   {
+      std::vector<std::uint64_t> keys( items.size( ) );
+      for( std::uint32_t i = 0; i < items.size( ); ++i )
+      {
+         auto const depth_order = items[i].pass == 1 ? gfx::draw_list::depth_order::e_back_to_front : gfx::draw_list::depth_order::e_front_to_back;
+         keys[i] = gfx::draw_list::make_sort_key( items[i], depth_order );
+      }
+
+      std::vector<std::uint32_t> order( items.size( ) );
+      std::iota( order.begin( ), order.end( ), 0u );
+      std::stable_sort( order.begin( ), order.end( ), [&keys] ( std::uint32_t lhs, std::uint32_t rhs ) { return keys[lhs] < keys[rhs]; } );
+
+      return order;
+   }
+
+   constexpr std::uint32_t item_counts[] = { 0, 1, 2, 255, 256, 257, 10000, 200000 };
+} // namespace
+
+TEST( draw_list, radix_sort_matches_stable_sort )
+{
+   for( auto const count : item_counts )
+   {
+      auto const items = make_items( count, count );
+
+      gfx::draw_list list;
+      build( list, items );
+
+      EXPECT_EQ( get_order( list ), get_stable_sort_order( items ) ) << count << " items";
+   }
+}
+
+TEST( draw_list, serial_matches_pooled )
+{
+   thread_pool pool;
+
+   for( auto const items_per_job : { 1u, 100u, 16384u } )
+   {
+      gfx::draw_list::create_info const create_info 
+      {
+         .p_thread_pool = &pool,
+         .items_per_job = items_per_job
+      };
+
+      for( auto const count : item_counts )
+      {
+         if ( items_per_job == 1 && count > 10000 )
+         {
+            continue;
+         }
+
+         auto const items = make_items( count, count + 1 );
+
+         gfx::draw_list serial_list;
+         auto pooled_list = gfx::draw_list( gfx::draw_list::create_info_t( create_info ) );
+         build( serial_list, items );
+         build( pooled_list, items );
+
+         EXPECT_EQ( get_order( serial_list ), get_order( pooled_list ) ) << count << " items, " << items_per_job << " per job";
+         EXPECT_EQ( get_order( pooled_list ), get_stable_sort_order( items ) ) << count << " items, " << items_per_job << " per job";
+         EXPECT_EQ( serial_list.get_batches( ).size( ), pooled_list.get_batches( ).size( ) );
+      }
+   }
+}
+
+TEST( draw_list, batches_cover_the_instances )
+{
+   auto const items = make_items( 50000, 3 );
+
+   gfx::draw_list list;
+   build( list, items );
+
+   auto const order = get_order( list );
+   auto const& batches = list.get_batches( );
+   auto const& stats = list.get_stats( );
+
+   ASSERT_FALSE( batches.empty( ) );
+   EXPECT_LT( batches.size( ), items.size( ) );
+   EXPECT_EQ( stats.draw_count, batches.size( ) );
+
+   std::uint32_t next_instance = 0;
+   gfx::draw_list::stats counted;
+   for( std::size_t b = 0; b < batches.size( ); ++b )
+   {
+      auto const& batch = batches[b];
+
+      EXPECT_EQ( batch.first_instance, next_instance );
+      ASSERT_GT( batch.instance_count, 0u );
+      next_instance += batch.instance_count;
+
+      for( std::uint32_t i = batch.first_instance; i < batch.first_instance + batch.instance_count; ++i )
+      {
+         auto const& item = items[order[i]];
+
+         ASSERT_EQ( item.pass, batch.pass );
+         ASSERT_EQ( item.pipeline, batch.pipeline );
+         ASSERT_EQ( item.material, batch.material );
+         ASSERT_EQ( item.mesh, batch.mesh );
+      }
+
+      bool const is_first = b == 0 || batches[b - 1].pass != batch.pass;
+      EXPECT_EQ( batch.is_pass_changed, is_first );
+      EXPECT_EQ( batch.is_pipeline_changed, is_first || batches[b - 1].pipeline != batch.pipeline );
+      EXPECT_EQ( batch.is_material_changed, is_first || batches[b - 1].material != batch.material );
+      EXPECT_EQ( batch.is_mesh_changed, is_first || batches[b - 1].mesh != batch.mesh );
+
+      counted.pass_count += batch.is_pass_changed;
+      counted.pipeline_bind_count += batch.is_pipeline_changed;
+      counted.material_bind_count += batch.is_material_changed;
+      counted.mesh_bind_count += batch.is_mesh_changed;
+   }
+
+   EXPECT_EQ( next_instance, items.size( ) );
+   EXPECT_EQ( stats.item_count, items.size( ) );
+   EXPECT_EQ( stats.pass_count, counted.pass_count );
+   EXPECT_EQ( stats.pipeline_bind_count, counted.pipeline_bind_count );
+   EXPECT_EQ( stats.material_bind_count, counted.material_bind_count );
+   EXPECT_EQ( stats.mesh_bind_count, counted.mesh_bind_count );
+}
+
+TEST( draw_list, orders_passes_by_depth )
+{
+   auto const items = make_items( 20000, 4 );
+
+   gfx::draw_list list;
+   build( list, items );
+
+   auto const order = get_order( list );
+   for( std::size_t i = 1; i < order.size( ); ++i )
+   {
+      auto const& previous = items[order[i - 1]];
+      auto const& current = items[order[i]];
+
+      ASSERT_LE( previous.pass, current.pass );
+      if ( previous.pass == 1 && current.pass == 1 )
+      {
+         /* blended draws go back to front, up to the quantization of the depth */
+         EXPECT_GE( previous.depth + 1.0f / 65535.0f, current.depth );
+      }
+   }
+}
+
+TEST( draw_list, skips_radix_passes_of_equal_digits )
+{
+   std::vector<gfx::draw_list::draw_item> items( 1000 );
+   for( std::uint32_t i = 0; i < items.size( ); ++i )
+   {
+      items[i].mesh = i % 3;
+      items[i].transform[3] = glm::vec4( static_cast<float>( i ), 0.0f, 0.0f, 1.0f );
+   }
+
+   gfx::draw_list list;
+   build( list, items );
+
+   EXPECT_GE( list.get_stats( ).skipped_sort_pass_count, 7u );
+   EXPECT_EQ( list.get_batches( ).size( ), 3u );
+   EXPECT_EQ( get_order( list ), get_stable_sort_order( items ) );
+}
+
+TEST( draw_list, rebuilds_smaller_frames )
+{
+   gfx::draw_list list;
+
+   auto const large = make_items( 5000, 5 );
+   build( list, large );
+
+   auto const small = make_items( 100, 6 );
+   build( list, small );
+
+   EXPECT_EQ( list.get_stats( ).item_count, small.size( ) );
+   EXPECT_EQ( get_order( list ), get_stable_sort_order( small ) );
+
+   std::uint32_t instance_count = 0;
+   for( auto const& batch : list.get_batches( ) )
+   {
+      instance_count += batch.instance_count;
+   }
+   EXPECT_EQ( instance_count, small.size( ) );
+}
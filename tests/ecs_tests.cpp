@@ -0,0 +1,301 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/sys/command_buffer.hpp>
+#include <luciole/sys/world.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+   struct position
+   {
+      float x = 0.0f;
+   }; // struct position
+
+   struct velocity
+   {
+      float x = 0.0f;
+   }; // struct velocity
+
+   /**
+    * @brief A component that counts how many of it are alive, to catch
+    * components that are lost or destroyed twice when rows move.
+    */
+   struct tracked
+   {
+      inline static int live_count = 0;
+
+      explicit tracked( std::string name ) : name( std::move( name ) ) { ++live_count; }
+      tracked( tracked const& rhs ) : name( rhs.name ) { ++live_count; }
+      tracked( tracked&& rhs ) noexcept : name( std::move( rhs.name ) ) { ++live_count; }
+      ~tracked( ) { --live_count; }
+
+      tracked& operator=( tracked const& rhs ) = default;
+      tracked& operator=( tracked&& rhs ) noexcept = default;
+
+      std::string name;
+   }; // struct tracked
+
+   std::string make_name( std::size_t i )
+   {
+      // Long enough not to fit in the small string buffer.
+      return "an entity with a long name, number " + std::to_string( i );
+   }
+} // namespace
+
+TEST( ecs, destroy_keeps_other_handles_valid )
+{
+   sys::world world;
+
+   std::vector<sys::entity> entities;
+   for( std::size_t i = 0; i < 5000; ++i )
+   {
+      entities.push_back( world.create( position{ static_cast<float>( i ) }, tracked( make_name( i ) ) ) );
+   }
+
+   /* every destroy moves the last row of the archetype into the hole */
+   for( std::size_t i = 0; i < entities.size( ); i += 3 )
+   {
+      world.destroy( entities[i] );
+   }
+
+   EXPECT_EQ( world.get_entity_count( ), 5000u - 1667u );
+   EXPECT_EQ( tracked::live_count, 5000 - 1667 );
+
+   for( std::size_t i = 0; i < entities.size( ); ++i )
+   {
+      if ( i % 3 == 0 )
+      {
+         EXPECT_FALSE( world.is_alive( entities[i] ) );
+         EXPECT_EQ( world.get<position>( entities[i] ), nullptr );
+      }
+      else
+      {
+         ASSERT_TRUE( world.is_alive( entities[i] ) );
+         EXPECT_EQ( world.get<position>( entities[i] )->x, static_cast<float>( i ) );
+         EXPECT_EQ( world.get<tracked>( entities[i] )->name, make_name( i ) );
+      }
+   }
+
+   /* new entities reuse the slots with another generation */
+   auto const reused = world.create( position{ -1.0f } );
+   EXPECT_TRUE( world.is_alive( reused ) );
+   for( std::size_t i = 0; i < entities.size( ); i += 3 )
+   {
+      EXPECT_NE( entities[i], reused );
+      EXPECT_FALSE( world.is_alive( entities[i] ) );
+   }
+
+   world.destroy( entities[0] );
+   EXPECT_TRUE( world.is_alive( reused ) );
+}
+
+TEST( ecs, add_and_remove_move_entities_between_archetypes )
+{
+   {
+      sys::world world;
+
+      std::vector<sys::entity> entities;
+      for( std::size_t i = 0; i < 1000; ++i )
+      {
+         entities.push_back( world.create( position{ static_cast<float>( i ) }, tracked( make_name( i ) ) ) );
+      }
+
+      for( std::size_t i = 0; i < entities.size( ); i += 2 )
+      {
+         world.add( entities[i], velocity{ 1.0f } );
+      }
+
+      std::size_t moving_count = 0;
+      world.each<position, velocity const>( [&] ( position& p, velocity const& v ) 
+      { 
+         p.x += v.x; 
+         ++moving_count;
+      } );
+      EXPECT_EQ( moving_count, 500u );
+
+      for( std::size_t i = 0; i < entities.size( ); ++i )
+      {
+         float const expected = static_cast<float>( i ) + ( i % 2 == 0 ? 1.0f : 0.0f );
+
+         EXPECT_EQ( world.has<velocity>( entities[i] ), i % 2 == 0 );
+         EXPECT_EQ( world.get<position>( entities[i] )->x, expected );
+         EXPECT_EQ( world.get<tracked>( entities[i] )->name, make_name( i ) );
+      }
+
+      /* adding an existing component replaces it without moving the entity */
+      std::size_t const archetype_count = world.get_archetype_count( );
+      world.add( entities[0], velocity{ 5.0f } );
+      EXPECT_EQ( world.get<velocity>( entities[0] )->x, 5.0f );
+      EXPECT_EQ( world.get_archetype_count( ), archetype_count );
+
+      for( std::size_t i = 0; i < entities.size( ); i += 2 )
+      {
+         world.remove<position>( entities[i] );
+      }
+
+      world.remove<position>( entities[0] );
+      world.destroy( entities[1] );
+      world.remove<position>( entities[1] );
+
+      std::size_t positioned_count = 0;
+      world.each<position>( [&] ( sys::entity e, position& ) 
+      { 
+         EXPECT_FALSE( world.has<velocity>( e ) );
+         ++positioned_count;
+      } );
+      EXPECT_EQ( positioned_count, 499u );
+
+      for( std::size_t i = 2; i < entities.size( ); ++i )
+      {
+         EXPECT_EQ( world.has<position>( entities[i] ), i % 2 == 1 );
+         EXPECT_EQ( world.get<tracked>( entities[i] )->name, make_name( i ) );
+      }
+
+      EXPECT_EQ( tracked::live_count, 999 );
+      EXPECT_THROW( world.add( entities[1], velocity{ } ), std::runtime_error );
+   }
+
+   EXPECT_EQ( tracked::live_count, 0 );
+}
+
+TEST( ecs, command_buffer_pending_handles )
+{
+   {
+      sys::world world;
+      sys::command_buffer buffer;
+
+      auto const existing = world.create( position{ 1.0f } );
+
+      auto const first = buffer.create( position{ 2.0f } );
+      auto const second = buffer.create( );
+      auto const third = buffer.create( tracked( make_name( 3 ) ) );
+
+      EXPECT_TRUE( sys::command_buffer::is_pending( first ) );
+      EXPECT_TRUE( sys::command_buffer::is_pending( second ) );
+      EXPECT_NE( first, second );
+
+      /* later commands of the buffer use the pending handles */
+      buffer.add( first, velocity{ 3.0f } );
+      buffer.add( second, tracked( make_name( 2 ) ) );
+      buffer.add( second, velocity{ 4.0f } );
+      buffer.add( second, velocity{ 5.0f } );
+      buffer.remove<position>( first );
+      buffer.destroy( third );
+      buffer.add( third, velocity{ 6.0f } );
+      buffer.add( existing, velocity{ 7.0f } );
+
+      EXPECT_EQ( world.get_entity_count( ), 1u );
+      EXPECT_FALSE( buffer.is_empty( ) );
+
+      world.execute( buffer );
+
+      EXPECT_TRUE( buffer.is_empty( ) );
+      EXPECT_EQ( world.get_entity_count( ), 3u );
+      EXPECT_EQ( tracked::live_count, 1 );
+
+      std::vector<float> velocities;
+      world.each<velocity const>( [&] ( sys::entity e, velocity const& v ) 
+      { 
+         velocities.push_back( v.x );
+
+         if ( v.x == 3.0f )
+         {
+            EXPECT_FALSE( world.has<position>( e ) );
+         }
+         else if ( v.x == 5.0f )
+         {
+            EXPECT_EQ( world.get<tracked>( e )->name, make_name( 2 ) );
+         }
+         else
+         {
+            EXPECT_EQ( e, existing );
+            EXPECT_EQ( world.get<position>( e )->x, 1.0f );
+         }
+      } );
+
+      std::sort( velocities.begin( ), velocities.end( ) );
+      EXPECT_EQ( velocities, ( std::vector<float>{ 3.0f, 5.0f, 7.0f } ) );
+
+      /* components left in a buffer that never runs are still destroyed */
+      sys::command_buffer unused;
+      unused.create( tracked( make_name( 4 ) ) );
+      EXPECT_EQ( tracked::live_count, 2 );
+   }
+
+   EXPECT_EQ( tracked::live_count, 0 );
+}
+
+TEST( ecs, command_buffer_skips_dead_entities )
+{
+   sys::world world;
+   sys::command_buffer buffer;
+
+   auto const e = world.create( position{ } );
+   buffer.destroy( e );
+   buffer.add( e, velocity{ } );
+   buffer.destroy( e );
+
+   world.execute( buffer );
+
+   EXPECT_FALSE( world.is_alive( e ) );
+   EXPECT_EQ( world.get_entity_count( ), 0u );
+}
+
+TEST( ecs, structural_changes_throw_during_a_query )
+{
+   sys::world world;
+
+   auto const e = world.create( position{ }, tracked( make_name( 0 ) ) );
+   world.create( position{ } );
+
+   auto const expect_throw = [&] ( auto&& change ) 
+   {
+      EXPECT_THROW( world.each<position>( [&] ( position& ) { change( ); } ), std::runtime_error );
+      EXPECT_THROW( world.each_chunk<position>( [&] ( std::size_t, sys::entity const*, position* ) { change( ); } ), std::runtime_error );
+   };
+
+   expect_throw( [&] { world.create( position{ } ); } );
+   expect_throw( [&] { world.destroy( e ); } );
+   expect_throw( [&] { world.add( e, velocity{ } ); } );
+   expect_throw( [&] { world.remove<position>( e ); } );
+
+   sys::command_buffer buffer;
+   expect_throw( [&] { world.execute( buffer ); } );
+
+   /* the world is untouched and allows changes again once the query is over */
+   EXPECT_EQ( world.get_entity_count( ), 2u );
+   EXPECT_TRUE( world.is_alive( e ) );
+   EXPECT_FALSE( world.has<velocity>( e ) );
+   EXPECT_EQ( tracked::live_count, 1 );
+
+   world.each<position>( [&] ( sys::entity entity, position& ) { buffer.add( entity, velocity{ } ); } );
+   world.execute( buffer );
+
+   std::size_t moving_count = 0;
+   world.each<velocity>( [&] ( velocity& ) { ++moving_count; } );
+   EXPECT_EQ( moving_count, 2u );
+
+   world.destroy( e );
+   EXPECT_EQ( tracked::live_count, 0 );
+}
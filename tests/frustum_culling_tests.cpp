@@ -0,0 +1,199 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/frustum_culling.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+   struct object
+   {
+      glm::vec3 min;
+      glm::vec3 max;
+      float radius;
+   }; // struct object
+
+   gfx::frustum make_camera_frustum( )
+   {
+      glm::mat4 const view = glm::lookAt( glm::vec3( 0.0f ), glm::vec3( 1.0f, 0.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+      glm::mat4 const projection = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 500.0f );
+
+      return gfx::make_frustum( projection * view );
+   }
+
+   /**
+    * @brief Boxes scattered around the camera. Every other object gets a
+    * sphere tighter than its box, so both tests decide some objects.
+    */
+   std::vector<object> make_objects( std::uint32_t count, std::uint32_t seed )
+   {
+      std::mt19937 rng( seed );
+      std::uniform_real_distribution<float> position( -500.0f, 500.0f );
+      std::uniform_real_distribution<float> size( 0.5f, 40.0f );
+
+      std::vector<object> objects( count );
+      for( std::uint32_t i = 0; i < count; ++i )
+      {
+         auto& o = objects[i];
+         o.min = glm::vec3( position( rng ), position( rng ), position( rng ) );
+         o.max = o.min + glm::vec3( size( rng ), size( rng ), size( rng ) );
+
+         float const corner_radius = glm::length( ( o.max - o.min ) * 0.5f );
+         o.radius = i % 2 == 0 ? corner_radius : corner_radius * 0.3f;
+      }
+
+      return objects;
+   }
+
+   void fill( gfx::culling_set& set, std::vector<object> const& objects )
+   {
+      for( auto const& o : objects )
+      {
+         set.set_radius( set.add( o.min, o.max ), o.radius );
+      }
+   }
+
+   /**
+    * @brief One object and one plane at a time, without any SIMD.
+    */
+   std::vector<std::uint32_t> cull_scalar( gfx::frustum const& f, std::vector<object> const& objects )
+   {
+      std::vector<std::uint32_t> visible;
+      for( std::uint32_t i = 0; i < objects.size( ); ++i )
+      {
+         glm::vec3 const center = ( objects[i].min + objects[i].max ) * 0.5f;
+         glm::vec3 const extent = ( objects[i].max - objects[i].min ) * 0.5f;
+
+         bool is_visible = true;
+         for( auto const& plane : f.planes )
+         {
+            float const distance = glm::dot( glm::vec3( plane ), center ) + plane.w;
+            float const reach = glm::dot( glm::abs( glm::vec3( plane ) ), extent );
+
+            is_visible = is_visible && distance + std::min( reach, objects[i].radius ) >= 0.0f;
+         }
+
+         if ( is_visible )
+         {
+            visible.push_back( i );
+         }
+      }
+
+      return visible;
+   }
+
+   /* counts around the vector widths, so the SIMD loops and the scalar tail both run */
+   constexpr std::uint32_t object_counts[] = { 0, 1, 3, 4, 7, 8, 9, 17, 1000, 100003 };
+} // namespace
+
+TEST( frustum_culling, planes_face_inwards )
+{
+   auto const f = make_camera_frustum( );
+
+   auto const distance = [] ( glm::vec4 const& plane, glm::vec3 const& point )
+   {
+      return glm::dot( glm::vec3( plane ), point ) + plane.w;
+   };
+
+   for( auto const& plane : f.planes )
+   {
+      EXPECT_NEAR( glm::length( glm::vec3( plane ) ), 1.0f, 1e-5f );
+      EXPECT_GT( distance( plane, glm::vec3( 10.0f, 0.0f, 0.0f ) ), 0.0f );
+   }
+
+   EXPECT_LT( distance( f.planes[4], glm::vec3( -1.0f, 0.0f, 0.0f ) ), 0.0f );
+   EXPECT_LT( distance( f.planes[5], glm::vec3( 600.0f, 0.0f, 0.0f ) ), 0.0f );
+}
+
+TEST( frustum_culling, simd_matches_scalar )
+{
+   auto const f = make_camera_frustum( );
+
+   for( auto const count : object_counts )
+   {
+      auto const objects = make_objects( count, count );
+
+      gfx::culling_set set;
+      fill( set, objects );
+
+      std::vector<std::uint32_t> visible;
+      set.cull( f, visible );
+
+      EXPECT_EQ( visible, cull_scalar( f, objects ) ) << count << " objects";
+   }
+}
+
+TEST( frustum_culling, culls_by_box_or_sphere )
+{
+   auto const f = make_camera_frustum( );
+
+   gfx::culling_set set;
+   set.add( glm::vec3( 9.0f, -1.0f, -1.0f ), glm::vec3( 11.0f, 1.0f, 1.0f ) );
+
+   /* a long box across the left plane, with a sphere fully outside of it */
+   auto const across = set.add( glm::vec3( 10.0f, 0.0f, -1.0f ), glm::vec3( 12.0f, 200.0f, 1.0f ) );
+   set.add( glm::vec3( -20.0f, -1.0f, -1.0f ), glm::vec3( -10.0f, 1.0f, 1.0f ) );
+
+   std::vector<std::uint32_t> visible;
+   set.cull( f, visible );
+   EXPECT_EQ( visible, ( std::vector<std::uint32_t>{ 0, 1 } ) );
+
+   set.set_radius( across, 1.0f );
+   set.cull( f, visible );
+   EXPECT_EQ( visible, ( std::vector<std::uint32_t>{ 0 } ) );
+}
+
+TEST( frustum_culling, serial_matches_pooled )
+{
+   thread_pool pool;
+   auto const f = make_camera_frustum( );
+
+   for( auto const objects_per_job : { 1u, 13u, 1000u } )
+   {
+      gfx::culling_set::create_info const create_info 
+      {
+         .p_thread_pool = &pool,
+         .objects_per_job = objects_per_job
+      };
+
+      for( auto const count : object_counts )
+      {
+         auto const objects = make_objects( count, count + 1 );
+
+         gfx::culling_set serial_set;
+         auto pooled_set = gfx::culling_set( gfx::culling_set::create_info_t( create_info ) );
+         fill( serial_set, objects );
+         fill( pooled_set, objects );
+
+         std::vector<std::uint32_t> serial;
+         std::vector<std::uint32_t> pooled;
+         serial_set.cull( f, serial );
+         pooled_set.cull( f, pooled );
+
+         EXPECT_EQ( serial, pooled ) << count << " objects, " << objects_per_job << " per job";
+      }
+   }
+}
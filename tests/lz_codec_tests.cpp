@@ -0,0 +1,198 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/lz_codec.hpp>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+   std::vector<std::byte> make_random_bytes( std::size_t size, std::uint32_t seed )
+   {
+      std::mt19937 rng( seed );
+      std::uniform_int_distribution<int> byte( 0, 255 );
+
+      std::vector<std::byte> data( size );
+      for( auto& value : data )
+      {
+         value = static_cast<std::byte>( byte( rng ) );
+      }
+
+      return data;
+   }
+
+   /**
+    * @brief Short random words repeated in a random order, with runs of
+    * zeros, so most of the data is matches of every length and offset.
+    */
+   std::vector<std::byte> make_compressible_bytes( std::size_t size, std::uint32_t seed )
+   {
+      std::mt19937 rng( seed );
+      std::uniform_int_distribution<std::size_t> pick( 0, 15 );
+
+      std::vector<std::vector<std::byte>> words;
+      for( std::uint32_t i = 0; i < 16; ++i )
+      {
+         words.push_back( make_random_bytes( 3 + i * 5, seed + i + 1 ) );
+      }
+
+      std::vector<std::byte> data;
+      while( data.size( ) < size )
+      {
+         auto const& word = words[pick( rng )];
+         data.insert( data.end( ), word.begin( ), word.end( ) );
+         data.insert( data.end( ), pick( rng ) * 8, std::byte{ 0 } );
+      }
+      data.resize( size );
+
+      return data;
+   }
+
+   std::vector<std::byte> compress( std::vector<std::byte> const& data )
+   {
+      std::vector<std::byte> compressed( assets::get_lz_bound( data.size( ) ) );
+      std::size_t const size = assets::compress_lz( data.data( ), data.size( ), compressed.data( ), compressed.size( ) );
+      compressed.resize( size );
+
+      return compressed;
+   }
+
+   bool decompress( std::vector<std::byte> const& compressed, std::size_t src_size, std::vector<std::byte>& data )
+   {
+      return assets::decompress_lz( compressed.data( ), src_size, data.data( ), data.size( ) );
+   }
+
+   constexpr std::size_t sizes[] = { 0, 1, 12, 13, 16, 31, 100, 4096, 65535, 65536, 300000 };
+} // namespace
+
+TEST( lz_codec, round_trips_random_data )
+{
+   for( std::size_t const size : sizes )
+   {
+      auto const data = make_random_bytes( size, static_cast<std::uint32_t>( size ) );
+      auto const compressed = compress( data );
+
+      ASSERT_TRUE( size == 0 || !compressed.empty( ) ) << "size " << size;
+      EXPECT_LE( compressed.size( ), assets::get_lz_bound( size ) );
+
+      std::vector<std::byte> decompressed( size );
+      ASSERT_TRUE( decompress( compressed, compressed.size( ), decompressed ) ) << "size " << size;
+      EXPECT_EQ( decompressed, data ) << "size " << size;
+   }
+}
+
+TEST( lz_codec, round_trips_compressible_data )
+{
+   for( std::size_t const size : sizes )
+   {
+      auto const data = make_compressible_bytes( size, static_cast<std::uint32_t>( size ) );
+      auto const compressed = compress( data );
+
+      std::vector<std::byte> decompressed( size );
+      ASSERT_TRUE( decompress( compressed, compressed.size( ), decompressed ) ) << "size " << size;
+      EXPECT_EQ( decompressed, data ) << "size " << size;
+   }
+
+   auto const zeros = std::vector<std::byte>( 65536, std::byte{ 0 } );
+   EXPECT_LT( compress( zeros ).size( ), zeros.size( ) / 100 );
+
+   auto const words = make_compressible_bytes( 65536, 7 );
+   EXPECT_LT( compress( words ).size( ), words.size( ) / 2 );
+}
+
+TEST( lz_codec, fails_when_the_output_does_not_fit )
+{
+   auto const data = make_compressible_bytes( 4096, 3 );
+
+   std::vector<std::byte> compressed( 64 );
+   EXPECT_EQ( assets::compress_lz( data.data( ), data.size( ), compressed.data( ), compressed.size( ) ), 0u );
+}
+
+TEST( lz_codec, rejects_truncated_streams )
+{
+   for( auto const& data : { make_random_bytes( 1000, 1 ), make_compressible_bytes( 100000, 2 ) } )
+   {
+      auto const compressed = compress( data );
+
+      std::vector<std::byte> decompressed( data.size( ) );
+      for( std::size_t size = 0; size < compressed.size( ); size += 1 + size / 64 )
+      {
+         EXPECT_FALSE( decompress( compressed, size, decompressed ) ) << "truncated to " << size;
+      }
+   }
+}
+
+TEST( lz_codec, rejects_a_wrong_output_size )
+{
+   auto const data = make_compressible_bytes( 10000, 4 );
+   auto const compressed = compress( data );
+
+   std::vector<std::byte> smaller( data.size( ) - 1 );
+   EXPECT_FALSE( decompress( compressed, compressed.size( ), smaller ) );
+
+   std::vector<std::byte> larger( data.size( ) + 1 );
+   EXPECT_FALSE( decompress( compressed, compressed.size( ), larger ) );
+}
+
+TEST( lz_codec, rejects_corrupt_matches )
+{
+   /* one literal then a match 2 bytes back, before the start of the output */
+   std::vector<std::byte> const too_far = { std::byte{ 0x10 }, std::byte{ 'a' }, std::byte{ 2 }, std::byte{ 0 } };
+   std::vector<std::byte> decompressed( 5 );
+   EXPECT_FALSE( decompress( too_far, too_far.size( ), decompressed ) );
+
+   std::vector<std::byte> const zero_offset = { std::byte{ 0x10 }, std::byte{ 'a' }, std::byte{ 0 }, std::byte{ 0 } };
+   EXPECT_FALSE( decompress( zero_offset, zero_offset.size( ), decompressed ) );
+
+   /* a length that continues past the end of the stream */
+   std::vector<std::byte> const open_length = { std::byte{ 0xF0 }, std::byte{ 255 }, std::byte{ 255 } };
+   EXPECT_FALSE( decompress( open_length, open_length.size( ), decompressed ) );
+
+   std::vector<std::byte> const valid = { std::byte{ 0x10 }, std::byte{ 'a' }, std::byte{ 1 }, std::byte{ 0 } };
+   ASSERT_TRUE( decompress( valid, valid.size( ), decompressed ) );
+   EXPECT_EQ( decompressed, std::vector<std::byte>( 5, std::byte{ 'a' } ) );
+}
+
+TEST( lz_codec, survives_corrupt_streams )
+{
+   auto const data = make_compressible_bytes( 20000, 5 );
+   auto const compressed = compress( data );
+
+   std::mt19937 rng( 6 );
+   std::uniform_int_distribution<std::size_t> position( 0, compressed.size( ) - 1 );
+   std::uniform_int_distribution<int> byte( 0, 255 );
+
+   /* corrupted streams either fail or decode to some output of the right size, never out of bounds */
+   std::vector<std::byte> decompressed( data.size( ) );
+   for( std::uint32_t i = 0; i < 1000; ++i )
+   {
+      auto corrupted = compressed;
+      corrupted[position( rng )] = static_cast<std::byte>( byte( rng ) );
+
+      [[maybe_unused]] bool const is_valid = decompress( corrupted, corrupted.size( ), decompressed );
+   }
+
+   for( std::uint32_t i = 0; i < 100; ++i )
+   {
+      auto const noise = make_random_bytes( 1 + i * 37, 1000 + i );
+      [[maybe_unused]] bool const is_valid = decompress( noise, noise.size( ), decompressed );
+   }
+}
@@ -0,0 +1,131 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/mesh_optimizer.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+   constexpr std::uint32_t grid_size = 100;
+
+   /**
+    * @brief A grid of grid_size by grid_size vertices, with its triangles
+    * in a random order so no two consecutive triangles share a vertex
+    * in the cache.
+    */
+   std::vector<std::uint32_t> make_shuffled_grid( )
+   {
+      std::vector<std::array<std::uint32_t, 3>> triangles;
+      for( std::uint32_t y = 0; y + 1 < grid_size; ++y )
+      {
+         for( std::uint32_t x = 0; x + 1 < grid_size; ++x )
+         {
+            std::uint32_t const i = y * grid_size + x;
+
+            triangles.push_back( { i, i + grid_size, i + 1 } );
+            triangles.push_back( { i + 1, i + grid_size, i + grid_size + 1 } );
+         }
+      }
+
+      std::shuffle( triangles.begin( ), triangles.end( ), std::mt19937( 42 ) );
+
+      std::vector<std::uint32_t> indices;
+      indices.reserve( triangles.size( ) * 3 );
+      for( auto const& triangle : triangles )
+      {
+         indices.insert( indices.end( ), triangle.begin( ), triangle.end( ) );
+      }
+
+      return indices;
+   }
+
+   std::vector<glm::vec3> make_grid_positions( )
+   {
+      std::vector<glm::vec3> positions;
+      positions.reserve( grid_size * grid_size );
+      for( std::uint32_t y = 0; y < grid_size; ++y )
+      {
+         for( std::uint32_t x = 0; x < grid_size; ++x )
+         {
+            positions.emplace_back( static_cast<float>( x ), static_cast<float>( y ), 0.0f );
+         }
+      }
+
+      return positions;
+   }
+} // namespace
+
+TEST( mesh_optimizer, shuffled_grid_acmr )
+{
+   auto indices = make_shuffled_grid( );
+   auto const positions = make_grid_positions( );
+
+   auto const res = gfx::optimize_mesh( indices, positions );
+
+   EXPECT_GT( res.report.before.acmr, 2.9f );
+   EXPECT_LT( res.report.after.acmr, 0.7f );
+   EXPECT_LT( res.report.after.atvr, res.report.before.atvr );
+   EXPECT_TRUE( res.report.uses_16_bit_indices );
+}
+
+TEST( mesh_optimizer, keeps_triangles )
+{
+   auto const original = make_shuffled_grid( );
+   auto const positions = make_grid_positions( );
+
+   auto indices = original;
+   auto const res = gfx::optimize_mesh( indices, positions );
+   auto const remapped = gfx::remap_vertices( positions, res.remap, res.vertex_count );
+
+   ASSERT_EQ( indices.size( ), original.size( ) );
+   ASSERT_EQ( res.vertex_count, grid_size * grid_size );
+
+   /* every optimized triangle must be one of the original ones, with its winding */
+   auto const key = [] ( glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c ) 
+   {
+      return std::array<float, 9>{ a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z };
+   };
+
+   auto const rotate_min = [&] ( glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c )
+   {
+      return std::min( { key( a, b, c ), key( b, c, a ), key( c, a, b ) } );
+   };
+
+   std::vector<std::array<float, 9>> expected;
+   std::vector<std::array<float, 9>> actual;
+   for( std::size_t i = 0; i < indices.size( ); i += 3 )
+   {
+      expected.push_back( rotate_min( positions[original[i]], positions[original[i + 1]], positions[original[i + 2]] ) );
+      actual.push_back( rotate_min( remapped[indices[i]], remapped[indices[i + 1]], remapped[indices[i + 2]] ) );
+   }
+
+   std::sort( expected.begin( ), expected.end( ) );
+   std::sort( actual.begin( ), actual.end( ) );
+
+   EXPECT_EQ( expected, actual );
+}
+
+TEST( mesh_optimizer, fits_16_bit_indices )
+{
+   EXPECT_TRUE( gfx::fits_16_bit_indices( 65535 ) );
+   EXPECT_FALSE( gfx::fits_16_bit_indices( 65536 ) );
+}
@@ -0,0 +1,336 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/pack_file.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace
+{
+   std::vector<std::byte> make_random_bytes( std::size_t size, std::uint32_t seed )
+   {
+      std::mt19937 rng( seed );
+      std::uniform_int_distribution<int> byte( 0, 255 );
+
+      std::vector<std::byte> data( size );
+      for( auto& value : data )
+      {
+         value = static_cast<std::byte>( byte( rng ) );
+      }
+
+      return data;
+   }
+
+   std::vector<std::byte> make_compressible_bytes( std::size_t size )
+   {
+      std::vector<std::byte> data( size );
+      for( std::size_t i = 0; i < size; ++i )
+      {
+         data[i] = static_cast<std::byte>( ( i / 64 ) % 7 );
+      }
+
+      return data;
+   }
+
+   struct test_file
+   {
+      std::string path;
+      std::vector<std::byte> data;
+      bool compress = true;
+   }; // struct test_file
+
+   /**
+    * @brief Files around the block size, so entries have several blocks
+    * with a partial last one, compressed and stored.
+    */
+   std::vector<test_file> make_files( )
+   {
+      return {
+         { "empty.bin", { } },
+         { "meshes/random.lmsh", make_random_bytes( 3 * assets::pack_block_size + 100, 1 ) },
+         { "textures/compressible.ktx2", make_compressible_bytes( 2 * assets::pack_block_size + 7 ) },
+         { "textures/stored.ktx2", make_compressible_bytes( assets::pack_block_size ), false },
+         { "small.json", make_random_bytes( 5, 2 ) }
+      };
+   }
+
+   std::vector<std::byte> build_pack( std::vector<test_file> const& files, thread_pool* p_thread_pool = nullptr )
+   {
+      assets::pack_writer writer;
+      for( auto const& file : files )
+      {
+         writer.add( file.path, file.data, file.compress );
+      }
+
+      return writer.build( p_thread_pool );
+   }
+
+   std::string write_pack( std::vector<std::byte> const& pack )
+   {
+      auto const* p_test = ::testing::UnitTest::GetInstance( )->current_test_info( );
+      auto const path = std::filesystem::temp_directory_path( ) / ( std::string( "luciole_" ) + p_test->name( ) + ".lpak" );
+
+      std::ofstream stream( path, std::ios::binary | std::ios::trunc );
+      stream.write( reinterpret_cast<char const*>( pack.data( ) ), static_cast<std::streamsize>( pack.size( ) ) );
+
+      return path.string( );
+   }
+
+   assets::pack_header get_header( std::vector<std::byte> const& pack )
+   {
+      assets::pack_header header;
+      std::memcpy( &header, pack.data( ), sizeof( header ) );
+
+      return header;
+   }
+
+   void set_header( std::vector<std::byte>& pack, assets::pack_header const& header )
+   {
+      std::memcpy( pack.data( ), &header, sizeof( header ) );
+   }
+
+   assets::pack_block* get_blocks( std::vector<std::byte>& pack )
+   {
+      return reinterpret_cast<assets::pack_block*>( pack.data( ) + get_header( pack ).block_table_offset );
+   }
+
+   assets::pack_entry* get_entries( std::vector<std::byte>& pack )
+   {
+      return reinterpret_cast<assets::pack_entry*>( pack.data( ) + get_header( pack ).entry_table_offset );
+   }
+
+   /**
+    * @brief The entry with the most blocks, whatever order the pack
+    * sorted the entries in.
+    */
+   assets::pack_entry& get_largest_entry( std::vector<std::byte>& pack )
+   {
+      auto* const p_entries = get_entries( pack );
+      return *std::max_element( p_entries, p_entries + get_header( pack ).entry_count, [] ( auto const& lhs, auto const& rhs )
+      {
+         return lhs.block_count < rhs.block_count;
+      } );
+   }
+} // namespace
+
+TEST( pack_file, round_trips_files )
+{
+   auto const files = make_files( );
+   assets::pack_file const pack( write_pack( build_pack( files ) ) );
+
+   ASSERT_EQ( pack.get_entry_count( ), files.size( ) );
+   for( auto const& file : files )
+   {
+      auto const entry = pack.find( file.path );
+
+      ASSERT_TRUE( entry.has_value( ) ) << file.path;
+      EXPECT_EQ( pack.get_path( *entry ), file.path );
+      EXPECT_EQ( pack.get_size( *entry ), file.data.size( ) );
+      EXPECT_EQ( pack.read( *entry ), file.data ) << file.path;
+   }
+
+   EXPECT_FALSE( pack.find( "missing.bin" ).has_value( ) );
+}
+
+TEST( pack_file, compresses_compressible_files )
+{
+   auto const files = make_files( );
+   auto const pack = build_pack( files );
+
+   std::size_t total_size = 0;
+   for( auto const& file : files )
+   {
+      total_size += file.data.size( );
+   }
+
+   EXPECT_LT( pack.size( ), total_size - files[2].data.size( ) / 2 );
+}
+
+TEST( pack_file, same_pack_with_a_thread_pool )
+{
+   thread_pool pool;
+
+   auto const files = make_files( );
+   EXPECT_EQ( build_pack( files ), build_pack( files, &pool ) );
+
+   assets::pack_file const pack( write_pack( build_pack( files, &pool ) ) );
+
+   std::vector<std::uint32_t> entries;
+   for( auto const& file : files )
+   {
+      entries.push_back( *pack.find( file.path ) );
+   }
+
+   auto const contents = pack.read( entries, pool );
+   ASSERT_EQ( contents.size( ), files.size( ) );
+   for( std::size_t i = 0; i < files.size( ); ++i )
+   {
+      EXPECT_EQ( contents[i], files[i].data ) << files[i].path;
+   }
+}
+
+TEST( pack_file, reads_ranges_across_blocks )
+{
+   auto const files = make_files( );
+   assets::pack_file const pack( write_pack( build_pack( files ) ) );
+
+   auto const& file = files[1];
+   auto const entry = *pack.find( file.path );
+
+   std::mt19937 rng( 3 );
+   for( std::uint32_t i = 0; i < 100; ++i )
+   {
+      std::uniform_int_distribution<std::size_t> offset_dist( 0, file.data.size( ) );
+      std::size_t const offset = offset_dist( rng );
+      std::uniform_int_distribution<std::size_t> size_dist( 0, file.data.size( ) - offset );
+      std::size_t const size = size_dist( rng );
+
+      std::vector<std::byte> range( size );
+      pack.read( entry, offset, size, range.data( ) );
+
+      EXPECT_TRUE( std::equal( range.begin( ), range.end( ), file.data.begin( ) + static_cast<std::ptrdiff_t>( offset ) ) ) 
+         << "offset " << offset << ", size " << size;
+   }
+
+   std::byte value;
+   EXPECT_THROW( pack.read( entry, file.data.size( ), 1, &value ), std::runtime_error );
+}
+
+TEST( pack_file, rejects_duplicate_paths )
+{
+   assets::pack_writer writer;
+   writer.add( "a.bin", make_random_bytes( 10, 1 ) );
+   writer.add( "a.bin", make_random_bytes( 10, 2 ) );
+
+   EXPECT_THROW( static_cast<void>( writer.build( ) ), std::runtime_error );
+}
+
+TEST( pack_file, rejects_a_truncated_file )
+{
+   auto pack = build_pack( make_files( ) );
+   pack.resize( pack.size( ) - 1 );
+
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+
+   pack.resize( sizeof( assets::pack_header ) - 1 );
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+}
+
+TEST( pack_file, rejects_a_wrong_header )
+{
+   auto pack = build_pack( make_files( ) );
+   auto header = get_header( pack );
+
+   header.magic = 0;
+   set_header( pack, header );
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+
+   header = get_header( build_pack( make_files( ) ) );
+   header.version = assets::pack_version + 1;
+   set_header( pack, header );
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+
+   header = get_header( build_pack( make_files( ) ) );
+   header.entry_count = 1u << 30;
+   set_header( pack, header );
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+}
+
+TEST( pack_file, rejects_a_misaligned_table )
+{
+   auto const valid = build_pack( make_files( ) );
+
+   auto pack = valid;
+   auto header = get_header( pack );
+   header.entry_table_offset += 4;
+   set_header( pack, header );
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+
+   pack = valid;
+   header = get_header( pack );
+   header.block_table_offset += 1;
+   set_header( pack, header );
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+}
+
+TEST( pack_file, rejects_wrong_block_sizes )
+{
+   auto const valid = build_pack( make_files( ) );
+
+   /* a block that is not full before the last one of its entry */
+   auto pack = valid;
+   auto const& entry = get_largest_entry( pack );
+   ASSERT_GT( entry.block_count, 1u );
+   get_blocks( pack )[entry.first_block].size -= 1;
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+
+   /* a last block that does not end the entry */
+   pack = valid;
+   auto const& last_entry = get_largest_entry( pack );
+   get_blocks( pack )[last_entry.first_block + last_entry.block_count - 1].size += 1;
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+
+   /* more blocks than the size of the entry needs */
+   pack = valid;
+   get_largest_entry( pack ).block_count += 1;
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+
+   /* a compressed size larger than the block */
+   pack = valid;
+   auto& block = get_blocks( pack )[0];
+   block.compressed_size = block.size + 1;
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+
+   /* a block past the end of the file */
+   pack = valid;
+   get_blocks( pack )[0].offset = pack.size( );
+   EXPECT_THROW( assets::pack_file( write_pack( pack ) ), std::runtime_error );
+}
+
+TEST( pack_file, rejects_corrupt_blocks_on_read )
+{
+   auto const files = make_files( );
+   auto pack = build_pack( files );
+
+   /* cut the compressed stream of a block short, the table still fits the file */
+   auto* const p_entries = get_entries( pack );
+   auto const& entry = *std::find_if( p_entries, p_entries + files.size( ), [&] ( auto const& entry )
+   {
+      return entry.size == files[2].data.size( );
+   } );
+
+   auto& block = get_blocks( pack )[entry.first_block];
+   ASSERT_LT( block.compressed_size, block.size );
+   block.compressed_size /= 2;
+
+   assets::pack_file const file( write_pack( pack ) );
+   auto const index = *file.find( files[2].path );
+
+   EXPECT_THROW( static_cast<void>( file.read( index ) ), std::runtime_error );
+
+   thread_pool pool;
+   EXPECT_THROW( static_cast<void>( file.read( std::vector<std::uint32_t>{ index }, pool ) ), std::runtime_error );
+}
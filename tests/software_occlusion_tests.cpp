@@ -0,0 +1,191 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/software_occlusion.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+   struct mesh
+   {
+      std::vector<glm::vec3> positions;
+      std::vector<std::uint32_t> indices;
+   }; // struct mesh
+
+   /**
+    * @brief A cube from -1 to 1, to be scaled into walls.
+    */
+   mesh make_cube( )
+   {
+      mesh cube;
+      for( std::uint32_t corner = 0; corner < 8; ++corner )
+      {
+         cube.positions.emplace_back( 
+            ( corner & 1u ) ? 1.0f : -1.0f, 
+            ( corner & 2u ) ? 1.0f : -1.0f, 
+            ( corner & 4u ) ? 1.0f : -1.0f 
+         );
+      }
+
+      cube.indices = { 
+         0, 1, 3, 0, 3, 2,   4, 6, 7, 4, 7, 5, 
+         0, 4, 5, 0, 5, 1,   2, 3, 7, 2, 7, 6, 
+         0, 2, 6, 0, 6, 4,   1, 5, 7, 1, 7, 3 
+      };
+
+      return cube;
+   }
+
+   /**
+    * @brief Standing at a height of 2, looking down the x axis.
+    */
+   glm::mat4 make_view_projection( )
+   {
+      glm::mat4 const view = glm::lookAt( glm::vec3( 0.0f, 0.0f, 2.0f ), glm::vec3( 1.0f, 0.0f, 2.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+      glm::mat4 const projection = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 500.0f );
+
+      return projection * view;
+   }
+
+   /**
+    * @brief A wall across the view at x = 30, then rows of buildings.
+    */
+   std::vector<glm::mat4> make_city( )
+   {
+      std::vector<glm::mat4> walls;
+      walls.push_back( glm::scale( glm::translate( glm::mat4( 1.0f ), glm::vec3( 30.0f, -6.0f, 4.0f ) ), glm::vec3( 0.5f, 8.0f, 4.0f ) ) );
+
+      std::mt19937 rng( 42 );
+      std::uniform_real_distribution<float> wall_height( 3.0f, 20.0f );
+      std::uniform_real_distribution<float> wall_width( 2.0f, 8.0f );
+      for( float x = 40.0f; x < 200.0f; x += 20.0f )
+      {
+         for( float y = -100.0f; y < 100.0f; y += 20.0f )
+         {
+            float const height = wall_height( rng );
+            walls.push_back( glm::scale( 
+               glm::translate( glm::mat4( 1.0f ), glm::vec3( x, y, height ) ), 
+               glm::vec3( wall_width( rng ), wall_width( rng ), height ) 
+            ) );
+         }
+      }
+
+      return walls;
+   }
+
+   void draw( gfx::occlusion_buffer& buffer, std::vector<glm::mat4> const& walls )
+   {
+      auto const cube = make_cube( );
+
+      buffer.begin_frame( make_view_projection( ) );
+      for( auto const& wall : walls )
+      {
+         buffer.add_occluder( cube.positions, cube.indices, wall );
+      }
+
+      buffer.rasterize( );
+   }
+
+   gfx::occlusion_buffer make_buffer( thread_pool* p_thread_pool )
+   {
+      gfx::occlusion_buffer::create_info create_info { };
+      create_info.p_thread_pool = p_thread_pool;
+      create_info.boxes_per_job = 256;
+
+      return gfx::occlusion_buffer( gfx::occlusion_buffer::create_info_t( create_info ) );
+   }
+} // namespace
+
+TEST( occlusion_buffer, known_boxes )
+{
+   auto buffer = make_buffer( nullptr );
+   draw( buffer, make_city( ) );
+
+   // Right behind the first wall, and in front of it.
+   EXPECT_TRUE( buffer.is_occluded( gfx::aabb{ glm::vec3( 32.0f, -1.0f, 1.0f ), glm::vec3( 33.0f, 1.0f, 3.0f ) } ) );
+   EXPECT_FALSE( buffer.is_occluded( gfx::aabb{ glm::vec3( 20.0f, -1.0f, 1.0f ), glm::vec3( 21.0f, 1.0f, 3.0f ) } ) );
+
+   // Behind the camera.
+   EXPECT_FALSE( buffer.is_occluded( gfx::aabb{ glm::vec3( -10.0f, -1.0f, 1.0f ), glm::vec3( -9.0f, 1.0f, 3.0f ) } ) );
+}
+
+TEST( occlusion_buffer, serial_matches_pooled )
+{
+   thread_pool pool;
+
+   auto serial_buffer = make_buffer( nullptr );
+   auto pooled_buffer = make_buffer( &pool );
+
+   auto const walls = make_city( );
+   draw( serial_buffer, walls );
+   draw( pooled_buffer, walls );
+
+   for( std::uint32_t y = 0; y < serial_buffer.get_height( ); ++y )
+   {
+      for( std::uint32_t x = 0; x < serial_buffer.get_width( ); ++x )
+      {
+         ASSERT_EQ( serial_buffer.get_depth( x, y ), pooled_buffer.get_depth( x, y ) ) << "at " << x << ", " << y;
+      }
+   }
+
+   std::mt19937 rng( 7 );
+   std::uniform_real_distribution<float> forward( 5.0f, 250.0f );
+   std::uniform_real_distribution<float> side( -120.0f, 120.0f );
+   std::uniform_real_distribution<float> up( 0.0f, 10.0f );
+   std::uniform_real_distribution<float> size( 0.5f, 3.0f );
+
+   std::vector<gfx::aabb> boxes( 10000 );
+   for( auto& box : boxes )
+   {
+      box.min = glm::vec3( forward( rng ), side( rng ), up( rng ) );
+      box.max = box.min + glm::vec3( size( rng ), size( rng ), size( rng ) );
+   }
+
+   std::vector<std::uint32_t> expected;
+   std::vector<std::uint32_t> visible;
+   serial_buffer.cull( boxes, expected );
+   pooled_buffer.cull( boxes, visible );
+
+   EXPECT_EQ( visible, expected );
+   EXPECT_LT( expected.size( ), boxes.size( ) );
+   EXPECT_GT( expected.size( ), 0u );
+}
+
+TEST( occlusion_buffer, skips_triangles_before_the_near_plane )
+{
+   auto buffer = make_buffer( nullptr );
+
+   // A wall between the camera and the near plane, at 0.05 of the 0.1, 
+   // is clipped by the GPU and must not hide anything.
+   std::vector<glm::mat4> const walls
+   {
+      glm::scale( glm::translate( glm::mat4( 1.0f ), glm::vec3( 0.05f, 0.0f, 2.0f ) ), glm::vec3( 0.001f, 10.0f, 10.0f ) ) 
+   };
+
+   draw( buffer, walls );
+
+   EXPECT_EQ( buffer.get_stats( ).skipped_triangle_count, buffer.get_stats( ).triangle_count );
+   EXPECT_FALSE( buffer.is_occluded( gfx::aabb{ glm::vec3( 10.0f, -1.0f, 1.0f ), glm::vec3( 11.0f, 1.0f, 3.0f ) } ) );
+}
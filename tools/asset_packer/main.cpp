@@ -0,0 +1,119 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/pack_file.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+   /**
+    * @brief Whether a file is already compressed, in which case 
+    * compressing it again only wastes time.
+    */
+   bool is_compressed( std::filesystem::path const& path )
+   {
+      static constexpr char const* extensions[] = { ".png", ".jpg", ".jpeg", ".ogg", ".mp3", ".zip", ".lpak" };
+
+      auto extension = path.extension( ).string( );
+      std::transform( extension.begin( ), extension.end( ), extension.begin( ), [] ( unsigned char c ) { 
+         return static_cast<char>( std::tolower( c ) ); 
+      } );
+
+      return std::find( std::begin( extensions ), std::end( extensions ), extension ) != std::end( extensions );
+   }
+
+   std::vector<std::byte> read_file( std::filesystem::path const& path )
+   {
+      std::ifstream file( path, std::ios::binary | std::ios::ate );
+      if ( !file.good( ) )
+      {
+         throw std::runtime_error{ "Error loading file at location: " + path.string( ) + "." };
+      }
+
+      std::vector<std::byte> data( static_cast<std::size_t>( file.tellg( ) ) );
+      file.seekg( 0 );
+      file.read( reinterpret_cast<char*>( data.data( ) ), static_cast<std::streamsize>( data.size( ) ) );
+
+      return data;
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   if ( argc < 3 )
+   {
+      std::cerr << "usage: " << argv[0] << " <input directory> <output.lpak> [--store]\n";
+
+      return 1;
+   }
+
+   bool const is_stored = argc >= 4 && std::strcmp( argv[3], "--store" ) == 0;
+
+   try
+   {
+      std::filesystem::path const root( argv[1] );
+
+      assets::pack_writer writer;
+
+      std::uint64_t raw_size = 0;
+      for( auto const& entry : std::filesystem::recursive_directory_iterator( root ) )
+      {
+         if ( !entry.is_regular_file( ) )
+         {
+            continue;
+         }
+
+         auto data = read_file( entry.path( ) );
+         raw_size += data.size( );
+
+         writer.add( entry.path( ).lexically_relative( root ).generic_string( ), std::move( data ), !is_stored && !is_compressed( entry.path( ) ) );
+      }
+
+      thread_pool pool;
+
+      auto const pack = writer.build( &pool );
+
+      std::ofstream file( argv[2], std::ios::binary );
+      if ( !file.good( ) )
+      {
+         std::cerr << "Error opening file: " << argv[2] << ".\n";
+
+         return 1;
+      }
+
+      file.write( reinterpret_cast<char const*>( pack.data( ) ), static_cast<std::streamsize>( pack.size( ) ) );
+
+      std::cout << raw_size << " bytes packed into " << pack.size( ) << " bytes.\n";
+   }
+   catch( std::exception const& e )
+   {
+      std::cerr << e.what( ) << '\n';
+
+      return 1;
+   }
+
+   return 0;
+}
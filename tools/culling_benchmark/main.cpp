@@ -0,0 +1,251 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/aabb_tree.hpp>
+#include <luciole/graphics/frustum_culling.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Culls boxes scattered around a camera, with a gfx::culling_set, with a
+ * gfx::aabb_tree and with a loop testing an array of boxes one at a time,
+ * then casts rays through them with the tree and with the loop:
+ *
+ *    culling_benchmark [object count...]
+ *
+ * The counts default to 10k, 100k and 1M objects.
+ */
+
+namespace
+{
+   struct box
+   {
+      glm::vec3 min;
+      glm::vec3 max;
+   }; // struct box
+
+   template<typename F>
+   double measure( std::uint32_t iteration_count, F&& f )
+   {
+      std::vector<double> times;
+      times.reserve( iteration_count );
+
+      for( std::uint32_t i = 0; i < iteration_count; ++i )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         f( );
+         times.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( ) );
+      }
+
+      std::sort( times.begin( ), times.end( ) );
+
+      return times[times.size( ) / 2];
+   }
+
+   void report( std::string const& name, double milliseconds, std::uint32_t object_count )
+   {
+      std::cout << "   " << name << ": " << milliseconds << " ms, " 
+         << milliseconds * 1e6 / object_count << " ns per object\n";
+   }
+
+   /**
+    * @brief The baseline: every plane against every box.
+    */
+   void cull_boxes( gfx::frustum const& f, std::vector<box> const& boxes, std::vector<std::uint32_t>& visible )
+   {
+      visible.clear( );
+
+      for( std::uint32_t i = 0; i < boxes.size( ); ++i )
+      {
+         glm::vec3 const center = ( boxes[i].min + boxes[i].max ) * 0.5f;
+         glm::vec3 const extent = ( boxes[i].max - boxes[i].min ) * 0.5f;
+
+         bool is_visible = true;
+         for( auto const& plane : f.planes )
+         {
+            float const distance = glm::dot( glm::vec3( plane ), center ) + plane.w;
+            float const reach = glm::dot( glm::abs( glm::vec3( plane ) ), extent );
+
+            if ( distance + reach < 0.0f )
+            {
+               is_visible = false;
+               break;
+            }
+         }
+
+         if ( is_visible )
+         {
+            visible.push_back( i );
+         }
+      }
+   }
+
+   /**
+    * @return How far along the ray it enters the box, or infinity.
+    */
+   float get_ray_distance( box const& b, glm::vec3 const& origin, glm::vec3 const& inverse_direction )
+   {
+      glm::vec3 const t_1 = ( b.min - origin ) * inverse_direction;
+      glm::vec3 const t_2 = ( b.max - origin ) * inverse_direction;
+
+      glm::vec3 const t_near = glm::min( t_1, t_2 );
+      glm::vec3 const t_far = glm::max( t_1, t_2 );
+
+      float const enter = std::max( std::max( t_near.x, t_near.y ), std::max( t_near.z, 0.0f ) );
+      float const exit = std::min( std::min( t_far.x, t_far.y ), t_far.z );
+
+      return enter <= exit ? enter : std::numeric_limits<float>::infinity( );
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   std::vector<std::uint32_t> object_counts;
+   for( int i = 1; i < argc; ++i )
+   {
+      object_counts.push_back( static_cast<std::uint32_t>( std::stoul( argv[i] ) ) );
+   }
+
+   if ( object_counts.empty( ) )
+   {
+      object_counts = { 10000, 100000, 1000000 };
+   }
+
+   glm::mat4 const view = glm::lookAt( glm::vec3( 0.0f ), glm::vec3( 1.0f, 0.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+   glm::mat4 const projection = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 500.0f );
+   auto const frustum = gfx::make_frustum( projection * view );
+
+   thread_pool pool;
+
+   for( auto const object_count : object_counts )
+   {
+      std::mt19937 rng( 42 );
+      std::uniform_real_distribution<float> position( -500.0f, 500.0f );
+      std::uniform_real_distribution<float> size( 0.5f, 4.0f );
+
+      std::vector<box> boxes( object_count );
+      for( auto& b : boxes )
+      {
+         b.min = glm::vec3( position( rng ), position( rng ), position( rng ) );
+         b.max = b.min + glm::vec3( size( rng ), size( rng ), size( rng ) );
+      }
+
+      gfx::culling_set::create_info const parallel_create_info 
+      {
+         .p_thread_pool = &pool
+      };
+
+      gfx::culling_set serial_set;
+      auto parallel_set = gfx::culling_set( gfx::culling_set::create_info_t( parallel_create_info ) );
+      for( auto const& b : boxes )
+      {
+         serial_set.add( b.min, b.max );
+         parallel_set.add( b.min, b.max );
+      }
+
+      std::uint32_t const iteration_count = std::max( 10u, 10000000u / object_count );
+
+      std::vector<std::uint32_t> expected;
+      std::vector<std::uint32_t> visible;
+
+      auto const baseline = measure( iteration_count, [&] { cull_boxes( frustum, boxes, expected ); } );
+      auto const serial = measure( iteration_count, [&] { serial_set.cull( frustum, visible ); } );
+      auto const parallel = measure( iteration_count, [&] { parallel_set.cull( frustum, visible ); } );
+
+      gfx::aabb_tree::create_info const tree_create_info 
+      {
+         .margin = 0.0f
+      };
+
+      auto tree = gfx::aabb_tree( gfx::aabb_tree::create_info_t( tree_create_info ) );
+      for( std::uint32_t i = 0; i < object_count; ++i )
+      {
+         tree.insert( gfx::aabb{ boxes[i].min, boxes[i].max }, i );
+      }
+
+      auto const tree_time = measure( iteration_count, [&] 
+      { 
+         visible.clear( );
+         tree.query_frustum( frustum, [&visible] ( std::uint32_t i ) { visible.push_back( i ); } ); 
+      } );
+
+      std::cout << object_count << " objects, " << expected.size( ) << " visible\n";
+
+      report( "array of boxes", baseline, object_count );
+      report( "culling_set, serial", serial, object_count );
+      report( "culling_set, " + std::to_string( pool.get_thread_count( ) ) + " threads", parallel, object_count );
+      report( "aabb_tree, height " + std::to_string( tree.get_height( ) ), tree_time, object_count );
+
+      std::uniform_real_distribution<float> direction( -1.0f, 1.0f );
+
+      std::vector<std::pair<glm::vec3, glm::vec3>> rays( 200 );
+      for( auto& [origin, dir] : rays )
+      {
+         origin = glm::vec3( position( rng ), position( rng ), position( rng ) );
+         dir = glm::normalize( glm::vec3( direction( rng ), direction( rng ), direction( rng ) ) );
+      }
+
+      float constexpr ray_length = 1000.0f;
+
+      std::vector<float> linear_hits( rays.size( ) );
+      std::vector<float> tree_hits( rays.size( ) );
+
+      auto const linear_rays = measure( 1, [&] 
+      {
+         for( std::size_t r = 0; r < rays.size( ); ++r )
+         {
+            glm::vec3 const inverse_direction = 1.0f / rays[r].second;
+
+            linear_hits[r] = ray_length;
+            for( auto const& b : boxes )
+            {
+               linear_hits[r] = std::min( linear_hits[r], get_ray_distance( b, rays[r].first, inverse_direction ) );
+            }
+         }
+      } );
+
+      auto const tree_rays = measure( 3, [&] 
+      {
+         for( std::size_t r = 0; r < rays.size( ); ++r )
+         {
+            glm::vec3 const inverse_direction = 1.0f / rays[r].second;
+
+            tree_hits[r] = ray_length;
+            tree.raycast( rays[r].first, rays[r].second, ray_length, [&] ( std::uint32_t i, float max_distance ) 
+            {
+               tree_hits[r] = std::min( max_distance, get_ray_distance( boxes[i], rays[r].first, inverse_direction ) );
+               return tree_hits[r];
+            } );
+         }
+      } );
+
+      std::cout << "   closest hit of " << rays.size( ) << " rays: array of boxes " << linear_rays << " ms, aabb_tree " << tree_rays << " ms\n";
+   }
+
+   return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/draw_list.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Builds the draws of a scene of objects sharing a few pipelines, 
+ * materials and meshes with a gfx::draw_list, and compares the batches 
+ * against drawing the objects one by one in the order they were added:
+ *
+ *    draw_list_benchmark [object count...]
+ *
+ * The counts default to 10k, 100k and 1M objects.
+ */
+
+namespace
+{
+   template<typename F>
+   double measure( std::uint32_t iteration_count, F&& f )
+   {
+      std::vector<double> times;
+      times.reserve( iteration_count );
+
+      for( std::uint32_t i = 0; i < iteration_count; ++i )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         f( );
+         times.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( ) );
+      }
+
+      std::sort( times.begin( ), times.end( ) );
+
+      return times[times.size( ) / 2];
+   }
+
+   void report( std::string const& name, gfx::draw_list::stats const& stats )
+   {
+      std::cout << "   " << name << ": " << stats.draw_count << " draws, " 
+         << stats.pipeline_bind_count << " pipeline binds, " 
+         << stats.material_bind_count << " material binds, " 
+         << stats.mesh_bind_count << " mesh binds\n";
+   }
+
+   /**
+    * @brief The baseline: a draw per object, binding what differs from 
+    * the previous object.
+    */
+   gfx::draw_list::stats count_unsorted( std::vector<gfx::draw_list::draw_item> const& items )
+   {
+      gfx::draw_list::stats stats;
+      stats.item_count = static_cast<std::uint32_t>( items.size( ) );
+      stats.draw_count = stats.item_count;
+
+      for( std::size_t i = 0; i < items.size( ); ++i )
+      {
+         bool const is_first = i == 0 || items[i].pass != items[i - 1].pass;
+
+         stats.pipeline_bind_count += is_first || items[i].pipeline != items[i - 1].pipeline;
+         stats.material_bind_count += is_first || items[i].material != items[i - 1].material;
+         stats.mesh_bind_count += is_first || items[i].mesh != items[i - 1].mesh;
+      }
+
+      return stats;
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   std::vector<std::uint32_t> object_counts;
+   for( int i = 1; i < argc; ++i )
+   {
+      object_counts.push_back( static_cast<std::uint32_t>( std::stoul( argv[i] ) ) );
+   }
+
+   if ( object_counts.empty( ) )
+   {
+      object_counts = { 10000, 100000, 1000000 };
+   }
+
+   thread_pool pool;
+
+   for( auto const object_count : object_counts )
+   {
+      std::mt19937 rng( 42 );
+      std::uniform_int_distribution<std::uint32_t> pipeline( 0, 7 );
+      std::uniform_int_distribution<std::uint32_t> material( 0, 31 );
+      std::uniform_int_distribution<std::uint32_t> mesh( 0, 63 );
+      std::uniform_real_distribution<float> depth( 0.0f, 1.0f );
+
+      // One in ten objects is blended, in a back to front pass.
+      std::vector<gfx::draw_list::draw_item> items( object_count );
+      for( std::uint32_t i = 0; i < object_count; ++i )
+      {
+         auto& item = items[i];
+         item.pass = i % 10 == 0 ? 1 : 0;
+         item.pipeline = pipeline( rng );
+         item.material = material( rng ) % ( item.pass == 1 ? 4 : 32 );
+         item.mesh = mesh( rng );
+         item.depth = depth( rng );
+         item.transform[3] = glm::vec4( static_cast<float>( i ), 0.0f, 0.0f, 1.0f );
+      }
+
+      gfx::draw_list::create_info const parallel_create_info 
+      {
+         .p_thread_pool = &pool
+      };
+
+      gfx::draw_list serial_list;
+      auto parallel_list = gfx::draw_list( gfx::draw_list::create_info_t( parallel_create_info ) );
+      serial_list.set_depth_order( 1, gfx::draw_list::depth_order::e_back_to_front );
+      parallel_list.set_depth_order( 1, gfx::draw_list::depth_order::e_back_to_front );
+
+      auto const build = [&items] ( gfx::draw_list& list )
+      {
+         list.clear( );
+         for( auto const& item : items )
+         {
+            list.add( item );
+         }
+
+         list.build( );
+      };
+
+      std::uint32_t const iteration_count = std::max( 5u, 2000000u / object_count );
+
+      auto const serial = measure( iteration_count, [&] { build( serial_list ); } );
+      auto const parallel = measure( iteration_count, [&] { build( parallel_list ); } );
+
+      // The reference: a stable sort of the keys.
+      std::vector<std::uint32_t> order( object_count );
+      std::vector<std::uint64_t> keys( object_count );
+      for( std::uint32_t i = 0; i < object_count; ++i )
+      {
+         auto const depth_order = items[i].pass == 1 ? gfx::draw_list::depth_order::e_back_to_front : gfx::draw_list::depth_order::e_front_to_back;
+         keys[i] = gfx::draw_list::make_sort_key( items[i], depth_order );
+      }
+
+      auto const reference = measure( iteration_count, [&] 
+      { 
+         std::iota( order.begin( ), order.end( ), 0u );
+         std::stable_sort( order.begin( ), order.end( ), [&keys] ( std::uint32_t lhs, std::uint32_t rhs ) { return keys[lhs] < keys[rhs]; } ); 
+      } );
+
+      std::cout << object_count << " objects\n";
+      std::cout << "   build, serial: " << serial << " ms\n";
+      std::cout << "   build, " << pool.get_thread_count( ) << " threads: " << parallel << " ms\n";
+      std::cout << "   std::stable_sort of the keys alone: " << reference << " ms\n";
+      std::cout << "   radix passes skipped: " << serial_list.get_stats( ).skipped_sort_pass_count << " of 8\n";
+
+      report( "unsorted", count_unsorted( items ) );
+      report( "draw_list", serial_list.get_stats( ) );
+   }
+
+   return 0;
+}
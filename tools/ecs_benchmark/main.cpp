@@ -0,0 +1,234 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/sys/command_buffer.hpp>
+#include <luciole/sys/scheduler.hpp>
+#include <luciole/sys/world.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Compares iterating the entities of a sys::world against iterating an
+ * array of structures holding the same data, then runs the same systems
+ * through a sys::scheduler, serially and on a thread pool:
+ *
+ *    ecs_benchmark [entity count] [iteration count]
+ */
+
+namespace
+{
+   struct position { float x, y, z; };
+   struct velocity { float x, y, z; };
+   struct rotation { float x, y, z, w; };
+   struct scale { float x, y, z; };
+   struct bounds { float min[3], max[3]; };
+   struct health { float value; };
+   struct name_tag { char value[32]; };
+
+   /**
+    * @brief The baseline: every component of an object side by side.
+    */
+   struct game_object
+   {
+      position pos;
+      velocity vel;
+      rotation rot;
+      scale scl;
+      bounds box;
+      health hp;
+      name_tag name;
+   }; // struct game_object
+
+   template<typename F>
+   double measure( std::uint32_t iteration_count, F&& f )
+   {
+      std::vector<double> times;
+      times.reserve( iteration_count );
+
+      for( std::uint32_t i = 0; i < iteration_count; ++i )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         f( );
+         times.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( ) );
+      }
+
+      std::sort( times.begin( ), times.end( ) );
+
+      return times[times.size( ) / 2];
+   }
+
+   void report( char const* name, double milliseconds, std::uint32_t entity_count )
+   {
+      std::cout << name << ": " << milliseconds << " ms, " 
+         << milliseconds * 1e6 / entity_count << " ns per entity\n";
+   }
+
+   /**
+    * @brief Register a few systems that touch disjoint or shared
+    * components, so that some of them may run side by side.
+    */
+   void add_systems( sys::scheduler& scheduler, float dt )
+   {
+      scheduler.add_system<sys::reads<velocity>, sys::writes<position>>( "movement", [dt] ( position& pos, velocity const& vel ) 
+      {
+         pos.x += vel.x * dt;
+         pos.y += vel.y * dt;
+         pos.z += vel.z * dt;
+      } );
+
+      scheduler.add_system<sys::reads<position, scale>, sys::writes<bounds>>( "bounds", [] ( bounds& box, position const& pos, scale const& scl ) 
+      {
+         box = bounds
+         {
+            { pos.x - scl.x, pos.y - scl.y, pos.z - scl.z },
+            { pos.x + scl.x, pos.y + scl.y, pos.z + scl.z }
+         };
+      } );
+
+      scheduler.add_system<sys::reads<velocity>, sys::writes<rotation>>( "spin", [dt] ( rotation& rot, velocity const& vel ) 
+      {
+         rot.x += vel.x * dt;
+         rot.w = 1.0f;
+      } );
+
+      scheduler.add_system<sys::reads<>, sys::writes<health>>( "regen", [dt] ( health& hp ) 
+      {
+         hp.value = std::min( hp.value + dt, 100.0f );
+      } );
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   auto const entity_count = argc >= 2 ? static_cast<std::uint32_t>( std::stoul( argv[1] ) ) : 1000000u;
+   auto const iteration_count = argc >= 3 ? static_cast<std::uint32_t>( std::stoul( argv[2] ) ) : 50u;
+
+   float constexpr dt = 1.0f / 60.0f;
+
+   std::vector<game_object> objects( entity_count );
+   for( std::uint32_t i = 0; i < entity_count; ++i )
+   {
+      objects[i].pos = { static_cast<float>( i ), 0.0f, 0.0f };
+      objects[i].vel = { 1.0f, 2.0f, 3.0f };
+   }
+
+   sys::world world;
+
+   auto const create_start = std::chrono::steady_clock::now( );
+   for( std::uint32_t i = 0; i < entity_count; ++i )
+   {
+      world.create( 
+         position{ static_cast<float>( i ), 0.0f, 0.0f }, velocity{ 1.0f, 2.0f, 3.0f }, 
+         rotation{ }, scale{ 1.0f, 1.0f, 1.0f }, bounds{ }, health{ 100.0f }, name_tag{ } 
+      );
+   }
+   
+   report( "create", std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - create_start ).count( ), entity_count );
+
+   auto const aos = measure( iteration_count, [&] 
+   {
+      for( auto& object : objects )
+      {
+         object.pos.x += object.vel.x * dt;
+         object.pos.y += object.vel.y * dt;
+         object.pos.z += object.vel.z * dt;
+      }
+   } );
+
+   auto const each = measure( iteration_count, [&] 
+   {
+      world.each<position, velocity const>( [] ( position& pos, velocity const& vel ) 
+      {
+         pos.x += vel.x * dt;
+         pos.y += vel.y * dt;
+         pos.z += vel.z * dt;
+      } );
+   } );
+
+   auto const each_chunk = measure( iteration_count, [&] 
+   {
+      world.each_chunk<position, velocity const>( [] ( std::size_t count, sys::entity const*, position* p_pos, velocity const* p_vel ) 
+      {
+         for( std::size_t i = 0; i < count; ++i )
+         {
+            p_pos[i].x += p_vel[i].x * dt;
+            p_pos[i].y += p_vel[i].y * dt;
+            p_pos[i].z += p_vel[i].z * dt;
+         }
+      } );
+   } );
+
+   report( "array of structures", aos, entity_count );
+   report( "world::each", each, entity_count );
+   report( "world::each_chunk", each_chunk, entity_count );
+
+   sys::scheduler::create_info const serial_create_info { };
+
+   auto serial_scheduler = sys::scheduler( sys::scheduler::create_info_t( serial_create_info ) );
+   add_systems( serial_scheduler, dt );
+
+   thread_pool pool;
+   
+   sys::scheduler::create_info const parallel_create_info 
+   {
+      .p_thread_pool = &pool
+   };
+
+   auto parallel_scheduler = sys::scheduler( sys::scheduler::create_info_t( parallel_create_info ) );
+   add_systems( parallel_scheduler, dt );
+
+   auto const serial = measure( iteration_count, [&] { serial_scheduler.run( world ); } );
+   auto const parallel = measure( iteration_count, [&] { parallel_scheduler.run( world ); } );
+
+   report( "scheduler, serial", serial, entity_count );
+   report( "scheduler, thread pool", parallel, entity_count );
+   std::cout << "scheduler speedup on " << pool.get_thread_count( ) << " threads: " << serial / parallel << "x\n";
+
+   sys::command_buffer commands;
+   auto const command_start = std::chrono::steady_clock::now( );
+   
+   world.each<health const>( [&] ( sys::entity e, health const& ) 
+   {
+      if ( e.index % 2 == 0 )
+      {
+         commands.remove<name_tag>( e );
+      }
+   } );
+
+   world.execute( commands );
+
+   report( "command buffer, remove a component from half", 
+      std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - command_start ).count( ), entity_count );
+
+   float checksum = 0.0f;
+   for( auto const& object : objects )
+   {
+      checksum += object.pos.x;
+   }
+
+   world.each<position const>( [&] ( position const& pos ) { checksum -= pos.x; } );
+
+   std::cout << "checksum " << checksum << '\n';
+
+   return 0;
+}
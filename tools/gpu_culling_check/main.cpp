@@ -0,0 +1,717 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/context.hpp>
+#include <luciole/graphics/depth_pyramid.hpp>
+#include <luciole/graphics/frustum_culling.hpp>
+#include <luciole/graphics/gpu_culling.hpp>
+#include <luciole/ui/window.hpp>
+#include <luciole/vk/buffers/queue_ownership.hpp>
+#include <luciole/vk/images/texture.hpp>
+#include <luciole/vk/shaders/shader_compiler.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Runs the culling shaders on the device, reads back the indirect 
+ * commands they write and checks them against the CPU culling:
+ *
+ *    gpu_culling_check <shader directory>
+ *
+ * The frustum culling of cull_instances.comp is checked with the draw 
+ * count read from the device, when VK_KHR_draw_indirect_count is 
+ * enabled, and with the fallback that keeps a command per instance. The
+ * instances must match those gfx::culling_set finds, apart from the ones
+ * touching a plane, where both sides may round differently.
+ *
+ * The two phases of cull_occlusion.comp are checked over a few frames, 
+ * with a depth buffer cleared to a depth standing in for what the early
+ * draws would write. A frame with nothing drawn lets the late phase draw
+ * every instance in the frustum, a wall through the origin then keeps 
+ * the early phase to those in front of it, and once the wall is gone 
+ * the late phase must pick up the instances behind it that the early 
+ * phase missed. Each phase must draw what the CPU finds from the same 
+ * test, apart from the instances touching a plane or the wall.
+ *
+ * The process returns 1 on any mismatch. Built in Debug, the validation
+ * layers check every submission.
+ */
+
+namespace
+{
+   using cull_phase = gfx::gpu_culling::cull_phase;
+
+   std::uint32_t constexpr instance_count = 4096;
+   std::uint32_t constexpr shown_mismatch_count = 8;
+
+   /**
+    * @brief How far from a plane, in world units, a sphere is taken as 
+    * touching it.
+    */
+   float constexpr boundary_tolerance = 1e-3f;
+
+   /**
+    * @brief How close in normalized depth a sphere is taken as touching
+    * the wall.
+    */
+   float constexpr depth_tolerance = 1e-5f;
+
+   VkExtent2D constexpr depth_extent = { 320, 180 };
+
+   struct scene
+   {
+      std::vector<glm::vec4> spheres;
+      glm::mat4 view;
+      glm::mat4 projection;
+   }; // struct scene
+
+   /**
+    * @brief The indirect commands and draw counts written by a cull.
+    */
+   struct readback
+   {
+      std::vector<VkDrawIndexedIndirectCommand> commands;
+      std::array<std::uint32_t, 2> draw_counts = { };
+   }; // struct readback
+
+   template<typename T>
+   T get_or_throw( std::variant<T, vk::error>&& result, char const* p_what )
+   {
+      if ( auto const* p_err = std::get_if<vk::error>( &result ) )
+      {
+         throw std::runtime_error( std::string( p_what ) + ": " + p_err->to_string( ) );
+      }
+
+      return std::get<T>( std::move( result ) );
+   }
+
+   void throw_on_error( vk::error const& err, char const* p_what )
+   {
+      if ( err.is_error( ) )
+      {
+         throw std::runtime_error( std::string( p_what ) + ": " + err.to_string( ) );
+      }
+   }
+
+   /**
+    * @brief Spheres scattered around the origin, seen from far enough 
+    * for some to be outside of the frustum on every side.
+    */
+   scene make_scene( std::mt19937& rng )
+   {
+      std::uniform_real_distribution<float> position( -20.0f, 20.0f );
+      std::uniform_real_distribution<float> radius( 0.05f, 1.5f );
+
+      scene s;
+      s.spheres.reserve( instance_count );
+      for( std::uint32_t i = 0; i < instance_count; ++i )
+      {
+         s.spheres.emplace_back( position( rng ), position( rng ), position( rng ), radius( rng ) );
+      }
+
+      s.view = glm::lookAt( glm::vec3( 0.0f, 0.0f, 30.0f ), glm::vec3( 0.0f ), glm::vec3( 0.0f, 1.0f, 0.0f ) );
+      s.projection = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 100.0f );
+      s.projection[1][1] *= -1;
+
+      return s;
+   }
+
+   /**
+    * @brief A range unique to each instance, so that a command can be 
+    * traced back to the instance that wrote it.
+    */
+   gfx::gpu_culling::draw_range get_range( std::uint32_t index )
+   {
+      return gfx::gpu_culling::draw_range
+      {
+         .index_count = 3 * ( index % 7 + 1 ),
+         .first_index = 3 * index,
+         .vertex_offset = static_cast<std::int32_t>( index % 5 )
+      };
+   }
+
+   bool is_on_boundary( gfx::frustum const& f, glm::vec4 const& sphere )
+   {
+      return std::any_of( f.planes.begin( ), f.planes.end( ), [&]( glm::vec4 const& plane ) 
+      {
+         return std::abs( glm::dot( glm::vec3( plane ), glm::vec3( sphere ) ) + plane.w + sphere.w ) < boundary_tolerance;
+      } );
+   }
+
+   /**
+    * @brief The nearest depth of the box around a sphere, as 
+    * cull_occlusion.comp projects it, or the lowest float when the box
+    * reaches behind the camera and cannot be occluded.
+    */
+   float get_nearest_depth( scene const& s, glm::vec4 const& sphere )
+   {
+      glm::vec3 const center = glm::vec3( s.view * glm::vec4( glm::vec3( sphere ), 1.0f ) );
+
+      float nearest = 1.0f;
+      for( int i = 0; i < 8; ++i )
+      {
+         glm::vec3 const corner = center + sphere.w * glm::vec3( 
+            ( i & 1 ) != 0 ? 1.0f : -1.0f, 
+            ( i & 2 ) != 0 ? 1.0f : -1.0f, 
+            ( i & 4 ) != 0 ? 1.0f : -1.0f 
+         );
+
+         glm::vec4 const clip = s.projection * glm::vec4( corner, 1.0f );
+         if ( clip.w <= 0.0f )
+         {
+            return std::numeric_limits<float>::lowest( );
+         }
+
+         nearest = std::min( nearest, clip.z / clip.w );
+      }
+
+      return nearest;
+   }
+
+   /**
+    * @brief Stand in for the early draws with a depth buffer cleared to 
+    * a depth, left for the depth pyramid to read.
+    */
+   void record_depth_clear( VkCommandBuffer cmd_buffer, vk::texture const& depth_image, float depth )
+   {
+      VkImageSubresourceRange const range
+      {
+         .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+         .baseMipLevel = 0,
+         .levelCount = 1,
+         .baseArrayLayer = 0,
+         .layerCount = 1
+      };
+
+      VkImageMemoryBarrier const clear_barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = 0,
+         .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+         .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+         .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+         .image = depth_image.get_image( ),
+         .subresourceRange = range
+      };
+
+      vkCmdPipelineBarrier( 
+         cmd_buffer, 
+         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 
+         0, 0, nullptr, 0, nullptr, 1, &clear_barrier 
+      );
+
+      VkClearDepthStencilValue const value
+      {
+         .depth = depth,
+         .stencil = 0
+      };
+
+      vkCmdClearDepthStencilImage( cmd_buffer, depth_image.get_image( ), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &value, 1, &range );
+
+      auto read_barrier = clear_barrier;
+      read_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      read_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      read_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      read_barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+      vkCmdPipelineBarrier( 
+         cmd_buffer, 
+         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+         0, 0, nullptr, 0, nullptr, 1, &read_barrier 
+      );
+   }
+
+   /**
+    * @brief Cull the spheres on the CPU, through the box and sphere of a
+    * culling_set.
+    */
+   std::vector<std::uint32_t> cull_on_cpu( scene const& s, gfx::frustum const& f )
+   {
+      gfx::culling_set culling;
+      for( auto const& sphere : s.spheres )
+      {
+         auto const index = culling.add( glm::vec3( sphere ) - sphere.w, glm::vec3( sphere ) + sphere.w );
+         culling.set_radius( index, sphere.w );
+      }
+
+      std::vector<std::uint32_t> visible;
+      culling.cull( f, visible );
+
+      return visible;
+   }
+
+   /**
+    * @brief Record the culling with a recorder, then copy its commands 
+    * and draw counts to the host once the device is done.
+    */
+   template<typename F>
+   readback cull_and_read( context const& ctx, gfx::gpu_culling const& culling, F&& record )
+   {
+      std::uint32_t const phase_count = culling.is_occlusion_culled( ) ? 2 : 1;
+      VkDeviceSize const command_size = sizeof( VkDrawIndexedIndirectCommand ) * culling.get_max_instance_count( ) * phase_count;
+      VkDeviceSize const count_size = sizeof( std::uint32_t ) * 2;
+
+      VkBufferCreateInfo const create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .size = command_size + count_size,
+         .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = 0,
+         .pQueueFamilyIndices = nullptr
+      };
+
+      VmaAllocationCreateInfo alloc_info = { };
+      alloc_info.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+
+      auto const buffer = get_or_throw( ctx.create_buffer( 
+         vk::buffer_create_info_t( create_info ), 
+         vk::allocation_create_info_t( alloc_info ), 
+         vk::memory_category::e_staging_buffer 
+      ), "readback buffer" );
+
+      auto cmd_buffer = get_or_throw( vk::begin_one_time_commands( &ctx, queue::flag::e_graphics ), "graphics commands" );
+
+      record( cmd_buffer );
+
+      VkMemoryBarrier const barrier
+      {
+         .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+         .pNext = nullptr,
+         .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+         .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT
+      };
+
+      vkCmdPipelineBarrier( 
+         cmd_buffer, 
+         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 
+         0, 1, &barrier, 0, nullptr, 0, nullptr 
+      );
+
+      VkBufferCopy const command_copy
+      {
+         .srcOffset = 0,
+         .dstOffset = 0,
+         .size = command_size
+      };
+
+      VkBufferCopy const count_copy
+      {
+         .srcOffset = 0,
+         .dstOffset = command_size,
+         .size = count_size
+      };
+
+      vkCmdCopyBuffer( cmd_buffer, culling.get_command_buffer( ), buffer.handle, 1, &command_copy );
+      vkCmdCopyBuffer( cmd_buffer, culling.get_count_buffer( ), buffer.handle, 1, &count_copy );
+
+      throw_on_error( vk::submit_one_time_commands( &ctx, queue::flag::e_graphics, cmd_buffer ), "graphics submit" );
+
+      readback result;
+      result.commands.resize( culling.get_max_instance_count( ) * phase_count );
+
+      void* p_data = nullptr;
+      if ( vmaMapMemory( ctx.get_memory_allocator( ), buffer.allocation, &p_data ) != VK_SUCCESS )
+      {
+         ctx.destroy_buffer( buffer );
+
+         throw std::runtime_error( "failed to map the readback buffer" );
+      }
+
+      vmaInvalidateAllocation( ctx.get_memory_allocator( ), buffer.allocation, 0, VK_WHOLE_SIZE );
+
+      std::memcpy( result.commands.data( ), p_data, command_size );
+      std::memcpy( result.draw_counts.data( ), static_cast<std::byte const*>( p_data ) + command_size, count_size );
+
+      vmaUnmapMemory( ctx.get_memory_allocator( ), buffer.allocation );
+      ctx.destroy_buffer( buffer );
+
+      return result;
+   }
+
+   /**
+    * @brief Check the commands of a phase against the instances expected
+    * to draw in it.
+    *
+    * @return The number of mismatches.
+    */
+   std::uint32_t compare( 
+      readback const& result, 
+      gfx::gpu_culling const& culling, 
+      cull_phase phase, 
+      std::vector<std::uint32_t> const& expected, 
+      std::vector<bool> const& is_ambiguous, 
+      std::string const& name )
+   {
+      std::uint32_t mismatch_count = 0;
+      auto const report = [&]( std::string const& what )
+      {
+         if ( mismatch_count++ < shown_mismatch_count )
+         {
+            std::cout << "      " << what << '\n';
+         }
+      };
+
+      auto const first = culling.get_command_offset( phase ) / sizeof( VkDrawIndexedIndirectCommand );
+      auto const phase_index = static_cast<std::uint32_t>( phase );
+
+      // Compacted, the drawn commands come first in any order. Otherwise
+      // each instance has its own and the culled ones draw nothing.
+      std::uint32_t const command_count = culling.is_compacted( ) ? result.draw_counts[phase_index] : culling.get_instance_count( );
+      if ( command_count > culling.get_instance_count( ) )
+      {
+         std::cout << "   " << name << ": the draw count " << command_count << " is over the instance count\n";
+
+         return 1;
+      }
+
+      std::vector<std::uint32_t> drawn;
+      for( std::uint32_t i = 0; i < command_count; ++i )
+      {
+         auto const& command = result.commands[first + i];
+         auto const index = command.firstInstance;
+         auto const range = get_range( index );
+
+         if ( index >= culling.get_instance_count( ) || ( !culling.is_compacted( ) && index != i ) )
+         {
+            report( "command " + std::to_string( i ) + " has the first instance " + std::to_string( index ) );
+            continue;
+         }
+
+         if ( command.indexCount != range.index_count || command.firstIndex != range.first_index || command.vertexOffset != range.vertex_offset )
+         {
+            report( "command " + std::to_string( i ) + " has the wrong range for instance " + std::to_string( index ) );
+         }
+
+         if ( command.instanceCount > 1 || ( culling.is_compacted( ) && command.instanceCount != 1 ) )
+         {
+            report( "command " + std::to_string( i ) + " draws " + std::to_string( command.instanceCount ) + " instances" );
+         }
+         else if ( command.instanceCount == 1 )
+         {
+            drawn.push_back( index );
+         }
+      }
+
+      std::sort( drawn.begin( ), drawn.end( ) );
+
+      if ( std::adjacent_find( drawn.begin( ), drawn.end( ) ) != drawn.end( ) )
+      {
+         report( "an instance is drawn twice" );
+      }
+
+      std::vector<std::uint32_t> missing;
+      std::set_difference( expected.begin( ), expected.end( ), drawn.begin( ), drawn.end( ), std::back_inserter( missing ) );
+
+      std::vector<std::uint32_t> extra;
+      std::set_difference( drawn.begin( ), drawn.end( ), expected.begin( ), expected.end( ), std::back_inserter( extra ) );
+
+      std::uint32_t ambiguous_count = 0;
+      auto const report_difference = [&]( std::vector<std::uint32_t> const& indices, char const* p_what )
+      {
+         for( auto const index : indices )
+         {
+            if ( is_ambiguous[index] )
+            {
+               ++ambiguous_count;
+            }
+            else
+            {
+               report( "instance " + std::to_string( index ) + p_what );
+            }
+         }
+      };
+
+      report_difference( missing, " is not drawn" );
+      report_difference( extra, " is drawn" );
+
+      std::cout << "   " << name << ": " << drawn.size( ) << " drawn, " << expected.size( ) << " expected, " 
+         << ambiguous_count << " differ on a plane, " << mismatch_count << " mismatches\n";
+
+      return mismatch_count;
+   }
+
+   /**
+    * @brief Cull the scene with cull_instances.comp and compare it with
+    * the CPU culling.
+    */
+   std::uint32_t check_frustum_culling( context const& ctx, std::vector<std::uint32_t> const& spir_v, scene const& s, bool is_draw_count_used )
+   {
+      gfx::gpu_culling::create_info const create_info
+      {
+         .p_context = &ctx,
+         .spir_v = spir_v,
+         .max_instance_count = instance_count,
+         .is_occlusion_culled = false,
+         .is_draw_count_used = is_draw_count_used
+      };
+
+      auto culling = gfx::gpu_culling( gfx::gpu_culling::create_info_t( create_info ) );
+
+      std::string const name = is_draw_count_used ? "frustum, draw count" : "frustum, a command per instance";
+      if ( is_draw_count_used && !culling.is_compacted( ) )
+      {
+         std::cout << "   " << name << ": skipped, VK_KHR_draw_indirect_count is not enabled\n";
+
+         return 0;
+      }
+
+      for( std::uint32_t i = 0; i < s.spheres.size( ); ++i )
+      {
+         culling.add( glm::vec3( s.spheres[i] ), s.spheres[i].w, get_range( i ) );
+      }
+
+      auto const f = gfx::make_frustum( s.projection * s.view );
+      culling.update( f );
+
+      std::vector<bool> is_ambiguous( s.spheres.size( ) );
+      for( std::uint32_t i = 0; i < s.spheres.size( ); ++i )
+      {
+         is_ambiguous[i] = is_on_boundary( f, s.spheres[i] );
+      }
+
+      auto const result = cull_and_read( ctx, culling, [&]( VkCommandBuffer cmd_buffer ) 
+      { 
+         culling.record_cull( cmd_buffer, cull_phase::e_early ); 
+      } );
+
+      return compare( result, culling, cull_phase::e_early, cull_on_cpu( s, f ), is_ambiguous, name );
+   }
+
+   /**
+    * @brief Cull the scene in two phases with cull_occlusion.comp over a
+    * few frames, each with the depth of the early draws set by a clear,
+    * and compare each phase with the CPU culling.
+    */
+   std::uint32_t check_occlusion_culling( 
+      context const& ctx, 
+      std::vector<std::uint32_t> const& spir_v, 
+      std::vector<std::uint32_t> const& pyramid_spir_v, 
+      scene const& s, 
+      bool is_draw_count_used )
+   {
+      if ( !ctx.is_format_supported( VK_FORMAT_D32_SFLOAT, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) )
+      {
+         throw std::runtime_error( "D32_SFLOAT depth buffers are not supported" );
+      }
+
+      vk::texture::create_info const depth_create_info
+      {
+         .p_context = &ctx,
+         .extent = depth_extent,
+         .format = VK_FORMAT_D32_SFLOAT,
+         .mip_levels = 1,
+         .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+         .aspect = VK_IMAGE_ASPECT_DEPTH_BIT
+      };
+
+      auto const depth_image = vk::texture( vk::texture::create_info_t( depth_create_info ) );
+
+      auto pyramid_create_info = gfx::depth_pyramid::create_info( );
+      pyramid_create_info.p_context = &ctx;
+      pyramid_create_info.spir_v = pyramid_spir_v;
+      pyramid_create_info.depth_view = depth_image.get_image_view( );
+      pyramid_create_info.depth_extent = depth_extent;
+
+      auto const pyramid = gfx::depth_pyramid( gfx::depth_pyramid::create_info_t( pyramid_create_info ) );
+
+      gfx::gpu_culling::create_info const create_info
+      {
+         .p_context = &ctx,
+         .spir_v = spir_v,
+         .max_instance_count = instance_count,
+         .is_occlusion_culled = true,
+         .is_draw_count_used = is_draw_count_used
+      };
+
+      auto culling = gfx::gpu_culling( gfx::gpu_culling::create_info_t( create_info ) );
+
+      std::string const name = is_draw_count_used ? "occlusion, draw count" : "occlusion, a command per instance";
+      if ( is_draw_count_used && !culling.is_compacted( ) )
+      {
+         std::cout << "   " << name << ": skipped, VK_KHR_draw_indirect_count is not enabled\n";
+
+         return 0;
+      }
+
+      for( std::uint32_t i = 0; i < s.spheres.size( ); ++i )
+      {
+         culling.add( glm::vec3( s.spheres[i] ), s.spheres[i].w, get_range( i ) );
+      }
+
+      auto const f = gfx::make_frustum( s.projection * s.view );
+
+      culling.set_camera( s.view, s.projection );
+      culling.set_depth_pyramid( pyramid );
+      culling.update( f );
+
+      std::vector<bool> is_in_frustum( s.spheres.size( ), false );
+      for( auto const index : cull_on_cpu( s, f ) )
+      {
+         is_in_frustum[index] = true;
+      }
+
+      std::vector<float> nearest_depths( s.spheres.size( ) );
+      std::vector<bool> is_ambiguous( s.spheres.size( ) );
+      for( std::uint32_t i = 0; i < s.spheres.size( ); ++i )
+      {
+         nearest_depths[i] = get_nearest_depth( s, s.spheres[i] );
+         is_ambiguous[i] = is_on_boundary( f, s.spheres[i] );
+      }
+
+      glm::vec4 const origin = s.projection * s.view * glm::vec4( 0.0f, 0.0f, 0.0f, 1.0f );
+      float const wall_depth = origin.z / origin.w;
+
+      struct frame
+      {
+         float depth;
+         char const* p_name;
+      }; // struct frame
+
+      std::array<frame, 4> const frames = 
+      {
+         frame{ 1.0f, "nothing drawn" },
+         frame{ wall_depth, "wall" },
+         frame{ wall_depth, "wall" },
+         frame{ 1.0f, "wall removed" }
+      };
+
+      // Nothing is visible before the first frame.
+      std::vector<bool> was_visible( s.spheres.size( ), false );
+
+      std::uint32_t mismatch_count = 0;
+      for( std::size_t i = 0; i < frames.size( ); ++i )
+      {
+         std::vector<std::uint32_t> early;
+         std::vector<std::uint32_t> late;
+         for( std::uint32_t j = 0; j < s.spheres.size( ); ++j )
+         {
+            // An instance that may go either way on the device leaves 
+            // its visibility unknown for the frames after.
+            is_ambiguous[j] = is_ambiguous[j] || std::abs( nearest_depths[j] - frames[i].depth ) < depth_tolerance;
+
+            bool const is_visible = is_in_frustum[j] && !( nearest_depths[j] > frames[i].depth );
+            if ( is_in_frustum[j] && was_visible[j] )
+            {
+               early.push_back( j );
+            }
+            else if ( is_visible )
+            {
+               late.push_back( j );
+            }
+
+            was_visible[j] = is_visible;
+         }
+
+         auto const result = cull_and_read( ctx, culling, [&]( VkCommandBuffer cmd_buffer ) 
+         { 
+            culling.record_cull( cmd_buffer, cull_phase::e_early ); 
+            record_depth_clear( cmd_buffer, depth_image, frames[i].depth );
+            pyramid.record_build( cmd_buffer );
+            culling.record_cull( cmd_buffer, cull_phase::e_late ); 
+         } );
+
+         std::string const frame_name = name + ", frame " + std::to_string( i + 1 ) + " (" + frames[i].p_name + ")";
+
+         mismatch_count += compare( result, culling, cull_phase::e_early, early, is_ambiguous, frame_name + ", early" );
+         mismatch_count += compare( result, culling, cull_phase::e_late, late, is_ambiguous, frame_name + ", late" );
+      }
+
+      return mismatch_count;
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   if ( argc < 2 )
+   {
+      std::cerr << "usage: " << argv[0] << " <shader directory>\n";
+
+      return 1;
+   }
+
+   try
+   {
+      ui::window::create_info const window_create_info
+      {
+         .title = "gpu_culling_check",
+         .position = { 100, 100 },
+         .size = { 320, 240 }
+      };
+
+      auto wnd = ui::window( ui::window::create_info_t( window_create_info ) );
+      auto ctx = context( wnd );
+
+      std::string const directory = argv[1];
+      std::string const cull_filepath = directory + "/cull_instances.comp";
+      std::string const occlusion_cull_filepath = directory + "/cull_occlusion.comp";
+      std::string const depth_pyramid_filepath = directory + "/depth_pyramid.comp";
+
+      vk::shader_compiler const compiler;
+      auto const cull_shader = compiler.load_shader( vk::shader::filepath_view_t( cull_filepath ) ).first;
+      auto const occlusion_cull_shader = compiler.load_shader( vk::shader::filepath_view_t( occlusion_cull_filepath ) ).first;
+      auto const depth_pyramid_shader = compiler.load_shader( vk::shader::filepath_view_t( depth_pyramid_filepath ) ).first;
+
+      std::mt19937 rng( 42 );
+      auto const s = make_scene( rng );
+
+      std::uint32_t mismatch_count = 0;
+      for( bool const is_draw_count_used : { true, false } )
+      {
+         mismatch_count += check_frustum_culling( ctx, cull_shader, s, is_draw_count_used );
+      }
+
+      for( bool const is_draw_count_used : { true, false } )
+      {
+         mismatch_count += check_occlusion_culling( ctx, occlusion_cull_shader, depth_pyramid_shader, s, is_draw_count_used );
+      }
+
+      if ( mismatch_count != 0 )
+      {
+         std::cout << mismatch_count << " mismatches\n";
+
+         return 1;
+      }
+   }
+   catch( std::exception const& e )
+   {
+      std::cerr << e.what( ) << '\n';
+
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/gltf_loader.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Decodes a glTF file into host memory with pools of an increasing
+ * number of threads, to see how the load time scales with cores:
+ *
+ *    load_benchmark <scene.gltf|scene.glb> [thread count...]
+ *
+ * By default the thread counts double from 1 up to the hardware
+ * concurrency. Each count keeps the best of a few runs, after a first
+ * run that warms the file cache. Parsing the file stays on a single
+ * thread, only the primitives are decoded in parallel.
+ */
+
+namespace
+{
+   constexpr int run_count = 3;
+
+   struct decode_timing
+   {
+      double time = 0.0;
+      std::size_t decoded_size = 0;
+   }; // struct decode_timing
+
+   std::vector<std::uint32_t> get_default_thread_counts( )
+   {
+      std::uint32_t const max_count = std::max( std::thread::hardware_concurrency( ), 1u );
+
+      std::vector<std::uint32_t> counts;
+      for( std::uint32_t count = 1; count < max_count; count *= 2 )
+      {
+         counts.push_back( count );
+      }
+
+      counts.push_back( max_count );
+
+      return counts;
+   }
+
+   /**
+    * @brief The best decode time of a file in milliseconds, with the
+    * size of the decoded vertices and indices.
+    */
+   decode_timing time_decode( std::string const& filepath, std::uint32_t thread_count )
+   {
+      thread_pool pool( thread_count );
+
+      assets::gltf_loader::create_info const loader_create_info
+      {
+         .p_context = nullptr,
+         .p_thread_pool = &pool
+      };
+
+      auto const loader = assets::gltf_loader( assets::gltf_loader::create_info_t( loader_create_info ) );
+
+      auto const warm_up = loader.decode( filepath );
+
+      decode_timing res
+      {
+         .time = std::numeric_limits<double>::max( ),
+         .decoded_size = warm_up.vertices.size( ) + warm_up.indices.size( ) * sizeof( std::uint32_t )
+      };
+
+      for( int i = 0; i < run_count; ++i )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         auto const data = loader.decode( filepath );
+         auto const time = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+
+         res.time = std::min( res.time, time );
+      }
+
+      return res;
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   if ( argc < 2 )
+   {
+      std::cerr << "usage: " << argv[0] << " <scene.gltf|scene.glb> [thread count...]\n";
+
+      return 1;
+   }
+
+   std::string const filepath = argv[1];
+
+   std::vector<std::uint32_t> thread_counts;
+   for( int i = 2; i < argc; ++i )
+   {
+      thread_counts.push_back( std::max( static_cast<std::uint32_t>( std::stoul( argv[i] ) ), 1u ) );
+   }
+
+   if ( thread_counts.empty( ) )
+   {
+      thread_counts = get_default_thread_counts( );
+   }
+
+   try
+   {
+      double first_time = 0.0;
+      for( auto thread_count : thread_counts )
+      {
+         auto const timing = time_decode( filepath, thread_count );
+         if ( first_time == 0.0 )
+         {
+            first_time = timing.time;
+         }
+
+         double const decoded_size = static_cast<double>( timing.decoded_size ) / ( 1024.0 * 1024.0 );
+
+         std::cout << thread_count << " threads: " << timing.time << " ms, " 
+            << decoded_size / ( timing.time / 1000.0 ) << " MiB/s decoded, "
+            << first_time / timing.time << "x\n";
+      }
+   }
+   catch( std::exception const& e )
+   {
+      std::cerr << e.what( ) << '\n';
+
+      return 1;
+   }
+
+   return 0;
+}
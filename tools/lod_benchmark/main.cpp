@@ -0,0 +1,248 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/frustum_culling.hpp>
+#include <luciole/graphics/lod_selection.hpp>
+#include <luciole/graphics/mesh_simplifier.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * Builds the levels of detail of a dense bumpy sphere, scatters copies
+ * of it around a camera and counts the triangles drawn with and without
+ * them, then moves the camera back and forth to count the switches the 
+ * hysteresis saves:
+ *
+ *    lod_benchmark [resolution] [object count]
+ *
+ * The resolution is the number of quads along an edge of the cube the
+ * sphere is made from, 128 by default, and there are 10k objects.
+ */
+
+namespace
+{
+   struct sphere_mesh
+   {
+      std::vector<glm::vec3> positions;
+      std::vector<std::uint32_t> indices;
+   }; // struct sphere_mesh
+
+   /**
+    * @brief A closed sphere of unit radius with bumps, made from the 
+    * faces of a subdivided cube.
+    */
+   sphere_mesh make_sphere( int resolution )
+   {
+      sphere_mesh res;
+      std::map<std::tuple<int, int, int>, std::uint32_t> vertices;
+
+      auto const get_vertex = [&] ( int x, int y, int z )
+      {
+         auto const [it, is_new] = vertices.try_emplace( std::make_tuple( x, y, z ), static_cast<std::uint32_t>( res.positions.size( ) ) );
+         if ( is_new )
+         {
+            auto const p = glm::normalize( glm::vec3( x, y, z ) * ( 2.0f / static_cast<float>( resolution ) ) - 1.0f );
+            res.positions.push_back( p * ( 1.0f + 0.05f * std::sin( p.x * 20.0f ) * std::sin( p.y * 17.0f ) ) );
+         }
+
+         return it->second;
+      };
+
+      for( int face = 0; face < 6; ++face )
+      {
+         int const axis = face / 2;
+         bool const is_positive = face % 2 == 1;
+
+         auto const get_face_vertex = [&] ( int u, int v )
+         {
+            int coords[3];
+            coords[axis] = is_positive ? resolution : 0;
+            coords[( axis + 1 ) % 3] = u;
+            coords[( axis + 2 ) % 3] = v;
+
+            return get_vertex( coords[0], coords[1], coords[2] );
+         };
+
+         for( int u = 0; u < resolution; ++u )
+         {
+            for( int v = 0; v < resolution; ++v )
+            {
+               std::uint32_t const a = get_face_vertex( u, v );
+               std::uint32_t const b = get_face_vertex( u + 1, v );
+               std::uint32_t const c = get_face_vertex( u + 1, v + 1 );
+               std::uint32_t const d = get_face_vertex( u, v + 1 );
+
+               if ( is_positive )
+               {
+                  res.indices.insert( res.indices.end( ), { a, b, c, a, c, d } );
+               }
+               else
+               {
+                  res.indices.insert( res.indices.end( ), { a, c, b, a, d, c } );
+               }
+            }
+         }
+      }
+
+      return res;
+   }
+
+   glm::mat4 look_from( glm::vec3 const& position )
+   {
+      return glm::lookAt( position, position + glm::vec3( 1.0f, 0.0f, 0.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   int const resolution = argc > 1 ? std::stoi( argv[1] ) : 128;
+   std::uint32_t const object_count = argc > 2 ? static_cast<std::uint32_t>( std::stoul( argv[2] ) ) : 10000;
+
+   thread_pool pool;
+
+   /* LEVELS */
+   auto const sphere = make_sphere( resolution );
+
+   auto const start = std::chrono::steady_clock::now( );
+   auto const chain = gfx::build_lod_chain( sphere.indices, sphere.positions, 6 );
+   auto const build_time = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+
+   std::vector<std::uint32_t> triangle_counts = { static_cast<std::uint32_t>( sphere.indices.size( ) / 3 ) };
+   std::vector<float> errors;
+
+   std::cout << "mesh: " << triangle_counts[0] << " triangles, " << chain.size( ) << " levels built in " << build_time << " ms\n";
+   for( std::size_t i = 0; i < chain.size( ); ++i )
+   {
+      triangle_counts.push_back( static_cast<std::uint32_t>( chain[i].indices.size( ) / 3 ) );
+      errors.push_back( chain[i].error );
+
+      std::cout << "   level " << i + 1 << ": " << triangle_counts.back( ) << " triangles, error " << chain[i].error << '\n';
+   }
+
+   /* SCENE */
+   std::mt19937 rng( 42 );
+   std::uniform_real_distribution<float> position( -1000.0f, 1000.0f );
+   std::uniform_real_distribution<float> size( 0.5f, 4.0f );
+
+   gfx::culling_set::create_info const culling_create_info
+   {
+      .p_thread_pool = &pool
+   };
+
+   auto culling = gfx::culling_set( gfx::culling_set::create_info_t( culling_create_info ) );
+
+   std::vector<glm::vec3> centers( object_count );
+   std::vector<float> scales( object_count );
+   for( std::uint32_t i = 0; i < object_count; ++i )
+   {
+      centers[i] = glm::vec3( position( rng ), position( rng ), position( rng ) * 0.05f );
+      scales[i] = size( rng );
+
+      // The bumps reach 5 percent past the unit sphere.
+      culling.add( centers[i] - glm::vec3( scales[i] * 1.05f ), centers[i] + glm::vec3( scales[i] * 1.05f ) );
+   }
+
+   auto const make_selector = [&] ( float hysteresis )
+   {
+      gfx::lod_selector::create_info const lod_create_info
+      {
+         .hysteresis = hysteresis
+      };
+
+      auto selector = gfx::lod_selector( gfx::lod_selector::create_info_t( lod_create_info ) );
+      for( std::uint32_t i = 0; i < object_count; ++i )
+      {
+         selector.add( centers[i], scales[i] * 1.05f, errors );
+         selector.set_bounds( i, centers[i], scales[i] * 1.05f, scales[i] );
+      }
+
+      return selector;
+   };
+
+   auto lods = make_selector( 0.25f );
+
+   float const width = 1920.0f;
+   float const height = 1080.0f;
+   auto const projection = glm::perspective( glm::radians( 60.0f ), width / height, 0.1f, 5000.0f );
+
+   std::vector<std::uint32_t> visible;
+
+   auto const camera = glm::vec3( -1000.0f, 0.0f, 10.0f );
+   culling.cull( gfx::make_frustum( projection * look_from( camera ) ), visible );
+
+   auto const select_start = std::chrono::steady_clock::now( );
+   lods.select( gfx::make_lod_view( look_from( camera ), projection, height ), visible );
+   auto const select_time = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - select_start ).count( );
+
+   std::uint64_t full_triangle_count = 0;
+   std::uint64_t lod_triangle_count = 0;
+   std::vector<std::uint32_t> level_counts( triangle_counts.size( ), 0 );
+   for( std::uint32_t index : visible )
+   {
+      full_triangle_count += triangle_counts[0];
+      lod_triangle_count += triangle_counts[lods.get_level( index )];
+      ++level_counts[lods.get_level( index )];
+   }
+
+   std::cout << visible.size( ) << " of " << object_count << " objects visible, levels selected in " << select_time << " ms\n";
+   std::cout << "   full detail: " << full_triangle_count << " triangles\n";
+   std::cout << "   levels of detail: " << lod_triangle_count << " triangles\n";
+   for( std::size_t i = 0; i < level_counts.size( ); ++i )
+   {
+      std::cout << "   level " << i << ": " << level_counts[i] << " objects\n";
+   }
+
+   /* HYSTERESIS */
+   for( float const hysteresis : { 0.0f, 0.25f } )
+   {
+      auto moving_lods = make_selector( hysteresis );
+
+      std::vector<std::uint32_t> previous_levels( object_count, 0 );
+      std::uint64_t switch_count = 0;
+
+      // The camera sways a couple of units back and forth, as a player
+      // standing still would.
+      for( int frame = 0; frame < 240; ++frame )
+      {
+         auto const view = look_from( camera + glm::vec3( 2.0f * std::sin( static_cast<float>( frame ) * 0.2f ), 0.0f, 0.0f ) );
+
+         culling.cull( gfx::make_frustum( projection * view ), visible );
+         moving_lods.select( gfx::make_lod_view( view, projection, height ), visible );
+
+         for( std::uint32_t index : visible )
+         {
+            switch_count += frame > 0 && moving_lods.get_level( index ) != previous_levels[index];
+            previous_levels[index] = moving_lods.get_level( index );
+         }
+      }
+
+      std::cout << "hysteresis " << hysteresis << ": " << switch_count << " level switches over 240 frames\n";
+   }
+
+   return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/utils/file_io.hpp>
+#include <luciole/vk/memory_stats.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <iostream>
+
+int main( int argc, char** argv )
+{
+   if ( argc < 3 )
+   {
+      std::cerr << "usage: " << argv[0] << " <before.json> <after.json> [output.json]\n";
+
+      return 1;
+   }
+
+   try
+   {
+      auto const before = nlohmann::json::parse( read_from_file( argv[1] ) );
+      auto const after = nlohmann::json::parse( read_from_file( argv[2] ) );
+
+      auto const diff = vk::diff_memory_stats( before, after ).dump( 3 );
+
+      if ( argc > 3 )
+      {
+         write_to_file( argv[3], diff );
+      }
+      else
+      {
+         std::cout << diff << '\n';
+      }
+   }
+   catch( std::exception const& e )
+   {
+      std::cerr << e.what( ) << '\n';
+
+      return 1;
+   }
+
+   return 0;
+}
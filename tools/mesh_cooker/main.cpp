@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/cooked_mesh.hpp>
+#include <luciole/assets/gltf_loader.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main( int argc, char** argv )
+{
+   if ( argc < 3 )
+   {
+      std::cerr << "usage: " << argv[0] << " <input.gltf|input.glb> <output.lmsh> [max lod count]\n";
+
+      return 1;
+   }
+
+   try
+   {
+      thread_pool pool;
+
+      assets::gltf_loader::create_info loader_create_info
+      {
+         .p_context = nullptr,
+         .p_thread_pool = &pool
+      };
+
+      auto const loader = assets::gltf_loader( assets::gltf_loader::create_info_t( loader_create_info ) );
+
+      assets::lod_settings settings;
+      if ( argc > 3 )
+      {
+         settings.max_lod_count = static_cast<std::uint32_t>( std::stoul( argv[3] ) );
+      }
+
+      auto data = loader.decode( argv[1] );
+      assets::generate_lods( data, settings, pool );
+
+      std::cout << "ACMR: " << data.optimization.before.acmr << " -> " << data.optimization.after.acmr << '\n';
+      std::cout << "ATVR: " << data.optimization.before.atvr << " -> " << data.optimization.after.atvr << '\n';
+
+      auto const cooked = assets::cook_meshes( data );
+
+      std::ofstream file( argv[2], std::ios::binary );
+      if ( !file.good( ) )
+      {
+         std::cerr << "Error opening file: " << argv[2] << ".\n";
+
+         return 1;
+      }
+
+      file.write( reinterpret_cast<char const*>( cooked.data( ) ), static_cast<std::streamsize>( cooked.size( ) ) );
+   }
+   catch( std::exception const& e )
+   {
+      std::cerr << e.what( ) << '\n';
+
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/software_occlusion.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Draws a city of walls into a gfx::occlusion_buffer and tests boxes 
+ * scattered behind and between them, on the calling thread and across a
+ * thread pool:
+ *
+ *    occlusion_benchmark [box count...]
+ *
+ * The counts default to 10k and 100k boxes. tests/software_occlusion_tests.cpp
+ * checks that both buffers hold the same depth and keep the same boxes.
+ */
+
+namespace
+{
+   struct mesh
+   {
+      std::vector<glm::vec3> positions;
+      std::vector<std::uint32_t> indices;
+   }; // struct mesh
+
+   template<typename F>
+   double measure( std::uint32_t iteration_count, F&& f )
+   {
+      std::vector<double> times;
+      times.reserve( iteration_count );
+
+      for( std::uint32_t i = 0; i < iteration_count; ++i )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         f( );
+         times.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( ) );
+      }
+
+      std::sort( times.begin( ), times.end( ) );
+
+      return times[times.size( ) / 2];
+   }
+
+   /**
+    * @brief A cube from -1 to 1, to be scaled into walls.
+    */
+   mesh make_cube( )
+   {
+      mesh cube;
+      for( std::uint32_t corner = 0; corner < 8; ++corner )
+      {
+         cube.positions.emplace_back( 
+            ( corner & 1u ) ? 1.0f : -1.0f, 
+            ( corner & 2u ) ? 1.0f : -1.0f, 
+            ( corner & 4u ) ? 1.0f : -1.0f 
+         );
+      }
+
+      cube.indices = { 
+         0, 1, 3, 0, 3, 2,   4, 6, 7, 4, 7, 5, 
+         0, 4, 5, 0, 5, 1,   2, 3, 7, 2, 7, 6, 
+         0, 2, 6, 0, 6, 4,   1, 5, 7, 1, 7, 3 
+      };
+
+      return cube;
+   }
+
+   void draw( gfx::occlusion_buffer& buffer, glm::mat4 const& view_projection, mesh const& cube, std::vector<glm::mat4> const& walls )
+   {
+      buffer.begin_frame( view_projection );
+      for( auto const& wall : walls )
+      {
+         buffer.add_occluder( cube.positions, cube.indices, wall );
+      }
+
+      buffer.rasterize( );
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   std::vector<std::uint32_t> box_counts;
+   for( int i = 1; i < argc; ++i )
+   {
+      box_counts.push_back( static_cast<std::uint32_t>( std::stoul( argv[i] ) ) );
+   }
+
+   if ( box_counts.empty( ) )
+   {
+      box_counts = { 10000, 100000 };
+   }
+
+   glm::mat4 const view = glm::lookAt( glm::vec3( 0.0f, 0.0f, 2.0f ), glm::vec3( 1.0f, 0.0f, 2.0f ), glm::vec3( 0.0f, 0.0f, 1.0f ) );
+   glm::mat4 const projection = glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 500.0f );
+   glm::mat4 const view_projection = projection * view;
+
+   auto const cube = make_cube( );
+
+   /* A wall across the view, then rows of buildings. */
+   std::vector<glm::mat4> walls;
+   walls.push_back( glm::scale( glm::translate( glm::mat4( 1.0f ), glm::vec3( 30.0f, -6.0f, 4.0f ) ), glm::vec3( 0.5f, 8.0f, 4.0f ) ) );
+
+   std::mt19937 rng( 42 );
+   std::uniform_real_distribution<float> wall_height( 3.0f, 20.0f );
+   std::uniform_real_distribution<float> wall_width( 2.0f, 8.0f );
+   for( float x = 40.0f; x < 200.0f; x += 20.0f )
+   {
+      for( float y = -100.0f; y < 100.0f; y += 20.0f )
+      {
+         float const height = wall_height( rng );
+         walls.push_back( glm::scale( 
+            glm::translate( glm::mat4( 1.0f ), glm::vec3( x, y, height ) ), 
+            glm::vec3( wall_width( rng ), wall_width( rng ), height ) 
+         ) );
+      }
+   }
+
+   thread_pool pool;
+
+   gfx::occlusion_buffer::create_info const serial_create_info { };
+   gfx::occlusion_buffer::create_info const parallel_create_info 
+   {
+      .p_thread_pool = &pool
+   };
+
+   auto serial_buffer = gfx::occlusion_buffer( gfx::occlusion_buffer::create_info_t( serial_create_info ) );
+   auto parallel_buffer = gfx::occlusion_buffer( gfx::occlusion_buffer::create_info_t( parallel_create_info ) );
+
+   auto const serial_raster = measure( 50, [&] { draw( serial_buffer, view_projection, cube, walls ); } );
+   auto const parallel_raster = measure( 50, [&] { draw( parallel_buffer, view_projection, cube, walls ); } );
+
+   auto const& stats = serial_buffer.get_stats( );
+   std::cout << serial_buffer.get_width( ) << "x" << serial_buffer.get_height( ) << " buffer, " << stats.occluder_count << " occluders, " 
+      << stats.triangle_count << " triangles, " << stats.skipped_triangle_count << " skipped\n";
+   std::cout << "   rasterize, serial: " << serial_raster << " ms\n";
+   std::cout << "   rasterize, " << pool.get_thread_count( ) << " threads: " << parallel_raster << " ms\n";
+
+   for( auto const box_count : box_counts )
+   {
+      std::uniform_real_distribution<float> forward( 5.0f, 250.0f );
+      std::uniform_real_distribution<float> side( -120.0f, 120.0f );
+      std::uniform_real_distribution<float> up( 0.0f, 10.0f );
+      std::uniform_real_distribution<float> size( 0.5f, 3.0f );
+
+      std::vector<gfx::aabb> boxes( box_count );
+      for( auto& b : boxes )
+      {
+         b.min = glm::vec3( forward( rng ), side( rng ), up( rng ) );
+         b.max = b.min + glm::vec3( size( rng ), size( rng ), size( rng ) );
+      }
+
+      std::uint32_t const iteration_count = std::max( 5u, 1000000u / box_count );
+
+      std::vector<std::uint32_t> visible;
+
+      auto const serial = measure( iteration_count, [&] { serial_buffer.cull( boxes, visible ); } );
+      auto const parallel = measure( iteration_count, [&] { parallel_buffer.cull( boxes, visible ); } );
+
+      std::cout << box_count << " boxes, " << box_count - visible.size( ) << " culled\n";
+      std::cout << "   test, serial: " << serial << " ms, " << serial * 1e6 / box_count << " ns per box\n";
+      std::cout << "   test, " << pool.get_thread_count( ) << " threads: " << parallel << " ms, " << parallel * 1e6 / box_count << " ns per box\n";
+   }
+
+   return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/scene.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#if defined( _WIN32 )
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+/**
+ * Compares loading a large scene from JSON and from a snapshot. Each 
+ * format is loaded by its own run of the tool, so the peak memory of
+ * the process is that of the format alone:
+ *
+ *    scene_benchmark generate <directory> [entity count]
+ *    scene_benchmark json <directory>
+ *    scene_benchmark snapshot <directory>
+ */
+
+namespace
+{
+   /**
+    * @brief The peak resident memory of the process, in bytes.
+    */
+   std::uint64_t get_peak_memory( )
+   {
+#if defined( _WIN32 )
+      PROCESS_MEMORY_COUNTERS counters;
+      GetProcessMemoryInfo( GetCurrentProcess( ), &counters, sizeof( counters ) );
+
+      return counters.PeakWorkingSetSize;
+#else
+      rusage usage;
+      getrusage( RUSAGE_SELF, &usage );
+
+#  if defined( __APPLE__ )
+      return static_cast<std::uint64_t>( usage.ru_maxrss );
+#  else
+      return static_cast<std::uint64_t>( usage.ru_maxrss ) * 1024;
+#  endif
+#endif
+   }
+
+   assets::scene_description generate_scene( std::uint32_t entity_count )
+   {
+      static constexpr std::uint32_t mesh_count = 64;
+
+      std::mt19937 rng( 42 );
+      std::uniform_real_distribution<float> position( -1000.0f, 1000.0f );
+
+      assets::scene_description scene;
+      scene.entities.resize( entity_count );
+
+      for( std::uint32_t i = 0; i < entity_count; ++i )
+      {
+         auto& entity = scene.entities[i];
+         entity.name = "entity_" + std::to_string( i );
+         entity.parent = i % 8 == 0 ? -1 : static_cast<std::int32_t>( i - i % 8 );
+         entity.translation = glm::vec3( position( rng ), position( rng ), position( rng ) );
+         entity.mesh = "data/meshes/mesh_" + std::to_string( i % mesh_count ) + ".lmsh";
+         entity.mesh_index = 0;
+      }
+
+      return scene;
+   }
+
+   void report( char const* format, std::chrono::steady_clock::time_point start, std::uint32_t entity_count, float checksum )
+   {
+      auto const elapsed = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+
+      std::cout << format << ": " << entity_count << " entities loaded in " << elapsed << " ms, peak memory " 
+         << get_peak_memory( ) / ( 1024 * 1024 ) << " MiB (checksum " << checksum << ")\n";
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   if ( argc < 3 )
+   {
+      std::cerr << "usage: " << argv[0] << " <generate|json|snapshot> <directory> [entity count]\n";
+
+      return 1;
+   }
+
+   std::string const directory = argv[2];
+   std::string const json_path = directory + "/scene.json";
+   std::string const snapshot_path = directory + "/scene.lscn";
+
+   try
+   {
+      if ( std::strcmp( argv[1], "generate" ) == 0 )
+      {
+         auto const entity_count = argc >= 4 ? static_cast<std::uint32_t>( std::stoul( argv[3] ) ) : 1000000u;
+         auto const scene = generate_scene( entity_count );
+
+         assets::write_scene_json( scene, json_path );
+
+         auto const snapshot = assets::cook_scene( scene );
+
+         std::ofstream file( snapshot_path, std::ios::binary );
+         file.write( reinterpret_cast<char const*>( snapshot.data( ) ), static_cast<std::streamsize>( snapshot.size( ) ) );
+      }
+      else if ( std::strcmp( argv[1], "json" ) == 0 )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         auto const scene = assets::read_scene_json( json_path );
+
+         float checksum = 0.0f;
+         for( auto const& entity : scene.entities )
+         {
+            checksum += entity.translation.x + static_cast<float>( entity.mesh.size( ) );
+         }
+
+         report( "json", start, static_cast<std::uint32_t>( scene.entities.size( ) ), checksum );
+      }
+      else if ( std::strcmp( argv[1], "snapshot" ) == 0 )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         auto const scene = assets::scene_snapshot( snapshot_path );
+
+         float checksum = 0.0f;
+         for( std::uint32_t i = 0; i < scene.get_entity_count( ); ++i )
+         {
+            auto const& entity = scene.get_entity( i );
+            checksum += entity.translation[0] + static_cast<float>( entity.mesh.get( ).size( ) );
+         }
+
+         report( "snapshot", start, scene.get_entity_count( ), checksum );
+      }
+      else
+      {
+         std::cerr << "Unknown command: " << argv[1] << ".\n";
+
+         return 1;
+      }
+   }
+   catch( std::exception const& e )
+   {
+      std::cerr << e.what( ) << '\n';
+
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/assets/ktx2.hpp>
+#include <luciole/assets/texture_loader.hpp>
+#include <luciole/graphics/block_compression.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+namespace
+{
+   std::optional<gfx::block_format> parse_block_format( std::string const& name )
+   {
+      if ( name == "bc1" ) return gfx::block_format::e_bc1;
+      if ( name == "bc3" ) return gfx::block_format::e_bc3;
+      if ( name == "bc4" ) return gfx::block_format::e_bc4;
+      if ( name == "bc5" ) return gfx::block_format::e_bc5;
+      if ( name == "bc7" ) return gfx::block_format::e_bc7;
+
+      return std::nullopt;
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   auto const format = argc >= 4 ? parse_block_format( argv[3] ) : std::nullopt;
+   if ( !format )
+   {
+      std::cerr << "usage: " << argv[0] << " <input image> <output.ktx2> <bc1|bc3|bc4|bc5|bc7> [--linear]\n";
+
+      return 1;
+   }
+
+   bool const is_linear = argc >= 5 && std::strcmp( argv[4], "--linear" ) == 0;
+
+   try
+   {
+      thread_pool pool;
+
+      assets::texture_loader::create_info loader_create_info
+      {
+         .p_context = nullptr,
+         .p_thread_pool = &pool
+      };
+
+      auto const loader = assets::texture_loader( assets::texture_loader::create_info_t( loader_create_info ) );
+
+      auto const image = loader.decode( argv[1], is_linear ? assets::color_space::e_linear : assets::color_space::e_srgb );
+      auto const cooked = assets::cook_texture( image, *format, &pool );
+
+      std::ofstream file( argv[2], std::ios::binary );
+      if ( !file.good( ) )
+      {
+         std::cerr << "Error opening file: " << argv[2] << ".\n";
+
+         return 1;
+      }
+
+      file.write( reinterpret_cast<char const*>( cooked.data( ) ), static_cast<std::streamsize>( cooked.size( ) ) );
+
+      std::cout << argv[2] << ": " << image.pixels.size( ) << " bytes of pixels cooked into " << cooked.size( ) << " bytes with mips.\n";
+   }
+   catch( std::exception const& e )
+   {
+      std::cerr << e.what( ) << '\n';
+
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/graphics/transform_hierarchy.hpp>
+#include <luciole/threads/thread_pool.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Animates every node of a forest of transforms each frame, with a 
+ * gfx::transform_hierarchy and with an array of nodes composing glm 
+ * matrices one at a time:
+ *
+ *    transform_benchmark [node count] [nodes per root] [frame count]
+ */
+
+namespace
+{
+   /**
+    * @brief The baseline: a node and its matrices side by side, the 
+    * parents before their children.
+    */
+   struct scene_node
+   {
+      glm::vec3 position = glm::vec3( 0.0f );
+      glm::quat rotation = glm::quat( 1.0f, 0.0f, 0.0f, 0.0f );
+      glm::vec3 scale = glm::vec3( 1.0f );
+
+      std::uint32_t parent = std::numeric_limits<std::uint32_t>::max( );
+
+      glm::mat4 world = glm::mat4( 1.0f );
+   }; // struct scene_node
+
+   template<typename F>
+   double measure( std::uint32_t frame_count, F&& f )
+   {
+      std::vector<double> times;
+      times.reserve( frame_count );
+
+      for( std::uint32_t i = 0; i < frame_count; ++i )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         f( i );
+         times.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( ) );
+      }
+
+      std::sort( times.begin( ), times.end( ) );
+
+      return times[times.size( ) / 2];
+   }
+
+   void report( char const* name, double milliseconds, std::uint32_t node_count )
+   {
+      std::cout << name << ": " << milliseconds << " ms, " 
+         << milliseconds * 1e6 / node_count << " ns per node\n";
+   }
+
+   glm::quat get_spin( std::uint32_t frame ) 
+   {
+      return glm::angleAxis( static_cast<float>( frame ) * 0.01f, glm::vec3( 0.0f, 0.0f, 1.0f ) );
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   auto const node_count = argc >= 2 ? static_cast<std::uint32_t>( std::stoul( argv[1] ) ) : 200000u;
+   auto const nodes_per_root = argc >= 3 ? std::max( static_cast<std::uint32_t>( std::stoul( argv[2] ) ), 1u ) : 200u;
+   auto const frame_count = argc >= 4 ? static_cast<std::uint32_t>( std::stoul( argv[3] ) ) : 50u;
+
+   std::mt19937 rng( 42 );
+   std::uniform_real_distribution<float> offset( -1.0f, 1.0f );
+
+   /* Each node hangs under one of the few nodes created before it in its tree. */
+   std::vector<std::uint32_t> parents( node_count );
+   for( std::uint32_t i = 0; i < node_count; ++i )
+   {
+      std::uint32_t const rank = i % nodes_per_root;
+      parents[i] = rank == 0 ? std::numeric_limits<std::uint32_t>::max( ) : i - 1 - rng( ) % std::min( rank, 8u );
+   }
+
+   std::vector<glm::vec3> positions( node_count );
+   for( auto& position : positions )
+   {
+      position = glm::vec3( offset( rng ), offset( rng ), offset( rng ) );
+   }
+
+   std::vector<scene_node> nodes( node_count );
+   for( std::uint32_t i = 0; i < node_count; ++i )
+   {
+      nodes[i].position = positions[i];
+      nodes[i].parent = parents[i];
+   }
+
+   auto const baseline = measure( frame_count, [&] ( std::uint32_t frame ) 
+   {
+      auto const spin = get_spin( frame );
+
+      for( auto& node : nodes )
+      {
+         node.rotation = spin;
+
+         glm::mat4 const local = glm::translate( glm::mat4( 1.0f ), node.position ) * 
+            glm::mat4_cast( node.rotation ) * glm::scale( glm::mat4( 1.0f ), node.scale );
+
+         node.world = node.parent == std::numeric_limits<std::uint32_t>::max( ) ? local : nodes[node.parent].world * local;
+      }
+   } );
+
+   report( "array of nodes", baseline, node_count );
+
+   thread_pool pool;
+
+   for( auto* p_pool : { static_cast<thread_pool*>( nullptr ), &pool } )
+   {
+      gfx::transform_hierarchy::create_info const create_info 
+      {
+         .p_thread_pool = p_pool
+      };
+
+      auto hierarchy = gfx::transform_hierarchy( gfx::transform_hierarchy::create_info_t( create_info ) );
+
+      std::vector<gfx::transform_node> handles( node_count );
+      for( std::uint32_t i = 0; i < node_count; ++i )
+      {
+         handles[i] = hierarchy.create( 
+            parents[i] == std::numeric_limits<std::uint32_t>::max( ) ? gfx::transform_hierarchy::null_node : handles[parents[i]] 
+         );
+
+         hierarchy.set_position( handles[i], positions[i] );
+      }
+
+      hierarchy.update( );
+
+      auto const all = measure( frame_count, [&] ( std::uint32_t frame ) 
+      {
+         auto const spin = get_spin( frame );
+         for( auto const handle : handles )
+         {
+            hierarchy.set_rotation( handle, spin );
+         }
+
+         hierarchy.update( );
+      } );
+
+      /* Only a few roots move, the rest of the forest is left as is. */
+      auto const some = measure( frame_count, [&] ( std::uint32_t frame ) 
+      {
+         for( std::uint32_t i = 0; i < node_count; i += nodes_per_root * 100 )
+         {
+            hierarchy.set_position( handles[i], glm::vec3( static_cast<float>( frame ), 0.0f, 0.0f ) );
+         }
+
+         hierarchy.update( );
+      } );
+
+      std::string const suffix = p_pool == nullptr ? ", serial" : ", " + std::to_string( pool.get_thread_count( ) ) + " threads";
+
+      report( ( "transform_hierarchy, every node" + suffix ).c_str( ), all, node_count );
+      report( ( "transform_hierarchy, 1% of the roots" + suffix ).c_str( ), some, node_count );
+
+      /* Both end on the same rotation, only the translations differ. */
+      float error = 0.0f;
+      for( std::uint32_t i = 0; i < node_count; i += 997 )
+      {
+         glm::mat4 const world = hierarchy.get_world_matrix( handles[i] );
+
+         for( int column = 0; column < 3; ++column )
+         {
+            error = std::max( error, glm::length( glm::vec3( world[column] ) - glm::vec3( nodes[i].world[column] ) ) );
+         }
+      }
+
+      std::cout << "largest difference in rotation with the array of nodes: " << error << '\n';
+   }
+
+   return 0;
+}
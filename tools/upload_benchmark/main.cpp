@@ -0,0 +1,572 @@
+/*
+ *  Copyright (C) 2018-2019 Wmbat
+ *
+ *  wmbat@protonmail.com
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  You should have received a copy of the GNU General Public License
+ *  GNU General Public License for more details.
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <luciole/context.hpp>
+#include <luciole/ui/window.hpp>
+#include <luciole/vk/buffers/queue_ownership.hpp>
+#include <luciole/vk/shaders/shader_compiler.hpp>
+
+#include <vma/vk_mem_alloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Copies vertex buffers on the transfer queue and draws them on the 
+ * graphics queue, with the buffers shared concurrently by both families 
+ * and with exclusive buffers handed over by release and acquire 
+ * barriers:
+ *
+ *    upload_benchmark <upload_benchmark.vert> [buffer size in KiB...]
+ *
+ * The sizes default to 64 KiB, 1 MiB and 16 MiB, 8 buffers a round. The
+ * draws have the rasterizer discarded, so only the vertex fetch of the
+ * uploaded buffers is measured on the graphics side.
+ */
+
+namespace
+{
+   std::uint32_t constexpr buffer_count = 8;
+   std::uint32_t constexpr vertex_stride = 3 * sizeof( float );
+
+   struct draw_state
+   {
+      VkRenderPass render_pass = VK_NULL_HANDLE;
+      VkFramebuffer framebuffer = VK_NULL_HANDLE;
+      VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+      VkPipeline pipeline = VK_NULL_HANDLE;
+   }; // struct draw_state
+
+   template<typename F>
+   double measure( std::uint32_t iteration_count, F&& f )
+   {
+      std::vector<double> times;
+      times.reserve( iteration_count );
+
+      for( std::uint32_t i = 0; i < iteration_count; ++i )
+      {
+         auto const start = std::chrono::steady_clock::now( );
+         f( );
+         times.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( ) );
+      }
+
+      std::sort( times.begin( ), times.end( ) );
+
+      return times[times.size( ) / 2];
+   }
+
+   template<typename T>
+   T get_or_throw( std::variant<T, vk::error>&& result, char const* p_what )
+   {
+      if ( auto const* p_err = std::get_if<vk::error>( &result ) )
+      {
+         throw std::runtime_error( std::string( p_what ) + ": " + p_err->to_string( ) );
+      }
+
+      return std::get<T>( std::move( result ) );
+   }
+
+   void throw_on_error( vk::error const& err, char const* p_what )
+   {
+      if ( err.is_error( ) )
+      {
+         throw std::runtime_error( std::string( p_what ) + ": " + err.to_string( ) );
+      }
+   }
+
+   /**
+    * @brief A render pass without attachments and a pipeline that only 
+    * reads the positions of the vertices.
+    */
+   draw_state create_draw_state( context const& ctx, std::vector<std::uint32_t> const& spir_v )
+   {
+      draw_state state;
+
+      VkSubpassDescription const subpass
+      {
+         .flags = 0,
+         .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+         .inputAttachmentCount = 0,
+         .pInputAttachments = nullptr,
+         .colorAttachmentCount = 0,
+         .pColorAttachments = nullptr,
+         .pResolveAttachments = nullptr,
+         .pDepthStencilAttachment = nullptr,
+         .preserveAttachmentCount = 0,
+         .pPreserveAttachments = nullptr
+      };
+
+      VkRenderPassCreateInfo const render_pass_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .attachmentCount = 0,
+         .pAttachments = nullptr,
+         .subpassCount = 1,
+         .pSubpasses = &subpass,
+         .dependencyCount = 0,
+         .pDependencies = nullptr
+      };
+
+      state.render_pass = get_or_throw( ctx.create_render_pass( vk::render_pass_create_info_t( render_pass_create_info ) ), "render pass" );
+
+      VkFramebufferCreateInfo const framebuffer_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .renderPass = state.render_pass,
+         .attachmentCount = 0,
+         .pAttachments = nullptr,
+         .width = 1,
+         .height = 1,
+         .layers = 1
+      };
+
+      state.framebuffer = get_or_throw( ctx.create_framebuffer( vk::framebuffer_create_info_t( framebuffer_create_info ) ), "framebuffer" );
+
+      VkPipelineLayoutCreateInfo const layout_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .setLayoutCount = 0,
+         .pSetLayouts = nullptr,
+         .pushConstantRangeCount = 0,
+         .pPushConstantRanges = nullptr
+      };
+
+      state.pipeline_layout = get_or_throw( ctx.create_pipeline_layout( vk::pipeline_layout_create_info_t( layout_create_info ) ), "pipeline layout" );
+
+      VkShaderModuleCreateInfo const module_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .codeSize = spir_v.size( ) * sizeof( std::uint32_t ),
+         .pCode = spir_v.data( )
+      };
+
+      auto const vert_shader = ctx.create_shader_module( vk::shader_module_create_info_t( module_create_info ) );
+
+      VkPipelineShaderStageCreateInfo const stage_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .stage = VK_SHADER_STAGE_VERTEX_BIT,
+         .module = vert_shader,
+         .pName = "main",
+         .pSpecializationInfo = nullptr
+      };
+
+      VkVertexInputBindingDescription const binding_description
+      {
+         .binding = 0,
+         .stride = vertex_stride,
+         .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+      };
+
+      VkVertexInputAttributeDescription const attribute_description
+      {
+         .location = 0,
+         .binding = 0,
+         .format = VK_FORMAT_R32G32B32_SFLOAT,
+         .offset = 0
+      };
+
+      VkPipelineVertexInputStateCreateInfo const vertex_input_state_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .vertexBindingDescriptionCount = 1,
+         .pVertexBindingDescriptions = &binding_description,
+         .vertexAttributeDescriptionCount = 1,
+         .pVertexAttributeDescriptions = &attribute_description
+      };
+
+      VkPipelineInputAssemblyStateCreateInfo const input_assembly_state_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST,
+         .primitiveRestartEnable = VK_FALSE
+      };
+
+      /* Nothing is rasterized, so there is no viewport, multisample or 
+         blend state to give. */
+      VkPipelineRasterizationStateCreateInfo const rasterization_state_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .depthClampEnable = VK_FALSE,
+         .rasterizerDiscardEnable = VK_TRUE,
+         .polygonMode = VK_POLYGON_MODE_FILL,
+         .cullMode = VK_CULL_MODE_NONE,
+         .frontFace = VK_FRONT_FACE_CLOCKWISE,
+         .depthBiasEnable = VK_FALSE,
+         .depthBiasConstantFactor = 0.0f,
+         .depthBiasClamp = 0.0f,
+         .depthBiasSlopeFactor = 0.0f,
+         .lineWidth = 1.0f
+      };
+
+      VkGraphicsPipelineCreateInfo const pipeline_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .stageCount = 1,
+         .pStages = &stage_create_info,
+         .pVertexInputState = &vertex_input_state_create_info,
+         .pInputAssemblyState = &input_assembly_state_create_info,
+         .pTessellationState = nullptr,
+         .pViewportState = nullptr,
+         .pRasterizationState = &rasterization_state_create_info,
+         .pMultisampleState = nullptr,
+         .pDepthStencilState = nullptr,
+         .pColorBlendState = nullptr,
+         .pDynamicState = nullptr,
+         .layout = state.pipeline_layout,
+         .renderPass = state.render_pass,
+         .subpass = 0,
+         .basePipelineHandle = VK_NULL_HANDLE,
+         .basePipelineIndex = 0
+      };
+
+      auto temp_pipeline = ctx.create_pipeline( vk::graphics_pipeline_create_info_t( pipeline_create_info ) );
+      ctx.destroy_shader_module( vk::shader_module_t( vert_shader ) );
+
+      state.pipeline = get_or_throw( std::move( temp_pipeline ), "pipeline" );
+
+      return state;
+   }
+
+   void destroy_draw_state( context const& ctx, draw_state const& state )
+   {
+      ctx.destroy_pipeline( vk::pipeline_t( state.pipeline ) );
+      ctx.destroy_pipeline_layout( vk::pipeline_layout_t( state.pipeline_layout ) );
+      ctx.destroy_framebuffer( vk::framebuffer_t( state.framebuffer ) );
+      ctx.destroy_render_pass( vk::render_pass_t( state.render_pass ) );
+   }
+
+   std::vector<vk::buffer_allocation> create_vertex_buffers( context const& ctx, VkDeviceSize size, bool is_concurrent )
+   {
+      auto const families = ctx.get_unique_family_indices( );
+
+      VkBufferCreateInfo const create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0,
+         .size = size,
+         .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+         .sharingMode = is_concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+         .queueFamilyIndexCount = is_concurrent ? static_cast<std::uint32_t>( families.size( ) ) : 0u,
+         .pQueueFamilyIndices = is_concurrent ? families.data( ) : nullptr
+      };
+
+      VmaAllocationCreateInfo alloc_info = { };
+      alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+      std::vector<vk::buffer_allocation> buffers;
+      for( std::uint32_t i = 0; i < buffer_count; ++i )
+      {
+         buffers.push_back( get_or_throw( ctx.create_buffer( 
+            vk::buffer_create_info_t( create_info ), 
+            vk::allocation_create_info_t( alloc_info ), 
+            vk::memory_category::e_vertex_buffer 
+         ), "vertex buffer" ) );
+      }
+
+      return buffers;
+   }
+
+   /**
+    * @brief Copy the staging buffer into every vertex buffer on the 
+    * transfer queue, then draw them all on the graphics queue once the 
+    * copies are done.
+    *
+    * @param [in] is_exclusive Whether the buffers are handed from the 
+    * transfer family to the graphics family.
+    */
+   void upload_and_draw( 
+      context const& ctx, 
+      draw_state const& state, 
+      vk::buffer_allocation const& staging_buffer, 
+      std::vector<vk::buffer_allocation> const& buffers, 
+      bool is_exclusive, 
+      VkSemaphore semaphore, 
+      VkFence fence )
+   {
+      auto const transfer_family_index = ctx.get_queue_family_index( queue::flag_t( queue::flag::e_transfer ) );
+      auto const graphics_family_index = ctx.get_queue_family_index( queue::flag_t( queue::flag::e_graphics ) );
+      bool const is_handed_over = is_exclusive && transfer_family_index != graphics_family_index;
+
+      auto const make_transfer = [&] ( vk::buffer_allocation const& buffer )
+      {
+         return vk::ownership_transfer_info
+         {
+            .p_context = &ctx,
+            .p_buffer = &buffer,
+            .ownership = vk::queue_ownership{ .owner = queue::flag::e_transfer, .family_index = transfer_family_index, .transfer_count = 0 },
+            .dst_queue = queue::flag::e_graphics,
+            .src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .src_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dst_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            .dst_access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT
+         };
+      };
+
+      /* COPY */
+      auto copy_cmd_buffer = get_or_throw( vk::begin_one_time_commands( &ctx, queue::flag::e_transfer ), "transfer commands" );
+
+      for( auto const& buffer : buffers )
+      {
+         VkBufferCopy const copy_region
+         {
+            .srcOffset = 0,
+            .dstOffset = 0,
+            .size = buffer.size
+         };
+
+         vkCmdCopyBuffer( copy_cmd_buffer, staging_buffer.handle, buffer.handle, 1, &copy_region );
+
+         if ( is_handed_over )
+         {
+            vk::record_ownership_release( copy_cmd_buffer, make_transfer( buffer ), graphics_family_index );
+         }
+      }
+
+      vkEndCommandBuffer( copy_cmd_buffer );
+
+      /* DRAW */
+      auto draw_cmd_buffer = get_or_throw( vk::begin_one_time_commands( &ctx, queue::flag::e_graphics ), "graphics commands" );
+
+      if ( is_handed_over )
+      {
+         for( auto const& buffer : buffers )
+         {
+            vk::record_ownership_acquire( draw_cmd_buffer, make_transfer( buffer ), graphics_family_index );
+         }
+      }
+
+      VkRenderPassBeginInfo const begin_info
+      {
+         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+         .pNext = nullptr,
+         .renderPass = state.render_pass,
+         .framebuffer = state.framebuffer,
+         .renderArea = { { 0, 0 }, { 1, 1 } },
+         .clearValueCount = 0,
+         .pClearValues = nullptr
+      };
+
+      vkCmdBeginRenderPass( draw_cmd_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE );
+      vkCmdBindPipeline( draw_cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.pipeline );
+
+      for( auto const& buffer : buffers )
+      {
+         VkDeviceSize const offset = 0;
+         vkCmdBindVertexBuffers( draw_cmd_buffer, 0, 1, &buffer.handle, &offset );
+         vkCmdDraw( draw_cmd_buffer, static_cast<std::uint32_t>( buffer.size / vertex_stride ), 1, 0, 0 );
+      }
+
+      vkCmdEndRenderPass( draw_cmd_buffer );
+      vkEndCommandBuffer( draw_cmd_buffer );
+
+      /* SUBMIT */
+      VkPipelineStageFlags const wait_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+
+      VkSubmitInfo const copy_submit_info
+      {
+         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+         .pNext = nullptr,
+         .waitSemaphoreCount = 0,
+         .pWaitSemaphores = nullptr,
+         .pWaitDstStageMask = nullptr,
+         .commandBufferCount = 1,
+         .pCommandBuffers = &copy_cmd_buffer,
+         .signalSemaphoreCount = 1,
+         .pSignalSemaphores = &semaphore
+      };
+
+      VkSubmitInfo const draw_submit_info
+      {
+         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+         .pNext = nullptr,
+         .waitSemaphoreCount = 1,
+         .pWaitSemaphores = &semaphore,
+         .pWaitDstStageMask = &wait_stage,
+         .commandBufferCount = 1,
+         .pCommandBuffers = &draw_cmd_buffer,
+         .signalSemaphoreCount = 0,
+         .pSignalSemaphores = nullptr
+      };
+
+      throw_on_error( ctx.submit_queue( queue::flag_t( queue::flag::e_transfer ), vk::submit_info_t( copy_submit_info ), vk::fence_t( VK_NULL_HANDLE ) ), "transfer submit" );
+      throw_on_error( ctx.submit_queue( queue::flag_t( queue::flag::e_graphics ), vk::submit_info_t( draw_submit_info ), vk::fence_t( fence ) ), "graphics submit" );
+
+      ctx.wait_for_fence( vk::fence_t( fence ) );
+      ctx.reset_fence( vk::fence_t( fence ) );
+
+      ctx.destroy_command_buffers( queue::flag_t( queue::flag::e_graphics ), { draw_cmd_buffer } );
+      ctx.destroy_command_buffers( queue::flag_t( queue::flag::e_transfer ), { copy_cmd_buffer } );
+   }
+} // namespace
+
+int main( int argc, char** argv )
+{
+   if ( argc < 2 )
+   {
+      std::cerr << "usage: " << argv[0] << " <upload_benchmark.vert> [buffer size in KiB...]\n";
+
+      return 1;
+   }
+
+   std::vector<VkDeviceSize> buffer_sizes;
+   for( int i = 2; i < argc; ++i )
+   {
+      buffer_sizes.push_back( std::stoull( argv[i] ) * 1024 );
+   }
+
+   if ( buffer_sizes.empty( ) )
+   {
+      buffer_sizes = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+   }
+
+   try
+   {
+      ui::window::create_info const window_create_info
+      {
+         .title = "upload_benchmark",
+         .position = { 100, 100 },
+         .size = { 320, 240 }
+      };
+
+      auto wnd = ui::window( ui::window::create_info_t( window_create_info ) );
+      auto ctx = context( wnd );
+
+      vk::shader_compiler const compiler;
+      auto const state = create_draw_state( ctx, compiler.load_shader( vk::shader::filepath_view_t( argv[1] ) ).first );
+
+      VkSemaphoreCreateInfo const semaphore_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0
+      };
+
+      VkFenceCreateInfo const fence_create_info
+      {
+         .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+         .pNext = nullptr,
+         .flags = 0
+      };
+
+      auto const semaphore = get_or_throw( ctx.create_semaphore( vk::semaphore_create_info_t( semaphore_create_info ) ), "semaphore" );
+      auto const fence = get_or_throw( ctx.create_fence( vk::fence_create_info_t( fence_create_info ) ), "fence" );
+
+      auto const transfer_family_index = ctx.get_queue_family_index( queue::flag_t( queue::flag::e_transfer ) );
+      auto const graphics_family_index = ctx.get_queue_family_index( queue::flag_t( queue::flag::e_graphics ) );
+      bool const has_concurrent = ctx.get_unique_family_indices( ).size( ) > 1;
+
+      std::cout << "transfer family " << transfer_family_index << ", graphics family " << graphics_family_index 
+         << ( has_concurrent ? "" : ", a single family: concurrent sharing is not measured" ) << '\n';
+
+      for( auto const size : buffer_sizes )
+      {
+         VkBufferCreateInfo const staging_create_info
+         {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .size = size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr
+         };
+
+         VmaAllocationCreateInfo staging_alloc_info = { };
+         staging_alloc_info.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+
+         auto const staging_buffer = get_or_throw( ctx.create_buffer( 
+            vk::buffer_create_info_t( staging_create_info ), 
+            vk::allocation_create_info_t( staging_alloc_info ), 
+            vk::memory_category::e_staging_buffer 
+         ), "staging buffer" );
+
+         void* p_data = nullptr;
+         vmaMapMemory( ctx.get_memory_allocator( ), staging_buffer.allocation, &p_data );
+         std::memset( p_data, 0, size );
+         vmaUnmapMemory( ctx.get_memory_allocator( ), staging_buffer.allocation );
+
+         std::uint32_t const iteration_count = std::max( 5u, static_cast<std::uint32_t>( ( 256ull * 1024 * 1024 ) / ( size * buffer_count ) ) );
+         double const megabytes = static_cast<double>( size * buffer_count ) / ( 1024.0 * 1024.0 );
+
+         std::cout << buffer_count << " buffers of " << size / 1024 << " KiB\n";
+
+         for( bool const is_exclusive : { true, false } )
+         {
+            if ( !is_exclusive && !has_concurrent )
+            {
+               continue;
+            }
+
+            auto const buffers = create_vertex_buffers( ctx, size, !is_exclusive );
+
+            auto const time = measure( iteration_count, [&] 
+            { 
+               upload_and_draw( ctx, state, staging_buffer, buffers, is_exclusive, semaphore, fence ); 
+            } );
+
+            std::cout << "   " << ( is_exclusive ? "exclusive, ownership transfer" : "concurrent" ) << ": " 
+               << time << " ms, " << megabytes * 1000.0 / time << " MiB/s\n";
+
+            for( auto const& buffer : buffers )
+            {
+               ctx.destroy_buffer( buffer );
+            }
+         }
+
+         ctx.destroy_buffer( staging_buffer );
+      }
+
+      ctx.destroy_fence( vk::fence_t( fence ) );
+      ctx.destroy_semaphore( vk::semaphore_t( semaphore ) );
+      destroy_draw_state( ctx, state );
+   }
+   catch( std::exception const& e )
+   {
+      std::cerr << e.what( ) << '\n';
+
+      return 1;
+   }
+
+   return 0;
+}